@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+# coding: utf-8
+"""
+Microbenchmark of the OrioleDB B-tree engine operations.
+
+Creates a temporary node, fills a table with the synthetic keys and runs
+orioledb_tbl_bench() from the given number of concurrent clients.  The page
+pool size sets the memory pressure: the tree doesn't fit into the pool when
+it's small.  Prints the total throughput and the latency percentiles of each
+operation in microseconds (percentiles are the maximum over the clients).
+
+Example:
+	python3 bench/btree_bench.py --key-type int8 --rows 1000000 \
+		--clients 8 --main-buffers 64MB --operations lookup,iterator
+"""
+
+import argparse
+import sys
+from tempfile import mkdtemp
+from threading import Thread
+
+import testgres
+
+OPERATIONS = ['lookup', 'lock', 'iterator', 'seqscan']
+
+
+def parse_args():
+	parser = argparse.ArgumentParser(
+	    description='OrioleDB B-tree engine microbenchmark')
+	parser.add_argument('--key-type',
+	                    default='int4',
+	                    help='type of the primary key column '
+	                    '(any type accepting integer literals)')
+	parser.add_argument('--rows',
+	                    type=int,
+	                    default=100000,
+	                    help='number of rows in the table')
+	parser.add_argument('--payload',
+	                    type=int,
+	                    default=100,
+	                    help='size of the non-key column in bytes')
+	parser.add_argument('--clients',
+	                    type=int,
+	                    default=1,
+	                    help='number of concurrent clients')
+	parser.add_argument('--ops',
+	                    type=int,
+	                    default=100000,
+	                    help='number of operations per client')
+	parser.add_argument('--seqscan-ops',
+	                    type=int,
+	                    default=10,
+	                    help='number of sequential scans per client')
+	parser.add_argument('--scan-length',
+	                    type=int,
+	                    default=100,
+	                    help='number of tuples fetched by an iterator scan')
+	parser.add_argument('--main-buffers',
+	                    default='1GB',
+	                    help='value of orioledb.main_buffers')
+	parser.add_argument('--operations',
+	                    default=','.join(OPERATIONS),
+	                    help='comma-separated list of operations to run')
+	args = parser.parse_args()
+	for operation in args.operations.split(','):
+		if operation not in OPERATIONS:
+			parser.error('unknown operation "%s"' % operation)
+	return args
+
+
+def run_client(node, args, operation, results, i):
+	nops = args.seqscan_ops if operation == 'seqscan' else args.ops
+	con = node.connect()
+	results[i] = con.execute(
+	    "SELECT ops_per_sec, latency_p50, latency_p90, latency_p99,\n"
+	    "       latency_max\n"
+	    "  FROM orioledb_tbl_bench('o_bench'::regclass, '%s', %d,\n"
+	    "                          1, %d, %d);" %
+	    (operation, nops, args.rows, args.scan_length))[0]
+	con.close()
+
+
+def run_operation(node, args, operation):
+	results = [None] * args.clients
+	threads = [
+	    Thread(target=run_client, args=(node, args, operation, results, i))
+	    for i in range(args.clients)
+	]
+	for thread in threads:
+		thread.start()
+	for thread in threads:
+		thread.join()
+	ops_per_sec = sum(r[0] for r in results)
+	latencies = [max(r[j] for r in results) for j in range(1, 5)]
+	print('%-10s %14.0f %10.2f %10.2f %10.2f %10.2f' %
+	      ((operation, ops_per_sec) + tuple(latencies)))
+
+
+def main():
+	args = parse_args()
+	node = testgres.get_new_node('bench',
+	                             base_dir=mkdtemp(prefix='btree_bench_'))
+	node.init(["--no-locale", "--encoding=UTF8"])
+	node.append_conf('postgresql.conf',
+	                 "shared_preload_libraries = orioledb\n"
+	                 "orioledb.main_buffers = %s\n"
+	                 "max_connections = %d\n" %
+	                 (args.main_buffers, args.clients + 10))
+	node.start()
+	try:
+		node.safe_psql(
+		    "CREATE EXTENSION orioledb;\n"
+		    "CREATE TABLE o_bench (\n"
+		    "	id %s NOT NULL PRIMARY KEY,\n"
+		    "	val text NOT NULL\n"
+		    ") USING orioledb;\n"
+		    "INSERT INTO o_bench\n"
+		    "	SELECT i::%s, repeat('x', %d)\n"
+		    "	FROM generate_series(1, %d) i;\n"
+		    "CHECKPOINT;\n" %
+		    (args.key_type, args.key_type, args.payload, args.rows))
+		print('%-10s %14s %10s %10s %10s %10s' %
+		      ('operation', 'ops/s', 'p50 us', 'p90 us', 'p99 us', 'max us'))
+		for operation in args.operations.split(','):
+			run_operation(node, args, operation)
+	finally:
+		node.stop()
+		node.cleanup()
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+# coding: utf-8
+"""
+End-to-end workload benchmarks of OrioleDB.
+
+Each workload runs against a fresh node configured for OrioleDB and appends
+one JSON object per line to the output file, so results from different
+builds and machines can be compared by regression tracking tools.  Run it
+from the repository root:
+
+	python3 -m bench.workload_bench --workloads tpcb,skewed_reads \
+		--output results.jsonl
+
+Workloads:
+ * tpcb -- pgbench TPC-B-like transactions.
+ * append -- insert-only append into a table with a serial primary key.
+ * skewed_reads -- zipfian point reads with main_buffers smaller than the
+   data.
+ * compress_append, compress_skewed_reads -- the same on compressed tables.
+ * checkpoint_load -- TPC-B-like load with concurrent checkpoints.
+ * recovery -- crash recovery of the given amount of WAL.
+ * s3_append -- append load and checkpoint in S3 mode against a local mock
+   server (requires moto and boto3, like t/s3_test.py).
+
+Recorded metrics are throughput (tps), the latencies of transactions
+(latency_avg_ms, latency_p99_ms), checkpoint duration (checkpoint_time_s)
+and recovery time (recovery_time_s) where applicable.
+"""
+
+import argparse
+import glob
+import json
+import os
+import platform
+import shutil
+import subprocess
+import sys
+import time
+from tempfile import mkdtemp
+from threading import Thread
+
+import testgres
+
+WORKLOADS = [
+    'tpcb', 'append', 'skewed_reads', 'compress_append',
+    'compress_skewed_reads', 'checkpoint_load', 'recovery', 's3_append'
+]
+
+APPEND_SCRIPT = """
+INSERT INTO o_append (val) VALUES (repeat('x', :payload));
+"""
+
+SKEWED_READS_SCRIPT = """
+\\set id random_zipfian(1, :rows, 1.1)
+SELECT val FROM o_reads WHERE id = :id;
+"""
+
+
+def parse_args():
+	parser = argparse.ArgumentParser(
+	    description='OrioleDB end-to-end workload benchmarks')
+	parser.add_argument('--workloads',
+	                    default=','.join(w for w in WORKLOADS
+	                                     if w != 's3_append'),
+	                    help='comma-separated list of workloads to run')
+	parser.add_argument('--output',
+	                    default='-',
+	                    help='file to append JSON results to, "-" for stdout')
+	parser.add_argument('--scale',
+	                    type=int,
+	                    default=10,
+	                    help='pgbench scale factor')
+	parser.add_argument('--clients', type=int, default=8)
+	parser.add_argument('--jobs', type=int, default=4)
+	parser.add_argument('--duration',
+	                    type=int,
+	                    default=60,
+	                    help='duration of each pgbench run in seconds')
+	parser.add_argument('--main-buffers',
+	                    default='1GB',
+	                    help='orioledb.main_buffers for in-memory workloads')
+	parser.add_argument('--small-main-buffers',
+	                    default='64MB',
+	                    help='orioledb.main_buffers for skewed reads')
+	parser.add_argument('--rows',
+	                    type=int,
+	                    default=2000000,
+	                    help='number of rows for skewed reads')
+	parser.add_argument('--payload',
+	                    type=int,
+	                    default=200,
+	                    help='size of the text column in bytes')
+	parser.add_argument('--compress',
+	                    type=int,
+	                    default=3,
+	                    help='compression level of compress_* workloads')
+	parser.add_argument('--checkpoint-interval',
+	                    type=int,
+	                    default=10,
+	                    help='seconds between checkpoints of checkpoint_load')
+	parser.add_argument('--recovery-wal-gb',
+	                    type=float,
+	                    default=1.0,
+	                    help='amount of WAL to replay by recovery')
+	parser.add_argument('--label',
+	                    default=platform.node(),
+	                    help='label of the machine in the results')
+	args = parser.parse_args()
+	for workload in args.workloads.split(','):
+		if workload not in WORKLOADS:
+			parser.error('unknown workload "%s"' % workload)
+	return args
+
+
+class Bench:
+
+	def __init__(self, args):
+		self.args = args
+		self.tmpdir = mkdtemp(prefix='workload_bench_')
+		self.node = None
+		self.s3 = None
+
+	def make_node(self, main_buffers, conf=''):
+		node = testgres.get_new_node('bench',
+		                             base_dir=os.path.join(
+		                                 self.tmpdir, 'node'))
+		node.init(["--no-locale", "--encoding=UTF8"])
+		node.append_conf(
+		    'postgresql.conf', "shared_preload_libraries = orioledb\n"
+		    "default_table_access_method = orioledb\n"
+		    "orioledb.main_buffers = %s\n"
+		    "max_connections = %d\n"
+		    "max_wal_size = 64GB\n"
+		    "checkpoint_timeout = 1d\n" %
+		    (main_buffers, self.args.clients + 20) + conf)
+		node.start()
+		node.safe_psql("CREATE EXTENSION orioledb;")
+		self.node = node
+		return node
+
+	def drop_node(self):
+		if self.node is not None:
+			self.node.stop(['-m', 'immediate'])
+			self.node.cleanup()
+			self.node = None
+
+	def pgbench(self, options):
+		"""Runs pgbench and returns tps with the latency statistics."""
+		log_dir = mkdtemp(dir=self.tmpdir)
+		prefix = os.path.join(log_dir, 'log')
+		pgbench = self.node.pgbench(options=options + [
+		    "--client",
+		    str(self.args.clients), "--jobs",
+		    str(self.args.jobs), "--time",
+		    str(self.args.duration), "--log", "--log-prefix", prefix
+		],
+		                            stdout=subprocess.PIPE,
+		                            stderr=subprocess.DEVNULL)
+		output = pgbench.communicate()[0].decode()
+		if pgbench.returncode != 0:
+			raise Exception("pgbench failed:\n" + output)
+
+		latencies = []
+		for name in glob.glob(prefix + '*'):
+			with open(name) as f:
+				for line in f:
+					latencies.append(int(line.split()[2]))
+		shutil.rmtree(log_dir)
+		latencies.sort()
+
+		tps = None
+		for line in output.splitlines():
+			if line.startswith('tps'):
+				tps = float(line.split()[2])
+				break
+
+		result = {'tps': tps}
+		if latencies:
+			result['latency_avg_ms'] = sum(latencies) / len(latencies) / 1000
+			result['latency_p99_ms'] = latencies[int(
+			    0.99 * (len(latencies) - 1))] / 1000
+		return result
+
+	def script(self, text):
+		name = os.path.join(self.tmpdir, 'script.sql')
+		with open(name, 'w') as f:
+			f.write(text)
+		return name
+
+	def checkpoint(self):
+		start = time.time()
+		self.node.safe_psql("CHECKPOINT;")
+		return time.time() - start
+
+	def tpcb(self):
+		self.make_node(self.args.main_buffers)
+		self.node.pgbench(options=["-i", "-s", str(self.args.scale)],
+		                  stdout=subprocess.DEVNULL,
+		                  stderr=subprocess.DEVNULL).wait()
+		result = self.pgbench([])
+		result['checkpoint_time_s'] = self.checkpoint()
+		return result
+
+	def append(self, compress=None):
+		self.make_node(self.args.main_buffers)
+		self.node.safe_psql("CREATE TABLE o_append (\n"
+		                    "	id bigserial PRIMARY KEY,\n"
+		                    "	val text NOT NULL\n"
+		                    ")%s;" % self.with_compress(compress))
+		result = self.pgbench([
+		    "--file",
+		    self.script(APPEND_SCRIPT), "--define",
+		    "payload=%d" % self.args.payload
+		])
+		result['checkpoint_time_s'] = self.checkpoint()
+		return result
+
+	def skewed_reads(self, compress=None):
+		self.make_node(self.args.small_main_buffers)
+		self.node.safe_psql(
+		    "CREATE TABLE o_reads (\n"
+		    "	id int PRIMARY KEY,\n"
+		    "	val text NOT NULL\n"
+		    ")%s;\n"
+		    "INSERT INTO o_reads\n"
+		    "	SELECT i, repeat('x', %d) FROM generate_series(1, %d) i;" %
+		    (self.with_compress(compress), self.args.payload, self.args.rows))
+		checkpoint_time = self.checkpoint()
+		result = self.pgbench([
+		    "--file",
+		    self.script(SKEWED_READS_SCRIPT), "--define",
+		    "rows=%d" % self.args.rows
+		])
+		result['checkpoint_time_s'] = checkpoint_time
+		return result
+
+	def with_compress(self, compress):
+		if compress is None:
+			return ""
+		return " WITH (compress = %d)" % compress
+
+	def checkpoint_load(self):
+		self.make_node(self.args.main_buffers)
+		self.node.pgbench(options=["-i", "-s", str(self.args.scale)],
+		                  stdout=subprocess.DEVNULL,
+		                  stderr=subprocess.DEVNULL).wait()
+		checkpoint_times = []
+		done = False
+
+		def checkpointer():
+			while not done:
+				time.sleep(self.args.checkpoint_interval)
+				if not done:
+					checkpoint_times.append(self.checkpoint())
+
+		thread = Thread(target=checkpointer)
+		thread.start()
+		try:
+			result = self.pgbench([])
+		finally:
+			done = True
+			thread.join()
+		if checkpoint_times:
+			result['checkpoint_time_s'] = max(checkpoint_times)
+			result['checkpoints'] = len(checkpoint_times)
+		return result
+
+	def recovery(self):
+		self.make_node(self.args.main_buffers)
+		self.node.safe_psql("CREATE TABLE o_recovery (\n"
+		                    "	id bigserial PRIMARY KEY,\n"
+		                    "	val text NOT NULL\n"
+		                    ");\n"
+		                    "CHECKPOINT;")
+		start_lsn = self.node.execute("SELECT pg_current_wal_lsn();")[0][0]
+		wal_bytes = 0
+		target = self.args.recovery_wal_gb * 1024 * 1024 * 1024
+		while wal_bytes < target:
+			self.node.safe_psql(
+			    "INSERT INTO o_recovery (val)\n"
+			    "	SELECT repeat('x', %d) FROM generate_series(1, 100000);" %
+			    self.args.payload)
+			wal_bytes = self.node.execute(
+			    "SELECT pg_current_wal_lsn() - '%s'::pg_lsn;" %
+			    start_lsn)[0][0]
+		self.node.stop(['-m', 'immediate'])
+		start = time.time()
+		self.node.start()
+		recovery_time = time.time() - start
+		return {
+		    'recovery_time_s': recovery_time,
+		    'wal_bytes': int(wal_bytes)
+		}
+
+	def s3_append(self):
+		import boto3
+		from botocore import UNSIGNED
+		from botocore.config import Config
+		from werkzeug.serving import make_ssl_devcert
+		import urllib3
+		from t.s3_test import MotoServerSSL
+
+		host = "localhost"
+		port = 5002
+		bucket = "bench-bucket"
+		region = "us-east-1"
+		urllib3.util.connection.HAS_IPV6 = False
+		ssl_key = make_ssl_devcert(os.path.join(self.tmpdir, 'key'), cn=host)
+		self.s3 = MotoServerSSL(host=host, port=port, ssl_context=ssl_key)
+		self.s3.start()
+		client = boto3.client("s3",
+		                      endpoint_url="https://%s:%d" % (host, port),
+		                      region_name=region,
+		                      aws_access_key_id="bench",
+		                      aws_secret_access_key="bench",
+		                      verify=ssl_key[0])
+		client.create_bucket(Bucket=bucket)
+
+		self.make_node(
+		    self.args.main_buffers, "orioledb.s3_mode = true\n"
+		    "orioledb.s3_host = '%s:%d/%s'\n"
+		    "orioledb.s3_region = '%s'\n"
+		    "orioledb.s3_accesskey = 'bench'\n"
+		    "orioledb.s3_secretkey = 'bench'\n"
+		    "orioledb.s3_cainfo = '%s'\n"
+		    "orioledb.s3_num_workers = 3\n" %
+		    (host, port, bucket, region, ssl_key[0]))
+		self.node.safe_psql("CREATE TABLE o_append (\n"
+		                    "	id bigserial PRIMARY KEY,\n"
+		                    "	val text NOT NULL\n"
+		                    ");")
+		result = self.pgbench([
+		    "--file",
+		    self.script(APPEND_SCRIPT), "--define",
+		    "payload=%d" % self.args.payload
+		])
+		result['checkpoint_time_s'] = self.checkpoint()
+		return result
+
+	def run(self, workload):
+		if workload == 'compress_append':
+			result = self.append(self.args.compress)
+		elif workload == 'compress_skewed_reads':
+			result = self.skewed_reads(self.args.compress)
+		else:
+			result = getattr(self, workload)()
+
+		result['commit'] = self.node.execute(
+		    "SELECT orioledb_commit_hash();")[0][0]
+		result['pg_version'] = self.node.execute("SHOW server_version;")[0][0]
+		return result
+
+	def cleanup(self):
+		self.drop_node()
+		if self.s3 is not None:
+			self.s3.stop()
+			self.s3 = None
+		shutil.rmtree(self.tmpdir, ignore_errors=True)
+
+
+def main():
+	args = parse_args()
+	output = sys.stdout if args.output == '-' else open(args.output, 'a')
+	for workload in args.workloads.split(','):
+		bench = Bench(args)
+		try:
+			result = bench.run(workload)
+		finally:
+			bench.cleanup()
+		result.update({
+		    'workload': workload,
+		    'label': args.label,
+		    'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S'),
+		    'clients': args.clients,
+		    'duration': args.duration
+		})
+		output.write(json.dumps(result, sort_keys=True) + '\n')
+		output.flush()
+	if output is not sys.stdout:
+		output.close()
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -12,7 +12,7 @@ sudo apt-get -y install -qq wget ca-certificates
 
 sudo apt-get update -qq
 
-apt_packages="build-essential flex bison pkg-config libreadline-dev make gdb libipc-run-perl libicu-dev python3 python3-dev python3-pip python3-setuptools python3-testresources libzstd1 libzstd-dev libcurl4-openssl-dev libssl-dev"
+apt_packages="build-essential flex bison pkg-config libreadline-dev make gdb libipc-run-perl libicu-dev python3 python3-dev python3-pip python3-setuptools python3-testresources libzstd1 libzstd-dev liblz4-1 liblz4-dev libcurl4-openssl-dev libssl-dev"
 if [ $GITHUB_JOB = "run-benchmark" ]; then
 	pip_packages="psycopg2-binary six testgres==1.8.9 python-telegram-bot matplotlib"
 elif [ $GITHUB_JOB = "pgindent" ]; then
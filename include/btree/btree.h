@@ -27,6 +27,7 @@
 
 typedef struct BTreeDescr BTreeDescr;
 typedef struct BTreeIterator BTreeIterator;
+typedef struct BTreeBatchLookup BTreeBatchLookup;
 typedef struct CheckpointFileHeader CheckpointFileHeader;
 
 typedef uint16 OIndexNumber;
@@ -58,6 +59,32 @@ typedef int (*OBTreeKeyCmp) (BTreeDescr *descr,
 							 void *p1, BTreeKeyType k1,
 							 void *p2, BTreeKeyType k2);
 
+/*
+ * Normalized integer representation of the search key.  Used by
+ * btree_page_search() to compare the key with page items without calling
+ * the generic comparison function.  See BTreeOps.int_search_key.
+ */
+typedef struct
+{
+	int64		value;
+	/* comparison result when the item value is equal to the key value */
+	int			eqResult;
+	/* width of the integer key in bytes: 4 or 8 */
+	uint8		width;
+
+	/*
+	 * Offsets and attribute numbers of the key value within leaf tuples and
+	 * non-leaf keys.  Offset is -1 if it's not known yet.  Fixed-format
+	 * tuples can be used only when the corresponding "fixedValid" is set.
+	 */
+	int16		leafOffset;
+	int16		nonLeafOffset;
+	AttrNumber	leafAttnum;
+	AttrNumber	nonLeafAttnum;
+	bool		leafFixedValid;
+	bool		nonLeafFixedValid;
+} BTreeIntSearchKey;
+
 typedef struct
 {
 	OInMemoryBlkno rootPageBlkno;
@@ -83,6 +110,16 @@ typedef enum BTreeOperationType
 	BTreeOperationDelete
 } BTreeOperationType;
 
+/* Kinds of tree operations counted in the meta page */
+typedef enum BTreeStatOp
+{
+	BTreeStatLookup,
+	BTreeStatInsert,
+	BTreeStatUpdate,
+	BTreeStatDelete,
+	BTreeStatOpsCount
+} BTreeStatOp;
+
 typedef enum BTreeLeafTupleDeletedStatus
 {
 	BTreeLeafTupleNonDeleted = 0,
@@ -147,6 +184,31 @@ typedef struct
 	uint32		(*hash) (BTreeDescr *desc, OTuple tuple, BTreeKeyType tupleType);
 	uint32		(*unique_hash) (BTreeDescr *desc, OTuple tuple);
 	OBTreeKeyCmp cmp;
+
+	/*
+	 * Optional.  Converts the search key into the normalized integer key
+	 * (see BTreeIntSearchKey).  Returns false if the key or the tree doesn't
+	 * allow that, then the generic `cmp` is used.
+	 */
+	bool		(*int_search_key) (BTreeDescr *desc, void *key,
+								   BTreeKeyType keyType,
+								   BTreeIntSearchKey *result);
+
+	/*
+	 * Optional.  Returns the shortest non-leaf key, which is greater than
+	 * `left` leaf tuple and less or equal than `right` leaf tuple.  Used as a
+	 * separator on leaf page split.  Returns null tuple if not applicable,
+	 * then the key made from `right` is used.
+	 */
+	OTuple		(*separator_key) (BTreeDescr *desc, OTuple left, OTuple right);
+
+	/*
+	 * Optional.  Hashes the equality search key for the lookup cache (see
+	 * btree/lookup_cache.c).  Returns false if the key isn't the equality
+	 * search for the whole key.
+	 */
+	bool		(*key_hash) (BTreeDescr *desc, void *key, BTreeKeyType keyType,
+							 uint32 *hash);
 } BTreeOps;
 
 #define MAX_NUM_DIRTY_PARTS			4
@@ -182,6 +244,43 @@ struct BTreeDescr
 	BTreeS3PartsInfo buildPartsInfo[2];
 	OXid		createOxid;
 	BTreeOps   *ops;
+
+	/*
+	 * Page pool usage settings of the tree (see OTable.buffers_* for
+	 * details).  Zeros mean no limits and the normal priority.
+	 */
+	int32		buffersMinPages;
+	int32		buffersMaxPercent;
+	int8		buffersPriority;
+
+	/*
+	 * Backend-local cache of the rightmost leaf location.  Used for the fast
+	 * path of ascending inserts.
+	 */
+	OInMemoryBlkno rightmostLeafBlkno;
+	uint32		rightmostLeafChangeCount;
+
+	/*
+	 * Backend-local find_page() statistics not yet added to the meta page
+	 * counters.
+	 */
+	uint32		localFindHits;
+	uint32		localFindMisses;
+
+	/*
+	 * Backend-local operation counters and undo bytes not yet added to the
+	 * meta page counters.
+	 */
+	uint32		localOps[BTreeStatOpsCount];
+	uint32		localOpsTotal;
+	uint32		localUndoBytes;
+
+	/*
+	 * Range of ctids reserved by btree_ctid_reserve() for this backend:
+	 * [localCtid; localCtidEnd).
+	 */
+	uint64		localCtid;
+	uint64		localCtidEnd;
 };
 
 static inline int
@@ -213,6 +312,28 @@ o_btree_needs_undo(BTreeDescr *desc, BTreeOperationType action,
 							  oldDeleted, newTuple, newOxid);
 }
 
+/* Operation counters are added to the meta page in batches */
+#define BTREE_STATS_OPS_BATCH		256
+#define BTREE_STATS_UNDO_BATCH		(64 * 1024)
+
+extern void o_btree_flush_stats(BTreeDescr *desc);
+
+static inline void
+o_btree_count_op(BTreeDescr *desc, BTreeStatOp op)
+{
+	desc->localOps[op]++;
+	if (++desc->localOpsTotal >= BTREE_STATS_OPS_BATCH)
+		o_btree_flush_stats(desc);
+}
+
+static inline void
+o_btree_count_undo(BTreeDescr *desc, Size size)
+{
+	desc->localUndoBytes += size;
+	if (desc->localUndoBytes >= BTREE_STATS_UNDO_BATCH)
+		o_btree_flush_stats(desc);
+}
+
 static inline uint32
 o_btree_hash(BTreeDescr *desc, OTuple tuple, BTreeKeyType tupleType)
 {
@@ -266,6 +387,17 @@ typedef struct
 #define TREE_NUM_LEAF_PAGES(desc) \
 	(pg_atomic_read_u32(&BTREE_GET_META(desc)->leafPagesNum))
 
+/*
+ * Get approximate number of tree leaf tuples.  Concurrent decrements might
+ * temporarily make the counter negative, so clamp it to zero.
+ */
+#define TREE_NUM_TUPLES(desc) \
+	((uint64) Max((int64) pg_atomic_read_u64(&BTREE_GET_META(desc)->numTuples), 0))
+
+/* Adjust the approximate number of tree leaf tuples */
+#define TREE_ADD_TUPLES(desc, n) \
+	(void) pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->numTuples, (n))
+
 /*
  * Check if given tree needs WAL and XIP records.  Currently, only primary index
  * tree and TOAST tree need it.  Argument is (BTreeDescr *).
@@ -355,6 +487,7 @@ extern void o_btree_init(BTreeDescr *descr);
 extern void o_btree_cleanup_pages(OInMemoryBlkno root, OInMemoryBlkno metaPageBlkno,
 								  uint32 rootPageChangeCount);
 extern ItemPointerData btree_ctid_get_and_inc(BTreeDescr *desc);
+extern void btree_ctid_reserve(BTreeDescr *desc, int count);
 extern void btree_ctid_update_if_needed(BTreeDescr *desc, ItemPointerData ctid);
 extern void btree_desc_stopevent_params_internal(BTreeDescr *desc,
 												 JsonbParseState **state);
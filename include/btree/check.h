@@ -30,6 +30,7 @@ typedef struct
 	int			nranges;
 	int64		totalSize;
 	int64		totalCompressedSize;
+	int64		totalLZ4CompressedSize;
 	BTreeCompressRange *ranges;
 } BTreeCompressStats;
 
@@ -37,5 +38,6 @@ extern bool check_btree(BTreeDescr *desc, bool force_file_check);
 extern void check_btree_compression(BTreeDescr *desc,
 									BTreeCompressStats *stats,
 									OCompress lvl);
+extern bool train_btree_compression_dict(BTreeDescr *desc);
 
 #endif							/* __BTREE_CHECK_H__ */
@@ -0,0 +1,20 @@
+/*-------------------------------------------------------------------------
+ *
+ * compact.h
+ *		Declarations for online compaction of OrioleDB B-tree data files.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/btree/compact.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __BTREE_COMPACT_H__
+#define __BTREE_COMPACT_H__
+
+#include "btree/btree.h"
+
+extern int64 btree_compact(BTreeDescr *desc);
+
+#endif							/* __BTREE_COMPACT_H__ */
@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------
+ *
+ * compressed_cache.h
+ *		Declarations for the shared cache of compressed page images.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/btree/compressed_cache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __BTREE_COMPRESSED_CACHE_H__
+#define __BTREE_COMPRESSED_CACHE_H__
+
+#include "btree/btree.h"
+
+extern Size compressed_cache_shmem_needs(void);
+extern void compressed_cache_shmem_init(Pointer ptr, bool found);
+extern void compressed_cache_put(BTreeDescr *desc, FileExtent extent,
+								 Page page);
+extern bool compressed_cache_get(BTreeDescr *desc, uint64 offset, Page page);
+extern void compressed_cache_invalidate(BTreeDescr *desc, uint64 offset);
+
+#endif							/* __BTREE_COMPRESSED_CACHE_H__ */
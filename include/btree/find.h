@@ -90,6 +90,8 @@ extern bool refind_page(OBTreeFindPageContext *context, void *key,
 						BTreeKeyType keyType, uint16 level,
 						OInMemoryBlkno blkno, uint32 pageChangeCount);
 
+extern int	btree_prefetch_keys(BTreeDescr *desc, Pointer *keys, int nkeys,
+								BTreeKeyType keyType);
 extern bool find_right_page(OBTreeFindPageContext *context, OFixedKey *hikey);
 extern bool find_left_page(OBTreeFindPageContext *context, OFixedKey *hikey);
 extern OTuple btree_find_context_lokey(OBTreeFindPageContext *context);
@@ -24,16 +24,21 @@ typedef enum OWalkPageResult
 	OWalkPageMerged,
 } OWalkPageResult;
 
+extern uint64 loaded_pages_count;
+
 extern Size btree_io_shmem_needs(void);
 extern void btree_io_shmem_init(Pointer buf, bool found);
 extern void btree_io_error_cleanup(void);
 extern void request_btree_io_lwlocks(void);
 extern int	assign_io_num(OInMemoryBlkno blkno, OffsetNumber offnum);
 extern OWalkPageResult walk_page(OInMemoryBlkno blkno, bool evict);
+extern OWalkPageResult walk_page_merge(OInMemoryBlkno blkno);
+extern OWalkPageResult walk_page_checkpoint_ahead(OInMemoryBlkno blkno);
 extern void unlock_io(int ionum);
 extern void wait_for_io_completion(int ionum);
 extern bool cleanup_btree_files(Oid datoid, Oid relnode);
 extern bool fsync_btree_files(Oid datoid, Oid relnode);
+extern void btree_smgr_sync_device(void);
 extern int	OFileRead(File file, char *buffer, int amount, off_t offset,
 					  uint32 wait_event_info);
 extern int	OFileWrite(File file, char *buffer, int amount, off_t offset,
@@ -46,12 +51,19 @@ extern char *btree_smgr_filename(BTreeDescr *desc, off_t offset,
 								 uint32 chkpNum);
 extern int	btree_smgr_read(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 							int amount, off_t offset);
+extern void btree_smgr_prefetch(BTreeDescr *desc, uint32 chkpNum,
+								int amount, off_t offset);
 extern void btree_smgr_writeback(BTreeDescr *desc, uint32 chkpNum,
 								 off_t offset, int amount);
 extern void btree_smgr_sync(BTreeDescr *desc, uint32 chkpNum, off_t length);
+extern void btree_smgr_truncate(BTreeDescr *desc, off_t oldLength,
+								off_t newLength);
 
 extern void init_btree_io_lwlocks(void);
 extern bool read_page_from_disk(BTreeDescr *desc, Pointer img, uint64 downlink, FileExtent *extent);
+extern void prefetch_page_from_disk(BTreeDescr *desc, uint64 downlink);
+extern uint64 downlink_get_s3_part(BTreeDescr *desc, uint64 downlink);
+extern void prefetch_s3_part(BTreeDescr *desc, uint64 part);
 extern void load_page(OBTreeFindPageContext *context);
 extern uint64 perform_page_io(BTreeDescr *desc, OInMemoryBlkno blkno,
 							  Page img, uint32 checkpoint_number,
@@ -62,4 +74,16 @@ extern uint64 perform_page_io_build(BTreeDescr *desc, Page img,
 									FileExtent *extent, BTreeMetaPage *metaPageBlkno);
 extern BTreeDescr *index_oids_get_btree_descr(ORelOids oids, OIndexType type);
 
+/*
+ * Returns the number of bytes written to disk for the page referenced by the
+ * on-disk downlink.
+ */
+static inline uint64
+disk_downlink_get_bytes(BTreeDescr *desc, uint64 downlink)
+{
+	if (!OCompressIsValid(desc->compress))
+		return ORIOLEDB_BLCKSZ;
+	return (uint64) DOWNLINK_GET_DISK_LEN(downlink) * ORIOLEDB_COMP_BLCKSZ;
+}
+
 #endif							/* __BTREE_IO_H__ */
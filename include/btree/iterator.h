@@ -40,6 +40,20 @@ extern OTuple o_btree_find_tuple_by_key(BTreeDescr *desc, void *key,
 										MemoryContext mcxt,
 										BTreeLocationHint *hint);
 
+extern BTreeBatchLookup *o_btree_batch_lookup_create(BTreeDescr *desc);
+extern OTuple o_btree_batch_lookup_fetch(BTreeBatchLookup *lookup, void *key,
+										 BTreeKeyType kind,
+										 CommitSeqNo readCsn,
+										 CommitSeqNo *outCsn,
+										 MemoryContext mcxt,
+										 BTreeLocationHint *hint);
+extern void o_btree_batch_lookup_free(BTreeBatchLookup *lookup);
+extern void o_btree_find_tuples_by_keys(BTreeDescr *desc, void **keys,
+										int nkeys, BTreeKeyType kind,
+										CommitSeqNo readCsn, OTuple *results,
+										CommitSeqNo *outCsns,
+										MemoryContext mcxt);
+
 extern BTreeIterator *o_btree_iterator_create(BTreeDescr *desc, void *key,
 											  BTreeKeyType kind, CommitSeqNo csn,
 											  ScanDirection scan);
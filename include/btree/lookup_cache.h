@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * lookup_cache.h
+ *		Declarations for the backend-local cache of leaf pages found by the
+ *		equality lookups.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/btree/lookup_cache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __BTREE_LOOKUP_CACHE_H__
+#define __BTREE_LOOKUP_CACHE_H__
+
+#include "btree/btree.h"
+#include "btree/find.h"
+
+extern bool lookup_cache_find_page(OBTreeFindPageContext *context,
+								   void *key, BTreeKeyType keyType,
+								   uint32 *hash);
+extern void lookup_cache_remember(OBTreeFindPageContext *context,
+								  uint32 hash);
+
+#endif							/* __BTREE_LOOKUP_CACHE_H__ */
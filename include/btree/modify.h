@@ -64,6 +64,10 @@ extern OBTreeModifyResult o_btree_modify(BTreeDescr *desc,
 										 RowLockMode lockMode,
 										 BTreeLocationHint *hint,
 										 BTreeModifyCallbackInfo *callbackInfo);
+extern int64 o_btree_delete_range(BTreeDescr *desc, Pointer low,
+								  Pointer high, BTreeKeyType keyType,
+								  OXid oxid, CommitSeqNo csn,
+								  BTreeModifyCallbackInfo *callbackInfo);
 extern OBTreeModifyResult o_btree_delete_moved_partitions(BTreeDescr *desc,
 														  Pointer key,
 														  BTreeKeyType keyType,
@@ -30,6 +30,19 @@ typedef struct
 	bool		newItem;
 } BTreePageItem;
 
+/*
+ * Chunks layout hint for the page being rewritten, based on the page access
+ * statistics.
+ */
+typedef enum
+{
+	OPageChunksLayoutDefault,
+	OPageChunksLayoutReadMostly,	/* prefer many small chunks */
+	OPageChunksLayoutWriteHot	/* prefer few large chunks */
+} OPageChunksLayout;
+
+extern void page_chunks_count_access(OInMemoryBlkno blkno, bool write);
+extern OPageChunksLayout page_chunks_get_layout(OInMemoryBlkno blkno);
 extern bool partial_load_chunk(PartialPageState *partial, Page img,
 							   OffsetNumber chunkOffset);
 extern BTreeItemPageFitType page_locator_fits_item(BTreeDescr *desc,
@@ -62,10 +75,16 @@ extern void page_locator_resize_item(Page p, BTreePageItemLocator *locator,
 									 LocationIndex newsize);
 extern void page_locator_delete_item(Page p, BTreePageItemLocator *locator);
 extern void page_split_chunk_if_needed(BTreeDescr *desc, Page p,
-									   BTreePageItemLocator *locator);
+									   BTreePageItemLocator *locator,
+									   OPageChunksLayout layout);
 extern void btree_page_reorg(BTreeDescr *desc, Page p, BTreePageItem *items,
 							 OffsetNumber count, LocationIndex hikeySize,
 							 OTuple hikey, BTreePageItemLocator *newLoc);
+extern void btree_page_reorg_layout(BTreeDescr *desc, Page p,
+									BTreePageItem *items, OffsetNumber count,
+									LocationIndex hikeySize, OTuple hikey,
+									BTreePageItemLocator *newLoc,
+									OPageChunksLayout layout);
 extern void split_page_by_chunks(BTreeDescr *desc, Page p);
 extern bool page_locator_find_real_item(Page p, PartialPageState *partial,
 										BTreePageItemLocator *locator);
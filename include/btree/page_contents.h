@@ -18,6 +18,24 @@
 
 #define NUM_SEQ_SCANS_ARRAY_SIZE	32
 
+/*
+ * Free extents of compressed trees are 1 up to FREE_EXTENTS_NUM_CLASSES
+ * chunks long.  A few free extents of each length are cached in the meta page
+ * to save the free extents B-tree lookups.  The cache is split into
+ * partitions selected by the backend, so that concurrent evicting backends
+ * and bgwriters don't contend on the same spinlock.
+ */
+#define FREE_EXTENTS_NUM_CLASSES	(ORIOLEDB_BLCKSZ / ORIOLEDB_COMP_BLCKSZ)
+#define FREE_EXTENTS_CLASS_SIZE		8
+#define FREE_EXTENTS_CACHE_PARTITIONS	4
+
+typedef struct
+{
+	slock_t		lock;
+	uint8		num[FREE_EXTENTS_NUM_CLASSES];
+	uint64		offsets[FREE_EXTENTS_NUM_CLASSES][FREE_EXTENTS_CLASS_SIZE];
+} BTreeFreeExtentsCache;
+
 /* The structure of BTree meta page.  Referenced by metaPageBlkno. */
 typedef struct
 {
@@ -27,8 +45,17 @@ typedef struct
 	SeqBufDescShared tmpBuf[2];
 	pg_atomic_uint64 numFreeBlocks;
 	pg_atomic_uint64 datafileLength[2];
+
+	/*
+	 * Data file segments written since they were last synced by checkpoint.
+	 * Bit i stands for the segment i, the last bit for all the segments past
+	 * it.
+	 */
+	pg_atomic_uint64 dirtySegments;
 	LWLock		metaLock;
 	LWLock		copyBlknoLock;
+	/* protects datafileLength[0] from concurrent extend and truncate */
+	LWLock		extendLock;
 
 	/*
 	 * A surrogate index key value which can be incremented on an INSERT
@@ -40,10 +67,44 @@ typedef struct
 	pg_atomic_uint64 ctid;
 	pg_atomic_uint32 leafPagesNum;
 
+	/*
+	 * Approximate number of non-deleted leaf tuples.  Maintained by tree
+	 * modifications and used for planner estimates, so it isn't exact under
+	 * aborted transactions.
+	 */
+	pg_atomic_uint64 numTuples;
+	/* Number of the tree pages in the page pool except the root */
+	pg_atomic_uint32 numResidentPages;
+	/* Number of the tree pages loaded from disk */
+	pg_atomic_uint64 numLoadedPages;
+	/* Number of the tree pages evicted from the page pool */
+	pg_atomic_uint64 numEvictedPages;
+	/* Number of find_page() steps to in-memory and loaded pages */
+	pg_atomic_uint64 numFindHits;
+	pg_atomic_uint64 numFindMisses;
+	/* Pages written and microseconds spent by checkpoints of the tree */
+	pg_atomic_uint64 numCheckpointPages;
+	pg_atomic_uint64 checkpointTime;
+	/* Number of lookups, inserts, updates and deletes of the tree tuples */
+	pg_atomic_uint64 numLookups;
+	pg_atomic_uint64 numInserts;
+	pg_atomic_uint64 numUpdates;
+	pg_atomic_uint64 numDeletes;
+	/* Number of page splits, merges and compactions */
+	pg_atomic_uint64 numSplits;
+	pg_atomic_uint64 numMerges;
+	pg_atomic_uint64 numCompactions;
+	/* Bytes written by eviction and checkpoints, bytes of undo generated */
+	pg_atomic_uint64 evictionBytes;
+	pg_atomic_uint64 checkpointBytes;
+	pg_atomic_uint64 undoBytes;
+
 	/* Number of running sequential scans depending on the checkpoint number */
 	pg_atomic_uint32 numSeqScans[NUM_SEQ_SCANS_ARRAY_SIZE];
 
 	BTreeS3PartsInfo partsInfo[2];
+
+	BTreeFreeExtentsCache freeExtentsCache[FREE_EXTENTS_CACHE_PARTITIONS];
 } BTreeMetaPage;
 
 StaticAssertDecl(sizeof(BTreeMetaPage) <= ORIOLEDB_BLCKSZ,
@@ -345,6 +406,9 @@ extern UndoLocation read_page_from_undo(BTreeDescr *desc, Page img,
 										CommitSeqNo csn, void *key,
 										BTreeKeyType keyType, OFixedKey *lokey);
 
+extern uint32 btree_page_ghost_key(BTreeDescr *desc, uint64 off);
+extern uint32 btree_page_initial_usage_count(BTreeDescr *desc,
+											 uint32 ghostKey);
 extern void init_new_btree_page(BTreeDescr *desc, OInMemoryBlkno blkno,
 								uint16 flags, uint16 level, bool noLock);
 extern void init_meta_page(OInMemoryBlkno blkno, uint32 leafPagesNum);
@@ -356,6 +420,7 @@ extern void page_cut_first_key(Page node);
 
 typedef struct ItemPointerData ItemPointerData;
 extern ItemPointerData btree_ctid_get_and_inc(BTreeDescr *desc);
+extern void btree_ctid_reserve(BTreeDescr *desc, int count);
 extern void btree_ctid_update_if_needed(BTreeDescr *desc, ItemPointerData ctid);
 
 extern void copy_fixed_tuple(BTreeDescr *desc, OFixedTuple *dst, OTuple src);
@@ -30,6 +30,9 @@
 #define O_PAGE_STATE_BLOCK_READ(state) ((state) | PAGE_STATE_LOCKED_FLAG | PAGE_STATE_NO_READ_FLAG)
 #define O_PAGE_STATE_READ_IS_BLOCKED(state) ((state) & PAGE_STATE_NO_READ_FLAG)
 
+/* Number of spins on read-blocked page state before joining the wait list */
+#define O_PAGE_OPTIMISTIC_READ_SPINS 64
+
 extern bool have_locked_pages(void);
 extern void lock_page(OInMemoryBlkno blkno);
 extern void relock_page(OInMemoryBlkno blkno);
@@ -39,6 +42,7 @@ extern bool page_is_locked(OInMemoryBlkno blkno);
 extern void page_block_reads(OInMemoryBlkno blkno);
 extern void unlock_page(OInMemoryBlkno blkno);
 extern void release_all_page_locks(void);
+extern bool page_spin_for_read_enable(OInMemoryBlkno blkno);
 extern void page_wait_for_read_enable(OInMemoryBlkno blkno);
 extern void btree_register_inprogress_split(OInMemoryBlkno left_blkno);
 extern void btree_unregister_inprogress_split(OInMemoryBlkno left_blkno);
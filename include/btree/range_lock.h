@@ -0,0 +1,29 @@
+/*-------------------------------------------------------------------------
+ *
+ * range_lock.h
+ *		Declarations of B-tree key-range locks.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/btree/range_lock.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __BTREE_RANGE_LOCK_H__
+#define __BTREE_RANGE_LOCK_H__
+
+#include "btree/btree.h"
+
+/* Maximum length of the key bound stored in the range lock */
+#define O_RANGE_LOCK_MAX_KEY_SIZE	256
+
+extern Size o_range_locks_shmem_needs(void);
+extern void o_range_locks_shmem_init(Pointer ptr, bool found);
+extern void o_range_lock_acquire(BTreeDescr *desc, OTuple lokey,
+								 OTuple hikey, OXid oxid);
+extern void o_range_lock_check_insert(BTreeDescr *desc, Pointer key,
+									  BTreeKeyType keyType, OXid oxid);
+extern void o_range_locks_release(void);
+
+#endif							/* __BTREE_RANGE_LOCK_H__ */
@@ -22,7 +22,8 @@
 typedef struct
 {
 	int			pageLoadTrancheId,
-				downlinksPublishTrancheId;
+				downlinksPublishTrancheId,
+				indexChunkTrancheId;
 } BTreeScanShmem;
 
 typedef struct BTreeSeqScan BTreeSeqScan;
@@ -41,12 +42,17 @@ extern BTreeSeqScan *make_btree_seq_scan(BTreeDescr *desc, CommitSeqNo csn,
 										 void *poscan);
 extern BTreeSeqScan *make_btree_seq_scan_cb(BTreeDescr *desc, CommitSeqNo csn,
 											BTreeSeqScanCallbacks *cb,
-											void *arg);
+											void *arg, void *poscan);
 extern BTreeSeqScan *make_btree_sampling_scan(BTreeDescr *desc,
 											  BlockSampler sampler);
+extern BlockNumber btree_sampling_scan_get_pages(BTreeSeqScan *scan);
 extern OTuple btree_seq_scan_getnext(BTreeSeqScan *scan, MemoryContext mctx,
 									 CommitSeqNo *tupleCsn,
 									 BTreeLocationHint *hint);
+extern int	btree_seq_scan_getnext_batch(BTreeSeqScan *scan, MemoryContext mctx,
+										 OTuple *tuples, CommitSeqNo *tupleCsns,
+										 BTreeLocationHint *hints, int maxTuples);
+extern uint64 btree_seq_scan_count(BTreeSeqScan *scan);
 extern OTuple btree_seq_scan_getnext_raw(BTreeSeqScan *scan, MemoryContext mctx,
 										 bool *end, BTreeLocationHint *hint);
 extern void free_btree_seq_scan(BTreeSeqScan *scan);
@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * undo_image_cache.h
+ *		Declarations for the shared cache of historical page images.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/btree/undo_image_cache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __BTREE_UNDO_IMAGE_CACHE_H__
+#define __BTREE_UNDO_IMAGE_CACHE_H__
+
+#include "btree/btree.h"
+
+extern Size undo_image_cache_shmem_needs(void);
+extern void undo_image_cache_shmem_init(Pointer ptr, bool found);
+extern UndoLocation undo_image_cache_get(UndoLocation startLoc,
+										 CommitSeqNo csn, Page img);
+extern void undo_image_cache_put(UndoLocation startLoc, CommitSeqNo csnLow,
+								 CommitSeqNo csnHigh, Page img,
+								 UndoLocation resultLoc);
+
+#endif							/* __BTREE_UNDO_IMAGE_CACHE_H__ */
@@ -17,6 +17,8 @@
 
 extern FileExtent get_extent(BTreeDescr *desc, uint16 len);
 extern void free_extent(BTreeDescr *desc, FileExtent extent);
+extern void free_extents_cache_flush(BTreeDescr *desc);
+extern uint64 cut_tail_free_extent(BTreeDescr *desc);
 
 typedef void (*ForEachExtentCallback) (BTreeDescr *desc, FileExtent extent, void *arg);
 extern void foreach_free_extent(BTreeDescr *desc, ForEachExtentCallback callback,
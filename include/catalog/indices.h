@@ -49,6 +49,9 @@ typedef struct oIdxSpool
 	OTableDescr *descr;
 	bool		isunique;
 
+	/* Source table for the rebuild of all the indices */
+	OTable	   *old_o_table;
+	OTableDescr *old_descr;
 } oIdxSpool;
 
 /*
@@ -113,7 +116,15 @@ typedef struct oIdxShared
 	uint32		new_position;
 	uint32		completed_position;
 	OXid		recovery_oxid;
+
+	/*
+	 * Number of shared tuplesorts.  Rebuild of all the indices needs one
+	 * tuplesort per index plus one for TOAST.
+	 */
+	int			nsharedsorts;
 	Size		o_table_size;
+	/* Non-zero when serialized old o_table follows the new one */
+	Size		old_o_table_size;
 	char		o_table_serialized[];
 } oIdxShared;
 
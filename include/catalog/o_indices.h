@@ -28,6 +28,9 @@ typedef struct
 	NameData	name;
 	bool		primaryIsCtid;
 	OCompress	compress;
+	int32		buffersMinPages;
+	int32		buffersMaxPercent;
+	int8		buffersPriority;
 	bool		nulls_not_distinct;
 	/* number of fields added using INCLUDE command explicitly */
 	/* pkey fields added implicitly in o_o_define_index_validate not counted */
@@ -7,8 +7,10 @@
  * usage during recovery. System catalog cache trees shoud use o_sys_cache_*
  * functions in sysTreesMeta (sys_trees.c), but if sys cache is
  * not TOAST tup_print function should be also provided.
- * Sys cache lookups are also cached in local backend mamory.
- * Cache entry invalidation is performed by syscache hook.
+ * Sys cache lookups are also cached in local backend mamory.  Lookups of
+ * absent entries are cached too, except during recovery.
+ * Cache entry invalidation is performed by syscache hook.  Adding a new entry
+ * to the sys cache tree sends catcache invalidation for its key.
  * Instead of physical deletion of sys cache entry we mark it as deleted.
  * Normally only not deleted entries used. During recovery we use
  * sys cache entries accroding to current WAL position.
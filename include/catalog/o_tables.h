@@ -89,6 +89,17 @@ typedef struct
 	OCompress	default_compress;
 	OCompress	primary_compress;
 	OCompress	toast_compress;
+
+	/*
+	 * Page pool usage settings.  No less than buffers_min_pages pages of each
+	 * table tree are kept from eviction.  A tree, which occupies more than
+	 * buffers_max_percent of the main pool, loads further pages with the
+	 * lowest usage count (0 means no limit).  buffers_priority is one of
+	 * OBuffersPriority values.
+	 */
+	int32		buffers_min_pages;
+	int32		buffers_max_percent;
+	int8		buffers_priority;
 	uint16		nfields;
 	uint16		primary_init_nfields;
 	uint16		nindices;
@@ -257,6 +268,8 @@ extern void orioledb_attr_to_field(OTableField *field, Form_pg_attribute attr);
 
 extern void o_tables_meta_lock(void);
 extern void o_tables_meta_lock_no_wal(void);
+extern void o_tables_meta_lock_all(void);
+extern void o_tables_meta_unlock_all(void);
 
 static inline void
 o_tables_rel_meta_lock(Relation rel)
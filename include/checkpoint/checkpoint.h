@@ -18,6 +18,7 @@
 #include "btree/page_contents.h"
 
 #include "access/xlogdefs.h"
+#include "datatype/timestamp.h"
 
 typedef struct
 {
@@ -44,7 +45,9 @@ struct CheckpointFileHeader
 	uint64		rootDownlink;
 	uint64		datafileLength;
 	uint64		numFreeBlocks;
+	uint64		numTuples;
 	uint32		leafPagesNum;
+	pg_crc32c	crc;
 };
 
 typedef enum
@@ -145,8 +148,9 @@ typedef enum
 } CurKeyType;
 
 #define SHARED_ROOT_INFO_INSERT_NUM_LOCKS 128
+#define O_TABLES_META_NUM_LOCKS		16
 
-#define XID_RECS_QUEUE_SIZE			(max_procs * 4)
+#define XID_RECS_QUEUE_SIZE			(max_procs * 32)
 
 typedef struct
 {
@@ -170,9 +174,21 @@ typedef struct
 	pid_t		pid;
 	double		dirtyPagesEstimate;
 	uint64		pagesWritten;
+	/* progress of the checkpoint in progress, startTime is 0 if none */
+	TimestampTz startTime;
+	uint64		pagesVisited;
+	uint64		bytesWritten;
+	uint64		autonomousPages;
+	uint64		lockWaitTime;
 	/* helps to avoid skip a new table for the checkpoint in progress */
 	int			oTablesMetaTrancheId;
-	LWLock		oTablesMetaLock;
+
+	/*
+	 * Partitions of the table metadata lock.  Metadata changes take the
+	 * partition of their process in the shared mode, while the checkpointer
+	 * takes all of them exclusively (see o_tables_meta_lock_all()).
+	 */
+	LWLockPadded oTablesMetaLocks[O_TABLES_META_NUM_LOCKS];
 	int			oSysTreesTrancheId;
 	LWLock		oSysTreesLock;
 	int			oSharedRootInfoInsertTrancheId;
@@ -243,6 +259,7 @@ extern void o_after_checkpoint_cleanup_hook(XLogRecPtr checkPointRedo,
 
 extern bool page_is_under_checkpoint(BTreeDescr *desc, OInMemoryBlkno blkno);
 extern bool tree_is_under_checkpoint(BTreeDescr *desc);
+extern bool checkpoint_is_ahead_of_tree(BTreeDescr *desc);
 extern bool get_checkpoint_number(BTreeDescr *desc, OInMemoryBlkno blkno, uint32 *checkpoint_number, bool *copy_blkno);
 extern uint32 get_cur_checkpoint_number(ORelOids *oids, OIndexType type, bool *checkpoint_concurrent);
 extern bool can_use_checkpoint_extents(BTreeDescr *desc, uint32 chkp_num);
@@ -261,5 +278,8 @@ extern void systrees_lock_callback(UndoLocation location,
 								   bool abort, bool changeCountsValid);
 extern void before_writing_xids_file(int chkpnum);
 extern void write_to_xids_queue(XidFileRec *rec);
+extern void checkpoint_file_header_set_crc(CheckpointFileHeader *header);
+extern void checkpoint_file_header_check_crc(CheckpointFileHeader *header,
+											 const char *filename);
 
 #endif							/* __CHECKPOINT_H__ */
@@ -33,12 +33,13 @@
 #include "utils/relcache.h"
 
 #define ORIOLEDB_VERSION "OrioleDB public beta 4"
-#define ORIOLEDB_BINARY_VERSION 4
+#define ORIOLEDB_BINARY_VERSION 7
 #define ORIOLEDB_DATA_DIR "orioledb_data"
 #define ORIOLEDB_UNDO_DIR "orioledb_undo"
 #define ORIOLEDB_EVT_EXTENSION "evt"
 #define ORIOLEDB_RMGR_ID (129)
 #define ORIOLEDB_XLOG_CONTAINER (0x00)
+#define ORIOLEDB_XLOG_CONTAINER_LZ4 (0x10)
 
 /*
  * perform_page_split() removes a key data from first right page downlink.
@@ -53,6 +54,8 @@
 #define ORIOLEDB_BLCKSZ		8192
 /* size of on disk compressed page chunk */
 #define ORIOLEDB_COMP_BLCKSZ	512
+/* memory alignment of buffers used for O_DIRECT data file IO */
+#define O_DIRECT_IO_ALIGN	4096
 /* size of data file segment */
 #define ORIOLEDB_SEGMENT_SIZE	(1024 * 1024 * 1024)
 /* size of S3 data file part */
@@ -195,6 +198,8 @@ typedef struct
 	FileExtent	fileExtent;
 	uint32		flags:4,
 				type:28;
+	/* sampled read and write counters, see page_chunks_count_access() */
+	pg_atomic_uint32 accessStats;
 	proclist_head waitersList;
 } OrioleDBPageDesc;
 
@@ -234,11 +239,31 @@ extern int	max_procs;
 extern OrioleDBPageDesc *page_descs;
 extern bool remove_old_checkpoint_files;
 extern bool debug_disable_bgwriter;
+extern int	bgwriter_num_workers;
+extern int	prewarm_workers;
+extern int	recovery_tree_loaders;
+extern int	bgwriter_merge_pages;
+extern int	bgwriter_checkpoint_ahead_pages;
+extern int	compressed_buffers_guc;
+extern int	undo_image_cache_buffers_guc;
 extern MemoryContext btree_insert_context;
 extern MemoryContext btree_seqscan_context;
 extern double o_checkpoint_completion_ratio;
 extern int	max_io_concurrency;
+extern int	max_range_locks;
+extern int	max_summaries;
 extern bool use_mmap;
+extern bool orioledb_direct_io;
+extern int	buffers_huge_page_size;
+extern bool buffers_numa_interleave;
+extern bool main_buffers_ghost;
+extern int	catalog_buffers_pinned_pages;
+extern bool catalog_buffers_pin_upper_levels;
+extern bool undo_compress;
+extern int	compaction_rate_limit;
+extern int	checkpoint_write_rate_limit;
+extern int	checkpoint_iops_limit;
+extern int	usage_count_batch;
 extern bool use_device;
 extern int	device_fd;
 extern char *device_filename;
@@ -249,8 +274,18 @@ extern int	default_primary_compress;
 extern int	default_toast_compress;
 #if PG_VERSION_NUM >= 140000
 extern bool orioledb_table_description_compress;
+extern bool wal_compress;
+extern bool standby_reads_low_priority;
 #endif
 extern bool orioledb_s3_mode;
+extern bool enable_btree_suffix_truncation;
+extern bool enable_btree_optimized_split;
+extern bool enable_bulk_load_sort;
+extern bool enable_batch_index_insert;
+extern bool enable_fkey_prefetch;
+extern int	iterator_prefetch_pages;
+extern double iterator_prefetch_threshold;
+extern int	lookup_cache_size;
 extern int	s3_num_workers;
 extern int	s3_desired_size;
 extern int	s3_queue_size_guc;
@@ -259,6 +294,7 @@ extern char *s3_region;
 extern char *s3_accesskey;
 extern char *s3_secretkey;
 extern char *s3_cainfo;
+extern bool s3_compress;
 
 #define GET_CUR_PROCDATA() \
 	(AssertMacro(MyProc->pgprocno >= 0 && \
@@ -275,11 +311,30 @@ extern char *s3_cainfo;
 extern void o_check_init_db_dir(Oid dbOid);
 extern void orioledb_check_shmem(void);
 
+/*
+ * Usage of a shared memory area in bytes, see orioledb_shmem_stats().
+ * highWater is the maximum of 'used' since the start.
+ */
+typedef struct
+{
+	int64		used;
+	int64		free;
+	int64		highWater;
+} OShmemUsage;
+
 typedef int OCompress;
 #define O_COMPRESS_DEFAULT (10)
 #define InvalidOCompress (-1)
 #define OCompressIsValid(compress) ((compress) != InvalidOCompress)
 
+/*
+ * OCompress values with O_COMPRESS_LZ4 bit set select LZ4 codec.  Other valid
+ * values are zstd compression levels.
+ */
+#define O_COMPRESS_LZ4 (0x100)
+#define OCompressIsLZ4(compress) \
+	(OCompressIsValid(compress) && ((compress) & O_COMPRESS_LZ4))
+
 /*
  * We save number of chunks inside downlinks instead of size of compressed data
  * because it helps us to avoid too often setup dirty flag for parent if page
@@ -288,6 +343,26 @@ typedef int OCompress;
  * The header of compressed data contains compressed data length.
  */
 typedef uint16 OCompressHeader;
+
+/*
+ * The highest bit of the header is set for images compressed with LZ4.  The
+ * compressed length is always less than ORIOLEDB_BLCKSZ, so images written
+ * before the codec choice was introduced are read as zstd.
+ */
+#define O_COMPRESS_HEADER_LZ4 (0x8000)
+#define O_COMPRESS_HEADER_GET_SIZE(header) ((header) & ~O_COMPRESS_HEADER_LZ4)
+/*
+ * Priority of the table pages in the page pool.  Pages of the low priority
+ * tables are loaded with the lowest usage count and are evicted first.  Pages
+ * of the high priority tables are loaded with the high usage count.
+ */
+typedef enum OBuffersPriority
+{
+	OBuffersPriorityLow = -1,
+	OBuffersPriorityNormal = 0,
+	OBuffersPriorityHigh = 1
+} OBuffersPriority;
+
 typedef struct ORelOptions
 {
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
@@ -295,6 +370,9 @@ typedef struct ORelOptions
 	int			compress_offset;
 	int			primary_compress_offset;
 	int			toast_compress_offset;
+	int			buffers_min_pages;
+	int			buffers_max_percent;
+	int			buffers_priority;
 } ORelOptions;
 
 typedef struct OBTOptions
@@ -37,7 +37,6 @@ extern uint64 recovery_queue_data_size;
 
 #define GET_WORKER_QUEUE(worker_id) ((void*)(recovery_first_queue \
 										+ recovery_queue_data_size * (worker_id)))
-#define GET_WORKER_ID(hash) ((hash) % recovery_pool_size_guc)
 
 /*
  * Recovery from master to workers messages format.
@@ -45,6 +44,7 @@ extern uint64 recovery_queue_data_size;
 #define RECOVERY_INSERT ((uint16) 1 << 0)
 #define RECOVERY_DELETE ((uint16) 1 << 1)
 #define RECOVERY_UPDATE ((uint16) 1 << 2)
+#define RECOVERY_UPDATE_DELTA ((uint16) 1 << 3)
 #define RECOVERY_COMMIT ((uint16) 1 << 4)
 #define RECOVERY_ROLLBACK ((uint16) 1 << 5)
 #define RECOVERY_FINISHED ((uint16) 1 << 6)
@@ -56,8 +56,14 @@ extern uint64 recovery_queue_data_size;
 #define RECOVERY_ROLLBACK_TO_SAVEPOINT ((uint16) 1 << 12)
 #define RECOVERY_WORKER_PARALLEL_INDEX_BUILD ((uint16) 1 << 13)
 #define RECOVERY_LEADER_PARALLEL_INDEX_BUILD ((uint16) 1 << 14)
-#define RECOVERY_MODIFY (RECOVERY_INSERT | RECOVERY_DELETE | RECOVERY_UPDATE)
-#define RECOVERY_QUEUE_BUF_SIZE (8 * 1024)
+#define RECOVERY_MODIFY (RECOVERY_INSERT | RECOVERY_DELETE | RECOVERY_UPDATE | \
+						 RECOVERY_UPDATE_DELTA)
+/*
+ * Size of the batch of messages sent to the worker queue at once.  It should
+ * be well below the minimal orioledb.recovery_queue_size, so the startup
+ * process doesn't wait for the whole queue to be drained.
+ */
+#define RECOVERY_QUEUE_BUF_SIZE (64 * 1024)
 
 
 typedef struct
@@ -113,6 +119,15 @@ typedef struct
 	pg_atomic_uint64 commitPtr;
 	pg_atomic_uint64 retainPtr;
 	uint32		flushedUndoLocCompletedCheckpointNumber;
+
+	/* Statistics for orioledb_recovery_workers() */
+	pg_atomic_uint64 startTime;
+	pg_atomic_uint64 sentBytes;
+	pg_atomic_uint64 receivedBytes;
+	pg_atomic_uint64 appliedRecords;
+	pg_atomic_uint64 loadedPages;
+	pg_atomic_uint64 sendWaitTime;
+	pg_atomic_uint64 syncWaitTime;
 } RecoveryWorkerPtrs;
 
 typedef struct
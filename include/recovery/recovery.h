@@ -47,12 +47,17 @@ extern XLogRecPtr recovery_get_current_ptr(void);
 extern int	recovery_queue_size_guc;
 extern int	recovery_pool_size_guc;
 extern int	recovery_idx_pool_size_guc;
+extern bool recovery_prefetch;
 extern OXid recovery_oxid;
 
 typedef struct BTreeDescr BTreeDescr;
 
 extern OTuple recovery_rec_insert(BTreeDescr *desc, OTuple tuple, bool *allocated, int *size);
 extern OTuple recovery_rec_update(BTreeDescr *desc, OTuple tuple, bool *allocated, int *size);
+extern OTuple recovery_rec_update_delta(BTreeDescr *desc, OTuple oldTuple,
+										OTuple tuple, int *size);
+extern OTuple recovery_update_delta_get_key(OTuple rec, int *size);
+extern OTuple recovery_update_delta_apply(BTreeDescr *desc, OTuple rec);
 extern OTuple recovery_rec_delete(BTreeDescr *desc, OTuple tuple, bool *allocated, int *size);
 extern OTuple recovery_rec_delete_key(BTreeDescr *desc, OTuple key, bool *allocated, int *size);
 
@@ -30,6 +30,7 @@
 #define WAL_REC_ROLLBACK_TO_SAVEPOINT (11)
 #define WAL_REC_JOINT_COMMIT (12)
 #define WAL_REC_TRUNCATE	(13)
+#define WAL_REC_UPDATE_DELTA (14)
 
 /* Constants for commitInProgressXlogLocation */
 #define OWalTmpCommitPos			(0)
@@ -71,6 +72,24 @@ typedef struct
 	uint8		length[sizeof(OffsetNumber)];
 } WALRecModify;
 
+/*
+ * Header of WAL_REC_UPDATE_DELTA payload.  It's followed by the primary key
+ * and the bytes of the new tuple between the prefix and the suffix shared
+ * with the previous tuple version.  Hashes of both versions let the replay
+ * tell whether the delta applies to the tuple found in the tree.
+ */
+typedef struct
+{
+	uint8		keyFormatFlags;
+	uint8		keyLength[sizeof(OffsetNumber)];
+	uint8		oldLength[sizeof(OffsetNumber)];
+	uint8		newLength[sizeof(OffsetNumber)];
+	uint8		prefixLength[sizeof(OffsetNumber)];
+	uint8		suffixLength[sizeof(OffsetNumber)];
+	uint8		oldHash[sizeof(uint32)];
+	uint8		newHash[sizeof(uint32)];
+} WALRecUpdateDelta;
+
 typedef struct
 {
 	uint8		recType;
@@ -105,9 +124,13 @@ typedef struct
 } WALRecTruncate;
 
 #define LOCAL_WAL_BUFFER_SIZE	(8192)
+/* Containers shorter than this aren't worth compressing */
+#define WAL_COMPRESS_MIN_LENGTH	(256)
 #define ORIOLEDB_WAL_PREFIX	"o_wal"
 #define ORIOLEDB_WAL_PREFIX_SIZE (5)
 
+extern Size wal_shmem_needs(void);
+extern void wal_shmem_init(Pointer ptr, bool found);
 extern void add_modify_wal_record(uint8 rec_type, BTreeDescr *desc,
 								  OTuple tuple, OffsetNumber length);
 extern void add_o_tables_meta_lock_wal_record(void);
@@ -123,6 +146,8 @@ extern void wal_rollback(OXid oxid);
 extern XLogRecPtr log_logical_wal_container(Pointer ptr, int length);
 extern void o_wal_insert(BTreeDescr *desc, OTuple tuple);
 extern void o_wal_update(BTreeDescr *desc, OTuple tuple);
+extern void o_wal_update_delta(BTreeDescr *desc, OTuple oldTuple,
+							   OTuple tuple);
 extern void o_wal_delete(BTreeDescr *desc, OTuple tuple);
 extern void o_wal_delete_key(BTreeDescr *desc, OTuple key);
 extern void add_truncate_wal_record(ORelOids oids);
@@ -41,6 +41,7 @@ extern Size s3_headers_shmem_needs(void);
 extern void s3_headers_shmem_init(Pointer buf, bool found);
 extern void s3_headers_increase_loaded_parts(uint64 inc);
 extern bool s3_header_lock_part(S3HeaderTag tag, int index);
+extern S3PartStatus s3_header_get_part_status(S3HeaderTag tag, int index);
 extern S3PartStatus s3_header_mark_part_loading(S3HeaderTag tag, int index);
 extern void s3_header_mark_part_loaded(S3HeaderTag tag, int index);
 extern void s3_header_unlock_part(S3HeaderTag tag, int index, bool setDirty);
@@ -21,9 +21,11 @@
 
 extern Size s3_queue_shmem_needs(void);
 extern void s3_queue_init_shmem(Pointer ptr, bool found);
+extern void s3_queue_shmem_usage(OShmemUsage *usage);
 extern S3TaskLocation s3_queue_get_insert_location(void);
 extern S3TaskLocation s3_queue_put_task(Pointer data, uint32 len);
 extern S3TaskLocation s3_queue_try_pick_task(void);
+extern bool s3_queue_has_ready_task(void);
 Pointer		s3_queue_get_task(S3TaskLocation taskLocation);
 extern void s3_queue_erase_task(S3TaskLocation taskLocation);
 extern void s3_queue_wait_for_location(S3TaskLocation location);
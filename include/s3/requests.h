@@ -17,5 +17,8 @@ extern bool s3_put_file(char *objectname, char *filename);
 extern void s3_put_empty_dir(char *objectname);
 extern bool s3_put_file_part(char *objectname, char *filename, int partnum);
 extern void s3_get_file_part(char *objectname, char *filename, int partnum);
+extern bool s3_read_file_part_range(uint32 chkpNum, Oid datoid, Oid relnode,
+									int32 segNum, int32 partNum,
+									uint64 offset, int amount, Pointer buffer);
 
 #endif							/* __S3_REQUESTS_H__ */
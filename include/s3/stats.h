@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * stats.h
+ *		Declarations for statistics of S3 requests.
+ *
+ * Copyright (c) 2023, OrioleDATA Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/s3/stats.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __S3_STATS_H__
+#define __S3_STATS_H__
+
+#include "utils/timestamp.h"
+
+typedef enum
+{
+	S3StatsGetPart,
+	S3StatsPutPart,
+	S3StatsPutFile,
+	S3StatsRangeGet,
+	S3StatsQueueWait,
+	S3StatsNumOps
+} S3StatsOp;
+
+extern Size s3_stats_shmem_needs(void);
+extern void s3_stats_shmem_init(Pointer ptr, bool found);
+extern void s3_stats_set_op(S3StatsOp op);
+extern void s3_stats_report(S3StatsOp op, uint64 bytes, TimestampTz start);
+extern void s3_stats_report_error(void);
+extern void s3_stats_report_retry(void);
+
+#endif							/* __S3_STATS_H__ */
@@ -57,6 +57,7 @@ typedef struct
 
 extern Size s3_workers_shmem_needs(void);
 extern void s3_workers_init_shmem(Pointer ptr, bool found);
+extern void s3_workers_wakeup(void);
 extern void register_s3worker(int num);
 PGDLLEXPORT void s3worker_main(Datum);
 extern S3TaskLocation s3_schedule_file_write(uint32 chkpNum, char *filename,
@@ -17,9 +17,36 @@
 #include "tableam/handler.h"
 #include "tableam/scan.h"
 
-#include "lib/rbtree.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
+#include "utils/dsa.h"
 
 typedef struct OBitmapScan OBitmapScan;
+typedef struct OKeyBitmap OKeyBitmap;
+
+typedef enum
+{
+	OParallelBitmapInitial,		/* nobody started building the bitmap */
+	OParallelBitmapInProgress,	/* one participant builds the bitmap */
+	OParallelBitmapFinished		/* bitmap is published in bitmap */
+} OParallelBitmapState;
+
+/*
+ * Shared state of parallel bitmap scan.  The first participant builds the key
+ * bitmap and puts its serialized copy to the query DSA.  Then participants
+ * split the primary key scan in the same way as parallel sequential scan
+ * does.
+ */
+typedef struct OParallelBitmapScanData
+{
+	slock_t		mutex;
+	ConditionVariable cv;
+	OParallelBitmapState state;
+	dsa_pointer bitmap;
+	ParallelOScanDescData poscan;
+} OParallelBitmapScanData;
+
+typedef OParallelBitmapScanData *OParallelBitmapScan;
 
 typedef struct OBitmapHeapPlanState
 {
@@ -33,6 +60,7 @@ typedef struct OBitmapHeapPlanState
 	MemoryContext cxt;
 	OBitmapScan *scan;
 	OEACallsCounters *eaCounters;
+	OParallelBitmapScan pscan;
 } OBitmapHeapPlanState;
 
 extern OBitmapScan *o_make_bitmap_scan(OBitmapHeapPlanState *bitmap_state,
@@ -43,15 +71,22 @@ extern OBitmapScan *o_make_bitmap_scan(OBitmapHeapPlanState *bitmap_state,
 extern TupleTableSlot *o_exec_bitmap_fetch(OBitmapScan *scan,
 										   CustomScanState *node);
 extern void o_free_bitmap_scan(OBitmapScan *scan);
+extern void o_parallel_bitmap_scan_init(OParallelBitmapScan pscan);
+extern void o_parallel_bitmap_scan_reinit(OParallelBitmapScan pscan,
+										  dsa_area *area);
 
-extern RBTree *o_keybitmap_create(void);
-extern void o_keybitmap_insert(RBTree *rbtree, uint64 value);
-extern void o_keybitmap_intersect(RBTree *a, RBTree *b);
-extern void o_keybitmap_union(RBTree *a, RBTree *b);
-extern void o_keybitmap_free(RBTree *tree);
-extern bool o_keybitmap_is_empty(RBTree *rbtree);
-extern bool o_keybitmap_test(RBTree *rbtree, uint64 value);
-extern bool o_keybitmap_range_is_valid(RBTree *rbtree, uint64 low, uint64 high);
-extern uint64 o_keybitmap_get_next(RBTree *rbtree, uint64 prev, bool *found);
+extern OKeyBitmap *o_keybitmap_create(void);
+extern void o_keybitmap_insert(OKeyBitmap *bitmap, uint64 value);
+extern void o_keybitmap_intersect(OKeyBitmap *a, OKeyBitmap *b);
+extern void o_keybitmap_union(OKeyBitmap *a, OKeyBitmap *b);
+extern void o_keybitmap_free(OKeyBitmap *bitmap);
+extern bool o_keybitmap_is_empty(OKeyBitmap *bitmap);
+extern bool o_keybitmap_test(OKeyBitmap *bitmap, uint64 value);
+extern bool o_keybitmap_range_is_valid(OKeyBitmap *bitmap, uint64 low,
+									   uint64 high);
+extern uint64 o_keybitmap_get_next(OKeyBitmap *bitmap, uint64 prev,
+								   bool *found);
+extern dsa_pointer o_keybitmap_serialize(OKeyBitmap *bitmap, dsa_area *area);
+extern OKeyBitmap *o_keybitmap_deserialize(dsa_area *area, dsa_pointer ptr);
 
 #endif							/* __TABLEAM_BITMAP_SCAN_H__ */
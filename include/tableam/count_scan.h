@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------
+ *
+ * count_scan.h
+ *		Declarations for count(*) pushdown to OrioleDB tables.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/tableam/count_scan.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __TABLEAM_COUNT_SCAN_H__
+#define __TABLEAM_COUNT_SCAN_H__
+
+#include "postgres.h"
+
+#include "nodes/extensible.h"
+#include "optimizer/planner.h"
+
+extern create_upper_paths_hook_type old_create_upper_paths_hook;
+extern CustomScanMethods o_count_scan_methods;
+
+extern void orioledb_create_upper_paths_hook(PlannerInfo *root,
+											 UpperRelationKind stage,
+											 RelOptInfo *input_rel,
+											 RelOptInfo *output_rel,
+											 void *extra);
+
+#endif							/* __TABLEAM_COUNT_SCAN_H__ */
@@ -27,6 +27,7 @@
 #include "commands/explain.h"
 #include "executor/tuptable.h"
 #include "nodes/pathnodes.h"
+#include "utils/uuid.h"
 
 /* tableam/descr.c */
 
@@ -48,6 +49,21 @@ typedef struct
 typedef struct OComparator OComparator;
 typedef struct OComparatorKey OComparatorKey;
 
+/*
+ * Kinds of the index field comparison, which are done inline without calling
+ * the comparator.  Detected by the opclass comparison function.
+ */
+typedef enum
+{
+	OFieldCmpGeneric = 0,
+	OFieldCmpInt2,
+	OFieldCmpInt4,
+	OFieldCmpInt8,
+	OFieldCmpOid,
+	OFieldCmpUuid,
+	OFieldCmpTextC
+} OFieldCmpKind;
+
 /*
  * The index field descriptor
  */
@@ -71,6 +87,7 @@ typedef struct
 	 * and opclass.
 	 */
 	OComparator *comparator;
+	OFieldCmpKind cmpKind;
 } OIndexField;
 
 typedef struct AttrNumberMap
@@ -105,6 +122,14 @@ struct OIndexDescr
 	ExprState  *predicate_state;
 	ExprContext *econtext;
 
+	/*
+	 * If the predicate consists only of "column IS [NOT] NULL" checks, they
+	 * are evaluated directly over the slot without ExprState.
+	 */
+	int			nPredicateNullTests;
+	AttrNumber *predicateNullTestAttnums;
+	bool	   *predicateNullTestIsNull;
+
 	/* Tuple descriptor and format specifier for non-leaf tuples */
 	TupleDesc	nonLeafTupdesc;
 	OTupleFixedFormatSpec nonLeafSpec;
@@ -145,6 +170,11 @@ struct OIndexDescr
 	/* Compression rate used in this index */
 	OCompress	compress;
 
+	/* Page pool usage settings of the table */
+	int32		buffersMinPages;
+	int32		buffersMaxPercent;
+	int8		buffersPriority;
+
 	/* The maximal value of tableAttnum among the fields[] */
 	int			maxTableAttnum;
 
@@ -261,6 +291,68 @@ extern EvictedTreeData *read_evicted_data(ORelOids oids, uint32 chkp_num);
 extern void oFillFieldOpClassAndComparator(OIndexField *field, Oid datoid, Oid opclassoid);
 extern void o_finish_sort_support_function(OComparator *comparator, SortSupport ssup);
 
+static inline int
+o_cmp_inline_values(int64 left, int64 right)
+{
+	if (left > right)
+		return 1;
+	else if (left < right)
+		return -1;
+	return 0;
+}
+
+/*
+ * Compares two non-null values of the index field.  Common types are
+ * compared inline, others are passed to the field comparator.
+ */
+static inline int
+o_call_field_comparator(OIndexField *field, Datum left, Datum right)
+{
+	switch (field->cmpKind)
+	{
+		case OFieldCmpInt2:
+			return o_cmp_inline_values(DatumGetInt16(left),
+									   DatumGetInt16(right));
+		case OFieldCmpInt4:
+			return o_cmp_inline_values(DatumGetInt32(left),
+									   DatumGetInt32(right));
+		case OFieldCmpInt8:
+			return o_cmp_inline_values(DatumGetInt64(left),
+									   DatumGetInt64(right));
+		case OFieldCmpOid:
+			return o_cmp_inline_values(DatumGetObjectId(left),
+									   DatumGetObjectId(right));
+		case OFieldCmpUuid:
+			return memcmp(DatumGetPointer(left), DatumGetPointer(right),
+						  UUID_LEN);
+		case OFieldCmpTextC:
+			{
+				Pointer		l = DatumGetPointer(left);
+				Pointer		r = DatumGetPointer(right);
+				int			len1,
+							len2,
+							cmp;
+
+				/* Compressed or external values need detoasting */
+				if (VARATT_IS_EXTENDED(l) && !VARATT_IS_SHORT(l))
+					break;
+				if (VARATT_IS_EXTENDED(r) && !VARATT_IS_SHORT(r))
+					break;
+
+				len1 = VARSIZE_ANY_EXHDR(l);
+				len2 = VARSIZE_ANY_EXHDR(r);
+				cmp = memcmp(VARDATA_ANY(l), VARDATA_ANY(r), Min(len1, len2));
+				if (cmp == 0 && len1 != len2)
+					cmp = (len1 < len2) ? -1 : 1;
+				return cmp;
+			}
+		case OFieldCmpGeneric:
+			break;
+	}
+
+	return o_call_comparator(field->comparator, left, right);
+}
+
 extern void o_add_invalidate_undo_item(ORelOids oids, uint32 flags);
 extern void o_invalidate_undo_item_callback(UndoLocation location,
 											UndoStackItem *baseItem,
@@ -19,6 +19,7 @@
 #include "access/tableam.h"
 #include "nodes/execnodes.h"
 #include "nodes/pathnodes.h"
+#include "portability/instr_time.h"
 #include "rewrite/rewriteHandler.h"
 
 extern bool is_orioledb_rel(Relation rel);
@@ -32,9 +33,14 @@ typedef struct
 	uint32		load;			/* load_page() */
 	uint32		lock;			/* lock_page() */
 	uint32		evict;			/* evict_page() */
+	uint32		s3Parts;		/* S3 parts fetched by read */
+	uint64		decompressed;	/* bytes of decompressed pages */
+	uint64		undoVersions;	/* undo versions visited by
+								 * o_find_tuple_version() */
+	double		lockWait;		/* time waiting for page locks in ms */
 } OEACallsCounter;
 
-#define EA_COUNTERS_NUM (5)		/* number of EXPLAIN ANALYZE counters */
+#define EA_COUNTERS_NUM (8)		/* number of EXPLAIN ANALYZE counters */
 
 /*
  * EXPLAIN ANALYZE counters for different trees involved in single executor
@@ -61,11 +67,11 @@ typedef struct
  */
 extern OEACallsCounters *ea_counters;
 
-/* returns AnalyzeCallsCounter for specified index number */
+/* returns AnalyzeCallsCounter for specified tree */
 static inline OEACallsCounter *
-get_ea_counters(OrioleDBPageDesc *desc)
+get_ea_counters_by_oids(ORelOids oids)
 {
-	OIndexNumber ix_num = find_tree_in_descr(ea_counters->descr, desc->oids);
+	OIndexNumber ix_num = find_tree_in_descr(ea_counters->descr, oids);
 
 	if (ix_num == InvalidIndexNumber)
 		return &ea_counters->others;
@@ -74,6 +80,13 @@ get_ea_counters(OrioleDBPageDesc *desc)
 	return &ea_counters->indices[ix_num];
 }
 
+/* returns AnalyzeCallsCounter for the tree of the page */
+static inline OEACallsCounter *
+get_ea_counters(OrioleDBPageDesc *desc)
+{
+	return get_ea_counters_by_oids(desc->oids);
+}
+
 /* increases EXPLAIN_ANALYZE counter for o_btree_read_page() call */
 #define EA_READ_INC(blkno)  \
 	if (ea_counters != NULL)	\
@@ -124,6 +137,36 @@ get_ea_counters(OrioleDBPageDesc *desc)
 			ix_counter->evict++; \
 	}
 
+/* increases EXPLAIN_ANALYZE counter of S3 parts fetched for the tree */
+#define EA_S3_PART_INC(oids)  \
+	if (ea_counters != NULL)	\
+		get_ea_counters_by_oids(oids)->s3Parts++;
+
+/* adds the page bytes decompressed for the tree to EXPLAIN_ANALYZE counter */
+#define EA_DECOMPRESS_ADD(oids, bytes)  \
+	if (ea_counters != NULL)	\
+		get_ea_counters_by_oids(oids)->decompressed += (bytes);
+
+/* increases EXPLAIN_ANALYZE counter of undo versions visited for the tree */
+#define EA_UNDO_VERSION_INC(oids)  \
+	if (ea_counters != NULL)	\
+		get_ea_counters_by_oids(oids)->undoVersions++;
+
+/*
+ * adds the time since 'start' to EXPLAIN_ANALYZE counter of the page lock
+ * wait time
+ */
+#define EA_LOCK_WAIT_ADD(blkno, start)  \
+	if (ea_counters != NULL)	\
+	{	\
+		OrioleDBPageDesc *desc = O_GET_IN_MEMORY_PAGEDESC(blkno);	\
+		OEACallsCounter *ix_counter = get_ea_counters(desc); \
+		instr_time	duration; \
+		INSTR_TIME_SET_CURRENT(duration); \
+		INSTR_TIME_SUBTRACT(duration, (start)); \
+		ix_counter->lockWait += INSTR_TIME_GET_MILLISEC(duration); \
+	}
+
 extern void cleanup_btree(Oid datoid, Oid relnode, bool files);
 extern bool o_drop_shared_root_info(Oid datoid, Oid relnode);
 extern void o_tableam_descr_init(void);
@@ -199,6 +242,8 @@ typedef struct ParallelOScanDescData
 	pg_atomic_uint64 downlinkIndex;
 	int			workersReportedCount;	/* number of workers that reported
 										 * disk downlinks number */
+	int			workersDiskStarted; /* number of workers that finished the
+									 * in-memory part of the scan */
 	bits8		flags;
 	int			nworkers;
 	dsm_handle	dsmHandle;
@@ -17,6 +17,25 @@
 #include "tableam/scan.h"
 
 #include "access/sdir.h"
+#include "storage/lwlock.h"
+
+/*
+ * Shared state of the parallel index scan.  Workers claim consecutive chunks
+ * of the key range.  The chunk bounds are taken from the downlinks of the
+ * internal pages just above the leaves.
+ */
+typedef struct OParallelIndexScanData
+{
+	LWLock		lock;
+	bool		started;
+	bool		finished;
+	/* the scan can't be split, so one participant does it all */
+	bool		serialClaimed;
+	/* the low bound of the next chunk */
+	OFixedShmemKey nextKey;
+} OParallelIndexScanData;
+
+typedef OParallelIndexScanData *OParallelIndexScan;
 
 typedef struct OScanState
 {
@@ -31,8 +50,28 @@ typedef struct OScanState
 	bool		exact;
 	OBTreeKeyRange curKeyRange;
 	BTreeIterator *iterator;
+	/* reused by exact key lookups */
+	BTreeBatchLookup *lookup;
+	/*
+	 * secondary tuples read ahead to fetch their primary tuples in a batch
+	 */
+	OTuple	   *prefetchTuples;
+	CommitSeqNo *prefetchCsns;
+	OTuple	   *prefetchResults;
+	BTreeLocationHint *prefetchHints;
+	BTreeBatchLookup *primaryLookup;
+	int			prefetchCount;
+	int			prefetchPos;
+	int			prefetchSkip;
+	int			prefetchBackoff;
+	bool		prefetchFinished;
 	IndexScanDescData *scandesc;
 	List	   *indexQuals;
+	/* parallel scan state, NULL for non-parallel scan */
+	OParallelIndexScan pscan;
+	bool		parallelSerial;
+	OFixedKey	chunkLow;
+	OFixedKey	chunkHigh;
 	/* used only by direct modify functions */
 	CmdType		cmd;
 	CommitSeqNo csn;
@@ -53,6 +92,8 @@ extern OTuple o_index_scan_getnext(OTableDescr *descr, OScanState *ostate,
 								   BTreeLocationHint *hint);
 extern TupleTableSlot *o_exec_fetch(OScanState *ostate, ScanState *ss,
 									CommitSeqNo csn);
+extern void o_parallel_index_scan_init(OParallelIndexScan pscan);
+extern void o_index_scan_batch_reset(OScanState *ostate);
 extern bool o_exec_qual(ExprContext *econtext, ExprState *qual,
 						TupleTableSlot *slot);
 extern TupleTableSlot *o_exec_project(ProjectionInfo *projInfo,
@@ -87,6 +87,14 @@ typedef struct
 extern TupleTableSlot *o_tbl_insert(OTableDescr *descr, Relation relation,
 									TupleTableSlot *slot, OXid oxid,
 									CommitSeqNo csn);
+extern void o_tbl_multi_insert(OTableDescr *descr, Relation relation,
+							   TupleTableSlot **slots, int ntuples,
+							   OXid oxid, CommitSeqNo csn);
+extern bool o_tbl_bulk_load_allowed(OTableDescr *descr, Relation relation);
+extern void o_tbl_bulk_load_put(OTableDescr *descr, Relation relation,
+								TupleTableSlot **slots, int ntuples);
+extern void o_tbl_bulk_load_finish(OTableDescr *descr, Relation relation);
+extern void o_tbl_bulk_load_cleanup(SubTransactionId subid);
 extern TupleTableSlot *o_tbl_insert_with_arbiter(Relation rel,
 												 OTableDescr *descr,
 												 TupleTableSlot *slot,
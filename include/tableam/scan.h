@@ -15,6 +15,8 @@
 
 #include "postgres.h"
 
+#include "btree/btree.h"
+
 #include "nodes/extensible.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -39,6 +41,8 @@ extern bool orioledb_set_plain_rel_pathlist_hook(PlannerInfo *root,
 												 RelOptInfo *rel,
 												 RangeTblEntry *rte);
 
+extern Cost o_tree_page_cost(BTreeDescr *desc, ORelOids *oids,
+							 Cost page_cost);
 extern bool is_o_custom_scan(CustomScan *scan);
 extern bool is_o_custom_scan_state(CustomScanState *scan);
 
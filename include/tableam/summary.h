@@ -0,0 +1,57 @@
+/*-------------------------------------------------------------------------
+ *
+ * summary.h
+ *		Declarations of min/max summaries of OrioleDB table columns.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/tableam/summary.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __TABLEAM_SUMMARY_H__
+#define __TABLEAM_SUMMARY_H__
+
+#include "btree/btree.h"
+#include "tableam/descr.h"
+
+#include "nodes/extensible.h"
+#include "optimizer/pathnode.h"
+
+/* Maximum number of key ranges in the single summary */
+#define O_SUMMARY_MAX_ZONES			4096
+/* Maximum length of the key starting a summary key range */
+#define O_SUMMARY_MAX_KEY_SIZE		64
+
+/*
+ * Reference to the summary used by a scan.  The summary might be dropped or
+ * rebuilt concurrently, then the reference just stops matching.
+ */
+typedef struct
+{
+	int			slotnum;
+	uint64		generation;
+	AttrNumber	attnum;
+	Oid			typid;
+} OSummaryRef;
+
+extern Size o_summaries_shmem_needs(void);
+extern void o_summaries_shmem_init(Pointer ptr, bool found);
+extern bool o_summary_type_supported(Oid typid);
+extern int64 o_summary_datum_get_int64(Datum value, Oid typid);
+extern void o_summary_build(OTableDescr *descr, AttrNumber attnum);
+extern void o_summary_drop(OTableDescr *descr);
+extern void o_summary_add_tuple(BTreeDescr *desc, OTuple tuple);
+extern bool o_summary_find(ORelOids oids, CommitSeqNo csn, OSummaryRef *ref);
+extern bool o_summary_range_matches(BTreeDescr *desc, OSummaryRef *ref,
+									OTuple low, OTuple high,
+									int64 minValue, int64 maxValue,
+									double *fraction);
+
+/* summary_scan.c */
+extern CustomScanMethods o_summary_scan_methods;
+extern void o_add_summary_scan_path(PlannerInfo *root, RelOptInfo *rel,
+									RangeTblEntry *rte, OTableDescr *descr);
+
+#endif							/* __TABLEAM_SUMMARY_H__ */
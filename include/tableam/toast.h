@@ -24,6 +24,10 @@
 
 /* external function used by toast_fetch_datum() */
 extern struct varlena *o_detoast(struct varlena *attr);
+/* fetches only the part of value needed for its slice */
+extern struct varlena *o_detoast_slice(struct varlena *attr,
+									   int32 sliceoffset,
+									   int32 slicelength);
 
 /*
  * BTree functions.
@@ -39,6 +39,12 @@ typedef struct
 	 *
 	 * [checkpointRetainStartLocation; checkpointRetainEndLocation) -- range of
 	 * undo locations required for recovery from the checkpoint.
+	 *
+	 * writtenToFilesBytes, readFromFilesBytes and fileReadsCount count undo
+	 * files IO for orioledb_undo_stats().
+	 *
+	 * maxBufferUsage is the maximal observed size of the circular buffer part
+	 * which is reserved and not yet written to the files.
 	 */
 	pg_atomic_uint64 lastUsedLocation;
 	pg_atomic_uint64 advanceReservedLocation;
@@ -53,6 +59,10 @@ typedef struct
 	pg_atomic_uint64 cleanedLocation;
 	pg_atomic_uint64 cleanedCheckpointStartLocation;
 	pg_atomic_uint64 cleanedCheckpointEndLocation;
+	pg_atomic_uint64 writtenToFilesBytes;
+	pg_atomic_uint64 readFromFilesBytes;
+	pg_atomic_uint64 fileReadsCount;
+	pg_atomic_uint64 maxBufferUsage;
 	slock_t		minUndoLocationsMutex;
 	uint32		minUndoLocationsChangeCount;
 	int			undoWriteTrancheId;
@@ -162,6 +172,7 @@ extern UndoMeta *undo_meta;
 
 extern Size undo_shmem_needs(void);
 extern void undo_shmem_init(Pointer buf, bool found);
+extern void undo_shmem_usage(OShmemUsage *usage);
 
 /*
  * UndoReserveType used here only for assertions and can be removed,
@@ -182,6 +193,7 @@ extern Pointer get_undo_record_unreserved(UndoReserveType type,
 										  Size size);
 extern Size get_reserved_undo_size(UndoReserveType type);
 extern void release_undo_size(UndoReserveType type);
+extern void release_undo_cache(void);
 extern void add_new_undo_stack_item(UndoLocation location);
 extern UndoLocation get_subxact_undo_location(void);
 extern void read_shared_undo_locations(UndoStackLocations *to, UndoStackSharedLocations *from);
@@ -208,6 +220,7 @@ extern void undo_snapshot_register_hook(Snapshot snapshot);
 extern void undo_snapshot_deregister_hook(Snapshot snapshot);
 extern void orioledb_snapshot_hook(Snapshot snapshot);
 extern void add_subxact_undo_item(SubTransactionId parentSubid);
+extern void undo_record_pending_savepoints(void);
 extern void rollback_to_savepoint(UndoStackKind kind,
 								  SubTransactionId parentSubid,
 								  bool changeCountsValid);
@@ -19,6 +19,8 @@ extern Tuplesortstate *tuplesort_begin_orioledb_index(OIndexDescr *idx,
 													  int workMem,
 													  bool randomAccess,
 													  SortCoordinate coordinate);
+extern Tuplesortstate *tuplesort_begin_orioledb_bulk_load(OIndexDescr *primary,
+														  int workMem);
 extern Tuplesortstate *tuplesort_begin_orioledb_toast(OIndexDescr *toast,
 													  OIndexDescr *primary,
 													  int workMem,
@@ -120,6 +120,12 @@ extern bool generic_toast_delete_optional_wal(ToastAPI *api, void *key,
 extern Pointer generic_toast_get(ToastAPI *api, void *key, Size data_size,
 								 CommitSeqNo csn, void *arg);
 
+/* Returns only the given slice of the value, reading the covering chunks */
+extern Pointer generic_toast_get_slice(ToastAPI *api, void *key,
+									   Size data_size, Size slice_offset,
+									   Size slice_length, CommitSeqNo csn,
+									   void *arg);
+
 /* Returns tuple and size of data if found, or NULL otherwise */
 extern Pointer generic_toast_get_any(ToastAPI *api, void *key,
 									 Size *data_size, CommitSeqNo csn,
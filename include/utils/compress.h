@@ -13,9 +13,18 @@
 #ifndef __COMPRESS_H__
 #define __COMPRESS_H__
 
+/* max size of the dictionary trained for a BTree */
+#define O_COMPRESS_DICT_SIZE (16 * 1024)
+
+extern Size o_compress_shmem_needs(void);
+extern void o_compress_shmem_init(Pointer ptr, bool found);
 extern void o_compress_init(void);
-extern Pointer o_compress_page(Pointer page, size_t *size, OCompress lvl);
-extern void o_decompress_page(Pointer src, size_t size, Pointer page);
+extern Pointer o_compress_page(Pointer page, size_t *size, OCompress lvl,
+							   Oid datoid, Oid relnode);
+extern void o_decompress_page(Pointer src, OCompressHeader header, Pointer page,
+							  Oid datoid, Oid relnode);
+extern bool o_compress_train_dict(Oid datoid, Oid relnode, Pointer samples,
+								  size_t *sizes, int nsamples);
 extern OCompress o_compress_max_lvl(void);
 
 #endif							/* __COMPRESS_H__ */
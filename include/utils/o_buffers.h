@@ -24,6 +24,7 @@ typedef struct
 	const char *groupCtlTrancheName;
 	const char *bufferCtlTrancheName;
 	uint32		buffersCount;
+	bool		compress;
 
 	/* these fields are initilized in o_buffers.c */
 	uint32		groupsCount;
@@ -32,6 +33,15 @@ typedef struct
 	File		curFile;
 	char		curFileName[MAXPGPATH];
 	uint64		curFileNum;
+
+	/* backend-local state of read-ahead and write-behind */
+	int64		lastReadBlockNum;
+	int64		readAheadBlockNum;
+	int			readDirection;
+	uint32		seqReadCount;
+	int64		lastWriteEnd;
+	int64		writebackStart;
+	int64		writebackEnd;
 } OBuffersDesc;
 
 extern Size o_buffers_shmem_needs(OBuffersDesc *desc);
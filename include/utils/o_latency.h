@@ -0,0 +1,39 @@
+/*-------------------------------------------------------------------------
+ *
+ * o_latency.h
+ *		Declarations for latency histograms of OrioleDB operations.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/utils/o_latency.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __O_LATENCY_H__
+#define __O_LATENCY_H__
+
+#include "portability/instr_time.h"
+
+/*
+ * Operations, which latency histograms are collected.  Should be in sync with
+ * oLatencyOpNames.
+ */
+typedef enum
+{
+	OLatencyPageLoad,
+	OLatencyEviction,
+	OLatencyUndoReserve,
+	OLatencyCommitWal,
+	OLatencyCheckpointWrite,
+	OLatencyOpsCount
+} OLatencyOp;
+
+extern Size o_latency_shmem_needs(void);
+extern void o_latency_shmem_init(Pointer ptr, bool found);
+extern void o_latency_report(OLatencyOp op, instr_time start);
+extern void o_latency_flush(void);
+
+#define O_LATENCY_START(start) INSTR_TIME_SET_CURRENT(start)
+
+#endif							/* __O_LATENCY_H__ */
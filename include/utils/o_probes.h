@@ -0,0 +1,60 @@
+/*-------------------------------------------------------------------------
+ *
+ * o_probes.h
+ *		Static probes of OrioleDB for the dynamic tracing tools.
+ *
+ * When PostgreSQL is built with --enable-dtrace, the probes described in
+ * probes.d are compiled into the module and can be attached by bpftrace,
+ * SystemTap or DTrace without rebuilding the server.  Otherwise, all the
+ * TRACE_ORIOLEDB_*() macros are empty.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/utils/o_probes.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __O_PROBES_H__
+#define __O_PROBES_H__
+
+#ifdef ENABLE_DTRACE
+
+#include "utils/probes_defs.h"
+
+#else
+
+#define TRACE_ORIOLEDB_PAGE_LOAD_START(INT1, INT2, INT3) do {} while (0)
+#define TRACE_ORIOLEDB_PAGE_LOAD_START_ENABLED() (0)
+#define TRACE_ORIOLEDB_PAGE_LOAD_DONE(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_PAGE_LOAD_DONE_ENABLED() (0)
+#define TRACE_ORIOLEDB_PAGE_WRITE_START(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_PAGE_WRITE_START_ENABLED() (0)
+#define TRACE_ORIOLEDB_PAGE_WRITE_DONE(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_PAGE_WRITE_DONE_ENABLED() (0)
+#define TRACE_ORIOLEDB_PAGE_SPLIT(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_PAGE_SPLIT_ENABLED() (0)
+#define TRACE_ORIOLEDB_PAGE_MERGE(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_PAGE_MERGE_ENABLED() (0)
+#define TRACE_ORIOLEDB_UNDO_RESERVE(INT1) do {} while (0)
+#define TRACE_ORIOLEDB_UNDO_RESERVE_ENABLED() (0)
+#define TRACE_ORIOLEDB_UNDO_WRITE_START(INT1, INT2) do {} while (0)
+#define TRACE_ORIOLEDB_UNDO_WRITE_START_ENABLED() (0)
+#define TRACE_ORIOLEDB_UNDO_WRITE_DONE(INT1) do {} while (0)
+#define TRACE_ORIOLEDB_UNDO_WRITE_DONE_ENABLED() (0)
+#define TRACE_ORIOLEDB_UNDO_OVERFLOW() do {} while (0)
+#define TRACE_ORIOLEDB_UNDO_OVERFLOW_ENABLED() (0)
+#define TRACE_ORIOLEDB_CHECKPOINT_TREE_START(INT1, INT2, INT3) do {} while (0)
+#define TRACE_ORIOLEDB_CHECKPOINT_TREE_START_ENABLED() (0)
+#define TRACE_ORIOLEDB_CHECKPOINT_TREE_DONE(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_CHECKPOINT_TREE_DONE_ENABLED() (0)
+#define TRACE_ORIOLEDB_RECOVERY_RECORD(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_RECOVERY_RECORD_ENABLED() (0)
+#define TRACE_ORIOLEDB_S3_REQUEST_START(INT1, INT2) do {} while (0)
+#define TRACE_ORIOLEDB_S3_REQUEST_START_ENABLED() (0)
+#define TRACE_ORIOLEDB_S3_REQUEST_DONE(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_ORIOLEDB_S3_REQUEST_DONE_ENABLED() (0)
+
+#endif							/* ENABLE_DTRACE */
+
+#endif							/* __O_PROBES_H__ */
@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------
+ *
+ * o_wait_events.h
+ *		Declarations for OrioleDB-specific wait events.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/utils/o_wait_events.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __O_WAIT_EVENTS_H__
+#define __O_WAIT_EVENTS_H__
+
+#include "pgstat.h"
+
+/*
+ * OrioleDB waits, which are not waits for regular LWLocks.  Each of them is
+ * registered as a separate LWLock tranche, so its name is shown as
+ * wait_event in pg_stat_activity.
+ */
+typedef enum
+{
+	OWaitEventPageLock,
+	OWaitEventPageReadEnable,
+	OWaitEventPageChangeCount,
+	OWaitEventUndoReserve,
+	OWaitEventS3Queue,
+	OWaitEventsCount
+} OWaitEvent;
+
+extern int *oWaitEventTrancheIds;
+
+extern Size o_wait_events_shmem_needs(void);
+extern void o_wait_events_shmem_init(Pointer ptr, bool found);
+
+static inline uint32
+o_wait_event_info(OWaitEvent event)
+{
+	return PG_WAIT_LWLOCK | oWaitEventTrancheIds[event];
+}
+
+#endif							/* __O_WAIT_EVENTS_H__ */
@@ -43,8 +43,26 @@ struct OPagePool
 {
 	/* count of available to reserve pages in the pool */
 	pg_atomic_uint64 *availablePagesCount;
+	/* minimum of availablePagesCount since the start */
+	pg_atomic_uint64 *minAvailablePagesCount;
 	/* count of dirty pages in the pool */
 	pg_atomic_uint32 *dirtyPagesCount;
+	/* count of pages reclaimed by merging sparse pages */
+	pg_atomic_uint64 *mergedPagesCount;
+	/* count of pages loaded from disk */
+	pg_atomic_uint64 *loadedPagesCount;
+	/* count of loaded pages found in the ghost history */
+	pg_atomic_uint64 *ghostHitsCount;
+	/* count of clock runs by processes failed to reserve pages */
+	pg_atomic_uint64 *backendEvictionsCount;
+
+	/*
+	 * Ghost history of evicted pages: the direct-mapped array of the page
+	 * keys, see ppool_ghost_insert().  ghostSize is zero when the history is
+	 * disabled for the pool.
+	 */
+	pg_atomic_uint32 *ghost;
+	uint32		ghostSize;
 	/* init position for the ucm */
 	OInMemoryBlkno location;
 	/* offset of the pool in the o_shared_buffers */
@@ -53,6 +71,8 @@ struct OPagePool
 	OInMemoryBlkno size;
 	/* reserved pages count by type array */
 	OInMemoryBlkno numPagesReserved[PPOOL_RESERVE_COUNT];
+	/* locally cached pages taken from availablePagesCount */
+	int			numPagesCached;
 	/* usage counter map and their size in shared memory */
 	UsageCountMap ucm;
 	Size		ucmShmemSize;
@@ -66,9 +86,17 @@ struct OPagePool
 
 extern Size ppool_estimate_space(OPagePool *pool, OInMemoryBlkno offset, OInMemoryBlkno size, bool debug);
 extern void ppool_shmem_init(OPagePool *pool, Pointer ptr, bool found);
+extern void ppool_set_partition(int num);
 extern OInMemoryBlkno ppool_free_pages_count(OPagePool *pool);
+extern OInMemoryBlkno ppool_min_free_pages_count(OPagePool *pool);
 extern OInMemoryBlkno ppool_dirty_pages_count(OPagePool *pool);
+extern uint64 ppool_merged_pages_count(OPagePool *pool);
+extern uint64 ppool_backend_evictions_count(OPagePool *pool);
+extern void ppool_ghost_insert(OPagePool *pool, uint32 key);
+extern uint32 ppool_loaded_page_usage_count(OPagePool *pool, uint32 key);
 extern void ppool_run_clock(OPagePool *pool, bool evict, volatile sig_atomic_t *shutdown_requested);
+extern int	ppool_run_merge_clock(OPagePool *pool, int count, volatile sig_atomic_t *shutdown_requested);
+extern int	ppool_run_checkpoint_ahead_clock(OPagePool *pool, int count, volatile sig_atomic_t *shutdown_requested);
 
 extern void ppool_reserve_pages(OPagePool *pool, int kind, int count);
 extern void ppool_release_reserved(OPagePool *pool, uint32 mask);
@@ -20,8 +20,17 @@ extern bool enable_stopevents;
 extern bool trace_stopevents;
 extern MemoryContext stopevents_cxt;
 
+/*
+ * Builds with ORIOLEDB_NO_STOPEVENTS defined (make NO_STOPEVENTS=1) have the
+ * constant false here, so the compiler removes all the stop event call sites
+ * including their parameters construction.
+ */
+#ifdef ORIOLEDB_NO_STOPEVENTS
+#define STOPEVENTS_ENABLED() (false)
+#else
 #define STOPEVENTS_ENABLED() \
 	(enable_stopevents || trace_stopevents)
+#endif
 
 #define STOPEVENT(event_id, params) \
 	do { \
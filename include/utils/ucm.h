@@ -17,10 +17,13 @@
 #define UCM_USAGE_LEVELS	7
 #define UCM_FREE_PAGES_LEVEL 7
 #define UCM_LEVELS			8
+#define UCM_MAX_DEFERRED	64
 
 typedef struct UsageCountMap
 {
 	pg_atomic_uint32 *epoch;
+	/* approximate number of page accesses counted by the map */
+	pg_atomic_uint64 *accessCount;
 	pg_atomic_uint32 *ucm;
 	OInMemoryBlkno offset;
 	OInMemoryBlkno size;
@@ -28,18 +31,28 @@ typedef struct UsageCountMap
 	int			nonLeaf;
 	int			rootFactor;
 	uint32		usageCounter;
+	/* backend-local usage count increments not applied yet */
+	int			numDeferred;
+	OInMemoryBlkno deferredBlknos[UCM_MAX_DEFERRED];
+	uint8		deferredUsageCounts[UCM_MAX_DEFERRED];
 } UsageCountMap;
 
 extern Size estimate_ucm_space(UsageCountMap *map, OInMemoryBlkno offset, OInMemoryBlkno size);
 extern void init_ucm(UsageCountMap *map, Pointer ptr, bool found);
 extern void page_inc_usage_count(UsageCountMap *map, OInMemoryBlkno blkno,
 								 uint32 usageCount, bool no_skip);
+extern void ucm_flush_deferred(UsageCountMap *map);
 extern void page_change_usage_count(UsageCountMap *map, OInMemoryBlkno blkno, uint32 usageCount);
 extern bool ucm_check_map(UsageCountMap *map);
 extern bool ucm_epoch_needs_shift(UsageCountMap *map);
 extern void ucm_epoch_shift(UsageCountMap *map);
 extern OInMemoryBlkno ucm_next_blkno(UsageCountMap *map, OInMemoryBlkno init_blkno, uint32 mask_src);
-extern OInMemoryBlkno ucm_occupy_free_page(UsageCountMap *map);
+extern OInMemoryBlkno ucm_occupy_free_page(UsageCountMap *map,
+											 OInMemoryBlkno init_blkno);
+extern uint32 ucm_loaded_page_usage_count(UsageCountMap *map, int boost);
+extern void ucm_bulk_read_start(void);
+extern void ucm_bulk_read_end(void);
+extern void ucm_bulk_read_reset(void);
 extern void set_skip_ucm(void);
 extern void unset_skip_ucm(void);
 
@@ -15,7 +15,7 @@
 
 extern bool IsBGWriter;
 
-extern void register_bgwriter(void);
+extern void register_bgwriter(int num);
 PGDLLEXPORT void bgwriter_main(Datum);
 
 #endif							/* __BGWRITER_H__ */
@@ -0,0 +1,22 @@
+/*-------------------------------------------------------------------------
+ *
+ * prewarm.h
+ *		Routines for saving and restoring the resident page set.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/workers/prewarm.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __PREWARM_H__
+#define __PREWARM_H__
+
+#define PREWARM_FILENAME		(ORIOLEDB_DATA_DIR "/prewarm")
+
+extern void prewarm_dump_resident_pages(void);
+extern void register_prewarm_worker(int num);
+PGDLLEXPORT void prewarm_worker_main(Datum);
+
+#endif							/* __PREWARM_H__ */
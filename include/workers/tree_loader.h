@@ -0,0 +1,21 @@
+/*-------------------------------------------------------------------------
+ *
+ * tree_loader.h
+ *		Routines for loading the trees ahead of recovery.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/include/workers/tree_loader.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef __TREE_LOADER_H__
+#define __TREE_LOADER_H__
+
+#include "postmaster/bgworker.h"
+
+extern BackgroundWorkerHandle *tree_loader_register(int num);
+PGDLLEXPORT void tree_loader_main(Datum);
+
+#endif							/* __TREE_LOADER_H__ */
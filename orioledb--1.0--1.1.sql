@@ -9,3 +9,205 @@ CREATE FUNCTION orioledb_tbl_bin_structure(relid oid,
 RETURNS text
 AS 'MODULE_PATHNAME'
 VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_merged_pages()
+RETURNS int8
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_tbl_train_compression_dict(relid oid)
+RETURNS int
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_tbl_compact(relid oid)
+RETURNS int8
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_page_hit_stats(OUT pool_name text,
+										OUT accesses int8,
+										OUT loads int8,
+										OUT ghost_hits int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_sys_tree_stats(OUT tree_num int4,
+										OUT resident_pages int8,
+										OUT loads int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_tree_stats(OUT datoid oid,
+									OUT reloid oid,
+									OUT relnode oid,
+									OUT index_type text,
+									OUT pool_name text,
+									OUT resident_pages int8,
+									OUT pages_by_level int8[],
+									OUT dirty_pages int8,
+									OUT avg_usage_level float8,
+									OUT loads int8,
+									OUT evictions int8,
+									OUT find_hits int8,
+									OUT find_misses int8,
+									OUT checkpoint_pages int8,
+									OUT checkpoint_time float8,
+									OUT lookups int8,
+									OUT inserts int8,
+									OUT updates int8,
+									OUT deletes int8,
+									OUT splits int8,
+									OUT merges int8,
+									OUT compactions int8,
+									OUT eviction_bytes int8,
+									OUT checkpoint_bytes int8,
+									OUT undo_bytes int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE VIEW orioledb_tree_stats AS
+	SELECT * FROM orioledb_tree_stats();
+
+CREATE FUNCTION orioledb_undo_stats(OUT buffer_size int8,
+									OUT reserved_size int8,
+									OUT retained_size int8,
+									OUT transaction_retained_size int8,
+									OUT oldest_retain_pid int4,
+									OUT oldest_retain_kind text,
+									OUT oldest_retain_size int8,
+									OUT files_size int8,
+									OUT written_to_files int8,
+									OUT read_from_files int8,
+									OUT file_reads int8)
+RETURNS record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE VIEW orioledb_undo AS
+	SELECT * FROM orioledb_undo_stats();
+
+CREATE FUNCTION orioledb_recovery_workers(OUT worker_id int4,
+										  OUT kind text,
+										  OUT replayed_lsn pg_lsn,
+										  OUT queued_bytes int8,
+										  OUT sent_bytes int8,
+										  OUT applied_records int8,
+										  OUT applied_records_per_sec float8,
+										  OUT page_loads int8,
+										  OUT send_wait_time float8,
+										  OUT sync_wait_time float8,
+										  OUT start_time timestamptz)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE VIEW orioledb_recovery_workers AS
+	SELECT * FROM orioledb_recovery_workers();
+
+CREATE FUNCTION orioledb_checkpoint_progress(OUT checkpoint_num int8,
+											 OUT pid int4,
+											 OUT datoid oid,
+											 OUT reloid oid,
+											 OUT relnode oid,
+											 OUT index_type text,
+											 OUT pages_visited int8,
+											 OUT pages_written int8,
+											 OUT dirty_pages_estimate int8,
+											 OUT bytes_written int8,
+											 OUT autonomous_images int8,
+											 OUT lock_wait_time float8,
+											 OUT start_time timestamptz,
+											 OUT progress float8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE VIEW orioledb_checkpoint_progress AS
+	SELECT * FROM orioledb_checkpoint_progress();
+
+CREATE FUNCTION orioledb_s3_cache_stats(OUT loaded_parts int8,
+										OUT desired_parts int8,
+										OUT hits int8,
+										OUT misses int8)
+RETURNS record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_s3_stats(OUT operation text,
+								  OUT count int8,
+								  OUT bytes int8,
+								  OUT errors int8,
+								  OUT retries int8,
+								  OUT total_time float8,
+								  OUT latency_bounds int4[],
+								  OUT latency_histogram int8[])
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE VIEW orioledb_s3_stats AS
+	SELECT * FROM orioledb_s3_stats();
+
+CREATE FUNCTION orioledb_tbl_bench(relid oid,
+								   operation text,
+								   nops int8,
+								   key_min int8,
+								   key_max int8,
+								   scan_length int4 DEFAULT 100,
+								   OUT ops int8,
+								   OUT found int8,
+								   OUT total_time float8,
+								   OUT ops_per_sec float8,
+								   OUT latency_p50 float8,
+								   OUT latency_p90 float8,
+								   OUT latency_p99 float8,
+								   OUT latency_max float8)
+RETURNS record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_shmem_stats(OUT name text,
+									 OUT size int8,
+									 OUT used int8,
+									 OUT free int8,
+									 OUT high_water int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE VIEW orioledb_shmem_stats AS
+	SELECT * FROM orioledb_shmem_stats();
+
+CREATE FUNCTION orioledb_latency_stats(OUT operation text,
+									   OUT count int8,
+									   OUT total_time float8,
+									   OUT max_time float8,
+									   OUT latency_bounds int8[],
+									   OUT latency_histogram int8[])
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE VIEW orioledb_latency_stats AS
+	SELECT * FROM orioledb_latency_stats();
+
+CREATE FUNCTION orioledb_latency_stats_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_range_lock(relid regclass,
+									lokey anyelement,
+									hikey anyelement)
+RETURNS void
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
+
+CREATE FUNCTION orioledb_tbl_summarize(relid regclass, attname name)
+RETURNS void
+AS 'MODULE_PATHNAME'
+VOLATILE LANGUAGE C;
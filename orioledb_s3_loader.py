@@ -61,8 +61,9 @@ class OrioledbS3ObjectLoader:
 
 	def run(self):
 		wal_dir = os.path.join(self.data_dir, 'pg_wal')
-		loader.download_files_in_directory(self.bucket_name, 'data/',
-										   self.data_dir)
+		chkp_num = loader.download_files_in_directory(self.bucket_name,
+													  'data/', self.data_dir)
+		loader.download_manifest_references(self.bucket_name, chkp_num)
 		loader.download_files_in_directory(self.bucket_name,
 										   'orioledb_data/',
 										   f"{self.data_dir}/orioledb_data",
@@ -74,6 +75,71 @@ class OrioledbS3ObjectLoader:
 		loader.download_file(self.bucket_name, f"wal/{wal_file}",
 							 f"{wal_dir}/{wal_file}")
 
+	# Download the files which were unchanged since the previous backups, and
+	# therefore are referenced by the manifest from older checkpoints.
+	def download_manifest_references(self, bucket_name, chkp_num):
+		manifest_path = f"{self.data_dir}/orioledb_data/s3_manifest"
+		if not os.path.exists(manifest_path):
+			return
+
+		files = []
+		bundles = {}
+		with open(manifest_path, 'r') as file:
+			for line in file:
+				(_, num, bundle, name) = line.rstrip('\n').split(' ', 3)
+				num = int(num)
+				bundle = int(bundle)
+				if num == chkp_num:
+					continue
+				if bundle < 0:
+					files.append((f"data/{num}/{name}", name))
+				else:
+					bundles.setdefault((num, bundle), set()).add(name)
+
+		max_threads = os.cpu_count()
+		with ThreadPoolExecutor(max_threads) as executor:
+			futures = []
+			for (file_key, name) in files:
+				futures.append(executor.submit(self.download_file, bucket_name,
+											   file_key,
+											   f"{self.data_dir}/{name}"))
+			for ((num, bundle), names) in bundles.items():
+				futures.append(executor.submit(self.download_bundle_files,
+											   bucket_name, num, bundle,
+											   names))
+			for future in futures:
+				future.result()
+
+	# Extract only the given files from the small files bundle of an older
+	# checkpoint.  The other files of the bundle have been changed or removed
+	# since then.
+	def download_bundle_files(self, bucket_name, num, bundle, names):
+		file_key = f"data/{num}/orioledb_data/small_files_{bundle}"
+		local_path = f"{self.data_dir}/orioledb_data/small_files_{num}_{bundle}"
+		self.download_file(bucket_name, file_key, local_path)
+		if not os.path.exists(local_path):
+			return
+		self.extract_small_files(file_key, local_path, names)
+
+	def extract_small_files(self, file_key, local_path, names=None):
+		base_dir = '/'.join(local_path.split('/')[:-2])
+		with open(local_path, 'rb') as file:
+			data = file.read()
+		numFiles = struct.unpack('i', data[0:4])[0]
+		for i in range(0, numFiles):
+			(nameOffset, dataOffset, dataLength) = struct.unpack('iii', data[4 + i * 12: 16 + i * 12])
+			name = data[nameOffset: data.find(b'\0', nameOffset)].decode('ascii')
+			if names is not None and name.removeprefix('./') not in names:
+				continue
+			fullname = f"{base_dir}/{name}"
+			if self.verbose:
+				print(f"{file_key} -> {fullname}", flush=True)
+			self.makedirs(os.path.dirname(fullname), exist_ok=True, mode=0o700)
+			with open(fullname, 'wb') as file:
+				file.write(data[dataOffset: dataOffset + dataLength])
+			os.chmod(fullname, 0o600)
+		os.unlink(local_path)
+
 	def list_objects_last_checkpoint(self, bucket_name, directory):
 		objects = []
 		paginator = self.s3.get_paginator('list_objects_v2')
@@ -96,7 +162,7 @@ class OrioledbS3ObjectLoader:
 		if greatest_number_dir:
 			objects = self.list_objects(bucket_name, greatest_number_dir)
 
-		return objects
+		return (objects, greatest_number)
 
 	def list_objects(self, bucket_name, directory):
 		objects = []
@@ -155,24 +221,11 @@ class OrioledbS3ObjectLoader:
 				self.s3.download_file(
 					bucket_name, file_key, local_path, Config=transfer_config
 				)
+				self.decompress_file(bucket_name, file_key, local_path)
 			if self.verbose:
 				print(f"{file_key} -> {local_path}", flush=True)
 			if re.match(r'.*/orioledb_data/small_files_\d+$', local_path):
-				base_dir = '/'.join(local_path.split('/')[:-2])
-				with open(local_path, 'rb') as file:
-					data = file.read()
-				numFiles = struct.unpack('i', data[0:4])[0]
-				for i in range(0, numFiles):
-					(nameOffset, dataOffset, dataLength) = struct.unpack('iii', data[4 + i * 12: 16 + i * 12])
-					name = data[nameOffset: data.find(b'\0', nameOffset)].decode('ascii')
-					fullname = f"{base_dir}/{name}"
-					if self.verbose:
-						print(f"{file_key} -> {fullname}", flush=True)
-					self.makedirs(os.path.dirname(fullname), exist_ok=True, mode=0o700)
-					with open(fullname, 'wb') as file:
-						file.write(data[dataOffset: dataOffset + dataLength])
-					os.chmod(fullname, 0o600)
-				os.unlink(local_path)
+				self.extract_small_files(file_key, local_path)
 
 		except ClientError as e:
 			if e.response['Error']['Code'] == "404":
@@ -181,6 +234,25 @@ class OrioledbS3ObjectLoader:
 				print(f"An error occurred: {e}")
 			self._error_occurred.set()
 
+	# Files uploaded with orioledb.s3_compress have the compression method
+	# in the object metadata.
+	def decompress_file(self, bucket_name, file_key, local_path):
+		if file_key.startswith('orioledb_data/') and not file_key.endswith('.map'):
+			# data file parts are never compressed
+			return
+		head = self.s3.head_object(Bucket=bucket_name, Key=file_key)
+		compression = head.get('Metadata', {}).get('orioledb-compression')
+		if compression is None:
+			return
+		if compression != 'zstd':
+			raise Exception(f"Unknown compression {compression} of {file_key}")
+
+		import zstandard
+		with open(local_path, 'rb') as file:
+			data = zstandard.ZstdDecompressor().decompressobj().decompress(file.read())
+		with open(local_path, 'wb') as file:
+			file.write(data)
+
 	def transform_orioledb(self, val: str) -> str:
 		parts = val.split('/')
 		file_parts = parts[3].split('.')
@@ -195,7 +267,8 @@ class OrioledbS3ObjectLoader:
 	def download_files_in_directory(self, bucket_name, directory,
 									local_directory, suffix='',
 									transform: Callable[[str], str] = transform_pg):
-		objects = self.list_objects_last_checkpoint(bucket_name, directory)
+		(objects, chkp_num) = self.list_objects_last_checkpoint(bucket_name,
+																directory)
 		max_threads = os.cpu_count()
 
 		with ThreadPoolExecutor(max_threads) as executor:
@@ -218,6 +291,8 @@ class OrioledbS3ObjectLoader:
 					executor.shutdown(wait=False, cancel_futures=True)
 					break
 
+		return chkp_num
+
 def get_control_data(data_dir: str):
 	"""
 	Return contents of pg_control file.
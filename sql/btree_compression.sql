@@ -79,6 +79,19 @@ SELECT regexp_replace
 
 SELECT orioledb_tbl_structure('o_test1'::regclass, 'nue');
 
+CREATE TABLE o_test2
+(
+	id integer NOT NULL,
+	val text NOT NULL,
+	PRIMARY KEY(id)
+) USING orioledb WITH (compress = 'lz4');
+CREATE INDEX o_test2_val_idx ON o_test2 (val) WITH (compress = 'zstd');
+INSERT INTO o_test2 (SELECT id, id || 'val' FROM generate_series(1, 5000, 1) id);
+SELECT orioledb_tbl_indices('o_test2'::regclass);
+SELECT count(*), sum(id) FROM o_test2;
+SELECT orioledb_tbl_compression_check(10, 'o_test2'::regclass, array[100])
+	~ 'LZ4 ratio = [0-9.]+' AS lz4_reported;
+
 DROP EXTENSION orioledb CASCADE;
 DROP SCHEMA btree_compression CASCADE;
 RESET search_path;
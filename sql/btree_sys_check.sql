@@ -233,6 +233,9 @@ SELECT regexp_replace(regexp_replace(
 		': NNN',
 		'g');
 
+SELECT count(*) = max(tree_num) FROM orioledb_sys_tree_stats()
+	WHERE resident_pages >= 0 AND loads >= 0;
+
 -- fail
 SELECT orioledb_sys_tree_structure(9999);
 SELECT orioledb_sys_tree_check(-1111);
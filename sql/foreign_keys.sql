@@ -186,6 +186,27 @@ UPDATE o_test_reference_to_self_update_cascade SET val_1 = 3 WHERE val_1 = 0;
 
 COMMIT;
 
+-- COPY loads the referenced keys of the batch before the checks
+CREATE TABLE o_test_fk_parent (
+	id int PRIMARY KEY,
+	val text
+) USING orioledb;
+CREATE TABLE o_test_fk_child (
+	id int PRIMARY KEY,
+	parent_id int REFERENCES o_test_fk_parent (id)
+) USING orioledb;
+INSERT INTO o_test_fk_parent SELECT i, i::text FROM generate_series(1, 10) i;
+SET orioledb.enable_fkey_prefetch = on;
+COPY o_test_fk_child FROM stdin;
+1	7
+2	3
+3	\N
+4	7
+5	10
+\.
+SELECT * FROM o_test_fk_child ORDER BY id;
+RESET orioledb.enable_fkey_prefetch;
+
 DROP EXTENSION orioledb CASCADE;
 DROP SCHEMA foreign_keys CASCADE;
 RESET search_path;
@@ -347,6 +347,78 @@ EXPLAIN (COSTS off) SELECT * FROM o_pk6 WHERE i <= 2 AND dt = '2021-03-01'::date
 SELECT * FROM o_pk6 WHERE i = 2 AND dt >= '2021-03-01'::date;
 RESET enable_seqscan;
 
+CREATE TABLE o_pk7 (
+	id int PRIMARY KEY,
+	val text
+) USING orioledb;
+CREATE INDEX o_pk7_val_idx ON o_pk7 (val);
+
+-- COPY inserts the batch in the primary key order
+COPY o_pk7 FROM stdin;
+5	e
+3	c
+9	i
+1	a
+7	g
+\.
+SELECT * FROM o_pk7;
+SELECT * FROM o_pk7 ORDER BY val DESC;
+COPY o_pk7 FROM stdin;
+8	h
+2	b
+6	f
+\.
+SELECT * FROM o_pk7;
+
+-- Sorted bulk load by COPY
+SET orioledb.enable_bulk_load_sort = on;
+CREATE TABLE o_pk8 (
+	id int PRIMARY KEY,
+	val text
+) USING orioledb;
+CREATE INDEX o_pk8_val_idx ON o_pk8 (val);
+COPY o_pk8 FROM stdin;
+4	d
+10	j
+1	a
+7	g
+\.
+BEGIN;
+COPY o_pk8 FROM stdin;
+3	c
+2	b
+\.
+ROLLBACK;
+COPY o_pk8 FROM stdin;
+3	c
+\.
+SELECT * FROM o_pk8;
+SELECT * FROM o_pk8 ORDER BY val DESC;
+SELECT orioledb_tbl_check('o_pk8'::regclass);
+RESET orioledb.enable_bulk_load_sort;
+
+-- Batch insertion into the secondary indices
+SET orioledb.enable_batch_index_insert = on;
+CREATE TABLE o_pk9 (
+	id int PRIMARY KEY,
+	val1 text,
+	val2 int
+) USING orioledb;
+CREATE INDEX o_pk9_val1_idx ON o_pk9 (val1);
+CREATE INDEX o_pk9_val2_idx ON o_pk9 (val2);
+COPY o_pk9 FROM stdin;
+3	c	30
+1	a	20
+2	b	10
+4	\N	40
+\.
+SET enable_seqscan = off;
+SELECT * FROM o_pk9 ORDER BY val1;
+SELECT * FROM o_pk9 ORDER BY val2 DESC;
+RESET enable_seqscan;
+SELECT orioledb_tbl_check('o_pk9'::regclass);
+RESET orioledb.enable_batch_index_insert;
+
 DROP EXTENSION orioledb CASCADE;
 DROP SCHEMA primary_key CASCADE;
 RESET search_path;
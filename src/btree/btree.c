@@ -56,6 +56,33 @@ o_btree_init(BTreeDescr *desc)
 	MARK_DIRTY(desc->ppool, desc->rootInfo.rootPageBlkno);
 }
 
+/*
+ * Adds backend-local operation counters of the tree to its meta page.  The
+ * counters are dropped if the tree isn't loaded anymore.
+ */
+void
+o_btree_flush_stats(BTreeDescr *desc)
+{
+	if (OInMemoryBlknoIsValid(desc->rootInfo.metaPageBlkno))
+	{
+		BTreeMetaPage *meta = BTREE_GET_META(desc);
+
+		pg_atomic_fetch_add_u64(&meta->numLookups,
+								desc->localOps[BTreeStatLookup]);
+		pg_atomic_fetch_add_u64(&meta->numInserts,
+								desc->localOps[BTreeStatInsert]);
+		pg_atomic_fetch_add_u64(&meta->numUpdates,
+								desc->localOps[BTreeStatUpdate]);
+		pg_atomic_fetch_add_u64(&meta->numDeletes,
+								desc->localOps[BTreeStatDelete]);
+		pg_atomic_fetch_add_u64(&meta->undoBytes, desc->localUndoBytes);
+	}
+
+	memset(desc->localOps, 0, sizeof(desc->localOps));
+	desc->localOpsTotal = 0;
+	desc->localUndoBytes = 0;
+}
+
 static bool
 get_page_children(OInMemoryBlkno blkno, uint32 pageChangeCount,
 				  OInMemoryBlkno childPageNumbers[BTREE_PAGE_MAX_CHUNK_ITEMS],
@@ -248,9 +275,14 @@ btree_ctid_get_and_inc(BTreeDescr *desc)
 {
 	BTreeMetaPage *metaPageBlkno = BTREE_GET_META(desc);
 	ItemPointerData result;
-	uint64		ctid = pg_atomic_fetch_add_u64(&metaPageBlkno->ctid, 1);
+	uint64		ctid;
 
 	Assert(ORootPageIsValid(desc) && OMetaPageIsValid(desc));
+
+	if (desc->localCtid < desc->localCtidEnd)
+		ctid = desc->localCtid++;
+	else
+		ctid = pg_atomic_fetch_add_u64(&metaPageBlkno->ctid, 1);
 	Assert(ctid / (MaxOffsetNumber - FirstOffsetNumber) < InvalidBlockNumber);
 
 	ItemPointerSet(&result,
@@ -259,6 +291,25 @@ btree_ctid_get_and_inc(BTreeDescr *desc)
 	return result;
 }
 
+/*
+ * Reserves the range of ctids for the following btree_ctid_get_and_inc()
+ * calls, so that multi-inserts don't contend on the shared counter for each
+ * tuple.  Ctids left unused are just skipped.
+ */
+void
+btree_ctid_reserve(BTreeDescr *desc, int count)
+{
+	BTreeMetaPage *metaPageBlkno = BTREE_GET_META(desc);
+
+	Assert(ORootPageIsValid(desc) && OMetaPageIsValid(desc));
+
+	if (count <= 1 || desc->localCtid < desc->localCtidEnd)
+		return;
+
+	desc->localCtid = pg_atomic_fetch_add_u64(&metaPageBlkno->ctid, count);
+	desc->localCtidEnd = desc->localCtid + count;
+}
+
 void
 btree_ctid_update_if_needed(BTreeDescr *desc, ItemPointerData ctid)
 {
@@ -80,7 +80,8 @@ stack_page_split(BTreeDescr *desc, OIndexBuildStackItem *stack, int level,
 	offset = BTREE_PAGE_LOCATOR_GET_OFFSET(img, &stack[level].loc);
 	left_count = btree_page_split_location(desc, img, offset,
 										   tuplesize, tuple, false, offset,
-										   0.9, NULL, COMMITSEQNO_INPROGRESS);
+										   0.9, NULL, NULL,
+										   COMMITSEQNO_INPROGRESS);
 
 
 	/* Distribute the tuples according the the split location */
@@ -353,6 +354,7 @@ btree_write_index_data(BTreeDescr *desc, TupleDesc tupdesc,
 	pg_atomic_init_u64(&metaPageBlkno.datafileLength[1], 0);
 	pg_atomic_init_u64(&metaPageBlkno.numFreeBlocks, 0);
 	pg_atomic_init_u32(&metaPageBlkno.leafPagesNum, 0);
+	pg_atomic_init_u64(&metaPageBlkno.numTuples, 0);
 	pg_atomic_init_u64(&metaPageBlkno.ctid, ctid);
 	for (i = 0; i < ORIOLEDB_MAX_DEPTH; i++)
 	{
@@ -368,6 +370,7 @@ btree_write_index_data(BTreeDescr *desc, TupleDesc tupdesc,
 	{
 		Assert(o_tuple_size(idx_tup, &((OIndexDescr *) desc->arg)->leafSpec) <= O_BTREE_MAX_TUPLE_SIZE);
 		put_tuple_to_stack(desc, stack, idx_tup, &root_level, &metaPageBlkno);
+		pg_atomic_fetch_add_u64(&metaPageBlkno.numTuples, 1);
 		idx_tup = tuplesort_getotuple(sortstate, true);
 	}
 
@@ -435,6 +438,7 @@ btree_write_index_data(BTreeDescr *desc, TupleDesc tupdesc,
 	file_header->datafileLength = pg_atomic_read_u64(&metaPageBlkno.datafileLength[chkpNum % 2]);
 	file_header->numFreeBlocks = pg_atomic_read_u64(&metaPageBlkno.numFreeBlocks);
 	file_header->leafPagesNum = pg_atomic_read_u32(&metaPageBlkno.leafPagesNum);
+	file_header->numTuples = pg_atomic_read_u64(&metaPageBlkno.numTuples);
 	file_header->ctid = pg_atomic_read_u64(&metaPageBlkno.ctid);
 }
 
@@ -467,6 +471,7 @@ btree_write_file_header(BTreeDescr *desc, CheckpointFileHeader *file_header)
 
 		file = PathNameOpenFile(filename, O_WRONLY | O_CREAT | PG_BINARY);
 
+		checkpoint_file_header_set_crc(file_header);
 		if (OFileWrite(file, (Pointer) file_header,
 					   sizeof(CheckpointFileHeader), 0,
 					   WAIT_EVENT_DATA_FILE_WRITE) !=
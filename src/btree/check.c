@@ -576,7 +576,8 @@ btree_check_compression_recursive(BTreeDescr *desc, BTreeCompressStats *stats, O
 	char		buf[ORIOLEDB_BLCKSZ];
 	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
 	OrioleDBPageHeader *header = (OrioleDBPageHeader *) p;
-	size_t		compressed_size;
+	size_t		compressed_size,
+				lz4_compressed_size;
 
 	page_inc_usage_count(&desc->ppool->ucm, blkno,
 						 pg_atomic_read_u32(&header->usageCount), false);
@@ -622,10 +623,14 @@ btree_check_compression_recursive(BTreeDescr *desc, BTreeCompressStats *stats, O
 
 	PG_TRY();
 	{
-		o_compress_page(buf, &compressed_size, lvl);
+		o_compress_page(buf, &lz4_compressed_size, O_COMPRESS_LZ4,
+						desc->oids.datoid, desc->oids.relnode);
+		o_compress_page(buf, &compressed_size, lvl,
+						desc->oids.datoid, desc->oids.relnode);
 
 		stats->totalSize += ORIOLEDB_BLCKSZ;
 		stats->totalCompressedSize += compressed_size;
+		stats->totalLZ4CompressedSize += lz4_compressed_size;
 
 		if (compressed_size > ORIOLEDB_BLCKSZ)
 		{
@@ -672,3 +677,104 @@ check_btree_compression(BTreeDescr *desc, BTreeCompressStats *stats, OCompress l
 
 	o_tables_rel_unlock_extended(&desc->oids, AccessShareLock, recovery);
 }
+
+/* max number of page images used to train the compression dictionary */
+#define TRAIN_DICT_MAX_SAMPLES (512)
+
+typedef struct
+{
+	Pointer		samples;
+	size_t	   *sizes;
+	int			nsamples;
+} BTreeDictSamples;
+
+static void
+btree_collect_samples_recursive(BTreeDescr *desc, BTreeDictSamples *samples,
+								OBTreeFindPageContext *context,
+								OInMemoryBlkno blkno)
+{
+	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+	Pointer		buf;
+
+	context->index++;
+	context->items[context->index].blkno = blkno;
+	context->items[context->index].pageChangeCount = O_PAGE_GET_CHANGE_COUNT(p);
+
+	if (!O_PAGE_IS(p, LEAF))
+	{
+		BTreePageItemLocator loc;
+
+		BTREE_PAGE_LOCATOR_FIRST(p, &loc);
+		while (BTREE_PAGE_LOCATOR_IS_VALID(p, &loc) &&
+			   samples->nsamples < TRAIN_DICT_MAX_SAMPLES)
+		{
+			Pointer		ptr = BTREE_PAGE_LOCATOR_GET_ITEM(p, &loc);
+			BTreeNonLeafTuphdr *tuphdr = (BTreeNonLeafTuphdr *) ptr;
+
+			if (DOWNLINK_IS_IN_MEMORY(tuphdr->downlink))
+			{
+				btree_collect_samples_recursive(desc, samples, context,
+												DOWNLINK_GET_IN_MEMORY_BLKNO(tuphdr->downlink));
+			}
+			else if (DOWNLINK_IS_IN_IO(tuphdr->downlink))
+			{
+				wait_for_io_completion(DOWNLINK_GET_IO_LOCKNUM(tuphdr->downlink));
+				continue;
+			}
+			else if (DOWNLINK_IS_ON_DISK(tuphdr->downlink))
+			{
+				context->items[context->index].locator = loc;
+				lock_page(blkno);
+				load_page(context);
+				unlock_page(blkno);
+				continue;
+			}
+			BTREE_PAGE_LOCATOR_NEXT(p, &loc);
+		}
+	}
+
+	if (samples->nsamples < TRAIN_DICT_MAX_SAMPLES)
+	{
+		buf = samples->samples + (Size) samples->nsamples * ORIOLEDB_BLCKSZ;
+		memcpy(buf, p, ORIOLEDB_BLCKSZ);
+		null_unused_bytes(buf);
+		samples->sizes[samples->nsamples++] = ORIOLEDB_BLCKSZ;
+	}
+
+	context->index--;
+}
+
+/*
+ * Trains the compression dictionary for the BTree from its page images.
+ * Returns false if the tree is too small to train the dictionary.
+ */
+bool
+train_btree_compression_dict(BTreeDescr *desc)
+{
+	OBTreeFindPageContext context;
+	BTreeDictSamples samples;
+	bool		recovery = is_recovery_in_progress();
+	bool		result;
+
+	samples.samples = palloc((Size) TRAIN_DICT_MAX_SAMPLES * ORIOLEDB_BLCKSZ);
+	samples.sizes = palloc(sizeof(size_t) * TRAIN_DICT_MAX_SAMPLES);
+	samples.nsamples = 0;
+
+	o_tables_rel_lock_extended(&desc->oids, AccessShareLock, recovery);
+	o_btree_load_shmem(desc);
+	init_page_find_context(&context, desc, COMMITSEQNO_INPROGRESS, BTREE_PAGE_FIND_MODIFY);
+
+	btree_collect_samples_recursive(desc, &samples, &context,
+									desc->rootInfo.rootPageBlkno);
+
+	o_tables_rel_unlock_extended(&desc->oids, AccessShareLock, recovery);
+
+	result = o_compress_train_dict(desc->oids.datoid, desc->oids.relnode,
+								   samples.samples, samples.sizes,
+								   samples.nsamples);
+
+	pfree(samples.samples);
+	pfree(samples.sizes);
+
+	return result;
+}
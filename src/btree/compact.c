@@ -0,0 +1,168 @@
+/*-------------------------------------------------------------------------
+ *
+ * compact.c
+ *		Online compaction of OrioleDB B-tree data files.
+ *
+ * Compaction works for compressed trees, whose free space is tracked by the
+ * free extents B-trees.  Each call does two steps.  First, free extents at
+ * the end of the data file are cut off and the file is truncated.  Second,
+ * pages located in the tail of the file, which would remain after moving
+ * all the data to the free extents, are loaded and marked dirty.  Their next
+ * write relocates them to the free extents (see perform_page_io()), and
+ * their old extents become free once the checkpoint completes.  So, the file
+ * shrinks on the next call after the checkpoint.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/btree/compact.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/compact.h"
+#include "btree/find.h"
+#include "btree/io.h"
+#include "catalog/free_extents.h"
+#include "recovery/recovery.h"
+#include "tableam/descr.h"
+#include "utils/page_pool.h"
+
+#include "miscadmin.h"
+#include "datatype/timestamp.h"
+
+typedef struct
+{
+	/* pages located at this offset and above should be relocated */
+	uint64		tailOffset;
+	uint64		pagesRelocated;
+} BTreeCompactState;
+
+static void
+compact_relocate_page(BTreeDescr *desc, BTreeCompactState *state,
+					  OInMemoryBlkno blkno)
+{
+	lock_page(blkno);
+	MARK_DIRTY(desc->ppool, blkno);
+	unlock_page(blkno);
+	state->pagesRelocated++;
+
+	if (compaction_rate_limit > 0)
+		pg_usleep(USECS_PER_SEC / compaction_rate_limit);
+	CHECK_FOR_INTERRUPTS();
+}
+
+static void
+btree_compact_recursive(BTreeDescr *desc, BTreeCompactState *state,
+						OBTreeFindPageContext *context,
+						OInMemoryBlkno blkno)
+{
+	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+	OrioleDBPageDesc *page_desc = O_GET_IN_MEMORY_PAGEDESC(blkno);
+
+	context->index++;
+	context->items[context->index].blkno = blkno;
+	context->items[context->index].pageChangeCount = O_PAGE_GET_CHANGE_COUNT(p);
+
+	if (!O_PAGE_IS(p, LEAF))
+	{
+		BTreePageItemLocator loc;
+		bool		leafChildren = PAGE_GET_LEVEL(p) == 1;
+
+		BTREE_PAGE_LOCATOR_FIRST(p, &loc);
+		while (BTREE_PAGE_LOCATOR_IS_VALID(p, &loc))
+		{
+			Pointer		ptr = BTREE_PAGE_LOCATOR_GET_ITEM(p, &loc);
+			BTreeNonLeafTuphdr *tuphdr = (BTreeNonLeafTuphdr *) ptr;
+
+			if (DOWNLINK_IS_IN_MEMORY(tuphdr->downlink))
+			{
+				btree_compact_recursive(desc, state, context,
+										DOWNLINK_GET_IN_MEMORY_BLKNO(tuphdr->downlink));
+			}
+			else if (DOWNLINK_IS_IN_IO(tuphdr->downlink))
+			{
+				wait_for_io_completion(DOWNLINK_GET_IO_LOCKNUM(tuphdr->downlink));
+				continue;
+			}
+			else if (DOWNLINK_IS_ON_DISK(tuphdr->downlink) &&
+					 (!leafChildren ||
+					  DOWNLINK_GET_DISK_OFF(tuphdr->downlink) >= state->tailOffset))
+			{
+				/*
+				 * Non-leaf pages are loaded anyway, because their children
+				 * might be located in the tail.
+				 */
+				context->items[context->index].locator = loc;
+				lock_page(blkno);
+				load_page(context);
+				unlock_page(blkno);
+				continue;
+			}
+			BTREE_PAGE_LOCATOR_NEXT(p, &loc);
+		}
+	}
+
+	if (FileExtentIsValid(page_desc->fileExtent) &&
+		page_desc->fileExtent.off >= state->tailOffset)
+		compact_relocate_page(desc, state, blkno);
+
+	context->index--;
+}
+
+/*
+ * Compacts the data file of the tree.  Returns the number of bytes the data
+ * file was truncated by.
+ */
+int64
+btree_compact(BTreeDescr *desc)
+{
+	OBTreeFindPageContext context;
+	BTreeCompactState state;
+	BTreeMetaPage *metaPage;
+	bool		recovery = is_recovery_in_progress();
+	uint64		datafileLength,
+				numFreeBlocks,
+				len,
+				truncated = 0;
+
+	if (!OCompressIsValid(desc->compress))
+		return 0;
+
+	o_tables_rel_lock_extended(&desc->oids, AccessShareLock, recovery);
+	o_btree_load_shmem(desc);
+	metaPage = BTREE_GET_META(desc);
+
+	/* Cut off the free space at the end of the data file */
+	add_free_extents_from_tmp(desc, remove_old_checkpoint_files);
+	while ((len = cut_tail_free_extent(desc)) > 0)
+		truncated += len;
+
+	/*
+	 * The data file could be as long as its used part.  Relocate the pages
+	 * located beyond it.
+	 */
+	datafileLength = pg_atomic_read_u64(&metaPage->datafileLength[0]);
+	numFreeBlocks = pg_atomic_read_u64(&metaPage->numFreeBlocks);
+	if (numFreeBlocks > 0 && numFreeBlocks < datafileLength)
+	{
+		state.tailOffset = datafileLength - numFreeBlocks;
+		state.pagesRelocated = 0;
+
+		init_page_find_context(&context, desc, COMMITSEQNO_INPROGRESS,
+							   BTREE_PAGE_FIND_MODIFY);
+		btree_compact_recursive(desc, &state, &context,
+								desc->rootInfo.rootPageBlkno);
+
+		elog(DEBUG1, "compaction of (%u, %u) marked %lu pages for relocation",
+			 desc->oids.datoid, desc->oids.relnode,
+			 (unsigned long) state.pagesRelocated);
+	}
+
+	o_tables_rel_unlock_extended(&desc->oids, AccessShareLock, recovery);
+
+	return (int64) truncated * ORIOLEDB_COMP_BLCKSZ;
+}
@@ -0,0 +1,238 @@
+/*-------------------------------------------------------------------------
+ *
+ * compressed_cache.c
+ *		Shared cache of compressed page images evicted from main buffers.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/btree/compressed_cache.c
+ *
+ * NOTES
+ *
+ *		Evicted page images are compressed with LZ4 and appended to the
+ *		circular buffer of chunks.  The image stays valid until the head
+ *		of the buffer wraps around and overwrites its chunks.  Images are
+ *		found by (datoid, relnode, file offset) using the direct-mapped
+ *		index, where a new image replaces any colliding one.
+ *
+ *		The content of a file extent can only change when the page image
+ *		is written there, so write_page_to_disk() invalidates the image
+ *		before the new downlink becomes visible to readers.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/compressed_cache.h"
+#include "tableam/handler.h"
+#include "utils/compress.h"
+
+#include "common/hashfn.h"
+#include "storage/lwlock.h"
+
+#define COMPRESSED_CACHE_CHUNK_SIZE (1024)
+#define COMPRESSED_CACHE_CHUNKS(size) \
+	(((size) + COMPRESSED_CACHE_CHUNK_SIZE - 1) / COMPRESSED_CACHE_CHUNK_SIZE)
+
+typedef struct
+{
+	Oid			datoid;
+	Oid			relnode;
+	uint64		offset;
+} CompressedCacheKey;
+
+typedef struct
+{
+	CompressedCacheKey key;
+	uint64		location;
+	uint16		len;
+	uint16		size;
+} CompressedCacheSlot;
+
+typedef struct
+{
+	LWLock		lock;
+	int			trancheId;
+	uint64		head;
+} CompressedCacheMeta;
+
+static CompressedCacheMeta *cacheMeta = NULL;
+static CompressedCacheSlot *cacheSlots = NULL;
+static Pointer cacheChunks = NULL;
+static uint64 cacheChunksCount = 0;
+
+Size
+compressed_cache_shmem_needs(void)
+{
+	Size		size;
+
+	cacheChunksCount = (uint64) compressed_buffers_guc *
+		(ORIOLEDB_BLCKSZ / COMPRESSED_CACHE_CHUNK_SIZE);
+	if (cacheChunksCount == 0)
+		return 0;
+
+	size = CACHELINEALIGN(sizeof(CompressedCacheMeta));
+	size = add_size(size, CACHELINEALIGN(mul_size(sizeof(CompressedCacheSlot),
+												  cacheChunksCount)));
+	size = add_size(size, mul_size(COMPRESSED_CACHE_CHUNK_SIZE,
+								   cacheChunksCount));
+	return size;
+}
+
+void
+compressed_cache_shmem_init(Pointer ptr, bool found)
+{
+	if (cacheChunksCount == 0)
+		return;
+
+	cacheMeta = (CompressedCacheMeta *) ptr;
+	ptr += CACHELINEALIGN(sizeof(CompressedCacheMeta));
+	cacheSlots = (CompressedCacheSlot *) ptr;
+	ptr += CACHELINEALIGN(sizeof(CompressedCacheSlot) * cacheChunksCount);
+	cacheChunks = ptr;
+
+	if (!found)
+	{
+		cacheMeta->trancheId = LWLockNewTrancheId();
+		LWLockInitialize(&cacheMeta->lock, cacheMeta->trancheId);
+		cacheMeta->head = 0;
+		memset(cacheSlots, 0, sizeof(CompressedCacheSlot) * cacheChunksCount);
+	}
+	LWLockRegisterTranche(cacheMeta->trancheId, "OCompressedCacheTrancheId");
+}
+
+static CompressedCacheSlot *
+get_slot(BTreeDescr *desc, uint64 offset, CompressedCacheKey *key)
+{
+	memset(key, 0, sizeof(*key));
+	key->datoid = desc->oids.datoid;
+	key->relnode = desc->oids.relnode;
+	key->offset = offset;
+
+	return &cacheSlots[hash_bytes((unsigned char *) key, sizeof(*key)) %
+					   cacheChunksCount];
+}
+
+/*
+ * Checks if slot contains the image of the key which isn't overwritten yet.
+ */
+static inline bool
+slot_is_valid(CompressedCacheSlot *slot, CompressedCacheKey *key)
+{
+	return slot->len > 0 &&
+		memcmp(&slot->key, key, sizeof(*key)) == 0 &&
+		cacheMeta->head <= slot->location + cacheChunksCount;
+}
+
+/*
+ * Puts the image of the page just evicted from the given extent into the
+ * cache.  The page must not be concurrently modified.
+ */
+void
+compressed_cache_put(BTreeDescr *desc, FileExtent extent, Page page)
+{
+	CompressedCacheSlot *slot;
+	CompressedCacheKey key;
+	Pointer		img;
+	size_t		size;
+	uint64		location,
+				len;
+
+	if (cacheChunksCount == 0)
+		return;
+
+	img = o_compress_page(page, &size, O_COMPRESS_LZ4,
+						  desc->oids.datoid, desc->oids.relnode);
+	len = COMPRESSED_CACHE_CHUNKS(size);
+
+	/* no sense to cache incompressible images */
+	if (len >= COMPRESSED_CACHE_CHUNKS(ORIOLEDB_BLCKSZ))
+		return;
+
+	slot = get_slot(desc, extent.off, &key);
+
+	LWLockAcquire(&cacheMeta->lock, LW_EXCLUSIVE);
+
+	/* image shouldn't wrap around the end of the buffer */
+	location = cacheMeta->head;
+	if (location % cacheChunksCount + len > cacheChunksCount)
+		location += cacheChunksCount - location % cacheChunksCount;
+	cacheMeta->head = location + len;
+
+	memcpy(cacheChunks + (location % cacheChunksCount) * COMPRESSED_CACHE_CHUNK_SIZE,
+		   img, size);
+	slot->key = key;
+	slot->location = location;
+	slot->len = len;
+	slot->size = size;
+
+	LWLockRelease(&cacheMeta->lock);
+}
+
+/*
+ * Loads the page image stored at the given file offset from the cache.
+ * Returns false if the image isn't cached.
+ */
+bool
+compressed_cache_get(BTreeDescr *desc, uint64 offset, Page page)
+{
+	CompressedCacheSlot *slot;
+	CompressedCacheKey key;
+	char		buf[ORIOLEDB_BLCKSZ];
+	OCompressHeader header = 0;
+
+	if (cacheChunksCount == 0)
+		return false;
+
+	slot = get_slot(desc, offset, &key);
+
+	LWLockAcquire(&cacheMeta->lock, LW_SHARED);
+	if (slot_is_valid(slot, &key))
+	{
+		header = slot->size;
+		memcpy(buf,
+			   cacheChunks + (slot->location % cacheChunksCount) * COMPRESSED_CACHE_CHUNK_SIZE,
+			   slot->size);
+	}
+	LWLockRelease(&cacheMeta->lock);
+
+	if (header == 0)
+		return false;
+
+	o_decompress_page(buf, header | O_COMPRESS_HEADER_LZ4, page,
+					  desc->oids.datoid, desc->oids.relnode);
+	EA_DECOMPRESS_ADD(desc->oids, ORIOLEDB_BLCKSZ);
+	return true;
+}
+
+/*
+ * Forgets the image stored at the given file offset.  Must be called before
+ * the new image written to the offset might be read.
+ */
+void
+compressed_cache_invalidate(BTreeDescr *desc, uint64 offset)
+{
+	CompressedCacheSlot *slot;
+	CompressedCacheKey key;
+
+	if (cacheChunksCount == 0)
+		return;
+
+	slot = get_slot(desc, offset, &key);
+
+	LWLockAcquire(&cacheMeta->lock, LW_SHARED);
+	if (!slot_is_valid(slot, &key))
+	{
+		LWLockRelease(&cacheMeta->lock);
+		return;
+	}
+	LWLockRelease(&cacheMeta->lock);
+
+	LWLockAcquire(&cacheMeta->lock, LW_EXCLUSIVE);
+	if (memcmp(&slot->key, &key, sizeof(key)) == 0)
+		slot->len = 0;
+	LWLockRelease(&cacheMeta->lock);
+}
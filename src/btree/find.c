@@ -44,7 +44,30 @@ static bool btree_find_read_page(OBTreeFindPageContext *context,
 								 PartialPageState *partial);
 static OffsetNumber btree_page_binary_search_chunks(BTreeDescr *desc, Page p,
 													Pointer key,
-													BTreeKeyType keyType);
+													BTreeKeyType keyType,
+													BTreeIntSearchKey *intKey);
+
+/* find_page() steps are added to the meta page counters in batches */
+#define FIND_STATS_BATCH	256
+
+static inline void
+find_page_count_step(BTreeDescr *desc, bool loaded)
+{
+	if (loaded)
+		desc->localFindMisses++;
+	else
+		desc->localFindHits++;
+
+	if (desc->localFindHits + desc->localFindMisses >= FIND_STATS_BATCH)
+	{
+		BTreeMetaPage *meta = BTREE_GET_META(desc);
+
+		pg_atomic_fetch_add_u64(&meta->numFindHits, desc->localFindHits);
+		pg_atomic_fetch_add_u64(&meta->numFindMisses, desc->localFindMisses);
+		desc->localFindHits = 0;
+		desc->localFindMisses = 0;
+	}
+}
 
 /*
  * Initialize B-tree page find context.
@@ -102,7 +125,8 @@ find_page(OBTreeFindPageContext *context, void *key, BTreeKeyType keyType,
 				noFixFlag = BTREE_PAGE_FIND_IS(context, NO_FIX_SPLIT),
 				keepLokeyFlag = BTREE_PAGE_FIND_IS(context, KEEP_LOKEY),
 				downlinkLocationFlag = BTREE_PAGE_FIND_IS(context, DOWNLINK_LOCATION);
-	bool		shmemIsReloaded = false;
+	bool		shmemIsReloaded = false,
+				loaded = false;
 	Jsonb	   *params = NULL;
 	CommitSeqNo *readCsn = BTREE_PAGE_FIND_IS(context, READ_CSN) ? &context->imgReadCsn : NULL;
 
@@ -481,6 +505,7 @@ find_page(OBTreeFindPageContext *context, void *key, BTreeKeyType keyType,
 			if (intCxt.haveLock)
 			{
 				load_page(context);
+				loaded = true;
 				intCxt.blkno = context->items[context->index].blkno;
 				loc = context->items[context->index].locator;
 				intCxt.pagePtr = p = O_GET_IN_MEMORY_PAGE(intCxt.blkno);
@@ -516,6 +541,9 @@ find_page(OBTreeFindPageContext *context, void *key, BTreeKeyType keyType,
 			continue;
 		}
 
+		find_page_count_step(desc, loaded);
+		loaded = false;
+
 		parentBlkno = intCxt.blkno;
 		context->index++;
 		intCxt.blkno = DOWNLINK_GET_IN_MEMORY_BLKNO(noneLeafHdr->downlink);
@@ -1043,6 +1071,99 @@ find_left_page(OBTreeFindPageContext *context, OFixedKey *hikey)
 	Assert(false);
 }
 
+/*
+ * Descend the tree for the key using only in-memory pages, and advise the
+ * kernel to read the page if the descent stops at an on-disk downlink.  Never
+ * loads pages, waits for IO or locks pages: any concurrent change just makes
+ * us give up.  Returns the on-disk downlink the read-ahead was issued for,
+ * or InvalidDiskDownlink.
+ */
+static uint64
+btree_prefetch_key(BTreeDescr *desc, void *key, BTreeKeyType keyType,
+				   uint64 prevDownlink)
+{
+	char		img[ORIOLEDB_BLCKSZ];
+	PartialPageState partial;
+	BTreePageItemLocator loc;
+	OInMemoryBlkno blkno;
+	uint32		pageChangeCount;
+	int			depth;
+
+	if (!o_btree_try_use_shmem(desc))
+		return InvalidDiskDownlink;
+
+	blkno = desc->rootInfo.rootPageBlkno;
+	pageChangeCount = desc->rootInfo.rootPageChangeCount;
+
+	for (depth = 0; depth < ORIOLEDB_MAX_DEPTH; depth++)
+	{
+		BTreeNonLeafTuphdr *tuphdr;
+		uint64		downlink;
+
+		if (O_PAGE_IS(O_GET_IN_MEMORY_PAGE(blkno), LEAF))
+			break;
+
+		if (o_btree_try_read_page(desc, blkno, pageChangeCount, img,
+								  COMMITSEQNO_INPROGRESS, key, keyType,
+								  &partial, NULL) != ReadPageResultOK)
+			break;
+
+		if (O_PAGE_IS(img, LEAF) ||
+			!btree_page_search(desc, img, key, keyType, &partial, &loc))
+			break;
+
+		BTREE_PAGE_LOCATOR_PREV(img, &loc);
+		if (!partial_load_chunk(&partial, img, loc.chunkOffset))
+			break;
+
+		tuphdr = (BTreeNonLeafTuphdr *) BTREE_PAGE_LOCATOR_GET_ITEM(img, &loc);
+		downlink = tuphdr->downlink;
+
+		if (DOWNLINK_IS_ON_DISK(downlink))
+		{
+			if (downlink != prevDownlink)
+				prefetch_page_from_disk(desc, downlink);
+			return downlink;
+		}
+		else if (!DOWNLINK_IS_IN_MEMORY(downlink))
+		{
+			break;
+		}
+
+		blkno = DOWNLINK_GET_IN_MEMORY_BLKNO(downlink);
+		pageChangeCount = DOWNLINK_GET_IN_MEMORY_CHANGECOUNT(downlink);
+	}
+
+	return InvalidDiskDownlink;
+}
+
+/*
+ * Issue read-ahead for on-disk pages which would be loaded by the search of
+ * given keys.  Returns the number of read-ahead requests issued.
+ */
+int
+btree_prefetch_keys(BTreeDescr *desc, Pointer *keys, int nkeys,
+					BTreeKeyType keyType)
+{
+	uint64		prevDownlink = InvalidDiskDownlink;
+	int			i,
+				result = 0;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		uint64		downlink;
+
+		downlink = btree_prefetch_key(desc, keys[i], keyType, prevDownlink);
+		if (DiskDownlinkIsValid(downlink))
+		{
+			if (downlink != prevDownlink)
+				result++;
+			prevDownlink = downlink;
+		}
+	}
+	return result;
+}
+
 /*
  * Return lokey of the context->img.
  *
@@ -1173,6 +1294,69 @@ btree_find_context_from_modify_to_read(OBTreeFindPageContext *context,
 	context->items[context->index].locator = loc;
 }
 
+/*
+ * Reads the integer key value from the page item or chunk hikey.  Returns
+ * false if the value can't be read directly from the tuple data, then the
+ * caller should fall back to the generic comparison function.
+ */
+static inline bool
+btree_int_key_read(BTreeIntSearchKey *intKey, OTuple tuple, bool leaf,
+				   int64 *value)
+{
+	int			offset = leaf ? intKey->leafOffset : intKey->nonLeafOffset;
+	Pointer		ptr;
+
+	if (offset < 0)
+		return false;
+
+	if (tuple.formatFlags & O_TUPLE_FLAGS_FIXED_FORMAT)
+	{
+		if (!(leaf ? intKey->leafFixedValid : intKey->nonLeafFixedValid))
+			return false;
+		ptr = tuple.data + offset;
+	}
+	else
+	{
+		OTupleHeader header = (OTupleHeader) tuple.data;
+
+		if (header->hasnulls ||
+			header->natts < (leaf ? intKey->leafAttnum : intKey->nonLeafAttnum))
+			return false;
+		ptr = tuple.data + SizeOfOTupleHeader + offset;
+	}
+
+	if (intKey->width == sizeof(int32))
+		*value = *((int32 *) ptr);
+	else
+		*value = *((int64 *) ptr);
+	return true;
+}
+
+/*
+ * Compares the search key with the tuple using the integer key if possible.
+ */
+static inline int
+btree_search_cmp(BTreeDescr *desc, OBTreeKeyCmp cmpFunc,
+				 Pointer key, BTreeKeyType keyType,
+				 BTreeIntSearchKey *intKey,
+				 OTuple *tuple, BTreeKeyType tupleType)
+{
+	int64		value;
+
+	if (intKey &&
+		btree_int_key_read(intKey, *tuple, tupleType == BTreeKeyLeafTuple,
+						   &value))
+	{
+		if (intKey->value < value)
+			return -1;
+		else if (intKey->value > value)
+			return 1;
+		return intKey->eqResult;
+	}
+
+	return cmpFunc(desc, key, keyType, tuple, tupleType);
+}
+
 /*
  * Search for a key within the page.  First, it does binary search of
  * appropriate chunk, then binary search within the chunk.
@@ -1193,6 +1377,8 @@ btree_page_search(BTreeDescr *desc, Page p, Pointer key, BTreeKeyType keyType,
 				nextkey;
 	OBTreeKeyCmp cmpFunc = desc->ops->cmp;
 	BTreeKeyType midkind;
+	BTreeIntSearchKey intKeyData,
+			   *intKey = NULL;
 	int			targetCmpVal,
 				result;
 
@@ -1204,7 +1390,19 @@ btree_page_search(BTreeDescr *desc, Page p, Pointer key, BTreeKeyType keyType,
 		return true;
 	}
 
-	chunkOffset = btree_page_binary_search_chunks(desc, p, key, keyType);
+	/*
+	 * Try to get the normalized integer key.  It allows to avoid the generic
+	 * comparison function calls on the page items.
+	 */
+	if (desc->ops->int_search_key &&
+		desc->ops->int_search_key(desc, key,
+								  keyType == BTreeKeyPageHiKey ?
+								  BTreeKeyNonLeafKey : keyType,
+								  &intKeyData))
+		intKey = &intKeyData;
+
+	chunkOffset = btree_page_binary_search_chunks(desc, p, key, keyType,
+												  intKey);
 
 	if (partial && !partial_load_chunk(partial, p, chunkOffset))
 		return false;
@@ -1260,7 +1458,8 @@ btree_page_search(BTreeDescr *desc, Page p, Pointer key, BTreeKeyType keyType,
 
 			locator->itemOffset = mid;
 			BTREE_PAGE_READ_TUPLE(midTup, p, locator);
-			result = cmpFunc(desc, key, keyType, &midTup, midkind);
+			result = btree_search_cmp(desc, cmpFunc, key, keyType, intKey,
+									  &midTup, midkind);
 		}
 
 		if (result >= targetCmpVal)
@@ -1279,7 +1478,8 @@ btree_page_search(BTreeDescr *desc, Page p, Pointer key, BTreeKeyType keyType,
  */
 static OffsetNumber
 btree_page_binary_search_chunks(BTreeDescr *desc, Page p,
-								Pointer key, BTreeKeyType keyType)
+								Pointer key, BTreeKeyType keyType,
+								BTreeIntSearchKey *intKey)
 {
 	OffsetNumber mid,
 				low,
@@ -1319,7 +1519,8 @@ btree_page_binary_search_chunks(BTreeDescr *desc, Page p,
 
 		midTup.formatFlags = header->chunkDesc[mid].hikeyFlags;
 		midTup.data = p + SHORT_GET_LOCATION(header->chunkDesc[mid].hikeyShortLocation);
-		result = cmpFunc(desc, key, keyType, &midTup, BTreeKeyNonLeafKey);
+		result = btree_search_cmp(desc, cmpFunc, key, keyType, intKey,
+								  &midTup, BTreeKeyNonLeafKey);
 
 		if (result >= targetCmpVal)
 			low = mid + 1;
@@ -501,6 +501,9 @@ o_btree_insert_item(BTreeInsertStackItem *insert_item, int reserve_kind)
 			backend_set_autonomous_level(checkpoint_state, insert_item->level);
 		}
 
+		if (insert_item->level == 0)
+			page_chunks_count_access(blkno, true);
+
 		if (fit != BTreeItemPageFitSplitRequired)
 		{
 			BTreePageHeader *header = (BTreePageHeader *) p;
@@ -605,7 +608,8 @@ o_btree_insert_item(BTreeInsertStackItem *insert_item, int reserve_kind)
 				insert_item->left_blkno = OInvalidInMemoryBlkno;
 			}
 
-			page_split_chunk_if_needed(desc, p, &loc);
+			page_split_chunk_if_needed(desc, p, &loc,
+									   page_chunks_get_layout(blkno));
 
 			MARK_DIRTY(desc->ppool, blkno);
 			END_CRIT_SECTION();
@@ -20,6 +20,7 @@
 #include "orioledb.h"
 
 #include "btree/io.h"
+#include "btree/compressed_cache.h"
 #include "btree/find.h"
 #include "btree/merge.h"
 #include "btree/page_chunks.h"
@@ -28,10 +29,13 @@
 #include "catalog/free_extents.h"
 #include "recovery/recovery.h"
 #include "s3/headers.h"
+#include "s3/requests.h"
 #include "s3/worker.h"
 #include "tableam/descr.h"
 #include "tableam/handler.h"
 #include "utils/compress.h"
+#include "utils/o_latency.h"
+#include "utils/o_probes.h"
 #include "utils/page_pool.h"
 #include "utils/seq_buf.h"
 #include "utils/stopevent.h"
@@ -42,6 +46,7 @@
 #include "access/relation.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/fd.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 
@@ -77,6 +82,9 @@ static LWLockPadded *io_locks;
 static IOShmem *ioShmem = NULL;
 static int	num_io_lwlocks;
 static bool io_in_progress = false;
+/* Number of pages loaded by this process */
+uint64		loaded_pages_count = 0;
+static char *direct_io_buffer = NULL;
 
 static bool prepare_non_leaf_page(Page p);
 static uint64 get_free_disk_offset(BTreeDescr *desc);
@@ -181,6 +189,30 @@ OFileWrite(File file, char *buffer, int amount, off_t offset,
 	return result;
 }
 
+/*
+ * Returns the backend-local buffer suitable for O_DIRECT reads and writes of
+ * up to ORIOLEDB_BLCKSZ bytes.
+ */
+static char *
+get_direct_io_buffer(void)
+{
+	if (direct_io_buffer == NULL)
+	{
+		char	   *buf = MemoryContextAlloc(TopMemoryContext,
+											 ORIOLEDB_BLCKSZ + O_DIRECT_IO_ALIGN);
+
+		direct_io_buffer = (char *) TYPEALIGN(O_DIRECT_IO_ALIGN, buf);
+	}
+	return direct_io_buffer;
+}
+
+static inline bool
+direct_io_needs_bounce(char *buffer)
+{
+	return orioledb_direct_io && !orioledb_s3_mode &&
+		(uintptr_t) buffer != TYPEALIGN(O_DIRECT_IO_ALIGN, buffer);
+}
+
 typedef struct
 {
 	uint32		checkpointNumber;
@@ -301,7 +333,9 @@ btree_open_smgr_file(BTreeDescr *desc, uint32 num, uint32 chkpNum)
 		filename = btree_smgr_filename(desc,
 									   (off_t) num * ORIOLEDB_SEGMENT_SIZE,
 									   chkpNum);
-		desc->smgr.array.files[num] = PathNameOpenFile(filename, O_RDWR | O_CREAT | PG_BINARY);
+		desc->smgr.array.files[num] = PathNameOpenFile(filename,
+													   O_RDWR | O_CREAT | PG_BINARY |
+													   (orioledb_direct_io ? PG_O_DIRECT : 0));
 
 		if (desc->smgr.array.files[num] <= 0)
 			ereport(FATAL,
@@ -514,11 +548,38 @@ btree_smgr_schedule_s3_write(BTreeDescr *desc, uint32 chkpNum,
 	}
 }
 
+#define DIRTY_SEGMENT_BIT(segno) \
+	(UINT64CONST(1) << Min((uint64) (segno), 63))
+
+/*
+ * Remembers that the data file segments covering the given range need to be
+ * synced by the next checkpoint of the tree.
+ */
+static void
+btree_smgr_mark_dirty(BTreeDescr *desc, off_t offset, off_t amount)
+{
+	uint64		bits = 0;
+	off_t		segno,
+				last;
+
+	if (orioledb_s3_mode || !OMetaPageIsValid(desc) || amount <= 0)
+		return;
+
+	segno = Min(offset / ORIOLEDB_SEGMENT_SIZE, 63);
+	last = Min((offset + amount - 1) / ORIOLEDB_SEGMENT_SIZE, 63);
+	for (; segno <= last; segno++)
+		bits |= DIRTY_SEGMENT_BIT(segno);
+
+	if ((pg_atomic_read_u64(&BTREE_GET_META(desc)->dirtySegments) & bits) != bits)
+		pg_atomic_fetch_or_u64(&BTREE_GET_META(desc)->dirtySegments, bits);
+}
+
 static int
 btree_smgr_write(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 				 int amount, off_t offset)
 {
 	int			result = 0;
+	int			origAmount = amount;
 	off_t		curOffset = offset,
 				granularity;
 	S3HeaderTag tag = {0};
@@ -529,7 +590,17 @@ btree_smgr_write(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 		memcpy(mmap_data + offset, buffer, amount);
 		return amount;
 	}
-	else if (use_device)
+
+	if (direct_io_needs_bounce(buffer))
+	{
+		char	   *aligned = get_direct_io_buffer();
+
+		Assert(amount <= ORIOLEDB_BLCKSZ);
+		memcpy(aligned, buffer, amount);
+		buffer = aligned;
+	}
+
+	if (use_device)
 	{
 		Assert(offset + amount <= device_length);
 		pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_WRITE);
@@ -590,6 +661,12 @@ btree_smgr_write(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 			s3_header_unlock_part(tag, partno, true);
 	}
 
+	/*
+	 * Mark the segments after the write, so the checkpoint which gets the
+	 * downlink of this page syncs them.
+	 */
+	btree_smgr_mark_dirty(desc, offset, origAmount);
+
 	if (orioledb_s3_mode)
 	{
 		btree_smgr_schedule_s3_write(desc,
@@ -620,6 +697,16 @@ btree_smgr_read(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 		memcpy(buffer, mmap_data + offset, amount);
 		return amount;
 	}
+	else if (direct_io_needs_bounce(buffer))
+	{
+		char	   *aligned = get_direct_io_buffer();
+
+		Assert(amount <= ORIOLEDB_BLCKSZ);
+		result = btree_smgr_read(desc, aligned, chkpNum, amount, offset);
+		if (result > 0)
+			memcpy(buffer, aligned, result);
+		return result;
+	}
 	else if (use_device)
 	{
 		Assert(offset + amount <= device_length);
@@ -641,6 +728,32 @@ btree_smgr_read(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 		granularity = ORIOLEDB_SEGMENT_SIZE;
 	}
 
+	/*
+	 * A single page from the part which isn't loaded yet is read directly
+	 * from S3 using the range request, while the whole part is loaded in
+	 * background.  So, the point lookup doesn't wait for the whole part
+	 * download.
+	 */
+	if (orioledb_s3_mode && amount <= ORIOLEDB_BLCKSZ &&
+		offset / ORIOLEDB_S3_PART_SIZE == (offset + amount - 1) / ORIOLEDB_S3_PART_SIZE)
+	{
+		int			segno = offset / ORIOLEDB_SEGMENT_SIZE;
+		int			partno = (offset % ORIOLEDB_SEGMENT_SIZE) / ORIOLEDB_S3_PART_SIZE;
+
+		tag.segNum = segno;
+		if (s3_header_get_part_status(tag, partno) == S3PartStatusNotLoaded &&
+			s3_schedule_file_part_read(chkpNum, desc->oids.datoid,
+									   desc->oids.relnode, segno, partno) != 0 &&
+			s3_read_file_part_range(chkpNum, desc->oids.datoid,
+									desc->oids.relnode, segno, partno,
+									offset % ORIOLEDB_S3_PART_SIZE,
+									amount, buffer))
+		{
+			EA_S3_PART_INC(desc->oids);
+			return amount;
+		}
+	}
+
 	while (amount > 0)
 	{
 		int			segno = offset / ORIOLEDB_SEGMENT_SIZE;
@@ -651,6 +764,9 @@ btree_smgr_read(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 		{
 			tag.segNum = segno;
 			partno = (offset % ORIOLEDB_SEGMENT_SIZE) / ORIOLEDB_S3_PART_SIZE;
+			if (ea_counters != NULL &&
+				s3_header_get_part_status(tag, partno) != S3PartStatusLoaded)
+				EA_S3_PART_INC(desc->oids);
 			s3_header_lock_part(tag, partno);
 		}
 
@@ -684,6 +800,48 @@ btree_smgr_read(BTreeDescr *desc, char *buffer, uint32 chkpNum,
 	return result;
 }
 
+/*
+ * Advise the kernel to read the given data range in background.  Does
+ * nothing if there is no way to do so.
+ */
+void
+btree_smgr_prefetch(BTreeDescr *desc, uint32 chkpNum,
+					int amount, off_t offset)
+{
+	/*
+	 * In S3 mode, the data might be not present locally, and the read would
+	 * fetch it from S3.  Don't try to prefetch then.
+	 */
+	if (use_mmap || orioledb_s3_mode)
+		return;
+
+	/* O_DIRECT reads bypass the page cache, so there is nothing to warm */
+	if (orioledb_direct_io)
+		return;
+
+	if (use_device)
+	{
+#if defined(USE_PREFETCH) && defined(POSIX_FADV_WILLNEED)
+		Assert(offset + amount <= device_length);
+		(void) posix_fadvise(device_fd, offset, amount, POSIX_FADV_WILLNEED);
+#endif
+		return;
+	}
+
+	while (amount > 0)
+	{
+		int			segno = offset / ORIOLEDB_SEGMENT_SIZE;
+		int			stepAmount = Min(amount, ORIOLEDB_SEGMENT_SIZE - offset % ORIOLEDB_SEGMENT_SIZE);
+		File		file;
+
+		file = btree_open_smgr_file(desc, segno, chkpNum);
+		(void) FilePrefetch(file, offset % ORIOLEDB_SEGMENT_SIZE, stepAmount,
+							WAIT_EVENT_DATA_FILE_PREFETCH);
+		offset += stepAmount;
+		amount -= stepAmount;
+	}
+}
+
 void
 btree_smgr_writeback(BTreeDescr *desc, uint32 chkpNum,
 					 off_t offset, int amount)
@@ -694,7 +852,7 @@ btree_smgr_writeback(BTreeDescr *desc, uint32 chkpNum,
 		msync(mmap_data + offset, amount, MS_ASYNC);
 		return;
 	}
-	else if (use_device)
+	else if (use_device || orioledb_direct_io)
 	{
 		return;
 	}
@@ -729,7 +887,9 @@ btree_smgr_writeback(BTreeDescr *desc, uint32 chkpNum,
 void
 btree_smgr_sync(BTreeDescr *desc, uint32 chkpNum, off_t length)
 {
-	int			num;
+	int			num,
+				numSegments;
+	uint64		dirty;
 
 	if (orioledb_s3_mode)
 		btree_s3_flush(desc, chkpNum);
@@ -737,12 +897,75 @@ btree_smgr_sync(BTreeDescr *desc, uint32 chkpNum, off_t length)
 	if (use_mmap || use_device)
 		return;
 
-	for (num = 0; num < length / ORIOLEDB_SEGMENT_SIZE; num++)
+	numSegments = (length + ORIOLEDB_SEGMENT_SIZE - 1) / ORIOLEDB_SEGMENT_SIZE;
+
+	/* S3 mode has the separate files for each checkpoint */
+	if (orioledb_s3_mode)
+		dirty = PG_UINT64_MAX;
+	else
+		dirty = pg_atomic_exchange_u64(&BTREE_GET_META(desc)->dirtySegments, 0);
+
+	/*
+	 * Start the writeback of all the dirty segments first, so the kernel
+	 * flushes them concurrently instead of one fsync() at a time.
+	 */
+	for (num = 0; num < numSegments; num++)
 	{
 		File		file;
 
+		if (!(dirty & DIRTY_SEGMENT_BIT(num)))
+			continue;
+
 		file = btree_open_smgr_file(desc, num, chkpNum);
-		FileSync(file, WAIT_EVENT_DATA_FILE_SYNC);
+		FileWriteback(file, 0, ORIOLEDB_SEGMENT_SIZE,
+					  WAIT_EVENT_DATA_FILE_FLUSH);
+	}
+
+	for (num = 0; num < numSegments; num++)
+	{
+		File		file;
+
+		if (!(dirty & DIRTY_SEGMENT_BIT(num)))
+			continue;
+
+		file = btree_open_smgr_file(desc, num, chkpNum);
+		if (FileSync(file, WAIT_EVENT_DATA_FILE_SYNC) < 0 &&
+			!orioledb_s3_mode)
+		{
+			/* let the next checkpoint retry */
+			pg_atomic_fetch_or_u64(&BTREE_GET_META(desc)->dirtySegments,
+								   DIRTY_SEGMENT_BIT(num));
+		}
+	}
+}
+
+/*
+ * Truncates the data files of the tree from oldLength to newLength bytes.
+ * Segments past the new length are left empty.
+ */
+void
+btree_smgr_truncate(BTreeDescr *desc, off_t oldLength, off_t newLength)
+{
+	int			num;
+
+	Assert(!orioledb_s3_mode && !use_mmap && !use_device);
+	Assert(newLength <= oldLength);
+
+	for (num = newLength / ORIOLEDB_SEGMENT_SIZE;
+		 num <= (oldLength - 1) / ORIOLEDB_SEGMENT_SIZE;
+		 num++)
+	{
+		File		file;
+		off_t		segLength;
+
+		segLength = Max(newLength - (off_t) num * ORIOLEDB_SEGMENT_SIZE, 0);
+		file = btree_open_smgr_file(desc, num, 0);
+		if (FileTruncate(file, segLength, WAIT_EVENT_DATA_FILE_TRUNCATE) < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not truncate data file to %lu bytes",
+							(unsigned long) segLength)));
+		btree_smgr_mark_dirty(desc, (off_t) num * ORIOLEDB_SEGMENT_SIZE, 1);
 	}
 }
 
@@ -1043,6 +1266,13 @@ read_page_from_disk(BTreeDescr *desc, Pointer img, uint64 downlink,
 	Assert(FileExtentOffIsValid(offset));
 	Assert(FileExtentLenIsValid(len));
 
+	if (compressed_cache_get(desc, offset, img))
+	{
+		extent->off = offset;
+		extent->len = len;
+		return true;
+	}
+
 	if (!OCompressIsValid(desc->compress))
 	{
 		/* easy case, read page from uncompressed index */
@@ -1089,13 +1319,101 @@ read_page_from_disk(BTreeDescr *desc, Pointer img, uint64 downlink,
 			OCompressHeader header;
 
 			memcpy(&header, buf, sizeof(OCompressHeader));
-			o_decompress_page(buf + sizeof(OCompressHeader), header, img);
+			o_decompress_page(buf + sizeof(OCompressHeader), header, img,
+							  desc->oids.datoid, desc->oids.relnode);
+			EA_DECOMPRESS_ADD(desc->oids, ORIOLEDB_BLCKSZ);
 		}
 	}
 
 	return !err;
 }
 
+/*
+ * Issues the prefetch of the page referenced by the valid on-disk downlink.
+ * Later read_page_from_disk() for this downlink is likely to be served from
+ * the OS cache.
+ */
+void
+prefetch_page_from_disk(BTreeDescr *desc, uint64 downlink)
+{
+	uint64		offset = DOWNLINK_GET_DISK_OFF(downlink);
+	uint16		len = DOWNLINK_GET_DISK_LEN(downlink);
+	uint32		chkpNum = 0;
+	off_t		byte_offset,
+				read_size;
+
+	Assert(FileExtentOffIsValid(offset));
+	Assert(FileExtentLenIsValid(len));
+
+	if (orioledb_s3_mode)
+	{
+		chkpNum = S3_GET_CHKP_NUM(offset);
+		offset &= S3_OFFSET_MASK;
+	}
+
+	if (!OCompressIsValid(desc->compress))
+	{
+		if (use_device)
+			byte_offset = (off_t) offset * (off_t) ORIOLEDB_COMP_BLCKSZ;
+		else
+			byte_offset = (off_t) offset * (off_t) ORIOLEDB_BLCKSZ;
+		read_size = ORIOLEDB_BLCKSZ;
+	}
+	else
+	{
+		byte_offset = (off_t) offset * (off_t) ORIOLEDB_COMP_BLCKSZ;
+		read_size = len * ORIOLEDB_COMP_BLCKSZ;
+	}
+
+	btree_smgr_prefetch(desc, chkpNum, read_size, byte_offset);
+}
+
+/*
+ * Returns the identifier of the S3 data file part containing the given
+ * on-disk page.  Identifiers grow together with downlinks, and parts of
+ * different checkpoints have identifiers differing by at least 2^32.
+ */
+uint64
+downlink_get_s3_part(BTreeDescr *desc, uint64 downlink)
+{
+	uint64		offset = DOWNLINK_GET_DISK_OFF(downlink);
+	uint32		chkpNum;
+	off_t		byte_offset;
+
+	Assert(orioledb_s3_mode);
+	Assert(FileExtentOffIsValid(offset));
+
+	chkpNum = S3_GET_CHKP_NUM(offset);
+	offset &= S3_OFFSET_MASK;
+
+	if (!OCompressIsValid(desc->compress) && !use_device)
+		byte_offset = (off_t) offset * (off_t) ORIOLEDB_BLCKSZ;
+	else
+		byte_offset = (off_t) offset * (off_t) ORIOLEDB_COMP_BLCKSZ;
+
+	return ((uint64) chkpNum << 32) | (uint64) (byte_offset / ORIOLEDB_S3_PART_SIZE);
+}
+
+/*
+ * Schedules the background load of the S3 data file part identified by
+ * downlink_get_s3_part().  Does nothing if the part is already loaded or
+ * being loaded.
+ */
+void
+prefetch_s3_part(BTreeDescr *desc, uint64 part)
+{
+	uint32		chkpNum = (uint32) (part >> 32);
+	uint32		partIndex = (uint32) part;
+	int			partsPerSegment = ORIOLEDB_SEGMENT_SIZE / ORIOLEDB_S3_PART_SIZE;
+
+	Assert(orioledb_s3_mode);
+
+	(void) s3_schedule_file_part_read(chkpNum, desc->oids.datoid,
+									  desc->oids.relnode,
+									  partIndex / partsPerSegment,
+									  partIndex % partsPerSegment);
+}
+
 /*
  * Writes a page to the disk. An array of file offsets must be valid.
  */
@@ -1110,6 +1428,10 @@ write_page_to_disk(BTreeDescr *desc, FileExtent *extent,
 	uint32		chkpNum = 0;
 
 	Assert(FileExtentOffIsValid(extent->off));
+
+	/* readers could get the new downlink only after we return */
+	compressed_cache_invalidate(desc, extent->off);
+
 	if (!OCompressIsValid(desc->compress))
 	{
 		/* easy case, write page to uncompressed index */
@@ -1146,6 +1468,10 @@ write_page_to_disk(BTreeDescr *desc, FileExtent *extent,
 		{
 			/* we need to write header first */
 			OCompressHeader header = page_size;
+			char	   *buf;
+
+			if (OCompressIsLZ4(desc->compress))
+				header |= O_COMPRESS_HEADER_LZ4;
 
 			/*
 			 * overflow protection
@@ -1154,14 +1480,18 @@ write_page_to_disk(BTreeDescr *desc, FileExtent *extent,
 			Assert(sizeof(OCompressHeader) == sizeof(uint16));
 			Assert(ORIOLEDB_BLCKSZ < UINT16_MAX);
 
-			write_size = sizeof(OCompressHeader);
-			err = btree_smgr_write(desc, (char *) &header, chkpNum, write_size, byte_offset) != write_size;
-			byte_offset += write_size;
-
-			if (err)
-				return false;
-
-			write_size = extent->len * ORIOLEDB_COMP_BLCKSZ - sizeof(OCompressHeader);
+			/*
+			 * Assemble header and data in one buffer, so the whole extent is
+			 * written at once with a sector-aligned offset and length.
+			 */
+			buf = get_direct_io_buffer();
+			write_size = extent->len * ORIOLEDB_COMP_BLCKSZ;
+			Assert(sizeof(OCompressHeader) + page_size <= write_size);
+			memcpy(buf, &header, sizeof(OCompressHeader));
+			memcpy(buf + sizeof(OCompressHeader), page, page_size);
+			memset(buf + sizeof(OCompressHeader) + page_size, 0,
+				   write_size - sizeof(OCompressHeader) - page_size);
+			page = buf;
 		}
 		else
 		{
@@ -1203,6 +1533,9 @@ load_page(OBTreeFindPageContext *context)
 	bool		was_image = false;
 	bool		was_keep_lokey = false;
 	uint32		chkpNum = 0;
+	instr_time	loadStart;
+
+	O_LATENCY_START(loadStart);
 
 	context_index = context->index;
 	parent_blkno = context->items[context_index].blkno;
@@ -1237,6 +1570,9 @@ load_page(OBTreeFindPageContext *context)
 
 	page_desc->flags = 0;
 
+	TRACE_ORIOLEDB_PAGE_LOAD_START(desc->oids.datoid, desc->oids.relnode,
+								   DOWNLINK_GET_DISK_OFF(downlink));
+
 	/* Read page data and put it to the page */
 	if (!read_page_from_disk(desc, buf, downlink, &page_desc->fileExtent))
 	{
@@ -1253,8 +1589,17 @@ load_page(OBTreeFindPageContext *context)
 	}
 
 	put_page_image(blkno, buf);
+	TRACE_ORIOLEDB_PAGE_LOAD_DONE(desc->oids.datoid, desc->oids.relnode, blkno,
+								  disk_downlink_get_bytes(desc, downlink));
+	o_latency_report(OLatencyPageLoad, loadStart);
 	page_change_usage_count(&desc->ppool->ucm, blkno,
-							(pg_atomic_read_u32(desc->ppool->ucm.epoch) + 2) % UCM_USAGE_LEVELS);
+							btree_page_initial_usage_count(desc,
+														   btree_page_ghost_key(desc,
+																				page_desc->fileExtent.off)));
+	pg_atomic_fetch_add_u64(desc->ppool->loadedPagesCount, 1);
+	loaded_pages_count++;
+	pg_atomic_fetch_add_u32(&BTREE_GET_META(desc)->numResidentPages, 1);
+	pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->numLoadedPages, 1);
 	page_desc->type = parent_page_desc->type;
 	page_desc->oids = parent_page_desc->oids;
 
@@ -1364,7 +1709,8 @@ get_write_img(BTreeDescr *desc, Page page, size_t *size)
 
 	if (OCompressIsValid(desc->compress))
 	{
-		result = o_compress_page(page, size, desc->compress);
+		result = o_compress_page(page, size, desc->compress,
+								 desc->oids.datoid, desc->oids.relnode);
 		if (*size > (ORIOLEDB_BLCKSZ - ORIOLEDB_COMP_BLCKSZ - sizeof(OCompressHeader)))
 		{
 			/*
@@ -1415,6 +1761,7 @@ perform_page_io(BTreeDescr *desc, OInMemoryBlkno blkno,
 	size_t		write_size;
 	int			chkp_index;
 	bool		less_num,
+				relocate,
 				err = false;
 
 #ifdef USE_ASSERT_CHECKING
@@ -1424,6 +1771,17 @@ perform_page_io(BTreeDescr *desc, OInMemoryBlkno blkno,
 	EA_WRITE_INC(blkno);
 
 	less_num = header->checkpointNum < checkpoint_number;
+
+	/*
+	 * Temporary trees are never checkpointed, so nobody needs the previous
+	 * page image.  Rewrite the page in-place instead of relocating it, that
+	 * saves the free extents churn.
+	 */
+	relocate = less_num &&
+		!(desc->storageType == BTreeStorageTemporary &&
+		  !OCompressIsValid(desc->compress) &&
+		  FileExtentIsValid(page_desc->fileExtent));
+
 	if (less_num)
 	{
 		/*
@@ -1488,7 +1846,7 @@ perform_page_io(BTreeDescr *desc, OInMemoryBlkno blkno,
 			}
 		}
 	}
-	else if (less_num)
+	else if (relocate)
 	{
 		/*
 		 * Page wasn't yet written during given checkpoint, so we have to
@@ -1531,8 +1889,8 @@ perform_page_io(BTreeDescr *desc, OInMemoryBlkno blkno,
 	else
 	{
 		/*
-		 * Has been already written during given checkpoint, so rewrite page
-		 * in-place.
+		 * Has been already written during given checkpoint (or belongs to a
+		 * temporary tree), so rewrite page in-place.
 		 */
 		Assert(FileExtentIsValid(page_desc->fileExtent));
 		if (!OCompressIsValid(desc->compress))
@@ -1839,8 +2197,14 @@ write_page(OBTreeFindPageContext *context, OInMemoryBlkno blkno, Page img,
 
 	if (!IS_DIRTY(blkno))
 	{
+		char		buf[ORIOLEDB_BLCKSZ];
+		FileExtent	extent = page_desc->fileExtent;
+
 		Assert(evict);
 
+		if (compressed_buffers_guc > 0)
+			memcpy(buf, p, ORIOLEDB_BLCKSZ);
+
 		/*
 		 * Easy case: page isn't dirty and doesn't need to be written to the
 		 * disk.  Then we just have to change downlink in the parent.
@@ -1851,6 +2215,10 @@ write_page(OBTreeFindPageContext *context, OInMemoryBlkno blkno, Page img,
 		/* Concurrent readers should give up when we release the lock... */
 		O_PAGE_CHANGE_COUNT_INC(p);
 		unlock_page(blkno);
+
+		/* IO lock prevents the page from being loaded and rewritten */
+		if (compressed_buffers_guc > 0)
+			compressed_cache_put(desc, extent, buf);
 		unlock_io(ionum);
 	}
 	else
@@ -1880,7 +2248,12 @@ write_page(OBTreeFindPageContext *context, OInMemoryBlkno blkno, Page img,
 										   checkpoint_number, copy_blkno, &dirty_parent);
 
 			if (DiskDownlinkIsValid(new_downlink))
+			{
 				writeback_put_extent(&io_writeback, desc, new_downlink);
+				compressed_cache_put(desc, page_desc->fileExtent, p);
+				pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->evictionBytes,
+										disk_downlink_get_bytes(desc, new_downlink));
+			}
 
 			/* Page is not dirty anymore */
 			CLEAN_DIRTY(desc->ppool, blkno);
@@ -1905,7 +2278,11 @@ write_page(OBTreeFindPageContext *context, OInMemoryBlkno blkno, Page img,
 										   checkpoint_number, copy_blkno, &dirty_parent);
 
 			if (DiskDownlinkIsValid(new_downlink))
+			{
 				writeback_put_extent(&io_writeback, desc, new_downlink);
+				pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->evictionBytes,
+										disk_downlink_get_bytes(desc, new_downlink));
+			}
 
 			/* Clean dirty only if there are no concurrent writes */
 			lock_page(blkno);
@@ -1990,7 +2367,16 @@ write_page(OBTreeFindPageContext *context, OInMemoryBlkno blkno, Page img,
 		unlock_page(parent_blkno);
 
 	if (evict)
+	{
+		if (FileExtentIsValid(page_desc->fileExtent))
+			ppool_ghost_insert(desc->ppool,
+							   btree_page_ghost_key(desc,
+													page_desc->fileExtent.off));
 		ppool_free_page(desc->ppool, blkno, NULL);
+		if (!is_root)
+			pg_atomic_fetch_sub_u32(&BTREE_GET_META(desc)->numResidentPages, 1);
+		pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->numEvictedPages, 1);
+	}
 
 	perform_writeback(&io_writeback);
 }
@@ -2096,6 +2482,10 @@ evict_btree(BTreeDescr *desc, uint32 checkpoint_number)
 
 	file_header.rootDownlink = new_downlink;
 
+	/* cached free extents would be lost together with the meta page */
+	if (OCompressIsValid(desc->compress) && !orioledb_s3_mode)
+		free_extents_cache_flush(desc);
+
 	ppool_free_page(desc->ppool, root_blkno, NULL);
 
 	if (orioledb_s3_mode)
@@ -2103,6 +2493,7 @@ evict_btree(BTreeDescr *desc, uint32 checkpoint_number)
 
 	file_header.datafileLength = pg_atomic_read_u64(&metaPage->datafileLength[chkpNum % 2]);
 	file_header.leafPagesNum = pg_atomic_read_u32(&metaPage->leafPagesNum);
+	file_header.numTuples = pg_atomic_read_u64(&metaPage->numTuples);
 	file_header.ctid = pg_atomic_read_u64(&metaPage->ctid);
 	file_header.numFreeBlocks = pg_atomic_read_u64(&metaPage->numFreeBlocks);
 #ifdef USE_ASSERT_CHECKING
@@ -2235,6 +2626,24 @@ retry:
 			return OWalkPageSkipped;
 	}
 
+	/* Keep the guaranteed number of the tree pages in memory */
+	if (evict && desc->buffersMinPages > 0 &&
+		pg_atomic_read_u32(&BTREE_GET_META(desc)->numResidentPages) <=
+		(uint32) desc->buffersMinPages)
+		return OWalkPageSkipped;
+
+	/*
+	 * Keep the system trees in catalog_buffers resident, unless the pool is
+	 * exhausted.
+	 */
+	if (evict && IS_SYS_TREE_OIDS(oids) &&
+		desc->ppool == get_ppool(OPagePoolCatalog) &&
+		ppool_free_pages_count(desc->ppool) > 0 &&
+		((catalog_buffers_pin_upper_levels && !O_PAGE_IS(p, LEAF)) ||
+		 pg_atomic_read_u32(&BTREE_GET_META(desc)->numResidentPages) <=
+		 (uint32) catalog_buffers_pinned_pages))
+		return OWalkPageSkipped;
+
 	if (!try_lock_page(blkno))
 		return OWalkPageSkipped;
 
@@ -2442,13 +2851,119 @@ retry:
 
 	STOPEVENT(STOPEVENT_BEFORE_WRITE_PAGE, NULL);
 
+	TRACE_ORIOLEDB_PAGE_WRITE_START(oids.datoid, oids.relnode, blkno, evict);
 	write_page(&context, blkno, img, checkpoint_number, evict, copy_blkno);
+	TRACE_ORIOLEDB_PAGE_WRITE_DONE(oids.datoid, oids.relnode, blkno, evict);
 
 	STOPEVENT(STOPEVENT_AFTER_WRITE_PAGE, NULL);
 
 	return evict ? OWalkPageEvicted : OWalkPageWritten;
 }
 
+/*
+ * Writes the dirty leaf page of the compressed BTree, which isn't yet passed
+ * by the checkpoint in progress.  That moves page compression from the
+ * checkpointer to the caller: the checkpointer finds the page clean and
+ * reuses its extent.
+ */
+OWalkPageResult
+walk_page_checkpoint_ahead(OInMemoryBlkno blkno)
+{
+	OrioleDBPageDesc *page_desc = O_GET_IN_MEMORY_PAGEDESC(blkno);
+	BTreeDescr *desc;
+	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+	ORelOids	oids;
+
+	if (!ORelOidsIsValid(page_desc->oids) || page_desc->type == oIndexInvalid)
+		return OWalkPageSkipped;
+
+	/* Cheap unlocked prechecks, walk_page() rechecks under the lock */
+	if (!O_PAGE_IS(p, LEAF) || !IS_DIRTY(blkno))
+		return OWalkPageSkipped;
+
+	/* Important to access the shared memory once */
+	oids = *((volatile ORelOids *) &page_desc->oids);
+
+	/* System trees are not compressed */
+	if (IS_SYS_TREE_OIDS(oids))
+		return OWalkPageSkipped;
+
+	desc = index_oids_get_btree_descr(oids, page_desc->type);
+	if (desc == NULL || !OCompressIsValid(desc->compress) ||
+		!checkpoint_is_ahead_of_tree(desc))
+		return OWalkPageSkipped;
+
+	return walk_page(blkno, false);
+}
+
+/*
+ * Examine single leaf page and merge it with a sibling if it's too sparse.
+ * Unlike walk_page(), the page is never written or evicted here.
+ */
+OWalkPageResult
+walk_page_merge(OInMemoryBlkno blkno)
+{
+	OrioleDBPageDesc *page_desc = O_GET_IN_MEMORY_PAGEDESC(blkno);
+	BTreeDescr *desc;
+	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+	ORelOids	oids;
+
+	if (!ORelOidsIsValid(page_desc->oids) || page_desc->type == oIndexInvalid)
+		return OWalkPageSkipped;
+
+	/* Cheap unlocked precheck, we'll recheck it under the lock */
+	if (!O_PAGE_IS(p, LEAF))
+		return OWalkPageSkipped;
+
+	/* Important to access the shared memory once */
+	oids = *((volatile ORelOids *) &page_desc->oids);
+
+	/*
+	 * Descriptor lookup might imply page eviction, so do this before locking
+	 * the page (see walk_page()).
+	 */
+	if (IS_SYS_TREE_OIDS(oids))
+	{
+		if (sys_tree_get_storage_type(oids.relnode) != BTreeStorageInMemory)
+			desc = get_sys_tree(oids.relnode);
+		else
+			return OWalkPageSkipped;
+	}
+	else
+	{
+		desc = index_oids_get_btree_descr(oids, page_desc->type);
+
+		if (desc == NULL)
+			return OWalkPageSkipped;
+	}
+
+	if (!try_lock_page(blkno))
+		return OWalkPageSkipped;
+
+	if (!ORelOidsIsValid(page_desc->oids) ||
+		page_desc->type == oIndexInvalid ||
+		!ORelOidsIsEqual(oids, page_desc->oids) ||
+		!O_PAGE_IS(p, LEAF) ||
+		O_PAGE_IS(p, PRE_CLEANUP) ||
+		page_desc->ionum >= 0 ||
+		RightLinkIsValid(BTREE_PAGE_GET_RIGHTLINK(p)) ||
+		desc->rootInfo.rootPageBlkno == blkno ||
+		!is_page_too_sparse(desc, p))
+	{
+		unlock_page(blkno);
+		return OWalkPageSkipped;
+	}
+
+	if (btree_try_merge_and_unlock(desc, blkno, true, false))
+	{
+		Assert(!have_locked_pages());
+		return OWalkPageMerged;
+	}
+
+	Assert(!have_locked_pages());
+	return OWalkPageSkipped;
+}
+
 static bool
 write_tree_pages_recursive(OInMemoryBlkno blkno, uint32 changeCount,
 						   int maxLevel, bool evict)
@@ -2685,7 +3200,8 @@ perform_writeback(IOWriteBack *writeback)
 	int			segno = 0;
 	int			chkpNum = 0;
 
-	if (use_device && !use_mmap)
+	/* O_DIRECT writes don't leave dirty data in the page cache */
+	if ((use_device || orioledb_direct_io) && !use_mmap)
 	{
 		writeback->extentsNumber = 0;
 		return;
@@ -2819,7 +3335,7 @@ iterate_relnode_files(Oid datoid, Oid relnode, RelnodeFileCallback callback,
 		if ((sscanf(file->d_name, "%10u-%10u.%4s",
 					&file_relnode, &file_chkp, file_ext) == 3 &&
 			 (!strcmp(file_ext, "tmp") || !strcmp(file_ext, "map") ||
-			  !strcmp(file_ext, "evt")) &&
+			  !strcmp(file_ext, "evt") || !strcmp(file_ext, "dict")) &&
 			 (file_ext_p = file_ext)) ||
 			sscanf(file->d_name, "%10u.%10u",
 				   &file_relnode, &file_segno) == 2 ||
@@ -2872,6 +3388,24 @@ cleanup_btree_files(Oid datoid, Oid relnode)
 	return iterate_relnode_files(datoid, relnode, unlink_callback, NULL);
 }
 
+/*
+ * Starts the writeback of the file without waiting for it.
+ */
+static void
+flush_callback(const char *filename, uint32 segno, char *ext, void *arg)
+{
+	int			fd;
+
+	if (ext != NULL && strcmp(ext, "tmp") == 0)
+		return;
+
+	fd = OpenTransientFile(filename, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+		return;
+	pg_flush_data(fd, 0, 0);
+	CloseTransientFile(fd);
+}
+
 static void
 fsync_callback(const char *filename, uint32 segno, char *ext, void *arg)
 {
@@ -2882,5 +3416,41 @@ fsync_callback(const char *filename, uint32 segno, char *ext, void *arg)
 bool
 fsync_btree_files(Oid datoid, Oid relnode)
 {
+	/* Pages of all the trees share the device */
+	if (use_device)
+		btree_smgr_sync_device();
+
+	/* Let the kernel write all the files concurrently, then wait for them */
+	if (!iterate_relnode_files(datoid, relnode, flush_callback, NULL))
+		return false;
 	return iterate_relnode_files(datoid, relnode, fsync_callback, NULL);
 }
+
+/*
+ * Makes the writes to the device durable.  Pages written with pwrite() or
+ * O_DIRECT might still reside in the OS page cache or the volatile cache of
+ * the device until synced.
+ */
+void
+btree_smgr_sync_device(void)
+{
+	Assert(use_device);
+
+	if (use_mmap)
+	{
+		if (msync(mmap_data, device_length, MS_SYNC) != 0)
+			ereport(data_sync_elevel(ERROR),
+					(errcode_for_file_access(),
+					 errmsg("could not msync device file \"%s\": %m",
+							device_filename)));
+		return;
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_SYNC);
+	if (pg_fsync(device_fd) != 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync device file \"%s\": %m",
+						device_filename)));
+	pgstat_report_wait_end();
+}
@@ -16,10 +16,14 @@
 
 #include "btree/btree.h"
 #include "btree/find.h"
+#include "btree/io.h"
 #include "btree/iterator.h"
+#include "btree/lookup_cache.h"
 #include "btree/page_chunks.h"
+#include "btree/page_state.h"
 #include "btree/undo.h"
 #include "catalog/sys_trees.h"
+#include "tableam/handler.h"
 #include "transam/oxid.h"
 #include "transam/undo.h"
 #include "utils/page_pool.h"
@@ -64,6 +68,8 @@ struct BTreeIterator
 	/* callback for fetching tuple version */
 	TupleFetchCallback fetchCallback;
 	void	   *fetchCallbackArg;
+	/* is read-ahead of the next leaves done for the current page? */
+	bool		prefetchDone;
 #ifdef USE_ASSERT_CHECKING
 	/* additional check for iteration order */
 	OFixedTuple prevTuple;
@@ -73,6 +79,7 @@ struct BTreeIterator
 static void get_next_combined_location(BTreeIterator *it);
 static void load_page_from_undo(BTreeIterator *it, void *key, BTreeKeyType kind);
 static bool btree_iterator_check_load_next_page(BTreeIterator *it);
+static void btree_iterator_prefetch_siblings(BTreeIterator *it);
 static OTuple o_btree_iterator_fetch_internal(BTreeIterator *it,
 											  CommitSeqNo *tupleCsn);
 static bool o_btree_interator_can_fetch_from_undo(BTreeDescr *desc, BTreeIterator *it);
@@ -105,48 +112,31 @@ static void undo_it_find_internal(UndoIterator *undoIt, void *key, BTreeKeyType
 			BTREE_PAGE_LOCATOR_PREV((undoIt)->image, (loc)); \
 	} while (0); \
 
+struct BTreeBatchLookup
+{
+	OBTreeFindPageContext context;
+	CommitSeqNo readCsn;
+	bool		combinedResult;
+	/* does context.img hold the leaf image, which could be searched again */
+	bool		imgValid;
+};
+
 /*
- * Fetches tuple from the tree with given CSN snapshot.  Tuple is allocated
- * in the given context.  Leaf page is found using the given hint (if provided).
- * Given hint is adjusted with relevant leaf page.
+ * Fetches tuple from the leaf page image already located by find context.
+ * Sets `*imgValid` to false if the image was replaced with undo image.
  */
-OTuple
-o_btree_find_tuple_by_key_cb(BTreeDescr *desc, void *key,
-							 BTreeKeyType kind, CommitSeqNo readCsn,
-							 CommitSeqNo *outCsn, MemoryContext mcxt,
-							 BTreeLocationHint *hint,
-							 bool *deleted,
-							 TupleFetchCallback cb,
-							 void *arg)
+static OTuple
+find_tuple_in_context(BTreeDescr *desc, OBTreeFindPageContext *context,
+					  BTreePageItemLocator loc, void *key,
+					  BTreeKeyType kind, CommitSeqNo readCsn,
+					  CommitSeqNo *outCsn, MemoryContext mcxt,
+					  bool combinedResult, bool *deleted,
+					  TupleFetchCallback cb, void *arg, bool *imgValid)
 {
-	BTreePageItemLocator loc;
-	OBTreeFindPageContext context;
-	char	   *img = context.img;
+	char	   *img = context->img;
 	BTreePageHeader *header = (BTreePageHeader *) img;
-	bool		combinedResult = false;
 	OTuple		result;
 
-	if (COMMITSEQNO_IS_NORMAL(readCsn))
-		combinedResult = !have_current_undo();
-
-	init_page_find_context(&context, desc,
-						   combinedResult ? COMMITSEQNO_INPROGRESS : readCsn, BTREE_PAGE_FIND_FETCH);
-
-	/* Use page location hint if provided */
-	if (hint && OInMemoryBlknoIsValid(hint->blkno))
-		refind_page(&context, key, kind, 0, hint->blkno, hint->pageChangeCount);
-	else
-		(void) find_page(&context, key, kind, 0);
-
-	loc = context.items[context.index].locator;
-
-	/* Adjust hint if given */
-	if (hint)
-	{
-		hint->blkno = context.items[context.index].blkno;
-		hint->pageChangeCount = context.items[context.index].pageChangeCount;
-	}
-
 	if (combinedResult && header->csn >= readCsn)
 	{
 		if (BTREE_PAGE_LOCATOR_IS_VALID(img, &loc))
@@ -185,6 +175,8 @@ o_btree_find_tuple_by_key_cb(BTreeDescr *desc, void *key,
 		}
 		read_page_from_undo(desc, img, header->undoLocation, readCsn,
 							key, kind, NULL);
+		if (imgValid)
+			*imgValid = false;
 		btree_page_search(desc, img, key, kind, NULL, &loc);
 		page_locator_find_real_item(img, NULL, &loc);
 	}
@@ -211,6 +203,56 @@ o_btree_find_tuple_by_key_cb(BTreeDescr *desc, void *key,
 	return result;
 }
 
+/*
+ * Fetches tuple from the tree with given CSN snapshot.  Tuple is allocated
+ * in the given context.  Leaf page is found using the given hint (if provided).
+ * Given hint is adjusted with relevant leaf page.
+ */
+OTuple
+o_btree_find_tuple_by_key_cb(BTreeDescr *desc, void *key,
+							 BTreeKeyType kind, CommitSeqNo readCsn,
+							 CommitSeqNo *outCsn, MemoryContext mcxt,
+							 BTreeLocationHint *hint,
+							 bool *deleted,
+							 TupleFetchCallback cb,
+							 void *arg)
+{
+	BTreePageItemLocator loc;
+	OBTreeFindPageContext context;
+	bool		combinedResult = false;
+	uint32		keyHash = 0;
+
+	o_btree_count_op(desc, BTreeStatLookup);
+
+	if (COMMITSEQNO_IS_NORMAL(readCsn))
+		combinedResult = !have_current_undo();
+
+	init_page_find_context(&context, desc,
+						   combinedResult ? COMMITSEQNO_INPROGRESS : readCsn, BTREE_PAGE_FIND_FETCH);
+
+	/* Use page location hint if provided */
+	if (hint && OInMemoryBlknoIsValid(hint->blkno))
+		refind_page(&context, key, kind, 0, hint->blkno, hint->pageChangeCount);
+	else if (!lookup_cache_find_page(&context, key, kind, &keyHash))
+	{
+		(void) find_page(&context, key, kind, 0);
+		lookup_cache_remember(&context, keyHash);
+	}
+
+	loc = context.items[context.index].locator;
+
+	/* Adjust hint if given */
+	if (hint)
+	{
+		hint->blkno = context.items[context.index].blkno;
+		hint->pageChangeCount = context.items[context.index].pageChangeCount;
+	}
+
+	return find_tuple_in_context(desc, &context, loc, key, kind, readCsn,
+								 outCsn, mcxt, combinedResult, deleted,
+								 cb, arg, NULL);
+}
+
 OTuple
 o_btree_find_tuple_by_key(BTreeDescr *desc, void *key, BTreeKeyType kind,
 						  CommitSeqNo readCsn, CommitSeqNo *outCsn,
@@ -221,6 +263,171 @@ o_btree_find_tuple_by_key(BTreeDescr *desc, void *key, BTreeKeyType kind,
 }
 
 
+/*
+ * Creates the lookup state for the series of o_btree_batch_lookup_fetch()
+ * calls.  Neighbouring keys are often located in the same leaf page.  Then
+ * the leaf page image read by the previous call is searched again without
+ * descending the tree from the root.
+ */
+BTreeBatchLookup *
+o_btree_batch_lookup_create(BTreeDescr *desc)
+{
+	BTreeBatchLookup *lookup;
+
+	lookup = (BTreeBatchLookup *) palloc(sizeof(BTreeBatchLookup));
+	lookup->context.desc = desc;
+	lookup->readCsn = InvalidCommitSeqNo;
+	lookup->combinedResult = false;
+	lookup->imgValid = false;
+
+	return lookup;
+}
+
+/*
+ * Tries to locate the key within the leaf page image left by the previous
+ * lookup.  That's possible only if the page wasn't changed since it was read
+ * and the key fits the page key range.
+ */
+static bool
+batch_lookup_locate_in_image(BTreeBatchLookup *lookup, void *key,
+							 BTreeKeyType kind, BTreePageItemLocator *loc)
+{
+	OBTreeFindPageContext *context = &lookup->context;
+	BTreeDescr *desc = context->desc;
+	OBtreePageFindItem *item = &context->items[context->index];
+	Page		img = context->img;
+	Page		p;
+	uint32		imgState,
+				srcState;
+
+	if (!lookup->imgValid)
+		return false;
+
+	/* The image should be the same as the in-memory page */
+	p = O_GET_IN_MEMORY_PAGE(item->blkno);
+	imgState = pg_atomic_read_u32(&(O_PAGE_HEADER(img)->state));
+	srcState = pg_atomic_read_u32(&(O_PAGE_HEADER(p)->state));
+	if ((imgState & PAGE_STATE_CHANGE_COUNT_MASK) != (srcState & PAGE_STATE_CHANGE_COUNT_MASK) ||
+		O_PAGE_STATE_READ_IS_BLOCKED(srcState) ||
+		O_PAGE_GET_CHANGE_COUNT(p) != item->pageChangeCount)
+		return false;
+
+	/* Check the key is less than the page hikey */
+	if (!O_PAGE_IS(img, RIGHTMOST))
+	{
+		OTuple		hikey;
+
+		BTREE_PAGE_GET_HIKEY(hikey, img);
+		if (o_btree_cmp(desc, key, kind, &hikey, BTreeKeyNonLeafKey) >= 0)
+			return false;
+	}
+
+	/*
+	 * We don't know the page lokey.  But the key greater or equal than the
+	 * first page item belongs to the page as well.
+	 */
+	if (!O_PAGE_IS(img, LEFTMOST))
+	{
+		BTreePageItemLocator firstLoc;
+		OTuple		firstTuple;
+
+		BTREE_PAGE_LOCATOR_FIRST(img, &firstLoc);
+		if (!BTREE_PAGE_LOCATOR_IS_VALID(img, &firstLoc) ||
+			!partial_load_chunk(&context->partial, img, firstLoc.chunkOffset))
+			return false;
+
+		BTREE_PAGE_READ_TUPLE(firstTuple, img, &firstLoc);
+		if (o_btree_cmp(desc, key, kind, &firstTuple, BTreeKeyLeafTuple) < 0)
+			return false;
+	}
+
+	if (!btree_page_search(desc, img, key, kind, &context->partial, loc) ||
+		!page_locator_find_real_item(img, &context->partial, loc) ||
+		!partial_load_chunk(&context->partial, img, loc->chunkOffset))
+		return false;
+
+	item->locator = *loc;
+	return true;
+}
+
+/*
+ * Fetches tuple by the key reusing the leaf page image from the previous
+ * call if possible.  Works the same as o_btree_find_tuple_by_key() otherwise.
+ */
+OTuple
+o_btree_batch_lookup_fetch(BTreeBatchLookup *lookup, void *key,
+						   BTreeKeyType kind, CommitSeqNo readCsn,
+						   CommitSeqNo *outCsn, MemoryContext mcxt,
+						   BTreeLocationHint *hint)
+{
+	OBTreeFindPageContext *context = &lookup->context;
+	BTreeDescr *desc = context->desc;
+	BTreePageItemLocator loc;
+	bool		combinedResult = false;
+
+	o_btree_count_op(desc, BTreeStatLookup);
+
+	if (COMMITSEQNO_IS_NORMAL(readCsn))
+		combinedResult = !have_current_undo();
+
+	if (!lookup->imgValid ||
+		lookup->readCsn != readCsn ||
+		lookup->combinedResult != combinedResult)
+	{
+		init_page_find_context(context, desc,
+							   combinedResult ? COMMITSEQNO_INPROGRESS : readCsn,
+							   BTREE_PAGE_FIND_FETCH);
+		lookup->readCsn = readCsn;
+		lookup->combinedResult = combinedResult;
+		lookup->imgValid = false;
+	}
+
+	if (!batch_lookup_locate_in_image(lookup, key, kind, &loc))
+	{
+		(void) find_page(context, key, kind, 0);
+		loc = context->items[context->index].locator;
+		lookup->imgValid = true;
+	}
+
+	if (hint)
+	{
+		hint->blkno = context->items[context->index].blkno;
+		hint->pageChangeCount = context->items[context->index].pageChangeCount;
+	}
+
+	return find_tuple_in_context(desc, context, loc, key, kind, readCsn,
+								 outCsn, mcxt, combinedResult, NULL,
+								 NULL, NULL, &lookup->imgValid);
+}
+
+void
+o_btree_batch_lookup_free(BTreeBatchLookup *lookup)
+{
+	pfree(lookup);
+}
+
+/*
+ * Fetches tuples for the batch of keys.  Keys are expected to be sorted, so
+ * that the keys located in the same leaf page are looked up together.
+ */
+void
+o_btree_find_tuples_by_keys(BTreeDescr *desc, void **keys, int nkeys,
+							BTreeKeyType kind, CommitSeqNo readCsn,
+							OTuple *results, CommitSeqNo *outCsns,
+							MemoryContext mcxt)
+{
+	BTreeBatchLookup *lookup = o_btree_batch_lookup_create(desc);
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+		results[i] = o_btree_batch_lookup_fetch(lookup, keys[i], kind,
+												readCsn,
+												outCsns ? &outCsns[i] : NULL,
+												mcxt, NULL);
+
+	o_btree_batch_lookup_free(lookup);
+}
+
 /*
  * Finds appropriate tuple version in the undo chain.
  */
@@ -336,6 +543,7 @@ o_find_tuple_version(BTreeDescr *desc, Page p, BTreePageItemLocator *loc,
 			get_prev_leaf_header_and_tuple_from_undo(&tupHdr, &curTuple, 0);
 			curTupleAllocated = true;
 		}
+		EA_UNDO_VERSION_INC(desc->oids);
 
 		Assert(UNDO_REC_EXISTS(undoLocation));
 	}
@@ -389,6 +597,7 @@ o_btree_iterator_create(BTreeDescr *desc, void *key, BTreeKeyType kind,
 	it->tupleCxt = CurrentMemoryContext;
 	it->fetchCallback = NULL;
 	it->fetchCallbackArg = NULL;
+	it->prefetchDone = false;
 	BTREE_PAGE_LOCATOR_SET_INVALID(&it->undoLoc);
 #ifdef USE_ASSERT_CHECKING
 	O_TUPLE_SET_NULL(it->prevTuple.tuple);
@@ -719,6 +928,9 @@ btree_iterator_check_load_next_page(BTreeIterator *it)
 	BTreeDescr *desc = context->desc;
 	OFixedKey	key_buf;
 
+	if (!it->prefetchDone)
+		btree_iterator_prefetch_siblings(it);
+
 	if (o_btree_interator_can_fetch_from_undo(context->desc, it))
 		return true;
 
@@ -737,6 +949,8 @@ btree_iterator_check_load_next_page(BTreeIterator *it)
 		if (!step_result)
 			return false;
 
+		it->prefetchDone = false;
+
 		if (it->combinedResult && header->csn >= it->csn)
 		{
 			bool		reload = true;
@@ -780,6 +994,67 @@ btree_iterator_check_load_next_page(BTreeIterator *it)
 	return true;
 }
 
+/*
+ * Issues read-ahead for the next leaves once the iterator has passed
+ * orioledb.iterator_prefetch_threshold of the current leaf.  Downlinks of the
+ * siblings are taken from the parent page image kept by the find context.
+ * In-memory siblings need no read-ahead, and the siblings beyond the parent
+ * page are left for find_right_page()/find_left_page() to load.
+ */
+static void
+btree_iterator_prefetch_siblings(BTreeIterator *it)
+{
+	OBTreeFindPageContext *context = &it->context;
+	Page		img = context->img,
+				parentImg = context->parentImg;
+	BTreePageItemLocator *leafLoc = &context->items[context->index].locator;
+	BTreePageItemLocator loc;
+	int			i;
+
+	if (iterator_prefetch_pages == 0 || context->index == 0 ||
+		!O_PAGE_IS(img, LEAF) || IS_LAST_PAGE(img, it))
+	{
+		it->prefetchDone = true;
+		return;
+	}
+
+	if (BTREE_PAGE_LOCATOR_IS_VALID(img, leafLoc))
+	{
+		int			count = BTREE_PAGE_ITEMS_COUNT(img),
+					passed;
+
+		passed = BTREE_PAGE_LOCATOR_GET_OFFSET(img, leafLoc);
+		if (IT_IS_BACKWARD(it))
+			passed = count - 1 - passed;
+		if (passed < iterator_prefetch_threshold * count)
+			return;
+	}
+
+	it->prefetchDone = true;
+
+	loc = context->items[context->index - 1].locator;
+	if (!BTREE_PAGE_LOCATOR_IS_VALID(parentImg, &loc))
+		return;
+
+	for (i = 0; i < iterator_prefetch_pages; i++)
+	{
+		BTreeNonLeafTuphdr *tuphdr;
+
+		if (IT_IS_FORWARD(it))
+			BTREE_PAGE_LOCATOR_NEXT(parentImg, &loc);
+		else
+			BTREE_PAGE_LOCATOR_PREV(parentImg, &loc);
+
+		if (!BTREE_PAGE_LOCATOR_IS_VALID(parentImg, &loc) ||
+			!partial_load_chunk(&context->partial, parentImg, loc.chunkOffset))
+			break;
+
+		tuphdr = (BTreeNonLeafTuphdr *) BTREE_PAGE_LOCATOR_GET_ITEM(parentImg, &loc);
+		if (DOWNLINK_IS_ON_DISK(tuphdr->downlink))
+			prefetch_page_from_disk(context->desc, tuphdr->downlink);
+	}
+}
+
 /*
  * Can we fetch more pages form undo page image?
  */
@@ -0,0 +1,153 @@
+/*-------------------------------------------------------------------------
+ *
+ * lookup_cache.c
+ *		Backend-local cache of leaf pages found by the equality lookups.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/btree/lookup_cache.c
+ *
+ * NOTES
+ *
+ *		Tables accessed only by the exact primary key still descend the tree
+ *		from the root on every lookup.  The cache maps the hash of the
+ *		equality search key together with the tree oids to the leaf page
+ *		found by the previous lookup of the same key.  The next lookup goes
+ *		directly to that leaf using refind_page(), which checks the page
+ *		change count and follows the rightlinks if the page was split.
+ *
+ *		The hash isn't unique, so the leaf located by the cache is checked
+ *		to cover the key: its first tuple must not be greater than the key.
+ *		Otherwise, the key might belong to the left sibling and the lookup
+ *		falls back to the regular search.  Thus, stale or colliding entries
+ *		only cost an extra search.
+ *
+ *		Slots are direct-mapped by the hash, a new entry replaces any
+ *		colliding one.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/btree.h"
+#include "btree/find.h"
+#include "btree/lookup_cache.h"
+#include "btree/page_chunks.h"
+
+#include "common/hashfn.h"
+#include "utils/memutils.h"
+
+typedef struct
+{
+	ORelOids	oids;
+	uint32		hash;
+	OInMemoryBlkno blkno;
+	uint32		pageChangeCount;
+} LookupCacheEntry;
+
+static LookupCacheEntry *lookupCache = NULL;
+static int	lookupCacheSize = 0;
+
+/*
+ * Returns the cache slot for the given key hash.  (Re)allocates the cache
+ * if orioledb.lookup_cache_size was changed.
+ */
+static LookupCacheEntry *
+get_cache_entry(BTreeDescr *desc, uint32 hash)
+{
+	uint32		slotNum;
+
+	if (lookupCacheSize != lookup_cache_size)
+	{
+		if (lookupCache)
+			pfree(lookupCache);
+		lookupCache = NULL;
+		lookupCacheSize = lookup_cache_size;
+		if (lookupCacheSize > 0)
+			lookupCache = MemoryContextAllocZero(TopMemoryContext,
+												 sizeof(LookupCacheEntry) *
+												 lookupCacheSize);
+	}
+
+	if (lookupCacheSize == 0)
+		return NULL;
+
+	slotNum = hash_combine(hash, desc->oids.relnode) % lookupCacheSize;
+	return &lookupCache[slotNum];
+}
+
+/*
+ * Locates the leaf page for the equality lookup of `key` using the cache.
+ * Returns true if the context points to the leaf page, which covers the
+ * key.  Otherwise, `*hash` is set to the key hash for the later
+ * lookup_cache_remember() call, or to zero if the key can't be cached.
+ */
+bool
+lookup_cache_find_page(OBTreeFindPageContext *context, void *key,
+					   BTreeKeyType keyType, uint32 *hash)
+{
+	BTreeDescr *desc = context->desc;
+	LookupCacheEntry *entry;
+	BTreePageItemLocator loc;
+	Page		img = context->img;
+	OTuple		firstTuple;
+
+	*hash = 0;
+	if (lookup_cache_size == 0 || desc->ops->key_hash == NULL ||
+		!desc->ops->key_hash(desc, key, keyType, hash))
+		return false;
+
+	/* Zero hash is reserved for the keys not cached */
+	if (*hash == 0)
+		*hash = 1;
+
+	entry = get_cache_entry(desc, *hash);
+	if (entry == NULL ||
+		entry->hash != *hash ||
+		!ORelOidsIsEqual(entry->oids, desc->oids) ||
+		!OInMemoryBlknoIsValid(entry->blkno))
+		return false;
+
+	refind_page(context, key, keyType, 0, entry->blkno,
+				entry->pageChangeCount);
+
+	if (!O_PAGE_IS(img, LEFTMOST))
+	{
+		BTREE_PAGE_LOCATOR_FIRST(img, &loc);
+		if (!BTREE_PAGE_LOCATOR_IS_VALID(img, &loc) ||
+			!partial_load_chunk(&context->partial, img, loc.chunkOffset))
+			return false;
+		BTREE_PAGE_READ_TUPLE(firstTuple, img, &loc);
+		if (o_btree_cmp(desc, key, keyType,
+						&firstTuple, BTreeKeyLeafTuple) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Remembers the leaf page found by the regular search for the key with
+ * given hash.
+ */
+void
+lookup_cache_remember(OBTreeFindPageContext *context, uint32 hash)
+{
+	BTreeDescr *desc = context->desc;
+	LookupCacheEntry *entry;
+
+	if (hash == 0)
+		return;
+
+	entry = get_cache_entry(desc, hash);
+	if (entry == NULL)
+		return;
+
+	entry->oids = desc->oids;
+	entry->hash = hash;
+	entry->blkno = context->items[context->index].blkno;
+	entry->pageChangeCount = context->items[context->index].pageChangeCount;
+}
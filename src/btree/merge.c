@@ -20,6 +20,7 @@
 #include "btree/page_chunks.h"
 #include "btree/undo.h"
 #include "checkpoint/checkpoint.h"
+#include "utils/o_probes.h"
 #include "utils/page_pool.h"
 #include "transam/undo.h"
 
@@ -149,6 +150,8 @@ btree_try_merge_pages(BTreeDescr *desc,
 	 * It contains the required memory barrier between making undo image and
 	 * setting the undo location.
 	 */
+	TRACE_ORIOLEDB_PAGE_MERGE(desc->oids.datoid, desc->oids.relnode,
+							  left_blkno, right_blkno);
 	merge_pages(desc, left_blkno, right, csn);
 	btree_page_update_max_key_len(desc, left);
 	MARK_DIRTY(desc->ppool, left_blkno);
@@ -173,9 +176,11 @@ btree_try_merge_pages(BTreeDescr *desc,
 	O_PAGE_CHANGE_COUNT_INC(right);
 
 	ppool_free_page(desc->ppool, right_blkno, true);
+	pg_atomic_fetch_sub_u32(&BTREE_GET_META(desc)->numResidentPages, 1);
 
 	if (O_PAGE_IS(left, LEAF))
 		pg_atomic_fetch_sub_u32(&BTREE_GET_META(desc)->leafPagesNum, 1);
+	pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->numMerges, 1);
 
 	END_CRIT_SECTION();
 
@@ -17,13 +17,16 @@
 #include "btree/find.h"
 #include "btree/insert.h"
 #include "btree/io.h"
+#include "btree/iterator.h"
 #include "btree/merge.h"
 #include "btree/modify.h"
 #include "btree/page_chunks.h"
+#include "btree/range_lock.h"
 #include "btree/undo.h"
 #include "catalog/o_tables.h"
 #include "recovery/recovery.h"
 #include "recovery/wal.h"
+#include "tableam/summary.h"
 #include "transam/undo.h"
 #include "transam/oxid.h"
 #include "utils/page_pool.h"
@@ -335,6 +338,7 @@ retry:
 				}
 			}
 			context.replace = true;
+			TREE_ADD_TUPLES(desc, 1);
 		}
 		else
 		{
@@ -629,6 +633,7 @@ o_btree_modify_handle_tuple_not_found(BTreeModifyInternalContext *context)
 
 		o_btree_modify_insert_update(context);
 		unlock_release(context, false);
+		TREE_ADD_TUPLES(context->pageFindContext->desc, 1);
 		return OBTreeModifyResultInserted;
 	}
 }
@@ -772,6 +777,7 @@ o_btree_modify_delete(BTreeModifyInternalContext *context)
 		{
 			/* Already deleted */
 			unlock_release(context, true);
+			TREE_ADD_TUPLES(desc, -1);
 
 			return OBTreeModifyResultDeleted;
 		}
@@ -833,6 +839,8 @@ o_btree_modify_delete(BTreeModifyInternalContext *context)
 
 	END_CRIT_SECTION();
 
+	TREE_ADD_TUPLES(desc, -1);
+
 	if (!OXidIsValid(context->opOxid) && is_page_too_sparse(desc, page))
 	{
 		(void) btree_try_merge_and_unlock(desc, blkno, false, false);
@@ -932,6 +940,107 @@ prepare_modify_start_params(BTreeDescr *desc)
 	return res;
 }
 
+/*
+ * Tries to locate the leaf page for insertion starting from the given
+ * in-memory location without descending the tree.  The page is accepted if
+ * the key is greater than its first item, so the insertion can't belong to
+ * the left of it.  With 'rightmost' set, the page also must be still
+ * rightmost.  Returns true if the page is found and locked.  Otherwise, the
+ * page is unlocked.
+ */
+static bool
+o_btree_find_leaf_by_location(OBTreeFindPageContext *context,
+							  Pointer key, BTreeKeyType keyType,
+							  OInMemoryBlkno hintBlkno,
+							  uint32 hintChangeCount,
+							  bool rightmost)
+{
+	BTreeDescr *desc = context->desc;
+	BTreePageItemLocator loc;
+	OInMemoryBlkno blkno;
+	OTuple		firstTuple;
+	Page		p;
+
+	refind_page(context, key, keyType, 0, hintBlkno, hintChangeCount);
+
+	blkno = context->items[context->index].blkno;
+	p = O_GET_IN_MEMORY_PAGE(blkno);
+
+	if (!rightmost || O_PAGE_IS(p, RIGHTMOST))
+	{
+		BTREE_PAGE_LOCATOR_FIRST(p, &loc);
+		if (BTREE_PAGE_LOCATOR_IS_VALID(p, &loc))
+		{
+			BTREE_PAGE_READ_TUPLE(firstTuple, p, &loc);
+			if (o_btree_cmp(desc, key, keyType,
+							&firstTuple, BTreeKeyLeafTuple) > 0)
+				return true;
+		}
+	}
+
+	unlock_page(blkno);
+	return false;
+}
+
+/*
+ * Fast path for ascending inserts.  Try to locate the cached rightmost leaf
+ * without descending the tree.  Returns true if the page is found and locked.
+ */
+static bool
+o_btree_find_rightmost_leaf(OBTreeFindPageContext *context,
+							Pointer key, BTreeKeyType keyType)
+{
+	BTreeDescr *desc = context->desc;
+
+	if (!OInMemoryBlknoIsValid(desc->rightmostLeafBlkno))
+		return false;
+
+	if (o_btree_find_leaf_by_location(context, key, keyType,
+									  desc->rightmostLeafBlkno,
+									  desc->rightmostLeafChangeCount,
+									  true))
+		return true;
+
+	/* The page doesn't fit, fallback to the regular search */
+	desc->rightmostLeafBlkno = OInvalidInMemoryBlkno;
+	return false;
+}
+
+/*
+ * Remembers the leaf page found for insertion if it's the rightmost one.
+ */
+static void
+o_btree_remember_rightmost_leaf(OBTreeFindPageContext *context)
+{
+	BTreeDescr *desc = context->desc;
+	OInMemoryBlkno blkno = context->items[context->index].blkno;
+	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+
+	if (O_PAGE_IS(p, RIGHTMOST))
+	{
+		desc->rightmostLeafBlkno = blkno;
+		desc->rightmostLeafChangeCount = O_PAGE_GET_CHANGE_COUNT(p);
+	}
+	else if (desc->rightmostLeafBlkno == blkno)
+	{
+		desc->rightmostLeafBlkno = OInvalidInMemoryBlkno;
+	}
+}
+
+/*
+ * Counts the modification in the tree statistics.  Row locks aren't counted.
+ */
+static inline void
+o_btree_modify_count_op(BTreeDescr *desc, BTreeOperationType action)
+{
+	if (action == BTreeOperationInsert)
+		o_btree_count_op(desc, BTreeStatInsert);
+	else if (action == BTreeOperationUpdate)
+		o_btree_count_op(desc, BTreeStatUpdate);
+	else if (action == BTreeOperationDelete)
+		o_btree_count_op(desc, BTreeStatDelete);
+}
+
 static OBTreeModifyResult
 o_btree_normal_modify(BTreeDescr *desc, BTreeOperationType action,
 					  OTuple tuple, BTreeKeyType tupleType,
@@ -943,12 +1052,15 @@ o_btree_normal_modify(BTreeDescr *desc, BTreeOperationType action,
 {
 	OBTreeFindPageContext pageFindContext;
 	int			pageReserveKind;
+	OBTreeModifyResult result;
 	Jsonb	   *params = NULL;
 
 	if (STOPEVENTS_ENABLED())
 		params = prepare_modify_start_params(desc);
 	STOPEVENT(STOPEVENT_MODIFY_START, params);
 
+	o_btree_modify_count_op(desc, action);
+
 	/* No no key is separately given, use the tuple itself */
 	if (key == NULL)
 	{
@@ -970,15 +1082,52 @@ o_btree_normal_modify(BTreeDescr *desc, BTreeOperationType action,
 	init_page_find_context(&pageFindContext, desc, COMMITSEQNO_INPROGRESS,
 						   BTREE_PAGE_FIND_MODIFY | BTREE_PAGE_FIND_FIX_LEAF_SPLIT);
 
-	if (hint && OInMemoryBlknoIsValid(hint->blkno))
+	if (action == BTreeOperationInsert)
+	{
+		/*
+		 * The insertion hint is only a guess left by the previous insertion
+		 * of a sorted batch, so it's checked against the page contents.
+		 */
+		if (!(hint && OInMemoryBlknoIsValid(hint->blkno) &&
+			  o_btree_find_leaf_by_location(&pageFindContext, key, keyType,
+											hint->blkno,
+											hint->pageChangeCount,
+											false)) &&
+			!o_btree_find_rightmost_leaf(&pageFindContext, key, keyType))
+			(void) find_page(&pageFindContext, key, keyType, 0);
+
+		o_btree_remember_rightmost_leaf(&pageFindContext);
+
+		if (hint)
+		{
+			OInMemoryBlkno blkno = pageFindContext.items[pageFindContext.index].blkno;
+
+			hint->blkno = blkno;
+			hint->pageChangeCount = O_PAGE_GET_CHANGE_COUNT(O_GET_IN_MEMORY_PAGE(blkno));
+		}
+	}
+	else if (hint && OInMemoryBlknoIsValid(hint->blkno))
 		refind_page(&pageFindContext, key, keyType, 0, hint->blkno, hint->pageChangeCount);
 	else
 		(void) find_page(&pageFindContext, key, keyType, 0);
 
-	return o_btree_modify_internal(&pageFindContext, action, tuple, tupleType,
-								   key, keyType, opOxid, opCsn,
-								   lockMode, deleted, pageReserveKind,
-								   callbackInfo);
+	result = o_btree_modify_internal(&pageFindContext, action, tuple, tupleType,
+									 key, keyType, opOxid, opCsn,
+									 lockMode, deleted, pageReserveKind,
+									 callbackInfo);
+
+	if (action == BTreeOperationInsert &&
+		(result == OBTreeModifyResultInserted ||
+		 result == OBTreeModifyResultUpdated))
+		o_range_lock_check_insert(desc, key, keyType, opOxid);
+
+	if ((action == BTreeOperationInsert || action == BTreeOperationUpdate) &&
+		tupleType == BTreeKeyLeafTuple &&
+		(result == OBTreeModifyResultInserted ||
+		 result == OBTreeModifyResultUpdated))
+		o_summary_add_tuple(desc, tuple);
+
+	return result;
 }
 
 static bool
@@ -1084,6 +1233,8 @@ o_btree_insert_unique(BTreeDescr *desc, OTuple tuple, BTreeKeyType tupleType,
 		params = prepare_modify_start_params(desc);
 	STOPEVENT(STOPEVENT_MODIFY_START, params);
 
+	o_btree_count_op(desc, BTreeStatInsert);
+
 	Assert(key != NULL && keyType == BTreeKeyBound);
 
 	if (desc->undoType != UndoReserveNone)
@@ -1294,6 +1445,15 @@ retry:
 									 callbackInfo);
 
 	LWLockRelease(uniqueLock);
+
+	if (result == OBTreeModifyResultInserted ||
+		result == OBTreeModifyResultUpdated)
+	{
+		o_range_lock_check_insert(desc, key, keyType, opOxid);
+		if (tupleType == BTreeKeyLeafTuple)
+			o_summary_add_tuple(desc, tuple);
+	}
+
 	return result;
 }
 
@@ -1309,6 +1469,54 @@ o_btree_modify(BTreeDescr *desc, BTreeOperationType action,
 								 hint, BTreeLeafTupleNonDeleted, callbackInfo);
 }
 
+/*
+ * Deletes all the tuples visible for `csn` within the key range from `low`
+ * to `high` (both inclusive).  Leaf pages are visited once by the iterator,
+ * and each tuple is then deleted using the location hint of its leaf page.
+ * So, the tree isn't descended from the root for every tuple.  Returns the
+ * number of deleted tuples.
+ */
+int64
+o_btree_delete_range(BTreeDescr *desc, Pointer low, Pointer high,
+					 BTreeKeyType keyType, OXid oxid, CommitSeqNo csn,
+					 BTreeModifyCallbackInfo *callbackInfo)
+{
+	BTreeIterator *it;
+	BTreeLocationHint hint = {OInvalidInMemoryBlkno, 0};
+	OTuple		nullTup;
+	int64		count = 0;
+
+	O_TUPLE_SET_NULL(nullTup);
+
+	it = o_btree_iterator_create(desc, low, keyType, csn,
+								 ForwardScanDirection);
+
+	while (true)
+	{
+		OTuple		tuple;
+		OBTreeModifyResult result;
+
+		tuple = o_btree_iterator_fetch(it, NULL, high, keyType, true, &hint);
+		if (O_TUPLE_IS_NULL(tuple))
+			break;
+
+		result = o_btree_normal_modify(desc, BTreeOperationDelete,
+									   nullTup, BTreeKeyNone,
+									   (Pointer) &tuple, BTreeKeyLeafTuple,
+									   oxid, csn, RowLockUpdate, &hint,
+									   BTreeLeafTupleNonDeleted, callbackInfo);
+		if (result == OBTreeModifyResultDeleted)
+			count++;
+
+		pfree(tuple.data);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	btree_iterator_free(it);
+
+	return count;
+}
+
 OBTreeModifyResult
 o_btree_delete_moved_partitions(BTreeDescr *desc, Pointer key,
 								BTreeKeyType keyType, OXid oxid,
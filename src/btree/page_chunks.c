@@ -28,10 +28,28 @@
 #include "miscadmin.h"
 #include "utils/memdebug.h"
 
+/*
+ * Page access statistics are sampled: only every PAGE_ACCESS_SAMPLE_RATE-th
+ * access of the backend touches the shared counters.  Reads are counted in
+ * the low half of accessStats, writes in the high half.  Both halves are
+ * divided by two once any of them reaches PAGE_ACCESS_COUNT_MAX, so the
+ * statistics reflect the recent workload.
+ */
+#define PAGE_ACCESS_SAMPLE_RATE			8
+#define PAGE_ACCESS_COUNT_MAX			0x4000
+#define PAGE_ACCESS_READ_ONE			((uint32) 1)
+#define PAGE_ACCESS_WRITE_ONE			((uint32) 1 << 16)
+#define PAGE_ACCESS_GET_READS(s)		((s) & 0xFFFF)
+#define PAGE_ACCESS_GET_WRITES(s)		((s) >> 16)
+#define PAGE_ACCESS_MIN_SAMPLES			8
+#define PAGE_ACCESS_READ_MOSTLY_RATIO	8
+
+static uint32 pageAccessCounter = 0;
+
 static void reclaim_page_space(BTreeDescr *desc, Pointer p, CommitSeqNo csn,
 							   BTreePageItemLocator *location,
 							   OTuple tuple, LocationIndex tuplesize,
-							   bool replace);
+							   bool replace, OPageChunksLayout layout);
 
 /*
  * Load chunk to the partial page.
@@ -160,6 +178,74 @@ page_locator_fits_item(BTreeDescr *desc, Page p, BTreePageItemLocator *locator,
 	}
 }
 
+/*
+ * Account read or write access to the page.
+ */
+void
+page_chunks_count_access(OInMemoryBlkno blkno, bool write)
+{
+	pg_atomic_uint32 *stats;
+	uint32		state;
+
+	if (++pageAccessCounter % PAGE_ACCESS_SAMPLE_RATE != 0)
+		return;
+
+	stats = &O_GET_IN_MEMORY_PAGEDESC(blkno)->accessStats;
+	state = pg_atomic_add_fetch_u32(stats, write ? PAGE_ACCESS_WRITE_ONE :
+									PAGE_ACCESS_READ_ONE);
+
+	while (PAGE_ACCESS_GET_READS(state) >= PAGE_ACCESS_COUNT_MAX ||
+		   PAGE_ACCESS_GET_WRITES(state) >= PAGE_ACCESS_COUNT_MAX)
+	{
+		uint32		newState;
+
+		newState = (PAGE_ACCESS_GET_READS(state) / 2) |
+			((PAGE_ACCESS_GET_WRITES(state) / 2) << 16);
+		if (pg_atomic_compare_exchange_u32(stats, &state, newState))
+			break;
+	}
+}
+
+/*
+ * Choose the chunks layout for the page according to its access statistics.
+ */
+OPageChunksLayout
+page_chunks_get_layout(OInMemoryBlkno blkno)
+{
+	uint32		state,
+				reads,
+				writes;
+
+	state = pg_atomic_read_u32(&O_GET_IN_MEMORY_PAGEDESC(blkno)->accessStats);
+	reads = PAGE_ACCESS_GET_READS(state);
+	writes = PAGE_ACCESS_GET_WRITES(state);
+
+	if (reads + writes < PAGE_ACCESS_MIN_SAMPLES)
+		return OPageChunksLayoutDefault;
+	if (reads >= writes * PAGE_ACCESS_READ_MOSTLY_RATIO)
+		return OPageChunksLayoutReadMostly;
+	if (writes >= reads)
+		return OPageChunksLayoutWriteHot;
+	return OPageChunksLayoutDefault;
+}
+
+/*
+ * Multiplier for the minimal chunk size.
+ */
+static inline float4
+page_chunks_layout_factor(OPageChunksLayout layout)
+{
+	switch (layout)
+	{
+		case OPageChunksLayoutReadMostly:
+			return 0.5f;
+		case OPageChunksLayoutWriteHot:
+			return 2.0f;
+		default:
+			return 1.0f;
+	}
+}
+
 void
 perform_page_compaction(BTreeDescr *desc, OInMemoryBlkno blkno,
 						BTreePageItemLocator *loc, OTuple tuple,
@@ -170,6 +256,8 @@ perform_page_compaction(BTreeDescr *desc, OInMemoryBlkno blkno,
 	BTreePageHeader *header = (BTreePageHeader *) p;
 	UndoLocation undoLocation;
 
+	pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->numCompactions, 1);
+
 	START_CRIT_SECTION();
 
 	Assert(O_PAGE_IS(p, LEAF));
@@ -204,7 +292,8 @@ perform_page_compaction(BTreeDescr *desc, OInMemoryBlkno blkno,
 		csn = COMMITSEQNO_INPROGRESS;
 	}
 
-	reclaim_page_space(desc, p, csn, loc, tuple, tuplesize, replace);
+	reclaim_page_space(desc, p, csn, loc, tuple, tuplesize, replace,
+					   page_chunks_get_layout(blkno));
 	Assert(header->dataSize <= ORIOLEDB_BLCKSZ);
 
 	END_CRIT_SECTION();
@@ -217,7 +306,7 @@ static void
 reclaim_page_space(BTreeDescr *desc, Pointer p, CommitSeqNo csn,
 				   BTreePageItemLocator *location,
 				   OTuple tuple, LocationIndex tuplesize,
-				   bool replace)
+				   bool replace, OPageChunksLayout layout)
 {
 	BTreePageItemLocator loc;
 	BTreePageItem items[BTREE_PAGE_MAX_CHUNK_ITEMS];
@@ -301,7 +390,8 @@ reclaim_page_space(BTreeDescr *desc, Pointer p, CommitSeqNo csn,
 		copy_fixed_hikey(desc, &hikey, p);
 		hikeySize = BTREE_PAGE_GET_HIKEY_SIZE(p);
 	}
-	btree_page_reorg(desc, p, items, i, hikeySize, hikey.tuple, location);
+	btree_page_reorg_layout(desc, p, items, i, hikeySize, hikey.tuple,
+							location, layout);
 	PAGE_SET_N_VACATED(p, nVacated);
 }
 
@@ -930,7 +1020,8 @@ page_split_chunk(Page p, BTreePageItemLocator *locator,
 	((MAXIMUM_ALIGNOF - 1) - ((s) + (MAXIMUM_ALIGNOF - 1)) % (MAXIMUM_ALIGNOF))
 
 void
-page_split_chunk_if_needed(BTreeDescr *desc, Page p, BTreePageItemLocator *locator)
+page_split_chunk_if_needed(BTreeDescr *desc, Page p, BTreePageItemLocator *locator,
+						   OPageChunksLayout layout)
 {
 	OffsetNumber i,
 				chunkOffset;
@@ -953,7 +1044,8 @@ page_split_chunk_if_needed(BTreeDescr *desc, Page p, BTreePageItemLocator *locat
 	chunkOffset = locator->chunkOffset;
 
 	if ((float4) locator->chunkSize / (float4) (ORIOLEDB_BLCKSZ - hikeysEnd) <
-		(float4) MAXALIGN(header->maxKeyLen) * 2.0f / (float4) (hikeysEnd - offsetof(BTreePageHeader, chunkDesc)))
+		(float4) MAXALIGN(header->maxKeyLen) * 2.0f * page_chunks_layout_factor(layout) /
+		(float4) (hikeysEnd - offsetof(BTreePageHeader, chunkDesc)))
 		return;
 
 	hikeysFreeSpace = hikeysEnd - header->hikeysEnd;
@@ -1125,6 +1217,20 @@ void
 btree_page_reorg(BTreeDescr *desc, Page p, BTreePageItem *items,
 				 OffsetNumber count, LocationIndex hikeySize, OTuple hikey,
 				 BTreePageItemLocator *newLoc)
+{
+	btree_page_reorg_layout(desc, p, items, count, hikeySize, hikey, newLoc,
+							OPageChunksLayoutDefault);
+}
+
+/*
+ * The same as btree_page_reorg(), but the chunk sizes are adjusted according
+ * to the layout hint.
+ */
+void
+btree_page_reorg_layout(BTreeDescr *desc, Page p, BTreePageItem *items,
+						OffsetNumber count, LocationIndex hikeySize,
+						OTuple hikey, BTreePageItemLocator *newLoc,
+						OPageChunksLayout layout)
 {
 	int			chunksCount;
 	LocationIndex totalDataSize,
@@ -1145,6 +1251,7 @@ btree_page_reorg(BTreeDescr *desc, Page p, BTreePageItem *items,
 	bool		isRightmost = O_PAGE_IS(p, RIGHTMOST);
 	LocationIndex chunkDataSize;
 	LocationIndex maxKeyLen;
+	float4		factor = page_chunks_layout_factor(layout);
 
 	VALGRIND_CHECK_MEM_IS_DEFINED(p, ORIOLEDB_BLCKSZ);
 	VALGRIND_MAKE_MEM_DEFINED(p, ORIOLEDB_BLCKSZ);
@@ -1194,8 +1301,8 @@ btree_page_reorg(BTreeDescr *desc, Page p, BTreePageItem *items,
 		}
 
 		dataSizeRatio = (float4) chunkDataSize / (float4) totalDataSize;
-		if (dataSizeRatio >= (float4) (nextKeySize + sizeof(BTreePageChunkDesc)) / (float4) hikeysFreeSpace &&
-			dataSizeRatio >= (float4) dataSpaceDiff / (float4) dataFreeSpace)
+		if (dataSizeRatio >= factor * (float4) (nextKeySize + sizeof(BTreePageChunkDesc)) / (float4) hikeysFreeSpace &&
+			dataSizeRatio >= factor * (float4) dataSpaceDiff / (float4) dataFreeSpace)
 		{
 			hikeysFreeSpaceLeft -= hikeySizeDiff;
 			dataFreeSpaceLeft -= dataSpaceDiff;
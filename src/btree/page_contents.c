@@ -17,6 +17,7 @@
 #include "btree/find.h"
 #include "btree/page_chunks.h"
 #include "btree/undo.h"
+#include "btree/undo_image_cache.h"
 #include "recovery/recovery.h"
 #include "tableam/descr.h"
 #include "transam/oxid.h"
@@ -25,6 +26,7 @@
 #include "utils/ucm.h"
 
 #include "access/transam.h"
+#include "common/hashfn.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/proc.h"
@@ -42,17 +44,27 @@ read_page_from_undo(BTreeDescr *desc, Page img, UndoLocation undo_loc,
 					OFixedKey *lokey)
 {
 	BTreePageHeader *header;
-	CommitSeqNo page_csn;
-	UndoLocation rec_undo_location;
-	bool		is_left = true;
+	CommitSeqNo page_csn,
+				csn_high = COMMITSEQNO_MAX_NORMAL;
+	UndoLocation rec_undo_location,
+				start_undo_loc = undo_loc;
+	bool		is_left = true,
+				is_right = true,
+				single_pages = true;
 
 	Assert(UndoLocationIsValid(undo_loc));
 
+	/* Another reader might already walk the same chain for us */
+	rec_undo_location = undo_image_cache_get(undo_loc, csn, img);
+	if (UndoLocationIsValid(rec_undo_location))
+		return O_UNDO_GET_IMAGE_LOCATION(rec_undo_location, true);
+
 	while (true)
 	{
 		/* Read page image from page-level undo item */
 		get_page_from_undo(desc, undo_loc, key, keyType, img,
-						   &is_left, NULL, lokey, NULL, NULL);
+						   &is_left, &is_right, lokey, NULL, NULL);
+		single_pages = single_pages && is_left && is_right;
 
 		header = (BTreePageHeader *) img;
 		page_csn = header->csn;
@@ -64,6 +76,7 @@ read_page_from_undo(BTreeDescr *desc, Page img, UndoLocation undo_loc,
 		/* Continue traversing undo chain if needed */
 		if (COMMITSEQNO_IS_NORMAL(page_csn) && page_csn >= csn)
 		{
+			csn_high = Min(csn_high, page_csn);
 			undo_loc = rec_undo_location;
 			continue;
 		}
@@ -76,6 +89,11 @@ read_page_from_undo(BTreeDescr *desc, Page img, UndoLocation undo_loc,
 	/* Page-level undo item should be retained */
 	Assert(UNDO_REC_EXISTS(undo_loc));
 
+	if (single_pages && COMMITSEQNO_IS_NORMAL(csn))
+		undo_image_cache_put(start_undo_loc,
+							 COMMITSEQNO_IS_NORMAL(page_csn) ? page_csn : 0,
+							 csn_high, img, undo_loc);
+
 	return O_UNDO_GET_IMAGE_LOCATION(undo_loc, is_left);
 }
 
@@ -136,12 +154,17 @@ try_copy_page(OInMemoryBlkno blkno, uint32 pageChangeCount, Page dest,
 	page_inc_usage_count(ucm, blkno,
 						 pg_atomic_read_u32(&((OrioleDBPageHeader *) dest)->usageCount),
 						 false);
+	page_chunks_count_access(blkno, false);
 
 	return ReadPageResultOK;
 }
 
 /*
  * Copy consistent image of page with page number = blkno to dest.
+ *
+ * The copy is optimistic: it's validated by the page state change count and
+ * retried on mismatch.  We first spin on the page state for a while, and only
+ * join the page wait list if the writer holds the page for too long.
  */
 static inline void
 copy_page(OInMemoryBlkno blkno, Page dest, PartialPageState *partial,
@@ -150,7 +173,8 @@ copy_page(OInMemoryBlkno blkno, Page dest, PartialPageState *partial,
 	while (try_copy_page(blkno, InvalidOPageChangeCount, dest,
 						 partial, readCsn) != ReadPageResultOK)
 	{
-		(void) page_wait_for_read_enable(blkno);
+		if (!page_spin_for_read_enable(blkno))
+			page_wait_for_read_enable(blkno);
 	}
 }
 
@@ -318,6 +342,51 @@ o_btree_try_read_page(BTreeDescr *desc, OInMemoryBlkno blkno, uint32 pageChangeC
 	return ReadPageResultOK;
 }
 
+/*
+ * Returns the key of the tree page located at the given file offset for the
+ * ghost history of the page pool.
+ */
+uint32
+btree_page_ghost_key(BTreeDescr *desc, uint64 off)
+{
+	uint32		key;
+
+	key = hash_bytes((const unsigned char *) &desc->oids, sizeof(ORelOids));
+	key = hash_combine(key, (uint32) desc->type);
+	key = hash_combine(key, hash_bytes_uint32((uint32) off));
+	key = hash_combine(key, hash_bytes_uint32((uint32) (off >> 32)));
+	return key != 0 ? key : 1;
+}
+
+/*
+ * Returns the usage count for the page just loaded or created in the tree
+ * according to the tree page pool usage settings.  'ghostKey' is the key of
+ * the loaded page for the ghost history or zero for the created page.
+ */
+uint32
+btree_page_initial_usage_count(BTreeDescr *desc, uint32 ghostKey)
+{
+	UsageCountMap *ucm = &desc->ppool->ucm;
+	uint32		epoch = pg_atomic_read_u32(ucm->epoch);
+
+	/*
+	 * On hot standby, pages loaded by the queries are evicted first, so they
+	 * don't push out the pages used by the replay.
+	 */
+	if (desc->buffersPriority == OBuffersPriorityLow ||
+		(standby_reads_low_priority && !is_recovery_process() &&
+		 RecoveryInProgress()) ||
+		(desc->buffersMaxPercent > 0 &&
+		 (uint64) pg_atomic_read_u32(&BTREE_GET_META(desc)->numResidentPages) * 100 >
+		 (uint64) desc->ppool->size * desc->buffersMaxPercent))
+		return (epoch + 1) % UCM_USAGE_LEVELS;
+
+	if (desc->buffersPriority == OBuffersPriorityHigh)
+		return (epoch + UCM_USAGE_LEVELS - 2) % UCM_USAGE_LEVELS;
+
+	return ppool_loaded_page_usage_count(desc->ppool, ghostKey);
+}
+
 void
 init_new_btree_page(BTreeDescr *desc, OInMemoryBlkno blkno, uint16 flags,
 					uint16 level, bool noLock)
@@ -355,7 +424,9 @@ init_new_btree_page(BTreeDescr *desc, OInMemoryBlkno blkno, uint16 flags,
 	header->prevInsertOffset = MaxOffsetNumber;
 	header->maxKeyLen = 0;
 	page_change_usage_count(&desc->ppool->ucm, blkno,
-							(pg_atomic_read_u32(desc->ppool->ucm.epoch) + 2) % UCM_USAGE_LEVELS);
+							btree_page_initial_usage_count(desc, 0));
+	if (blkno != desc->rootInfo.rootPageBlkno)
+		pg_atomic_fetch_add_u32(&BTREE_GET_META(desc)->numResidentPages, 1);
 
 	memset(p + offsetof(BTreePageHeader, chunkDesc),
 		   0,
@@ -373,9 +444,29 @@ init_meta_page(OInMemoryBlkno blkno, uint32 leafPagesNum)
 
 	memset(p + O_PAGE_HEADER_SIZE, 0, ORIOLEDB_BLCKSZ - O_PAGE_HEADER_SIZE);
 	pg_atomic_init_u32(&metaPageBlkno->leafPagesNum, leafPagesNum);
+	pg_atomic_init_u64(&metaPageBlkno->numTuples, 0);
+	pg_atomic_init_u32(&metaPageBlkno->numResidentPages, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numLoadedPages, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numEvictedPages, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numFindHits, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numFindMisses, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numCheckpointPages, 0);
+	pg_atomic_init_u64(&metaPageBlkno->checkpointTime, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numLookups, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numInserts, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numUpdates, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numDeletes, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numSplits, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numMerges, 0);
+	pg_atomic_init_u64(&metaPageBlkno->numCompactions, 0);
+	pg_atomic_init_u64(&metaPageBlkno->evictionBytes, 0);
+	pg_atomic_init_u64(&metaPageBlkno->checkpointBytes, 0);
+	pg_atomic_init_u64(&metaPageBlkno->undoBytes, 0);
 	pg_atomic_init_u64(&metaPageBlkno->numFreeBlocks, 0);
 	pg_atomic_init_u64(&metaPageBlkno->datafileLength[0], 0);
 	pg_atomic_init_u64(&metaPageBlkno->datafileLength[1], 0);
+	/* we don't know what was written before the tree was loaded */
+	pg_atomic_init_u64(&metaPageBlkno->dirtySegments, PG_UINT64_MAX);
 	pg_atomic_init_u64(&metaPageBlkno->ctid, 0);
 	for (i = 0; i < NUM_SEQ_SCANS_ARRAY_SIZE; i++)
 		pg_atomic_init_u32(&metaPageBlkno->numSeqScans[i], 0);
@@ -384,6 +475,10 @@ init_meta_page(OInMemoryBlkno blkno, uint32 leafPagesNum)
 					 checkpoint_state->copyBlknoTrancheId);
 	LWLockInitialize(&metaPageBlkno->metaLock,
 					 checkpoint_state->oMetaTrancheId);
+	LWLockInitialize(&metaPageBlkno->extendLock,
+					 checkpoint_state->oMetaTrancheId);
+	for (i = 0; i < FREE_EXTENTS_CACHE_PARTITIONS; i++)
+		SpinLockInit(&metaPageBlkno->freeExtentsCache[i].lock);
 
 	page_desc->type = oIndexInvalid;
 	page_desc->oids.datoid = InvalidOid;
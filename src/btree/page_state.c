@@ -22,6 +22,7 @@
 #include "tableam/descr.h"
 #include "transam/oxid.h"
 #include "transam/undo.h"
+#include "utils/o_wait_events.h"
 #include "utils/page_pool.h"
 #include "utils/stopevent.h"
 #include "utils/ucm.h"
@@ -277,10 +278,12 @@ lock_page(OInMemoryBlkno blkno)
 	OrioleDBPageHeader *header = (OrioleDBPageHeader *) p;
 	uint32		prevState;
 	int			extraWaits = 0;
+	instr_time	waitStart;
 
 	Assert(get_my_locked_page_index(blkno) < 0);
 
 	EA_LOCK_INC(blkno);
+	INSTR_TIME_SET_ZERO(waitStart);
 
 	page_inc_usage_count(ucm, blkno,
 						 pg_atomic_read_u32(&header->usageCount), false);
@@ -307,7 +310,9 @@ lock_page(OInMemoryBlkno blkno)
 			}
 		}
 
-		pgstat_report_wait_start(PG_WAIT_LWLOCK | LWTRANCHE_BUFFER_CONTENT);
+		if (ea_counters != NULL)
+			INSTR_TIME_SET_CURRENT(waitStart);
+		pgstat_report_wait_start(o_wait_event_info(OWaitEventPageLock));
 
 		for (;;)
 		{
@@ -318,6 +323,7 @@ lock_page(OInMemoryBlkno blkno)
 		}
 
 		pgstat_report_wait_end();
+		EA_LOCK_WAIT_ADD(blkno, waitStart);
 	}
 
 	my_locked_page_add(blkno, prevState | PAGE_STATE_LOCKED_FLAG);
@@ -329,6 +335,28 @@ lock_page(OInMemoryBlkno blkno)
 		PGSemaphoreUnlock(MyProc->sem);
 }
 
+/*
+ * Optimistically wait for the page to become readable by spinning on its
+ * state.  Unlike page_wait_for_read_enable(), it never modifies the page
+ * state nor joins the page wait list, so concurrent readers of a hot page
+ * don't contend on its cache line.  Returns false if the page is still
+ * read-blocked after O_PAGE_OPTIMISTIC_READ_SPINS iterations.
+ */
+bool
+page_spin_for_read_enable(OInMemoryBlkno blkno)
+{
+	OrioleDBPageHeader *header = (OrioleDBPageHeader *) O_GET_IN_MEMORY_PAGE(blkno);
+	int			i;
+
+	for (i = 0; i < O_PAGE_OPTIMISTIC_READ_SPINS; i++)
+	{
+		if (!O_PAGE_STATE_READ_IS_BLOCKED(pg_atomic_read_u32(&header->state)))
+			return true;
+		pg_spin_delay();
+	}
+	return false;
+}
+
 void
 page_wait_for_read_enable(OInMemoryBlkno blkno)
 {
@@ -356,7 +384,7 @@ page_wait_for_read_enable(OInMemoryBlkno blkno)
 			return;
 		}
 
-		pgstat_report_wait_start(PG_WAIT_LWLOCK | LWTRANCHE_BUFFER_CONTENT);
+		pgstat_report_wait_start(o_wait_event_info(OWaitEventPageReadEnable));
 
 		for (;;)
 		{
@@ -412,7 +440,7 @@ page_wait_for_changecount(OInMemoryBlkno blkno, uint32 state)
 			return dequeue_self(blkno);
 		}
 
-		pgstat_report_wait_start(PG_WAIT_LWLOCK | LWTRANCHE_BUFFER_CONTENT);
+		pgstat_report_wait_start(o_wait_event_info(OWaitEventPageChangeCount));
 
 		for (;;)
 		{
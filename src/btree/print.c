@@ -243,7 +243,9 @@ print_page_contents_recursive(BTreeDescr *desc, OInMemoryBlkno blkno,
 			break;
 	}
 
-	if (OCompressIsValid(desc->compress))
+	if (OCompressIsLZ4(desc->compress))
+		appendStringInfo(outbuf, ", compression = lz4");
+	else if (OCompressIsValid(desc->compress))
 		appendStringInfo(outbuf, ", compression = %d", desc->compress);
 
 	if (IS_DIRTY(blkno))
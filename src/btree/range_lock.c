@@ -0,0 +1,353 @@
+/*-------------------------------------------------------------------------
+ *
+ * range_lock.c
+ *		B-tree key-range locks.
+ *
+ * A key-range lock protects the range of the primary key values from the
+ * insertions by concurrent transactions.  That covers the "insert if absent"
+ * patterns: once the range is locked and checked to be empty, nobody else can
+ * insert there until the locker commits or aborts.
+ *
+ * The locks live in the fixed shared array sized by orioledb.max_range_locks.
+ * Acquiring the lock and checking the insertion follows the Dekker-like
+ * protocol.  The locker first publishes the lock, then scans the range and
+ * waits for every in-progress insertion it meets.  The inserter first inserts
+ * the tuple, then checks the published locks and waits for every locker
+ * covering the key.  So, at least one of them sees the other.  Both wait via
+ * wait_for_oxid(), so mutual waits are resolved by the PostgreSQL deadlock
+ * detector and lock_timeout applies.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/btree/range_lock.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/btree.h"
+#include "btree/iterator.h"
+#include "btree/range_lock.h"
+#include "transam/oxid.h"
+
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "utils/memutils.h"
+
+typedef struct
+{
+	/* InvalidOXid if the slot is free */
+	OXid		oxid;
+	int			procnum;
+	ORelOids	oids;
+	/* Zero length means the unbounded side of the range */
+	uint16		lokeyLen;
+	uint16		hikeyLen;
+	uint8		lokeyFlags;
+	uint8		hikeyFlags;
+	uint64		lokey[O_RANGE_LOCK_MAX_KEY_SIZE / sizeof(uint64)];
+	uint64		hikey[O_RANGE_LOCK_MAX_KEY_SIZE / sizeof(uint64)];
+} ORangeLock;
+
+typedef struct
+{
+	int			trancheId;
+	LWLock		lock;
+	pg_atomic_uint32 numLocks;
+} ORangeLocksMeta;
+
+typedef struct
+{
+	OXid		myOxid;
+	OXid		conflictOxid;
+} RangeLockScanArg;
+
+static ORangeLocksMeta *range_locks_meta = NULL;
+static ORangeLock *range_locks = NULL;
+
+/* Number of the range locks held by the current backend */
+static int	my_range_locks_count = 0;
+
+Size
+o_range_locks_shmem_needs(void)
+{
+	if (max_range_locks == 0)
+		return 0;
+
+	return add_size(CACHELINEALIGN(sizeof(ORangeLocksMeta)),
+					mul_size(sizeof(ORangeLock), max_range_locks));
+}
+
+void
+o_range_locks_shmem_init(Pointer ptr, bool found)
+{
+	int			i;
+
+	if (max_range_locks == 0)
+		return;
+
+	range_locks_meta = (ORangeLocksMeta *) ptr;
+	range_locks = (ORangeLock *) (ptr + CACHELINEALIGN(sizeof(ORangeLocksMeta)));
+
+	if (!found)
+	{
+		range_locks_meta->trancheId = LWLockNewTrancheId();
+		LWLockInitialize(&range_locks_meta->lock, range_locks_meta->trancheId);
+		pg_atomic_init_u32(&range_locks_meta->numLocks, 0);
+		for (i = 0; i < max_range_locks; i++)
+			range_locks[i].oxid = InvalidOXid;
+	}
+	LWLockRegisterTranche(range_locks_meta->trancheId, "OrioleDBRangeLocks");
+}
+
+static void
+range_lock_set_bound(OTuple bound, uint64 *data, uint16 *len, uint8 *flags,
+					 int keyLen)
+{
+	if (O_TUPLE_IS_NULL(bound))
+	{
+		*len = 0;
+		return;
+	}
+	memcpy(data, bound.data, keyLen);
+	*len = keyLen;
+	*flags = bound.formatFlags;
+}
+
+/*
+ * Checks if the key is within the range of the lock.  Both bounds are
+ * inclusive.
+ */
+static bool
+range_lock_covers(BTreeDescr *desc, ORangeLock *lock,
+				  Pointer key, BTreeKeyType keyType)
+{
+	OTuple		bound;
+
+	if (lock->lokeyLen > 0)
+	{
+		bound.data = (Pointer) lock->lokey;
+		bound.formatFlags = lock->lokeyFlags;
+		if (o_btree_cmp(desc, key, keyType, (Pointer) &bound,
+						BTreeKeyNonLeafKey) < 0)
+			return false;
+	}
+	if (lock->hikeyLen > 0)
+	{
+		bound.data = (Pointer) lock->hikey;
+		bound.formatFlags = lock->hikeyFlags;
+		if (o_btree_cmp(desc, key, keyType, (Pointer) &bound,
+						BTreeKeyNonLeafKey) > 0)
+			return false;
+	}
+	return true;
+}
+
+static TupleFetchCallbackResult
+range_lock_scan_callback(OTuple tuple, OXid tupOxid, CommitSeqNo csn,
+						 void *arg, TupleFetchCallbackCheckType check_type)
+{
+	RangeLockScanArg *scanArg = (RangeLockScanArg *) arg;
+
+	if (check_type == OTupleFetchCallbackVersionCheck &&
+		tupOxid != scanArg->myOxid &&
+		!OXidIsValid(scanArg->conflictOxid))
+		scanArg->conflictOxid = tupOxid;
+
+	return OTupleFetchMatch;
+}
+
+/*
+ * Waits for all the in-progress modifications of other transactions within
+ * the range.
+ */
+static void
+range_lock_wait_range(BTreeDescr *desc, OTuple lokey, OTuple hikey, OXid oxid)
+{
+	MemoryContext tupleCxt;
+	RangeLockScanArg arg;
+
+	tupleCxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "orioledb range lock tuples",
+									 ALLOCSET_DEFAULT_SIZES);
+	arg.myOxid = oxid;
+
+	while (true)
+	{
+		BTreeIterator *it;
+
+		arg.conflictOxid = InvalidOXid;
+		it = o_btree_iterator_create(desc,
+									 O_TUPLE_IS_NULL(lokey) ? NULL : (Pointer) &lokey,
+									 O_TUPLE_IS_NULL(lokey) ? BTreeKeyNone : BTreeKeyNonLeafKey,
+									 COMMITSEQNO_INPROGRESS,
+									 ForwardScanDirection);
+		o_btree_iterator_set_tuple_ctx(it, tupleCxt);
+		o_btree_iterator_set_callback(it, range_lock_scan_callback, &arg);
+
+		while (!OXidIsValid(arg.conflictOxid))
+		{
+			OTuple		tuple;
+
+			tuple = o_btree_iterator_fetch(it, NULL,
+										   O_TUPLE_IS_NULL(hikey) ? NULL : (Pointer) &hikey,
+										   O_TUPLE_IS_NULL(hikey) ? BTreeKeyNone : BTreeKeyNonLeafKey,
+										   true, NULL);
+			if (O_TUPLE_IS_NULL(tuple))
+				break;
+			MemoryContextReset(tupleCxt);
+		}
+		btree_iterator_free(it);
+
+		if (!OXidIsValid(arg.conflictOxid))
+			break;
+
+		wait_for_oxid(arg.conflictOxid);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	MemoryContextDelete(tupleCxt);
+}
+
+/*
+ * Locks the range [lokey, hikey] of the tree against insertions by other
+ * transactions until the end of transaction `oxid`.  Null bound means the
+ * unbounded side of the range.  Bounds are the non-leaf keys of the tree.
+ * The caller must have the tree loaded.
+ */
+void
+o_range_lock_acquire(BTreeDescr *desc, OTuple lokey, OTuple hikey, OXid oxid)
+{
+	ORangeLock *lock = NULL;
+	int			lokeyLen = 0,
+				hikeyLen = 0;
+	int			i;
+
+	if (max_range_locks == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("key-range locks are disabled"),
+				 errhint("Set orioledb.max_range_locks to a positive value.")));
+
+	if (!O_TUPLE_IS_NULL(lokey))
+		lokeyLen = o_btree_len(desc, lokey, OKeyLength);
+	if (!O_TUPLE_IS_NULL(hikey))
+		hikeyLen = o_btree_len(desc, hikey, OKeyLength);
+
+	if (lokeyLen > O_RANGE_LOCK_MAX_KEY_SIZE ||
+		hikeyLen > O_RANGE_LOCK_MAX_KEY_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("key-range lock bound is too long"),
+				 errdetail("Maximum bound length is %d bytes.",
+						   O_RANGE_LOCK_MAX_KEY_SIZE)));
+
+	LWLockAcquire(&range_locks_meta->lock, LW_EXCLUSIVE);
+	for (i = 0; i < max_range_locks; i++)
+	{
+		if (!OXidIsValid(range_locks[i].oxid))
+		{
+			lock = &range_locks[i];
+			break;
+		}
+	}
+
+	if (lock == NULL)
+	{
+		LWLockRelease(&range_locks_meta->lock);
+		ereport(ERROR,
+				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+				 errmsg("out of key-range locks"),
+				 errhint("Increase orioledb.max_range_locks.")));
+	}
+
+	lock->oxid = oxid;
+	lock->procnum = MyProc->pgprocno;
+	lock->oids = desc->oids;
+	range_lock_set_bound(lokey, lock->lokey, &lock->lokeyLen,
+						 &lock->lokeyFlags, lokeyLen);
+	range_lock_set_bound(hikey, lock->hikey, &lock->hikeyLen,
+						 &lock->hikeyFlags, hikeyLen);
+
+	/* Full barrier: the lock must be published before the range scan */
+	pg_atomic_fetch_add_u32(&range_locks_meta->numLocks, 1);
+	my_range_locks_count++;
+	LWLockRelease(&range_locks_meta->lock);
+
+	range_lock_wait_range(desc, lokey, hikey, oxid);
+}
+
+/*
+ * Waits for the transactions holding key-range locks, which cover the key
+ * just inserted into the tree by transaction `oxid`.
+ */
+void
+o_range_lock_check_insert(BTreeDescr *desc, Pointer key, BTreeKeyType keyType,
+						  OXid oxid)
+{
+	if (max_range_locks == 0)
+		return;
+
+	/* Pairs with the barrier in o_range_lock_acquire() */
+	pg_memory_barrier();
+	if (pg_atomic_read_u32(&range_locks_meta->numLocks) == 0)
+		return;
+
+	while (true)
+	{
+		OXid		conflictOxid = InvalidOXid;
+		int			i;
+
+		LWLockAcquire(&range_locks_meta->lock, LW_SHARED);
+		for (i = 0; i < max_range_locks; i++)
+		{
+			ORangeLock *lock = &range_locks[i];
+
+			if (OXidIsValid(lock->oxid) && lock->oxid != oxid &&
+				ORelOidsIsEqual(lock->oids, desc->oids) &&
+				!xid_is_finished(lock->oxid) &&
+				range_lock_covers(desc, lock, key, keyType))
+			{
+				conflictOxid = lock->oxid;
+				break;
+			}
+		}
+		LWLockRelease(&range_locks_meta->lock);
+
+		if (!OXidIsValid(conflictOxid))
+			break;
+
+		wait_for_oxid(conflictOxid);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Releases all the key-range locks held by the current backend.  Called at
+ * the transaction end.
+ */
+void
+o_range_locks_release(void)
+{
+	int			i;
+
+	if (my_range_locks_count == 0)
+		return;
+
+	LWLockAcquire(&range_locks_meta->lock, LW_EXCLUSIVE);
+	for (i = 0; i < max_range_locks; i++)
+	{
+		if (OXidIsValid(range_locks[i].oxid) &&
+			range_locks[i].procnum == MyProc->pgprocno)
+		{
+			range_locks[i].oxid = InvalidOXid;
+			pg_atomic_fetch_sub_u32(&range_locks_meta->numLocks, 1);
+		}
+	}
+	LWLockRelease(&range_locks_meta->lock);
+	my_range_locks_count = 0;
+}
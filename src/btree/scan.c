@@ -49,11 +49,15 @@
 #include "btree/page_chunks.h"
 #include "btree/scan.h"
 #include "btree/undo.h"
+#include "btree/undo_image_cache.h"
 #include "tuple/slot.h"
+#include "utils/page_pool.h"
 #include "utils/sampling.h"
 #include "utils/stopevent.h"
+#include "utils/ucm.h"
 
 #include "miscadmin.h"
+#include "utils/memutils.h"
 #if PG_VERSION_NUM >= 140000
 #include "utils/wait_event.h"
 #else
@@ -107,6 +111,19 @@ struct BTreeSeqScan
 	int64		downlinkIndex;
 	int64		allocatedDownlinks;
 
+	/*
+	 * In parallel scan: the remaining local downlinks are moved to the shared
+	 * list.  Before that, the worker reads its own downlinks.
+	 */
+	bool		downlinksPublished;
+
+	/*
+	 * In S3 mode: the index of the next downlink to check for S3 part
+	 * prefetch, and the last part scheduled for the load.
+	 */
+	int64		s3PrefetchIndex;
+	uint64		s3PrefetchPart;
+
 	BTreeIterator *iter;
 	OTuple		iterEnd;
 
@@ -128,8 +145,18 @@ struct BTreeSeqScan
 	BlockNumber samplingNumber;
 	BlockNumber samplingNext;
 
+	/*
+	 * The sampling scan descends to the sampled leaves instead of walking all
+	 * the internal pages (see get_next_sampled_downlink()).  Then
+	 * samplingNumber is the number of distinct leaves sampled.
+	 */
+	bool		randomSampling;
+	uint64		lastSampledDownlink;
+
 	BTreeSeqScanCallbacks *cb;
 	void	   *arg;
+	/* Scan is large enough to use the bulk read strategy */
+	bool		bulkRead;
 	bool		isSingleLeafPage;	/* Scan couldn't read first internal page */
 	OFixedKey	keyRangeLow,
 				keyRangeHigh;
@@ -142,6 +169,47 @@ struct BTreeSeqScan
 	dsm_segment *dsmSeg;
 };
 
+/*
+ * Number of the next in-memory child pages to prefetch while iterating the
+ * internal page, and the number of bytes to prefetch from the beginning of
+ * each page: the page header, chunk descriptors and hikeys.
+ */
+#define SEQ_SCAN_PREFETCH_DISTANCE	4
+#define SEQ_SCAN_PREFETCH_BYTES		256
+
+/*
+ * Number of on-disk leaf pages to be read ahead of the current one during
+ * the disk phase of the scan.
+ */
+#define SEQ_SCAN_DISK_PREFETCH_DISTANCE	32
+
+/*
+ * Number of S3 data file parts, including the current one, to be loaded in
+ * background during the disk phase of the scan in S3 mode.
+ */
+#define SEQ_SCAN_S3_PREFETCH_PARTS		4
+
+/*
+ * Scans of trees having more leaf pages than this fraction of the pool use
+ * the bulk read strategy (see ucm_bulk_read_start()).
+ */
+#define SEQ_SCAN_BULK_READ_FRACTION		4
+
+/*
+ * The sampling scan descends to the random leaves once the tree has this
+ * many times more leaves than sampled.  Otherwise, walking the internal pages
+ * is cheaper.  Concurrent changes of the tree might make the descent to retry
+ * up to SAMPLING_DESCENT_RETRIES times before the sample is skipped.
+ */
+#define SAMPLING_DESCENT_FRACTION		2
+#define SAMPLING_DESCENT_RETRIES		4
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SEQ_SCAN_PREFETCH(addr)		__builtin_prefetch((addr), 0, 1)
+#else
+#define SEQ_SCAN_PREFETCH(addr)		((void) (addr))
+#endif
+
 static dlist_head listOfScans = DLIST_STATIC_INIT(listOfScans);
 
 static void scan_make_iterator(BTreeSeqScan *scan, OTuple startKey, OTuple keyRangeHigh);
@@ -164,12 +232,15 @@ btree_scan_init_shmem(Pointer ptr, bool found)
 	{
 		btreeScanShmem->pageLoadTrancheId = LWLockNewTrancheId();
 		btreeScanShmem->downlinksPublishTrancheId = LWLockNewTrancheId();
+		btreeScanShmem->indexChunkTrancheId = LWLockNewTrancheId();
 	}
 
 	LWLockRegisterTranche(btreeScanShmem->pageLoadTrancheId,
 						  "OBTreeScanPageLoadTrancheId");
 	LWLockRegisterTranche(btreeScanShmem->downlinksPublishTrancheId,
 						  "OBTreeScanDownlinksPublishTrancheId");
+	LWLockRegisterTranche(btreeScanShmem->indexChunkTrancheId,
+						  "OBTreeScanIndexChunkTrancheId");
 }
 
 
@@ -245,9 +316,28 @@ load_next_historical_page(BTreeSeqScan *scan)
 {
 	BTreePageHeader *header = (BTreePageHeader *) scan->leafImg;
 	OFixedKey	prevHikey;
+	CommitSeqNo csnHigh = COMMITSEQNO_MAX_NORMAL;
+	UndoLocation startLoc = InvalidUndoLocation,
+				undoLoc = InvalidUndoLocation;
+	bool		isLeft,
+				isRight,
+				singlePages = true;
 
 	copy_fixed_hikey(scan->desc, &prevHikey, scan->histImg);
 
+	if (COMMITSEQNO_IS_NORMAL(header->csn) &&
+		header->csn >= scan->snapshotCsn)
+	{
+		startLoc = header->undoLocation;
+		if (UndoLocationIsValid(undo_image_cache_get(startLoc,
+													 scan->snapshotCsn,
+													 scan->histImg)))
+		{
+			BTREE_PAGE_LOCATOR_FIRST(scan->histImg, &scan->histLoc);
+			return;
+		}
+	}
+
 	while (COMMITSEQNO_IS_NORMAL(header->csn) &&
 		   header->csn >= scan->snapshotCsn)
 	{
@@ -257,12 +347,21 @@ load_next_historical_page(BTreeSeqScan *scan)
 					(errcode(ERRCODE_SNAPSHOT_TOO_OLD),
 					 errmsg("snapshot too old")));
 		}
-		(void) get_page_from_undo(scan->desc, header->undoLocation,
+		if (header != (BTreePageHeader *) scan->leafImg)
+			csnHigh = Min(csnHigh, header->csn);
+		undoLoc = header->undoLocation;
+		(void) get_page_from_undo(scan->desc, undoLoc,
 								  (Pointer) &prevHikey.tuple, BTreeKeyNonLeafKey,
-								  scan->histImg, NULL, NULL, NULL,
+								  scan->histImg, &isLeft, &isRight, NULL,
 								  NULL, NULL);
+		singlePages = singlePages && isLeft && isRight;
 		header = (BTreePageHeader *) scan->histImg;
 	}
+
+	if (UndoLocationIsValid(startLoc) && singlePages)
+		undo_image_cache_put(startLoc,
+							 COMMITSEQNO_IS_NORMAL(header->csn) ? header->csn : 0,
+							 csnHigh, scan->histImg, undoLoc);
 	BTREE_PAGE_LOCATOR_FIRST(scan->histImg, &scan->histLoc);
 }
 
@@ -372,127 +471,176 @@ cmp_downlinks(const void *p1, const void *p2)
 		return 1;
 }
 
+/*
+ * Switches the scan to reading the on-disk leaf pages collected during the
+ * in-memory part of the scan.
+ *
+ * In a parallel scan, the disk downlinks are distributed between workers via
+ * the shared sorted list.  It can be built only once all the workers finished
+ * the in-memory part.  Until then, the worker reads the pages of its own
+ * downlinks instead of waiting for the slowest worker.  So, disk reads of some
+ * workers overlap with the in-memory part of others, while the shared list
+ * still balances the rest of disk pages.
+ */
 static void
 switch_to_disk_scan(BTreeSeqScan *scan)
 {
 	ParallelOScanDesc poscan = scan->poscan;
-	bool		diskLeader = false;
 
 	scan->status = BTreeSeqScanDisk;
 	BTREE_PAGE_LOCATOR_SET_INVALID(&scan->leafLoc);
-	if (!poscan)
-	{
-		qsort(scan->diskDownlinks,
-			  scan->downlinksCount,
-			  sizeof(scan->diskDownlinks[0]),
-			  cmp_downlinks);
-	}
-	else
+	qsort(scan->diskDownlinks,
+		  scan->downlinksCount,
+		  sizeof(scan->diskDownlinks[0]),
+		  cmp_downlinks);
+
+	if (poscan)
 	{
 		SpinLockAcquire(&poscan->workerStart);
-		if (!(poscan->flags & O_PARALLEL_DISK_SCAN_STARTED))
-		{
-			poscan->flags |= O_PARALLEL_DISK_SCAN_STARTED;
-			diskLeader = true;
-		}
-		/* Publish the number of downlinks */
-		poscan->downlinksCount += scan->downlinksCount;
-		poscan->workersReportedCount++;
+		poscan->workersDiskStarted++;
 		SpinLockRelease(&poscan->workerStart);
+	}
+}
 
-		/* Wait until all workers publish their number of downlinks. */
-		while (true)
-		{
-			SpinLockAcquire(&poscan->workerStart);
-			Assert(poscan->workersReportedCount <= poscan->nworkers);
-			if ((poscan->workersReportedCount == poscan->nworkers ||
-				 poscan->flags & O_PARALLEL_IS_SINGLE_LEAF_PAGE) &&
-				(diskLeader ||
-				 poscan->dsmHandle != 0 ||
-				 poscan->downlinksCount == 0))
-			{
-				SpinLockRelease(&poscan->workerStart);
-				break;
-			}
-			SpinLockRelease(&poscan->workerStart);
-
-			pg_usleep(100L);
-			CHECK_FOR_INTERRUPTS();
-		}
+/*
+ * Checks if all the parallel workers finished the in-memory part of the scan.
+ */
+static bool
+all_workers_disk_started(ParallelOScanDesc poscan)
+{
+	bool		result;
 
-		if (diskLeader)
-		{
-			if (poscan->downlinksCount > 0)
-			{
-				/* Create DSM segment and publish downlinks list first */
-				LWLockAcquire(&poscan->downlinksPublish, LW_EXCLUSIVE);
-				Assert(!poscan->dsmHandle);
-				scan->dsmSeg = dsm_create(MAXALIGN(poscan->downlinksCount * sizeof(scan->diskDownlinks[0])), 0);
-				poscan->dsmHandle = dsm_segment_handle(scan->dsmSeg);
-				memcpy((Pointer) dsm_segment_address(scan->dsmSeg), scan->diskDownlinks,
-					   scan->downlinksCount * sizeof(scan->diskDownlinks[0]));
-				pg_atomic_fetch_add_u64(&poscan->downlinkIndex, scan->downlinksCount);
-				LWLockRelease(&poscan->downlinksPublish);
+	SpinLockAcquire(&poscan->workerStart);
+	Assert(poscan->workersDiskStarted <= poscan->nworkers);
+	result = (poscan->workersDiskStarted == poscan->nworkers ||
+			  (poscan->flags & O_PARALLEL_IS_SINGLE_LEAF_PAGE));
+	SpinLockRelease(&poscan->workerStart);
 
-				/*
-				 * Wait until the other workers have published their downlinks
-				 * lists
-				 */
-				while (true)
-				{
-					Assert(pg_atomic_read_u64(&poscan->downlinkIndex) <= poscan->downlinksCount);
-					if (pg_atomic_read_u64(&poscan->downlinkIndex) == poscan->downlinksCount)
-						break;
+	return result;
+}
 
-					pg_usleep(100L);
-					CHECK_FOR_INTERRUPTS();
-				}
+/*
+ * Moves the downlinks, which weren't read by the worker itself, to the shared
+ * sorted list.
+ */
+static void
+publish_disk_downlinks(BTreeSeqScan *scan)
+{
+	ParallelOScanDesc poscan = scan->poscan;
+	BTreeSeqScanDiskDownlink *localDownlinks;
+	int64		localCount;
+	bool		diskLeader = false;
 
-				/* Make sure all workers released this lock */
-				LWLockAcquire(&poscan->downlinksPublish, LW_EXCLUSIVE);
-				LWLockRelease(&poscan->downlinksPublish);
+	Assert(scan->downlinkIndex <= scan->downlinksCount);
+	localDownlinks = scan->diskDownlinks + scan->downlinkIndex;
+	localCount = scan->downlinksCount - scan->downlinkIndex;
 
-				qsort(dsm_segment_address(scan->dsmSeg), poscan->downlinksCount,
-					  sizeof(scan->diskDownlinks[0]), cmp_downlinks);
-			}
+	SpinLockAcquire(&poscan->workerStart);
+	if (!(poscan->flags & O_PARALLEL_DISK_SCAN_STARTED))
+	{
+		poscan->flags |= O_PARALLEL_DISK_SCAN_STARTED;
+		diskLeader = true;
+	}
+	/* Publish the number of downlinks */
+	poscan->downlinksCount += localCount;
+	poscan->workersReportedCount++;
+	SpinLockRelease(&poscan->workerStart);
 
-			pg_atomic_write_u64(&poscan->downlinkIndex, 0);
-			pg_write_barrier();
-			poscan->flags |= O_PARALLEL_DOWNLINKS_SORTED;
-			/* Now workers can get downlinks from shared sorted list */
-		}
-		else
+	/* Wait until all workers publish their number of downlinks. */
+	while (true)
+	{
+		SpinLockAcquire(&poscan->workerStart);
+		Assert(poscan->workersReportedCount <= poscan->nworkers);
+		if ((poscan->workersReportedCount == poscan->nworkers ||
+			 poscan->flags & O_PARALLEL_IS_SINGLE_LEAF_PAGE) &&
+			(diskLeader ||
+			 poscan->dsmHandle != 0 ||
+			 poscan->downlinksCount == 0))
 		{
-			uint64		index = 0;
+			SpinLockRelease(&poscan->workerStart);
+			break;
+		}
+		SpinLockRelease(&poscan->workerStart);
 
-			LWLockAcquire(&poscan->downlinksPublish, LW_SHARED);
-			if (poscan->downlinksCount > 0)
-			{
-				Assert(poscan->dsmHandle && !scan->dsmSeg);
-				scan->dsmSeg = dsm_attach(poscan->dsmHandle);
-			}
-			if (scan->downlinksCount > 0)
-			{
-				index = pg_atomic_fetch_add_u64(&poscan->downlinkIndex, scan->downlinksCount);
-				memcpy((Pointer) dsm_segment_address(scan->dsmSeg) + index * sizeof(scan->diskDownlinks[0]),
-					   scan->diskDownlinks, scan->downlinksCount * sizeof(scan->diskDownlinks[0]));
-				index += scan->downlinksCount;
-			}
+		pg_usleep(100L);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if (diskLeader)
+	{
+		if (poscan->downlinksCount > 0)
+		{
+			/* Create DSM segment and publish downlinks list first */
+			LWLockAcquire(&poscan->downlinksPublish, LW_EXCLUSIVE);
+			Assert(!poscan->dsmHandle);
+			scan->dsmSeg = dsm_create(MAXALIGN(poscan->downlinksCount * sizeof(scan->diskDownlinks[0])), 0);
+			poscan->dsmHandle = dsm_segment_handle(scan->dsmSeg);
+			memcpy((Pointer) dsm_segment_address(scan->dsmSeg), localDownlinks,
+				   localCount * sizeof(scan->diskDownlinks[0]));
+			pg_atomic_fetch_add_u64(&poscan->downlinkIndex, localCount);
 			LWLockRelease(&poscan->downlinksPublish);
 
 			/*
-			 * Wait until leader sorts the downlinks.
+			 * Wait until the other workers have published their downlinks
+			 * lists
 			 */
 			while (true)
 			{
-				if (poscan->flags & O_PARALLEL_DOWNLINKS_SORTED)
+				Assert(pg_atomic_read_u64(&poscan->downlinkIndex) <= poscan->downlinksCount);
+				if (pg_atomic_read_u64(&poscan->downlinkIndex) == poscan->downlinksCount)
 					break;
 
 				pg_usleep(100L);
 				CHECK_FOR_INTERRUPTS();
 			}
+
+			/* Make sure all workers released this lock */
+			LWLockAcquire(&poscan->downlinksPublish, LW_EXCLUSIVE);
+			LWLockRelease(&poscan->downlinksPublish);
+
+			qsort(dsm_segment_address(scan->dsmSeg), poscan->downlinksCount,
+				  sizeof(scan->diskDownlinks[0]), cmp_downlinks);
+		}
+
+		pg_atomic_write_u64(&poscan->downlinkIndex, 0);
+		pg_write_barrier();
+		poscan->flags |= O_PARALLEL_DOWNLINKS_SORTED;
+		/* Now workers can get downlinks from shared sorted list */
+	}
+	else
+	{
+		uint64		index = 0;
+
+		LWLockAcquire(&poscan->downlinksPublish, LW_SHARED);
+		if (poscan->downlinksCount > 0)
+		{
+			Assert(poscan->dsmHandle && !scan->dsmSeg);
+			scan->dsmSeg = dsm_attach(poscan->dsmHandle);
+		}
+		if (localCount > 0)
+		{
+			index = pg_atomic_fetch_add_u64(&poscan->downlinkIndex, localCount);
+			memcpy((Pointer) dsm_segment_address(scan->dsmSeg) + index * sizeof(scan->diskDownlinks[0]),
+				   localDownlinks, localCount * sizeof(scan->diskDownlinks[0]));
+			index += localCount;
+		}
+		LWLockRelease(&poscan->downlinksPublish);
+
+		/*
+		 * Wait until leader sorts the downlinks.
+		 */
+		while (true)
+		{
+			if (poscan->flags & O_PARALLEL_DOWNLINKS_SORTED)
+				break;
+
+			pg_usleep(100L);
+			CHECK_FOR_INTERRUPTS();
 		}
 	}
+	scan->downlinksPublished = true;
+	/* The S3 prefetch continues over the shared list */
+	scan->s3PrefetchIndex = 0;
 }
 
 /*
@@ -580,6 +728,35 @@ get_next_key(BTreeSeqScan *scan, BTreePageItemLocator *intLoc, OFixedKey *nextKe
  * 3) There is scan->iter to be processed before we can get downlinks from the
  *    current internal page.
  */
+/*
+ * Issues the CPU prefetch for the next in-memory children of the internal
+ * page starting from `loc`.  Makes the following o_btree_try_read_page() of
+ * those pages hit the cache.
+ */
+static void
+prefetch_next_downlinks(Page img, BTreePageItemLocator *loc)
+{
+	BTreePageItemLocator prefetchLoc = *loc;
+	int			i;
+
+	for (i = 0; i < SEQ_SCAN_PREFETCH_DISTANCE &&
+		 BTREE_PAGE_LOCATOR_IS_VALID(img, &prefetchLoc); i++)
+	{
+		BTreeNonLeafTuphdr *tuphdr;
+
+		tuphdr = (BTreeNonLeafTuphdr *) BTREE_PAGE_LOCATOR_GET_ITEM(img, &prefetchLoc);
+		if (DOWNLINK_IS_IN_MEMORY(tuphdr->downlink))
+		{
+			Pointer		p = O_GET_IN_MEMORY_PAGE(DOWNLINK_GET_IN_MEMORY_BLKNO(tuphdr->downlink));
+			int			offset;
+
+			for (offset = 0; offset < SEQ_SCAN_PREFETCH_BYTES; offset += PG_CACHE_LINE_SIZE)
+				SEQ_SCAN_PREFETCH(p + offset);
+		}
+		BTREE_PAGE_LOCATOR_NEXT(img, &prefetchLoc);
+	}
+}
+
 static bool
 get_next_downlink(BTreeSeqScan *scan, uint64 *downlink,
 				  OFixedKey *keyRangeLow, OFixedKey *keyRangeHigh)
@@ -630,6 +807,7 @@ get_next_downlink(BTreeSeqScan *scan, uint64 *downlink,
 				 * internal locator
 				 */
 				get_next_key(scan, &scan->intLoc, keyRangeHigh, scan->context.img);
+				prefetch_next_downlinks(scan->context.img, &scan->intLoc);
 				return true;
 			}
 
@@ -812,6 +990,120 @@ check_in_memory_leaf_page(BTreeSeqScan *scan, OTuple keyRangeLow, OTuple keyRang
 }
 
 
+/*
+ * Descends from the root to the leaf downlink located at the relative
+ * position `pos` (from 0 to 1) of the tree.  Each level chooses the child by
+ * the position scaled to the number of downlinks and passes the remainder to
+ * the next level.  Internal pages are copied from the page pool or read from
+ * disk to the local image without loading them to the pool.
+ *
+ * Returns false if concurrent changes of the tree require the retry.
+ */
+static bool
+sampling_descend(BTreeSeqScan *scan, double pos, uint64 *downlink,
+				 OFixedKey *keyRangeLow, OFixedKey *keyRangeHigh)
+{
+	BTreeDescr *desc = scan->desc;
+	Page		img = scan->context.img;
+	uint64		cur = MAKE_IN_MEMORY_DOWNLINK(desc->rootInfo.rootPageBlkno,
+											  InvalidOPageChangeCount);
+
+	clear_fixed_key(keyRangeLow);
+	clear_fixed_key(keyRangeHigh);
+
+	while (true)
+	{
+		BTreePageItemLocator loc;
+		BTreeNonLeafTuphdr *tuphdr;
+		OTuple		key;
+		int			nitems;
+		int			offset;
+
+		if (DOWNLINK_IS_IN_MEMORY(cur))
+		{
+			if (o_btree_try_read_page(desc,
+									  DOWNLINK_GET_IN_MEMORY_BLKNO(cur),
+									  DOWNLINK_GET_IN_MEMORY_CHANGECOUNT(cur),
+									  img,
+									  scan->snapshotCsn,
+									  NULL,
+									  BTreeKeyNone,
+									  NULL,
+									  &scan->context.imgReadCsn) != ReadPageResultOK)
+				return false;
+		}
+		else if (DOWNLINK_IS_ON_DISK(cur))
+		{
+			FileExtent	extent;
+
+			if (!read_page_from_disk(desc, img, cur, &extent))
+				elog(ERROR, "can not read internal page from disk");
+		}
+		else
+		{
+			Assert(DOWNLINK_IS_IN_IO(cur));
+			wait_for_io_completion(DOWNLINK_GET_IO_LOCKNUM(cur));
+			return false;
+		}
+
+		/* The root became a leaf concurrently */
+		if (O_PAGE_IS(img, LEAF))
+			return false;
+
+		nitems = BTREE_PAGE_ITEMS_COUNT(img);
+		offset = Min((int) (pos * nitems), nitems - 1);
+		pos = Min(Max(pos * nitems - offset, 0.0), 1.0);
+
+		BTREE_PAGE_OFFSET_GET_LOCATOR(img, offset, &loc);
+		BTREE_PAGE_READ_INTERNAL_ITEM(tuphdr, key, img, &loc);
+		cur = tuphdr->downlink;
+
+		/* The first downlink inherits the low key from the parent */
+		if (offset > 0)
+			copy_fixed_key(desc, keyRangeLow, key);
+		get_next_key(scan, &loc, keyRangeHigh, img);
+
+		if (PAGE_GET_LEVEL(img) == 1)
+		{
+			*downlink = cur;
+			return true;
+		}
+	}
+}
+
+/*
+ * Gets the downlink of the next sampled leaf with it's keyrange.  The block
+ * numbers of the sampler are mapped to the positions in the tree.  Since the
+ * sampler returns block numbers in ascending order, the sampled leaves also
+ * go in the key order, and the same leaf sampled twice is skipped.
+ */
+static bool
+get_next_sampled_downlink(BTreeSeqScan *scan, uint64 *downlink,
+						  OFixedKey *keyRangeLow, OFixedKey *keyRangeHigh)
+{
+	while (BlockSampler_HasMore(scan->sampler))
+	{
+		double		pos;
+		bool		found = false;
+		int			i;
+
+		pos = (double) BlockSampler_Next(scan->sampler) /
+			(double) scan->sampler->N;
+
+		for (i = 0; i < SAMPLING_DESCENT_RETRIES && !found; i++)
+			found = sampling_descend(scan, pos, downlink,
+									 keyRangeLow, keyRangeHigh);
+
+		if (!found || *downlink == scan->lastSampledDownlink)
+			continue;
+
+		scan->lastSampledDownlink = *downlink;
+		scan->samplingNumber++;
+		return true;
+	}
+	return false;
+}
+
 /*
  * Interates the internal page till we either:
  *  - Successfully read the next in-memory leaf page;
@@ -823,14 +1115,16 @@ iterate_internal_page(BTreeSeqScan *scan)
 {
 	uint64		downlink = 0;
 
-	while (get_next_downlink(scan, &downlink, &scan->keyRangeLow, &scan->keyRangeHigh))
+	while (scan->randomSampling ?
+		   get_next_sampled_downlink(scan, &downlink, &scan->keyRangeLow, &scan->keyRangeHigh) :
+		   get_next_downlink(scan, &downlink, &scan->keyRangeLow, &scan->keyRangeHigh))
 	{
 		bool		valid_downlink = true;
 
 		if (scan->cb && scan->cb->isRangeValid)
 			valid_downlink = scan->cb->isRangeValid(scan->keyRangeLow.tuple, scan->keyRangeHigh.tuple,
 													scan->arg);
-		else if (scan->needSampling)
+		else if (scan->needSampling && !scan->randomSampling)
 		{
 			if (scan->samplingNumber < scan->samplingNext)
 			{
@@ -911,6 +1205,70 @@ iterate_internal_page(BTreeSeqScan *scan)
 	return false;
 }
 
+/*
+ * Keeps the window of SEQ_SCAN_DISK_PREFETCH_DISTANCE on-disk pages after
+ * `index` being read ahead.  So, the kernel reads the next pages while we're
+ * processing (and decompressing) the current one.  Subsequent calls are
+ * expected to come with consecutive indexes (possibly from different parallel
+ * workers), so each call needs to issue the prefetch for a single page.
+ */
+static void
+prefetch_disk_downlinks(BTreeSeqScan *scan, BTreeSeqScanDiskDownlink *downlinks,
+						uint64 count, uint64 index)
+{
+	uint64		i,
+				start,
+				end;
+
+	if (index == 0)
+		start = 1;
+	else
+		start = index + SEQ_SCAN_DISK_PREFETCH_DISTANCE;
+	end = Min(index + SEQ_SCAN_DISK_PREFETCH_DISTANCE + 1, count);
+
+	for (i = start; i < end; i++)
+		prefetch_page_from_disk(scan->desc, downlinks[i].downlink);
+}
+
+/*
+ * In S3 mode, schedules the background load of the data file parts
+ * containing the on-disk pages we're going to read next.  Downlinks are
+ * sorted, so we walk them forward and schedule each next part till we're
+ * SEQ_SCAN_S3_PREFETCH_PARTS parts ahead of the page at `index`.  Thus, the
+ * S3 workers download the parts while we're processing the current one
+ * instead of each part miss being a synchronous download.
+ */
+static void
+prefetch_s3_parts(BTreeSeqScan *scan, BTreeSeqScanDiskDownlink *downlinks,
+				  uint64 count, uint64 index)
+{
+	uint64		curPart;
+
+	if (!orioledb_s3_mode)
+		return;
+
+	curPart = downlink_get_s3_part(scan->desc, downlinks[index].downlink);
+	if (scan->s3PrefetchIndex < index)
+		scan->s3PrefetchIndex = index;
+
+	while (scan->s3PrefetchIndex < count)
+	{
+		uint64		part;
+
+		part = downlink_get_s3_part(scan->desc,
+									downlinks[scan->s3PrefetchIndex].downlink);
+		if (part >= curPart + SEQ_SCAN_S3_PREFETCH_PARTS)
+			break;
+
+		if (part != scan->s3PrefetchPart)
+		{
+			prefetch_s3_part(scan->desc, part);
+			scan->s3PrefetchPart = part;
+		}
+		scan->s3PrefetchIndex++;
+	}
+}
+
 static bool
 load_next_disk_leaf_page(BTreeSeqScan *scan)
 {
@@ -926,16 +1284,39 @@ load_next_disk_leaf_page(BTreeSeqScan *scan)
 			return false;
 
 		downlink = scan->diskDownlinks[scan->downlinkIndex];
+		prefetch_disk_downlinks(scan, scan->diskDownlinks,
+								scan->downlinksCount, scan->downlinkIndex);
+		prefetch_s3_parts(scan, scan->diskDownlinks,
+						  scan->downlinksCount, scan->downlinkIndex);
+	}
+	else if (!scan->downlinksPublished &&
+			 scan->downlinkIndex < scan->downlinksCount &&
+			 !all_workers_disk_started(poscan))
+	{
+		/* Other workers are still in memory, read our own downlinks */
+		downlink = scan->diskDownlinks[scan->downlinkIndex];
+		prefetch_disk_downlinks(scan, scan->diskDownlinks,
+								scan->downlinksCount, scan->downlinkIndex);
+		prefetch_s3_parts(scan, scan->diskDownlinks,
+						  scan->downlinksCount, scan->downlinkIndex);
 	}
 	else
 	{
-		uint64		index = pg_atomic_fetch_add_u64(&poscan->downlinkIndex, 1);
+		uint64		index;
+		BTreeSeqScanDiskDownlink *downlinks;
+
+		if (!scan->downlinksPublished)
+			publish_disk_downlinks(scan);
 
+		index = pg_atomic_fetch_add_u64(&poscan->downlinkIndex, 1);
 		if (index >= poscan->downlinksCount)
 		{
 			return false;
 		}
-		downlink = ((BTreeSeqScanDiskDownlink *) dsm_segment_address(scan->dsmSeg))[index];
+		downlinks = (BTreeSeqScanDiskDownlink *) dsm_segment_address(scan->dsmSeg);
+		downlink = downlinks[index];
+		prefetch_disk_downlinks(scan, downlinks, poscan->downlinksCount, index);
+		prefetch_s3_parts(scan, downlinks, poscan->downlinksCount, index);
 	}
 
 	success = read_page_from_disk(scan->desc,
@@ -1020,6 +1401,11 @@ init_btree_seq_scan(BTreeSeqScan *scan)
 
 	o_btree_load_shmem(desc);
 
+	/* similar to BAS_BULKREAD in PostgreSQL */
+	scan->bulkRead = TREE_NUM_LEAF_PAGES(desc) > desc->ppool->size / SEQ_SCAN_BULK_READ_FRACTION;
+	if (scan->bulkRead)
+		ucm_bulk_read_start();
+
 	if (poscan)
 	{
 		/*
@@ -1057,7 +1443,20 @@ init_btree_seq_scan(BTreeSeqScan *scan)
 
 	if (sampler)
 	{
+		Page		rootPage = O_GET_IN_MEMORY_PAGE(desc->rootInfo.rootPageBlkno);
+
 		scan->needSampling = true;
+		scan->randomSampling = !O_PAGE_IS(rootPage, LEAF) &&
+			(uint64) sampler->n * SAMPLING_DESCENT_FRACTION < sampler->N;
+	}
+	else
+	{
+		scan->needSampling = false;
+		scan->randomSampling = false;
+	}
+
+	if (scan->needSampling && !scan->randomSampling)
+	{
 		if (BlockSampler_HasMore(scan->sampler))
 			scan->samplingNext = BlockSampler_Next(scan->sampler);
 		else
@@ -1065,7 +1464,6 @@ init_btree_seq_scan(BTreeSeqScan *scan)
 	}
 	else
 	{
-		scan->needSampling = false;
 		scan->samplingNext = InvalidBlockNumber;
 	}
 
@@ -1086,6 +1484,9 @@ init_btree_seq_scan(BTreeSeqScan *scan)
 			scan->status = BTreeSeqScanFinished;
 	}
 
+	if (scan->bulkRead)
+		ucm_bulk_read_end();
+
 	scan->initialized = true;
 }
 
@@ -1104,6 +1505,9 @@ make_btree_seq_scan_internal(BTreeDescr *desc, CommitSeqNo csn,
 	scan->allocatedDownlinks = 16;
 	scan->downlinksCount = 0;
 	scan->downlinkIndex = 0;
+	scan->downlinksPublished = false;
+	scan->s3PrefetchIndex = 0;
+	scan->s3PrefetchPart = PG_UINT64_MAX;
 	scan->diskDownlinks = (BTreeSeqScanDiskDownlink *) palloc(sizeof(scan->diskDownlinks[0]) * scan->allocatedDownlinks);
 	scan->mctx = CurrentMemoryContext;
 	scan->iter = NULL;
@@ -1113,10 +1517,13 @@ make_btree_seq_scan_internal(BTreeDescr *desc, CommitSeqNo csn,
 	scan->intStartOffset = 0;
 	scan->samplingNumber = 0;
 	scan->sampler = sampler;
+	scan->randomSampling = false;
+	scan->lastSampledDownlink = InvalidDiskDownlink;
 	scan->dsmSeg = NULL;
 	scan->initialized = false;
 	scan->checkpointNumberSet = false;
 	scan->haveHistImg = false;
+	scan->bulkRead = false;
 	BTREE_PAGE_LOCATOR_SET_INVALID(&scan->leafLoc);
 
 	dlist_push_tail(&listOfScans, &scan->listNode);
@@ -1133,10 +1540,10 @@ make_btree_seq_scan(BTreeDescr *desc, CommitSeqNo csn, void *poscan)
 
 BTreeSeqScan *
 make_btree_seq_scan_cb(BTreeDescr *desc, CommitSeqNo csn,
-					   BTreeSeqScanCallbacks *cb, void *arg)
+					   BTreeSeqScanCallbacks *cb, void *arg, void *poscan)
 {
 	o_btree_load_shmem(desc);
-	return make_btree_seq_scan_internal(desc, csn, cb, arg, NULL, NULL);
+	return make_btree_seq_scan_internal(desc, csn, cb, arg, NULL, poscan);
 }
 
 BTreeSeqScan *
@@ -1146,6 +1553,18 @@ make_btree_sampling_scan(BTreeDescr *desc, BlockSampler sampler)
 										NULL, NULL, sampler, NULL);
 }
 
+/*
+ * Returns the number of leaf pages read by the sampling scan.
+ */
+BlockNumber
+btree_sampling_scan_get_pages(BTreeSeqScan *scan)
+{
+	Assert(scan->needSampling);
+	if (scan->randomSampling)
+		return scan->samplingNumber;
+	return scan->sampler->m;
+}
+
 static OTuple
 btree_seq_scan_get_tuple_from_iterator(BTreeSeqScan *scan,
 									   CommitSeqNo *tupleCsn,
@@ -1479,20 +1898,120 @@ btree_seq_scan_getnext(BTreeSeqScan *scan, MemoryContext mctx,
 	if (!scan->initialized)
 		init_btree_seq_scan(scan);
 
+	O_TUPLE_SET_NULL(tuple);
 	if (scan->status == BTreeSeqScanInMemory ||
 		scan->status == BTreeSeqScanDisk)
 	{
+		if (scan->bulkRead)
+			ucm_bulk_read_start();
 		tuple = btree_seq_scan_getnext_internal(scan, mctx, tupleCsn, hint);
-
-		if (!O_TUPLE_IS_NULL(tuple))
-			return tuple;
+		if (scan->bulkRead)
+			ucm_bulk_read_end();
 	}
-	Assert(scan->status == BTreeSeqScanFinished);
+	Assert(!O_TUPLE_IS_NULL(tuple) || scan->status == BTreeSeqScanFinished);
 
-	O_TUPLE_SET_NULL(tuple);
 	return tuple;
 }
 
+/*
+ * Fetches up to 'maxTuples' visible tuples at once.  Tuples are allocated in
+ * 'mctx' like in btree_seq_scan_getnext().  The page images of the scan are
+ * reused on the page switch, and the tuple versions might come from undo, so
+ * the tuples are copied rather than pointing to the page.  Returns the number
+ * of fetched tuples, which is less than 'maxTuples' only at the end of the
+ * scan.
+ */
+int
+btree_seq_scan_getnext_batch(BTreeSeqScan *scan, MemoryContext mctx,
+							 OTuple *tuples, CommitSeqNo *tupleCsns,
+							 BTreeLocationHint *hints, int maxTuples)
+{
+	int			count = 0;
+
+	Assert(scan);
+	if (!scan->initialized)
+		init_btree_seq_scan(scan);
+
+	if (scan->status != BTreeSeqScanInMemory &&
+		scan->status != BTreeSeqScanDisk)
+		return 0;
+
+	if (scan->bulkRead)
+		ucm_bulk_read_start();
+	while (count < maxTuples)
+	{
+		OTuple		tuple;
+
+		tuple = btree_seq_scan_getnext_internal(scan, mctx,
+												&tupleCsns[count],
+												&hints[count]);
+		if (O_TUPLE_IS_NULL(tuple))
+		{
+			Assert(scan->status == BTreeSeqScanFinished);
+			break;
+		}
+		tuples[count++] = tuple;
+	}
+	if (scan->bulkRead)
+		ucm_bulk_read_end();
+
+	return count;
+}
+
+/*
+ * Number of tuples counted by btree_seq_scan_count() between resets of the
+ * memory context holding the tuple versions.
+ */
+#define SEQ_SCAN_COUNT_RESET_TUPLES	1024
+
+/*
+ * Counts the tuples visible to the scan snapshot without returning them to
+ * the caller.  The visibility is checked in the same way as
+ * btree_seq_scan_getnext() does.
+ */
+uint64
+btree_seq_scan_count(BTreeSeqScan *scan)
+{
+	MemoryContext mctx;
+	uint64		count = 0;
+
+	Assert(scan);
+	if (!scan->initialized)
+		init_btree_seq_scan(scan);
+
+	mctx = AllocSetContextCreate(CurrentMemoryContext,
+								 "orioledb seq scan count",
+								 ALLOCSET_DEFAULT_SIZES);
+
+	if (scan->bulkRead)
+		ucm_bulk_read_start();
+	while (scan->status == BTreeSeqScanInMemory ||
+		   scan->status == BTreeSeqScanDisk)
+	{
+		OTuple		tuple;
+		CommitSeqNo tupleCsn;
+
+		tuple = btree_seq_scan_getnext_internal(scan, mctx, &tupleCsn, NULL);
+		if (O_TUPLE_IS_NULL(tuple))
+		{
+			Assert(scan->status == BTreeSeqScanFinished);
+			break;
+		}
+
+		if (++count % SEQ_SCAN_COUNT_RESET_TUPLES == 0)
+		{
+			MemoryContextReset(mctx);
+			CHECK_FOR_INTERRUPTS();
+		}
+	}
+	if (scan->bulkRead)
+		ucm_bulk_read_end();
+
+	MemoryContextDelete(mctx);
+
+	return count;
+}
+
 static OTuple
 btree_seq_scan_get_tuple_from_iterator_raw(BTreeSeqScan *scan,
 										   bool *end,
@@ -1593,7 +2112,11 @@ btree_seq_scan_getnext_raw(BTreeSeqScan *scan, MemoryContext mctx,
 	if (scan->status == BTreeSeqScanInMemory ||
 		scan->status == BTreeSeqScanDisk)
 	{
+		if (scan->bulkRead)
+			ucm_bulk_read_start();
 		tuple = btree_seq_scan_getnext_raw_internal(scan, mctx, hint);
+		if (scan->bulkRead)
+			ucm_bulk_read_end();
 		if (scan->status == BTreeSeqScanInMemory ||
 			scan->status == BTreeSeqScanDisk)
 		{
@@ -21,6 +21,7 @@
 #include "checkpoint/checkpoint.h"
 #include "recovery/recovery.h"
 #include "transam/undo.h"
+#include "utils/o_probes.h"
 #include "utils/page_pool.h"
 #include "utils/stopevent.h"
 
@@ -175,13 +176,15 @@ split_item_interator_get(SplitItemIterator *it)
  * as close as possible to `targetLocation`, or if `targetLocation == 0` close
  * to `spaceRatio`.  Also, this function takes advantage of reclaiming unused
  * space according to `csn`.  Returns number of items in new left page and
- * sets the first tuple of right page to `*split_item`.
+ * sets the first tuple of right page to `*split_item` and the last tuple of
+ * left page to `*left_item`.
  */
 OffsetNumber
 btree_page_split_location(BTreeDescr *desc, Page page, OffsetNumber offset,
 						  LocationIndex tuplesize, OTuple tuple, bool replace,
 						  OffsetNumber targetLocation, float4 spaceRatio,
-						  OTuple *split_item, CommitSeqNo csn)
+						  OTuple *split_item, OTuple *left_item,
+						  CommitSeqNo csn)
 {
 	int			leftPageSpaceLeft,
 				rightPageSpaceLeft,
@@ -277,9 +280,106 @@ btree_page_split_location(BTreeDescr *desc, Page page, OffsetNumber offset,
 	if (split_item)
 		*split_item = split_item_interator_get(&left_it);
 
+	if (left_item)
+	{
+		SplitItemIterator last_left_it = left_it;
+
+		split_item_interator_prev(&last_left_it);
+		*left_item = split_item_interator_get(&last_left_it);
+	}
+
 	return minLeftPageItemsCount;
 }
 
+/*
+ * No more split points than this are tried on each side of the balanced one
+ * when looking for the shortest separator.
+ */
+#define SPLIT_SEPARATOR_MAX_DISTANCE	8
+
+/*
+ * Returns the length of the separator key between the leaf tuples.
+ */
+static LocationIndex
+split_separator_len(BTreeDescr *desc, OTuple left_item, OTuple split_item)
+{
+	if (desc->ops->separator_key)
+	{
+		OTuple		separator;
+
+		separator = desc->ops->separator_key(desc, left_item, split_item);
+		if (!O_TUPLE_IS_NULL(separator))
+		{
+			LocationIndex len = o_btree_len(desc, separator, OKeyLength);
+
+			pfree(separator.data);
+			return len;
+		}
+	}
+	return o_btree_len(desc, split_item, OTupleKeyLengthNoVersion);
+}
+
+/*
+ * Looks for the leaf page split point giving the shortest separator key
+ * within a small distance from the balanced split point `balanced`.  Shorter
+ * separators make non-leaf pages hold more downlinks.  Returns the number of
+ * items in the new left page and updates `*split_item` and `*left_item` if a
+ * better split point is found.  Ties are resolved in favor of the split
+ * point closer to the balanced one.
+ */
+static OffsetNumber
+btree_split_choose_separator(BTreeDescr *desc, Page page, OffsetNumber offset,
+							 LocationIndex tuplesize, OTuple tuple,
+							 bool replace, OffsetNumber balanced,
+							 OTuple *split_item, OTuple *left_item,
+							 CommitSeqNo csn)
+{
+	int			totalCount = BTREE_PAGE_ITEMS_COUNT(page) + (replace ? 0 : 1),
+				maxDistance,
+				distance,
+				sign;
+	OffsetNumber best = balanced;
+	LocationIndex bestLen;
+
+	maxDistance = Min(SPLIT_SEPARATOR_MAX_DISTANCE, Max(1, totalCount / 16));
+	bestLen = split_separator_len(desc, *left_item, *split_item);
+
+	for (distance = 1; distance <= maxDistance; distance++)
+	{
+		for (sign = -1; sign <= 1; sign += 2)
+		{
+			int			target = (int) balanced + sign * distance;
+			OffsetNumber count;
+			OTuple		cur_split_item,
+						cur_left_item;
+			LocationIndex len;
+
+			if (target < 1 || target > totalCount - 1)
+				continue;
+
+			count = btree_page_split_location(desc, page, offset, tuplesize,
+											  tuple, replace, target, 0.5,
+											  &cur_split_item, &cur_left_item,
+											  csn);
+
+			/* the split point doesn't fit the page space */
+			if (count != target)
+				continue;
+
+			len = split_separator_len(desc, cur_left_item, cur_split_item);
+			if (len < bestLen)
+			{
+				best = count;
+				bestLen = len;
+				*split_item = cur_split_item;
+				*left_item = cur_left_item;
+			}
+		}
+	}
+
+	return best;
+}
+
 OffsetNumber
 btree_get_split_left_count(BTreeDescr *desc, OInMemoryBlkno blkno,
 						   OTuple tuple, LocationIndex tuplesize,
@@ -292,7 +392,8 @@ btree_get_split_left_count(BTreeDescr *desc, OInMemoryBlkno blkno,
 	OffsetNumber targetCount;
 	OffsetNumber result;
 	float4		spaceRatio;
-	OTuple		split_item;
+	OTuple		split_item,
+				left_item;
 
 	/* The default target is to split the page 50%/50% */
 	targetCount = 0;
@@ -324,24 +425,52 @@ btree_get_split_left_count(BTreeDescr *desc, OInMemoryBlkno blkno,
 
 	/*
 	 * If we don't autodetect the insertion order, we still assume TOAST and
-	 * rightmost inserts are always assumed to be ordered ascendingly.
+	 * rightmost inserts are always assumed to be ordered ascendingly.  The
+	 * tuple appended after all the items of the rightmost page goes alone to
+	 * the right page then, if optimized split is enabled.
 	 */
 	else if ((desc->type == oIndexToast && O_PAGE_IS(page, LEAF)) || O_PAGE_IS(page, RIGHTMOST))
-		spaceRatio = 0.9;
+	{
+		if (enable_btree_optimized_split && O_PAGE_IS(page, RIGHTMOST) &&
+			!replace && offset == header->itemsCount)
+			targetCount = offset;
+		else
+			spaceRatio = 0.9;
+	}
 
 	result = btree_page_split_location(desc, page, offset, tuplesize, tuple, replace,
-									   targetCount, spaceRatio, &split_item, csn);
+									   targetCount, spaceRatio, &split_item,
+									   &left_item, csn);
+
+	if (enable_btree_optimized_split && O_PAGE_IS(page, LEAF) &&
+		targetCount == 0 && spaceRatio == 0.5)
+		result = btree_split_choose_separator(desc, page, offset, tuplesize,
+											  tuple, replace, result,
+											  &split_item, &left_item, csn);
 
 	/*
-	 * Fill the split key.  Convert tuple to key if needed.
+	 * Fill the split key.  Convert tuple to key if needed.  On leaf pages try
+	 * to make the shorter separator key.
 	 */
 	if (split_key)
 	{
 		bool		allocated = true;
 
 		if (O_PAGE_IS(page, LEAF))
-			split_item = o_btree_tuple_make_key(desc, split_item, NULL,
-												false, &allocated);
+		{
+			OTuple		separator;
+
+			O_TUPLE_SET_NULL(separator);
+			if (desc->ops->separator_key)
+				separator = desc->ops->separator_key(desc, left_item,
+													 split_item);
+
+			if (!O_TUPLE_IS_NULL(separator))
+				split_item = separator;
+			else
+				split_item = o_btree_tuple_make_key(desc, split_item, NULL,
+													false, &allocated);
+		}
 
 		*split_key_len = o_btree_len(desc, split_item, OKeyLength);
 		if (!O_PAGE_IS(page, LEAF) || !allocated)
@@ -385,6 +514,11 @@ perform_page_split(BTreeDescr *desc, OInMemoryBlkno blkno, OInMemoryBlkno new_bl
 	BTreePageItemLocator loc;
 	BTreePageItem items[BTREE_PAGE_MAX_CHUNK_ITEMS + 1];
 	char		newItem[Max(BTreeLeafTuphdrSize, BTreeNonLeafTuphdrSize) + O_BTREE_MAX_TUPLE_SIZE];
+	OPageChunksLayout layout = page_chunks_get_layout(blkno);
+
+	pg_atomic_fetch_add_u64(&BTREE_GET_META(desc)->numSplits, 1);
+	TRACE_ORIOLEDB_PAGE_SPLIT(desc->oids.datoid, desc->oids.relnode,
+							  blkno, new_blkno);
 
 	init_new_btree_page(desc, new_blkno,
 						left_header->flags & ~(O_BTREE_FLAG_LEFTMOST),
@@ -489,8 +623,9 @@ perform_page_split(BTreeDescr *desc, OInMemoryBlkno blkno, OInMemoryBlkno new_bl
 		BTREE_PAGE_GET_HIKEY(hikey, left_page);
 	}
 
-	btree_page_reorg(desc, right_page, &items[left_count], count - left_count,
-					 hikeySize, hikey, NULL);
+	btree_page_reorg_layout(desc, right_page, &items[left_count],
+							count - left_count, hikeySize, hikey, NULL,
+							layout);
 
 	/*
 	 * Start page modification.  It contains the required memory barrier
@@ -514,8 +649,8 @@ perform_page_split(BTreeDescr *desc, OInMemoryBlkno blkno, OInMemoryBlkno new_bl
 													  O_PAGE_GET_CHANGE_COUNT(right_page));
 	left_header->flags &= ~(O_BTREE_FLAG_RIGHTMOST);
 
-	btree_page_reorg(desc, left_page, &items[0], left_count,
-					 splitkey_len, splitkey, NULL);
+	btree_page_reorg_layout(desc, left_page, &items[0], left_count,
+							splitkey_len, splitkey, NULL, layout);
 
 	o_btree_page_calculate_statistics(desc, left_page);
 	o_btree_page_calculate_statistics(desc, right_page);
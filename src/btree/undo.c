@@ -79,11 +79,17 @@ page_add_item_to_undo(BTreeDescr *desc, Pointer p, CommitSeqNo imageCsn,
 
 	Assert(desc->undoType != UndoReserveNone);
 	if (splitKey)
+	{
 		ptr = get_undo_record(desc->undoType, &undoLocation,
 							  O_SPLIT_UNDO_IMAGE_SIZE(splitKeyLen));
+		o_btree_count_undo(desc, O_SPLIT_UNDO_IMAGE_SIZE(splitKeyLen));
+	}
 	else
+	{
 		ptr = get_undo_record(desc->undoType, &undoLocation,
 							  O_COMPACT_UNDO_IMAGE_SIZE);
+		o_btree_count_undo(desc, O_COMPACT_UNDO_IMAGE_SIZE);
+	}
 
 	header = (UndoPageImageHeader *) ptr;
 	if (splitKey)
@@ -320,6 +326,7 @@ make_undo_record(BTreeDescr *desc, OTuple tuple, bool is_tuple,
 	item = (BTreeModifyUndoStackItem *) get_undo_record(desc->undoType,
 														undoLocation,
 														MAXALIGN(size));
+	o_btree_count_undo(desc, MAXALIGN(size));
 	item->header.itemSize = size;
 	if (action == BTreeOperationLock)
 		item->header.type = RowLockUndoItemType;
@@ -1096,6 +1103,7 @@ make_merge_undo_image(BTreeDescr *desc, Pointer left,
 
 	Assert(desc->undoType != UndoReserveNone);
 	undo_rec = get_undo_record(desc->undoType, &undoLocation, O_MERGE_UNDO_IMAGE_SIZE);
+	o_btree_count_undo(desc, O_MERGE_UNDO_IMAGE_SIZE);
 
 	header = (UndoPageImageHeader *) undo_rec;
 	header->type = UndoPageImageMerge;
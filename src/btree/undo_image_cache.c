@@ -0,0 +1,185 @@
+/*-------------------------------------------------------------------------
+ *
+ * undo_image_cache.c
+ *		Shared cache of historical page images reconstructed from undo.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/btree/undo_image_cache.c
+ *
+ * NOTES
+ *
+ *		Reading the page as of the old snapshot follows the chain of
+ *		page-level undo images starting from the undo location of the page
+ *		header, until the image old enough is found.  Long snapshots over
+ *		frequently modified pages walk long chains, and every reader does it
+ *		on its own.
+ *
+ *		The cache keeps the result of such a walk by the undo location the
+ *		walk started from together with the range of snapshot CSNs, for which
+ *		the walk gives the same result.  That is the (csnLow, csnHigh] range,
+ *		where csnLow is the CSN of the resulting image and csnHigh is the
+ *		minimal CSN of the images skipped.  Undo
+ *		location identifies both the page and its state, because any page
+ *		modification producing the new page image also gets a new undo
+ *		location.  Undo images never change, so there is nothing to
+ *		invalidate: an entry is only ignored once its undo is discarded.
+ *
+ *		Only walks over the single-page images are cached.  Choosing the
+ *		side of the merge image depends on the key, which is not a part of
+ *		the cache key.
+ *
+ *		Slots are direct-mapped by the hash of the start location, a new
+ *		entry replaces any colliding one.  Slots are protected by the
+ *		partitioned locks.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/undo_image_cache.h"
+#include "transam/undo.h"
+
+#include "common/hashfn.h"
+#include "storage/lwlock.h"
+
+#define UNDO_IMAGE_CACHE_PARTITIONS (64)
+
+typedef struct
+{
+	UndoLocation startLoc;
+	UndoLocation resultLoc;
+	CommitSeqNo csnLow;
+	CommitSeqNo csnHigh;
+} UndoImageCacheSlot;
+
+typedef struct
+{
+	int			trancheId;
+	LWLock		locks[UNDO_IMAGE_CACHE_PARTITIONS];
+} UndoImageCacheMeta;
+
+static UndoImageCacheMeta *cacheMeta = NULL;
+static UndoImageCacheSlot *cacheSlots = NULL;
+static Pointer cacheImages = NULL;
+static uint64 cacheSlotsCount = 0;
+
+Size
+undo_image_cache_shmem_needs(void)
+{
+	Size		size;
+
+	cacheSlotsCount = (uint64) undo_image_cache_buffers_guc;
+	if (cacheSlotsCount == 0)
+		return 0;
+
+	size = CACHELINEALIGN(sizeof(UndoImageCacheMeta));
+	size = add_size(size, CACHELINEALIGN(mul_size(sizeof(UndoImageCacheSlot),
+												  cacheSlotsCount)));
+	size = add_size(size, mul_size(ORIOLEDB_BLCKSZ, cacheSlotsCount));
+	return size;
+}
+
+void
+undo_image_cache_shmem_init(Pointer ptr, bool found)
+{
+	int			i;
+
+	if (cacheSlotsCount == 0)
+		return;
+
+	cacheMeta = (UndoImageCacheMeta *) ptr;
+	ptr += CACHELINEALIGN(sizeof(UndoImageCacheMeta));
+	cacheSlots = (UndoImageCacheSlot *) ptr;
+	ptr += CACHELINEALIGN(sizeof(UndoImageCacheSlot) * cacheSlotsCount);
+	cacheImages = ptr;
+
+	if (!found)
+	{
+		cacheMeta->trancheId = LWLockNewTrancheId();
+		for (i = 0; i < UNDO_IMAGE_CACHE_PARTITIONS; i++)
+			LWLockInitialize(&cacheMeta->locks[i], cacheMeta->trancheId);
+		for (i = 0; i < cacheSlotsCount; i++)
+			cacheSlots[i].startLoc = InvalidUndoLocation;
+	}
+	LWLockRegisterTranche(cacheMeta->trancheId, "OUndoImageCacheTrancheId");
+}
+
+static uint64
+get_slot_num(UndoLocation startLoc)
+{
+	return hash_bytes_uint32((uint32) startLoc ^ (uint32) (startLoc >> 32)) %
+		cacheSlotsCount;
+}
+
+static inline LWLock *
+get_slot_lock(uint64 slotNum)
+{
+	return &cacheMeta->locks[slotNum % UNDO_IMAGE_CACHE_PARTITIONS];
+}
+
+/*
+ * Loads the cached result of the undo chain walk, which starts from
+ * `startLoc`, for the snapshot `csn`.  On success, the image is copied to
+ * `img` and the location of the undo item holding it is returned.  Returns
+ * InvalidUndoLocation if there is no such result in the cache.
+ */
+UndoLocation
+undo_image_cache_get(UndoLocation startLoc, CommitSeqNo csn, Page img)
+{
+	UndoImageCacheSlot *slot;
+	UndoLocation result = InvalidUndoLocation;
+	uint64		slotNum;
+	LWLock	   *lock;
+
+	if (cacheSlotsCount == 0 || !COMMITSEQNO_IS_NORMAL(csn))
+		return InvalidUndoLocation;
+
+	slotNum = get_slot_num(startLoc);
+	slot = &cacheSlots[slotNum];
+	lock = get_slot_lock(slotNum);
+
+	LWLockAcquire(lock, LW_SHARED);
+	if (slot->startLoc == startLoc &&
+		csn > slot->csnLow && csn <= slot->csnHigh &&
+		UNDO_REC_EXISTS(slot->resultLoc))
+	{
+		result = slot->resultLoc;
+		memcpy(img, cacheImages + slotNum * ORIOLEDB_BLCKSZ, ORIOLEDB_BLCKSZ);
+	}
+	LWLockRelease(lock);
+
+	return result;
+}
+
+/*
+ * Saves the result of the undo chain walk from `startLoc`: the image `img`
+ * read from undo item `resultLoc` is valid for the snapshots within the
+ * (csnLow, csnHigh] range.
+ */
+void
+undo_image_cache_put(UndoLocation startLoc, CommitSeqNo csnLow,
+					 CommitSeqNo csnHigh, Page img, UndoLocation resultLoc)
+{
+	UndoImageCacheSlot *slot;
+	uint64		slotNum;
+	LWLock	   *lock;
+
+	if (cacheSlotsCount == 0 || csnLow >= csnHigh)
+		return;
+
+	slotNum = get_slot_num(startLoc);
+	slot = &cacheSlots[slotNum];
+	lock = get_slot_lock(slotNum);
+
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+	slot->startLoc = startLoc;
+	slot->resultLoc = resultLoc;
+	slot->csnLow = csnLow;
+	slot->csnHigh = csnHigh;
+	memcpy(cacheImages + slotNum * ORIOLEDB_BLCKSZ, img, ORIOLEDB_BLCKSZ);
+	LWLockRelease(lock);
+}
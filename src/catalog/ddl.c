@@ -1338,6 +1338,82 @@ orioledb_ExecutorRun_hook(QueryDesc *queryDesc,
 	saved_undo_location = prevSavedLocation;
 }
 
+/*
+ * Fills the page pool usage settings of the table from its options.  Returns
+ * true if any of them was changed.
+ */
+static bool
+o_table_fill_buffers_options(OTable *o_table, ORelOptions *options)
+{
+	int32		min_pages = 0,
+				max_percent = 0;
+	int8		priority = OBuffersPriorityNormal;
+	bool		changed;
+
+	if (options)
+	{
+		min_pages = options->buffers_min_pages;
+		max_percent = options->buffers_max_percent;
+		priority = options->buffers_priority;
+	}
+
+	changed = o_table->buffers_min_pages != min_pages ||
+		o_table->buffers_max_percent != max_percent ||
+		o_table->buffers_priority != priority;
+	o_table->buffers_min_pages = min_pages;
+	o_table->buffers_max_percent = max_percent;
+	o_table->buffers_priority = priority;
+	return changed;
+}
+
+/*
+ * Applies changes of the page pool usage settings made by ALTER TABLE ...
+ * SET/RESET to the table and its trees.
+ */
+static void
+o_table_update_buffers_options(Relation rel)
+{
+	OTable	   *o_table;
+	ORelOids	oids;
+	CommitSeqNo csn;
+	OXid		oxid;
+	int			ix_num,
+				ctid_off;
+
+	ORelOidsSetFromRel(oids, rel);
+	o_table = o_tables_get(oids);
+	if (o_table == NULL)
+		return;
+
+	CommandCounterIncrement();
+	if (!o_table_fill_buffers_options(o_table, (ORelOptions *) rel->rd_options))
+	{
+		o_table_free(o_table);
+		return;
+	}
+
+	fill_current_oxid_csn(&oxid, &csn);
+	o_tables_rel_meta_lock(rel);
+	o_tables_update(o_table, oxid, csn);
+	o_tables_after_update(o_table, oxid, csn);
+
+	ctid_off = o_table->has_primary ? 0 : 1;
+	for (ix_num = 0; ix_num < o_table->nindices; ix_num++)
+	{
+		OTableIndex *index = &o_table->indices[ix_num];
+
+		if (index->type == oIndexPrimary)
+			continue;
+		o_indices_update(o_table, ix_num + ctid_off, oxid, csn);
+		o_invalidate_oids(index->oids);
+		o_add_invalidate_undo_item(index->oids, O_INVALIDATE_OIDS_ON_ABORT);
+	}
+	if (ORelOidsIsValid(o_table->toast_oids))
+		o_indices_update(o_table, TOASTIndexNumber, oxid, csn);
+	o_tables_rel_meta_unlock(rel, InvalidOid);
+	o_table_free(o_table);
+}
+
 static void
 orioledb_object_access_hook(ObjectAccessType access, Oid classId, Oid objectId,
 							int subId, void *arg)
@@ -1715,6 +1791,7 @@ orioledb_object_access_hook(ObjectAccessType access, Oid classId, Oid objectId,
 					o_table->default_compress = compress;
 					o_table->toast_compress = toast_compress;
 					o_table->primary_compress = primary_compress;
+					(void) o_table_fill_buffers_options(o_table, options);
 
 					fill_current_oxid_csn(&oxid, &csn);
 
@@ -1955,6 +2032,12 @@ orioledb_object_access_hook(ObjectAccessType access, Oid classId, Oid objectId,
 				orioledb_free_rd_amcache(rel);
 				relation_close(old_rel, NoLock);
 			}
+			else if ((rel->rd_rel->relkind == RELKIND_RELATION ||
+					  rel->rd_rel->relkind == RELKIND_MATVIEW) &&
+					 (subId == 0) && is_orioledb_rel(rel))
+			{
+				o_table_update_buffers_options(rel);
+			}
 			else if (rel->rd_rel->relkind == RELKIND_INDEX)
 			{
 				Relation	tbl = relation_open(rel->rd_index->indrelid,
@@ -2137,8 +2220,11 @@ o_parse_compress(const char *value)
 	{
 		if (strcmp(value, "auto") == 0 ||
 			strcmp(value, "on") == 0 ||
-			strcmp(value, "true") == 0)
+			strcmp(value, "true") == 0 ||
+			strcmp(value, "zstd") == 0)
 			result = O_COMPRESS_DEFAULT;
+		else if (strcmp(value, "lz4") == 0)
+			result = O_COMPRESS_LZ4;
 		else if (strcmp(value, "off") == 0)
 			result = InvalidOCompress;
 		else
@@ -14,6 +14,16 @@
  * is reset after reboot of the database engine and the state must
  * be restored after it.
  *
+ * On top of the B-trees, a few free extents of each short length are cached
+ * in the meta page of the tree (see BTreeFreeExtentsCache).  Cache refills
+ * are batched: a single B-tree lookup fetches an extent long enough for
+ * several allocations of the same length.  The cache is partitioned by
+ * backend: each backend allocates from and returns extents to its own
+ * partition and looks into the other partitions only before going to the
+ * B-trees.  Being in the meta page, cached extents stay visible to the
+ * checkpointer and are never lost with a backend.  They are counted in
+ * numFreeBlocks and listed by foreach_free_extent() as any other free extent.
+ *
  * Copyright (c) 2021-2023, Oriole DB Inc.
  *
  * IDENTIFICATION
@@ -39,6 +49,7 @@
 
 #include "access/transam.h"
 #include "miscadmin.h"
+#include "storage/proc.h"
 #if PG_VERSION_NUM >= 140000
 #include "utils/wait_event.h"
 #else
@@ -49,8 +60,168 @@
 								 (ex1).datoid == (ex2).datoid && \
 								 (ex1).relnode == (ex2).relnode)
 
+/* number of extents fetched from the B-trees at once on the cache refill */
+#define FREE_EXTENTS_REFILL_BATCH	8
+
+#define FREE_EXTENTS_MY_PARTITION() \
+	(MyProc ? MyProc->pgprocno % FREE_EXTENTS_CACHE_PARTITIONS : 0)
+
+static void free_extent_to_tree(BTreeDescr *desc, FileExtent extent);
+
+/*
+ * Takes a free extent of the given length from the given partition of the
+ * meta page cache.
+ */
+static bool
+free_extents_cache_pop_partition(BTreeFreeExtentsCache *cache, uint16 len,
+								 FileExtent *result)
+{
+	bool		found = false;
+
+	SpinLockAcquire(&cache->lock);
+	if (cache->num[len - 1] > 0)
+	{
+		cache->num[len - 1]--;
+		result->off = cache->offsets[len - 1][cache->num[len - 1]];
+		result->len = len;
+		found = true;
+	}
+	SpinLockRelease(&cache->lock);
+
+	return found;
+}
+
+/*
+ * Takes a free extent of the given length from the meta page cache.  Looks
+ * into the partition of our backend first.  The other partitions are checked
+ * without the lock first to skip the empty ones cheaply.
+ */
+static bool
+free_extents_cache_pop(BTreeMetaPage *metaPage, uint16 len, FileExtent *result)
+{
+	int			part = FREE_EXTENTS_MY_PARTITION();
+	int			i;
+
+	if (len == 0 || len > FREE_EXTENTS_NUM_CLASSES)
+		return false;
+
+	if (free_extents_cache_pop_partition(&metaPage->freeExtentsCache[part],
+										 len, result))
+		return true;
+
+	for (i = 1; i < FREE_EXTENTS_CACHE_PARTITIONS; i++)
+	{
+		BTreeFreeExtentsCache *cache;
+
+		cache = &metaPage->freeExtentsCache[(part + i) % FREE_EXTENTS_CACHE_PARTITIONS];
+		if (*((volatile uint8 *) &cache->num[len - 1]) > 0 &&
+			free_extents_cache_pop_partition(cache, len, result))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Puts a free extent to the meta page cache.  Returns false if the extent
+ * length isn't cached or there is no room for it.
+ */
+static bool
+free_extents_cache_push(BTreeMetaPage *metaPage, FileExtent extent)
+{
+	BTreeFreeExtentsCache *cache = &metaPage->freeExtentsCache[FREE_EXTENTS_MY_PARTITION()];
+	bool		pushed = false;
+
+	if (extent.len == 0 || extent.len > FREE_EXTENTS_NUM_CLASSES)
+		return false;
+
+	SpinLockAcquire(&cache->lock);
+	if (cache->num[extent.len - 1] < FREE_EXTENTS_CLASS_SIZE)
+	{
+		cache->offsets[extent.len - 1][cache->num[extent.len - 1]] = extent.off;
+		cache->num[extent.len - 1]++;
+		pushed = true;
+	}
+	SpinLockRelease(&cache->lock);
+
+	return pushed;
+}
+
+/*
+ * Copies the cached free extents of the tree into the array.  Returns the
+ * number of extents copied.
+ */
+static int
+free_extents_cache_copy(BTreeMetaPage *metaPage, FileExtent *extents,
+						bool reset)
+{
+	int			i,
+				j,
+				k,
+				n = 0;
+
+	for (k = 0; k < FREE_EXTENTS_CACHE_PARTITIONS; k++)
+	{
+		BTreeFreeExtentsCache *cache = &metaPage->freeExtentsCache[k];
+
+		SpinLockAcquire(&cache->lock);
+		for (i = 0; i < FREE_EXTENTS_NUM_CLASSES; i++)
+		{
+			for (j = 0; j < cache->num[i]; j++)
+			{
+				extents[n].off = cache->offsets[i][j];
+				extents[n].len = i + 1;
+				n++;
+			}
+			if (reset)
+				cache->num[i] = 0;
+		}
+		SpinLockRelease(&cache->lock);
+	}
+
+	return n;
+}
+
+/*
+ * Returns the cached free extents of the tree back to the free extents
+ * B-trees.  Must be called before the meta page is released.
+ */
+void
+free_extents_cache_flush(BTreeDescr *desc)
+{
+	FileExtent	extents[FREE_EXTENTS_CACHE_PARTITIONS * FREE_EXTENTS_NUM_CLASSES * FREE_EXTENTS_CLASS_SIZE];
+	int			i,
+				n;
+
+	n = free_extents_cache_copy(BTREE_GET_META(desc), extents, true);
+	for (i = 0; i < n; i++)
+		free_extent_to_tree(desc, extents[i]);
+}
+
+static FileExtent
+extend_datafile(BTreeDescr *desc, uint16 len)
+{
+	BTreeMetaPage *metaPage = BTREE_GET_META(desc);
+	FileExtent	result;
+
+	result.len = len;
+	if (use_device)
+	{
+		result.off = orioledb_device_alloc(desc, len * ORIOLEDB_COMP_BLCKSZ) / ORIOLEDB_COMP_BLCKSZ;
+	}
+	else
+	{
+		/* see cut_tail_free_extent() */
+		LWLockAcquire(&metaPage->extendLock, LW_SHARED);
+		result.off = pg_atomic_fetch_add_u64(&metaPage->datafileLength[0], len);
+		LWLockRelease(&metaPage->extendLock);
+	}
+	return result;
+}
+
 /*
- * Returns free file extent with length = len.
+ * Takes a free file extent with length = len from the free extents B-trees.
+ * Returns false if there is no such extent.
  *
  * get_extend()/free_extend() operations optimized for more fast get_extend()
  * execution because as more critical for performance part.
@@ -71,15 +242,14 @@
  * 4. If found extent is more than needed than return the remaining part into
  * the (len, off) B-tree.
  */
-FileExtent
-get_extent(BTreeDescr *desc, uint16 len)
+static bool
+get_extent_from_tree(BTreeDescr *desc, uint16 len, FileExtent *result)
 {
 	BTreeMetaPage *metaPage = BTREE_GET_META(desc);
 	BTreeLeafTuphdr *header;
 	FreeTreeTuple tup,
 				deleted_tup,
 			   *cur_tup;
-	FileExtent	result;
 	OBTreeFindPageContext context;
 	Page		p;
 	bool		old_enable_stopevents;
@@ -91,19 +261,9 @@ get_extent(BTreeDescr *desc, uint16 len)
 	BTreeDescr *off_len_tree = get_sys_tree(SYS_TREES_EXTENTS_OFF_LEN);
 	OTuple		tmpTup;
 
-	Assert(!orioledb_s3_mode);
-
 	/* a fast check */
 	if (pg_atomic_read_u64(&metaPage->numFreeBlocks) < len)
-	{
-		/* free extent can not be founded, increase file length */
-		result.len = len;
-		if (use_device)
-			result.off = orioledb_device_alloc(desc, len * ORIOLEDB_COMP_BLCKSZ) / ORIOLEDB_COMP_BLCKSZ;
-		else
-			result.off = pg_atomic_fetch_add_u64(&metaPage->datafileLength[0], len);
-		return result;
-	}
+		return false;
 
 	old_enable_stopevents = enable_stopevents;
 	enable_stopevents = false;
@@ -177,14 +337,8 @@ get_extent(BTreeDescr *desc, uint16 len)
 
 	if (!found)
 	{
-		/* free extent not founded, increase file length */
-		result.len = len;
-		if (use_device)
-			result.off = orioledb_device_alloc(desc, len * ORIOLEDB_COMP_BLCKSZ) / ORIOLEDB_COMP_BLCKSZ;
-		else
-			result.off = pg_atomic_fetch_add_u64(&metaPage->datafileLength[0], len);
 		enable_stopevents = old_enable_stopevents;
-		return result;
+		return false;
 	}
 
 	Assert(p != NULL);
@@ -258,17 +412,77 @@ get_extent(BTreeDescr *desc, uint16 len)
 		}
 	}
 
-	result.off = deleted_tup.extent.offset;
-	result.len = len;
+	result->off = deleted_tup.extent.offset;
+	result->len = len;
 
 	enable_stopevents = old_enable_stopevents;
-	return result;
+	return true;
 }
 
 /*
- * Adds the extent to a free extents list.
+ * Returns free file extent with length = len.  Tries the meta page cache
+ * first, then refills it from the B-trees, then searches the B-trees for the
+ * exact length.  Extends the data file if there is no suitable free extent.
+ */
+FileExtent
+get_extent(BTreeDescr *desc, uint16 len)
+{
+	BTreeMetaPage *metaPage = BTREE_GET_META(desc);
+	FileExtent	result;
+
+	Assert(!orioledb_s3_mode);
+
+	if (free_extents_cache_pop(metaPage, len, &result))
+	{
+		pg_atomic_fetch_sub_u64(&metaPage->numFreeBlocks, (uint64) len);
+		return result;
+	}
+
+	if (len <= FREE_EXTENTS_NUM_CLASSES &&
+		get_extent_from_tree(desc, len * FREE_EXTENTS_REFILL_BATCH, &result))
+	{
+		FileExtent	extent;
+		int			i;
+
+		/* return the first part, put the rest to the cache */
+		for (i = 1; i < FREE_EXTENTS_REFILL_BATCH; i++)
+		{
+			extent.off = result.off + (uint64) i * len;
+			extent.len = len;
+			pg_atomic_fetch_add_u64(&metaPage->numFreeBlocks, (uint64) len);
+			if (!free_extents_cache_push(metaPage, extent))
+				free_extent_to_tree(desc, extent);
+		}
+		result.len = len;
+		return result;
+	}
+
+	if (get_extent_from_tree(desc, len, &result))
+		return result;
+
+	/* free extent not founded, increase file length */
+	return extend_datafile(desc, len);
+}
+
+/*
+ * Adds the extent to a free extents list.  Caller is responsible for
+ * accounting the extent in numFreeBlocks.
+ */
+void
+free_extent(BTreeDescr *desc, FileExtent extent)
+{
+	Assert(FileExtentIsValid(extent));
+
+	if (free_extents_cache_push(BTREE_GET_META(desc), extent))
+		return;
+
+	free_extent_to_tree(desc, extent);
+}
+
+/*
+ * Adds the extent to the free extents B-trees.
  *
- * See description of the get_extent() function.
+ * See description of the get_extent_from_tree() function.
  *
  * free_extent() algorithm:
  *
@@ -279,8 +493,8 @@ get_extent(BTreeDescr *desc, uint16 len)
  *
  * TODO: add hints support
  */
-void
-free_extent(BTreeDescr *desc, FileExtent extent)
+static void
+free_extent_to_tree(BTreeDescr *desc, FileExtent extent)
 {
 	BTreeIterator *it = NULL;
 	FreeTreeTuple tup,
@@ -486,6 +700,9 @@ foreach_free_extent(BTreeDescr *desc, ForEachExtentCallback callback, void *arg)
 				to,
 			   *cur;
 	FileExtent	cur_extent;
+	FileExtent	cached[FREE_EXTENTS_CACHE_PARTITIONS * FREE_EXTENTS_NUM_CLASSES * FREE_EXTENTS_CLASS_SIZE];
+	int			i,
+				ncached;
 	bool		old_enable_stopevents = enable_stopevents;
 	BTreeDescr *off_len_tree = get_sys_tree(SYS_TREES_EXTENTS_OFF_LEN);
 	OTuple		tmpTup;
@@ -541,7 +758,123 @@ foreach_free_extent(BTreeDescr *desc, ForEachExtentCallback callback, void *arg)
 	}
 
 	btree_iterator_free(it);
+
+	ncached = free_extents_cache_copy(BTREE_GET_META(desc), cached, false);
+	for (i = 0; i < ncached; i++)
+		callback(desc, cached[i], arg);
+
+	enable_stopevents = old_enable_stopevents;
+}
+
+/*
+ * Cuts off the free extent located at the end of the data file, and decreases
+ * the data file length accordingly.  Returns the number of chunks the data
+ * file was shortened by, zero if the last chunk of the data file is in use.
+ */
+uint64
+cut_tail_free_extent(BTreeDescr *desc)
+{
+	BTreeMetaPage *metaPage = BTREE_GET_META(desc);
+	BTreeIterator *it;
+	FreeTreeTuple tup,
+			   *cur;
+	bool		old_enable_stopevents = enable_stopevents;
+	BTreeDescr *len_off_tree = get_sys_tree(SYS_TREES_EXTENTS_LEN_OFF);
+	BTreeDescr *off_len_tree = get_sys_tree(SYS_TREES_EXTENTS_OFF_LEN);
+	OTuple		tmpTup;
+	uint64		length,
+				expected;
+
+	Assert(!orioledb_s3_mode && !use_device);
+
+	/* let cached extents be merged with their neighbors */
+	free_extents_cache_flush(desc);
+
+	enable_stopevents = false;
+
+	memset(&tup, 0, sizeof(FreeTreeTuple));
+	tup.ixType = desc->type;
+	tup.datoid = desc->oids.datoid;
+	tup.relnode = desc->oids.relnode;
+	tup.extent.offset = PG_UINT64_MAX;
+	tup.extent.length = PG_UINT64_MAX;
+
+	/* find the last free extent in the (off, len) B-tree */
+	tmpTup.data = (Pointer) &tup;
+	tmpTup.formatFlags = 0;
+	it = o_btree_iterator_create(off_len_tree, (Pointer) &tmpTup,
+								 BTreeKeyNonLeafKey,
+								 COMMITSEQNO_INPROGRESS,
+								 BackwardScanDirection);
+	tmpTup = o_btree_iterator_fetch(it, NULL, NULL, BTreeKeyLeafTuple,
+									false, NULL);
+	btree_iterator_free(it);
+	cur = (FreeTreeTuple *) tmpTup.data;
+
+	if (cur == NULL || !EXTENTS_IX_EQ(*cur, tup))
+	{
+		if (cur != NULL)
+			pfree(cur);
+		enable_stopevents = old_enable_stopevents;
+		return 0;
+	}
+	tup = *cur;
+	pfree(cur);
+
+	length = tup.extent.length;
+	expected = tup.extent.offset + length;
+	if (pg_atomic_read_u64(&metaPage->datafileLength[0]) != expected)
+	{
+		enable_stopevents = old_enable_stopevents;
+		return 0;
+	}
+
+	/* concurrent get_extent() could already take it */
+	tmpTup.data = (Pointer) &tup;
+	tmpTup.formatFlags = 0;
+	if (!o_btree_autonomous_delete(len_off_tree, tmpTup, BTreeKeyLeafTuple, NULL))
+	{
+		enable_stopevents = old_enable_stopevents;
+		return 0;
+	}
+
+	if (!o_btree_autonomous_delete(off_len_tree, tmpTup, BTreeKeyLeafTuple, NULL))
+	{
+		elog(FATAL, "unable to delete extent (%lu, %lu) from the (off, len) B-tree",
+			 tup.extent.offset, tup.extent.length);
+	}
+
+	/*
+	 * The file is truncated under extendLock, so nobody could write to the
+	 * newly allocated space before it's truncated.
+	 */
+	LWLockAcquire(&metaPage->extendLock, LW_EXCLUSIVE);
+	if (pg_atomic_read_u64(&metaPage->datafileLength[0]) == expected)
+	{
+		pg_atomic_write_u64(&metaPage->datafileLength[0], tup.extent.offset);
+		btree_smgr_truncate(desc,
+							(off_t) expected * ORIOLEDB_COMP_BLCKSZ,
+							(off_t) tup.extent.offset * ORIOLEDB_COMP_BLCKSZ);
+		LWLockRelease(&metaPage->extendLock);
+	}
+	else
+	{
+		LWLockRelease(&metaPage->extendLock);
+
+		/* the data file was extended concurrently, return the extent back */
+		if (!o_btree_autonomous_insert(off_len_tree, tmpTup) ||
+			!o_btree_autonomous_insert(len_off_tree, tmpTup))
+		{
+			elog(FATAL, "unable to return extent (%lu, %lu) into the free extents B-trees",
+				 tup.extent.offset, tup.extent.length);
+		}
+		enable_stopevents = old_enable_stopevents;
+		return 0;
+	}
+
+	pg_atomic_fetch_sub_u64(&metaPage->numFreeBlocks, length);
 	enable_stopevents = old_enable_stopevents;
+	return length;
 }
 
 /*
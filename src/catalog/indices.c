@@ -116,6 +116,7 @@ typedef struct oIdxBuildState
 	oIdxLeader *btleader;
 	void		(*worker_heap_sort_fn) (oIdxSpool *, void *, Sharedsort *, int sortmem, bool progress);
 	OIndexNumber ix_num;
+	int			nsharedsorts;
 } oIdxBuildState;
 
 static void _o_index_end_parallel(oIdxLeader *btleader);
@@ -124,6 +125,21 @@ static void build_secondary_index_worker_sort(oIdxSpool *btspool, void *btshared
 											  Sharedsort *sharedsort, int sortmem,
 											  bool progress);
 static void build_secondary_index_worker_heap_scan(OTableDescr *descr, OIndexDescr *idx, ParallelOScanDesc poscan, Tuplesortstate **sortstates, bool progress, double *heap_tuples, double *index_tuples[]);
+static void rebuild_indices_worker_sort(oIdxSpool *btspool, void *btshared,
+										Sharedsort *sharedsort, int sortmem,
+										bool progress);
+
+/*
+ * Shared tuplesorts are placed one after another in the same chunk.  Returns
+ * the i-th of them.
+ */
+static inline Sharedsort *
+o_index_shared_sort(Sharedsort *sharedsort, int nparticipants, int i)
+{
+	Size		size = MAXALIGN(tuplesort_estimate_shared(nparticipants));
+
+	return (Sharedsort *) ((Pointer) sharedsort + size * i);
+}
 
 
 /* copied from tablecmds.c */
@@ -729,8 +745,11 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 	BufferUsage *bufferusage;
 	bool		leaderparticipates = true;
 	int			o_table_size;
+	int			old_o_table_size = 0;
 	Pointer		o_table_serialized;
+	Pointer		old_o_table_serialized = NULL;
 	bool		in_recovery = is_recovery_in_progress();
+	int			i;
 #ifdef DISABLE_LEADER_PARTICIPATION
 	leaderparticipates = false;
 #endif
@@ -738,6 +757,9 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 	if (!in_recovery)
 	{
 		o_table_serialized = serialize_o_table(btspool->o_table, &o_table_size);
+		if (btspool->old_o_table)
+			old_o_table_serialized = serialize_o_table(btspool->old_o_table,
+													   &old_o_table_size);
 
 		/*
 		 * Enter parallel mode, and create context for parallel build of btree
@@ -754,9 +776,11 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 		 * PARALLEL_KEY_TUPLESORT tuplesort workspace
 		 */
 		/* Calls orioledb_parallelscan_estimate via tableam handler */
-		estbtshared = _o_index_parallel_estimate_shared(o_table_size);
+		estbtshared = _o_index_parallel_estimate_shared(o_table_size +
+														old_o_table_size);
 		shm_toc_estimate_chunk(&pcxt->estimator, estbtshared);
-		estsort = tuplesort_estimate_shared(scantuplesortstates);
+		estsort = mul_size(MAXALIGN(tuplesort_estimate_shared(scantuplesortstates)),
+						   buildstate->nsharedsorts);
 		shm_toc_estimate_chunk(&pcxt->estimator, estsort);
 		shm_toc_estimate_keys(&pcxt->estimator, 2);
 
@@ -781,6 +805,8 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 		if (pcxt->seg == NULL)
 		{
 			pfree(o_table_serialized);
+			if (old_o_table_serialized)
+				pfree(old_o_table_serialized);
 			DestroyParallelContext(pcxt);
 			ExitParallelMode();
 			return;
@@ -789,9 +815,16 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 		/* Store shared build state, for which we reserved space */
 		btshared = (oIdxShared *) shm_toc_allocate(pcxt->toc, estbtshared);
 		btshared->o_table_size = o_table_size;
+		btshared->old_o_table_size = old_o_table_size;
 		sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
 
 		memmove(&btshared->o_table_serialized, o_table_serialized, btshared->o_table_size);
+		if (old_o_table_serialized)
+		{
+			memmove(&btshared->o_table_serialized[o_table_size],
+					old_o_table_serialized, old_o_table_size);
+			pfree(old_o_table_serialized);
+		}
 	}
 	else
 	{
@@ -813,7 +846,11 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 #endif
 		scantuplesortstates = leaderparticipates ? btshared->nrecoveryworkers + 1 : btshared->nrecoveryworkers;
 		btshared->o_table_size = 0;
+		btshared->old_o_table_size = 0;
 		sharedsort = recovery_sharedsort;
+
+		/* Recovery shared memory has a room for the single tuplesort */
+		Assert(buildstate->nsharedsorts == 1);
 	}
 
 	/* Initialize immutable state */
@@ -822,6 +859,7 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 	btshared->ix_num = buildstate->ix_num;
 	btshared->scantuplesortstates = scantuplesortstates;
 	btshared->worker_heap_sort_fn = buildstate->worker_heap_sort_fn;
+	btshared->nsharedsorts = buildstate->nsharedsorts;
 	/* Initialize mutable state */
 	ConditionVariableInit(&btshared->workersdonecv);
 	SpinLockInit(&btshared->mutex);
@@ -837,8 +875,12 @@ _o_index_begin_parallel(oIdxBuildState *buildstate, bool isconcurrent, int reque
 		 * Store shared tuplesort-private state, for which we reserved space.
 		 * Then, initialize opaque state using tuplesort routine.
 		 */
-		tuplesort_initialize_shared(sharedsort, scantuplesortstates,
-									pcxt->seg);
+		for (i = 0; i < btshared->nsharedsorts; i++)
+			tuplesort_initialize_shared(o_index_shared_sort(sharedsort,
+															scantuplesortstates,
+															i),
+										scantuplesortstates,
+										pcxt->seg);
 
 		shm_toc_insert(pcxt->toc, PARALLEL_KEY_BTREE_SHARED, btshared);
 		shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
@@ -1004,6 +1046,8 @@ _o_index_leader_participate_as_worker(oIdxBuildState *buildstate)
 	leaderworker->isunique = buildstate->spool->isunique;
 	leaderworker->o_table = buildstate->spool->o_table;
 	leaderworker->descr = buildstate->spool->descr;
+	leaderworker->old_o_table = buildstate->spool->old_o_table;
+	leaderworker->old_descr = buildstate->spool->old_descr;
 
 	/*
 	 * Might as well use reliable figure when doling out maintenance_work_mem
@@ -1050,6 +1094,7 @@ _o_index_parallel_build_inner(dsm_segment *seg, shm_toc *toc,
 	WalUsage   *walusage;
 	BufferUsage *bufferusage;
 	int			sortmem;
+	int			i;
 
 #ifdef BTREE_BUILD_STATS
 	if (log_btree_build_stats)
@@ -1070,9 +1115,16 @@ _o_index_parallel_build_inner(dsm_segment *seg, shm_toc *toc,
 		/* Look up nbtree shared state */
 		btshared = shm_toc_lookup(toc, PARALLEL_KEY_BTREE_SHARED, false);
 		btspool->o_table = deserialize_o_table((Pointer) (&btshared->o_table_serialized), btshared->o_table_size);
+		if (btshared->old_o_table_size > 0)
+			btspool->old_o_table = deserialize_o_table((Pointer) (&btshared->o_table_serialized[btshared->o_table_size]),
+													   btshared->old_o_table_size);
 		/* Look up shared state private to tuplesort.c */
 		sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
-		tuplesort_attach_shared(sharedsort, seg);
+		for (i = 0; i < btshared->nsharedsorts; i++)
+			tuplesort_attach_shared(o_index_shared_sort(sharedsort,
+														btshared->scantuplesortstates,
+														i),
+									seg);
 	}
 	else
 	{
@@ -1093,6 +1145,11 @@ _o_index_parallel_build_inner(dsm_segment *seg, shm_toc *toc,
 	btspool->isunique = btshared->isunique;
 	btspool->descr = (OTableDescr *) palloc0(sizeof(OTableDescr));
 	o_fill_tmp_table_descr(btspool->descr, btspool->o_table);
+	if (btspool->old_o_table)
+	{
+		btspool->old_descr = (OTableDescr *) palloc0(sizeof(OTableDescr));
+		o_fill_tmp_table_descr(btspool->old_descr, btspool->old_o_table);
+	}
 
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
@@ -1104,6 +1161,11 @@ _o_index_parallel_build_inner(dsm_segment *seg, shm_toc *toc,
 
 	o_free_tmp_table_descr(btspool->descr);
 	pfree(btspool->descr);
+	if (btspool->old_descr)
+	{
+		o_free_tmp_table_descr(btspool->old_descr);
+		pfree(btspool->old_descr);
+	}
 	pfree(btspool);
 
 	if (!is_recovery_in_progress())
@@ -1296,6 +1358,7 @@ build_secondary_index(OTable *o_table, OTableDescr *descr, OIndexNumber ix_num,
 
 		buildstate.worker_heap_sort_fn = &build_secondary_index_worker_sort;
 		buildstate.ix_num = ix_num;
+		buildstate.nsharedsorts = 1;
 		buildstate.spool = btspool;
 
 		_o_index_begin_parallel(&buildstate, false, nParallelWorkers);
@@ -1388,48 +1451,31 @@ build_secondary_index(OTable *o_table, OTableDescr *descr, OIndexNumber ix_num,
 	pfree(index_tuples);
 }
 
-void
-rebuild_indices(OTable *old_o_table, OTableDescr *old_descr,
-				OTable *o_table, OTableDescr *descr)
+/*
+ * Scans the primary tree of the old table and puts tuples of all the new
+ * indices and TOAST into the given tuplesorts.  Scans the part of tree if
+ * the parallel scan is given.  Fills the sequential ctid if the new primary
+ * index uses it.
+ */
+static void
+rebuild_indices_heap_scan(OTableDescr *old_descr, OTableDescr *descr,
+						  ParallelOScanDesc poscan,
+						  Tuplesortstate **sortstates,
+						  Tuplesortstate *toastSortState,
+						  double *heap_tuples, double *index_tuples,
+						  uint64 *ctid)
 {
 	void	   *sscan;
-	OIndexDescr *idx;
-	Tuplesortstate **sortstates;
-	Tuplesortstate *toastSortState;
 	TupleTableSlot *primarySlot;
+	OIndexDescr *idx;
 	int			i;
-	Relation	tableRelation;
-	double		heap_tuples,
-			   *index_tuples;
-	uint64		ctid;
-	CheckpointFileHeader *fileHeaders;
-	CheckpointFileHeader toastFileHeader;
-	S3TaskLocation maxLocation = 0,
-				location;
-
-	sortstates = (Tuplesortstate **) palloc(sizeof(Tuplesortstate *) *
-											descr->nIndices);
-	fileHeaders = (CheckpointFileHeader *) palloc(sizeof(CheckpointFileHeader) *
-												  descr->nIndices);
 
-	for (i = 0; i < descr->nIndices; i++)
-	{
-		idx = descr->indices[i];
-		sortstates[i] = tuplesort_begin_orioledb_index(idx, work_mem, false, NULL);
-	}
 	primarySlot = MakeSingleTupleTableSlot(old_descr->tupdesc, &TTSOpsOrioleDB);
+	sscan = make_btree_seq_scan(&GET_PRIMARY(old_descr)->desc,
+								COMMITSEQNO_INPROGRESS, poscan);
 
-	btree_open_smgr(&descr->toast->desc);
-	toastSortState = tuplesort_begin_orioledb_toast(descr->toast,
-													descr->indices[0],
-													work_mem, false, NULL);
-
-	sscan = make_btree_seq_scan(&GET_PRIMARY(old_descr)->desc, COMMITSEQNO_INPROGRESS, NULL);
-
-	heap_tuples = 0;
-	ctid = 0;
-	index_tuples = palloc0(sizeof(double) * descr->nIndices);
-	while (scan_getnextslot_allattrs(sscan, old_descr, primarySlot, &heap_tuples))
+	*heap_tuples = 0;
+	while (scan_getnextslot_allattrs(sscan, old_descr, primarySlot, heap_tuples))
 	{
 		tts_orioledb_detoast(primarySlot);
 		tts_orioledb_toast(primarySlot, descr);
@@ -1450,10 +1496,11 @@ rebuild_indices(OTable *old_o_table, OTableDescr *old_descr,
 			{
 				if (idx->primaryIsCtid)
 				{
-					primarySlot->tts_tid.ip_posid = (OffsetNumber) ctid;
+					Assert(poscan == NULL);
+					primarySlot->tts_tid.ip_posid = (OffsetNumber) *ctid;
 					BlockIdSet(&primarySlot->tts_tid.ip_blkid,
-							   (uint32) (ctid >> 16));
-					ctid++;
+							   (uint32) (*ctid >> 16));
+					(*ctid)++;
 				}
 				newTup = tts_orioledb_form_orphan_tuple(primarySlot, descr);
 			}
@@ -1474,6 +1521,184 @@ rebuild_indices(OTable *old_o_table, OTableDescr *old_descr,
 
 	ExecDropSingleTupleTableSlot(primarySlot);
 	free_btree_seq_scan(sscan);
+}
+
+/*
+ * Perform a worker's portion of a parallel rebuild of all the table indices.
+ * Single scan of the old primary tree feeds the worker tuplesorts of every
+ * new index and TOAST.
+ */
+static void
+rebuild_indices_worker_sort(oIdxSpool *btspool, void *bt_shared,
+							Sharedsort *sharedsort, int sortmem,
+							bool progress)
+{
+	oIdxShared *btshared = (oIdxShared *) bt_shared;
+	OTableDescr *descr = btspool->descr;
+	Tuplesortstate **sortstates;
+	double	   *indtuples,
+				heaptuples;
+	int			nsorts = btshared->nsharedsorts;
+	int			i;
+
+	Assert(nsorts == descr->nIndices + 1);
+	Assert(btspool->old_descr != NULL);
+
+	/* Memory is distributed between all the tuplesorts of participant */
+	sortmem = Max(sortmem / nsorts, 64);
+	sortstates = (Tuplesortstate **) palloc0(sizeof(Tuplesortstate *) * nsorts);
+	indtuples = (double *) palloc0(sizeof(double) * descr->nIndices);
+
+	for (i = 0; i < nsorts; i++)
+	{
+		SortCoordinate coordinate;
+
+		coordinate = palloc0(sizeof(SortCoordinateData));
+		coordinate->isWorker = true;
+		coordinate->nParticipants = -1;
+		coordinate->sharedsort = o_index_shared_sort(sharedsort,
+													 btshared->scantuplesortstates,
+													 i);
+		if (i < descr->nIndices)
+			sortstates[i] = tuplesort_begin_orioledb_index(descr->indices[i],
+														   sortmem, false,
+														   coordinate);
+		else
+			sortstates[i] = tuplesort_begin_orioledb_toast(descr->toast,
+														   descr->indices[0],
+														   sortmem, false,
+														   coordinate);
+	}
+
+	rebuild_indices_heap_scan(btspool->old_descr, descr, &btshared->poscan,
+							  sortstates, sortstates[descr->nIndices],
+							  &heaptuples, indtuples, NULL);
+
+	o_set_syscache_hooks();
+	for (i = 0; i < nsorts; i++)
+		tuplesort_performsort(sortstates[i]);
+	o_unset_syscache_hooks();
+
+	SpinLockAcquire(&btshared->mutex);
+	btshared->nparticipantsdone++;
+	btshared->reltuples += heaptuples;
+	for (i = 0; i < descr->nIndices; i++)
+		btshared->indtuples[i] += indtuples[i];
+	SpinLockRelease(&btshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&btshared->workersdonecv);
+
+	for (i = 0; i < nsorts; i++)
+		tuplesort_end(sortstates[i]);
+	pfree(sortstates);
+	pfree(indtuples);
+}
+
+void
+rebuild_indices(OTable *old_o_table, OTableDescr *old_descr,
+				OTable *o_table, OTableDescr *descr)
+{
+	OIndexDescr *idx;
+	Tuplesortstate **sortstates;
+	Tuplesortstate *toastSortState;
+	int			i;
+	Relation	tableRelation;
+	double		heap_tuples,
+			   *index_tuples;
+	uint64		ctid;
+	CheckpointFileHeader *fileHeaders;
+	CheckpointFileHeader toastFileHeader;
+	S3TaskLocation maxLocation = 0,
+				location;
+	oIdxSpool  *btspool = NULL;
+	oIdxBuildState buildstate;
+	SortCoordinate coordinate = NULL;
+
+	sortstates = (Tuplesortstate **) palloc(sizeof(Tuplesortstate *) *
+											descr->nIndices);
+	fileHeaders = (CheckpointFileHeader *) palloc(sizeof(CheckpointFileHeader) *
+												  descr->nIndices);
+	index_tuples = palloc0(sizeof(double) * descr->nIndices);
+
+	buildstate.btleader = NULL;
+
+	/*
+	 * Scan the old primary tree in parallel workers if possible.  Sequential
+	 * ctids of the new primary index can't be assigned in parallel.  Also,
+	 * recovery workers have a room for the single shared tuplesort.
+	 */
+	if (max_parallel_maintenance_workers > 0 &&
+		!is_recovery_in_progress() &&
+		!GET_PRIMARY(descr)->primaryIsCtid &&
+		descr->nIndices <= INDEX_MAX_KEYS)
+	{
+		btspool = (oIdxSpool *) palloc0(sizeof(oIdxSpool));
+		btspool->o_table = o_table;
+		btspool->descr = descr;
+		btspool->old_o_table = old_o_table;
+		btspool->old_descr = old_descr;
+
+		buildstate.worker_heap_sort_fn = &rebuild_indices_worker_sort;
+		buildstate.ix_num = InvalidIndexNumber;
+		buildstate.nsharedsorts = descr->nIndices + 1;
+		buildstate.spool = btspool;
+
+		_o_index_begin_parallel(&buildstate, false,
+								max_parallel_maintenance_workers);
+	}
+
+	if (buildstate.btleader)
+	{
+		coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+		coordinate->isWorker = false;
+		coordinate->nParticipants =
+			buildstate.btleader->nparticipanttuplesorts;
+	}
+
+	for (i = 0; i < descr->nIndices; i++)
+	{
+		SortCoordinate ixCoordinate = NULL;
+
+		idx = descr->indices[i];
+		if (coordinate)
+		{
+			ixCoordinate = (SortCoordinate) palloc(sizeof(SortCoordinateData));
+			*ixCoordinate = *coordinate;
+			ixCoordinate->sharedsort = o_index_shared_sort(buildstate.btleader->sharedsort,
+														   buildstate.btleader->btshared->scantuplesortstates,
+														   i);
+		}
+		sortstates[i] = tuplesort_begin_orioledb_index(idx, work_mem, false,
+													   ixCoordinate);
+	}
+
+	btree_open_smgr(&descr->toast->desc);
+	if (coordinate)
+		coordinate->sharedsort = o_index_shared_sort(buildstate.btleader->sharedsort,
+													 buildstate.btleader->btshared->scantuplesortstates,
+													 descr->nIndices);
+	toastSortState = tuplesort_begin_orioledb_toast(descr->toast,
+													descr->indices[0],
+													work_mem, false,
+													coordinate);
+
+	ctid = 0;
+	if (!buildstate.btleader)
+	{
+		/* Serial scan */
+		rebuild_indices_heap_scan(old_descr, descr, NULL,
+								  sortstates, toastSortState,
+								  &heap_tuples, index_tuples, &ctid);
+	}
+	else
+	{
+		/* We are on leader.  Wait until workers end their scans */
+		_o_index_parallel_heapscan(&buildstate);
+		heap_tuples = buildstate.btleader->btshared->reltuples;
+		for (i = 0; i < descr->nIndices; i++)
+			index_tuples[i] = buildstate.btleader->btshared->indtuples[i];
+	}
 
 	o_set_syscache_hooks();
 	for (i = 0; i < descr->nIndices; i++)
@@ -1494,6 +1719,12 @@ rebuild_indices(OTable *old_o_table, OTableDescr *old_descr,
 	tuplesort_end(toastSortState);
 	o_unset_syscache_hooks();
 
+	if (buildstate.btleader)
+	{
+		pfree(btspool);
+		_o_index_end_parallel(buildstate.btleader);
+	}
+
 	/*
 	 * Write the file headers.  We need to write the correct checkpoint
 	 * number, meta lock will prevent checkpointer from walking through.
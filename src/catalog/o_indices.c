@@ -624,6 +624,9 @@ make_o_index(OTable *table, OIndexNumber ixNum)
 
 		index = make_secondary_o_index(table, tableIndex);
 	}
+	index->buffersMinPages = table->buffers_min_pages;
+	index->buffersMaxPercent = table->buffers_max_percent;
+	index->buffersPriority = table->buffers_priority;
 	return index;
 }
 
@@ -664,6 +667,46 @@ attrnumber_cmp(const void *p1, const void *p2)
 	return 0;
 }
 
+/*
+ * Checks if the index predicate consists only of "column IS [NOT] NULL"
+ * clauses and remembers them for the fast path of
+ * o_is_index_predicate_satisfied().
+ */
+static void
+o_index_fill_predicate_null_tests(OIndexDescr *descr)
+{
+	ListCell   *lc;
+	int			i = 0;
+
+	descr->nPredicateNullTests = 0;
+	if (descr->predicate == NIL)
+		return;
+
+	foreach(lc, descr->predicate)
+	{
+		NullTest   *ntest = (NullTest *) lfirst(lc);
+
+		if (!IsA(ntest, NullTest) || ntest->argisrow ||
+			!IsA(ntest->arg, Var) ||
+			((Var *) ntest->arg)->varattno <= 0)
+			return;
+	}
+
+	descr->predicateNullTestAttnums = palloc(sizeof(AttrNumber) *
+											 list_length(descr->predicate));
+	descr->predicateNullTestIsNull = palloc(sizeof(bool) *
+											list_length(descr->predicate));
+	foreach(lc, descr->predicate)
+	{
+		NullTest   *ntest = (NullTest *) lfirst(lc);
+
+		descr->predicateNullTestAttnums[i] = ((Var *) ntest->arg)->varattno;
+		descr->predicateNullTestIsNull[i] = ntest->nulltesttype == IS_NULL;
+		i++;
+	}
+	descr->nPredicateNullTests = i;
+}
+
 void
 o_index_fill_descr(OIndexDescr *descr, OIndex *oIndex, OTable *oTable)
 {
@@ -801,6 +844,8 @@ o_index_fill_descr(OIndexDescr *descr, OIndex *oIndex, OTable *oTable)
 		descr->predicate_str = pstrdup(oIndex->predicate_str);
 	descr->expressions = list_copy_deep(oIndex->expressions);
 
+	o_index_fill_predicate_null_tests(descr);
+
 	o_set_syscache_hooks();
 	descr->predicate_state = ExecInitQual(descr->predicate, NULL);
 	descr->expressions_state = NIL;
@@ -835,6 +880,9 @@ o_index_fill_descr(OIndexDescr *descr, OIndex *oIndex, OTable *oTable)
 		   oIndex->primaryFieldsAttnums,
 		   descr->nPrimaryFields * sizeof(descr->primaryFieldsAttnums[0]));
 	descr->compress = oIndex->compress;
+	descr->buffersMinPages = oIndex->buffersMinPages;
+	descr->buffersMaxPercent = oIndex->buffersMaxPercent;
+	descr->buffersPriority = oIndex->buffersPriority;
 
 	fillFixedFormatSpec(descr->leafTupdesc, &descr->leafSpec,
 						(oIndex->indexType == oIndexPrimary),
@@ -46,16 +46,20 @@
 #include "executor/functions.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "storage/sinval.h"
 #include "utils/builtins.h"
 #include "utils/fmgrtab.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
+#include "utils/memdebug.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 
 typedef struct OSysCacheHashTreeEntry
 {
 	OSysCache  *sys_cache;		/* If NULL only link stored */
+	bool		negative;		/* entry is a copy of the key, which is absent
+								 * in the sys tree */
 	Pointer		entry;
 } OSysCacheHashTreeEntry;
 typedef struct OSysCacheHashEntry
@@ -73,6 +77,11 @@ typedef struct OCacheIdMapEntry
 	OSysCache  *sys_cache;
 } OCacheIdMapEntry;
 
+static Pointer o_sys_cache_search_internal(OSysCache *sys_cache, int nkeys,
+										   OSysCacheKey *key,
+										   bool use_negative);
+static void o_sys_cache_drop_negative(OSysCache *sys_cache,
+									  OSysCacheKey *key);
 static Pointer o_sys_cache_get_from_tree(OSysCache *sys_cache,
 										 int nkeys,
 										 OSysCacheKey *key);
@@ -393,7 +402,10 @@ invalidate_fastcache_entry(int cacheid, uint32 hashvalue)
 						   sizeof(OSysCacheHashKey));
 					sys_cache->last_fast_cache_entry = NULL;
 				}
-				tree_entry->sys_cache->funcs->free_entry(tree_entry->entry);
+				if (tree_entry->negative)
+					pfree(tree_entry->entry);
+				else
+					tree_entry->sys_cache->funcs->free_entry(tree_entry->entry);
 			}
 		}
 		list_free_deep(fast_cache_entry->tree_entries);
@@ -427,6 +439,42 @@ orioledb_setup_syscache_hooks(void)
 
 Pointer
 o_sys_cache_search(OSysCache *sys_cache, int nkeys, OSysCacheKey *key)
+{
+	return o_sys_cache_search_internal(sys_cache, nkeys, key, true);
+}
+
+/*
+ * Checks if negative entries could be cached for the sys cache.  Keys
+ * containing names are stored by reference, so they are not copied.  During
+ * recovery entries are added by WAL replay, which doesn't send
+ * invalidations.
+ */
+static bool
+o_sys_cache_negative_allowed(OSysCache *sys_cache)
+{
+	int			i;
+
+	if (is_recovery_in_progress())
+		return false;
+
+	for (i = 0; i < sys_cache->nkeys; i++)
+	{
+		if (sys_cache->keytypes[i] == NAMEOID)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Searches for the sys cache entry in the backend-local fast cache first, and
+ * then in the sys tree.  Misses are also cached if use_negative is true: the
+ * negative entries are invalidated the same way as regular ones, and also
+ * by o_sys_cache_add().  Callers modifying the sys tree pass
+ * use_negative = false to always check the tree itself.
+ */
+static Pointer
+o_sys_cache_search_internal(OSysCache *sys_cache, int nkeys,
+							OSysCacheKey *key, bool use_negative)
 {
 	bool		found = false;
 	OSysCacheHashKey cur_fast_cache_key;
@@ -460,6 +508,7 @@ o_sys_cache_search(OSysCache *sys_cache, int nkeys, OSysCacheKey *key)
 	if (found)
 	{
 		ListCell   *lc;
+		OSysCacheHashTreeEntry *negative_entry = NULL;
 
 		foreach(lc, fast_cache_entry->tree_entries)
 		{
@@ -477,6 +526,13 @@ o_sys_cache_search(OSysCache *sys_cache, int nkeys, OSysCacheKey *key)
 					o_sys_cache_key_cmp(sys_cache, sys_cache->nkeys,
 										sys_cache_key, key) == 0)
 				{
+					if (tree_entry->negative)
+					{
+						if (use_negative)
+							return NULL;
+						negative_entry = tree_entry;
+						break;
+					}
 					memcpy(&sys_cache->last_fast_cache_key,
 						   &cur_fast_cache_key,
 						   sizeof(OSysCacheHashKey));
@@ -485,6 +541,16 @@ o_sys_cache_search(OSysCache *sys_cache, int nkeys, OSysCacheKey *key)
 				}
 			}
 		}
+
+		/* The tree is going to be checked, the negative entry is useless */
+		if (negative_entry)
+		{
+			fast_cache_entry->tree_entries =
+				list_delete_ptr(fast_cache_entry->tree_entries,
+								negative_entry);
+			pfree(negative_entry->entry);
+			pfree(negative_entry);
+		}
 	}
 	else
 		fast_cache_entry->tree_entries = NIL;
@@ -496,6 +562,23 @@ o_sys_cache_search(OSysCache *sys_cache, int nkeys, OSysCacheKey *key)
 		tree_entry = o_sys_cache_get_from_tree(sys_cache, nkeys, key);
 	if (tree_entry == NULL)
 	{
+		if (use_negative && o_sys_cache_negative_allowed(sys_cache))
+		{
+			Size		key_len = offsetof(OSysCacheKey, keys) +
+				sizeof(Datum) * sys_cache->nkeys;
+			OSysCacheKey *negative_key = palloc0(key_len);
+
+			negative_key->common.datoid = key->common.datoid;
+			memcpy(negative_key->keys, key->keys,
+				   sizeof(Datum) * sys_cache->nkeys);
+
+			new_entry = palloc0(sizeof(OSysCacheHashTreeEntry));
+			new_entry->sys_cache = sys_cache;
+			new_entry->negative = true;
+			new_entry->entry = (Pointer) negative_key;
+			fast_cache_entry->tree_entries =
+				lappend(fast_cache_entry->tree_entries, new_entry);
+		}
 		MemoryContextSwitchTo(prev_context);
 		return NULL;
 	}
@@ -740,9 +823,70 @@ o_sys_cache_add(OSysCache *sys_cache, OSysCacheKey *key, Pointer entry)
 	}
 	if (allocated)
 		pfree(entry);
+	if (inserted)
+		o_sys_cache_drop_negative(sys_cache, key);
 	return inserted;
 }
 
+/*
+ * Invalidates negative entries for the key, which was just added to the
+ * sys tree.  Local fast cache is fixed in place.  Other backends receive the
+ * catcache invalidation message for the key hash value, which is handled by
+ * orioledb_syscache_hook().
+ */
+static void
+o_sys_cache_drop_negative(OSysCache *sys_cache, OSysCacheKey *key)
+{
+	SharedInvalidationMessage msg;
+	OSysCacheHashKey hash_key;
+	OSysCacheHashEntry *fast_cache_entry;
+
+	if (!o_sys_cache_negative_allowed(sys_cache))
+		return;
+
+	hash_key = compute_hash_value(sys_cache->cc_hashfunc, sys_cache->nkeys,
+								  key);
+
+	fast_cache_entry = (OSysCacheHashEntry *)
+		hash_search(sys_cache->fast_cache, &hash_key, HASH_FIND, NULL);
+	if (fast_cache_entry)
+	{
+		ListCell   *lc;
+
+		foreach(lc, fast_cache_entry->tree_entries)
+		{
+			OSysCacheHashTreeEntry *tree_entry;
+			OSysCacheKey *sys_cache_key;
+
+			tree_entry = (OSysCacheHashTreeEntry *) lfirst(lc);
+			sys_cache_key = (OSysCacheKey *) tree_entry->entry;
+
+			if (tree_entry->sys_cache == sys_cache && tree_entry->negative &&
+				sys_cache_key->common.datoid == key->common.datoid &&
+				o_sys_cache_key_cmp(sys_cache, sys_cache->nkeys,
+									sys_cache_key, key) == 0)
+			{
+				fast_cache_entry->tree_entries =
+					list_delete_ptr(fast_cache_entry->tree_entries,
+									tree_entry);
+				pfree(tree_entry->entry);
+				pfree(tree_entry);
+				break;
+			}
+		}
+	}
+
+	/* The sys caches are shared between databases */
+	msg.cc.id = sys_cache->cacheId;
+	msg.cc.dbId = InvalidOid;
+	msg.cc.hashValue = hash_key;
+
+	/* check AddCatcacheInvalidationMessage() for an explanation */
+	VALGRIND_MAKE_MEM_DEFINED(&msg, sizeof(msg));
+
+	SendSharedInvalidMessages(&msg, 1);
+}
+
 static OBTreeWaitCallbackAction
 o_sys_cache_wait_callback(BTreeDescr *descr,
 						  OTuple tup, OTuple *newtup, OXid oxid,
@@ -867,7 +1011,8 @@ o_sys_cache_add_if_needed(OSysCache *sys_cache, OSysCacheKey *key, Pointer arg)
 
 	o_sys_cache_lock(sys_cache, key, AccessExclusiveLock);
 
-	entry = o_sys_cache_search(sys_cache, sys_cache->nkeys, key);
+	entry = o_sys_cache_search_internal(sys_cache, sys_cache->nkeys, key,
+										false);
 	found = entry != NULL;
 
 	if (found)
@@ -900,7 +1045,8 @@ o_sys_cache_update_if_needed(OSysCache *sys_cache, OSysCacheKey *key,
 	o_sys_cache_lock(sys_cache, key, AccessExclusiveLock);
 
 	o_sys_cache_set_datoid_lsn(&key->common.lsn, NULL);
-	entry = o_sys_cache_search(sys_cache, sys_cache->nkeys, key);
+	entry = o_sys_cache_search_internal(sys_cache, sys_cache->nkeys, key,
+										false);
 	if (entry == NULL)
 	{
 		/* it's not exist in B-tree */
@@ -922,7 +1068,8 @@ o_sys_cache_delete(OSysCache *sys_cache, OSysCacheKey *key)
 	OSysCacheKey *sys_cache_key;
 
 	o_sys_cache_set_datoid_lsn(&key->common.lsn, NULL);
-	entry = o_sys_cache_search(sys_cache, sys_cache->nkeys, key);
+	entry = o_sys_cache_search_internal(sys_cache, sys_cache->nkeys, key,
+										false);
 
 	if (entry == NULL)
 		return false;
@@ -44,6 +44,7 @@
 #include "optimizer/optimizer.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
+#include "storage/proc.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -635,6 +636,9 @@ o_table_tableam_create(ORelOids oids, TupleDesc tupdesc, char relpersistence)
 	o_table->default_compress = InvalidOCompress;
 	o_table->primary_compress = InvalidOCompress;
 	o_table->toast_compress = InvalidOCompress;
+	o_table->buffers_min_pages = 0;
+	o_table->buffers_max_percent = 0;
+	o_table->buffers_priority = OBuffersPriorityNormal;
 	o_table->temp = relpersistence == RELPERSISTENCE_TEMP;
 
 	for (i = 0; i < tupdesc->natts; i++)
@@ -1848,17 +1852,30 @@ o_tables_swap_relnodes(OTable *old_o_table, OTable *new_o_table)
 	new_o_table->default_compress = old_o_table->default_compress;
 	new_o_table->primary_compress = old_o_table->primary_compress;
 	new_o_table->toast_compress = old_o_table->toast_compress;
+	new_o_table->buffers_min_pages = old_o_table->buffers_min_pages;
+	new_o_table->buffers_max_percent = old_o_table->buffers_max_percent;
+	new_o_table->buffers_priority = old_o_table->buffers_priority;
 }
 
 static int	recovery_num_o_tables_meta_locks = 0;
 
+/*
+ * Metadata changes of different processes take different partitions of the
+ * metadata lock, so they don't contend on the single lock.
+ */
+static inline LWLock *
+o_tables_meta_lock_partition(void)
+{
+	return &checkpoint_state->oTablesMetaLocks[MyProc->pgprocno % O_TABLES_META_NUM_LOCKS].lock;
+}
+
 void
 o_tables_meta_lock(void)
 {
 	if (!is_recovery_process())
 	{
-		Assert(!LWLockHeldByMe(&checkpoint_state->oTablesMetaLock));
-		LWLockAcquire(&checkpoint_state->oTablesMetaLock, LW_SHARED);
+		Assert(!LWLockHeldByMe(o_tables_meta_lock_partition()));
+		LWLockAcquire(o_tables_meta_lock_partition(), LW_SHARED);
 
 		/* Make sure we've acquired oxid */
 		(void) get_current_oxid();
@@ -1867,7 +1884,7 @@ o_tables_meta_lock(void)
 	else
 	{
 		if (recovery_num_o_tables_meta_locks++ == 0)
-			LWLockAcquire(&checkpoint_state->oTablesMetaLock, LW_SHARED);
+			LWLockAcquire(o_tables_meta_lock_partition(), LW_SHARED);
 	}
 }
 
@@ -1876,17 +1893,40 @@ o_tables_meta_lock_no_wal(void)
 {
 	if (!is_recovery_process())
 	{
-		LWLockAcquire(&checkpoint_state->oTablesMetaLock, LW_SHARED);
+		LWLockAcquire(o_tables_meta_lock_partition(), LW_SHARED);
 	}
 	else
 	{
 		if (recovery_num_o_tables_meta_locks++ == 0)
-			LWLockAcquire(&checkpoint_state->oTablesMetaLock, LW_SHARED);
+			LWLockAcquire(o_tables_meta_lock_partition(), LW_SHARED);
 	}
 }
 
 /*
- * Release oTablesMetaLock and WAL-log the information required to replay
+ * Takes all the partitions of the metadata lock exclusively.  That waits for
+ * the metadata changes in progress and blocks the new ones.
+ */
+void
+o_tables_meta_lock_all(void)
+{
+	int			i;
+
+	for (i = 0; i < O_TABLES_META_NUM_LOCKS; i++)
+		LWLockAcquire(&checkpoint_state->oTablesMetaLocks[i].lock,
+					  LW_EXCLUSIVE);
+}
+
+void
+o_tables_meta_unlock_all(void)
+{
+	int			i;
+
+	for (i = O_TABLES_META_NUM_LOCKS - 1; i >= 0; i--)
+		LWLockRelease(&checkpoint_state->oTablesMetaLocks[i].lock);
+}
+
+/*
+ * Release the metadata lock and WAL-log the information required to replay
  * DDL changes.
  */
 void
@@ -1897,12 +1937,12 @@ o_tables_meta_unlock(ORelOids oids, Oid oldRelnode)
 		add_o_tables_meta_unlock_wal_record(oids, oldRelnode);
 		(void) flush_local_wal(false);
 
-		LWLockRelease(&checkpoint_state->oTablesMetaLock);
+		LWLockRelease(o_tables_meta_lock_partition());
 	}
 	else
 	{
 		if (--recovery_num_o_tables_meta_locks == 0)
-			LWLockRelease(&checkpoint_state->oTablesMetaLock);
+			LWLockRelease(o_tables_meta_lock_partition());
 	}
 }
 
@@ -1911,11 +1951,11 @@ o_tables_meta_unlock_no_wal(void)
 {
 	if (!is_recovery_process())
 	{
-		LWLockRelease(&checkpoint_state->oTablesMetaLock);
+		LWLockRelease(o_tables_meta_lock_partition());
 	}
 	else
 	{
 		if (--recovery_num_o_tables_meta_locks == 0)
-			LWLockRelease(&checkpoint_state->oTablesMetaLock);
+			LWLockRelease(o_tables_meta_lock_partition());
 	}
 }
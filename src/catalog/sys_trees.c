@@ -17,6 +17,7 @@
 
 #include "btree/check.h"
 #include "btree/iterator.h"
+#include "btree/page_contents.h"
 #include "catalog/sys_trees.h"
 #include "catalog/o_sys_cache.h"
 #include "checkpoint/checkpoint.h"
@@ -380,6 +381,7 @@ static SysTreeDescr sysTreesDescrs[SYS_TREES_NUM];
 PG_FUNCTION_INFO_V1(orioledb_sys_tree_structure);
 PG_FUNCTION_INFO_V1(orioledb_sys_tree_check);
 PG_FUNCTION_INFO_V1(orioledb_sys_tree_rows);
+PG_FUNCTION_INFO_V1(orioledb_sys_tree_stats);
 
 /*
  * Returns size of the shared memory needed for enum tree header.
@@ -479,6 +481,56 @@ orioledb_sys_tree_structure(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(cstring_to_text(buf.data));
 }
 
+/*
+ * Returns the number of resident and loaded pages for each sys tree.
+ */
+Datum
+orioledb_sys_tree_stats(PG_FUNCTION_ARGS)
+{
+	Datum		values[3];
+	bool		nulls[3];
+	int			i;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+
+	orioledb_check_shmem();
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	for (i = 1; i <= SYS_TREES_NUM; i++)
+	{
+		BTreeDescr *td = get_sys_tree(i);
+		BTreeMetaPage *meta;
+
+		o_btree_load_shmem(td);
+		meta = BTREE_GET_META(td);
+
+		values[0] = Int32GetDatum(i);
+		values[1] = Int64GetDatum((int64) pg_atomic_read_u32(&meta->numResidentPages));
+		values[2] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numLoadedPages));
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 Datum
 orioledb_sys_tree_check(PG_FUNCTION_ARGS)
 {
@@ -698,12 +750,27 @@ sys_tree_init(int i, bool init_shmem)
 	ops->cmp = meta->cmpFunc;
 	ops->unique_hash = NULL;
 	ops->hash = sys_tree_hash;
+	ops->int_search_key = NULL;
+	ops->separator_key = NULL;
+	ops->key_hash = NULL;
 
 	descr->compress = InvalidOCompress;
 	descr->ppool = pool;
 	descr->undoType = meta->undoReserveType;
 	descr->storageType = meta->storageType;
 	descr->createOxid = InvalidOXid;
+	descr->rightmostLeafBlkno = OInvalidInMemoryBlkno;
+	descr->rightmostLeafChangeCount = InvalidOPageChangeCount;
+	descr->localFindHits = 0;
+	descr->localFindMisses = 0;
+	memset(descr->localOps, 0, sizeof(descr->localOps));
+	descr->localOpsTotal = 0;
+	descr->localUndoBytes = 0;
+	descr->localCtid = 0;
+	descr->localCtidEnd = 0;
+	descr->buffersMinPages = 0;
+	descr->buffersMaxPercent = 0;
+	descr->buffersPriority = OBuffersPriorityNormal;
 
 	if (descr->storageType == BTreeStoragePersistence)
 	{
@@ -38,22 +38,33 @@
 #include "tableam/toast.h"
 #include "transam/oxid.h"
 #include "transam/undo.h"
+#include "utils/o_latency.h"
+#include "utils/o_probes.h"
 #include "utils/page_pool.h"
 #include "utils/seq_buf.h"
 #include "utils/stopevent.h"
 #include "utils/ucm.h"
+#include "workers/prewarm.h"
 
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "portability/instr_time.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/interrupt.h"
 #include "storage/bufmgr.h"
 #include "storage/proc.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/timestamp.h"
 
 #define CONTROL_FILENAME ORIOLEDB_DATA_DIR"/control"
 
+/* Limits for merging written extents into a single writeback request */
+#define WRITEBACK_MAX_LEN	1024
+#define WRITEBACK_MAX_GAP	16
+
 /*
  * Single action in B-tree checkpoint loop.
  */
@@ -149,10 +160,15 @@ static char *xidFilename = NULL;
 static uint32 xidFileCheckpointnum = 0;
 static File xidFile = -1;
 static S3TaskLocation maxLocation = 0;
+static TimestampTz throttle_start = 0;
+static uint64 throttle_bytes = 0;
+static uint64 throttle_ios = 0;
 
 static void init_writeback(CheckpointWriteBack *writeback, int flags, bool isCompressed);
 static void writeback_put_extent(CheckpointWriteBack *writeback, FileExtent *extent);
+static void checkpoint_throttle(CheckpointWriteBack *writeback, uint64 bytes);
 static void perform_writeback(BTreeDescr *desc, CheckpointWriteBack *writeback);
+static void checkpoint_drain_xids_queue(void);
 static void free_writeback(CheckpointWriteBack *writeback);
 
 static void write_checkpoint_control(CheckpointControl *control);
@@ -165,6 +181,9 @@ static int	file_extents_len_off_cmp(const void *a, const void *b);
 static int	file_extents_off_len_cmp(const void *a, const void *b);
 static int	file_extents_writeback_cmp(const void *a, const void *b);
 
+static void sort_free_blocks_file(File file, const char *filename, off_t start,
+								  uint64 nitems, Size itemsize,
+								  int (*cmp) (const void *, const void *));
 static void sort_checkpoint_map_file(BTreeDescr *descr, int cur_chkp_index);
 static void sort_checkpoint_tmp_file(BTreeDescr *descr, int cur_chkp_index);
 static inline void checkpoint_ix_init_state(CheckpointState *state, BTreeDescr *descr);
@@ -275,6 +294,7 @@ checkpoint_shmem_init(Pointer ptr, bool found)
 		pg_atomic_init_u64(&xid_meta->cleanedCheckpointXmax, FirstNormalTransactionId);
 
 		checkpoint_reset_stack(checkpoint_state);
+		checkpoint_state->startTime = 0;
 
 		checkpoint_state->oTablesMetaTrancheId = LWLockNewTrancheId();
 		checkpoint_state->oSysTreesTrancheId = LWLockNewTrancheId();
@@ -283,8 +303,9 @@ checkpoint_shmem_init(Pointer ptr, bool found)
 		checkpoint_state->oXidQueueFlushTrancheId = LWLockNewTrancheId();
 		checkpoint_state->copyBlknoTrancheId = LWLockNewTrancheId();
 		checkpoint_state->oMetaTrancheId = LWLockNewTrancheId();
-		LWLockInitialize(&checkpoint_state->oTablesMetaLock,
-						 checkpoint_state->oTablesMetaTrancheId);
+		for (i = 0; i < O_TABLES_META_NUM_LOCKS; i++)
+			LWLockInitialize(&checkpoint_state->oTablesMetaLocks[i].lock,
+							 checkpoint_state->oTablesMetaTrancheId);
 		LWLockInitialize(&checkpoint_state->oSysTreesLock,
 						 checkpoint_state->oSysTreesTrancheId);
 		for (i = 0; i < SHARED_ROOT_INFO_INSERT_NUM_LOCKS; i++)
@@ -395,8 +416,14 @@ init_writeback(CheckpointWriteBack *writeback, int flags, bool isCompressed)
 static void
 writeback_put_extent(CheckpointWriteBack *writeback, FileExtent *extent)
 {
+	uint64		bytes = (uint64) extent->len *
+		(writeback->isCompressed ? ORIOLEDB_COMP_BLCKSZ : ORIOLEDB_BLCKSZ);
+
 	Assert(extent != NULL);
 
+	checkpoint_state->bytesWritten += bytes;
+	checkpoint_throttle(writeback, bytes);
+
 	if (writeback->extentsNumber >= writeback->extentsAllocated)
 	{
 		writeback->extentsAllocated *= 2;
@@ -411,6 +438,57 @@ writeback_put_extent(CheckpointWriteBack *writeback, FileExtent *extent)
 	writeback->extentsNumber++;
 }
 
+/*
+ * Keeps the average rate of the checkpoint writes within
+ * orioledb.checkpoint_write_rate_limit and orioledb.checkpoint_iops_limit.
+ * The budget is counted from the checkpoint start against the wall clock, so
+ * the time spent by the slow device on the writes themselves is accounted and
+ * the checkpointer sleeps only when it is ahead of the budget.
+ */
+static void
+checkpoint_throttle(CheckpointWriteBack *writeback, uint64 bytes)
+{
+	double		target_usecs = 0.0;
+	long		secs;
+	int			usecs;
+	int64		elapsed_usecs;
+
+	if (checkpoint_write_rate_limit <= 0 && checkpoint_iops_limit <= 0)
+		return;
+
+	/* Don't delay the shutdown and explicitly requested checkpoints */
+	if (writeback->checkpointFlags & (CHECKPOINT_IMMEDIATE | CHECKPOINT_IS_SHUTDOWN))
+		return;
+
+	throttle_bytes += bytes;
+	throttle_ios++;
+
+	if (checkpoint_write_rate_limit > 0)
+		target_usecs = Max(target_usecs,
+						   (double) throttle_bytes * USECS_PER_SEC /
+						   ((double) checkpoint_write_rate_limit * 1024.0 * 1024.0));
+	if (checkpoint_iops_limit > 0)
+		target_usecs = Max(target_usecs,
+						   (double) throttle_ios * USECS_PER_SEC /
+						   (double) checkpoint_iops_limit);
+
+	TimestampDifference(throttle_start, GetCurrentTimestamp(), &secs, &usecs);
+	elapsed_usecs = (int64) secs * USECS_PER_SEC + usecs;
+
+	while (elapsed_usecs < (int64) target_usecs)
+	{
+		/* Sleep in short steps to keep absorbing the fsync requests */
+		pg_usleep(Min((int64) target_usecs - elapsed_usecs, 100000));
+		CheckpointWriteDelay(writeback->checkpointFlags, 1.0);
+
+		if (ShutdownRequestPending)
+			break;
+
+		TimestampDifference(throttle_start, GetCurrentTimestamp(), &secs, &usecs);
+		elapsed_usecs = (int64) secs * USECS_PER_SEC + usecs;
+	}
+}
+
 static void
 perform_writeback(BTreeDescr *desc, CheckpointWriteBack *writeback)
 {
@@ -421,6 +499,8 @@ perform_writeback(BTreeDescr *desc, CheckpointWriteBack *writeback)
 	uint		blcksz = (writeback->isCompressed || use_mmap) ? ORIOLEDB_COMP_BLCKSZ : ORIOLEDB_BLCKSZ;
 	uint32		chkpNum = checkpoint_state->lastCheckpointNumber + 1;
 
+	checkpoint_drain_xids_queue();
+
 	if (use_device && !use_mmap)
 	{
 		writeback->extentsNumber = 0;
@@ -438,9 +518,18 @@ perform_writeback(BTreeDescr *desc, CheckpointWriteBack *writeback)
 			continue;
 		}
 
-		if (writeback->extents[i].off == offset + len && len < 1024)
+		/*
+		 * Merge the extent into the current range when it's adjacent or
+		 * separated by a small gap.  Flushing the few blocks in the gap costs
+		 * nothing if they aren't dirty, while issuing one large request
+		 * instead of many small ones lets the kernel write the whole run
+		 * sequentially.
+		 */
+		if (writeback->extents[i].off >= offset + len &&
+			writeback->extents[i].off <= offset + len + WRITEBACK_MAX_GAP &&
+			len < WRITEBACK_MAX_LEN)
 		{
-			len += writeback->extents[i].len;
+			len = writeback->extents[i].off + writeback->extents[i].len - offset;
 		}
 		else
 		{
@@ -676,6 +765,19 @@ try_flush_xids_queue(void)
 	}
 }
 
+/*
+ * Flush the xid records accumulated in the queue by the checkpointer while
+ * it's writing the trees.  That keeps the queue from filling up, so the
+ * committing backends almost never have to write the xids file themselves.
+ */
+static void
+checkpoint_drain_xids_queue(void)
+{
+	if (pg_atomic_read_u64(&checkpoint_state->xidRecLastPos) >
+		pg_atomic_read_u64(&checkpoint_state->xidRecFlushPos))
+		try_flush_xids_queue();
+}
+
 /*
  * Write single xid record to queue.
  */
@@ -865,6 +967,16 @@ o_perform_checkpoint(XLogRecPtr redo_pos, int flags)
 	checkpoint_state->pagesWritten = 0;
 	checkpoint_state->toastConsistentPtr = InvalidXLogRecPtr;
 
+	throttle_start = GetCurrentTimestamp();
+	throttle_bytes = 0;
+	throttle_ios = 0;
+
+	checkpoint_state->pagesVisited = 0;
+	checkpoint_state->bytesWritten = 0;
+	checkpoint_state->autonomousPages = 0;
+	checkpoint_state->lockWaitTime = 0;
+	checkpoint_state->startTime = throttle_start;
+
 	if (chkp_mem_context == NULL)
 	{
 		chkp_mem_context = AllocSetContextCreate(TopMemoryContext,
@@ -895,7 +1007,7 @@ o_perform_checkpoint(XLogRecPtr redo_pos, int flags)
 	before_writing_xids_file(cur_chkp_num);
 	start_write_xids(cur_chkp_num);
 
-	LWLockAcquire(&checkpoint_state->oTablesMetaLock, LW_EXCLUSIVE);
+	o_tables_meta_lock_all();
 	LWLockAcquire(&checkpoint_state->oSysTreesLock, LW_EXCLUSIVE);
 
 	for (sys_tree_num = 1; sys_tree_num <= SYS_TREES_NUM; sys_tree_num++)
@@ -914,37 +1026,51 @@ o_perform_checkpoint(XLogRecPtr redo_pos, int flags)
 			/* System trees can't be concurrently deleted */
 			Assert(success);
 			if (!orioledb_s3_mode)
-			{
-				sort_checkpoint_map_file(desc, cur_chkp_num % 2);
-				sort_checkpoint_tmp_file(desc, cur_chkp_num % 2);
 				chkp_tbl_arg.cleanupMap = add_map_cleanup_item(chkp_tbl_arg.cleanupMap,
 															   desc);
-			}
 		}
 		else
 		{
 			checkpoint_temporary_tree(flags, desc);
-			if (!orioledb_s3_mode)
-				sort_checkpoint_tmp_file(desc, cur_chkp_num % 2);
 		}
 	}
 
 	/*
 	 * We get start position for replay changes to system trees while holding
-	 * the oTablesMetaLock.  That guarantees that we will start recovery from
-	 * the state there is no partial changes to tables and indices system
-	 * trees.
+	 * all the table metadata locks.  That guarantees that we will start
+	 * recovery from the state there is no partial changes to tables and
+	 * indices system trees.
 	 */
 	checkpoint_state->sysTreesStartPtr = GetXLogInsertRecPtr();
 	LWLockRelease(&checkpoint_state->oSysTreesLock);
-	LWLockRelease(&checkpoint_state->oTablesMetaLock);
+	o_tables_meta_unlock_all();
+
+	/*
+	 * The map and tmp files of this checkpoint are finalized, and the
+	 * concurrent writes go to the files of the next checkpoint.  So, sort
+	 * them after releasing the locks, as we do for the regular trees, to
+	 * avoid blocking DDL for the time of the sorting.
+	 */
+	for (sys_tree_num = 1; sys_tree_num <= SYS_TREES_NUM && !orioledb_s3_mode;
+		 sys_tree_num++)
+	{
+		BTreeDescr *desc;
+
+		if (sys_tree_get_storage_type(sys_tree_num) == BTreeStorageInMemory)
+			continue;
+
+		desc = get_sys_tree(sys_tree_num);
+		if (desc->storageType == BTreeStoragePersistence)
+			sort_checkpoint_map_file(desc, cur_chkp_num % 2);
+		sort_checkpoint_tmp_file(desc, cur_chkp_num % 2);
+	}
 
 	MemoryContextSwitchTo(prev_context);
 	MemoryContextResetOnly(chkp_mem_context);
 
 	enable_stopevents = old_enable_stopevents;
 
-	LWLockAcquire(&checkpoint_state->oTablesMetaLock, LW_EXCLUSIVE);
+	o_tables_meta_lock_all();
 	o_indices_foreach_oids(checkpoint_tables_callback, &chkp_tbl_arg);
 
 	chkp_inc_changecount_before(checkpoint_state);
@@ -956,7 +1082,7 @@ o_perform_checkpoint(XLogRecPtr redo_pos, int flags)
 	checkpoint_state->completed = false;
 	chkp_inc_changecount_after(checkpoint_state);
 
-	LWLockRelease(&checkpoint_state->oTablesMetaLock);
+	o_tables_meta_unlock_all();
 
 	/*
 	 * It might happen there is no secondary indices, but we still need to set
@@ -972,8 +1098,8 @@ o_perform_checkpoint(XLogRecPtr redo_pos, int flags)
 	checkpoint_end_loc = pg_atomic_read_u64(&undo_meta->lastUsedLocation);
 	checkpoint_xmax = pg_atomic_read_u64(&xid_meta->nextXid);
 
-	if (use_mmap)
-		msync(mmap_data, device_length, MS_SYNC);
+	if (use_device)
+		btree_smgr_sync_device();
 
 	fsync_undo_range(checkpoint_start_loc,
 					 checkpoint_end_loc,
@@ -1067,12 +1193,17 @@ o_perform_checkpoint(XLogRecPtr redo_pos, int flags)
 		list_free_deep(chkp_tbl_arg.cleanupMap);
 	}
 
+	/* Save the resident page set for the prewarm after restart */
+	prewarm_dump_resident_pages();
+
 	CheckPointProgress = o_checkpoint_completion_ratio;
 
 	pg_atomic_write_u64(&my_proc_info->xmin, InvalidOXid);
 
 	o_unset_syscache_hooks();
 
+	checkpoint_state->startTime = 0;
+
 	elog(LOG, "orioledb checkpoint %u complete",
 		 checkpoint_state->lastCheckpointNumber);
 
@@ -1096,7 +1227,6 @@ checkpoint_temporary_tree(int flags, BTreeDescr *descr)
 	Oid			datoid = descr->oids.datoid;
 	Oid			relnode = descr->oids.relnode;
 	bool		success;
-	CheckpointWriteBack writeback;
 
 	Assert(!OCompressIsValid(descr->compress));
 
@@ -1133,14 +1263,15 @@ checkpoint_temporary_tree(int flags, BTreeDescr *descr)
 				 errmsg("could not init a new sequence buffer file %s",
 						get_seq_buf_filename(&next_tmp_tag))));
 
-	/* Make checkpoint of the tree itself */
-	init_writeback(&writeback, flags, false);
-	(void) checkpoint_btree(&descr, checkpoint_state, &writeback);
-	(void) perform_writeback_and_relock(descr, &writeback,
-										checkpoint_state, NULL, 0);
-	free_writeback(&writeback);
-
-	Assert(checkpoint_state->curKeyType == CurKeyGreatest);
+	/*
+	 * Temporary tree contents don't survive the restart, so there is no point
+	 * to write its dirty pages.  Pages are written on eviction only, and
+	 * in-place (see perform_page_io()).  The checkpoint just switches the
+	 * tree to the next *.tmp file, so that the free extents get recycled.
+	 */
+	chkp_inc_changecount_before(checkpoint_state);
+	checkpoint_state->curKeyType = CurKeyGreatest;
+	chkp_inc_changecount_after(checkpoint_state);
 
 	STOPEVENT(STOPEVENT_BEFORE_BLKNO_LOCK, NULL);
 
@@ -1342,20 +1473,224 @@ file_extents_writeback_cmp(const void *a, const void *b)
 	return 0;
 }
 
+/*
+ * Reads or writes a part of the free blocks file, FATAL on failure.
+ */
+static void
+free_blocks_file_io(File file, const char *filename, Pointer buf,
+					uint64 size, off_t offset, bool write)
+{
+	while (size > 0)
+	{
+		int			amount = Min(size, MaxAllocSize);
+		int			result;
+
+		if (write)
+			result = OFileWrite(file, buf, amount, offset,
+								WAIT_EVENT_DATA_FILE_WRITE);
+		else
+			result = OFileRead(file, buf, amount, offset,
+							   WAIT_EVENT_DATA_FILE_READ);
+		if (result != amount)
+		{
+			ereport(FATAL, (errcode_for_file_access(),
+							errmsg("Could not %s free blocks file: %s",
+								   write ? "write" : "read", filename)));
+		}
+		buf += amount;
+		offset += amount;
+		size -= amount;
+	}
+}
+
+typedef struct
+{
+	Pointer		buf;			/* read buffer */
+	uint64		pos;			/* next item of the run to read */
+	uint64		end;			/* end of the run */
+	int			nitems;			/* items in the buffer */
+	int			cur;			/* current item in the buffer */
+} FreeBlocksRun;
+
+typedef struct
+{
+	FreeBlocksRun *runs;
+	Size		itemsize;
+	int			(*cmp) (const void *, const void *);
+} FreeBlocksMergeArg;
+
+static int
+free_blocks_run_cmp(Datum a, Datum b, void *arg)
+{
+	FreeBlocksMergeArg *mergeArg = (FreeBlocksMergeArg *) arg;
+	FreeBlocksRun *runA = &mergeArg->runs[DatumGetInt32(a)];
+	FreeBlocksRun *runB = &mergeArg->runs[DatumGetInt32(b)];
+
+	/* binaryheap is a max-heap, so invert the order */
+	return -mergeArg->cmp(runA->buf + runA->cur * mergeArg->itemsize,
+						  runB->buf + runB->cur * mergeArg->itemsize);
+}
+
+static bool
+free_blocks_run_fill(File tmpFile, FreeBlocksRun *run, int bufItems,
+					 Size itemsize)
+{
+	run->nitems = Min(run->end - run->pos, bufItems);
+	run->cur = 0;
+	if (run->nitems == 0)
+		return false;
+	free_blocks_file_io(tmpFile, "temporary file", run->buf,
+						(uint64) run->nitems * itemsize,
+						run->pos * itemsize, false);
+	run->pos += run->nitems;
+	return true;
+}
+
+/*
+ * Sorts nitems items of the free blocks file starting from the given offset.
+ *
+ * The items fitting maintenance_work_mem are sorted in memory.  Otherwise,
+ * the sorted runs are written to a temporary file and then merged back,
+ * so the memory usage doesn't depend on the tree size.
+ */
+static void
+sort_free_blocks_file(File file, const char *filename, off_t start,
+					  uint64 nitems, Size itemsize,
+					  int (*cmp) (const void *, const void *))
+{
+	Size		mem = Min((Size) maintenance_work_mem * 1024, MaxAllocSize);
+	uint64		runItems = Max(mem / itemsize, 2),
+				nruns,
+				written = 0,
+				i;
+	int			bufItems,
+				outItems,
+				nout = 0;
+	Pointer		buf;
+	File		tmpFile;
+	FreeBlocksRun *runs;
+	FreeBlocksMergeArg mergeArg;
+	binaryheap *heap;
+
+	if (nitems == 0)
+		return;
+
+	if (nitems <= runItems)
+	{
+		buf = palloc(nitems * itemsize);
+		free_blocks_file_io(file, filename, buf, nitems * itemsize, start, false);
+		pg_qsort(buf, nitems, itemsize, cmp);
+		free_blocks_file_io(file, filename, buf, nitems * itemsize, start, true);
+		pfree(buf);
+		return;
+	}
+
+	/* produce the sorted runs */
+	tmpFile = OpenTemporaryFile(false);
+	nruns = (nitems + runItems - 1) / runItems;
+	buf = palloc(runItems * itemsize);
+	for (i = 0; i < nruns; i++)
+	{
+		uint64		count = Min(runItems, nitems - i * runItems);
+
+		free_blocks_file_io(file, filename, buf, count * itemsize,
+							start + i * runItems * itemsize, false);
+		pg_qsort(buf, count, itemsize, cmp);
+		free_blocks_file_io(tmpFile, "temporary file", buf, count * itemsize,
+							i * runItems * itemsize, true);
+	}
+	pfree(buf);
+
+	/* merge the runs back to the file, half of memory is for the output */
+	bufItems = Max(runItems / (2 * nruns), 1);
+	outItems = Max(runItems / 2, 1);
+	buf = palloc(outItems * itemsize);
+	runs = palloc(sizeof(FreeBlocksRun) * nruns);
+	mergeArg.runs = runs;
+	mergeArg.itemsize = itemsize;
+	mergeArg.cmp = cmp;
+	heap = binaryheap_allocate(nruns, free_blocks_run_cmp, &mergeArg);
+
+	for (i = 0; i < nruns; i++)
+	{
+		runs[i].buf = palloc(bufItems * itemsize);
+		runs[i].pos = i * runItems;
+		runs[i].end = Min((i + 1) * runItems, nitems);
+		if (free_blocks_run_fill(tmpFile, &runs[i], bufItems, itemsize))
+			binaryheap_add_unordered(heap, Int32GetDatum(i));
+	}
+	binaryheap_build(heap);
+
+	while (!binaryheap_empty(heap))
+	{
+		int			runNum = DatumGetInt32(binaryheap_first(heap));
+		FreeBlocksRun *run = &runs[runNum];
+
+		memcpy(buf + nout * itemsize, run->buf + run->cur * itemsize, itemsize);
+		if (++nout == outItems)
+		{
+			free_blocks_file_io(file, filename, buf, (uint64) nout * itemsize,
+								start + written * itemsize, true);
+			written += nout;
+			nout = 0;
+		}
+
+		if (++run->cur < run->nitems ||
+			free_blocks_run_fill(tmpFile, run, bufItems, itemsize))
+			binaryheap_replace_first(heap, Int32GetDatum(runNum));
+		else
+			(void) binaryheap_remove_first(heap);
+	}
+	if (nout > 0)
+		free_blocks_file_io(file, filename, buf, (uint64) nout * itemsize,
+							start + written * itemsize, true);
+	Assert(written + nout == nitems);
+
+	for (i = 0; i < nruns; i++)
+		pfree(runs[i].buf);
+	pfree(runs);
+	pfree(buf);
+	binaryheap_free(heap);
+	FileClose(tmpFile);
+}
+
+void
+checkpoint_file_header_set_crc(CheckpointFileHeader *header)
+{
+	INIT_CRC32C(header->crc);
+	COMP_CRC32C(header->crc, header, offsetof(CheckpointFileHeader, crc));
+	FIN_CRC32C(header->crc);
+}
+
+/*
+ * Checks the CRC of the map file header read from the given file.
+ */
+void
+checkpoint_file_header_check_crc(CheckpointFileHeader *header,
+								 const char *filename)
+{
+	pg_crc32c	crc;
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, header, offsetof(CheckpointFileHeader, crc));
+	FIN_CRC32C(crc);
+
+	if (crc != header->crc)
+		ereport(FATAL, (errcode(ERRCODE_DATA_CORRUPTED),
+						errmsg("wrong CRC in header of map file %s", filename)));
+}
+
 /*
  * Sort lists of free blocks in .map file to optimize disk access.
  */
 static void
 sort_checkpoint_map_file(BTreeDescr *descr, int cur_chkp_index)
 {
-	Pointer		free_blocks;
-	uint64		free_blocks_size;
 	File		file;
 	char	   *filename;
 	CheckpointFileHeader header = {0};
 	bool		ferror = false,
 				is_compressed = OCompressIsValid(descr->compress);
-	int			read_size;
 
 	filename = get_seq_buf_filename(&descr->nextChkp[cur_chkp_index].tag);
 	file = PathNameOpenFile(filename, O_RDWR | PG_BINARY);
@@ -1375,40 +1710,16 @@ sort_checkpoint_map_file(BTreeDescr *descr, int cur_chkp_index)
 						errmsg("Could not read data from checkpoint map file: %s",
 							   filename)));
 	}
+	checkpoint_file_header_check_crc(&header, filename);
 
 	if (is_compressed || use_device)
-	{
-		free_blocks_size = sizeof(FileExtent) * header.numFreeBlocks;
-	}
+		sort_free_blocks_file(file, filename, sizeof(header), header.numFreeBlocks,
+							  sizeof(FileExtent), file_extents_len_off_cmp);
 	else
-	{
-		free_blocks_size = sizeof(uint32) * header.numFreeBlocks;
-	}
+		sort_free_blocks_file(file, filename, sizeof(header), header.numFreeBlocks,
+							  sizeof(uint32), uint32_offsets_cmp);
 
-	free_blocks = palloc(free_blocks_size);
-	if (free_blocks_size > 0)
-	{
-		read_size = OFileRead(file, (Pointer) free_blocks, free_blocks_size,
-							  sizeof(header), WAIT_EVENT_DATA_FILE_READ);
-
-		if (read_size != free_blocks_size)
-		{
-			ereport(FATAL, (errcode_for_file_access(),
-							errmsg("Could not read data from checkpoint map file: %s",
-								   filename)));
-		}
-	}
-
-	/* sorts blocks */
-	if (is_compressed || use_device)
-		pg_qsort(free_blocks, header.numFreeBlocks, sizeof(FileExtent), file_extents_len_off_cmp);
-	else
-		pg_qsort(free_blocks, header.numFreeBlocks, sizeof(uint32), uint32_offsets_cmp);
-
-	/* writes sorted blocks to map file. */
-	if (OFileWrite(file, (Pointer) free_blocks, free_blocks_size,
-				   sizeof(header), WAIT_EVENT_DATA_FILE_WRITE) != free_blocks_size ||
-		FileSync(file, WAIT_EVENT_SLRU_SYNC) != 0)
+	if (FileSync(file, WAIT_EVENT_SLRU_SYNC) != 0)
 	{
 		ereport(FATAL, (errcode_for_file_access(),
 						errmsg("Could not write sorted data to checkpoint map file: %s",
@@ -1416,7 +1727,6 @@ sort_checkpoint_map_file(BTreeDescr *descr, int cur_chkp_index)
 	}
 	FileClose(file);
 	pfree(filename);
-	pfree(free_blocks);
 }
 
 /*
@@ -1425,12 +1735,10 @@ sort_checkpoint_map_file(BTreeDescr *descr, int cur_chkp_index)
 static void
 sort_checkpoint_tmp_file(BTreeDescr *descr, int cur_chkp_index)
 {
-	Pointer		free_blocks;
 	uint64		free_blocks_size;
 	File		file;
 	char	   *filename;
 	bool		is_compressed = OCompressIsValid(descr->compress);
-	int			read_size;
 
 	filename = get_seq_buf_filename(&descr->tmpBuf[cur_chkp_index].tag);
 	file = PathNameOpenFile(filename, O_RDWR | PG_BINARY);
@@ -1443,36 +1751,17 @@ sort_checkpoint_tmp_file(BTreeDescr *descr, int cur_chkp_index)
 	}
 
 	free_blocks_size = FileSize(file);
-	free_blocks = palloc(free_blocks_size);
-
-	if (free_blocks_size > 0)
-	{
-		read_size = OFileRead(file, (Pointer) free_blocks,
-							  free_blocks_size, 0, WAIT_EVENT_DATA_FILE_READ);
-		if (read_size != free_blocks_size)
-		{
-			ereport(FATAL, (errcode_for_file_access(),
-							errmsg("Could not read data from checkpoint tmp file: %s %d %lu",
-								   filename, read_size, free_blocks_size)));
-		}
-	}
 
-	/* sorts blocks */
 	if (is_compressed || use_device)
-	{
-		pg_qsort(free_blocks, free_blocks_size / sizeof(FileExtent),
-				 sizeof(FileExtent), file_extents_len_off_cmp);
-	}
+		sort_free_blocks_file(file, filename, 0,
+							  free_blocks_size / sizeof(FileExtent),
+							  sizeof(FileExtent), file_extents_len_off_cmp);
 	else
-	{
-		pg_qsort(free_blocks, free_blocks_size / sizeof(uint32),
-				 sizeof(uint32), uint32_offsets_cmp);
-	}
+		sort_free_blocks_file(file, filename, 0,
+							  free_blocks_size / sizeof(uint32),
+							  sizeof(uint32), uint32_offsets_cmp);
 
-	/* writes sorted blocks to tmp file */
-	if (OFileWrite(file, (Pointer) free_blocks,
-				   free_blocks_size, 0, WAIT_EVENT_DATA_FILE_WRITE) != free_blocks_size ||
-		FileSync(file, WAIT_EVENT_SLRU_SYNC) != 0)
+	if (FileSync(file, WAIT_EVENT_SLRU_SYNC) != 0)
 	{
 		ereport(FATAL, (errcode_for_file_access(),
 						errmsg("Could not write sorted data to checkpoint tmp file: %s",
@@ -1481,7 +1770,6 @@ sort_checkpoint_tmp_file(BTreeDescr *descr, int cur_chkp_index)
 
 	FileClose(file);
 	pfree(filename);
-	pfree(free_blocks);
 }
 
 static inline void
@@ -1772,6 +2060,43 @@ chkp_ordering_cmp(OIndexType type1, Oid datoid1, Oid relnode1,
 	return 0;
 }
 
+/*
+ * Returns true if there is a checkpoint in progress, which didn't pass the
+ * given BTree yet.  Dirty pages of such BTree written now would be clean once
+ * the checkpointer reaches them.
+ */
+bool
+checkpoint_is_ahead_of_tree(BTreeDescr *desc)
+{
+	Oid			datoid,
+				relnode;
+	int			before_changecount,
+				after_changecount;
+	OIndexType	type;
+
+	while (true)
+	{
+		chkp_save_changecount_before(checkpoint_state, before_changecount);
+		if (before_changecount & 1)
+			continue;
+
+		type = checkpoint_state->treeType;
+		datoid = checkpoint_state->datoid;
+		relnode = checkpoint_state->relnode;
+
+		chkp_save_changecount_after(checkpoint_state, after_changecount);
+		if (before_changecount != after_changecount)
+			continue;
+
+		if (type == oIndexInvalid)
+			return false;
+
+		return chkp_ordering_cmp(desc->type, desc->oids.datoid,
+								 desc->oids.relnode,
+								 type, datoid, relnode) >= 0;
+	}
+}
+
 /*
  * Determine which checkpoint `blkno` should be written to.
  */
@@ -1967,11 +2292,14 @@ checkpoint_ix(int flags, BTreeDescr *descr)
 	CheckpointWriteBack writeback;
 	off_t		file_length;
 	uint32		chkpNum = checkpoint_state->lastCheckpointNumber + 1;
+	uint64		pages_written = checkpoint_state->pagesWritten;
+	TimestampTz start_time = GetCurrentTimestamp();
 
 	/*
 	 * TODO: can we make checkpoint on evicted or unloaded tree?
 	 */
 	checkpoint_ix_init_state(checkpoint_state, descr);
+	TRACE_ORIOLEDB_CHECKPOINT_TREE_START(datoid, relnode, chkpNum);
 
 	cur_chkp_index = (checkpoint_state->lastCheckpointNumber + 1) % 2;
 	next_chkp_index = (checkpoint_state->lastCheckpointNumber + 2) % 2;
@@ -2060,6 +2388,13 @@ checkpoint_ix(int flags, BTreeDescr *descr)
 		}
 	}
 
+	pg_atomic_fetch_add_u64(&BTREE_GET_META(descr)->numCheckpointPages,
+							checkpoint_state->pagesWritten - pages_written);
+	pg_atomic_fetch_add_u64(&BTREE_GET_META(descr)->checkpointTime,
+							GetCurrentTimestamp() - start_time);
+	TRACE_ORIOLEDB_CHECKPOINT_TREE_DONE(datoid, relnode, chkpNum,
+										checkpoint_state->pagesWritten - pages_written);
+
 	if (is_compressed)
 	{
 		free_extents = file_extents_array_init();
@@ -2086,6 +2421,7 @@ checkpoint_ix(int flags, BTreeDescr *descr)
 	else
 		header.datafileLength = pg_atomic_read_u64(&meta_page->datafileLength[0]);
 	header.leafPagesNum = pg_atomic_read_u32(&meta_page->leafPagesNum);
+	header.numTuples = pg_atomic_read_u64(&meta_page->numTuples);
 	header.ctid = pg_atomic_read_u64(&meta_page->ctid);
 
 	if (!orioledb_s3_mode && !is_compressed)
@@ -2279,6 +2615,7 @@ checkpoint_ix(int flags, BTreeDescr *descr)
 		header.numFreeBlocks = (map_len - sizeof(CheckpointFileHeader)) / sizeof(FileExtent);
 	}
 
+	checkpoint_file_header_set_crc(&header);
 	if (OFileWrite(file, (Pointer) &header, sizeof(header), 0,
 				   WAIT_EVENT_SLRU_WRITE) != sizeof(header) ||
 		FileSync(file, WAIT_EVENT_SLRU_SYNC) != 0)
@@ -2435,8 +2772,15 @@ checkpoint_lock_page(BTreeDescr *descr, CheckpointState *state,
 				page_level;
 	OInMemoryBlkno next_blkno;
 	bool		autonomous;
+	instr_time	start_time,
+				end_time;
 
+	INSTR_TIME_SET_CURRENT(start_time);
 	lock_page(*blkno);
+	INSTR_TIME_SET_CURRENT(end_time);
+	INSTR_TIME_SUBTRACT(end_time, start_time);
+	checkpoint_state->lockWaitTime += INSTR_TIME_GET_MICROSEC(end_time);
+	checkpoint_state->pagesVisited++;
 	page = O_GET_IN_MEMORY_PAGE(*blkno);
 	page_level = PAGE_GET_LEVEL(page);
 	if (page_level == level)
@@ -2834,6 +3178,7 @@ checkpoint_btree_loop(BTreeDescr **descrPtr,
 	uint		blcksz = OCompressIsValid(descr->compress) ? ORIOLEDB_COMP_BLCKSZ : ORIOLEDB_BLCKSZ;
 	Jsonb	   *params;
 	uint32		chkpNum = checkpoint_state->lastCheckpointNumber + 1;
+	instr_time	writeStart;
 
 	memset(&message, 0, sizeof(WalkMessage));
 
@@ -3006,12 +3351,14 @@ checkpoint_btree_loop(BTreeDescr **descrPtr,
 					/* prepare_leaf_page() unlocks page */
 					prepare_leaf_page(descr, state);
 
+					O_LATENCY_START(writeStart);
 					downlink = perform_page_io(descr,
 											   blkno,
 											   state->stack[level].image,
 											   chkpNum,
 											   false,
 											   &parent_dirty);
+					o_latency_report(OLatencyCheckpointWrite, writeStart);
 
 					if (!DiskDownlinkIsValid(downlink))
 					{
@@ -3025,6 +3372,8 @@ checkpoint_btree_loop(BTreeDescr **descrPtr,
 							 btree_smgr_filename(descr, chkpNum, offset),
 							 offset);
 					}
+					pg_atomic_fetch_add_u64(&BTREE_GET_META(descr)->checkpointBytes,
+											disk_downlink_get_bytes(descr, downlink));
 
 					writeback_put_extent(writeback, &page_desc->fileExtent);
 					unlock_io(page_desc->ionum);
@@ -3290,6 +3639,7 @@ autonomous_image_write(BTreeDescr *descr, CheckpointState *state,
 	uint64		downlink;
 	uint32		chkpNum = state->lastCheckpointNumber + 1;
 	FileExtent	extent;
+	instr_time	writeStart;
 
 	/* prepare the image header */
 	img_header = (BTreePageHeader *) img;
@@ -3307,8 +3657,13 @@ autonomous_image_write(BTreeDescr *descr, CheckpointState *state,
 	/* write the image to disk */
 	split_page_by_chunks(descr, img);
 
+	O_LATENCY_START(writeStart);
 	downlink = perform_page_io_autonomous(descr, chkpNum, img, &extent);
+	o_latency_report(OLatencyCheckpointWrite, writeStart);
 	writeback_put_extent(writeback, &extent);
+	checkpoint_state->autonomousPages++;
+	pg_atomic_fetch_add_u64(&BTREE_GET_META(descr)->checkpointBytes,
+							disk_downlink_get_bytes(descr, downlink));
 
 	Assert(DiskDownlinkIsValid(downlink));
 
@@ -3577,6 +3932,7 @@ checkpoint_internal_pass(BTreeDescr *descr, CheckpointState *state,
 				tuple_processed;
 	BTreePageItemLocator loc;
 	uint32		chkpNum = state->lastCheckpointNumber + 1;
+	instr_time	writeStart;
 
 	autonomous = state->stack[level].autonomous;
 	blkno = state->stack[level].blkno;
@@ -4128,12 +4484,14 @@ checkpoint_internal_pass(BTreeDescr *descr, CheckpointState *state,
 			 */
 			split_page_by_chunks(descr, img);
 
+			O_LATENCY_START(writeStart);
 			written_downlink = perform_page_io(descr,
 											   blkno,
 											   img,
 											   chkpNum,
 											   false,
 											   &parent_dirty);
+			o_latency_report(OLatencyCheckpointWrite, writeStart);
 
 			if (!DiskDownlinkIsValid(written_downlink))
 			{
@@ -4148,6 +4506,8 @@ checkpoint_internal_pass(BTreeDescr *descr, CheckpointState *state,
 					 btree_smgr_filename(descr, chkpNum, offset),
 					 offset);
 			}
+			pg_atomic_fetch_add_u64(&BTREE_GET_META(descr)->checkpointBytes,
+									disk_downlink_get_bytes(descr, written_downlink));
 
 			writeback_put_extent(writeback, &page_desc->fileExtent);
 
@@ -4247,7 +4607,7 @@ checkpoint_tables_callback(OIndexType type, ORelOids treeOids,
 			checkpoint_state->toastConsistentPtr = GetXLogInsertRecPtr();
 		}
 
-		LWLockRelease(&checkpoint_state->oTablesMetaLock);
+		o_tables_meta_unlock_all();
 
 		if (STOPEVENTS_ENABLED())
 			params = prepare_checkpoint_tree_start_params(td);
@@ -4277,7 +4637,7 @@ checkpoint_tables_callback(OIndexType type, ORelOids treeOids,
 		}
 
 
-		LWLockAcquire(&checkpoint_state->oTablesMetaLock, LW_EXCLUSIVE);
+		o_tables_meta_lock_all();
 	}
 
 	MemoryContextSwitchTo(prev_context);
@@ -4532,6 +4892,7 @@ evictable_tree_init_meta(BTreeDescr *desc, EvictedTreeData **evicted_data,
 			file_header.datafileLength = 0;
 			file_header.numFreeBlocks = 0;
 			file_header.leafPagesNum = 1;
+			file_header.numTuples = 0;
 			file_header.ctid = 0;
 		}
 	}
@@ -4561,6 +4922,7 @@ evictable_tree_init_meta(BTreeDescr *desc, EvictedTreeData **evicted_data,
 			file_header.datafileLength = 0;
 			file_header.numFreeBlocks = 0;
 			file_header.leafPagesNum = 1;
+			file_header.numTuples = 0;
 			file_header.ctid = 0;
 
 			prev_chkp_file = PathNameOpenFile(prev_chkp_fname, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
@@ -4571,6 +4933,7 @@ evictable_tree_init_meta(BTreeDescr *desc, EvictedTreeData **evicted_data,
 								errmsg("could not create map file %s", prev_chkp_fname)));
 			}
 
+			checkpoint_file_header_set_crc(&file_header);
 			ferror = OFileWrite(prev_chkp_file, (Pointer) &file_header, sizeof(file_header), 0,
 								WAIT_EVENT_SLRU_WRITE) != sizeof(file_header) ||
 				FileSync(prev_chkp_file, WAIT_EVENT_SLRU_SYNC) != 0;
@@ -4608,6 +4971,7 @@ evictable_tree_init_meta(BTreeDescr *desc, EvictedTreeData **evicted_data,
 									errmsg("could not to read header of map file %s",
 										   prev_chkp_fname)));
 				}
+				checkpoint_file_header_check_crc(&file_header, prev_chkp_fname);
 			}
 		}
 		if (prev_chkp_file_exist)
@@ -4624,6 +4988,7 @@ evictable_tree_init_meta(BTreeDescr *desc, EvictedTreeData **evicted_data,
 	else
 		pg_atomic_write_u64(&meta_page->datafileLength[0], file_header.datafileLength);
 	pg_atomic_write_u32(&meta_page->leafPagesNum, file_header.leafPagesNum);
+	pg_atomic_write_u64(&meta_page->numTuples, file_header.numTuples);
 	pg_atomic_write_u64(&meta_page->ctid, file_header.ctid);
 	if (evicted_data && *evicted_data)
 	{
@@ -15,9 +15,13 @@
 
 #include "orioledb.h"
 
+#include "btree/compressed_cache.h"
 #include "btree/find.h"
 #include "btree/io.h"
+#include "btree/page_contents.h"
+#include "btree/range_lock.h"
 #include "btree/scan.h"
+#include "btree/undo_image_cache.h"
 #include "catalog/o_tables.h"
 #include "catalog/o_sys_cache.h"
 #include "catalog/sys_trees.h"
@@ -26,23 +30,31 @@
 #include "recovery/wal.h"
 #include "s3/headers.h"
 #include "s3/queue.h"
+#include "s3/stats.h"
 #include "s3/worker.h"
+#include "tableam/count_scan.h"
+#include "tableam/descr.h"
 #include "tableam/handler.h"
 #include "tableam/scan.h"
+#include "tableam/summary.h"
 #include "tableam/toast.h"
 #include "transam/oxid.h"
 #include "transam/undo.h"
 #include "tuple/toast.h"
 #include "utils/compress.h"
 #include "utils/memdebug.h"
+#include "utils/o_latency.h"
+#include "utils/o_wait_events.h"
 #include "utils/page_pool.h"
 #include "utils/stopevent.h"
 #include "utils/ucm.h"
 #include "workers/bgwriter.h"
+#include "workers/prewarm.h"
 
 #include "access/table.h"
 #include "access/xlog_internal.h"
 #include "catalog/pg_enum.h"
+#include "catalog/pg_type.h"
 #include "executor/execExpr.h"
 #include "funcapi.h"
 #include "libpq/auth.h"
@@ -58,16 +70,23 @@
 #include "storage/ipc.h"
 #include "storage/lwlock.h"
 #include "storage/proclist.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/hsearch.h"
 #include "utils/inval.h"
 #include "utils/rangetypes.h"
 #include "utils/pg_locale.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
+#include "utils/timestamp.h"
 
 #include <dirent.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 
 PG_MODULE_MAGIC;
 
@@ -101,6 +120,17 @@ uint32		xid_buffers_count;
 bool		remove_old_checkpoint_files = true;
 bool		debug_disable_bgwriter = false;
 bool		use_mmap = false;
+bool		orioledb_direct_io = false;
+int			buffers_huge_page_size = 0;
+bool		buffers_numa_interleave = false;
+bool		main_buffers_ghost = false;
+int			catalog_buffers_pinned_pages = 0;
+bool		catalog_buffers_pin_upper_levels = false;
+bool		undo_compress = false;
+int			compaction_rate_limit = 0;
+int			checkpoint_write_rate_limit = 0;
+int			checkpoint_iops_limit = 0;
+int			usage_count_batch = 0;
 bool		use_device = false;
 char	   *device_filename = NULL;
 Pointer		mmap_data = NULL;
@@ -109,7 +139,15 @@ int			device_length_guc = 0;
 Size		device_length = 0;
 double		o_checkpoint_completion_ratio;
 int			bgwriter_num_workers = 1;
+int			bgwriter_merge_pages = 0;
+int			bgwriter_checkpoint_ahead_pages = 0;
+int			prewarm_workers = 0;
+int			recovery_tree_loaders = 0;
+int			compressed_buffers_guc = 0;
+int			undo_image_cache_buffers_guc = 0;
 int			max_io_concurrency = 0;
+int			max_range_locks = 0;
+int			max_summaries = 0;
 ODBProcData *oProcData;
 int			default_compress = InvalidOCompress;
 int			default_primary_compress = InvalidOCompress;
@@ -118,6 +156,16 @@ int			default_toast_compress = InvalidOCompress;
 bool		orioledb_table_description_compress = false;
 #endif
 bool		orioledb_s3_mode = false;
+bool		enable_btree_suffix_truncation = false;
+bool		enable_btree_optimized_split = false;
+bool		enable_bulk_load_sort = false;
+bool		enable_batch_index_insert = false;
+bool		enable_fkey_prefetch = false;
+int			iterator_prefetch_pages = 0;
+double		iterator_prefetch_threshold = 0.5;
+int			lookup_cache_size = 0;
+bool		wal_compress = false;
+bool		standby_reads_low_priority = false;
 int			s3_num_workers = 3;
 int			s3_desired_size = 10000;
 int			s3_queue_size_guc;
@@ -126,6 +174,7 @@ char	   *s3_region = NULL;
 char	   *s3_accesskey = NULL;
 char	   *s3_secretkey = NULL;
 char	   *s3_cainfo = NULL;
+bool		s3_compress = false;
 
 /* Previous values of hooks to chain call them */
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
@@ -154,11 +203,18 @@ static Size o_proc_shmem_needs(void);
 static void o_proc_shmem_init(Pointer ptr, bool found);
 static Size ppools_shmem_needs(void);
 static void ppools_shmem_init(Pointer ptr, bool found);
+static void ppools_shmem_usage(OShmemUsage *usage);
 
+/*
+ * Shared memory area of the subsystem.  The name and the optional usage
+ * callback are exposed by orioledb_shmem_stats().
+ */
 typedef struct
 {
+	const char *name;
 	Size		(*shmem_size) (void);
 	void		(*shmem_init) (Pointer ptr, bool found);
+	void		(*shmem_usage) (OShmemUsage *usage);
 } ShmemItem;
 
 /*
@@ -166,19 +222,28 @@ typedef struct
  * See recovery_shmem_init() for description.
  */
 static ShmemItem shmemItems[] = {
-	{btree_io_shmem_needs, btree_io_shmem_init},
-	{oxid_shmem_needs, oxid_init_shmem},
-	{sys_trees_shmem_needs, sys_trees_shmem_init},
-	{StopEventShmemSize, StopEventShmemInit},
-	{undo_shmem_needs, undo_shmem_init},
-	{checkpoint_shmem_size, checkpoint_shmem_init},
-	{recovery_shmem_needs, recovery_shmem_init},
-	{o_proc_shmem_needs, o_proc_shmem_init},
-	{ppools_shmem_needs, ppools_shmem_init},
-	{btree_scan_shmem_needs, btree_scan_init_shmem},
-	{s3_queue_shmem_needs, s3_queue_init_shmem},
-	{s3_workers_shmem_needs, s3_workers_init_shmem},
-	{s3_headers_shmem_needs, s3_headers_shmem_init}
+	{"btree_io", btree_io_shmem_needs, btree_io_shmem_init, NULL},
+	{"oxid", oxid_shmem_needs, oxid_init_shmem, NULL},
+	{"sys_trees", sys_trees_shmem_needs, sys_trees_shmem_init, NULL},
+	{"stopevents", StopEventShmemSize, StopEventShmemInit, NULL},
+	{"undo", undo_shmem_needs, undo_shmem_init, undo_shmem_usage},
+	{"wal", wal_shmem_needs, wal_shmem_init, NULL},
+	{"checkpoint", checkpoint_shmem_size, checkpoint_shmem_init, NULL},
+	{"recovery", recovery_shmem_needs, recovery_shmem_init, NULL},
+	{"proc", o_proc_shmem_needs, o_proc_shmem_init, NULL},
+	{"page_pools", ppools_shmem_needs, ppools_shmem_init, ppools_shmem_usage},
+	{"btree_scan", btree_scan_shmem_needs, btree_scan_init_shmem, NULL},
+	{"s3_queue", s3_queue_shmem_needs, s3_queue_init_shmem, s3_queue_shmem_usage},
+	{"s3_workers", s3_workers_shmem_needs, s3_workers_init_shmem, NULL},
+	{"s3_headers", s3_headers_shmem_needs, s3_headers_shmem_init, NULL},
+	{"s3_stats", s3_stats_shmem_needs, s3_stats_shmem_init, NULL},
+	{"compress", o_compress_shmem_needs, o_compress_shmem_init, NULL},
+	{"compressed_cache", compressed_cache_shmem_needs, compressed_cache_shmem_init, NULL},
+	{"wait_events", o_wait_events_shmem_needs, o_wait_events_shmem_init, NULL},
+	{"latency_stats", o_latency_shmem_needs, o_latency_shmem_init, NULL},
+	{"range_locks", o_range_locks_shmem_needs, o_range_locks_shmem_init, NULL},
+	{"undo_image_cache", undo_image_cache_shmem_needs, undo_image_cache_shmem_init, NULL},
+	{"summaries", o_summaries_shmem_needs, o_summaries_shmem_init, NULL}
 };
 
 
@@ -194,6 +259,11 @@ static void orioledb_get_relation_info_hook(PlannerInfo *root,
 											RelOptInfo *rel);
 
 PG_FUNCTION_INFO_V1(orioledb_page_stats);
+PG_FUNCTION_INFO_V1(orioledb_shmem_stats);
+PG_FUNCTION_INFO_V1(orioledb_merged_pages);
+PG_FUNCTION_INFO_V1(orioledb_page_hit_stats);
+PG_FUNCTION_INFO_V1(orioledb_tree_stats);
+PG_FUNCTION_INFO_V1(orioledb_checkpoint_progress);
 PG_FUNCTION_INFO_V1(orioledb_version);
 PG_FUNCTION_INFO_V1(orioledb_commit_hash);
 PG_FUNCTION_INFO_V1(orioledb_ucm_check);
@@ -204,12 +274,18 @@ PG_FUNCTION_INFO_V1(orioledb_parallel_debug_stop);
 static void
 orioledb_rm_desc(StringInfo buf, XLogReaderState *record)
 {
-	appendStringInfo(buf, "OrioleDB WAL container");
+	if ((XLogRecGetInfo(record) & ~XLR_INFO_MASK) == ORIOLEDB_XLOG_CONTAINER_LZ4)
+		appendStringInfo(buf, "OrioleDB WAL container (LZ4, %u bytes)",
+						 XLogRecGetDataLen(record));
+	else
+		appendStringInfo(buf, "OrioleDB WAL container");
 }
 
 static const char *
 orioledb_rm_identify(uint8 info)
 {
+	if ((info & ~XLR_INFO_MASK) == ORIOLEDB_XLOG_CONTAINER_LZ4)
+		return "OrioleDB compressed WAL container";
 	return "OrioleDB WAL container";
 }
 
@@ -282,6 +358,67 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("orioledb.buffers_huge_page_size",
+							"Size of huge pages backing orioledb engine shared buffers.",
+							"Zero means using the regular shared memory segment.  Supported sizes are 2MB and 1GB.",
+							&buffers_huge_page_size,
+							0,
+							0,
+							1024 * 1024,
+							PGC_POSTMASTER,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("orioledb.buffers_numa_interleave",
+							 "Interleave orioledb engine shared buffers across NUMA nodes.",
+							 NULL,
+							 &buffers_numa_interleave,
+							 false,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("orioledb.main_buffers_ghost",
+							 "Keeps the history of pages evicted from the main page pool.",
+							 "Pages loaded again soon after eviction get higher usage count than pages loaded for the first time.",
+							 &main_buffers_ghost,
+							 false,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("orioledb.compressed_buffers",
+							"Size of orioledb engine shared cache for compressed images of evicted pages.",
+							NULL,
+							&compressed_buffers_guc,
+							0,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_UNIT_BLOCKS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.undo_image_cache_buffers",
+							"Size of orioledb engine shared cache for historical page images reconstructed from undo.",
+							NULL,
+							&undo_image_cache_buffers_guc,
+							0,
+							0,
+							INT_MAX,
+							PGC_POSTMASTER,
+							GUC_UNIT_BLOCKS,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomIntVariable("orioledb.free_tree_buffers",
 							"Size of orioledb engine shared buffers for free extents BTrees.",
 							NULL,
@@ -308,6 +445,30 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("orioledb.catalog_buffers_pinned_pages",
+							"Number of pages of each system tree kept in catalog buffers regardless of eviction.",
+							NULL,
+							&catalog_buffers_pinned_pages,
+							0,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("orioledb.catalog_buffers_pin_upper_levels",
+							 "Keeps non-leaf pages of system trees in catalog buffers regardless of eviction.",
+							 NULL,
+							 &catalog_buffers_pin_upper_levels,
+							 false,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomIntVariable("orioledb.undo_buffers",
 							"Size of orioledb engine undo log buffers.",
 							NULL,
@@ -321,6 +482,17 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomBoolVariable("orioledb.undo_compress",
+							 "Compresses undo log blocks written to the undo files.",
+							 NULL,
+							 &undo_compress,
+							 false,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomIntVariable("orioledb.xid_buffers",
 							"Size of orioledb engine xid buffers.",
 							NULL,
@@ -404,6 +576,17 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomBoolVariable("orioledb.recovery_prefetch",
+							 "Issues read-ahead for the pages modified by the replayed WAL records.",
+							 NULL,
+							 &recovery_prefetch,
+							 true,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomIntVariable("orioledb.recovery_idx_pool_size",
 							"Sets the number of recovery index build workers.",
 							NULL,
@@ -470,6 +653,58 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("orioledb.prewarm_workers",
+							"Number of workers loading the saved resident pages on startup.",
+							"Zero disables saving and loading the resident pages.",
+							&prewarm_workers,
+							0,
+							0,
+							MAX_BACKENDS,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.recovery_tree_loaders",
+							"Number of workers loading the trees on recovery start.",
+							NULL,
+							&recovery_tree_loaders,
+							0,
+							0,
+							MAX_BACKENDS,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.bgwriter_merge_pages",
+							"Number of pages checked for merge by background writer per round.",
+							NULL,
+							&bgwriter_merge_pages,
+							0,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.bgwriter_checkpoint_ahead_pages",
+							"Number of pages checked by background writer per round for writing ahead of checkpoint.",
+							NULL,
+							&bgwriter_checkpoint_ahead_pages,
+							0,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomIntVariable("orioledb.max_io_concurrency",
 							"Number of maximum concurrent IO operations.",
 							NULL,
@@ -483,6 +718,32 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("orioledb.max_range_locks",
+							"Maximum number of concurrently held key-range locks.",
+							"Zero disables key-range locks.",
+							&max_range_locks,
+							0,
+							0,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.max_summaries",
+							"Maximum number of column summaries of all the tables.",
+							"Zero disables column summaries.",
+							&max_summaries,
+							0,
+							0,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomBoolVariable("orioledb.use_mmap",
 							 "Store data in the mmap'ed file.",
 							 NULL,
@@ -494,6 +755,69 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("orioledb.compaction_rate_limit",
+							"Maximum number of pages per second relocated by the data file compaction.",
+							"Zero disables the limit.",
+							&compaction_rate_limit,
+							0,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.checkpoint_write_rate_limit",
+							"Maximum rate of the orioledb checkpoint writes in megabytes per second.",
+							"Zero disables the limit.",
+							&checkpoint_write_rate_limit,
+							0,
+							0,
+							INT_MAX / 1024,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.checkpoint_iops_limit",
+							"Maximum number of the orioledb checkpoint page writes per second.",
+							"Zero disables the limit.",
+							&checkpoint_iops_limit,
+							0,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("orioledb.usage_count_batch",
+							"Number of page usage count increments deferred by the backend.",
+							"Zero applies the increments immediately.",
+							&usage_count_batch,
+							0,
+							0,
+							UCM_MAX_DEFERRED,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("orioledb.direct_io",
+							 "Use O_DIRECT for the data files to bypass the OS page cache.",
+							 NULL,
+							 &orioledb_direct_io,
+							 false,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomStringVariable("orioledb.device_filename",
 							   "Data file for mmap.",
 							   NULL,
@@ -571,6 +895,131 @@ _PG_init(void)
 							 NULL);
 #endif
 
+	DefineCustomBoolVariable("orioledb.enable_suffix_truncation",
+							 "Truncate unneeded trailing attributes of separator "
+							 "keys on leaf page split",
+							 NULL,
+							 &enable_btree_suffix_truncation,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("orioledb.enable_optimized_split",
+							 "Choose the leaf page split point giving the shortest "
+							 "separator key and split appends at the right edge",
+							 NULL,
+							 &enable_btree_optimized_split,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("orioledb.enable_bulk_load_sort",
+							 "Sort the tuples loaded by COPY by the primary key "
+							 "before inserting them",
+							 NULL,
+							 &enable_bulk_load_sort,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("orioledb.enable_batch_index_insert",
+							 "Insert the non-unique secondary index tuples of "
+							 "the multi-row insertion in the index key order",
+							 NULL,
+							 &enable_batch_index_insert,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("orioledb.enable_fkey_prefetch",
+							 "Loads the referenced keys of the multi-row "
+							 "insertion before the foreign key checks",
+							 NULL,
+							 &enable_fkey_prefetch,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("orioledb.iterator_prefetch_pages",
+							"Sets the number of the next leaf pages read ahead "
+							"by the B-tree range scans.",
+							NULL,
+							&iterator_prefetch_pages,
+							0,
+							0,
+							64,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomRealVariable("orioledb.iterator_prefetch_threshold",
+							 "Sets the fraction of the leaf page passed by the "
+							 "B-tree range scan before reading ahead the next "
+							 "leaf pages.",
+							 NULL,
+							 &iterator_prefetch_threshold,
+							 0.5,
+							 0.0,
+							 1.0,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("orioledb.lookup_cache_size",
+							"Sets the number of entries in the backend-local "
+							"cache of leaf pages found by the equality lookups.",
+							NULL,
+							&lookup_cache_size,
+							0,
+							0,
+							INT_MAX / 2,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("orioledb.standby_reads_low_priority",
+							 "Loads pages read by hot standby queries with the lowest usage count.",
+							 NULL,
+							 &standby_reads_low_priority,
+							 false,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("orioledb.wal_compress",
+							 "Compresses orioledb WAL containers with LZ4.",
+							 NULL,
+							 &wal_compress,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable("orioledb.s3_mode",
 							 "The OrioleDB function mode on top of S3 storage",
 							 NULL,
@@ -678,6 +1127,17 @@ _PG_init(void)
 							   NULL,
 							   NULL);
 
+	DefineCustomBoolVariable("orioledb.s3_compress",
+							 "Compress the files other than OrioleDB data file parts before S3 upload.",
+							 NULL,
+							 &s3_compress,
+							 false,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomStringVariable("orioledb.s3_cainfo",
 							   "S3 CApath or CAfile path used to validate "
 							   "the peer certificate. For tests only!",
@@ -727,6 +1187,8 @@ _PG_init(void)
 	EmitWarningsOnPlaceholders("pg_stat_statements");
 
 	memset(page_pools, 0, OPagePoolTypesCount * sizeof(OPagePool));
+	if (main_buffers_ghost)
+		page_pools[OPagePoolMain].ghostSize = main_buffers_count;
 	page_pools_size[OPagePoolFreeTree] = ppool_estimate_space(&page_pools[OPagePoolFreeTree],
 															  0,
 															  free_tree_buffers_count,
@@ -751,7 +1213,9 @@ _PG_init(void)
 
 	if (device_filename)
 	{
-		device_fd = BasicOpenFile(device_filename, O_RDWR);
+		device_fd = BasicOpenFile(device_filename,
+								  O_RDWR | PG_BINARY |
+								  (orioledb_direct_io && !use_mmap ? PG_O_DIRECT : 0));
 		device_length = (Size) device_length_guc * BLCKSZ;
 		if (device_fd < 0)
 		{
@@ -782,7 +1246,11 @@ _PG_init(void)
 
 	/* Register background writers */
 	for (i = 0; i < bgwriter_num_workers; i++)
-		register_bgwriter();
+		register_bgwriter(i);
+
+	/* Register prewarm workers */
+	for (i = 0; i < prewarm_workers; i++)
+		register_prewarm_worker(i);
 
 	/* Register S3 workers */
 	for (i = 0; orioledb_s3_mode && (i < s3_num_workers); i++)
@@ -792,6 +1260,8 @@ _PG_init(void)
 	register_o_detoast_func(o_detoast);
 
 	RegisterCustomScanMethods(&o_scan_methods);
+	RegisterCustomScanMethods(&o_count_scan_methods);
+	RegisterCustomScanMethods(&o_summary_scan_methods);
 
 	/* Setup the required hooks. */
 #if PG_VERSION_NUM >= 150000
@@ -804,6 +1274,8 @@ _PG_init(void)
 	old_set_rel_pathlist_hook = set_rel_pathlist_hook;
 	set_rel_pathlist_hook = orioledb_set_rel_pathlist_hook;
 	set_plain_rel_pathlist_hook = orioledb_set_plain_rel_pathlist_hook;
+	old_create_upper_paths_hook = create_upper_paths_hook;
+	create_upper_paths_hook = orioledb_create_upper_paths_hook;
 	RegisterXactCallback(undo_xact_callback, NULL);
 	RegisterSubXactCallback(undo_subxact_callback, NULL);
 	CacheRegisterUsercacheCallback(orioledb_usercache_hook, PointerGetDatum(NULL));
@@ -863,26 +1335,142 @@ o_proc_shmem_init(Pointer ptr, bool found)
 		{
 			int			j;
 
-			pg_atomic_init_u64(&oProcData[i].reservedUndoLocation, InvalidUndoLocation);
-			pg_atomic_init_u64(&oProcData[i].snapshotRetainUndoLocation, InvalidUndoLocation);
-			pg_atomic_init_u64(&oProcData[i].transactionUndoRetainLocation, InvalidUndoLocation);
-			pg_atomic_init_u64(&oProcData[i].commitInProgressXlogLocation, OWalInvalidCommitPos);
-			pg_atomic_init_u64(&oProcData[i].xmin, InvalidOXid);
-			oProcData[i].autonomousNestingLevel = 0;
-			memset(&oProcData[i].vxids, 0, sizeof(oProcData[i].vxids));
-			LWLockInitialize(&oProcData[i].undoStackLocationsFlushLock,
-							 undo_meta->undoStackLocationsFlushLockTrancheId);
-			oProcData[i].flushUndoLocations = false;
-			for (j = 0; j < PROC_XID_ARRAY_SIZE; j++)
-			{
-				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].location, InvalidUndoLocation);
-				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].branchLocation, InvalidUndoLocation);
-				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].subxactLocation, InvalidUndoLocation);
-				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].onCommitLocation, InvalidUndoLocation);
-				oProcData[i].vxids[j].oxid = InvalidOXid;
-			}
-		}
+			pg_atomic_init_u64(&oProcData[i].reservedUndoLocation, InvalidUndoLocation);
+			pg_atomic_init_u64(&oProcData[i].snapshotRetainUndoLocation, InvalidUndoLocation);
+			pg_atomic_init_u64(&oProcData[i].transactionUndoRetainLocation, InvalidUndoLocation);
+			pg_atomic_init_u64(&oProcData[i].commitInProgressXlogLocation, OWalInvalidCommitPos);
+			pg_atomic_init_u64(&oProcData[i].xmin, InvalidOXid);
+			oProcData[i].autonomousNestingLevel = 0;
+			memset(&oProcData[i].vxids, 0, sizeof(oProcData[i].vxids));
+			LWLockInitialize(&oProcData[i].undoStackLocationsFlushLock,
+							 undo_meta->undoStackLocationsFlushLockTrancheId);
+			oProcData[i].flushUndoLocations = false;
+			for (j = 0; j < PROC_XID_ARRAY_SIZE; j++)
+			{
+				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].location, InvalidUndoLocation);
+				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].branchLocation, InvalidUndoLocation);
+				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].subxactLocation, InvalidUndoLocation);
+				pg_atomic_init_u64(&oProcData[i].undoStackLocations[j].onCommitLocation, InvalidUndoLocation);
+				oProcData[i].vxids[j].oxid = InvalidOXid;
+			}
+		}
+	}
+}
+
+/*
+ * Shared buffers are mapped separately from the main shared memory segment
+ * when they are backed by huge pages of a particular size, or placed with
+ * a NUMA policy.  The mapping is created by postmaster before forking
+ * backends, and reused on the shared memory reinitialization.
+ */
+static Pointer buffers_mapping = NULL;
+
+static bool
+buffers_mapped_separately(void)
+{
+	return buffers_huge_page_size != 0 || buffers_numa_interleave;
+}
+
+#ifdef __linux__
+/*
+ * Interleaves the given memory range across the online NUMA nodes.  Must be
+ * called before the memory is touched.
+ */
+static void
+buffers_numa_interleave_range(Pointer ptr, Size size)
+{
+	unsigned long nodemask[1024 / (8 * sizeof(unsigned long))] = {0};
+	char		buf[256];
+	char	   *p;
+	FILE	   *file;
+
+	file = AllocateFile("/sys/devices/system/node/online", "r");
+	if (file == NULL || fgets(buf, sizeof(buf), file) == NULL)
+	{
+		if (file)
+			FreeFile(file);
+		elog(WARNING, "could not read the list of NUMA nodes, shared buffers aren't interleaved");
+		return;
+	}
+	FreeFile(file);
+
+	/* the list looks like "0-3" or "0,2-3" */
+	p = buf;
+	while (*p >= '0' && *p <= '9')
+	{
+		long		from = strtol(p, &p, 10),
+					to = from,
+					i;
+
+		if (*p == '-')
+			to = strtol(p + 1, &p, 10);
+		for (i = from; i <= to && i < (long) (8 * sizeof(nodemask)); i++)
+			nodemask[i / (8 * sizeof(unsigned long))] |= 1UL << (i % (8 * sizeof(unsigned long)));
+		if (*p == ',')
+			p++;
+	}
+
+	if (syscall(SYS_mbind, ptr, size, MPOL_INTERLEAVE, nodemask,
+				8 * sizeof(nodemask), 0) != 0)
+		elog(WARNING, "could not interleave shared buffers across NUMA nodes: %m");
+}
+#endif
+
+static Size
+buffers_mapping_size(void)
+{
+	Size		page_size = (Size) buffers_huge_page_size * 1024;
+
+	if (page_size == 0)
+		return orioledb_buffers_size;
+	return TYPEALIGN(page_size, orioledb_buffers_size);
+}
+
+static Pointer
+buffers_map(void)
+{
+	int			flags = MAP_SHARED | MAP_ANONYMOUS;
+	Pointer		ptr;
+
+	if (buffers_mapping)
+		return buffers_mapping;
+
+#ifdef EXEC_BACKEND
+	elog(FATAL, "orioledb.buffers_huge_page_size and orioledb.buffers_numa_interleave are not supported on this platform");
+#endif
+
+	if (buffers_huge_page_size != 0)
+	{
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+		if (buffers_huge_page_size == 2 * 1024)
+			flags |= MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+		else if (buffers_huge_page_size == 1024 * 1024)
+			flags |= MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+		else
+			elog(FATAL, "orioledb.buffers_huge_page_size must be 2MB or 1GB");
+#else
+		elog(FATAL, "huge pages are not supported on this platform");
+#endif
+	}
+
+	ptr = mmap(NULL, buffers_mapping_size(), PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (ptr == MAP_FAILED)
+		ereport(FATAL,
+				(errmsg("could not map orioledb shared buffers: %m"),
+				 errhint("Check if there are enough huge pages of size %dkB reserved.",
+						 buffers_huge_page_size)));
+
+	if (buffers_numa_interleave)
+	{
+#ifdef __linux__
+		buffers_numa_interleave_range(ptr, buffers_mapping_size());
+#else
+		elog(WARNING, "NUMA interleave is not supported on this platform");
+#endif
 	}
+
+	buffers_mapping = ptr;
+	return ptr;
 }
 
 static Size
@@ -893,7 +1481,8 @@ ppools_shmem_needs(void)
 
 	for (i = 0; i < OPagePoolTypesCount; i++)
 		size = add_size(size, page_pools_size[i]);
-	size = add_size(size, orioledb_buffers_size);
+	if (!buffers_mapped_separately())
+		size = add_size(size, orioledb_buffers_size);
 	size = add_size(size, page_descs_size);
 	return size;
 }
@@ -909,8 +1498,15 @@ ppools_shmem_init(Pointer ptr, bool found)
 		page_pools_ptr[i] = ptr;
 		ptr += page_pools_size[i];
 	}
-	o_shared_buffers = ptr;
-	ptr += orioledb_buffers_size;
+	if (buffers_mapped_separately())
+	{
+		o_shared_buffers = buffers_map();
+	}
+	else
+	{
+		o_shared_buffers = ptr;
+		ptr += orioledb_buffers_size;
+	}
 	page_descs = (OrioleDBPageDesc *) ptr;
 
 	for (i = 0; i < OPagePoolTypesCount; i++)
@@ -938,11 +1534,34 @@ ppools_shmem_init(Pointer ptr, bool found)
 			page_descs[i].ionum = -1;
 			page_descs[i].type = 0;
 			page_descs[i].flags = 0;
+			pg_atomic_init_u32(&page_descs[i].accessStats, 0);
 			proclist_init(&page_descs[i].waitersList);
 		}
 	}
 }
 
+/*
+ * Usage of the page pools: busy and free pages of all the pools.  The high
+ * water mark is the sum of per-pool maximums.
+ */
+static void
+ppools_shmem_usage(OShmemUsage *usage)
+{
+	int			i;
+
+	MemSet(usage, 0, sizeof(*usage));
+	for (i = 0; i < OPagePoolTypesCount; i++)
+	{
+		int64		size = page_pools[i].size,
+					free = ppool_free_pages_count(&page_pools[i]),
+					minFree = ppool_min_free_pages_count(&page_pools[i]);
+
+		usage->used += (size - free) * ORIOLEDB_BLCKSZ;
+		usage->free += free * ORIOLEDB_BLCKSZ;
+		usage->highWater += (size - Min(free, minFree)) * ORIOLEDB_BLCKSZ;
+	}
+}
+
 /*
  * Estimate amount of shared memory required by OrioleDB extension.
  */
@@ -964,6 +1583,9 @@ orioledb_on_shmem_exit(int code, Datum arg)
 {
 	if (MyProc)
 		pg_atomic_write_u64(&oProcData[MyProc->pgprocno].xmin, InvalidOXid);
+	ppool_release_all_pages();
+	release_undo_cache();
+	o_latency_flush();
 }
 
 /*
@@ -1302,6 +1924,417 @@ orioledb_page_stats(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns the size of each OrioleDB shared memory area.  Areas having the
+ * usage callback also report the used and free bytes and the high water
+ * mark, others have NULLs there.
+ */
+Datum
+orioledb_shmem_stats(PG_FUNCTION_ARGS)
+{
+	Datum		values[5];
+	bool		nulls[5];
+	int			i,
+				count = sizeof(shmemItems) / sizeof(shmemItems[0]);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+
+	orioledb_check_shmem();
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < count; i++)
+	{
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = PointerGetDatum(cstring_to_text(shmemItems[i].name));
+		values[1] = Int64GetDatum((int64) CACHELINEALIGN(shmemItems[i].shmem_size()));
+		if (shmemItems[i].shmem_usage)
+		{
+			OShmemUsage usage;
+
+			shmemItems[i].shmem_usage(&usage);
+			values[2] = Int64GetDatum(usage.used);
+			values[3] = Int64GetDatum(usage.free);
+			values[4] = Int64GetDatum(usage.highWater);
+		}
+		else
+		{
+			nulls[2] = nulls[3] = nulls[4] = true;
+		}
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	/* Shared buffers might be mapped outside of the main segment */
+	if (buffers_mapped_separately())
+	{
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = PointerGetDatum(cstring_to_text("mapped_buffers"));
+		values[1] = Int64GetDatum((int64) orioledb_buffers_size);
+		nulls[2] = nulls[3] = nulls[4] = true;
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns total number of pages reclaimed by merging sparse pages.
+ */
+Datum
+orioledb_merged_pages(PG_FUNCTION_ARGS)
+{
+	uint64		result = 0;
+	int			i;
+
+	orioledb_check_shmem();
+
+	for (i = 0; i < OPagePoolTypesCount; i++)
+		result += ppool_merged_pages_count(&page_pools[i]);
+
+	PG_RETURN_INT64((int64) result);
+}
+
+/*
+ * Returns page access, load and ghost history hit counters for each page
+ * pool.  Accesses are counted in batches, so the number is approximate.
+ */
+Datum
+orioledb_page_hit_stats(PG_FUNCTION_ARGS)
+{
+	Datum		values[4];
+	bool		nulls[4];
+	int			i;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+
+	orioledb_check_shmem();
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	for (i = 0; i < OPagePoolTypesCount; i++)
+	{
+		OPagePool  *pool = &page_pools[i];
+
+		if (i == OPagePoolMain)
+			values[0] = PointerGetDatum(cstring_to_text("main"));
+		else if (i == OPagePoolFreeTree)
+			values[0] = PointerGetDatum(cstring_to_text("free_tree"));
+		else if (i == OPagePoolCatalog)
+			values[0] = PointerGetDatum(cstring_to_text("catalog"));
+		values[1] = Int64GetDatum((int64) pg_atomic_read_u64(pool->ucm.accessCount));
+		values[2] = Int64GetDatum((int64) pg_atomic_read_u64(pool->loadedPagesCount));
+		values[3] = Int64GetDatum((int64) pg_atomic_read_u64(pool->ghostHitsCount));
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+typedef struct
+{
+	ORelOids	oids;
+	OIndexType	type;
+} TreeStatsKey;
+
+typedef struct
+{
+	TreeStatsKey key;
+	OPagePoolType poolType;
+	int64		numPages;
+	int64		numDirtyPages;
+	int64		usageLevelSum;
+	int			numLevels;
+	int64		numPagesByLevel[ORIOLEDB_MAX_DEPTH];
+} TreeStatsEntry;
+
+static const char *
+tree_stats_type_name(OIndexType type)
+{
+	switch (type)
+	{
+		case oIndexToast:
+			return "toast";
+		case oIndexPrimary:
+			return "primary";
+		case oIndexUnique:
+			return "unique";
+		case oIndexRegular:
+			return "regular";
+		default:
+			return "invalid";
+	}
+}
+
+/*
+ * Returns residency of each tree in the page pools together with its
+ * cumulative load, eviction, find_page(), operation and IO counters.  Page descriptors and
+ * headers are read without locks, so the result is approximate.
+ */
+Datum
+orioledb_tree_stats(PG_FUNCTION_ARGS)
+{
+	Datum		values[25];
+	bool		nulls[25];
+	int			i;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASHCTL		ctl;
+	HTAB	   *trees;
+	HASH_SEQ_STATUS hash_seq;
+	TreeStatsEntry *entry;
+
+	orioledb_check_shmem();
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(TreeStatsKey);
+	ctl.entrysize = sizeof(TreeStatsEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	trees = hash_create("orioledb tree stats", 64, &ctl,
+						HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (i = 0; i < OPagePoolTypesCount; i++)
+	{
+		OPagePool  *pool = &page_pools[i];
+		uint32		epoch = pg_atomic_read_u32(pool->ucm.epoch);
+		OInMemoryBlkno blkno;
+
+		for (blkno = pool->offset; blkno < pool->offset + pool->size; blkno++)
+		{
+			OrioleDBPageDesc *page_desc = O_GET_IN_MEMORY_PAGEDESC(blkno);
+			Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+			TreeStatsKey key;
+			uint32		usageCount;
+			int			level;
+			bool		found;
+
+			memset(&key, 0, sizeof(key));
+			key.oids = *((volatile ORelOids *) &page_desc->oids);
+			key.type = page_desc->type;
+			if (!ORelOidsIsValid(key.oids) || key.type == oIndexInvalid)
+				continue;
+
+			usageCount = pg_atomic_read_u32(&O_PAGE_HEADER(p)->usageCount);
+			if (usageCount >= UCM_USAGE_LEVELS)
+				continue;
+
+			entry = (TreeStatsEntry *) hash_search(trees, &key, HASH_ENTER,
+												   &found);
+			if (!found)
+			{
+				memset((Pointer) entry + sizeof(key), 0,
+					   sizeof(*entry) - sizeof(key));
+				entry->poolType = i;
+			}
+
+			level = Min(PAGE_GET_LEVEL(p), ORIOLEDB_MAX_DEPTH - 1);
+			entry->numPages++;
+			entry->numPagesByLevel[level]++;
+			entry->numLevels = Max(entry->numLevels, level + 1);
+			if (IS_DIRTY(blkno))
+				entry->numDirtyPages++;
+			entry->usageLevelSum += (UCM_USAGE_LEVELS + usageCount - epoch) % UCM_USAGE_LEVELS;
+		}
+	}
+
+	hash_seq_init(&hash_seq, trees);
+	while ((entry = (TreeStatsEntry *) hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		levels[ORIOLEDB_MAX_DEPTH];
+		BTreeDescr *desc;
+		int			j;
+
+		values[0] = ObjectIdGetDatum(entry->key.oids.datoid);
+		values[1] = ObjectIdGetDatum(entry->key.oids.reloid);
+		values[2] = ObjectIdGetDatum(entry->key.oids.relnode);
+		values[3] = PointerGetDatum(cstring_to_text(tree_stats_type_name(entry->key.type)));
+		if (entry->poolType == OPagePoolMain)
+			values[4] = PointerGetDatum(cstring_to_text("main"));
+		else if (entry->poolType == OPagePoolFreeTree)
+			values[4] = PointerGetDatum(cstring_to_text("free_tree"));
+		else
+			values[4] = PointerGetDatum(cstring_to_text("catalog"));
+		values[5] = Int64GetDatum(entry->numPages);
+		for (j = 0; j < entry->numLevels; j++)
+			levels[j] = Int64GetDatum(entry->numPagesByLevel[j]);
+		values[6] = PointerGetDatum(construct_array(levels, entry->numLevels,
+													INT8OID, sizeof(int64),
+													FLOAT8PASSBYVAL, 'd'));
+		values[7] = Int64GetDatum(entry->numDirtyPages);
+		values[8] = Float8GetDatum((double) entry->usageLevelSum / entry->numPages);
+
+		if (IS_SYS_TREE_OIDS(entry->key.oids))
+			desc = get_sys_tree(entry->key.oids.relnode);
+		else
+			desc = index_oids_get_btree_descr(entry->key.oids, entry->key.type);
+
+		if (desc != NULL && OInMemoryBlknoIsValid(desc->rootInfo.metaPageBlkno))
+		{
+			BTreeMetaPage *meta = BTREE_GET_META(desc);
+
+			memset(&nulls[9], 0, sizeof(bool) * 16);
+			values[9] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numLoadedPages));
+			values[10] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numEvictedPages));
+			values[11] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numFindHits));
+			values[12] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numFindMisses));
+			values[13] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numCheckpointPages));
+			values[14] = Float8GetDatum((double) pg_atomic_read_u64(&meta->checkpointTime) / 1000.0);
+			values[15] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numLookups));
+			values[16] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numInserts));
+			values[17] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numUpdates));
+			values[18] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numDeletes));
+			values[19] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numSplits));
+			values[20] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numMerges));
+			values[21] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numCompactions));
+			values[22] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->evictionBytes));
+			values[23] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->checkpointBytes));
+			values[24] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->undoBytes));
+		}
+		else
+		{
+			/* the tree might be deleted or invisible for us */
+			memset(&nulls[9], 1, sizeof(bool) * 16);
+		}
+		memset(nulls, 0, sizeof(bool) * 9);
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	hash_destroy(trees);
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns the progress of the orioledb checkpoint in progress, if any.  The
+ * fields are updated by the checkpointer without locks, so they could be
+ * slightly inconsistent with each other.
+ */
+Datum
+orioledb_checkpoint_progress(PG_FUNCTION_ARGS)
+{
+	Datum		values[14];
+	bool		nulls[14];
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	TimestampTz startTime;
+	ORelOids	oids;
+	OIndexType	type;
+	double		dirtyPagesEstimate;
+	uint64		pagesWritten;
+
+	orioledb_check_shmem();
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	startTime = checkpoint_state->startTime;
+	if (startTime == 0)
+	{
+		tuplestore_donestoring(tupstore);
+		return (Datum) 0;
+	}
+
+	oids.datoid = checkpoint_state->datoid;
+	oids.reloid = checkpoint_state->reloid;
+	oids.relnode = checkpoint_state->relnode;
+	type = checkpoint_state->treeType;
+	dirtyPagesEstimate = checkpoint_state->dirtyPagesEstimate;
+	pagesWritten = checkpoint_state->pagesWritten;
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum((int64) checkpoint_state->lastCheckpointNumber + 1);
+	values[1] = Int32GetDatum((int32) checkpoint_state->pid);
+	if (ORelOidsIsValid(oids) && type != oIndexInvalid)
+	{
+		values[2] = ObjectIdGetDatum(oids.datoid);
+		values[3] = ObjectIdGetDatum(oids.reloid);
+		values[4] = ObjectIdGetDatum(oids.relnode);
+		values[5] = PointerGetDatum(cstring_to_text(tree_stats_type_name(type)));
+	}
+	else
+	{
+		memset(&nulls[2], 1, sizeof(bool) * 4);
+	}
+	values[6] = Int64GetDatum((int64) checkpoint_state->pagesVisited);
+	values[7] = Int64GetDatum((int64) pagesWritten);
+	values[8] = Int64GetDatum((int64) dirtyPagesEstimate);
+	values[9] = Int64GetDatum((int64) checkpoint_state->bytesWritten);
+	values[10] = Int64GetDatum((int64) checkpoint_state->autonomousPages);
+	values[11] = Float8GetDatum((double) checkpoint_state->lockWaitTime / 1000.0);
+	values[12] = TimestampTzGetDatum(startTime);
+	if (dirtyPagesEstimate > 0)
+		values[13] = Float8GetDatum(Min((double) pagesWritten / dirtyPagesEstimate, 1.0));
+	else
+		nulls[13] = true;
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 Datum
 orioledb_ucm_check(PG_FUNCTION_ARGS)
 {
@@ -1469,6 +2502,7 @@ orioledb_error_cleanup_hook(void)
 	release_undo_size(UndoReserveTxn);
 	btree_mark_incomplete_splits();
 	unset_skip_ucm();
+	ucm_bulk_read_reset();
 	btree_io_error_cleanup();
 	o_reset_syscache_hooks();
 	if (drop_index_list)
@@ -1514,8 +2548,8 @@ orioledb_get_relation_info_hook(PlannerInfo *root,
 					bool		hasbitmap;
 
 					/*
-					 * TODO: Remove when parallel index scan will be
-					 * implemented
+					 * Parallel index scans are planned as custom scans (see
+					 * add_partial_index_path()), not as btree ones.
 					 */
 					info->amcanparallel = false;
 					hasbitmap = info->indexoid != primary->oids.reloid &&
@@ -1531,6 +2565,27 @@ orioledb_get_relation_info_hook(PlannerInfo *root,
 						hasbitmap = hasbitmap && valid;
 					}
 					info->amhasgetbitmap = hasbitmap;
+
+					/*
+					 * Take secondary index sizes from their trees, since
+					 * the bridged index relations have no storage of
+					 * their own.
+					 */
+					for (i = PrimaryIndexNumber + 1; i < descr->nIndices; i++)
+					{
+						OIndexDescr *index = descr->indices[i];
+
+						if (index->oids.reloid != info->indexoid ||
+							!tbl_data_exists(&index->oids))
+							continue;
+
+						o_btree_load_shmem(&index->desc);
+						info->pages = Max(TREE_NUM_LEAF_PAGES(&index->desc), 1);
+						if (TREE_NUM_TUPLES(&index->desc) > 0)
+							info->tuples = Min((double) TREE_NUM_TUPLES(&index->desc),
+											   rel->tuples);
+						break;
+					}
 				}
 			}
 		}
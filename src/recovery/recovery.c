@@ -16,7 +16,9 @@
 #include "orioledb.h"
 
 #include "btree/btree.h"
+#include "btree/find.h"
 #include "btree/io.h"
+#include "btree/iterator.h"
 #include "btree/modify.h"
 #include "btree/undo.h"
 #include "catalog/free_extents.h"
@@ -29,14 +31,17 @@
 #include "tableam/operations.h"
 #include "transam/undo.h"
 #include "utils/inval.h"
+#include "utils/o_probes.h"
 #include "utils/stopevent.h"
 #include "utils/syscache.h"
+#include "workers/tree_loader.h"
 
 #include "access/hash.h"
 #include "access/xlog_internal.h"
 #if PG_VERSION_NUM >= 150000
 #include "access/xlogrecovery.h"
 #endif
+#include "funcapi.h"
 #include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "miscadmin.h"
@@ -47,9 +52,20 @@
 #include "storage/ipc.h"
 #include "storage/shm_mq.h"
 #include "storage/standby.h"
+#include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/pg_lsn.h"
+#include "utils/timestamp.h"
 #include "utils/typcache.h"
 
+#include <lz4.h>
+
+/*
+ * Number of the tables tracked for each worker to limit the synchronization
+ * to the workers having records of the given table.
+ */
+#define RECOVERY_MAX_SENT_TABLES	(16)
+
 /*
  * Recovery worker state in pool.
  */
@@ -67,10 +83,28 @@ typedef struct
 	OIndexType	type;
 	/* Handle for the worker */
 	BackgroundWorkerHandle *handle;
+	/* Tables having records sent since the last synchronization */
+	ORelOids	sentTables[RECOVERY_MAX_SENT_TABLES];
+	int			sentTablesCount;
+	bool		sentTablesOverflow;
 } RecoveryWorkerState;
 
 static RecoveryWorkerState *workers_pool;
 
+/*
+ * Modify records are routed to the workers by buckets of key hashes.  We
+ * count the records sent for each bucket, and reassign buckets to the
+ * workers when the load is skewed.  Reassignment is done only at the
+ * synchronization point without transactions in progress, when all the
+ * workers have applied all the records sent.  So, records for the same key
+ * are still applied in order.
+ */
+#define RECOVERY_ROUTE_BUCKETS			(1024)
+#define RECOVERY_REBALANCE_MIN_RECORDS	(RECOVERY_ROUTE_BUCKETS * 16)
+
+static int *recovery_route_worker = NULL;
+static uint64 *recovery_route_load = NULL;
+
 typedef struct
 {
 	ORelOids	oids;			/* hash table key */
@@ -122,6 +156,7 @@ typedef struct
 
 
 PG_FUNCTION_INFO_V1(orioledb_recovery_synchronized);
+PG_FUNCTION_INFO_V1(orioledb_recovery_workers);
 
 /*
  * Comparator for retain min-heap.
@@ -227,6 +262,18 @@ int			recovery_idx_pool_size_guc;
  */
 int			recovery_queue_size_guc;
 
+/*
+ * GUC value, issue read-ahead for the pages modified by records sent to
+ * recovery workers.
+ */
+bool		recovery_prefetch = true;
+
+/* Maximal number of records to skip prefetching when it finds nothing */
+#define RECOVERY_PREFETCH_MAX_BACKOFF	256
+
+static int	recovery_prefetch_backoff = 0;
+static int	recovery_prefetch_skip = 0;
+
 /*
  * Are TOAST trees consistent with primary indices.
  */
@@ -273,6 +320,8 @@ static void workers_send_savepoint(SubTransactionId parentSubId);
 static void workers_send_rollback_to_savepoint(XLogRecPtr ptr,
 											   SubTransactionId parentSubId);
 static void workers_synchronize(XLogRecPtr csn, bool send_synchronize);
+static void workers_rebalance(void);
+static void workers_synchronize_table(XLogRecPtr ptr, ORelOids oids);
 static void workers_notify_toast_consistent(void);
 static void worker_wait_shutdown(RecoveryWorkerState *worker);
 
@@ -281,6 +330,8 @@ static inline bool apply_sys_tree_modify_record(int sys_tree_num, uint16 type,
 												OXid oxid, CommitSeqNo csn);
 static inline void spread_idx_modify(BTreeDescr *desc, uint16 recType,
 									 OTuple rec);
+static inline void recovery_prefetch_record(BTreeDescr *desc, uint16 recType,
+											OTuple rec);
 
 static inline uint16 recovery_msg_from_wal_record(uint8 wal_record);
 
@@ -373,6 +424,13 @@ recovery_shmem_init(Pointer ptr, bool found)
 			pg_atomic_init_u64(&worker_ptrs[i].commitPtr, InvalidXLogRecPtr);
 			pg_atomic_init_u64(&worker_ptrs[i].retainPtr, InvalidXLogRecPtr);
 			worker_ptrs[i].flushedUndoLocCompletedCheckpointNumber = 0;
+			pg_atomic_init_u64(&worker_ptrs[i].startTime, 0);
+			pg_atomic_init_u64(&worker_ptrs[i].sentBytes, 0);
+			pg_atomic_init_u64(&worker_ptrs[i].receivedBytes, 0);
+			pg_atomic_init_u64(&worker_ptrs[i].appliedRecords, 0);
+			pg_atomic_init_u64(&worker_ptrs[i].loadedPages, 0);
+			pg_atomic_init_u64(&worker_ptrs[i].sendWaitTime, 0);
+			pg_atomic_init_u64(&worker_ptrs[i].syncWaitTime, 0);
 		}
 		pg_atomic_init_u64(recovery_ptr, InvalidXLogRecPtr);
 		pg_atomic_init_u64(recovery_main_retain_ptr, InvalidXLogRecPtr);
@@ -588,6 +646,19 @@ o_recovery_start_hook(void)
 			if (shm_mq_wait_for_attach(workers_pool[i].queue) != SHM_MQ_SUCCESS)
 				elog(ERROR, "unable to attach recovery workers to shm queue");
 		}
+
+		/*
+		 * Tree loaders only speed up the recovery: without them the trees are
+		 * loaded on demand.
+		 */
+		for (i = 0; i < recovery_tree_loaders; i++)
+		{
+			if (tree_loader_register(i) == NULL)
+			{
+				elog(LOG, "unable to start orioledb tree loaders: not enough background worker slots");
+				break;
+			}
+		}
 	}
 
 /*	if (enable_stopevents)
@@ -612,11 +683,32 @@ orioledb_redo(XLogReaderState *record)
 {
 	Pointer		msg_start = (Pointer) XLogRecGetData(record);
 	int			msg_len = XLogRecGetDataLen(record);
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
 	bool		recovery_single;
 
-	Assert((XLogRecGetInfo(record) & ~XLR_INFO_MASK) == ORIOLEDB_XLOG_CONTAINER);
+	Assert(info == ORIOLEDB_XLOG_CONTAINER ||
+		   info == ORIOLEDB_XLOG_CONTAINER_LZ4);
 	recovery_single = *recovery_single_process;
 
+	if (info == ORIOLEDB_XLOG_CONTAINER_LZ4)
+	{
+		static char decompressed[LOCAL_WAL_BUFFER_SIZE];
+		uint16		raw_length;
+
+		if (msg_len < sizeof(uint16))
+			elog(ERROR, "invalid compressed orioledb WAL container at %X/%X",
+				 LSN_FORMAT_ARGS(record->ReadRecPtr));
+		memcpy(&raw_length, msg_start, sizeof(uint16));
+		if (raw_length > LOCAL_WAL_BUFFER_SIZE ||
+			LZ4_decompress_safe(msg_start + sizeof(uint16), decompressed,
+								msg_len - sizeof(uint16),
+								raw_length) != raw_length)
+			elog(ERROR, "could not decompress orioledb WAL container at %X/%X",
+				 LSN_FORMAT_ARGS(record->ReadRecPtr));
+		msg_start = decompressed;
+		msg_len = raw_length;
+	}
+
 	if (record->ReadRecPtr >= checkpoint_state->controlToastConsistentPtr)
 	{
 		toast_consistent = true;
@@ -1505,6 +1597,169 @@ recovery_rec_update(BTreeDescr *desc, OTuple tuple, bool *allocated, int *size)
 	return tuple;
 }
 
+/*
+ * Makes the payload of WAL_REC_UPDATE_DELTA record: the primary key and the
+ * bytes of the new tuple, which differ from the previous version.  Returns
+ * null tuple if that isn't shorter than the new tuple itself.
+ */
+OTuple
+recovery_rec_update_delta(BTreeDescr *desc, OTuple oldTuple, OTuple tuple,
+						  int *size)
+{
+	WALRecUpdateDelta delta;
+	OTuple		result,
+				key;
+	bool		key_pfree;
+	OffsetNumber oldLen,
+				newLen,
+				keyLen,
+				prefixLen = 0,
+				suffixLen = 0;
+	uint32		hash;
+	Pointer		ptr;
+
+	O_TUPLE_SET_NULL(result);
+	oldLen = o_btree_len(desc, oldTuple, OTupleLength);
+	newLen = o_btree_len(desc, tuple, OTupleLength);
+
+	while (prefixLen < oldLen && prefixLen < newLen &&
+		   oldTuple.data[prefixLen] == tuple.data[prefixLen])
+		prefixLen++;
+	while (suffixLen < oldLen - prefixLen && suffixLen < newLen - prefixLen &&
+		   oldTuple.data[oldLen - 1 - suffixLen] ==
+		   tuple.data[newLen - 1 - suffixLen])
+		suffixLen++;
+
+	key = o_btree_tuple_make_key(desc, tuple, NULL, true, &key_pfree);
+	keyLen = o_btree_len(desc, key, OKeyLength);
+
+	*size = sizeof(delta) + keyLen + (newLen - prefixLen - suffixLen);
+	if (*size >= newLen)
+	{
+		if (key_pfree)
+			pfree(key.data);
+		return result;
+	}
+
+	delta.keyFormatFlags = key.formatFlags;
+	memcpy(delta.keyLength, &keyLen, sizeof(OffsetNumber));
+	memcpy(delta.oldLength, &oldLen, sizeof(OffsetNumber));
+	memcpy(delta.newLength, &newLen, sizeof(OffsetNumber));
+	memcpy(delta.prefixLength, &prefixLen, sizeof(OffsetNumber));
+	memcpy(delta.suffixLength, &suffixLen, sizeof(OffsetNumber));
+	hash = hash_bytes((unsigned char *) oldTuple.data, oldLen);
+	memcpy(delta.oldHash, &hash, sizeof(uint32));
+	hash = hash_bytes((unsigned char *) tuple.data, newLen);
+	memcpy(delta.newHash, &hash, sizeof(uint32));
+
+	result.formatFlags = tuple.formatFlags;
+	result.data = ptr = palloc(*size);
+	memcpy(ptr, &delta, sizeof(delta));
+	ptr += sizeof(delta);
+	memcpy(ptr, key.data, keyLen);
+	ptr += keyLen;
+	memcpy(ptr, tuple.data + prefixLen, newLen - prefixLen - suffixLen);
+
+	if (key_pfree)
+		pfree(key.data);
+	return result;
+}
+
+/*
+ * Returns the primary key of WAL_REC_UPDATE_DELTA record and the record size.
+ */
+OTuple
+recovery_update_delta_get_key(OTuple rec, int *size)
+{
+	WALRecUpdateDelta delta;
+	OTuple		key;
+	OffsetNumber keyLen,
+				newLen,
+				prefixLen,
+				suffixLen;
+
+	memcpy(&delta, rec.data, sizeof(delta));
+	memcpy(&keyLen, delta.keyLength, sizeof(OffsetNumber));
+	memcpy(&newLen, delta.newLength, sizeof(OffsetNumber));
+	memcpy(&prefixLen, delta.prefixLength, sizeof(OffsetNumber));
+	memcpy(&suffixLen, delta.suffixLength, sizeof(OffsetNumber));
+
+	key.formatFlags = delta.keyFormatFlags;
+	key.data = rec.data + sizeof(delta);
+	*size = sizeof(delta) + keyLen + (newLen - prefixLen - suffixLen);
+	return key;
+}
+
+/*
+ * Reconstructs the new tuple from WAL_REC_UPDATE_DELTA record and the tuple
+ * version currently in the tree.  Returns null tuple if the tuple is deleted
+ * or contains the version that is neither previous nor new.  That happens
+ * only when the tree image is ahead of the record, so later records take
+ * care of the tuple.
+ */
+OTuple
+recovery_update_delta_apply(BTreeDescr *desc, OTuple rec)
+{
+	WALRecUpdateDelta delta;
+	OTuple		key,
+				cur,
+				result;
+	CommitSeqNo curCsn;
+	OffsetNumber oldLen,
+				newLen,
+				curLen,
+				prefixLen,
+				suffixLen;
+	uint32		oldHash,
+				newHash,
+				curHash;
+	int			size;
+
+	O_TUPLE_SET_NULL(result);
+	key = recovery_update_delta_get_key(rec, &size);
+	memcpy(&delta, rec.data, sizeof(delta));
+	memcpy(&oldLen, delta.oldLength, sizeof(OffsetNumber));
+	memcpy(&newLen, delta.newLength, sizeof(OffsetNumber));
+	memcpy(&prefixLen, delta.prefixLength, sizeof(OffsetNumber));
+	memcpy(&suffixLen, delta.suffixLength, sizeof(OffsetNumber));
+	memcpy(&oldHash, delta.oldHash, sizeof(uint32));
+	memcpy(&newHash, delta.newHash, sizeof(uint32));
+
+	cur = o_btree_find_tuple_by_key(desc, (Pointer) &key, BTreeKeyNonLeafKey,
+									COMMITSEQNO_INPROGRESS, &curCsn,
+									CurrentMemoryContext, NULL);
+	if (O_TUPLE_IS_NULL(cur))
+		return result;
+
+	curLen = o_btree_len(desc, cur, OTupleLength);
+	curHash = hash_bytes((unsigned char *) cur.data, curLen);
+
+	if (curLen == oldLen && curHash == oldHash)
+	{
+		result.formatFlags = rec.formatFlags;
+		result.data = palloc(newLen);
+		memcpy(result.data, cur.data, prefixLen);
+		memcpy(result.data + prefixLen,
+			   key.data + o_btree_len(desc, key, OKeyLength),
+			   newLen - prefixLen - suffixLen);
+		memcpy(result.data + newLen - suffixLen,
+			   cur.data + oldLen - suffixLen, suffixLen);
+		pfree(cur.data);
+	}
+	else if (curLen == newLen && curHash == newHash)
+	{
+		/* the tree already contains the new version */
+		result = cur;
+		result.formatFlags = rec.formatFlags;
+	}
+	else
+	{
+		pfree(cur.data);
+	}
+
+	return result;
+}
+
 OTuple
 recovery_rec_delete(BTreeDescr *desc, OTuple tuple, bool *allocated, int *size)
 {
@@ -1546,6 +1801,80 @@ orioledb_recovery_synchronized(PG_FUNCTION_ARGS)
 	PG_RETURN_BOOL(true);
 }
 
+/*
+ * Returns the statistics of recovery workers: the last replayed position,
+ * size of messages queued but not read yet, number of applied records and
+ * page loads, and the time startup process waited for the queue space and
+ * the worker synchronization.
+ */
+Datum
+orioledb_recovery_workers(PG_FUNCTION_ARGS)
+{
+	Datum		values[11];
+	bool		nulls[11];
+	int			i;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	TimestampTz now = GetCurrentTimestamp();
+
+	orioledb_check_shmem();
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < recovery_pool_size_guc + recovery_idx_pool_size_guc; i++)
+	{
+		RecoveryWorkerPtrs *ptrs = &worker_ptrs[i];
+		TimestampTz startTime = (TimestampTz) pg_atomic_read_u64(&ptrs->startTime);
+		XLogRecPtr	commitPtr = pg_atomic_read_u64(&ptrs->commitPtr);
+		uint64		sent = pg_atomic_read_u64(&ptrs->sentBytes),
+					received = pg_atomic_read_u64(&ptrs->receivedBytes),
+					applied = pg_atomic_read_u64(&ptrs->appliedRecords);
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = Int32GetDatum(i);
+		values[1] = PointerGetDatum(cstring_to_text(i < index_build_leader ?
+													"recovery" : "index_build"));
+		if (XLogRecPtrIsInvalid(commitPtr))
+			nulls[2] = true;
+		else
+			values[2] = LSNGetDatum(commitPtr);
+		values[3] = Int64GetDatum((int64) (sent > received ? sent - received : 0));
+		values[4] = Int64GetDatum((int64) sent);
+		values[5] = Int64GetDatum((int64) applied);
+		if (startTime == 0 || now <= startTime)
+			nulls[6] = true;
+		else
+			values[6] = Float8GetDatum((double) applied * USECS_PER_SEC /
+									   (double) (now - startTime));
+		values[7] = Int64GetDatum((int64) pg_atomic_read_u64(&ptrs->loadedPages));
+		values[8] = Float8GetDatum((double) pg_atomic_read_u64(&ptrs->sendWaitTime) / 1000.0);
+		values[9] = Float8GetDatum((double) pg_atomic_read_u64(&ptrs->syncWaitTime) / 1000.0);
+		if (startTime == 0)
+			nulls[10] = true;
+		else
+			values[10] = TimestampTzGetDatum(startTime);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 static void
 update_run_xmin(void)
 {
@@ -1900,6 +2229,7 @@ recovery_cleanup_old_files(uint32 chkp_num, bool before_recovery)
 			   *dbFile;
 	char	   *filename;
 	char		ext[5];
+	bool		removed;
 
 	if (!before_recovery && chkp_num == 0)
 		return;
@@ -1918,9 +2248,12 @@ recovery_cleanup_old_files(uint32 chkp_num, bool before_recovery)
 
 		dbDirName = psprintf(ORIOLEDB_DATA_DIR "/%u", dbOid);
 		dbDir = opendir(dbDirName);
-		pfree(dbDirName);
 		if (dbDir == NULL)
+		{
+			pfree(dbDirName);
 			continue;
+		}
+		removed = false;
 
 		while (errno = 0, (dbFile = readdir(dbDir)) != NULL)
 		{
@@ -1994,11 +2327,24 @@ recovery_cleanup_old_files(uint32 chkp_num, bool before_recovery)
 			if (cleanup)
 			{
 				filename = psprintf(ORIOLEDB_DATA_DIR "/%u/%s", dbOid, dbFile->d_name);
-				durable_unlink(filename, FATAL);
+				if (unlink(filename) < 0 && errno != ENOENT)
+					ereport(FATAL,
+							(errcode_for_file_access(),
+							 errmsg("could not remove file \"%s\": %m",
+									filename)));
 				pfree(filename);
+				removed = true;
 			}
 		}
 		closedir(dbDir);
+
+		/*
+		 * Make the removals durable with a single fsync of the directory
+		 * instead of one per file.
+		 */
+		if (removed)
+			fsync_fname(dbDirName, true);
+		pfree(dbDirName);
 	}
 
 	if (errno != 0)
@@ -2261,6 +2607,9 @@ replay_container(Pointer startPtr, Pointer endPtr,
 		rec_type = *ptr;
 		ptr++;
 
+		TRACE_ORIOLEDB_RECOVERY_RECORD(rec_type, cur_oids.datoid,
+									   cur_oids.relnode, xlogPtr);
+
 		if (rec_type == WAL_REC_XID)
 		{
 			memcpy(&oxid, ptr, sizeof(oxid));
@@ -2401,7 +2750,7 @@ replay_container(Pointer startPtr, Pointer endPtr,
 			ptr += sizeof(Oid);
 
 			if (!single)
-				workers_synchronize(xlogPtr, true);
+				workers_synchronize_table(xlogPtr, oids);
 
 			o_truncate_table(oids);
 
@@ -2439,7 +2788,8 @@ replay_container(Pointer startPtr, Pointer endPtr,
 		{
 			OFixedTuple tuple;
 
-			Assert(rec_type == WAL_REC_INSERT || rec_type == WAL_REC_UPDATE || rec_type == WAL_REC_DELETE);
+			Assert(rec_type == WAL_REC_INSERT || rec_type == WAL_REC_UPDATE ||
+				   rec_type == WAL_REC_UPDATE_DELTA || rec_type == WAL_REC_DELETE);
 
 			tuple.tuple.formatFlags = *ptr;
 			ptr++;
@@ -2457,6 +2807,7 @@ replay_container(Pointer startPtr, Pointer endPtr,
 			if (sys_tree_num > 0 && xlogRecPtr >= checkpoint_state->sysTreesStartPtr)
 			{
 				Assert(sys_tree_supports_transactions(sys_tree_num));
+				Assert(type != RECOVERY_UPDATE_DELTA);
 				recovery_switch_to_oxid(oxid, -1);
 
 				cur_state->systree_modified = true;
@@ -2503,6 +2854,7 @@ replay_container(Pointer startPtr, Pointer endPtr,
 			}
 			else
 			{
+				recovery_prefetch_record(&indexDescr->desc, type, tuple.tuple);
 				spread_idx_modify(&indexDescr->desc, type, tuple.tuple);
 			}
 
@@ -2644,6 +2996,84 @@ delay_rels_queued_for_idxbuild(ORelOids oids)
 /*
  * Sends modify message to a worker.
  */
+static void
+worker_track_sent_table(RecoveryWorkerState *state, ORelOids oids)
+{
+	int			i;
+
+	if (state->sentTablesOverflow)
+		return;
+
+	for (i = 0; i < state->sentTablesCount; i++)
+	{
+		if (state->sentTables[i].datoid == oids.datoid &&
+			state->sentTables[i].reloid == oids.reloid)
+			return;
+	}
+
+	if (state->sentTablesCount >= RECOVERY_MAX_SENT_TABLES)
+		state->sentTablesOverflow = true;
+	else
+		state->sentTables[state->sentTablesCount++] = oids;
+}
+
+static bool
+worker_has_sent_table(RecoveryWorkerState *state, ORelOids oids)
+{
+	int			i;
+
+	if (state->sentTablesOverflow)
+		return true;
+
+	for (i = 0; i < state->sentTablesCount; i++)
+	{
+		if (state->sentTables[i].datoid == oids.datoid &&
+			state->sentTables[i].reloid == oids.reloid)
+			return true;
+	}
+	return false;
+}
+
+static void
+worker_wait_ptr(int worker_id, XLogRecPtr ptr)
+{
+	int			j = 0;
+	TimestampTz start = 0;
+
+	if (pg_atomic_read_u64(&worker_ptrs[worker_id].commitPtr) < ptr)
+		start = GetCurrentTimestamp();
+
+	while (pg_atomic_read_u64(&worker_ptrs[worker_id].commitPtr) < ptr &&
+		   workers_pool[worker_id].queue)
+	{
+		BgwHandleStatus status;
+		pid_t		pid;
+
+		pg_usleep(10);
+
+		if (j % 100 == 0)
+		{
+			status = GetBackgroundWorkerPid(workers_pool[worker_id].handle, &pid);
+			if (status != BGWH_STARTED && status != BGWH_NOT_YET_STARTED)
+			{
+				unexpected_worker_detach = true;
+				break;
+			}
+		}
+		j++;
+	}
+
+	if (start != 0)
+		pg_atomic_fetch_add_u64(&worker_ptrs[worker_id].syncWaitTime,
+								GetCurrentTimestamp() - start);
+
+	if (!unexpected_worker_detach)
+	{
+		workers_pool[worker_id].sentTablesCount = 0;
+		workers_pool[worker_id].sentTablesOverflow = false;
+	}
+}
+
 static void
 worker_send_modify(int worker_id, BTreeDescr *desc, uint16 recType,
 				   OTuple tuple, int tuple_len)
@@ -2715,6 +3145,10 @@ worker_send_modify(int worker_id, BTreeDescr *desc, uint16 recType,
 		header->type |= RECOVERY_MODIFY_OIDS;
 		state->oids = oids;
 		state->type = type;
+
+		if (!IS_SYS_TREE_OIDS(desc->oids))
+			worker_track_sent_table(state,
+									((OIndexDescr *) desc->arg)->tableOids);
 	}
 
 	memcpy(data, &tuple_len, sizeof(int));
@@ -2902,29 +3336,143 @@ workers_synchronize(XLogRecPtr ptr, bool send_synchronize)
 	}
 
 	for (i = 0; i < recovery_pool_size_guc && !unexpected_worker_detach; i++)
+		worker_wait_ptr(i, ptr);
+
+	if (!unexpected_worker_detach && recovery_route_worker)
+		workers_rebalance();
+}
+
+/*
+ * Waits only for the workers, which might have records of the given table
+ * not yet applied.  Other workers continue replay.
+ */
+static void
+workers_synchronize_table(XLogRecPtr ptr, ORelOids oids)
+{
+	RecoveryMsgPtr sync_msg;
+	bool	   *waitFor;
+	int			i;
+
+	waitFor = palloc0(sizeof(bool) * recovery_pool_size_guc);
+	sync_msg.header.type = RECOVERY_SYNCHRONIZE;
+	sync_msg.ptr = ptr;
+	for (i = 0; i < recovery_pool_size_guc; i++)
 	{
-		int			j = 0;
+		if (!worker_has_sent_table(&workers_pool[i], oids))
+			continue;
+
+		waitFor[i] = true;
+		worker_send_msg(i, (Pointer) &sync_msg, sizeof(sync_msg));
+		worker_queue_flush(i);
+	}
+
+	for (i = 0; i < recovery_pool_size_guc && !unexpected_worker_detach; i++)
+	{
+		if (waitFor[i])
+			worker_wait_ptr(i, ptr);
+	}
+	pfree(waitFor);
+}
+
+static int
+route_index_load_cmp(const void *a, const void *b)
+{
+	uint64		load1 = recovery_route_load[*(const int *) a],
+				load2 = recovery_route_load[*(const int *) b];
+
+	if (load1 != load2)
+		return load1 > load2 ? -1 : 1;
+	return *(const int *) a - *(const int *) b;
+}
+
+/*
+ * Reassigns the routing buckets to the workers if one of them got
+ * significantly more records than the average since the last rebalance.
+ * Buckets are assigned in the descending order of load to the least loaded
+ * worker.
+ */
+static void
+workers_rebalance(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	RecoveryXidState *state;
+	uint64	   *workerLoad;
+	uint64		total = 0,
+				maxLoad = 0;
+	int			buckets[RECOVERY_ROUTE_BUCKETS];
+	int			i,
+				j;
+
+	for (i = 0; i < RECOVERY_ROUTE_BUCKETS; i++)
+		total += recovery_route_load[i];
+	if (total < RECOVERY_REBALANCE_MIN_RECORDS || recovery_pool_size_guc < 2)
+		return;
 
-		while (pg_atomic_read_u64(&worker_ptrs[i].commitPtr) < ptr &&
-			   workers_pool[i].queue)
+	/* Records of in-progress transactions should stay on their workers */
+	hash_seq_init(&hash_seq, recovery_xid_state_hash);
+	while ((state = (RecoveryXidState *) hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (state->csn == COMMITSEQNO_INPROGRESS)
 		{
-			BgwHandleStatus status;
-			pid_t		pid;
+			hash_seq_term(&hash_seq);
+			return;
+		}
+	}
 
-			pg_usleep(10);
+	workerLoad = palloc0(sizeof(uint64) * recovery_pool_size_guc);
+	for (i = 0; i < RECOVERY_ROUTE_BUCKETS; i++)
+		workerLoad[recovery_route_worker[i]] += recovery_route_load[i];
+	for (i = 0; i < recovery_pool_size_guc; i++)
+		maxLoad = Max(maxLoad, workerLoad[i]);
 
-			if (j % 100 == 0)
-			{
-				status = GetBackgroundWorkerPid(workers_pool[i].handle, &pid);
-				if (status != BGWH_STARTED && status != BGWH_NOT_YET_STARTED)
-				{
-					unexpected_worker_detach = true;
-					break;
-				}
-			}
-			j++;
+	if (maxLoad * 2 * recovery_pool_size_guc > total * 3)
+	{
+		for (i = 0; i < RECOVERY_ROUTE_BUCKETS; i++)
+			buckets[i] = i;
+		pg_qsort(buckets, RECOVERY_ROUTE_BUCKETS, sizeof(int),
+				 route_index_load_cmp);
+
+		memset(workerLoad, 0, sizeof(uint64) * recovery_pool_size_guc);
+		for (i = 0; i < RECOVERY_ROUTE_BUCKETS; i++)
+		{
+			int			minWorker = 0;
+
+			for (j = 1; j < recovery_pool_size_guc; j++)
+				if (workerLoad[j] < workerLoad[minWorker])
+					minWorker = j;
+			recovery_route_worker[buckets[i]] = minWorker;
+			workerLoad[minWorker] += recovery_route_load[buckets[i]];
 		}
 	}
+	pfree(workerLoad);
+
+	/* Decay the load, so the routing follows changes of the workload */
+	for (i = 0; i < RECOVERY_ROUTE_BUCKETS; i++)
+		recovery_route_load[i] /= 2;
+}
+
+/*
+ * Returns the worker responsible for the records with given key hash.
+ */
+static inline int
+route_worker_id(uint32 hash)
+{
+	int			bucket = hash % RECOVERY_ROUTE_BUCKETS;
+
+	if (recovery_route_worker == NULL)
+	{
+		int			i;
+
+		recovery_route_worker = MemoryContextAlloc(TopMemoryContext,
+												   sizeof(int) * RECOVERY_ROUTE_BUCKETS);
+		recovery_route_load = MemoryContextAllocZero(TopMemoryContext,
+													 sizeof(uint64) * RECOVERY_ROUTE_BUCKETS);
+		for (i = 0; i < RECOVERY_ROUTE_BUCKETS; i++)
+			recovery_route_worker[i] = i % recovery_pool_size_guc;
+	}
+
+	recovery_route_load[bucket]++;
+	return recovery_route_worker[bucket];
 }
 
 
@@ -2954,12 +3502,17 @@ worker_queue_flush(int worker_id)
 {
 	RecoveryWorkerState *state = &workers_pool[worker_id];
 	shm_mq_result result;
+	TimestampTz start = GetCurrentTimestamp();
 
 #if PG_VERSION_NUM >= 150000
 	result = shm_mq_send(state->queue, state->queue_buf_len, state->queue_buf, false, true);
 #else
 	result = shm_mq_send(state->queue, state->queue_buf_len, state->queue_buf, false);
 #endif
+	pg_atomic_fetch_add_u64(&worker_ptrs[worker_id].sendWaitTime,
+							GetCurrentTimestamp() - start);
+	pg_atomic_fetch_add_u64(&worker_ptrs[worker_id].sentBytes,
+							state->queue_buf_len);
 	state->queue_buf_len = 0;
 	Assert(result != SHM_MQ_WOULD_BLOCK);
 	if (result == SHM_MQ_DETACHED)
@@ -2999,7 +3552,7 @@ apply_sys_tree_modify_record(int sys_tree_num, uint16 type, OTuple tup,
 static inline void
 spread_idx_modify(BTreeDescr *desc, uint16 recType, OTuple rec)
 {
-	OTuple		key PG_USED_FOR_ASSERTS_ONLY;
+	OTuple		key;
 	uint32		hash;
 	int			key_len,
 				tup_len;
@@ -3017,13 +3570,19 @@ spread_idx_modify(BTreeDescr *desc, uint16 recType, OTuple rec)
 			if (key_pfree)
 				pfree(key.data);
 #endif
-			worker_send_modify(GET_WORKER_ID(hash), desc,
+			worker_send_modify(route_worker_id(hash), desc,
 							   recType, rec, tup_len);
 			break;
+		case RECOVERY_UPDATE_DELTA:
+			key = recovery_update_delta_get_key(rec, &tup_len);
+			hash = o_btree_hash(desc, key, BTreeKeyNonLeafKey);
+			worker_send_modify(route_worker_id(hash), desc, recType,
+							   rec, tup_len);
+			break;
 		case RECOVERY_DELETE:
 			key_len = o_btree_len(desc, rec, OKeyLength);
 			hash = o_btree_hash(desc, rec, BTreeKeyNonLeafKey);
-			worker_send_modify(GET_WORKER_ID(hash), desc, recType,
+			worker_send_modify(route_worker_id(hash), desc, recType,
 							   rec, key_len);
 			break;
 		default:
@@ -3031,6 +3590,52 @@ spread_idx_modify(BTreeDescr *desc, uint16 recType, OTuple rec)
 	}
 }
 
+/*
+ * Issues read-ahead for the on-disk leaf page the record is going to modify.
+ * The record would be applied by the worker after the records queued before
+ * it, so the page is likely to be read by that moment.  When the tree turns
+ * out to be in memory, prefetching is skipped for an increasing number of
+ * records.
+ */
+static inline void
+recovery_prefetch_record(BTreeDescr *desc, uint16 recType, OTuple rec)
+{
+	OTuple		key;
+	Pointer		keyPtr;
+	BTreeKeyType keyType;
+	int			size;
+
+	if (!recovery_prefetch || recovery_prefetch_skip-- > 0)
+		return;
+
+	switch (recType)
+	{
+		case RECOVERY_INSERT:
+		case RECOVERY_UPDATE:
+			key = rec;
+			keyType = BTreeKeyLeafTuple;
+			break;
+		case RECOVERY_UPDATE_DELTA:
+			key = recovery_update_delta_get_key(rec, &size);
+			keyType = BTreeKeyNonLeafKey;
+			break;
+		case RECOVERY_DELETE:
+			key = rec;
+			keyType = BTreeKeyNonLeafKey;
+			break;
+		default:
+			return;
+	}
+
+	keyPtr = (Pointer) &key;
+	if (btree_prefetch_keys(desc, &keyPtr, 1, keyType) > 0)
+		recovery_prefetch_backoff = 0;
+	else
+		recovery_prefetch_backoff = Min(Max(recovery_prefetch_backoff * 2, 1),
+										RECOVERY_PREFETCH_MAX_BACKOFF);
+	recovery_prefetch_skip = recovery_prefetch_backoff;
+}
+
 /*
  * Converts wal record type to recovery message type.
  */
@@ -3045,6 +3650,8 @@ recovery_msg_from_wal_record(uint8 wal_record)
 			return RECOVERY_DELETE;
 		case WAL_REC_UPDATE:
 			return RECOVERY_UPDATE;
+		case WAL_REC_UPDATE_DELTA:
+			return RECOVERY_UPDATE_DELTA;
 		default:
 			Assert(false);
 			elog(ERROR, "Wrong WAL record modify type %d", wal_record);
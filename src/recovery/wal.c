@@ -14,16 +14,38 @@
 
 #include "orioledb.h"
 
+#include "access/xlog.h"
 #include "access/xloginsert.h"
 #include "catalog/sys_trees.h"
 #include "recovery/recovery.h"
 #include "recovery/wal.h"
 #include "tableam/descr.h"
 #include "transam/oxid.h"
+#include "utils/o_latency.h"
 
+#include "pgstat.h"
 #include "replication/message.h"
+#include "storage/condition_variable.h"
 #include "storage/proc.h"
 
+#include <lz4.h>
+
+/*
+ * Shared state of the commit group flush.  The first committing backend
+ * becomes the group leader, waits for commit_delay, and flushes WAL up to the
+ * highest commit position requested.  Other backends wait for the leader to
+ * complete the round.
+ */
+typedef struct
+{
+	pg_atomic_uint64 groupFlushPos;
+	pg_atomic_uint32 groupLeader;
+	pg_atomic_uint64 groupGeneration;
+	ConditionVariable groupFlushedCV;
+} WalGroupCommitMeta;
+
+static WalGroupCommitMeta *wal_group_commit_meta = NULL;
+
 static char local_wal_buffer[LOCAL_WAL_BUFFER_SIZE];
 static int	local_wal_buffer_offset;
 static ORelOids local_oids;
@@ -35,6 +57,27 @@ static void add_xid_wal_record(OXid oxid);
 static void add_rel_wal_record(ORelOids oids, OIndexType type);
 static void flush_local_wal_if_needed(int required_length);
 static inline void add_local_modify(uint8 record_type, OTuple record, OffsetNumber length);
+static void wal_group_flush(XLogRecPtr pos);
+
+Size
+wal_shmem_needs(void)
+{
+	return CACHELINEALIGN(sizeof(WalGroupCommitMeta));
+}
+
+void
+wal_shmem_init(Pointer ptr, bool found)
+{
+	wal_group_commit_meta = (WalGroupCommitMeta *) ptr;
+
+	if (!found)
+	{
+		pg_atomic_init_u64(&wal_group_commit_meta->groupFlushPos, InvalidXLogRecPtr);
+		pg_atomic_init_u32(&wal_group_commit_meta->groupLeader, 0);
+		pg_atomic_init_u64(&wal_group_commit_meta->groupGeneration, 0);
+		ConditionVariableInit(&wal_group_commit_meta->groupFlushedCV);
+	}
+}
 
 void
 add_modify_wal_record(uint8 rec_type, BTreeDescr *desc,
@@ -57,7 +100,8 @@ add_modify_wal_record(uint8 rec_type, BTreeDescr *desc,
 	}
 
 	Assert(!is_recovery_process());
-	Assert(rec_type == WAL_REC_INSERT || rec_type == WAL_REC_UPDATE || rec_type == WAL_REC_DELETE);
+	Assert(rec_type == WAL_REC_INSERT || rec_type == WAL_REC_UPDATE ||
+		   rec_type == WAL_REC_UPDATE_DELTA || rec_type == WAL_REC_DELETE);
 
 	required_length = sizeof(WALRecModify) + length;
 
@@ -104,6 +148,7 @@ void
 wal_commit(OXid oxid)
 {
 	XLogRecPtr	wait_pos;
+	instr_time	start;
 
 	Assert(!is_recovery_process());
 
@@ -116,11 +161,95 @@ wal_commit(OXid oxid)
 	if (local_wal_buffer_offset == 0)
 		add_xid_wal_record(oxid);
 	add_finish_wal_record(WAL_REC_COMMIT, pg_atomic_read_u64(&xid_meta->runXmin));
+
+	O_LATENCY_START(start);
 	wait_pos = flush_local_wal(true);
 
 	if (synchronous_commit > SYNCHRONOUS_COMMIT_OFF ||
 		oxid_needs_wal_flush)
-		XLogFlush(wait_pos);
+		wal_group_flush(wait_pos);
+	else
+		XLogSetAsyncXactLSN(wait_pos);
+	o_latency_report(OLatencyCommitWal, start);
+}
+
+/*
+ * Checks if there are at least CommitSiblings other backends committing
+ * orioledb transactions.  Unlike MinimumActiveBackends(), it counts
+ * transactions without builtin xid.
+ */
+static bool
+commit_siblings_active(void)
+{
+	ODBProcData *curProcData = GET_CUR_PROCDATA();
+	int			count = 0;
+	int			i;
+
+	if (CommitSiblings <= 0)
+		return true;
+
+	for (i = 0; i < max_procs; i++)
+	{
+		if (&oProcData[i] == curProcData)
+			continue;
+
+		if (pg_atomic_read_u64(&oProcData[i].commitInProgressXlogLocation) != OWalInvalidCommitPos &&
+			++count >= CommitSiblings)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Flushes WAL up to the commit position.  Commits of concurrent backends are
+ * flushed together by the group leader.
+ */
+static void
+wal_group_flush(XLogRecPtr pos)
+{
+	uint64		curPos;
+	uint64		generation;
+	uint32		expected = 0;
+
+	if (CommitDelay <= 0 || !enableFsync || !commit_siblings_active())
+	{
+		XLogFlush(pos);
+		return;
+	}
+
+	curPos = pg_atomic_read_u64(&wal_group_commit_meta->groupFlushPos);
+	while (curPos < pos)
+	{
+		if (pg_atomic_compare_exchange_u64(&wal_group_commit_meta->groupFlushPos,
+										   &curPos, pos))
+			break;
+	}
+	generation = pg_atomic_read_u64(&wal_group_commit_meta->groupGeneration);
+
+	if (pg_atomic_compare_exchange_u32(&wal_group_commit_meta->groupLeader,
+									   &expected, 1))
+	{
+		/* wait for the followers to insert their commit records */
+		pg_usleep(CommitDelay);
+
+		curPos = pg_atomic_read_u64(&wal_group_commit_meta->groupFlushPos);
+		XLogFlush(Max(pos, curPos));
+
+		pg_atomic_fetch_add_u64(&wal_group_commit_meta->groupGeneration, 1);
+		pg_atomic_write_u32(&wal_group_commit_meta->groupLeader, 0);
+		ConditionVariableBroadcast(&wal_group_commit_meta->groupFlushedCV);
+		return;
+	}
+
+	ConditionVariablePrepareToSleep(&wal_group_commit_meta->groupFlushedCV);
+	while (pg_atomic_read_u32(&wal_group_commit_meta->groupLeader) != 0 &&
+		   pg_atomic_read_u64(&wal_group_commit_meta->groupGeneration) == generation)
+		ConditionVariableSleep(&wal_group_commit_meta->groupFlushedCV,
+							   WAIT_EVENT_WAL_SYNC);
+	ConditionVariableCancelSleep();
+
+	/* cheap if the leader has already flushed our commit record */
+	XLogFlush(pos);
 }
 
 void
@@ -164,6 +293,8 @@ wal_rollback(OXid oxid)
 	wait_pos = flush_local_wal(false);
 	if (synchronous_commit > SYNCHRONOUS_COMMIT_OFF)
 		XLogFlush(wait_pos);
+	else
+		XLogSetAsyncXactLSN(wait_pos);
 }
 
 static void
@@ -408,6 +539,34 @@ XLogRecPtr
 log_logical_wal_container(Pointer ptr, int length)
 {
 #if PG_VERSION_NUM >= 150000
+	/*
+	 * Containers are compressed as a whole: consecutive modify records of
+	 * the same relation share a lot of tuple data.  The compressed container
+	 * starts with the uncompressed length.  Containers which don't get smaller
+	 * are written as is.
+	 */
+	if (wal_compress && length >= WAL_COMPRESS_MIN_LENGTH &&
+		length <= LOCAL_WAL_BUFFER_SIZE)
+	{
+		static char compressed[sizeof(uint16) +
+							   LZ4_COMPRESSBOUND(LOCAL_WAL_BUFFER_SIZE)];
+		uint16		raw_length = length;
+		int			compressed_length;
+
+		compressed_length = LZ4_compress_default(ptr,
+												 compressed + sizeof(uint16),
+												 length,
+												 LZ4_COMPRESSBOUND(LOCAL_WAL_BUFFER_SIZE));
+		if (compressed_length > 0 &&
+			compressed_length + sizeof(uint16) < length)
+		{
+			memcpy(compressed, &raw_length, sizeof(uint16));
+			XLogBeginInsert();
+			XLogRegisterData(compressed, compressed_length + sizeof(uint16));
+			return XLogInsert(ORIOLEDB_RMGR_ID, ORIOLEDB_XLOG_CONTAINER_LZ4);
+		}
+	}
+
 	XLogBeginInsert();
 	XLogRegisterData(ptr, length);
 	return XLogInsert(ORIOLEDB_RMGR_ID, ORIOLEDB_XLOG_CONTAINER);
@@ -448,6 +607,34 @@ o_wal_update(BTreeDescr *desc, OTuple tuple)
 		pfree(wal_record.data);
 }
 
+/*
+ * Makes WAL update record containing only the changed part of the tuple
+ * relative to its previous version.  Falls back to the whole tuple when the
+ * delta isn't shorter.
+ */
+void
+o_wal_update_delta(BTreeDescr *desc, OTuple oldTuple, OTuple tuple)
+{
+	OTuple		wal_record;
+	int			size;
+
+	if (O_TUPLE_IS_NULL(oldTuple))
+	{
+		o_wal_update(desc, tuple);
+		return;
+	}
+
+	wal_record = recovery_rec_update_delta(desc, oldTuple, tuple, &size);
+	if (O_TUPLE_IS_NULL(wal_record))
+	{
+		o_wal_update(desc, tuple);
+		return;
+	}
+
+	add_modify_wal_record(WAL_REC_UPDATE_DELTA, desc, wal_record, size);
+	pfree(wal_record.data);
+}
+
 /*
  * Makes WAL delete record.
  */
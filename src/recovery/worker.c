@@ -14,6 +14,7 @@
 
 #include "orioledb.h"
 
+#include "btree/io.h"
 #include "btree/modify.h"
 #include "catalog/indices.h"
 #include "catalog/o_sys_cache.h"
@@ -37,6 +38,7 @@
 #include "utils/inval.h"
 #include "utils/syscache.h"
 #include "utils/timeout.h"
+#include "utils/timestamp.h"
 
 #if PG_VERSION_NUM >= 140000
 #include "utils/wait_event.h"
@@ -209,6 +211,8 @@ recovery_worker_main(Datum main_arg)
 		recovery_worker_queue = shm_mq_attach(GET_WORKER_QUEUE(id), NULL, NULL);
 
 		my_ptr = pg_atomic_read_u64(&worker_ptrs[id].commitPtr);
+		pg_atomic_write_u64(&worker_ptrs[id].startTime,
+							(uint64) GetCurrentTimestamp());
 		recovery_queue_process(recovery_worker_queue, id);
 		if (detached)
 		{
@@ -279,6 +283,7 @@ recovery_queue_process(shm_mq_handle *queue, int id)
 				data_pos;
 	bool		finished = false;
 	OXid		oxid;
+	uint64		applied_records = 0;
 
 	while (!finished)
 	{
@@ -286,6 +291,8 @@ recovery_queue_process(shm_mq_handle *queue, int id)
 		if (detached)
 			break;
 
+		pg_atomic_fetch_add_u64(&worker_ptrs[id].receivedBytes, data_size);
+
 		Assert(data != NULL);
 		data_pos = 0;
 		while (data_pos < data_size)
@@ -343,6 +350,7 @@ recovery_queue_process(shm_mq_handle *queue, int id)
 										(recovery_header->type & RECOVERY_MODIFY),
 										tuple);
 				}
+				applied_records++;
 				data_pos += tuple_len;
 			}
 #if PG_VERSION_NUM >= 140000
@@ -456,6 +464,8 @@ recovery_queue_process(shm_mq_handle *queue, int id)
 			}
 			data_pos = MAXALIGN(data_pos);
 		}
+		pg_atomic_write_u64(&worker_ptrs[id].appliedRecords, applied_records);
+		pg_atomic_write_u64(&worker_ptrs[id].loadedPages, loaded_pages_count);
 		update_recovery_undo_loc_flush(false, id);
 	}
 	if (descr)
@@ -471,10 +481,21 @@ apply_modify_record(OTableDescr *descr, OIndexDescr *id, uint16 type,
 {
 	OXid		oxid;
 	CommitSeqNo csn;
+	bool		delta = false;
 
 	oxid = get_current_oxid();
 	csn = COMMITSEQNO_INPROGRESS;
 
+	if (type == RECOVERY_UPDATE_DELTA)
+	{
+		o_btree_load_shmem(&id->desc);
+		p = recovery_update_delta_apply(&id->desc, p);
+		if (O_TUPLE_IS_NULL(p))
+			return;
+		type = RECOVERY_UPDATE;
+		delta = true;
+	}
+
 	/*
 	 * Don't apply changes to secondary indices before TOAST is consisntent.
 	 * Otherwise, values of secondary indices on TOASTed fields can be
@@ -490,6 +511,9 @@ apply_modify_record(OTableDescr *descr, OIndexDescr *id, uint16 type,
 		o_btree_load_shmem(&id->desc);
 		apply_btree_modify_record(&id->desc, type, p, oxid, csn);
 	}
+
+	if (delta)
+		pfree(p.data);
 }
 
 /*
@@ -19,6 +19,7 @@
 #include "s3/checkpoint.h"
 #include "s3/headers.h"
 #include "s3/worker.h"
+#include "workers/prewarm.h"
 
 #include "utils/wait_event.h"
 
@@ -57,6 +58,9 @@
 #include "utils/resowner.h"
 #include "utils/timestamp.h"
 
+#include "openssl/evp.h"
+#include "openssl/sha.h"
+
 /*
  * How much data do we want to send in one CopyData message? Note that
  * this may also result in reading the underlying files in chunks of this
@@ -188,14 +192,43 @@ typedef struct
 	int64		size;			/* total size as sent; -1 if not known */
 } tablespaceinfo;
 
+/*
+ * The backup manifest lists every file of the backup together with the hash
+ * of its contents and the checkpoint the object holding the contents was
+ * uploaded with.  Files unchanged since the previous backup aren't uploaded
+ * again: the new manifest references their objects of previous checkpoints.
+ *
+ * Each line of the manifest has the format:
+ *
+ * <sha256 hex> <checkpoint number> <small files bundle number> <file name>
+ *
+ * where the bundle number is -1 for the files uploaded as separate objects.
+ * The local copy of the manifest of the last completed backup is kept in
+ * the orioledb data directory, which isn't included into the backup.
+ */
+#define S3_MANIFEST_FILENAME		ORIOLEDB_DATA_DIR "/s3_manifest"
+#define S3_MANIFEST_TMP_FILENAME	ORIOLEDB_DATA_DIR "/s3_manifest.tmp"
+#define S3_HASH_HEX_LEN				(2 * SHA256_DIGEST_LENGTH)
+
+typedef struct
+{
+	char		name[MAXPGPATH];
+	char		hash[S3_HASH_HEX_LEN + 1];
+	uint32		chkpNum;
+	int			bundle;
+} S3ManifestEntry;
+
 typedef struct
 {
 	List	   *tablespaces;
 	List	   *smallFileNames;
 	List	   *smallFileSizes;
+	List	   *smallFileDatas;
 	int			smallFilesTotalSize;
 	int			smallFilesNum;
 	uint32		chkpNum;
+	HTAB	   *prevManifest;
+	StringInfoData manifest;
 } S3BackupState;
 
 #define SMALL_FILE_THRESHOLD		0x10000
@@ -205,10 +238,17 @@ static S3TaskLocation flush_small_files(S3BackupState *state);
 static S3TaskLocation accumulate_small_file(S3BackupState *state,
 											const char *path,
 											int size);
+static S3TaskLocation backup_file(S3BackupState *state, const char *path);
+static HTAB *load_manifest(void);
+static S3TaskLocation finish_manifest(S3BackupState *state,
+									  S3TaskLocation maxLocation);
 static int64 s3_backup_scan_dir(S3BackupState *state,
 								const char *path, int basepathlen,
 								const char *spcoid);
 static List *get_tablespaces(StringInfo tblspcmapfile);
+static void write_data(File file, char *filename, int offset, Pointer ptr,
+					   int length);
+static Pointer read_small_file(const char *filename, int *size);
 
 /*
  * Actually do a base backup for the specified tablespaces.
@@ -242,8 +282,11 @@ s3_perform_backup(S3TaskLocation maxLocation)
 	state.chkpNum = chkpNum;
 	state.smallFileNames = NIL;
 	state.smallFileSizes = NIL;
+	state.smallFileDatas = NIL;
 	state.smallFilesTotalSize = sizeof(int);
 	state.smallFilesNum = 0;
+	state.prevManifest = load_manifest();
+	initStringInfo(&state.manifest);
 
 	/* Send off our tablespaces one by one */
 	foreach(lc, state.tablespaces)
@@ -267,6 +310,13 @@ s3_perform_backup(S3TaskLocation maxLocation)
 			location = s3_schedule_file_write(chkpNum, xidFilename, false);
 			maxLocation = Max(maxLocation, location);
 			pfree(xidFilename);
+
+			/* Let the node restored from this backup prewarm its caches */
+			if (prewarm_workers > 0)
+			{
+				location = s3_schedule_file_write(chkpNum, PREWARM_FILENAME, false);
+				maxLocation = Max(maxLocation, location);
+			}
 		}
 		else
 		{
@@ -280,11 +330,235 @@ s3_perform_backup(S3TaskLocation maxLocation)
 	location = flush_small_files(&state);
 	maxLocation = Max(maxLocation, location);
 
+	maxLocation = finish_manifest(&state, maxLocation);
 
+	hash_destroy(state.prevManifest);
+	pfree(state.manifest.data);
 	pfree(tablespaceMapData.data);
 	s3_queue_wait_for_location(maxLocation);
 }
 
+/*
+ * Returns the name of the file as used in the S3 object name.
+ */
+static const char *
+backup_object_name(const char *path)
+{
+	if (path[0] == '.' && path[1] == '/')
+		return path + 2;
+	return path;
+}
+
+static void
+hash_to_hex(unsigned char *hash, char *hex)
+{
+	hex_encode((char *) hash, SHA256_DIGEST_LENGTH, hex);
+	hex[S3_HASH_HEX_LEN] = '\0';
+}
+
+/*
+ * Loads the manifest of the last completed backup.  Returns an empty hash
+ * if there is no such backup or its manifest is unreadable.  Then all the
+ * files are uploaded.
+ */
+static HTAB *
+create_manifest_hash(void)
+{
+	HASHCTL		ctl;
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = MAXPGPATH;
+	ctl.entrysize = sizeof(S3ManifestEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	return hash_create("orioledb s3 backup manifest", 1024, &ctl,
+					   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+static HTAB *
+load_manifest(void)
+{
+	HTAB	   *result = create_manifest_hash();
+	FILE	   *file;
+	char		line[MAXPGPATH + 128];
+
+	file = AllocateFile(S3_MANIFEST_FILENAME, PG_BINARY_R);
+	if (file == NULL)
+		return result;
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		char		hash[S3_HASH_HEX_LEN + 1];
+		char		key[MAXPGPATH];
+		uint32		chkpNum;
+		int			bundle;
+		int			nameOffset;
+		int			len;
+		S3ManifestEntry *entry;
+
+		len = strlen(line);
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		if (sscanf(line, "%64s %u %d %n", hash, &chkpNum, &bundle,
+				   &nameOffset) != 3 ||
+			strlen(hash) != S3_HASH_HEX_LEN ||
+			len - nameOffset <= 0 || len - nameOffset >= MAXPGPATH)
+		{
+			ereport(LOG,
+					(errmsg("invalid line in orioledb s3 backup manifest \"%s\", all files will be uploaded",
+							S3_MANIFEST_FILENAME)));
+			hash_destroy(result);
+			FreeFile(file);
+			return create_manifest_hash();
+		}
+
+		memset(key, 0, sizeof(key));
+		strlcpy(key, line + nameOffset, sizeof(key));
+		entry = (S3ManifestEntry *) hash_search(result, key, HASH_ENTER, NULL);
+		memcpy(entry->hash, hash, sizeof(entry->hash));
+		entry->chkpNum = chkpNum;
+		entry->bundle = bundle;
+	}
+
+	FreeFile(file);
+
+	return result;
+}
+
+static void
+manifest_add(S3BackupState *state, const char *name, const char *hash,
+			 uint32 chkpNum, int bundle)
+{
+	appendStringInfo(&state->manifest, "%s %u %d %s\n",
+					 hash, chkpNum, bundle, name);
+}
+
+/*
+ * Checks if the file with given contents hash was already uploaded by the
+ * previous backup.  If so, adds the reference to the existing object to the
+ * new manifest.
+ *
+ * Note that we might upload the contents differing from the hashed ones if
+ * the file is concurrently modified.  This is fine: the next backup will
+ * find the hash changed and upload the file again.  The file can't get back
+ * to the exactly hashed contents later, because data pages carry LSNs.
+ */
+static bool
+manifest_reuse(S3BackupState *state, const char *name, const char *hash)
+{
+	char		key[MAXPGPATH];
+	S3ManifestEntry *entry;
+
+	memset(key, 0, sizeof(key));
+	strlcpy(key, name, sizeof(key));
+	entry = (S3ManifestEntry *) hash_search(state->prevManifest, key,
+											HASH_FIND, NULL);
+	if (!entry || strcmp(entry->hash, hash) != 0)
+		return false;
+
+	manifest_add(state, name, hash, entry->chkpNum, entry->bundle);
+	return true;
+}
+
+/*
+ * Calculates the hash of the file contents.  Returns false if the file is
+ * gone.
+ */
+static bool
+file_contents_hash(const char *path, char *hex)
+{
+	File		file;
+	char	   *buffer;
+	EVP_MD_CTX *ctx;
+	off_t		offset = 0;
+	int			rc;
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+
+	file = PathNameOpenFile(path, O_RDONLY | PG_BINARY);
+	if (file < 0)
+	{
+		if (errno == ENOENT)
+			return false;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+	}
+
+	buffer = palloc(SINK_BUFFER_LENGTH);
+	ctx = EVP_MD_CTX_new();
+	EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+
+	while ((rc = FileRead(file, buffer, SINK_BUFFER_LENGTH, offset,
+						  WAIT_EVENT_DATA_FILE_READ)) > 0)
+	{
+		EVP_DigestUpdate(ctx, buffer, rc);
+		offset += rc;
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if (rc < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", path)));
+
+	EVP_DigestFinal_ex(ctx, hash, NULL);
+	EVP_MD_CTX_free(ctx);
+	pfree(buffer);
+	FileClose(file);
+
+	hash_to_hex(hash, hex);
+	return true;
+}
+
+/*
+ * Schedules the upload of the file unless it's unchanged since the previous
+ * backup.
+ */
+static S3TaskLocation
+backup_file(S3BackupState *state, const char *path)
+{
+	const char *name = backup_object_name(path);
+	char		hash[S3_HASH_HEX_LEN + 1];
+
+	/* If the file went away while scanning, it's not an error. */
+	if (!file_contents_hash(path, hash))
+		return 0;
+
+	if (manifest_reuse(state, name, hash))
+		return 0;
+
+	manifest_add(state, name, hash, state->chkpNum, -1);
+	return s3_schedule_file_write(state->chkpNum, (char *) path, false);
+}
+
+/*
+ * Writes the manifest of the backup.  It becomes the reference for the next
+ * backup only after all the files are uploaded, so we wait for that.
+ */
+static S3TaskLocation
+finish_manifest(S3BackupState *state, S3TaskLocation maxLocation)
+{
+	File		file;
+
+	file = PathNameOpenFile(S3_MANIFEST_TMP_FILENAME,
+							O_RDWR | O_CREAT | O_TRUNC | PG_BINARY);
+	if (file < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m",
+						S3_MANIFEST_TMP_FILENAME)));
+
+	write_data(file, S3_MANIFEST_TMP_FILENAME, 0, state->manifest.data,
+			   state->manifest.len);
+	FileClose(file);
+
+	s3_queue_wait_for_location(maxLocation);
+
+	(void) durable_rename(S3_MANIFEST_TMP_FILENAME, S3_MANIFEST_FILENAME, ERROR);
+
+	return s3_schedule_file_write(state->chkpNum, S3_MANIFEST_FILENAME, false);
+}
+
 static int64
 s3_backup_scan_dir(S3BackupState *state, const char *path,
 				   int basepathlen, const char *spcoid)
@@ -552,7 +826,7 @@ s3_backup_scan_dir(S3BackupState *state, const char *path,
 			if (statbuf.st_size < SMALL_FILE_THRESHOLD)
 				location = accumulate_small_file(state, pathbuf, statbuf.st_size);
 			else
-				location = s3_schedule_file_write(state->chkpNum, pathbuf, false);
+				location = backup_file(state, pathbuf);
 			maxLocation = Max(maxLocation, location);
 		}
 		else
@@ -695,20 +969,24 @@ write_data(File file, char *filename, int offset, Pointer ptr, int length)
 						filename)));
 }
 
+/*
+ * Reads up to *size bytes of the small file.  Sets *size to the number of
+ * bytes actually read.  Returns NULL if the file is gone.
+ */
 static Pointer
-read_small_file(const char *filename, int size)
+read_small_file(const char *filename, int *size)
 {
 	File		file;
 	Pointer		buffer;
 	int			rc;
 
-	buffer = (Pointer) palloc(size);
-
 	file = PathNameOpenFile(filename, O_RDONLY | PG_BINARY);
 	if (file < 0)
 		return NULL;
 
-	rc = FileRead(file, buffer, size, 0, WAIT_EVENT_DATA_FILE_READ);
+	buffer = (Pointer) palloc(Max(*size, 1));
+
+	rc = FileRead(file, buffer, *size, 0, WAIT_EVENT_DATA_FILE_READ);
 
 	if (rc < 0)
 		ereport(ERROR,
@@ -718,6 +996,7 @@ read_small_file(const char *filename, int size)
 
 	FileClose(file);
 
+	*size = rc;
 	return buffer;
 }
 
@@ -734,6 +1013,10 @@ flush_small_files(S3BackupState *state)
 	File		file;
 	S3TaskLocation location;
 
+	/* All the small files might be unchanged since the previous backup */
+	if (state->smallFileNames == NIL)
+		return 0;
+
 	foreach(lc, state->smallFileNames)
 		totalNamesLen += strlen(lfirst(lc)) + 1;
 
@@ -773,12 +1056,11 @@ flush_small_files(S3BackupState *state)
 		offset += len;
 	}
 
-	forboth(lc, state->smallFileNames, lc2, state->smallFileSizes)
+	forboth(lc, state->smallFileDatas, lc2, state->smallFileSizes)
 	{
 		int			len = lfirst_int(lc2);
-		Pointer		data = read_small_file(lfirst(lc), len);
 
-		write_data(file, filename, offset, data, len);
+		write_data(file, filename, offset, lfirst(lc), len);
 		offset += len;
 	}
 
@@ -790,25 +1072,55 @@ flush_small_files(S3BackupState *state)
 
 	list_free_deep(state->smallFileNames);
 	list_free(state->smallFileSizes);
+	list_free_deep(state->smallFileDatas);
 	state->smallFileNames = NIL;
 	state->smallFileSizes = NIL;
+	state->smallFileDatas = NIL;
 	state->smallFilesTotalSize = sizeof(int);
 	state->smallFilesNum++;
 
 	return location;
 }
 
+/*
+ * Adds the small file to the bundle of small files, unless it's unchanged
+ * since the previous backup.  The file contents is read here and kept till
+ * the bundle is flushed, so that the bundle contains exactly the hashed
+ * contents.
+ */
 static S3TaskLocation
 accumulate_small_file(S3BackupState *state, const char *path, int size)
 {
-	int			sizeRequired = 3 * sizeof(int) + strlen(path) + 1 + size;
+	int			sizeRequired;
 	S3TaskLocation location = 0;
+	Pointer		data;
+	const char *name = backup_object_name(path);
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	char		hex[S3_HASH_HEX_LEN + 1];
+
+	/* If the file went away while scanning, it's not an error. */
+	data = read_small_file(path, &size);
+	if (data == NULL)
+		return 0;
 
+	(void) SHA256((unsigned char *) data, size, hash);
+	hash_to_hex(hash, hex);
+
+	if (manifest_reuse(state, name, hex))
+	{
+		pfree(data);
+		return 0;
+	}
+
+	sizeRequired = 3 * sizeof(int) + strlen(path) + 1 + size;
 	if (state->smallFilesTotalSize + sizeRequired > SMALL_FILES_TOTAL_THRESHOLD)
 		location = flush_small_files(state);
 
+	manifest_add(state, name, hex, state->chkpNum, state->smallFilesNum);
+
 	state->smallFileNames = lappend(state->smallFileNames, pstrdup(path));
 	state->smallFileSizes = lappend_int(state->smallFileSizes, size);
+	state->smallFileDatas = lappend(state->smallFileDatas, data);
 	state->smallFilesTotalSize += sizeRequired;
 
 	return location;
@@ -26,12 +26,15 @@
 #include "common/file_utils.h"
 #include "common/hashfn.h"
 #include "common/pg_prng.h"
+#include "funcapi.h"
 #if PG_VERSION_NUM < 160000
 #include "port/pg_iovec.h"
 #endif
 #include "pgstat.h"
 #if PG_VERSION_NUM < 160000
 #include "storage/fd.h"
+
+PG_FUNCTION_INFO_V1(orioledb_s3_cache_stats);
 #endif
 
 #define S3_HEADER_BUFFERS_PER_GROUP 4
@@ -42,6 +45,9 @@ typedef struct
 	int			groupCtlTrancheId;
 	int			bufferCtlTrancheId;
 	pg_atomic_uint64 numberOfLoadedParts;
+	/* Number of part accesses found the part loaded or not */
+	pg_atomic_uint64 numHits;
+	pg_atomic_uint64 numMisses;
 } S3HeadersMeta;
 
 typedef struct
@@ -66,6 +72,10 @@ static int	groupsCount = 0;
 static S3HeadersMeta *meta;
 static S3HeadersBuffersGroup *groups;
 
+/* The last part accessed by this process */
+static S3HeaderTag lastUsedTag = {0};
+static int	lastUsedIndex = -1;
+
 #define S3_HEADER_MAX_CHANGE_COUNT (0x7FFFFFFF)
 
 #define S3_PART_DIRTY_BIT		   UINT64CONST(0x8000000000000000)
@@ -90,6 +100,7 @@ static S3HeadersBuffersGroup *groups;
 #define S3_PART_USAGE_COUNT_SHIFT  (25)
 #define S3_PART_GET_USAGE_COUNT(p) (((p) & S3_PART_USAGE_COUNT_MASK) >> S3_PART_USAGE_COUNT_SHIFT)
 #define S3_PART_SET_USAGE_COUNT(p, u) (((p) & (~S3_PART_USAGE_COUNT_MASK)) | ((uint64) (u) << S3_PART_USAGE_COUNT_SHIFT))
+#define S3_PART_MAX_USAGE_COUNT	   (S3_PART_USAGE_COUNT_MASK >> S3_PART_USAGE_COUNT_SHIFT)
 #define S3_PART_WRITING_FLAG	   UINT64CONST(0x0000000001000000)
 #define S3_PART_DIRTY_FLAG		   UINT64CONST(0x0000000000800000)
 #define S3_PART_STATUS_MASK		   UINT64CONST(0x0000000000700000)
@@ -183,6 +194,8 @@ s3_headers_shmem_init(Pointer buf, bool found)
 		meta->groupCtlTrancheId = LWLockNewTrancheId();
 		meta->bufferCtlTrancheId = LWLockNewTrancheId();
 		pg_atomic_init_u64(&meta->numberOfLoadedParts, 0);
+		pg_atomic_init_u64(&meta->numHits, 0);
+		pg_atomic_init_u64(&meta->numMisses, 0);
 
 		for (i = 0; i < groupsCount; i++)
 		{
@@ -641,8 +654,22 @@ s3_header_lock_part(S3HeaderTag tag, int index)
 {
 	uint32		value;
 
+	bool		counted = false,
+				sameAsLast;
+
 	Assert(!OidIsValid(curLockedTag.datoid) && !OidIsValid(curLockedTag.relnode));
 
+	/*
+	 * Consecutive accesses of the same process to the same part, for instance
+	 * reads of the pages by a sequential scan, are counted once.  Thus, the
+	 * part read once by a scan doesn't look hotter than the part accessed by
+	 * a few different lookups.
+	 */
+	sameAsLast = (index == lastUsedIndex &&
+				  S3HeaderTagsIsEqual(tag, lastUsedTag));
+	lastUsedTag = tag;
+	lastUsedIndex = index;
+
 	value = s3_header_read_value(tag, index);
 
 	while (true)
@@ -653,6 +680,13 @@ s3_header_lock_part(S3HeaderTag tag, int index)
 
 		status = S3_PART_GET_STATUS(value);
 
+		if (!counted)
+		{
+			pg_atomic_fetch_add_u64(status == S3PartStatusLoaded ?
+									&meta->numHits : &meta->numMisses, 1);
+			counted = true;
+		}
+
 		if (status == S3PartStatusNotLoaded)
 		{
 			s3_load_file_part(tag.checkpointNum, tag.datoid,
@@ -675,7 +709,8 @@ s3_header_lock_part(S3HeaderTag tag, int index)
 		{
 			Assert(status == S3PartStatusLoaded);
 			newValue += S3_PART_LOCKS_ONE;
-			newValue = S3_PART_SET_USAGE_COUNT(newValue, usageCount + 1);
+			if (!sameAsLast && usageCount < S3_PART_MAX_USAGE_COUNT)
+				newValue = S3_PART_SET_USAGE_COUNT(newValue, usageCount + 1);
 		}
 
 		if (s3_header_compare_and_swap(tag, index, &value, newValue))
@@ -687,6 +722,15 @@ s3_header_lock_part(S3HeaderTag tag, int index)
 	}
 }
 
+/*
+ * Returns the current status of the part without locking it.
+ */
+S3PartStatus
+s3_header_get_part_status(S3HeaderTag tag, int index)
+{
+	return S3_PART_GET_STATUS(s3_header_read_value(tag, index));
+}
+
 S3PartStatus
 s3_header_mark_part_loading(S3HeaderTag tag, int index)
 {
@@ -1139,6 +1183,36 @@ eviction_callback(S3HeaderTag tag)
 	close(fd);
 }
 
+/*
+ * Returns the number of loaded parts and the part access hit and miss
+ * counters.
+ */
+Datum
+orioledb_s3_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[4];
+	bool		nulls[4] = {false};
+
+	orioledb_check_shmem();
+
+	if (!orioledb_s3_mode)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("orioledb is not in S3 mode")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	values[0] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numberOfLoadedParts));
+	values[1] = Int64GetDatum((int64) s3_desired_size * 1024 * 1024 / ORIOLEDB_S3_PART_SIZE);
+	values[2] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numHits));
+	values[3] = Int64GetDatum((int64) pg_atomic_read_u64(&meta->numMisses));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 void
 s3_headers_try_eviction_cycle(void)
 {
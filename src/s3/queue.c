@@ -16,6 +16,9 @@
 #include "orioledb.h"
 
 #include "s3/queue.h"
+#include "s3/stats.h"
+#include "s3/worker.h"
+#include "utils/o_wait_events.h"
 
 #include "utils/wait_event.h"
 
@@ -37,6 +40,9 @@ typedef struct
 	 */
 	pg_atomic_uint64 erasedLocation;
 	ConditionVariable erasedLocationCV;
+
+	/* Maximal size of the not yet erased tasks in the buffer */
+	pg_atomic_uint64 maxUsedSize;
 } S3TaskQueueMeta;
 
 /*
@@ -81,6 +87,7 @@ s3_queue_init_shmem(Pointer ptr, bool found)
 		pg_atomic_init_u64(&s3_queue_meta->insertLocation, 0);
 		pg_atomic_init_u64(&s3_queue_meta->pickLocation, 0);
 		pg_atomic_init_u64(&s3_queue_meta->erasedLocation, 0);
+		pg_atomic_init_u64(&s3_queue_meta->maxUsedSize, 0);
 
 		ConditionVariableInit(&s3_queue_meta->insertLocationCV);
 		ConditionVariableInit(&s3_queue_meta->erasedLocationCV);
@@ -89,6 +96,25 @@ s3_queue_init_shmem(Pointer ptr, bool found)
 	}
 }
 
+void
+s3_queue_shmem_usage(OShmemUsage *usage)
+{
+	uint64		used;
+
+	if (!orioledb_s3_mode)
+	{
+		memset(usage, 0, sizeof(*usage));
+		return;
+	}
+
+	used = pg_atomic_read_u64(&s3_queue_meta->insertLocation) -
+		pg_atomic_read_u64(&s3_queue_meta->erasedLocation);
+	used = Min(used, s3_queue_size);
+	usage->used = used;
+	usage->free = s3_queue_size - used;
+	usage->highWater = Max(pg_atomic_read_u64(&s3_queue_meta->maxUsedSize), used);
+}
+
 S3TaskLocation
 s3_queue_get_insert_location(void)
 {
@@ -104,8 +130,10 @@ s3_queue_put_task(Pointer data, uint32 len)
 	S3TaskLocation insertLocation;
 	bool		slept = false;
 	uint32		totallen = len + sizeof(uint32);
+	uint64		used,
+				maxUsed;
 
-	Assert(totallen = INTALIGN(totallen));
+	Assert(totallen == INTALIGN(totallen));
 
 	/* Pick the insert location */
 	insertLocation = pg_atomic_fetch_add_u64(&s3_queue_meta->insertLocation, totallen);
@@ -122,6 +150,15 @@ s3_queue_put_task(Pointer data, uint32 len)
 	if (slept)
 		ConditionVariableCancelSleep();
 
+	used = insertLocation + totallen - pg_atomic_read_u64(&s3_queue_meta->erasedLocation);
+	maxUsed = pg_atomic_read_u64(&s3_queue_meta->maxUsedSize);
+	while (used > maxUsed)
+	{
+		if (pg_atomic_compare_exchange_u64(&s3_queue_meta->maxUsedSize,
+										   &maxUsed, used))
+			break;
+	}
+
 	/* Put the task into a circular buffer */
 	if (insertLocation / s3_queue_size == (insertLocation + totallen - 1) / s3_queue_size)
 	{
@@ -155,6 +192,8 @@ s3_queue_put_task(Pointer data, uint32 len)
 	pg_write_barrier();
 	*((uint32 *) (s3_queue_buffer + insertLocation % s3_queue_size)) = totallen;
 
+	s3_workers_wakeup();
+
 	return insertLocation;
 }
 
@@ -213,6 +252,29 @@ s3_queue_try_pick_task(void)
 	}
 }
 
+/*
+ * Check if there is a task ready to be picked.  Workers use it to recheck
+ * the queue before going to sleep.
+ */
+bool
+s3_queue_has_ready_task(void)
+{
+	S3TaskLocation pickLocation,
+				insertLocation,
+				erasedLocation;
+
+	pickLocation = pg_atomic_read_u64(&s3_queue_meta->pickLocation);
+	pg_read_barrier();
+	insertLocation = pg_atomic_read_u64(&s3_queue_meta->insertLocation);
+	erasedLocation = pg_atomic_read_u64(&s3_queue_meta->erasedLocation);
+
+	if (pickLocation >= insertLocation ||
+		pickLocation + sizeof(uint32) >= erasedLocation + s3_queue_size)
+		return false;
+
+	return *((volatile uint32 *) (s3_queue_buffer + pickLocation % s3_queue_size)) != 0;
+}
+
 /*
  * Get the task by its location.
  */
@@ -248,8 +310,8 @@ s3_queue_get_task(S3TaskLocation taskLocation)
 
 		Assert(firstChunkLen >= sizeof(uint32));
 
-		memcpy(s3_queue_buffer + taskLocation % s3_queue_size + sizeof(uint32),
-			   result,
+		memcpy(result,
+			   s3_queue_buffer + taskLocation % s3_queue_size + sizeof(uint32),
 			   firstChunkLen - sizeof(uint32));
 		memcpy(result + (firstChunkLen - sizeof(uint32)),
 			   s3_queue_buffer,
@@ -335,13 +397,19 @@ void
 s3_queue_wait_for_location(S3TaskLocation location)
 {
 	bool		slept = false;
+	TimestampTz start = 0;
 
 	while (pg_atomic_read_u64(&s3_queue_meta->erasedLocation) <= location)
 	{
+		if (!slept)
+			start = GetCurrentTimestamp();
 		ConditionVariableSleep(&s3_queue_meta->erasedLocationCV,
-							   WAIT_EVENT_MQ_PUT_MESSAGE);
+							   o_wait_event_info(OWaitEventS3Queue));
 		slept = true;
 	}
 	if (slept)
+	{
 		ConditionVariableCancelSleep();
+		s3_stats_report(S3StatsQueueWait, 0, start);
+	}
 }
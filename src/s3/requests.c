@@ -16,18 +16,40 @@
 #include "orioledb.h"
 
 #include "s3/requests.h"
+#include "s3/stats.h"
+#include "utils/o_probes.h"
 
 #include "common/base64.h"
 #include "lib/stringinfo.h"
 #include "utils/wait_event.h"
 
+#include <sys/stat.h>
+
 #include "curl/curl.h"
 #include "openssl/hmac.h"
 #include "openssl/sha.h"
+#include <zstd.h>
 
 PG_FUNCTION_INFO_V1(s3_get);
 PG_FUNCTION_INFO_V1(s3_put);
 
+/*
+ * Files larger than the part size are uploaded using S3 multipart upload.
+ * S3 requires all the parts except the last one to be at least 5MB.
+ */
+#define S3_MULTIPART_PART_SIZE	(16 * 1024 * 1024)
+#define S3_UPLOAD_PART_RETRIES	3
+
+/*
+ * Compressed objects have this metadata header set to the compression
+ * method, so that the restore knows to decompress them.
+ */
+#define S3_COMPRESSION_HEADER	"x-amz-meta-orioledb-compression"
+#define S3_COMPRESSION_ZSTD		"zstd"
+
+/* CURL handle reused by the requests of this process */
+static CURL *s3_curl = NULL;
+
 static void
 hmac_sha256(char *input, char *output, char *secretkey, int secretkeylen)
 {
@@ -62,7 +84,7 @@ hex_string(Pointer data, int len)
  */
 static char *
 canonical_request_hash(char *method, char *datetime, char *objectname,
-					   char *contenthash)
+					   char *query, char *contenthash, char *compression)
 {
 	StringInfoData buf;
 	unsigned char hash[32];
@@ -70,12 +92,15 @@ canonical_request_hash(char *method, char *datetime, char *objectname,
 	initStringInfo(&buf);
 	appendStringInfo(&buf, "%s\n", method);
 	appendStringInfo(&buf, "/%s\n", objectname);
-	appendStringInfo(&buf, "\n");
+	appendStringInfo(&buf, "%s\n", query ? query : "");
 	appendStringInfo(&buf, "host:%s\n", s3_host);
 	appendStringInfo(&buf, "x-amz-content-sha256:%s\n", contenthash);
 	appendStringInfo(&buf, "x-amz-date:%s\n", datetime);
+	if (compression)
+		appendStringInfo(&buf, S3_COMPRESSION_HEADER ":%s\n", compression);
 	appendStringInfo(&buf, "\n");
-	appendStringInfo(&buf, "host;x-amz-content-sha256;x-amz-date\n");
+	appendStringInfo(&buf, "host;x-amz-content-sha256;x-amz-date%s\n",
+					 compression ? ";" S3_COMPRESSION_HEADER : "");
 	appendStringInfo(&buf, "%s", contenthash);
 
 	(void) SHA256((unsigned char *) buf.data, buf.len, hash);
@@ -90,7 +115,8 @@ canonical_request_hash(char *method, char *datetime, char *objectname,
  */
 static char *
 s3_signature(char *method, char *datetimestring, char *datestring,
-			 char *objectname, char *secretkey, char *contenthash)
+			 char *objectname, char *query, char *secretkey,
+			 char *contenthash, char *compression)
 {
 	StringInfoData buf;
 	char	   *key;
@@ -98,7 +124,8 @@ s3_signature(char *method, char *datetimestring, char *datestring,
 	char	   *chash;
 
 	chash = canonical_request_hash(method, datetimestring,
-								   objectname, contenthash);
+								   objectname, query, contenthash,
+								   compression);
 
 	key = psprintf("AWS4%s", s3_secretkey);
 	hmac_sha256(datestring, hash, key, strlen(key));
@@ -169,6 +196,32 @@ write_data_to_buf(void *buffer, size_t size, size_t nmemb, void *userp)
 	return segsize;
 }
 
+/*
+ * Returns the CURL handle for the next request.  The handle is kept for the
+ * lifetime of the process, and curl_easy_reset() preserves its connection
+ * cache.  So, the consecutive requests to the same host reuse the keep-alive
+ * connection and the TLS session instead of making a new handshake each
+ * time.
+ */
+static CURL *
+s3_curl_handle(void)
+{
+	if (s3_curl == NULL)
+	{
+		s3_curl = curl_easy_init();
+		if (s3_curl == NULL)
+			ereport(FATAL, (errcode(ERRCODE_CONNECTION_EXCEPTION),
+							errmsg("could not initialize CURL handle")));
+	}
+	else
+	{
+		curl_easy_reset(s3_curl);
+	}
+
+	curl_easy_setopt(s3_curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	return s3_curl;
+}
+
 /*
  * Get the binary content of an object from S3 into 'str'.
  */
@@ -194,7 +247,7 @@ s3_get_object(char *objectname, StringInfo str)
 	datestring = httpdate(NULL);
 	datetimestring = httpdatetime(NULL);
 	signature = s3_signature("GET", datetimestring, datestring, objectname,
-							 s3_secretkey, contenthash);
+							 NULL, s3_secretkey, contenthash, NULL);
 
 	slist = NULL;
 	slist = curl_slist_append(slist, (tmp = psprintf("x-amz-date: %s", datetimestring)));
@@ -206,7 +259,7 @@ s3_get_object(char *objectname, StringInfo str)
 											  s3_accesskey, datestring, s3_region, signature)));
 	pfree(tmp);
 
-	curl = curl_easy_init();
+	curl = s3_curl_handle();
 	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, slist);
 	curl_easy_setopt(curl, CURLOPT_URL, url);
 	if (s3_cainfo)
@@ -214,19 +267,20 @@ s3_get_object(char *objectname, StringInfo str)
 	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data_to_buf);
 	curl_easy_setopt(curl, CURLOPT_WRITEDATA, str);
 
+	TRACE_ORIOLEDB_S3_REQUEST_START("GET", objectname);
 	sc = curl_easy_perform(curl);
 	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+	TRACE_ORIOLEDB_S3_REQUEST_DONE("GET", objectname, http_code, sc);
 
 	if (sc != 0 || http_code != 200)
 	{
+		s3_stats_report_error();
 		ereport(FATAL, (errcode(ERRCODE_CONNECTION_EXCEPTION),
 						errmsg("could not get object from S3"),
 						errdetail("return code = %d, http code = %ld, response = %s",
 								  sc, http_code, str->data)));
 	}
 
-	curl_easy_cleanup(curl);
-
 	curl_slist_free_all(slist);
 	pfree(url);
 	pfree(datestring);
@@ -353,10 +407,13 @@ read_file(const char *filename, uint64 *size)
 }
 
 /*
- * Put object with given binary contents to S3.
+ * Put object with given binary contents to S3.  'compression' is the
+ * compression method of the contents to be saved in the object metadata, or
+ * NULL if the contents isn't compressed.
  */
 static void
-s3_put_object_with_contents(char *objectname, Pointer data, uint64 dataSize)
+s3_put_object_with_contents(char *objectname, Pointer data, uint64 dataSize,
+							char *compression)
 {
 	CURL	   *curl;
 	char	   *url;
@@ -378,7 +435,7 @@ s3_put_object_with_contents(char *objectname, Pointer data, uint64 dataSize)
 	datestring = httpdate(NULL);
 	datetimestring = httpdatetime(NULL);
 	signature = s3_signature("PUT", datetimestring, datestring, objectname,
-							 s3_secretkey, contenthash);
+							 NULL, s3_secretkey, contenthash, compression);
 
 	slist = NULL;
 	slist = curl_slist_append(slist, (tmp = psprintf("x-amz-date: %s", datetimestring)));
@@ -387,15 +444,22 @@ s3_put_object_with_contents(char *objectname, Pointer data, uint64 dataSize)
 	pfree(tmp);
 	slist = curl_slist_append(slist, (tmp = psprintf("Content-Length: %lu", dataSize)));
 	pfree(tmp);
+	if (compression)
+	{
+		slist = curl_slist_append(slist, (tmp = psprintf(S3_COMPRESSION_HEADER ": %s", compression)));
+		pfree(tmp);
+	}
 	slist = curl_slist_append(slist,
-							  (tmp = psprintf("Authorization: AWS4-HMAC-SHA256 Credential=%s/%s/%s/s3/aws4_request, SignedHeaders=host;x-amz-content-sha256;x-amz-date, Signature=%s",
-											  s3_accesskey, datestring, s3_region, signature)));
+							  (tmp = psprintf("Authorization: AWS4-HMAC-SHA256 Credential=%s/%s/%s/s3/aws4_request, SignedHeaders=host;x-amz-content-sha256;x-amz-date%s, Signature=%s",
+											  s3_accesskey, datestring, s3_region,
+											  compression ? ";" S3_COMPRESSION_HEADER : "",
+											  signature)));
 	slist = curl_slist_append(slist, "Content-Type: application/octet-stream");
 	pfree(tmp);
 
 	initStringInfo(&buf);
 
-	curl = curl_easy_init();
+	curl = s3_curl_handle();
 	curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
 	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, slist);
 	curl_easy_setopt(curl, CURLOPT_URL, url);
@@ -406,19 +470,20 @@ s3_put_object_with_contents(char *objectname, Pointer data, uint64 dataSize)
 	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data_to_buf);
 	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
 
+	TRACE_ORIOLEDB_S3_REQUEST_START("PUT", objectname);
 	sc = curl_easy_perform(curl);
 	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+	TRACE_ORIOLEDB_S3_REQUEST_DONE("PUT", objectname, http_code, sc);
 
 	if (sc != 0 || http_code != 200 || strlen(buf.data) != 0)
 	{
+		s3_stats_report_error();
 		ereport(FATAL, (errcode(ERRCODE_CONNECTION_EXCEPTION),
 						errmsg("could not put object to S3"),
 						errdetail("return code = %d, http code = %ld, response = %s",
 								  sc, http_code, buf.data)));
 	}
 
-	curl_easy_cleanup(curl);
-
 	curl_slist_free_all(slist);
 	if (data)
 		pfree(data);
@@ -430,17 +495,309 @@ s3_put_object_with_contents(char *objectname, Pointer data, uint64 dataSize)
 }
 
 /*
- * Put the whole file as S3 object.
+ * Saves the ETag header of the response to the StringInfo.
+ */
+static size_t
+write_etag_header(char *buffer, size_t size, size_t nitems, void *userp)
+{
+	size_t		len = size * nitems;
+	StringInfo	etag = (StringInfo) userp;
+
+	if (len > 5 && pg_strncasecmp(buffer, "ETag:", 5) == 0)
+	{
+		char	   *start = buffer + 5,
+				   *end = buffer + len;
+
+		while (start < end && (*start == ' ' || *start == '\t'))
+			start++;
+		while (end > start && (end[-1] == '\r' || end[-1] == '\n' ||
+							   end[-1] == ' '))
+			end--;
+		resetStringInfo(etag);
+		appendBinaryStringInfo(etag, start, end - start);
+	}
+
+	return len;
+}
+
+/*
+ * Performs the signed S3 request with the given method, query string and
+ * body.  The query string must be in the canonical form: parameters sorted
+ * and URI-encoded.  Returns true on HTTP 200.  The response body is written
+ * to 'response' and the ETag header, if requested, to 'etag'.
+ */
+static bool
+s3_perform_request(char *method, char *objectname, char *query,
+				   Pointer data, uint64 dataSize,
+				   StringInfo response, StringInfo etag,
+				   int *sc, long *http_code)
+{
+	CURL	   *curl;
+	char	   *url;
+	char	   *datestring;
+	char	   *datetimestring;
+	char	   *signature;
+	char	   *contenthash;
+	struct curl_slist *slist;
+	char	   *tmp;
+	unsigned char hash[32];
+
+	(void) SHA256((unsigned char *) (data ? data : ""), dataSize, hash);
+	contenthash = hex_string((Pointer) hash, sizeof(hash));
+
+	url = psprintf("https://%s/%s?%s", s3_host, objectname, query);
+	datestring = httpdate(NULL);
+	datetimestring = httpdatetime(NULL);
+	signature = s3_signature(method, datetimestring, datestring, objectname,
+							 query, s3_secretkey, contenthash, NULL);
+
+	slist = NULL;
+	slist = curl_slist_append(slist, (tmp = psprintf("x-amz-date: %s", datetimestring)));
+	pfree(tmp);
+	slist = curl_slist_append(slist, (tmp = psprintf("x-amz-content-sha256: %s", contenthash)));
+	pfree(tmp);
+	slist = curl_slist_append(slist, (tmp = psprintf("Content-Length: %lu", dataSize)));
+	pfree(tmp);
+	slist = curl_slist_append(slist,
+							  (tmp = psprintf("Authorization: AWS4-HMAC-SHA256 Credential=%s/%s/%s/s3/aws4_request, SignedHeaders=host;x-amz-content-sha256;x-amz-date, Signature=%s",
+											  s3_accesskey, datestring, s3_region, signature)));
+	slist = curl_slist_append(slist, "Content-Type: application/octet-stream");
+	pfree(tmp);
+
+	resetStringInfo(response);
+
+	curl = s3_curl_handle();
+	curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, slist);
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	if (s3_cainfo)
+		curl_easy_setopt(curl, CURLOPT_CAINFO, s3_cainfo);
+	curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data ? data : "");
+	curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, dataSize);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data_to_buf);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+	if (etag)
+	{
+		resetStringInfo(etag);
+		curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_etag_header);
+		curl_easy_setopt(curl, CURLOPT_HEADERDATA, etag);
+	}
+
+	*http_code = 0;
+	TRACE_ORIOLEDB_S3_REQUEST_START(method, objectname);
+	*sc = curl_easy_perform(curl);
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, http_code);
+	TRACE_ORIOLEDB_S3_REQUEST_DONE(method, objectname, *http_code, *sc);
+
+	curl_slist_free_all(slist);
+	pfree(url);
+	pfree(datestring);
+	pfree(datetimestring);
+	pfree(signature);
+	pfree(contenthash);
+
+	return *sc == 0 && *http_code == 200;
+}
+
+/*
+ * Extracts the contents of the first 'tag' XML element from the response.
+ */
+static char *
+s3_xml_element(const char *response, const char *tag)
+{
+	char	   *open = psprintf("<%s>", tag),
+			   *close = psprintf("</%s>", tag);
+	const char *start,
+			   *end;
+	char	   *result = NULL;
+
+	start = strstr(response, open);
+	if (start)
+	{
+		start += strlen(open);
+		end = strstr(start, close);
+		if (end)
+			result = pnstrdup(start, end - start);
+	}
+	pfree(open);
+	pfree(close);
+	return result;
+}
+
+/*
+ * Uploads the file as S3 object part by part.  Only one part is kept in
+ * memory, and the failed part upload is retried without restarting the
+ * whole upload.
+ */
+static bool
+s3_put_file_multipart(char *objectname, char *filename)
+{
+	StringInfoData response,
+				etag,
+				complete;
+	char	   *uploadId,
+			   *query;
+	int			partnum = 1,
+				sc;
+	long		http_code;
+	uint64		offset = 0;
+
+	initStringInfo(&response);
+	initStringInfo(&etag);
+	initStringInfo(&complete);
+
+	if (!s3_perform_request("POST", objectname, "uploads=", NULL, 0,
+							&response, NULL, &sc, &http_code) ||
+		(uploadId = s3_xml_element(response.data, "UploadId")) == NULL)
+	{
+		s3_stats_report_error();
+		ereport(FATAL, (errcode(ERRCODE_CONNECTION_EXCEPTION),
+						errmsg("could not start multipart upload to S3"),
+						errdetail("return code = %d, http code = %ld, response = %s",
+								  sc, http_code, response.data)));
+	}
+
+	appendStringInfoString(&complete, "<CompleteMultipartUpload>");
+	while (true)
+	{
+		Pointer		data;
+		uint64		dataSize;
+		int			attempt;
+
+		data = read_file_part(filename, offset, S3_MULTIPART_PART_SIZE,
+							  &dataSize);
+		if (!data)
+		{
+			/* the file is gone, don't leave the parts stored in S3 */
+			query = psprintf("uploadId=%s", uploadId);
+			(void) s3_perform_request("DELETE", objectname, query, NULL, 0,
+									  &response, NULL, &sc, &http_code);
+			pfree(query);
+			return false;
+		}
+		if (dataSize == 0 && partnum > 1)
+		{
+			pfree(data);
+			break;
+		}
+
+		query = psprintf("partNumber=%d&uploadId=%s", partnum, uploadId);
+		for (attempt = 0; attempt <= S3_UPLOAD_PART_RETRIES; attempt++)
+		{
+			if (s3_perform_request("PUT", objectname, query, data, dataSize,
+								   &response, &etag, &sc, &http_code) &&
+				etag.len > 0)
+				break;
+			if (attempt == S3_UPLOAD_PART_RETRIES)
+			{
+				s3_stats_report_error();
+				ereport(FATAL, (errcode(ERRCODE_CONNECTION_EXCEPTION),
+								errmsg("could not upload part %d to S3", partnum),
+								errdetail("return code = %d, http code = %ld, response = %s",
+										  sc, http_code, response.data)));
+			}
+			s3_stats_report_retry();
+			pg_usleep(100000L << attempt);
+		}
+		pfree(query);
+		pfree(data);
+
+		appendStringInfo(&complete,
+						 "<Part><PartNumber>%d</PartNumber><ETag>%s</ETag></Part>",
+						 partnum, etag.data);
+		partnum++;
+		offset += dataSize;
+		if (dataSize < S3_MULTIPART_PART_SIZE)
+			break;
+	}
+	appendStringInfoString(&complete, "</CompleteMultipartUpload>");
+
+	/* S3 might report the completion error with HTTP 200 */
+	query = psprintf("uploadId=%s", uploadId);
+	if (!s3_perform_request("POST", objectname, query,
+							complete.data, complete.len,
+							&response, NULL, &sc, &http_code) ||
+		strstr(response.data, "<Error>") != NULL)
+	{
+		s3_stats_report_error();
+		ereport(FATAL, (errcode(ERRCODE_CONNECTION_EXCEPTION),
+						errmsg("could not complete multipart upload to S3"),
+						errdetail("return code = %d, http code = %ld, response = %s",
+								  sc, http_code, response.data)));
+	}
+
+	pfree(query);
+	pfree(uploadId);
+	pfree(response.data);
+	pfree(etag.data);
+	pfree(complete.data);
+	return true;
+}
+
+/*
+ * Compresses the data with zstd if orioledb.s3_compress is on.  Returns the
+ * compressed data replacing the original one, or NULL if the data is left
+ * uncompressed.
+ */
+static char *
+s3_compress_data(Pointer *data, uint64 *dataSize)
+{
+	size_t		bound,
+				compressedSize;
+	Pointer		compressed;
+
+	if (!s3_compress || *dataSize == 0)
+		return NULL;
+
+	bound = ZSTD_compressBound(*dataSize);
+	compressed = palloc(bound);
+	compressedSize = ZSTD_compress(compressed, bound, *data, *dataSize,
+								   ZSTD_CLEVEL_DEFAULT);
+	if (ZSTD_isError(compressedSize) || compressedSize >= *dataSize)
+	{
+		/* not worth it */
+		pfree(compressed);
+		return NULL;
+	}
+
+	pfree(*data);
+	*data = compressed;
+	*dataSize = compressedSize;
+	return S3_COMPRESSION_ZSTD;
+}
+
+/*
+ * Put the whole file as S3 object.  Files uploaded with the single request
+ * might be compressed.  Files large enough for the multipart upload are
+ * relation files, which don't compress well enough to be worth buffering
+ * them entirely.
  */
 bool
 s3_put_file(char *objectname, char *filename)
 {
 	Pointer		data;
 	uint64		dataSize = 0;
+	struct stat st;
+	TimestampTz start = GetCurrentTimestamp();
+
+	s3_stats_set_op(S3StatsPutFile);
+
+	if (stat(filename, &st) == 0 && st.st_size > S3_MULTIPART_PART_SIZE)
+	{
+		if (!s3_put_file_multipart(objectname, filename))
+			return false;
+		s3_stats_report(S3StatsPutFile, st.st_size, start);
+		return true;
+	}
 
 	data = read_file(filename, &dataSize);
 	if (data)
-		s3_put_object_with_contents(objectname, data, dataSize);
+	{
+		char	   *compression = s3_compress_data(&data, &dataSize);
+
+		s3_put_object_with_contents(objectname, data, dataSize, compression);
+		s3_stats_report(S3StatsPutFile, dataSize, start);
+	}
 	return data != NULL;
 }
 
@@ -452,13 +809,19 @@ s3_put_file_part(char *objectname, char *filename, int partnum)
 {
 	Pointer		data;
 	uint64		dataSize;
+	TimestampTz start = GetCurrentTimestamp();
+
+	s3_stats_set_op(S3StatsPutPart);
 
 	data = read_file_part(filename,
 						  partnum * ORIOLEDB_S3_PART_SIZE + ORIOLEDB_BLCKSZ,
 						  ORIOLEDB_S3_PART_SIZE,
 						  &dataSize);
 	if (data)
-		s3_put_object_with_contents(objectname, data, dataSize);
+	{
+		s3_put_object_with_contents(objectname, data, dataSize, NULL);
+		s3_stats_report(S3StatsPutPart, dataSize, start);
+	}
 	return data != NULL;
 }
 
@@ -469,9 +832,13 @@ void
 s3_get_file_part(char *objectname, char *filename, int partnum)
 {
 	StringInfoData buf;
+	TimestampTz start = GetCurrentTimestamp();
+
+	s3_stats_set_op(S3StatsGetPart);
 
 	initStringInfo(&buf);
 	s3_get_object(objectname, &buf);
+	s3_stats_report(S3StatsGetPart, buf.len, start);
 
 	write_file_part(filename,
 					partnum * ORIOLEDB_S3_PART_SIZE + ORIOLEDB_BLCKSZ,
@@ -481,13 +848,111 @@ s3_get_file_part(char *objectname, char *filename, int partnum)
 	pfree(buf.data);
 }
 
+/*
+ * Reads 'amount' bytes from 'offset' within the data file part directly from
+ * its S3 object using the range request.  Returns false on failure, then the
+ * caller should fall back to loading the whole part.
+ */
+bool
+s3_read_file_part_range(uint32 chkpNum, Oid datoid, Oid relnode,
+						int32 segNum, int32 partNum,
+						uint64 offset, int amount, Pointer buffer)
+{
+	CURL	   *curl;
+	char	   *objectname;
+	char	   *url;
+	char	   *datestring;
+	char	   *datetimestring;
+	char	   *signature;
+	struct curl_slist *slist;
+	char	   *tmp;
+	int			sc;
+	unsigned char hash[32];
+	char	   *contenthash;
+	long		http_code = 0;
+	StringInfoData buf;
+	bool		result;
+	TimestampTz start = GetCurrentTimestamp();
+
+	s3_stats_set_op(S3StatsRangeGet);
+
+	objectname = psprintf("orioledb_data/%u/%u/%u.%u.%u",
+						  chkpNum, datoid, relnode, segNum, partNum);
+
+	(void) SHA256(NULL, 0, hash);
+	contenthash = hex_string((Pointer) hash, sizeof(hash));
+
+	url = psprintf("https://%s/%s", s3_host, objectname);
+	datestring = httpdate(NULL);
+	datetimestring = httpdatetime(NULL);
+	signature = s3_signature("GET", datetimestring, datestring, objectname,
+							 NULL, s3_secretkey, contenthash, NULL);
+
+	slist = NULL;
+	slist = curl_slist_append(slist, (tmp = psprintf("x-amz-date: %s", datetimestring)));
+	pfree(tmp);
+	slist = curl_slist_append(slist, (tmp = psprintf("x-amz-content-sha256: %s", contenthash)));
+	pfree(tmp);
+	slist = curl_slist_append(slist, (tmp = psprintf("Range: bytes=%llu-%llu",
+													 (unsigned long long) offset,
+													 (unsigned long long) (offset + amount - 1))));
+	pfree(tmp);
+	slist = curl_slist_append(slist,
+							  (tmp = psprintf("Authorization: AWS4-HMAC-SHA256 Credential=%s/%s/%s/s3/aws4_request, SignedHeaders=host;x-amz-content-sha256;x-amz-date, Signature=%s",
+											  s3_accesskey, datestring, s3_region, signature)));
+	pfree(tmp);
+
+	initStringInfo(&buf);
+
+	curl = s3_curl_handle();
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, slist);
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	if (s3_cainfo)
+		curl_easy_setopt(curl, CURLOPT_CAINFO, s3_cainfo);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data_to_buf);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
+
+	TRACE_ORIOLEDB_S3_REQUEST_START("GET", objectname);
+	sc = curl_easy_perform(curl);
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+	TRACE_ORIOLEDB_S3_REQUEST_DONE("GET", objectname, http_code, sc);
+
+	result = (sc == 0 && http_code == 206 && buf.len == amount);
+	if (result)
+	{
+		memcpy(buffer, buf.data, amount);
+		s3_stats_report(S3StatsRangeGet, amount, start);
+	}
+	else
+	{
+		s3_stats_report_error();
+		elog(DEBUG1, "S3 range get %s failed: return code = %d, http code = %ld",
+			 objectname, sc, http_code);
+	}
+
+	curl_slist_free_all(slist);
+	pfree(objectname);
+	pfree(url);
+	pfree(datestring);
+	pfree(datetimestring);
+	pfree(signature);
+	pfree(contenthash);
+	pfree(buf.data);
+
+	return result;
+}
+
 /*
  * Put empty dir as S3 object.
  */
 void
 s3_put_empty_dir(char *objectname)
 {
-	s3_put_object_with_contents(objectname, NULL, 0);
+	TimestampTz start = GetCurrentTimestamp();
+
+	s3_stats_set_op(S3StatsPutFile);
+	s3_put_object_with_contents(objectname, NULL, 0, NULL);
+	s3_stats_report(S3StatsPutFile, 0, start);
 }
 
 /*
@@ -0,0 +1,221 @@
+/*-------------------------------------------------------------------------
+ *
+ * stats.c
+ *		Statistics of S3 requests.
+ *
+ * For each kind of S3 operation we count the operations completed, their
+ * bytes, errors, retries and the latency histogram.  The time backends wait
+ * for the S3 workers in s3_queue_wait_for_location() is accounted the same
+ * way as a separate kind.  Counters are shared atomics, so they are updated
+ * without locks and read without a consistent snapshot.
+ *
+ * Copyright (c) 2023, OrioleDATA Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/s3/stats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "s3/stats.h"
+
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/tuplestore.h"
+
+PG_FUNCTION_INFO_V1(orioledb_s3_stats);
+
+/* Upper bounds of the latency histogram buckets in milliseconds */
+static const int s3_stats_bucket_bounds[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000};
+
+#define S3_STATS_NUM_BUCKETS	(lengthof(s3_stats_bucket_bounds) + 1)
+
+typedef struct
+{
+	pg_atomic_uint64 count;
+	pg_atomic_uint64 bytes;
+	pg_atomic_uint64 errors;
+	pg_atomic_uint64 retries;
+	pg_atomic_uint64 time;		/* in microseconds */
+	pg_atomic_uint64 buckets[S3_STATS_NUM_BUCKETS];
+} S3OpStats;
+
+static const char *const s3_stats_op_names[] = {
+	"get part",
+	"put part",
+	"put file",
+	"range get",
+	"queue wait"
+};
+
+StaticAssertDecl(lengthof(s3_stats_op_names) == S3StatsNumOps,
+				 "every S3 operation must have a name");
+
+static S3OpStats *s3_stats = NULL;
+
+/* The operation errors and retries are accounted to */
+static S3StatsOp cur_op = S3StatsPutFile;
+
+Size
+s3_stats_shmem_needs(void)
+{
+	if (!orioledb_s3_mode)
+		return 0;
+
+	return CACHELINEALIGN(sizeof(S3OpStats) * S3StatsNumOps);
+}
+
+void
+s3_stats_shmem_init(Pointer ptr, bool found)
+{
+	int			i,
+				j;
+
+	if (!orioledb_s3_mode)
+		return;
+
+	s3_stats = (S3OpStats *) ptr;
+
+	if (!found)
+	{
+		for (i = 0; i < S3StatsNumOps; i++)
+		{
+			pg_atomic_init_u64(&s3_stats[i].count, 0);
+			pg_atomic_init_u64(&s3_stats[i].bytes, 0);
+			pg_atomic_init_u64(&s3_stats[i].errors, 0);
+			pg_atomic_init_u64(&s3_stats[i].retries, 0);
+			pg_atomic_init_u64(&s3_stats[i].time, 0);
+			for (j = 0; j < S3_STATS_NUM_BUCKETS; j++)
+				pg_atomic_init_u64(&s3_stats[i].buckets[j], 0);
+		}
+	}
+}
+
+/*
+ * Sets the operation the subsequent errors and retries are accounted to.
+ */
+void
+s3_stats_set_op(S3StatsOp op)
+{
+	cur_op = op;
+}
+
+/*
+ * Accounts the completed operation started at `start`.
+ */
+void
+s3_stats_report(S3StatsOp op, uint64 bytes, TimestampTz start)
+{
+	S3OpStats  *stats;
+	int64		elapsed = GetCurrentTimestamp() - start;
+	int			i;
+
+	if (!s3_stats)
+		return;
+
+	stats = &s3_stats[op];
+	elapsed = Max(elapsed, 0);
+	pg_atomic_fetch_add_u64(&stats->count, 1);
+	pg_atomic_fetch_add_u64(&stats->bytes, bytes);
+	pg_atomic_fetch_add_u64(&stats->time, (uint64) elapsed);
+
+	for (i = 0; i < lengthof(s3_stats_bucket_bounds); i++)
+	{
+		if (elapsed < (int64) s3_stats_bucket_bounds[i] * 1000)
+			break;
+	}
+	pg_atomic_fetch_add_u64(&stats->buckets[i], 1);
+}
+
+void
+s3_stats_report_error(void)
+{
+	if (s3_stats)
+		pg_atomic_fetch_add_u64(&s3_stats[cur_op].errors, 1);
+}
+
+void
+s3_stats_report_retry(void)
+{
+	if (s3_stats)
+		pg_atomic_fetch_add_u64(&s3_stats[cur_op].retries, 1);
+}
+
+/*
+ * Returns the statistics of S3 operations.  The latency histogram is an
+ * array of the operation counts per bucket, with bucket upper bounds given
+ * in milliseconds in the separate column, and the last bucket unbounded.
+ */
+Datum
+orioledb_s3_stats(PG_FUNCTION_ARGS)
+{
+	Datum		values[8];
+	bool		nulls[8];
+	Datum		bounds[lengthof(s3_stats_bucket_bounds)];
+	int			i,
+				j;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+
+	orioledb_check_shmem();
+
+	if (!orioledb_s3_mode)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("orioledb is not in S3 mode")));
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < lengthof(s3_stats_bucket_bounds); i++)
+		bounds[i] = Int32GetDatum(s3_stats_bucket_bounds[i]);
+
+	for (i = 0; i < S3StatsNumOps; i++)
+	{
+		S3OpStats  *stats = &s3_stats[i];
+		Datum		buckets[S3_STATS_NUM_BUCKETS];
+
+		for (j = 0; j < S3_STATS_NUM_BUCKETS; j++)
+			buckets[j] = Int64GetDatum((int64) pg_atomic_read_u64(&stats->buckets[j]));
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = PointerGetDatum(cstring_to_text(s3_stats_op_names[i]));
+		values[1] = Int64GetDatum((int64) pg_atomic_read_u64(&stats->count));
+		values[2] = Int64GetDatum((int64) pg_atomic_read_u64(&stats->bytes));
+		values[3] = Int64GetDatum((int64) pg_atomic_read_u64(&stats->errors));
+		values[4] = Int64GetDatum((int64) pg_atomic_read_u64(&stats->retries));
+		values[5] = Float8GetDatum((double) pg_atomic_read_u64(&stats->time) / 1000.0);
+		values[6] = PointerGetDatum(construct_array(bounds,
+													lengthof(s3_stats_bucket_bounds),
+													INT4OID, sizeof(int32),
+													true, TYPALIGN_INT));
+		values[7] = PointerGetDatum(construct_array(buckets,
+													S3_STATS_NUM_BUCKETS,
+													INT8OID, sizeof(int64),
+													FLOAT8PASSBYVAL,
+													TYPALIGN_DOUBLE));
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
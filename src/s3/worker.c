@@ -24,10 +24,12 @@
 #include "miscadmin.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/interrupt.h"
 #include "storage/bufmgr.h"
 #include "storage/latch.h"
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
+#include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
@@ -37,15 +39,36 @@
 
 #include <unistd.h>
 
+/*
+ * Shared state of S3 worker.
+ */
+typedef struct
+{
+	/* Location of the task being processed */
+	S3TaskLocation location;
+	/* PGPROC number of the worker process or -1 if not started */
+	int			procno;
+	/* The worker is going to sleep on its latch */
+	bool		idle;
+} S3WorkerState;
+
+typedef struct
+{
+	/* Worker to start looking for the idle one on the next wakeup */
+	pg_atomic_uint32 nextWakeup;
+	S3WorkerState workers[FLEXIBLE_ARRAY_MEMBER];
+} S3WorkersMeta;
+
 static volatile sig_atomic_t shutdown_requested = false;
-static volatile S3TaskLocation *workers_locations = NULL;
+static S3WorkersMeta *workers_meta = NULL;
 
 Size
 s3_workers_shmem_needs(void)
 {
 	Size		size;
 
-	size = CACHELINEALIGN(sizeof(S3TaskLocation) * s3_num_workers);
+	size = CACHELINEALIGN(offsetof(S3WorkersMeta, workers) +
+						  sizeof(S3WorkerState) * s3_num_workers);
 
 	return size;
 }
@@ -55,10 +78,52 @@ s3_workers_init_shmem(Pointer ptr, bool found)
 {
 	int			i;
 
-	workers_locations = (S3TaskLocation *) ptr;
+	workers_meta = (S3WorkersMeta *) ptr;
+
+	if (!found)
+	{
+		pg_atomic_init_u32(&workers_meta->nextWakeup, 0);
+		for (i = 0; i < s3_num_workers; i++)
+		{
+			workers_meta->workers[i].location = InvalidS3TaskLocation;
+			workers_meta->workers[i].procno = -1;
+			workers_meta->workers[i].idle = false;
+		}
+	}
+}
 
+/*
+ * Wake up an idle S3 worker to process the newly inserted task.  Busy
+ * workers don't need a wakeup: they check the queue before going to sleep.
+ * The search for an idle worker starts from different workers in a
+ * round-robin manner to spread the tasks of a burst across the workers.
+ */
+void
+s3_workers_wakeup(void)
+{
+	uint32		start;
+	int			i;
+
+	if (!workers_meta || s3_num_workers == 0)
+		return;
+
+	/* Pairs with the barrier in s3worker_main() after setting the flag */
+	pg_memory_barrier();
+
+	start = pg_atomic_fetch_add_u32(&workers_meta->nextWakeup, 1);
 	for (i = 0; i < s3_num_workers; i++)
-		workers_locations[i] = InvalidS3TaskLocation;
+	{
+		volatile S3WorkerState *worker;
+		int			procno;
+
+		worker = &workers_meta->workers[(start + i) % s3_num_workers];
+		procno = worker->procno;
+		if (worker->idle && procno >= 0)
+		{
+			SetLatch(&GetPGProcByNumber(procno)->procLatch);
+			return;
+		}
+	}
 }
 
 static void
@@ -460,6 +525,7 @@ s3worker_main(Datum main_arg)
 	int			rc,
 				wake_events = WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_TIMEOUT,
 				num = Int32GetDatum(main_arg);
+	volatile S3WorkerState *worker;
 
 	/* enable timeout for relation lock */
 	RegisterTimeout(DEADLOCK_TIMEOUT, CheckDeadLockAlert);
@@ -482,6 +548,7 @@ s3worker_main(Datum main_arg)
 
 	/* catch SIGTERM signal for reason to not interupt background writing */
 	pqsignal(SIGTERM, handle_sigterm);
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
 	BackgroundWorkerUnblockSignals();
 
 	elog(LOG, "orioledb s3 worker %d started", num);
@@ -495,6 +562,9 @@ s3worker_main(Datum main_arg)
 
 	ResetLatch(MyLatch);
 
+	worker = &workers_meta->workers[num];
+	worker->idle = false;
+	worker->procno = MyProc->pgprocno;
 
 	PG_TRY();
 	{
@@ -504,10 +574,10 @@ s3worker_main(Datum main_arg)
 		 * There might be task to process saved into shared memory.  If so,
 		 * pick and process it.
 		 */
-		if (workers_locations[num] != InvalidS3TaskLocation)
+		if (worker->location != InvalidS3TaskLocation)
 		{
-			s3process_task(workers_locations[num]);
-			workers_locations[num] = InvalidS3TaskLocation;
+			s3process_task(worker->location);
+			worker->location = InvalidS3TaskLocation;
 		}
 
 		while (true)
@@ -517,15 +587,13 @@ s3worker_main(Datum main_arg)
 			if (shutdown_requested)
 				break;
 
-			/*
-			 * Sleep until we are signaled or it's time to check the queue.
-			 */
-			rc = WaitLatch(MyLatch, wake_events,
-						   BgWriterDelay,
-						   WAIT_EVENT_BGWRITER_MAIN);
+			ResetLatch(MyLatch);
 
-			if (rc & WL_POSTMASTER_DEATH)
-				shutdown_requested = true;
+			if (ConfigReloadPending)
+			{
+				ConfigReloadPending = false;
+				ProcessConfigFile(PGC_SIGHUP);
+			}
 
 			/*
 			 * Task processing loop.  It might happend that error occurs and
@@ -534,13 +602,38 @@ s3worker_main(Datum main_arg)
 			 */
 			while ((taskLocation = s3_queue_try_pick_task()) != InvalidS3TaskLocation)
 			{
-				workers_locations[num] = taskLocation;
+				worker->location = taskLocation;
 				s3process_task(taskLocation);
-				workers_locations[num] = InvalidS3TaskLocation;
+				worker->location = InvalidS3TaskLocation;
 			}
 
-			ResetLatch(MyLatch);
+			/*
+			 * Advertise we're going to sleep, then recheck the queue.  Either
+			 * we see the task inserted concurrently, or its inserter sees
+			 * our flag and sets our latch.
+			 */
+			worker->idle = true;
+			pg_memory_barrier();
+			if (s3_queue_has_ready_task())
+			{
+				worker->idle = false;
+				continue;
+			}
+
+			/*
+			 * Sleep until we are signaled.  The timeout is only a safety net
+			 * for the tasks which were not ready yet when we checked the
+			 * queue.
+			 */
+			rc = WaitLatch(MyLatch, wake_events,
+						   BgWriterDelay,
+						   WAIT_EVENT_BGWRITER_MAIN);
+			worker->idle = false;
+
+			if (rc & WL_POSTMASTER_DEATH)
+				shutdown_requested = true;
 		}
+		worker->procno = -1;
 		elog(LOG, "orioledb s3 worker %d is shut down", num);
 	}
 	PG_CATCH();
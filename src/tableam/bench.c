@@ -0,0 +1,319 @@
+/*-------------------------------------------------------------------------
+ *
+ * bench.c
+ *		Microbenchmark of the B-tree engine operations.
+ *
+ * orioledb_tbl_bench() runs the given number of lookups, row locks, short
+ * iterator scans or full sequential scans directly on the primary tree of
+ * the table, bypassing the executor.  Keys are drawn uniformly from the given
+ * range and converted to the type of the primary key column using its input
+ * function, so the table is expected to be filled by the keys of the same
+ * range.  Each operation is timed separately, which gives latency
+ * percentiles besides the throughput.  Concurrency and memory pressure are
+ * set up by the caller: see bench/btree_bench.py.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/tableam/bench.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/iterator.h"
+#include "btree/scan.h"
+#include "tableam/descr.h"
+#include "tableam/operations.h"
+#include "transam/oxid.h"
+
+#include "access/htup_details.h"
+#include "access/relation.h"
+#include "access/tableam.h"
+#include "common/pg_prng.h"
+#include "executor/tuptable.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+#include "utils/timestamp.h"
+
+PG_FUNCTION_INFO_V1(orioledb_tbl_bench);
+
+typedef enum
+{
+	OBenchLookup,
+	OBenchLock,
+	OBenchIterator,
+	OBenchSeqScan
+} OBenchOperation;
+
+static OBenchOperation
+bench_parse_operation(const char *name)
+{
+	if (strcmp(name, "lookup") == 0)
+		return OBenchLookup;
+	else if (strcmp(name, "lock") == 0)
+		return OBenchLock;
+	else if (strcmp(name, "iterator") == 0)
+		return OBenchIterator;
+	else if (strcmp(name, "seqscan") == 0)
+		return OBenchSeqScan;
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("unknown benchmark operation \"%s\"", name),
+			 errhint("Valid operations are \"lookup\", \"lock\", \"iterator\" and \"seqscan\".")));
+	return OBenchLookup;		/* keep compiler quiet */
+}
+
+static int
+bench_cmp_latency(const void *a, const void *b)
+{
+	uint64		la = *((const uint64 *) a);
+	uint64		lb = *((const uint64 *) b);
+
+	if (la < lb)
+		return -1;
+	else if (la > lb)
+		return 1;
+	return 0;
+}
+
+/* Returns the given percentile of the sorted latencies in microseconds */
+static double
+bench_percentile(uint64 *latencies, int64 n, double percentile)
+{
+	int64		i = (int64) (percentile * (n - 1));
+
+	return (double) latencies[i] / 1000.0;
+}
+
+/*
+ * Runs the single operation of the benchmark.  Returns the number of tuples
+ * found.
+ */
+static int64
+bench_run_operation(OBenchOperation operation, OTableDescr *descr,
+					Relation rel, TupleTableSlot *slot,
+					OBTreeKeyBound *key, int scanLength,
+					CommitSeqNo csn, MemoryContext tupleCxt)
+{
+	BTreeDescr *desc = &GET_PRIMARY(descr)->desc;
+	int64		found = 0;
+
+	switch (operation)
+	{
+		case OBenchLookup:
+			{
+				OTuple		tuple;
+
+				tuple = o_btree_find_tuple_by_key(desc, key, BTreeKeyBound,
+												  csn, NULL, tupleCxt, NULL);
+				if (!O_TUPLE_IS_NULL(tuple))
+					found++;
+				break;
+			}
+		case OBenchLock:
+			{
+				OLockCallbackArg larg;
+				OBTreeModifyResult res;
+
+				larg.rel = rel;
+				larg.descr = descr;
+				larg.oxid = get_current_oxid();
+				larg.csn = csn;
+				larg.scanSlot = slot;
+				larg.waitPolicy = LockWaitBlock;
+				larg.wouldBlock = false;
+				larg.modified = false;
+				larg.selfModified = false;
+				larg.deleted = BTreeLeafTupleNonDeleted;
+
+				res = o_tbl_lock(descr, key, LockTupleKeyShare, larg.oxid,
+								 &larg, NULL);
+				if (res == OBTreeModifyResultLocked ||
+					res == OBTreeModifyResultFound)
+					found++;
+				ExecClearTuple(slot);
+				break;
+			}
+		case OBenchIterator:
+			{
+				BTreeIterator *it;
+				int			i;
+
+				it = o_btree_iterator_create(desc, key, BTreeKeyBound, csn,
+											 ForwardScanDirection);
+				o_btree_iterator_set_tuple_ctx(it, tupleCxt);
+				for (i = 0; i < scanLength; i++)
+				{
+					OTuple		tuple;
+
+					tuple = o_btree_iterator_fetch(it, NULL, NULL,
+												   BTreeKeyNone, false, NULL);
+					if (O_TUPLE_IS_NULL(tuple))
+						break;
+					found++;
+				}
+				btree_iterator_free(it);
+				break;
+			}
+		case OBenchSeqScan:
+			{
+				BTreeSeqScan *scan;
+
+				scan = make_btree_seq_scan(desc, csn, NULL);
+				while (true)
+				{
+					OTuple		tuple;
+
+					tuple = btree_seq_scan_getnext(scan, tupleCxt, NULL, NULL);
+					if (O_TUPLE_IS_NULL(tuple))
+						break;
+					found++;
+					MemoryContextReset(tupleCxt);
+				}
+				free_btree_seq_scan(scan);
+				break;
+			}
+	}
+
+	return found;
+}
+
+/*
+ * orioledb_tbl_bench(relid, operation, nops, key_min, key_max, scan_length)
+ *
+ * Returns the number of operations, tuples found, the total time in
+ * milliseconds, operations per second and the latency percentiles in
+ * microseconds.
+ */
+Datum
+orioledb_tbl_bench(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	OBenchOperation operation = bench_parse_operation(text_to_cstring(PG_GETARG_TEXT_PP(1)));
+	int64		nops = PG_GETARG_INT64(2);
+	int64		keyMin = PG_GETARG_INT64(3);
+	int64		keyMax = PG_GETARG_INT64(4);
+	int32		scanLength = PG_GETARG_INT32(5);
+	Relation	rel;
+	OTableDescr *descr;
+	OIndexDescr *primary;
+	TupleTableSlot *slot;
+	TupleDesc	tupdesc;
+	MemoryContext tupleCxt;
+	CommitSeqNo csn;
+	Oid			keyType,
+				typInput,
+				typIOParam;
+	pg_prng_state prng;
+	uint64	   *latencies;
+	uint64		totalTime = 0;
+	int64		found = 0;
+	int64		i;
+	Datum		values[8];
+	bool		nulls[8];
+
+	orioledb_check_shmem();
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (nops <= 0 || nops > MaxAllocSize / sizeof(uint64))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of operations must be between 1 and %zu",
+						MaxAllocSize / sizeof(uint64))));
+	if (keyMin > keyMax)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("key_min must not exceed key_max")));
+
+	rel = relation_open(relid, AccessShareLock);
+	descr = relation_get_descr(rel);
+	if (!descr)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("relation oid %u is not orioledb", relid)));
+
+	primary = GET_PRIMARY(descr);
+	if (primary->primaryIsCtid || primary->nonLeafTupdesc->natts != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("benchmark requires a table with a single column primary key")));
+	keyType = primary->nonLeafTupdesc->attrs[0].atttypid;
+	getTypeInputInfo(keyType, &typInput, &typIOParam);
+
+	o_btree_load_shmem(&primary->desc);
+
+	slot = table_slot_create(rel, NULL);
+	tupleCxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "orioledb benchmark tuples",
+									 ALLOCSET_DEFAULT_SIZES);
+	latencies = palloc(sizeof(uint64) * nops);
+	pg_prng_seed(&prng, (uint64) MyProcPid ^ (uint64) GetCurrentTimestamp());
+	csn = GetActiveSnapshot()->snapshotcsn;
+
+	for (i = 0; i < nops; i++)
+	{
+		OBTreeKeyBound key;
+		instr_time	start,
+					duration;
+		int64		keyValue;
+		MemoryContext oldcxt;
+
+		/* The key is prepared outside of the measured interval */
+		oldcxt = MemoryContextSwitchTo(tupleCxt);
+		keyValue = keyMin + (int64) pg_prng_uint64_range(&prng, 0,
+														 (uint64) (keyMax - keyMin));
+		key.nkeys = 1;
+		key.n_row_keys = 0;
+		key.row_keys = NULL;
+		key.keys[0].value = OidInputFunctionCall(typInput,
+												 psprintf(INT64_FORMAT, keyValue),
+												 typIOParam, -1);
+		key.keys[0].type = keyType;
+		key.keys[0].flags = O_VALUE_BOUND_PLAIN_VALUE;
+		key.keys[0].comparator = primary->fields[0].comparator;
+		MemoryContextSwitchTo(oldcxt);
+
+		INSTR_TIME_SET_CURRENT(start);
+		found += bench_run_operation(operation, descr, rel, slot, &key,
+									 scanLength, csn, tupleCxt);
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		latencies[i] = (uint64) (INSTR_TIME_GET_DOUBLE(duration) * 1000000000.0);
+		totalTime += latencies[i];
+
+		MemoryContextReset(tupleCxt);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	qsort(latencies, nops, sizeof(uint64), bench_cmp_latency);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(nops);
+	values[1] = Int64GetDatum(found);
+	values[2] = Float8GetDatum((double) totalTime / 1000000.0);
+	values[3] = Float8GetDatum(totalTime > 0 ?
+							   (double) nops * 1000000000.0 / totalTime : 0.0);
+	values[4] = Float8GetDatum(bench_percentile(latencies, nops, 0.5));
+	values[5] = Float8GetDatum(bench_percentile(latencies, nops, 0.9));
+	values[6] = Float8GetDatum(bench_percentile(latencies, nops, 0.99));
+	values[7] = Float8GetDatum((double) latencies[nops - 1] / 1000.0);
+
+	pfree(latencies);
+	MemoryContextDelete(tupleCxt);
+	ExecDropSingleTupleTableSlot(slot);
+	relation_close(rel, AccessShareLock);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
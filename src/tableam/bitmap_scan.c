@@ -23,8 +23,8 @@
 #include "access/relation.h"
 #include "access/table.h"
 #include "catalog/pg_type.h"
-#include "lib/rbtree.h"
 #include "nodes/execnodes.h"
+#include "pgstat.h"
 #include "utils/memutils.h"
 
 #include <math.h>
@@ -35,7 +35,7 @@ typedef struct OBitmapScan
 	ScanState  *ss;
 	CommitSeqNo csn;
 	MemoryContext cxt;
-	RBTree	   *saved_bitmap;
+	OKeyBitmap *saved_bitmap;
 	Oid			typeoid;
 	BTreeSeqScan *seq_scan;
 } OBitmapScan;
@@ -152,7 +152,7 @@ primary_tuple_get_data(OTuple tuple, OIndexDescr *primary, bool onlyPkey)
 
 static double
 o_index_getbitmap(OBitmapHeapPlanState *bitmap_state,
-				  BitmapIndexScanState *node, RBTree *bitmap)
+				  BitmapIndexScanState *node, OKeyBitmap *bitmap)
 {
 	OScanState	ostate = {0};
 	OTableDescr *descr;
@@ -226,10 +226,10 @@ o_index_getbitmap(OBitmapHeapPlanState *bitmap_state,
 	return nTuples;
 }
 
-static RBTree *
+static OKeyBitmap *
 o_exec_bitmapqual(OBitmapHeapPlanState *bitmap_state, PlanState *planstate)
 {
-	RBTree	   *result = NULL;
+	OKeyBitmap *result = NULL;
 
 	switch (nodeTag(planstate))
 	{
@@ -245,7 +245,7 @@ o_exec_bitmapqual(OBitmapHeapPlanState *bitmap_state, PlanState *planstate)
 				for (i = 0; i < node->nplans; i++)
 				{
 					PlanState  *subnode = node->bitmapplans[i];
-					RBTree	   *subresult = o_exec_bitmapqual(bitmap_state,
+					OKeyBitmap *subresult = o_exec_bitmapqual(bitmap_state,
 															  subnode);
 
 					if (result == NULL)
@@ -283,7 +283,7 @@ o_exec_bitmapqual(OBitmapHeapPlanState *bitmap_state, PlanState *planstate)
 				for (i = 0; i < node->nplans; i++)
 				{
 					PlanState  *subnode = node->bitmapplans[i];
-					RBTree	   *subresult;
+					OKeyBitmap *subresult;
 
 					if (IsA(subnode, BitmapIndexScanState))
 					{
@@ -351,6 +351,58 @@ o_exec_bitmapqual(OBitmapHeapPlanState *bitmap_state, PlanState *planstate)
 	return result;
 }
 
+void
+o_parallel_bitmap_scan_init(OParallelBitmapScan pscan)
+{
+	SpinLockInit(&pscan->mutex);
+	ConditionVariableInit(&pscan->cv);
+	pscan->state = OParallelBitmapInitial;
+	pscan->bitmap = InvalidDsaPointer;
+	orioledb_parallelscan_initialize_inner((ParallelTableScanDesc) &pscan->poscan);
+}
+
+void
+o_parallel_bitmap_scan_reinit(OParallelBitmapScan pscan, dsa_area *area)
+{
+	if (DsaPointerIsValid(pscan->bitmap))
+		dsa_free(area, pscan->bitmap);
+	o_parallel_bitmap_scan_init(pscan);
+}
+
+/*
+ * Returns true if the caller should build the key bitmap.  Otherwise, waits
+ * until another participant publishes the bitmap.
+ */
+static bool
+parallel_bitmap_is_builder(OParallelBitmapScan pscan)
+{
+	OParallelBitmapState state;
+
+	SpinLockAcquire(&pscan->mutex);
+	state = pscan->state;
+	if (state == OParallelBitmapInitial)
+		pscan->state = OParallelBitmapInProgress;
+	SpinLockRelease(&pscan->mutex);
+
+	if (state == OParallelBitmapInitial)
+		return true;
+
+	ConditionVariablePrepareToSleep(&pscan->cv);
+	while (true)
+	{
+		SpinLockAcquire(&pscan->mutex);
+		state = pscan->state;
+		SpinLockRelease(&pscan->mutex);
+
+		if (state == OParallelBitmapFinished)
+			break;
+		ConditionVariableSleep(&pscan->cv, WAIT_EVENT_PARALLEL_BITMAP_SCAN);
+	}
+	ConditionVariableCancelSleep();
+
+	return false;
+}
+
 OBitmapScan *
 o_make_bitmap_scan(OBitmapHeapPlanState *bitmap_state, ScanState *ss,
 				   PlanState *bitmapqualplanstate, Relation rel,
@@ -365,9 +417,41 @@ o_make_bitmap_scan(OBitmapHeapPlanState *bitmap_state, ScanState *ss,
 	scan->ss = ss;
 	scan->tbl_desc = relation_get_descr(rel);
 	bitmap_state->scan = scan;
-	scan->saved_bitmap = o_exec_bitmapqual(bitmap_state, bitmapqualplanstate);
-	scan->seq_scan = make_btree_seq_scan_cb(&GET_PRIMARY(scan->tbl_desc)->desc, scan->csn,
-											&bitmap_seq_scan_callbacks, scan);
+
+	if (bitmap_state->pscan)
+	{
+		OParallelBitmapScan pscan = bitmap_state->pscan;
+		dsa_area   *area = ss->ps.state->es_query_dsa;
+
+		if (parallel_bitmap_is_builder(pscan))
+		{
+			scan->saved_bitmap = o_exec_bitmapqual(bitmap_state,
+												   bitmapqualplanstate);
+			pscan->bitmap = o_keybitmap_serialize(scan->saved_bitmap, area);
+
+			SpinLockAcquire(&pscan->mutex);
+			pscan->state = OParallelBitmapFinished;
+			SpinLockRelease(&pscan->mutex);
+			ConditionVariableBroadcast(&pscan->cv);
+		}
+		else
+		{
+			scan->saved_bitmap = o_keybitmap_deserialize(area, pscan->bitmap);
+		}
+		scan->seq_scan = make_btree_seq_scan_cb(&GET_PRIMARY(scan->tbl_desc)->desc,
+												scan->csn,
+												&bitmap_seq_scan_callbacks,
+												scan, &pscan->poscan);
+	}
+	else
+	{
+		scan->saved_bitmap = o_exec_bitmapqual(bitmap_state,
+											   bitmapqualplanstate);
+		scan->seq_scan = make_btree_seq_scan_cb(&GET_PRIMARY(scan->tbl_desc)->desc,
+												scan->csn,
+												&bitmap_seq_scan_callbacks,
+												scan, NULL);
+	}
 	return scan;
 }
 
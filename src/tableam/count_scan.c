@@ -0,0 +1,334 @@
+/*-------------------------------------------------------------------------
+ *
+ * count_scan.c
+ *		Routines for count(*) pushdown to orioledb tables
+ *
+ * Plain "SELECT count(*) FROM table" queries are answered by a custom scan,
+ * which counts visible tuples of the primary tree directly instead of
+ * passing each tuple through the slot and the aggregate node.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/tableam/count_scan.c
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/scan.h"
+#include "tableam/count_scan.h"
+#include "tableam/descr.h"
+#include "tableam/handler.h"
+#include "tableam/index_scan.h"
+#include "tableam/scan.h"
+
+#include "access/table.h"
+#include "commands/explain.h"
+#include "executor/executor.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/tlist.h"
+#include "parser/parsetree.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/spccache.h"
+
+#if PG_VERSION_NUM >= 140000
+#define O_COUNT_STAR_OID	F_COUNT_
+#else
+#define O_COUNT_STAR_OID	2803
+#endif
+
+typedef struct OCountScanState
+{
+	CustomScanState css;
+	Oid			reloid;
+	bool		done;
+} OCountScanState;
+
+create_upper_paths_hook_type old_create_upper_paths_hook = NULL;
+
+static Plan *o_plan_count_path(PlannerInfo *root, RelOptInfo *rel,
+							   CustomPath *best_path, List *tlist,
+							   List *clauses, List *custom_plans);
+static Node *o_create_count_scan_state(CustomScan *cscan);
+static void o_begin_count_scan(CustomScanState *node, EState *estate,
+							   int eflags);
+static TupleTableSlot *o_exec_count_scan(CustomScanState *node);
+static void o_end_count_scan(CustomScanState *node);
+static void o_rescan_count_scan(CustomScanState *node);
+static void o_explain_count_scan(CustomScanState *node, List *ancestors,
+								 ExplainState *es);
+
+static CustomPathMethods o_count_path_methods =
+{
+	.CustomName = "o_count_path",
+	.PlanCustomPath = o_plan_count_path
+};
+
+CustomScanMethods o_count_scan_methods =
+{
+	"o_count_scan",
+	o_create_count_scan_state
+};
+
+static CustomExecMethods o_count_scan_exec_methods =
+{
+	.CustomName = "o_exec_count_scan",
+	.BeginCustomScan = o_begin_count_scan,
+	.ExecCustomScan = o_exec_count_scan,
+	.EndCustomScan = o_end_count_scan,
+	.ReScanCustomScan = o_rescan_count_scan,
+	.ExplainCustomScan = o_explain_count_scan
+};
+
+/*
+ * Checks if the expressions contain no aggregates other than plain count(*)
+ * and don't reference relation columns.
+ */
+static bool
+is_count_star_target(List *exprs)
+{
+	List	   *vars;
+	ListCell   *lc;
+	bool		result = true;
+
+	vars = pull_var_clause((Node *) exprs,
+						   PVC_INCLUDE_AGGREGATES |
+						   PVC_INCLUDE_WINDOWFUNCS |
+						   PVC_INCLUDE_PLACEHOLDERS);
+	foreach(lc, vars)
+	{
+		Aggref	   *aggref = (Aggref *) lfirst(lc);
+
+		if (!IsA(aggref, Aggref) ||
+			aggref->aggfnoid != O_COUNT_STAR_OID ||
+			!aggref->aggstar ||
+			aggref->aggfilter != NULL ||
+			aggref->aggdistinct != NIL ||
+			aggref->aggorder != NIL ||
+			aggref->agglevelsup != 0 ||
+			aggref->aggsplit != AGGSPLIT_SIMPLE)
+		{
+			result = false;
+			break;
+		}
+	}
+	list_free(vars);
+
+	return result;
+}
+
+/*
+ * Adds the count path to the grouping relation if the query is a plain
+ * count(*) over the whole orioledb table.
+ */
+void
+orioledb_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage,
+								 RelOptInfo *input_rel, RelOptInfo *output_rel,
+								 void *extra)
+{
+	Query	   *parse = root->parse;
+	RangeTblEntry *rte;
+	Relation	relation;
+
+	if (old_create_upper_paths_hook)
+		old_create_upper_paths_hook(root, stage, input_rel, output_rel, extra);
+
+	if (stage != UPPERREL_GROUP_AGG ||
+		input_rel->reloptkind != RELOPT_BASEREL ||
+		input_rel->baserestrictinfo != NIL ||
+		parse->commandType != CMD_SELECT ||
+		!parse->hasAggs ||
+		parse->groupClause != NIL ||
+		parse->groupingSets != NIL ||
+		parse->hasWindowFuncs ||
+		parse->hasTargetSRFs ||
+		parse->rowMarks != NIL ||
+		root->hasHavingQual ||
+		!is_count_star_target(output_rel->reltarget->exprs))
+		return;
+
+	rte = planner_rt_fetch(input_rel->relid, root);
+	if (rte->rtekind != RTE_RELATION ||
+		(rte->relkind != RELKIND_RELATION && rte->relkind != RELKIND_MATVIEW) ||
+		rte->inh || rte->tablesample != NULL)
+		return;
+
+	relation = table_open(rte->relid, NoLock);
+
+	if (is_orioledb_rel(relation))
+	{
+		OTableDescr *descr = relation_get_descr(relation);
+		CustomPath *path;
+		double		spc_random_page_cost;
+		double		spc_seq_page_cost;
+		Cost		page_cost;
+
+		get_tablespace_page_costs(input_rel->reltablespace,
+								  &spc_random_page_cost,
+								  &spc_seq_page_cost);
+		if (descr)
+			page_cost = o_tree_page_cost(&GET_PRIMARY(descr)->desc,
+										 &GET_PRIMARY(descr)->oids,
+										 spc_seq_page_cost);
+		else
+			page_cost = 0.0;
+
+		path = makeNode(CustomPath);
+		path->path.pathtype = T_CustomScan;
+		path->path.parent = output_rel;
+		path->path.pathtarget = output_rel->reltarget;
+		path->path.param_info = NULL;
+		path->path.parallel_aware = false;
+		path->path.parallel_safe = false;
+		path->path.parallel_workers = 0;
+		path->path.rows = 1;
+
+		/*
+		 * The scan reads the same pages as the sequential scan does, but
+		 * checks only the visibility of each tuple.
+		 */
+		path->path.startup_cost = input_rel->pages * page_cost +
+			input_rel->tuples * cpu_operator_cost;
+		path->path.total_cost = path->path.startup_cost + cpu_tuple_cost;
+		path->path.pathkeys = NIL;
+		path->flags = 0;
+		path->custom_paths = NIL;
+		path->custom_private = list_make1(makeInteger(rte->relid));
+		path->methods = &o_count_path_methods;
+
+		add_path(output_rel, &path->path);
+	}
+
+	table_close(relation, NoLock);
+}
+
+/*
+ * The scan returns count(*) values in its custom_scan_tlist.  Setrefs replace
+ * the aggregates of the target list with references to it.
+ */
+static Plan *
+o_plan_count_path(PlannerInfo *root, RelOptInfo *rel,
+				  CustomPath *best_path, List *tlist,
+				  List *clauses, List *custom_plans)
+{
+	CustomScan *custom_scan = makeNode(CustomScan);
+	List	   *scan_tlist = NIL;
+	List	   *aggrefs;
+	ListCell   *lc;
+
+	aggrefs = pull_var_clause((Node *) tlist, PVC_INCLUDE_AGGREGATES);
+	foreach(lc, aggrefs)
+	{
+		Expr	   *aggref = (Expr *) lfirst(lc);
+
+		if (!tlist_member(aggref, scan_tlist))
+			scan_tlist = lappend(scan_tlist,
+								 makeTargetEntry(copyObject(aggref),
+												 list_length(scan_tlist) + 1,
+												 NULL,
+												 false));
+	}
+
+	custom_scan->scan.plan.targetlist = tlist;
+	custom_scan->scan.plan.qual = NIL;
+	custom_scan->scan.plan.lefttree = NULL;
+	custom_scan->scan.plan.righttree = NULL;
+	custom_scan->scan.scanrelid = 0;
+	custom_scan->flags = best_path->flags;
+	custom_scan->methods = &o_count_scan_methods;
+	custom_scan->custom_plans = NIL;
+	custom_scan->custom_exprs = NIL;
+	custom_scan->custom_private = best_path->custom_private;
+	custom_scan->custom_scan_tlist = scan_tlist;
+	custom_scan->custom_relids = NULL;
+
+	return (Plan *) custom_scan;
+}
+
+static Node *
+o_create_count_scan_state(CustomScan *cscan)
+{
+	OCountScanState *cstate = palloc0(sizeof(OCountScanState));
+
+	NodeSetTag(cstate, T_CustomScanState);
+	cstate->css.methods = &o_count_scan_exec_methods;
+	cstate->css.slotOps = &TTSOpsVirtual;
+	cstate->reloid = intVal(linitial(cscan->custom_private));
+	cstate->done = false;
+
+	return (Node *) cstate;
+}
+
+static void
+o_begin_count_scan(CustomScanState *node, EState *estate, int eflags)
+{
+}
+
+static TupleTableSlot *
+o_exec_count_scan(CustomScanState *node)
+{
+	OCountScanState *cstate = (OCountScanState *) node;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	Relation	relation;
+	OTableDescr *descr;
+	uint64		count = 0;
+	int			i;
+
+	if (cstate->done)
+		return NULL;
+	cstate->done = true;
+
+	relation = table_open(cstate->reloid, AccessShareLock);
+	descr = relation_get_descr(relation);
+	if (descr)
+	{
+		BTreeSeqScan *scan;
+
+		scan = make_btree_seq_scan(&GET_PRIMARY(descr)->desc,
+								   node->ss.ps.state->es_snapshot->snapshotcsn,
+								   NULL);
+		count = btree_seq_scan_count(scan);
+		free_btree_seq_scan(scan);
+	}
+	table_close(relation, AccessShareLock);
+
+	ExecClearTuple(slot);
+	for (i = 0; i < slot->tts_tupleDescriptor->natts; i++)
+	{
+		slot->tts_values[i] = Int64GetDatum((int64) count);
+		slot->tts_isnull[i] = false;
+	}
+	ExecStoreVirtualTuple(slot);
+
+	ResetExprContext(node->ss.ps.ps_ExprContext);
+	return o_exec_project(node->ss.ps.ps_ProjInfo, node->ss.ps.ps_ExprContext,
+						  slot, NULL);
+}
+
+static void
+o_end_count_scan(CustomScanState *node)
+{
+}
+
+static void
+o_rescan_count_scan(CustomScanState *node)
+{
+	OCountScanState *cstate = (OCountScanState *) node;
+
+	cstate->done = false;
+}
+
+static void
+o_explain_count_scan(CustomScanState *node, List *ancestors,
+					 ExplainState *es)
+{
+	OCountScanState *cstate = (OCountScanState *) node;
+
+	ExplainPropertyText("Count of", get_rel_name(cstate->reloid), es);
+}
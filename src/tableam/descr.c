@@ -33,20 +33,24 @@
 #include "utils/stopevent.h"
 
 #include "access/nbtree.h"
+#include "access/xact.h"
+#include "catalog/pg_collation_d.h"
 #include "catalog/pg_opfamily.h"
 #include "common/hashfn.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "parser/parse_coerce.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/fmgrtab.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 #include "pgstat.h"
+#include "storage/proc.h"
 
 static OIndexDescr *get_index_descr(ORelOids ixOids, OIndexType ixType,
-									bool miss_ok);
+									OTable *table, bool miss_ok);
 static void o_table_descr_fill_indices(OTableDescr *descr, OTable *table);
 static void init_shared_root_info(OPagePool *pool,
 								  SharedRootInfo *sharedRootInfo);
@@ -82,6 +86,8 @@ struct OComparator
 	MemoryContext ssup_cxt;
 	void	   *ssup_extra;
 	int			(*ssup_comparator) (Datum x, Datum y, SortSupport ssup);
+	/* Sort support function, called again to get abbreviated keys */
+	FmgrInfo	ssup_finfo;
 };
 
 static HTAB *oTableDescrHash;
@@ -662,7 +668,7 @@ o_fetch_index_descr(ORelOids oids, OIndexType type, bool lock, bool *nested)
 	if (lock)
 		o_tables_rel_lock_extended(&oids, AccessShareLock, true);
 
-	index_descr = get_index_descr(oids, type, true);
+	index_descr = get_index_descr(oids, type, NULL, true);
 
 	if (!index_descr && lock)
 	{
@@ -876,8 +882,14 @@ o_drop_shared_root_info(Oid datoid, Oid relnode)
 									 key_tuple, BTreeKeyNonLeafKey, NULL);
 }
 
+/*
+ * Returns the index descriptor from the cache or builds a new one.  If the
+ * caller already has the table loaded, it's passed as `table` to save
+ * fetching it from the sys tree again.
+ */
 static OIndexDescr *
-get_index_descr(ORelOids ixOids, OIndexType ixType, bool miss_ok)
+get_index_descr(ORelOids ixOids, OIndexType ixType, OTable *table,
+				bool miss_ok)
 {
 	bool		found;
 	OIndexDescr *result;
@@ -897,7 +909,7 @@ get_index_descr(ORelOids ixOids, OIndexType ixType, bool miss_ok)
 		return NULL;
 	}
 	mcxt = MemoryContextSwitchTo(descrCxt);
-	o_index_fill_descr(result, oIndex, NULL);
+	o_index_fill_descr(result, oIndex, table);
 	MemoryContextSwitchTo(mcxt);
 	index_btree_desc_init(&result->desc, result->compress, result->oids,
 						  oIndex->indexType, oIndex->temp_table, oIndex->createOxid, result);
@@ -960,13 +972,15 @@ o_table_descr_fill_indices(OTableDescr *descr, OTable *table)
 			ixType = table->indices[cur_ix - ix_off].type;
 		}
 
-		descr->indices[cur_ix] = get_index_descr(ixOids, ixType, false);
+		descr->indices[cur_ix] = get_index_descr(ixOids, ixType, table,
+												 false);
 		descr->indices[cur_ix]->refcnt++;
 	}
 
 	if (ORelOidsIsValid(table->toast_oids))
 	{
-		descr->toast = get_index_descr(table->toast_oids, oIndexToast, false);
+		descr->toast = get_index_descr(table->toast_oids, oIndexToast, table,
+									   false);
 		descr->toast->refcnt++;
 	}
 	else
@@ -1030,6 +1044,37 @@ o_find_toastable_attrs(OTableDescr *tableDescr)
 }
 
 /* fills field opclass fields and finds comparator for it */
+/*
+ * Detects whether values of the field could be compared inline.  We rely on
+ * the opclass comparison function, so it doesn't matter how the opclass was
+ * defined.
+ */
+static OFieldCmpKind
+o_field_cmp_kind(Oid cmpOid, Oid collation)
+{
+	switch (cmpOid)
+	{
+		case F_BTINT2CMP:
+			return OFieldCmpInt2;
+		case F_BTINT4CMP:
+			return OFieldCmpInt4;
+		case F_BTINT8CMP:
+			return OFieldCmpInt8;
+		case F_BTOIDCMP:
+			return OFieldCmpOid;
+		case F_UUID_CMP:
+			return OFieldCmpUuid;
+		case F_BTTEXTCMP:
+			/* memcmp() matches only the "C" collation */
+			if (collation == C_COLLATION_OID ||
+				collation == POSIX_COLLATION_OID)
+				return OFieldCmpTextC;
+			return OFieldCmpGeneric;
+		default:
+			return OFieldCmpGeneric;
+	}
+}
+
 void
 oFillFieldOpClassAndComparator(OIndexField *field, Oid datoid, Oid opclassoid)
 {
@@ -1041,6 +1086,7 @@ oFillFieldOpClassAndComparator(OIndexField *field, Oid datoid, Oid opclassoid)
 	field->inputtype = opclass->inputtype;
 	field->opfamily = opclass->opfamily;
 	field->comparator = o_find_opclass_comparator(opclass, field->collation);
+	field->cmpKind = o_field_cmp_kind(opclass->cmpOid, field->collation);
 
 	Assert(field->comparator != NULL);
 }
@@ -1086,7 +1132,8 @@ o_find_comparator(Oid opfamily, Oid lefttype, Oid righttype, Oid collation)
 		ssup.ssup_cxt = descrCxt;
 		ssup.ssup_collation = collation;
 		ssup.abbreviate = false;
-		OidFunctionCall1(procOid, PointerGetDatum(&ssup));
+		fmgr_info_cxt(procOid, &comparator.ssup_finfo, descrCxt);
+		FunctionCall1(&comparator.ssup_finfo, PointerGetDatum(&ssup));
 		if (ssup.comparator != NULL)
 		{
 			comparator.haveSortSupport = true;
@@ -1177,6 +1224,7 @@ o_find_opclass_comparator(OOpclass *opclass, Oid collation)
 			comparator.ssup_cxt = ssup.ssup_cxt;
 			comparator.ssup_extra = ssup.ssup_extra;
 			comparator.ssup_comparator = ssup.comparator;
+			comparator.ssup_finfo = finfo;
 		}
 	}
 
@@ -1331,9 +1379,30 @@ comparison_shim(Datum x, Datum y, SortSupport ssup)
 	return result;
 }
 
+/*
+ * Fills the sort support for given comparator.  If the caller asks for
+ * abbreviated keys, the sort support function is called once again for the
+ * given `ssup`.  Cached comparator is created without abbreviation, because
+ * abbreviation state is specific for the particular sort.
+ */
 void
 o_finish_sort_support_function(OComparator *comparator, SortSupport ssup)
 {
+	if (comparator->haveSortSupport && ssup->abbreviate)
+	{
+		o_set_syscache_hooks();
+		FunctionCall1(&comparator->ssup_finfo, PointerGetDatum(ssup));
+		o_unset_syscache_hooks();
+
+		if (ssup->comparator != NULL)
+			return;
+
+		/* Shouldn't happen, but fallback to the cached comparator */
+		ssup->abbrev_converter = NULL;
+		ssup->abbrev_abort = NULL;
+		ssup->abbrev_full_comparator = NULL;
+	}
+
 	if (comparator->haveSortSupport)
 	{
 		ssup->comparator = comparator->ssup_comparator;
@@ -1551,6 +1620,64 @@ o_invalidate_undo_item_callback(UndoLocation location, UndoStackItem *baseItem,
 	o_invalidate_oids(invalidateItem->oids);
 }
 
+/*
+ * Invalidation items already added by the current (sub)transaction.  DDL
+ * over partitioned tables often requests the invalidation of the same
+ * relation many times.  Each undo item turns into a separate shared
+ * invalidation message, which makes every backend rebuild the descriptor
+ * again.  So, we skip the items duplicating the ones already added within
+ * the same subtransaction.  Items of the rolled back subtransactions are
+ * never matched, because subtransaction ids are not reused within a
+ * transaction.
+ */
+#define INVALIDATE_ITEMS_CACHE_SIZE	64
+
+static struct
+{
+	LocalTransactionId lxid;
+	SubTransactionId subxid;
+	int			count;
+	struct
+	{
+		ORelOids	oids;
+		uint32		flags;
+	}			items[INVALIDATE_ITEMS_CACHE_SIZE];
+}			invalidateItemsCache = {InvalidLocalTransactionId};
+
+/*
+ * Returns true if the same invalidation item is already added by the current
+ * subtransaction.  Otherwise remembers the item.
+ */
+static bool
+invalidate_item_is_duplicate(ORelOids oids, uint32 flags)
+{
+	SubTransactionId subxid = GetCurrentSubTransactionId();
+	int			i;
+
+	if (invalidateItemsCache.lxid != MyProc->lxid ||
+		invalidateItemsCache.subxid != subxid)
+	{
+		invalidateItemsCache.lxid = MyProc->lxid;
+		invalidateItemsCache.subxid = subxid;
+		invalidateItemsCache.count = 0;
+	}
+
+	for (i = 0; i < invalidateItemsCache.count; i++)
+	{
+		if (ORelOidsIsEqual(invalidateItemsCache.items[i].oids, oids) &&
+			invalidateItemsCache.items[i].flags == flags)
+			return true;
+	}
+
+	if (invalidateItemsCache.count < INVALIDATE_ITEMS_CACHE_SIZE)
+	{
+		invalidateItemsCache.items[invalidateItemsCache.count].oids = oids;
+		invalidateItemsCache.items[invalidateItemsCache.count].flags = flags;
+		invalidateItemsCache.count++;
+	}
+	return false;
+}
+
 void
 o_add_invalidate_undo_item(ORelOids oids, uint32 flags)
 {
@@ -1558,6 +1685,9 @@ o_add_invalidate_undo_item(ORelOids oids, uint32 flags)
 	InvalidateUndoStackItem *item;
 	LocationIndex size;
 
+	if (invalidate_item_is_duplicate(oids, flags))
+		return;
+
 	size = sizeof(InvalidateUndoStackItem);
 	item = (InvalidateUndoStackItem *) get_undo_record_unreserved(UndoReserveTxn,
 																  &location,
@@ -17,12 +17,16 @@
 
 #include "btree/btree.h"
 #include "btree/check.h"
+#include "btree/compact.h"
 #include "btree/io.h"
 #include "btree/iterator.h"
 #include "btree/page_chunks.h"
+#include "btree/range_lock.h"
 #include "catalog/indices.h"
 #include "tableam/descr.h"
+#include "tableam/summary.h"
 #include "tableam/toast.h"
+#include "transam/oxid.h"
 #include "tuple/format.h"
 #include "tuple/toast.h"
 #include "utils/compress.h"
@@ -32,6 +36,8 @@
 #include "access/relation.h"
 #include "access/table.h"
 #include "access/tupmacs.h"
+#include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/pg_type_d.h"
 #include "miscadmin.h"
 #include "utils/builtins.h"
@@ -46,10 +52,14 @@ PG_FUNCTION_INFO_V1(orioledb_tbl_bin_structure);
 PG_FUNCTION_INFO_V1(orioledb_tbl_check);
 PG_FUNCTION_INFO_V1(orioledb_compression_max_level);
 PG_FUNCTION_INFO_V1(orioledb_tbl_compression_check);
+PG_FUNCTION_INFO_V1(orioledb_tbl_train_compression_dict);
+PG_FUNCTION_INFO_V1(orioledb_tbl_compact);
 PG_FUNCTION_INFO_V1(orioledb_tbl_indices);
 PG_FUNCTION_INFO_V1(orioledb_relation_size);
 PG_FUNCTION_INFO_V1(orioledb_tbl_are_indices_equal);
 PG_FUNCTION_INFO_V1(orioledb_table_pages);
+PG_FUNCTION_INFO_V1(orioledb_range_lock);
+PG_FUNCTION_INFO_V1(orioledb_tbl_summarize);
 
 extern void log_btree(BTreeDescr *desc);
 
@@ -1263,6 +1273,7 @@ orioledb_tbl_compression_check(PG_FUNCTION_ARGS)
 	stats.oversize = 0;
 	stats.totalSize = 0;
 	stats.totalCompressedSize = 0;
+	stats.totalLZ4CompressedSize = 0;
 	stats.nranges = narray + 1;
 	stats.ranges = palloc(sizeof(BTreeCompressRange) * stats.nranges);
 
@@ -1314,6 +1325,8 @@ orioledb_tbl_compression_check(PG_FUNCTION_ARGS)
 		appendStringInfo(&result, "Total size = " INT64_FORMAT "\n", stats.totalSize);
 		appendStringInfo(&result, "Total compressed size = " INT64_FORMAT "\n", stats.totalCompressedSize);
 		appendStringInfo(&result, "Ratio = %lf\n", (double) stats.totalCompressedSize / (double) stats.totalSize);
+		appendStringInfo(&result, "LZ4 compressed size = " INT64_FORMAT "\n", stats.totalLZ4CompressedSize);
+		appendStringInfo(&result, "LZ4 ratio = %lf\n", (double) stats.totalLZ4CompressedSize / (double) stats.totalSize);
 
 		/* nodes */
 		appendStringInfo(&result, "\nCompressed pages size for nodes:\n");
@@ -1355,12 +1368,95 @@ orioledb_tbl_compression_check(PG_FUNCTION_ARGS)
 		stats.errors = 0;
 		stats.totalSize = 0;
 		stats.totalCompressedSize = 0;
+		stats.totalLZ4CompressedSize = 0;
 	}
 
 	pfree(stats.ranges);
 	PG_RETURN_TEXT_P(cstring_to_text(result.data));
 }
 
+/*
+ * Trains compression dictionaries for the compressed trees of the relation.
+ * Returns the number of trees the dictionary was trained for.
+ */
+Datum
+orioledb_tbl_train_compression_dict(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	OTableDescr *descr;
+	Relation	rel;
+	int			i,
+				result = 0;
+
+	orioledb_check_shmem();
+
+	if (orioledb_s3_mode)
+		elog(ERROR, "compression dictionaries are not supported in S3 mode");
+
+	rel = relation_open(relid, AccessShareLock);
+	descr = relation_get_descr(rel);
+	relation_close(rel, AccessShareLock);
+
+	if (descr == NULL)
+		elog(ERROR, "orioledb relation not found.");
+
+	for (i = 0; i <= descr->nIndices; i++)
+	{
+		BTreeDescr *td;
+
+		if (i < descr->nIndices)
+			td = &descr->indices[i]->desc;
+		else
+			td = &descr->toast->desc;
+
+		if (OCompressIsValid(td->compress) && !OCompressIsLZ4(td->compress) &&
+			train_btree_compression_dict(td))
+			result++;
+	}
+
+	PG_RETURN_INT32(result);
+}
+
+/*
+ * Compacts data files of the compressed trees of the table.  Returns the
+ * number of bytes the files were truncated by.
+ */
+Datum
+orioledb_tbl_compact(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	OTableDescr *descr;
+	Relation	rel;
+	int			i;
+	int64		result = 0;
+
+	orioledb_check_shmem();
+
+	if (orioledb_s3_mode || use_device)
+		elog(ERROR, "data file compaction is supported only for local data files");
+
+	rel = relation_open(relid, AccessShareLock);
+	descr = relation_get_descr(rel);
+	relation_close(rel, AccessShareLock);
+
+	if (descr == NULL)
+		elog(ERROR, "orioledb relation not found.");
+
+	for (i = 0; i <= descr->nIndices; i++)
+	{
+		BTreeDescr *td;
+
+		if (i < descr->nIndices)
+			td = &descr->indices[i]->desc;
+		else
+			td = &descr->toast->desc;
+
+		result += btree_compact(td);
+	}
+
+	PG_RETURN_INT64(result);
+}
+
 Datum
 orioledb_tbl_indices(PG_FUNCTION_ARGS)
 {
@@ -1394,7 +1490,9 @@ orioledb_tbl_indices(PG_FUNCTION_ARGS)
 		appendStringInfo(&buf, "Index %s\n", ct->name.data);
 		appendStringInfo(&buf, "    Index type: %s", primary ? "primary" : "secondary");
 		appendStringInfo(&buf, "%s", ct->unique ? ", unique" : "");
-		if (OCompressIsValid(ct->compress))
+		if (OCompressIsLZ4(ct->compress))
+			appendStringInfo(&buf, ", compression = lz4");
+		else if (OCompressIsValid(ct->compress))
 			appendStringInfo(&buf, ", compression = %d", ct->compress);
 		appendStringInfo(&buf, "%s\n", primary && ct->primaryIsCtid ? ", ctid" : "");
 		if (ct->predicate)
@@ -1454,3 +1552,157 @@ orioledb_relation_size(PG_FUNCTION_ARGS)
 	relation_close(rel, AccessShareLock);
 	PG_RETURN_INT64(result);
 }
+
+/*
+ * orioledb_range_lock(relid, lokey, hikey)
+ *
+ * Locks the range [lokey, hikey] of the table primary key against insertions
+ * by other transactions until the end of the current transaction.  NULL bound
+ * means the unbounded side of the range.
+ */
+Datum
+orioledb_range_lock(PG_FUNCTION_ARGS)
+{
+	Oid			relid;
+	Relation	rel;
+	OTableDescr *descr;
+	OIndexDescr *primary;
+	Form_pg_attribute keyAttr;
+	OTuple		bounds[2];
+	int			i;
+
+	orioledb_check_shmem();
+
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("relation must not be null")));
+	relid = PG_GETARG_OID(0);
+
+	rel = relation_open(relid, AccessShareLock);
+	descr = relation_get_descr(rel);
+	if (!descr)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("relation oid %u is not orioledb", relid)));
+
+	primary = GET_PRIMARY(descr);
+	if (primary->primaryIsCtid || primary->nonLeafTupdesc->natts != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("key-range locks require a table with a single column primary key")));
+	keyAttr = TupleDescAttr(primary->nonLeafTupdesc, 0);
+
+	for (i = 0; i < 2; i++)
+	{
+		Datum		value;
+		bool		isnull = false;
+		Oid			argType;
+
+		if (PG_ARGISNULL(i + 1))
+		{
+			O_TUPLE_SET_NULL(bounds[i]);
+			continue;
+		}
+
+		argType = get_fn_expr_argtype(fcinfo->flinfo, i + 1);
+		if (argType != keyAttr->atttypid)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("range bound type %s doesn't match primary key type %s",
+							format_type_be(argType),
+							format_type_be(keyAttr->atttypid))));
+
+		value = PG_GETARG_DATUM(i + 1);
+		if (keyAttr->attlen == -1)
+			value = PointerGetDatum(PG_DETOAST_DATUM(value));
+		bounds[i] = o_form_tuple(primary->nonLeafTupdesc, &primary->nonLeafSpec,
+								 0, &value, &isnull);
+	}
+
+	o_btree_load_shmem(&primary->desc);
+	o_range_lock_acquire(&primary->desc, bounds[0], bounds[1],
+						 get_current_oxid());
+
+	relation_close(rel, AccessShareLock);
+	PG_RETURN_VOID();
+}
+
+/*
+ * orioledb_tbl_summarize(relid, attname)
+ *
+ * Builds the min/max summary of the table column used to skip the leaf pages
+ * in sequential scans.  Replaces the previous summary of the table if any.
+ * NULL attname drops the summary.
+ */
+Datum
+orioledb_tbl_summarize(PG_FUNCTION_ARGS)
+{
+	Oid			relid;
+	Relation	rel;
+	OTableDescr *descr;
+
+	orioledb_check_shmem();
+
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("relation must not be null")));
+	relid = PG_GETARG_OID(0);
+
+	if (RecoveryInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("column summaries can't be built during recovery")));
+
+	/*
+	 * The build must see all the modifications of the table, so it can't
+	 * follow the modifications of the same transaction.
+	 */
+	PreventInTransactionBlock(true, "orioledb_tbl_summarize()");
+
+	/* Prevent concurrent modifications during the build */
+	rel = relation_open(relid, ShareLock);
+	descr = relation_get_descr(rel);
+	if (!descr)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("relation oid %u is not orioledb", relid)));
+
+	if (PG_ARGISNULL(1))
+	{
+		o_summary_drop(descr);
+	}
+	else
+	{
+		char	   *attname = NameStr(*PG_GETARG_NAME(1));
+		AttrNumber	attnum;
+
+		if (GET_PRIMARY(descr)->primaryIsCtid)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("column summaries require a table with a primary key")));
+
+		attnum = get_attnum(relid, attname);
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" of relation \"%s\" does not exist",
+							attname, RelationGetRelationName(rel))));
+		if (attnum < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("can't summarize system column \"%s\"", attname)));
+
+		if (!o_summary_type_supported(get_atttype(relid, attnum)))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("column summaries don't support type %s",
+							format_type_be(get_atttype(relid, attnum)))));
+
+		o_summary_build(descr, attnum);
+	}
+
+	relation_close(rel, NoLock);
+	PG_RETURN_VOID();
+}
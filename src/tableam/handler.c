@@ -79,12 +79,24 @@
 	((relation)->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT)
 #endif
 
+/*
+ * Number of tuples fetched from the sequential scan at once.
+ */
+#define O_SEQ_SCAN_BATCH_SIZE	64
+
 typedef struct OScanDescData
 {
 	TableScanDescData rs_base;	/* AM independent part of the descriptor */
 	BTreeSeqScan *scan;
 	CommitSeqNo csn;
 	ItemPointerData iptr;
+
+	/* Tuples fetched from the sequential scan, but not returned yet */
+	int			batchCount;
+	int			batchIndex;
+	OTuple		batchTuples[O_SEQ_SCAN_BATCH_SIZE];
+	CommitSeqNo batchCsns[O_SEQ_SCAN_BATCH_SIZE];
+	BTreeLocationHint batchHints[O_SEQ_SCAN_BATCH_SIZE];
 } OScanDescData;
 typedef OScanDescData *OScanDesc;
 
@@ -615,7 +627,10 @@ orioledb_tuple_lock(Relation rel, Datum tupleid, Snapshot snapshot,
 static void
 orioledb_finish_bulk_insert(Relation relation, int options)
 {
-	/* Do nothing here */
+	OTableDescr *descr = relation_get_descr(relation);
+
+	if (descr)
+		o_tbl_bulk_load_finish(descr, relation);
 }
 
 
@@ -860,16 +875,36 @@ orioledb_estimate_rel_size(Relation rel, int32 *attr_widths,
 	BlockNumber curpages;
 	BlockNumber relpages;
 	double		reltuples;
-	BlockNumber relallvisible;
 	double		density;
+	OTableDescr *descr;
 
 	/* it has storage, ok to call the smgr */
 	curpages = RelationGetNumberOfBlocks(rel);
 
+	/*
+	 * The primary tree maintains the number of its leaf tuples.  Unlike
+	 * pg_class statistics, it follows the table growth immediately, so prefer
+	 * it once the table has some data.
+	 */
+	descr = relation_get_descr(rel);
+	if (descr && tbl_data_exists(&GET_PRIMARY(descr)->oids))
+	{
+		uint64		numTuples;
+
+		o_btree_load_shmem(&GET_PRIMARY(descr)->desc);
+		numTuples = TREE_NUM_TUPLES(&GET_PRIMARY(descr)->desc);
+		if (numTuples > 0)
+		{
+			*pages = Max(curpages, 1);
+			*tuples = (double) numTuples;
+			*allvisfrac = 1;
+			return;
+		}
+	}
+
 	/* coerce values in pg_class to more desirable types */
 	relpages = (BlockNumber) rel->rd_rel->relpages;
 	reltuples = (double) rel->rd_rel->reltuples;
-	relallvisible = (BlockNumber) rel->rd_rel->relallvisible;
 
 	/*
 	 * HACK: if the relation has never yet been vacuumed, use a minimum size
@@ -943,17 +978,11 @@ orioledb_estimate_rel_size(Relation rel, int32 *attr_widths,
 	*tuples = rint(density * (double) curpages);
 
 	/*
-	 * We use relallvisible as-is, rather than scaling it up like we do for
-	 * the pages and tuples counts, on the theory that any pages added since
-	 * the last VACUUM are most likely not marked all-visible.  But costsize.c
-	 * wants it converted to a fraction.
+	 * Secondary trees are versioned through undo on their own, so index-only
+	 * scans check visibility without visiting the primary tree.  This is what
+	 * all-visible pages mean for costsize.c.
 	 */
-	if (relallvisible == 0 || curpages <= 0)
-		*allvisfrac = 0;
-	else if ((double) relallvisible >= curpages)
-		*allvisfrac = 1;
-	else
-		*allvisfrac = (double) relallvisible / curpages;
+	*allvisfrac = 1;
 }
 
 
@@ -1021,6 +1050,7 @@ orioledb_parallelscan_initialize_internal(ParallelTableScanDesc pscan)
 	poscan->intPage[1].offset = 0;
 	poscan->downlinksCount = 0;
 	poscan->workersReportedCount = 0;
+	poscan->workersDiskStarted = 0;
 	poscan->flags = 0;
 	poscan->cur_int_pageno = 0;
 	poscan->dsmHandle = 0;
@@ -1115,6 +1145,18 @@ orioledb_beginscan(Relation relation, Snapshot snapshot,
 	return &scan->rs_base;
 }
 
+/*
+ * Frees the fetched tuples, which weren't returned from the scan.
+ */
+static void
+oscan_free_batch(OScanDesc scan)
+{
+	while (scan->batchIndex < scan->batchCount)
+		pfree(scan->batchTuples[scan->batchIndex++].data);
+	scan->batchCount = 0;
+	scan->batchIndex = 0;
+}
+
 static void
 orioledb_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 				bool allow_strat, bool allow_sync, bool allow_pagemode)
@@ -1128,6 +1170,7 @@ orioledb_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	memcpy(scan->rs_base.rs_key, key, sizeof(ScanKeyData) *
 		   scan->rs_base.rs_nkeys);
 
+	oscan_free_batch(scan);
 	if (scan->scan)
 		free_btree_seq_scan(scan->scan);
 
@@ -1145,6 +1188,7 @@ orioledb_endscan(TableScanDesc sscan)
 	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
 		UnregisterSnapshot(scan->rs_base.rs_snapshot);
 
+	oscan_free_batch(scan);
 	if (scan->scan)
 		free_btree_seq_scan(scan->scan);
 }
@@ -1191,24 +1235,32 @@ orioledb_getnextslot(TableScanDesc sscan, ScanDirection direction,
 	OTableDescr *descr;
 	bool		result;
 
+	scan = (OScanDesc) sscan;
+	descr = relation_get_descr(scan->rs_base.rs_rd);
+
 	do
 	{
-		OTuple		tuple = {0};
-		BTreeLocationHint hint;
-		CommitSeqNo tupleCsn;
+		int			i;
 
-		scan = (OScanDesc) sscan;
-		descr = relation_get_descr(scan->rs_base.rs_rd);
-
-		if (scan->scan)
-			tuple = btree_seq_scan_getnext(scan->scan, slot->tts_mcxt,
-										   &tupleCsn, &hint);
-
-		if (O_TUPLE_IS_NULL(tuple))
-			return false;
+		if (scan->batchIndex >= scan->batchCount)
+		{
+			scan->batchIndex = 0;
+			scan->batchCount = 0;
+			if (scan->scan)
+				scan->batchCount = btree_seq_scan_getnext_batch(scan->scan,
+																slot->tts_mcxt,
+																scan->batchTuples,
+																scan->batchCsns,
+																scan->batchHints,
+																O_SEQ_SCAN_BATCH_SIZE);
+			if (scan->batchCount == 0)
+				return false;
+		}
 
-		tts_orioledb_store_tuple(slot, tuple, descr, tupleCsn,
-								 PrimaryIndexNumber, true, &hint);
+		i = scan->batchIndex++;
+		tts_orioledb_store_tuple(slot, scan->batchTuples[i], descr,
+								 scan->batchCsns[i], PrimaryIndexNumber,
+								 true, &scan->batchHints[i]);
 
 		result = slot_keytest(slot,
 							  scan->rs_base.rs_nkeys,
@@ -1224,11 +1276,22 @@ orioledb_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 					  CommandId cid, int options, BulkInsertState bistate,
 					  bool *insert_indexes)
 {
-	int			i;
+	OTableDescr *descr;
+	CommitSeqNo csn;
+	OXid		oxid;
+
+	descr = relation_get_descr(relation);
+	*insert_indexes = false;
 
-	for (i = 0; i < ntuples; i++)
-		orioledb_tuple_insert(relation, slots[i],
-							  cid, options, bistate, insert_indexes);
+	/* Only COPY passes the bulk insert state to multi_insert */
+	if (bistate != NULL && o_tbl_bulk_load_allowed(descr, relation))
+	{
+		o_tbl_bulk_load_put(descr, relation, slots, ntuples);
+		return;
+	}
+
+	fill_current_oxid_csn(&oxid, &csn);
+	o_tbl_multi_insert(descr, relation, slots, ntuples, oxid, csn);
 }
 
 static void
@@ -1310,6 +1373,7 @@ orioledb_acquire_sample_rows(Relation relation, int elevel,
 	double		rowstoskip = -1;	/* -1 means not set yet */
 	BlockSamplerData bs;
 	BlockNumber totalblocks = TREE_NUM_LEAF_PAGES(&pk->desc);
+	BlockNumber scannedblocks;
 
 	nblocks = BlockSampler_Init(&bs, totalblocks,
 								targrows, random());
@@ -1374,6 +1438,7 @@ orioledb_acquire_sample_rows(Relation relation, int elevel,
 			deadrows += 1;
 		}
 	}
+	scannedblocks = btree_sampling_scan_get_pages(scan);
 	free_btree_seq_scan(scan);
 
 	/*
@@ -1383,10 +1448,10 @@ orioledb_acquire_sample_rows(Relation relation, int elevel,
 	 * a random sample of the pages in the relation, this should be a good
 	 * assumption.
 	 */
-	if (bs.m > 0)
+	if (scannedblocks > 0)
 	{
-		*totalrows = floor((liverows / bs.m) * totalblocks + 0.5);
-		*totaldeadrows = floor((deadrows / bs.m) * totalblocks + 0.5);
+		*totalrows = floor((liverows / scannedblocks) * totalblocks + 0.5);
+		*totaldeadrows = floor((deadrows / scannedblocks) * totalblocks + 0.5);
 	}
 	else
 	{
@@ -1398,11 +1463,11 @@ orioledb_acquire_sample_rows(Relation relation, int elevel,
 	 * Emit some interesting relation info
 	 */
 	ereport(elevel,
-			(errmsg("\"%s\": scanned %d of %u pages, "
+			(errmsg("\"%s\": scanned %u of %u pages, "
 					"containing %.0f live rows and %.0f dead rows; "
 					"%d rows in sample, %.0f estimated total rows",
 					RelationGetRelationName(relation),
-					bs.m, totalblocks,
+					scannedblocks, totalblocks,
 					liverows, deadrows,
 					numrows, *totalrows)));
 
@@ -1428,7 +1493,8 @@ validate_compress(OCompress compress, char *prefix)
 {
 	OCompress	max_compress = o_compress_max_lvl();
 
-	if (compress < -1 || compress > max_compress)
+	if (compress != O_COMPRESS_LZ4 &&
+		(compress < -1 || compress > max_compress))
 	{
 		elog(ERROR, "%s compression level must be between %d and %d",
 			 prefix, -1, max_compress);
@@ -1500,6 +1566,22 @@ static relopt_enum_elt_def StdRdOptIndexCleanupValues[] =
 };
 #endif
 
+static relopt_enum_elt_def OBuffersPriorityValues[] =
+{
+	{
+		"low", OBuffersPriorityLow
+	},
+	{
+		"normal", OBuffersPriorityNormal
+	},
+	{
+		"high", OBuffersPriorityHigh
+	},
+	{
+		(const char *) NULL
+	}							/* list terminator */
+};
+
 /*
  * Option parser for anything that uses StdRdOptions.
  */
@@ -1713,6 +1795,25 @@ orioledb_default_reloptions(Datum reloptions, bool validate, relopt_kind kind)
 								   NULL, validate_toast_compress, NULL,
 								   offsetof(ORelOptions,
 											toast_compress_offset));
+		add_local_int_reloption(&relopts, "buffers_min_pages",
+								"Number of the table tree pages kept from "
+								"eviction",
+								0, 0, INT_MAX,
+								offsetof(ORelOptions, buffers_min_pages));
+		add_local_int_reloption(&relopts, "buffers_max_percent",
+								"Percentage of the main page pool the table "
+								"tree can take before its pages are "
+								"evicted first, or 0 for no limit",
+								0, 0, 100,
+								offsetof(ORelOptions, buffers_max_percent));
+		add_local_enum_reloption(&relopts, "buffers_priority",
+								 "Priority of the table pages in the main "
+								 "page pool",
+								 OBuffersPriorityValues,
+								 OBuffersPriorityNormal,
+								 gettext_noop("Valid values are \"low\", "
+											  "\"normal\", and \"high\"."),
+								 offsetof(ORelOptions, buffers_priority));
 		MemoryContextSwitchTo(oldcxt);
 		relopts_set = true;
 	}
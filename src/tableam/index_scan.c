@@ -15,8 +15,10 @@
 
 #include "orioledb.h"
 
+#include "btree/find.h"
 #include "btree/io.h"
 #include "btree/iterator.h"
+#include "btree/scan.h"
 #include "tableam/index_scan.h"
 #include "tableam/tree.h"
 #include "tuple/slot.h"
@@ -162,6 +164,113 @@ is_tuple_valid(OTuple tup, OIndexDescr *id, OBTreeKeyRange *range)
 	return valid;
 }
 
+/*
+ * Number of consecutive tuples failing the range check, after which we try to
+ * skip over them with a new tree descent.  Iterating tuples within a page is
+ * cheaper than a descent, so we only skip after a run of misses.
+ */
+#define SKIP_SCAN_MIN_INVALID_TUPLES	32
+
+/*
+ * Skip scan.  The tuple doesn't match the key range because of some column
+ * after the first one, while the preceding columns match.  Then, the next
+ * matching tuple either has the same prefix and the column past the bound of
+ * the range, or the next prefix.  Re-create the iterator from there.
+ *
+ * Returns false if the skip is not possible.
+ */
+static bool
+skip_scan_to_next_prefix(OIndexDescr *id, OScanState *ostate, OTuple tup,
+						 CommitSeqNo csn, MemoryContext tupleCxt)
+{
+	OBTreeKeyRange *range = &ostate->curKeyRange;
+	OBTreeKeyBound bound;
+	OBTreeKeyBound *rangeBound;
+	bool		forward = (ostate->scanDir == ForwardScanDirection);
+	bool		belowLow = false,
+				aboveHigh = false;
+	uint8		valueFlags;
+	int			nkeys = range->low.nkeys;
+	int			i,
+				j;
+	MemoryContext oldcontext;
+
+	if (range->low.n_row_keys > 0 || range->high.n_row_keys > 0)
+		return false;
+
+	for (j = 0; j < nkeys; j++)
+	{
+		OBTreeValueBound *low = &range->low.keys[j];
+		OBTreeValueBound *high = &range->high.keys[j];
+		int			attnum;
+		bool		isnull;
+
+		if ((low->flags | high->flags) & O_VALUE_BOUND_NULL)
+			return false;
+
+		attnum = OIndexKeyAttnumToTupleAttnum(BTreeKeyLeafTuple, id, j + 1);
+		bound.keys[j].value = o_fastgetattr(tup, attnum, id->leafTupdesc,
+											&id->leafSpec, &isnull);
+		if (isnull)
+			return false;
+		bound.keys[j].type = id->leafTupdesc->attrs[attnum - 1].atttypid;
+		bound.keys[j].comparator = id->fields[j].comparator;
+
+		if (!(low->flags & O_VALUE_BOUND_UNBOUNDED) &&
+			o_idx_cmp_range_key_to_value(low, &id->fields[j],
+										 bound.keys[j].value, false) > 0)
+		{
+			belowLow = true;
+			break;
+		}
+		if (!(high->flags & O_VALUE_BOUND_UNBOUNDED) &&
+			o_idx_cmp_range_key_to_value(high, &id->fields[j],
+										 bound.keys[j].value, false) < 0)
+		{
+			aboveHigh = true;
+			break;
+		}
+	}
+
+	/* The first column mismatch is handled by the iterator bounds */
+	if (j == 0 || j >= nkeys)
+		return false;
+
+	bound.nkeys = nkeys;
+	bound.n_row_keys = 0;
+	bound.row_keys = NULL;
+	valueFlags = (forward ? O_VALUE_BOUND_LOWER : O_VALUE_BOUND_UPPER) |
+		O_VALUE_BOUND_INCLUSIVE | O_VALUE_BOUND_COERCIBLE;
+	for (i = 0; i < j; i++)
+		bound.keys[i].flags = valueFlags;
+
+	if ((forward && belowLow) || (!forward && aboveHigh))
+	{
+		/* Jump to the bound of the column within the same prefix */
+		rangeBound = forward ? &range->low : &range->high;
+		for (i = j; i < nkeys; i++)
+			bound.keys[i] = rangeBound->keys[i];
+	}
+	else
+	{
+		/* Jump to the next prefix */
+		bound.keys[j - 1].flags &= ~O_VALUE_BOUND_INCLUSIVE;
+		for (i = j; i < nkeys; i++)
+			bound.keys[i].flags = forward ? O_VALUE_BOUND_MINUS_INFINITY :
+				O_VALUE_BOUND_PLUS_INFINITY;
+	}
+
+	oldcontext = MemoryContextSwitchTo(ostate->cxt);
+	btree_iterator_free(ostate->iterator);
+	ostate->iterator = o_btree_iterator_create(&id->desc, (Pointer) &bound,
+											   BTreeKeyBound, csn,
+											   ostate->scanDir);
+	o_btree_iterator_set_tuple_ctx(ostate->iterator, tupleCxt);
+	MemoryContextSwitchTo(oldcontext);
+
+	return true;
+}
+
 static bool
 switch_to_next_range(OIndexDescr *indexDescr, OScanState *ostate,
 					 CommitSeqNo csn, MemoryContext tupleCxt)
@@ -194,7 +303,34 @@ switch_to_next_range(OIndexDescr *indexDescr, OScanState *ostate,
 											indexDescr->nonLeafTupdesc->natts,
 											indexDescr->fields);
 
-	if (!ostate->exact)
+	/*
+	 * Only the forward scan of the single key range is split between the
+	 * parallel workers.  Otherwise, the first participant scans it all.
+	 */
+	if (ostate->pscan && !ostate->parallelSerial &&
+		(ostate->exact || so->numArrayKeys > 0 ||
+		 ostate->scanDir != ForwardScanDirection))
+	{
+		OParallelIndexScan pscan = ostate->pscan;
+
+		LWLockAcquire(&pscan->lock, LW_EXCLUSIVE);
+		if (!pscan->serialClaimed && !pscan->started)
+		{
+			pscan->serialClaimed = true;
+			ostate->parallelSerial = true;
+		}
+		LWLockRelease(&pscan->lock);
+
+		if (!ostate->parallelSerial)
+		{
+			MemoryContextSwitchTo(oldcontext);
+			ostate->exact = false;
+			return false;
+		}
+	}
+
+	/* Parallel workers make iterators for each claimed chunk */
+	if (!ostate->exact && (!ostate->pscan || ostate->parallelSerial))
 	{
 		bound = (ostate->scanDir == ForwardScanDirection
 				 ? &ostate->curKeyRange.low
@@ -210,6 +346,159 @@ switch_to_next_range(OIndexDescr *indexDescr, OScanState *ostate,
 	return true;
 }
 
+/*
+ * Number of the downlinks of the internal page, which a parallel worker
+ * claims at once.
+ */
+#define PARALLEL_INDEX_CHUNK_DOWNLINKS	8
+
+void
+o_parallel_index_scan_init(OParallelIndexScan pscan)
+{
+	LWLockInitialize(&pscan->lock, btreeScanShmem->indexChunkTrancheId);
+	pscan->started = false;
+	pscan->finished = false;
+	pscan->serialClaimed = false;
+	clear_fixed_shmem_key(&pscan->nextKey);
+}
+
+/*
+ * Claims the next chunk of the key range for the parallel worker.  The chunk
+ * starts where the previous claimed chunk ended, and spans the next few
+ * downlinks of the internal page.  The bounds only need to be increasing, so
+ * concurrent page splits and merges can't make the result incorrect.
+ * Returns false if the whole key range is already claimed.
+ */
+static bool
+parallel_index_claim_chunk(OIndexDescr *id, OScanState *ostate,
+						   CommitSeqNo csn)
+{
+	OParallelIndexScan pscan = ostate->pscan;
+	BTreeDescr *desc = &id->desc;
+	OBTreeFindPageContext context;
+	Page		img;
+
+	LWLockAcquire(&pscan->lock, LW_EXCLUSIVE);
+	if (pscan->finished || pscan->serialClaimed)
+	{
+		pscan->started = true;
+		LWLockRelease(&pscan->lock);
+		return false;
+	}
+
+	if (pscan->started)
+		copy_from_fixed_shmem_key(&ostate->chunkLow, &pscan->nextKey);
+	else
+		clear_fixed_key(&ostate->chunkLow);
+
+	init_page_find_context(&context, desc, csn,
+						   BTREE_PAGE_FIND_IMAGE |
+						   BTREE_PAGE_FIND_DOWNLINK_LOCATION);
+	if (!O_TUPLE_IS_NULL(ostate->chunkLow.tuple))
+		find_page(&context, &ostate->chunkLow.tuple, BTreeKeyNonLeafKey, 1);
+	else
+		find_page(&context, &ostate->curKeyRange.low, BTreeKeyBound, 1);
+	img = context.img;
+
+	clear_fixed_key(&ostate->chunkHigh);
+	if (PAGE_GET_LEVEL(img) > 0)
+	{
+		BTreePageItemLocator loc = context.items[context.index].locator;
+		int			i;
+
+		for (i = 0; i < PARALLEL_INDEX_CHUNK_DOWNLINKS &&
+			 BTREE_PAGE_LOCATOR_IS_VALID(img, &loc); i++)
+			BTREE_PAGE_LOCATOR_NEXT(img, &loc);
+
+		if (BTREE_PAGE_LOCATOR_IS_VALID(img, &loc))
+			copy_fixed_page_key(desc, &ostate->chunkHigh, img, &loc);
+		else if (!O_PAGE_IS(img, RIGHTMOST))
+			copy_fixed_hikey(desc, &ostate->chunkHigh, img);
+	}
+
+	/* The rest of the tree is beyond the key range */
+	if (O_TUPLE_IS_NULL(ostate->chunkHigh.tuple) ||
+		o_btree_cmp(desc, &ostate->chunkHigh.tuple, BTreeKeyNonLeafKey,
+					&ostate->curKeyRange.high, BTreeKeyBound) > 0)
+	{
+		clear_fixed_key(&ostate->chunkHigh);
+		pscan->finished = true;
+	}
+	else
+	{
+		copy_fixed_shmem_key(desc, &pscan->nextKey, ostate->chunkHigh.tuple);
+	}
+	pscan->started = true;
+	LWLockRelease(&pscan->lock);
+
+	return true;
+}
+
+/*
+ * Fetches the next tuple of the parallel index scan, claiming new chunks of
+ * the key range when the current one is over.  Chunks are claimed in the key
+ * order, so the tuples returned by each worker are ordered.
+ */
+static OTuple
+parallel_index_fetch(OIndexDescr *id, OScanState *ostate, CommitSeqNo csn,
+					 CommitSeqNo *tupleCsn, MemoryContext tupleCxt,
+					 BTreeLocationHint *hint)
+{
+	BTreeDescr *desc = &id->desc;
+	OTuple		tup;
+
+	while (true)
+	{
+		if (!ostate->iterator)
+		{
+			MemoryContext oldcontext;
+
+			if (!parallel_index_claim_chunk(id, ostate, csn))
+			{
+				O_TUPLE_SET_NULL(tup);
+				return tup;
+			}
+
+			oldcontext = MemoryContextSwitchTo(ostate->cxt);
+			if (!O_TUPLE_IS_NULL(ostate->chunkLow.tuple) &&
+				o_btree_cmp(desc, &ostate->chunkLow.tuple, BTreeKeyNonLeafKey,
+							&ostate->curKeyRange.low, BTreeKeyBound) > 0)
+				ostate->iterator = o_btree_iterator_create(desc,
+														   (Pointer) &ostate->chunkLow.tuple,
+														   BTreeKeyNonLeafKey,
+														   csn,
+														   ForwardScanDirection);
+			else
+				ostate->iterator = o_btree_iterator_create(desc,
+														   (Pointer) &ostate->curKeyRange.low,
+														   BTreeKeyBound,
+														   csn,
+														   ForwardScanDirection);
+			o_btree_iterator_set_tuple_ctx(ostate->iterator, tupleCxt);
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		if (O_TUPLE_IS_NULL(ostate->chunkHigh.tuple))
+			tup = o_btree_iterator_fetch(ostate->iterator, tupleCsn,
+										 &ostate->curKeyRange.high,
+										 BTreeKeyBound, true, hint);
+		else
+			tup = o_btree_iterator_fetch(ostate->iterator, tupleCsn,
+										 &ostate->chunkHigh.tuple,
+										 BTreeKeyNonLeafKey, false, hint);
+
+		if (O_TUPLE_IS_NULL(tup))
+		{
+			btree_iterator_free(ostate->iterator);
+			ostate->iterator = NULL;
+			continue;
+		}
+
+		if (is_tuple_valid(tup, id, &ostate->curKeyRange))
+			return tup;
+	}
+}
+
 OTuple
 o_iterate_index(OIndexDescr *indexDescr, OScanState *ostate,
 				CommitSeqNo csn, CommitSeqNo *tupleCsn,
@@ -234,18 +523,35 @@ o_iterate_index(OIndexDescr *indexDescr, OScanState *ostate,
 
 		if (ostate->exact)
 		{
-			if (hint)
-				hint->blkno = InvalidBlockNumber;
+			/*
+			 * Exact keys of IN-list come in order, so subsequent keys are
+			 * likely to be found at the same leaf page.
+			 */
+			if (!ostate->lookup)
+			{
+				MemoryContext oldcontext = MemoryContextSwitchTo(ostate->cxt);
 
-			tup = o_btree_find_tuple_by_key(&indexDescr->desc,
-											&ostate->curKeyRange.low,
-											BTreeKeyBound, csn, tupleCsn,
-											tupleCxt, hint);
+				ostate->lookup = o_btree_batch_lookup_create(&indexDescr->desc);
+				MemoryContextSwitchTo(oldcontext);
+			}
+
+			tup = o_btree_batch_lookup_fetch(ostate->lookup,
+											 &ostate->curKeyRange.low,
+											 BTreeKeyBound, csn, tupleCsn,
+											 tupleCxt, hint);
 			if (!O_TUPLE_IS_NULL(tup))
 				tup_fetched = true;
 		}
+		else if (ostate->pscan && !ostate->parallelSerial)
+		{
+			tup = parallel_index_fetch(indexDescr, ostate, csn, tupleCsn,
+									   tupleCxt, hint);
+			tup_fetched = true;
+		}
 		else if (ostate->iterator)
 		{
+			int			nInvalid = 0;
+
 			bound = (ostate->scanDir == ForwardScanDirection
 					 ? &ostate->curKeyRange.high : &ostate->curKeyRange.low);
 
@@ -263,6 +569,12 @@ o_iterate_index(OIndexDescr *indexDescr, OScanState *ostate,
 												  &ostate->curKeyRange);
 					if (tup_is_valid)
 						tup_fetched = true;
+					else if (++nInvalid >= SKIP_SCAN_MIN_INVALID_TUPLES)
+					{
+						(void) skip_scan_to_next_prefix(indexDescr, ostate,
+														tup, csn, tupleCxt);
+						nInvalid = 0;
+					}
 				}
 			} while (!tup_is_valid);
 		}
@@ -282,6 +594,196 @@ o_iterate_index(OIndexDescr *indexDescr, OScanState *ostate,
 	return tup;
 }
 
+/*
+ * Number of secondary index tuples read ahead in order to issue read-ahead
+ * for the primary tree pages they refer to.
+ */
+#define INDEX_SCAN_PREFETCH_DISTANCE	16
+/* Maximal number of batches to skip prefetching when it finds nothing */
+#define INDEX_SCAN_PREFETCH_MAX_BACKOFF	64
+
+typedef struct
+{
+	OBTreeKeyBound *bounds;
+	BTreeDescr *desc;
+} PrefetchSortArg;
+
+static int
+prefetch_bounds_cmp(const void *a, const void *b, void *arg)
+{
+	PrefetchSortArg *sortArg = (PrefetchSortArg *) arg;
+	int			i1 = *((const int *) a);
+	int			i2 = *((const int *) b);
+
+	return o_btree_cmp(sortArg->desc,
+					   (Pointer) &sortArg->bounds[i1], BTreeKeyBound,
+					   (Pointer) &sortArg->bounds[i2], BTreeKeyBound);
+}
+
+/*
+ * Returns next primary tuple for the secondary index scan.  Secondary tuples
+ * are read in batches, and their primary tuples are fetched in the batch as
+ * well:
+ *
+ * 1. We issue read-ahead for the on-disk primary tree pages the batch refers
+ *	  to, so the lookups don't wait for the disk one read after another.  When
+ *	  the primary tree turns out to be in memory, prefetching is skipped for an
+ *	  increasing number of batches.
+ * 2. Lookups go in the primary key order, so the keys located in the same
+ *	  leaf page are found without descending the tree again.
+ *
+ * Primary tuples are returned in the secondary index order.
+ */
+static OTuple
+o_index_scan_batch_getnext(OTableDescr *descr, OScanState *ostate,
+						   CommitSeqNo csn, CommitSeqNo *tupleCsn,
+						   MemoryContext tupleCxt, BTreeLocationHint *hint)
+{
+	OIndexDescr *id = descr->indices[ostate->ixNum];
+	OIndexDescr *primary = GET_PRIMARY(descr);
+	OTuple		tup;
+
+	while (true)
+	{
+		OBTreeKeyBound bounds[INDEX_SCAN_PREFETCH_DISTANCE];
+		Pointer		keys[INDEX_SCAN_PREFETCH_DISTANCE];
+		int			order[INDEX_SCAN_PREFETCH_DISTANCE];
+		PrefetchSortArg sortArg;
+		MemoryContext oldcontext;
+		int			i;
+
+		while (ostate->prefetchPos < ostate->prefetchCount)
+		{
+			i = ostate->prefetchPos++;
+			tup = ostate->prefetchResults[i];
+
+			/*
+			 * In concurrent DELETE/UPDATE it might happen, we should try the
+			 * next tuple
+			 */
+			if (O_TUPLE_IS_NULL(tup))
+				continue;
+
+			O_TUPLE_SET_NULL(ostate->prefetchResults[i]);
+			*tupleCsn = ostate->prefetchCsns[i];
+			if (hint)
+				*hint = ostate->prefetchHints[i];
+			return tup;
+		}
+
+		ostate->prefetchCount = 0;
+		ostate->prefetchPos = 0;
+
+		if (ostate->prefetchFinished)
+		{
+			O_TUPLE_SET_NULL(tup);
+			return tup;
+		}
+
+		if (ostate->prefetchTuples == NULL)
+		{
+			ostate->prefetchTuples = MemoryContextAlloc(ostate->cxt,
+														sizeof(OTuple) * INDEX_SCAN_PREFETCH_DISTANCE);
+			ostate->prefetchCsns = MemoryContextAlloc(ostate->cxt,
+													  sizeof(CommitSeqNo) * INDEX_SCAN_PREFETCH_DISTANCE);
+			ostate->prefetchResults = MemoryContextAllocZero(ostate->cxt,
+															 sizeof(OTuple) * INDEX_SCAN_PREFETCH_DISTANCE);
+			ostate->prefetchHints = MemoryContextAlloc(ostate->cxt,
+													   sizeof(BTreeLocationHint) * INDEX_SCAN_PREFETCH_DISTANCE);
+			oldcontext = MemoryContextSwitchTo(ostate->cxt);
+			ostate->primaryLookup = o_btree_batch_lookup_create(&primary->desc);
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		while (ostate->prefetchCount < INDEX_SCAN_PREFETCH_DISTANCE)
+		{
+			tup = o_iterate_index(id, ostate, csn,
+								  &ostate->prefetchCsns[ostate->prefetchCount],
+								  ostate->cxt, NULL);
+			if (O_TUPLE_IS_NULL(tup))
+			{
+				ostate->prefetchFinished = true;
+				break;
+			}
+			ostate->prefetchTuples[ostate->prefetchCount++] = tup;
+		}
+
+		if (ostate->prefetchCount == 0)
+		{
+			O_TUPLE_SET_NULL(tup);
+			return tup;
+		}
+
+		for (i = 0; i < ostate->prefetchCount; i++)
+		{
+			o_fill_pindex_tuple_key_bound(&id->desc,
+										  ostate->prefetchTuples[i],
+										  &bounds[i]);
+			keys[i] = (Pointer) &bounds[i];
+			order[i] = i;
+		}
+
+		o_btree_load_shmem(&primary->desc);
+		if (ostate->prefetchCount > 1 && ostate->prefetchSkip-- <= 0)
+		{
+			if (btree_prefetch_keys(&primary->desc, keys,
+									ostate->prefetchCount,
+									BTreeKeyBound) > 0)
+			{
+				ostate->prefetchBackoff = 0;
+			}
+			else
+			{
+				ostate->prefetchBackoff = Min(Max(ostate->prefetchBackoff * 2, 1),
+											  INDEX_SCAN_PREFETCH_MAX_BACKOFF);
+			}
+			ostate->prefetchSkip = ostate->prefetchBackoff;
+		}
+
+		sortArg.bounds = bounds;
+		sortArg.desc = &primary->desc;
+		qsort_arg(order, ostate->prefetchCount, sizeof(int),
+				  prefetch_bounds_cmp, &sortArg);
+
+		for (i = 0; i < ostate->prefetchCount; i++)
+		{
+			int			j = order[i];
+
+			ostate->prefetchResults[j] =
+				o_btree_batch_lookup_fetch(ostate->primaryLookup,
+										   (Pointer) &bounds[j],
+										   BTreeKeyBound, csn,
+										   &ostate->prefetchCsns[j],
+										   tupleCxt,
+										   &ostate->prefetchHints[j]);
+		}
+
+		for (i = 0; i < ostate->prefetchCount; i++)
+			pfree(ostate->prefetchTuples[i].data);
+	}
+}
+
+/*
+ * Releases the primary tuples fetched ahead, but not returned yet.
+ */
+void
+o_index_scan_batch_reset(OScanState *ostate)
+{
+	int			i;
+
+	for (i = ostate->prefetchPos; i < ostate->prefetchCount; i++)
+	{
+		if (!O_TUPLE_IS_NULL(ostate->prefetchResults[i]))
+		{
+			pfree(ostate->prefetchResults[i].data);
+			O_TUPLE_SET_NULL(ostate->prefetchResults[i]);
+		}
+	}
+	ostate->prefetchCount = 0;
+	ostate->prefetchPos = 0;
+	ostate->prefetchFinished = false;
+}
+
 OTuple
 o_index_scan_getnext(OTableDescr *descr, OScanState *ostate, CommitSeqNo csn,
 					 CommitSeqNo *tupleCsn, bool scan_primary,
@@ -293,6 +795,15 @@ o_index_scan_getnext(OTableDescr *descr, OScanState *ostate, CommitSeqNo csn,
 	o_btree_load_shmem(&id->desc);
 	while (true)
 	{
+		/*
+		 * Reading ahead is only safe for snapshot reads, which aren't
+		 * affected by our own modifications made meanwhile.
+		 */
+		if (scan_primary && ostate->ixNum != PrimaryIndexNumber &&
+			COMMITSEQNO_IS_NORMAL(csn))
+			return o_index_scan_batch_getnext(descr, ostate, csn, tupleCsn,
+											  tupleCxt, hint);
+
 		tup = o_iterate_index(id, ostate, csn, tupleCsn, tupleCxt,
 							  ostate->ixNum == PrimaryIndexNumber ? hint : NULL);
 
@@ -428,9 +939,9 @@ eanalyze_counter_explain(OEACallsCounter *counter, char *label,
 {
 	StringInfoData explain;
 	char	   *fnames[EA_COUNTERS_NUM] = {"read", "lock", "evict",
-	"write", "load"};
-	uint32		counts[EA_COUNTERS_NUM],
-				i;
+		"write", "load", "s3_parts", "decompressed", "undo_versions"};
+	uint64		counts[EA_COUNTERS_NUM];
+	uint32		i;
 	bool		is_first,
 				is_null;
 	char	   *label_upcase = NULL;
@@ -442,8 +953,11 @@ eanalyze_counter_explain(OEACallsCounter *counter, char *label,
 	counts[2] = counter->evict;
 	counts[3] = counter->write;
 	counts[4] = counter->load;
+	counts[5] = counter->s3Parts;
+	counts[6] = counter->decompressed;
+	counts[7] = counter->undoVersions;
 
-	is_null = true;
+	is_null = counter->lockWait <= 0.0;
 	for (i = 0; i < EA_COUNTERS_NUM; i++)
 		if (counts[i] > 0)
 			is_null = false;
@@ -491,7 +1005,8 @@ eanalyze_counter_explain(OEACallsCounter *counter, char *label,
 						appendStringInfo(&explain, ", ");
 					else
 						initStringInfo(&explain);
-					appendStringInfo(&explain, "%s=%d", fnames[i], counts[i]);
+					appendStringInfo(&explain, "%s=" UINT64_FORMAT,
+									 fnames[i], counts[i]);
 					break;
 				case EXPLAIN_FORMAT_JSON:
 				case EXPLAIN_FORMAT_XML:
@@ -509,6 +1024,27 @@ eanalyze_counter_explain(OEACallsCounter *counter, char *label,
 		}
 	}
 
+	/* time waiting for page locks in milliseconds */
+	if (counter->lockWait > 0.0)
+	{
+		switch (es->format)
+		{
+			case EXPLAIN_FORMAT_TEXT:
+				if (!is_first)
+					appendStringInfo(&explain, ", ");
+				else
+					initStringInfo(&explain);
+				appendStringInfo(&explain, "lock_wait=%.3f", counter->lockWait);
+				break;
+			case EXPLAIN_FORMAT_JSON:
+			case EXPLAIN_FORMAT_XML:
+			case EXPLAIN_FORMAT_YAML:
+				ExplainPropertyFloat("Lock_wait", "ms", counter->lockWait, 3, es);
+				break;
+		}
+		is_first = false;
+	}
+
 	switch (es->format)
 	{
 		case EXPLAIN_FORMAT_TEXT:
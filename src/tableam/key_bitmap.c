@@ -3,6 +3,14 @@
  * key_bitmap.c
  *		Routines for bitmap scan of orioledb table
  *
+ * Key bitmap is a compressed bitmap of uint64 values in the spirit of
+ * roaring bitmaps.  Values are split into a 48-bit high part and a 16-bit
+ * low part.  Each distinct high part has a container, which are kept in a
+ * red-black tree ordered by the high part.  A container is either a sorted
+ * array of low parts (for sparse ranges) or a plain 2^16-bit bitmap (for
+ * dense ranges).  Containers are converted between these representations
+ * depending on their cardinality.
+ *
  * Copyright (c) 2021-2023, Oriole DB Inc.
  *
  * IDENTIFICATION
@@ -13,485 +21,815 @@
 
 #include "orioledb.h"
 
-#include "btree/io.h"
-#include "btree/iterator.h"
-#include "btree/page_chunks.h"
 #include "tableam/bitmap_scan.h"
-#include "tableam/index_scan.h"
-#include "tuple/slot.h"
 
 #include "lib/rbtree.h"
+#include "port/pg_bitutils.h"
+#include "utils/memutils.h"
 
-static int	bm_rbt_comparator(const RBTNode *a, const RBTNode *b, void *arg);
-static void bm_rbt_combiner(RBTNode *existing, const RBTNode *newdata, void *arg);
-static RBTNode *bm_rbt_allocfunc(void *arg);
-static void bm_rbt_freefunc(RBTNode *x, void *arg);
+#define CONTAINER_BITS			16
+#define CONTAINER_LOW_MASK		((UINT64CONST(1) << CONTAINER_BITS) - 1)
+#define CONTAINER_HIGH(value)	((value) >> CONTAINER_BITS)
+#define CONTAINER_LOW(value)	((uint16) ((value) & CONTAINER_LOW_MASK))
 
-#define HIGH_PART_MASK	(0xFFFFFFFFFFFFFC00)
-#define LOW_PART_MASK	(0x00000000000003FF)
-#define BITMAP_SIZE		0x80
+/* Number of 64-bit words in a bitmap container */
+#define BITMAP_WORDS			((1 << CONTAINER_BITS) / 64)
+
+/*
+ * Array containers having more values than that are converted to bitmaps.
+ * At this point both representations take the same amount of memory.
+ */
+#define ARRAY_MAX_VALUES		(BITMAP_WORDS * sizeof(uint64) / sizeof(uint16))
+#define ARRAY_INITIAL_CAPACITY	4
 
 typedef struct
 {
 	RBTNode		rbtnode;
-	uint64		key;
-	uint8	   *bitmap;
-} OKeyBitmapRBTNode;
+	uint64		high;
+	/* number of values in the container */
+	uint32		cardinality;
+	/* array capacity, zero for bitmap containers */
+	uint32		capacity;
+	union
+	{
+		uint16	   *values;
+		uint64	   *words;
+	}			data;
+} OKeyBitmapContainer;
+
+#define CONTAINER_IS_BITMAP(c)	((c)->capacity == 0)
 
-RBTree *
+struct OKeyBitmap
+{
+	RBTree	   *tree;
+	MemoryContext mcxt;
+	/* the last container used for insertion */
+	OKeyBitmapContainer *last;
+};
+
+static int	bm_rbt_comparator(const RBTNode *a, const RBTNode *b, void *arg);
+static void bm_rbt_combiner(RBTNode *existing, const RBTNode *newdata, void *arg);
+static RBTNode *bm_rbt_allocfunc(void *arg);
+static void bm_rbt_freefunc(RBTNode *x, void *arg);
+
+OKeyBitmap *
 o_keybitmap_create(void)
 {
-	return rbt_create(sizeof(OKeyBitmapRBTNode),
-					  bm_rbt_comparator,
-					  bm_rbt_combiner,
-					  bm_rbt_allocfunc,
-					  bm_rbt_freefunc,
-					  NULL);
+	MemoryContext mcxt;
+	MemoryContext oldcxt;
+	OKeyBitmap *bitmap;
+
+	mcxt = AllocSetContextCreate(CurrentMemoryContext,
+								 "orioledb key bitmap",
+								 ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(mcxt);
+	bitmap = palloc(sizeof(OKeyBitmap));
+	bitmap->mcxt = mcxt;
+	bitmap->last = NULL;
+	bitmap->tree = rbt_create(sizeof(OKeyBitmapContainer),
+							  bm_rbt_comparator,
+							  bm_rbt_combiner,
+							  bm_rbt_allocfunc,
+							  bm_rbt_freefunc,
+							  NULL);
+	MemoryContextSwitchTo(oldcxt);
+
+	return bitmap;
 }
 
 void
-o_keybitmap_insert(RBTree *rbtree, uint64 value)
+o_keybitmap_free(OKeyBitmap *bitmap)
 {
-	OKeyBitmapRBTNode node;
-	bool		is_new;
-
-	node.key = value;
-	node.bitmap = NULL;
-	(void) rbt_insert(rbtree, &node.rbtnode, &is_new);
+	MemoryContextDelete(bitmap->mcxt);
 }
 
 bool
-o_keybitmap_test(RBTree *rbtree, uint64 value)
+o_keybitmap_is_empty(OKeyBitmap *bitmap)
 {
-	OKeyBitmapRBTNode node;
-	OKeyBitmapRBTNode *found;
+	return rbt_leftmost(bitmap->tree) == NULL;
+}
 
-	node.key = value;
-	node.bitmap = NULL;
-	found = (OKeyBitmapRBTNode *) rbt_find(rbtree, &node.rbtnode);
-	if (!found)
-		return false;
+/*
+ * Returns position of the first array element, which is greater or equal to
+ * the given value.
+ */
+static uint32
+array_lower_bound(const uint16 *values, uint32 count, uint16 value)
+{
+	uint32		low = 0,
+				high = count;
 
-	if (found->bitmap)
+	while (low < high)
 	{
-		int			offset = (value & LOW_PART_MASK);
+		uint32		mid = low + (high - low) / 2;
 
-		if (found->bitmap[offset >> 3] & (1 << (offset & 7)))
-			return true;
+		if (values[mid] < value)
+			low = mid + 1;
 		else
-			return false;
-	}
-	else
-	{
-		return (found->key == value);
+			high = mid;
 	}
+	return low;
 }
 
-bool
-o_keybitmap_range_is_valid(RBTree *rbtree, uint64 low, uint64 high)
-{
-	OKeyBitmapRBTNode lowNode;
-	OKeyBitmapRBTNode *node;
-	int			i,
-				iStart,
-				iEnd;
-	uint8		startMask,
-				endMask;
-	bool		valid = false;
-	bool		first = true;
-
-	while (!valid && ((low & HIGH_PART_MASK) <= (high & HIGH_PART_MASK)))
-	{
-		bool		skip_step = false;
-
-		lowNode.key = low;
-		lowNode.bitmap = NULL;
+static inline bool
+bitmap_test(const uint64 *words, uint16 value)
+{
+	return (words[value / 64] & (UINT64CONST(1) << (value % 64))) != 0;
+}
 
-		node = (OKeyBitmapRBTNode *) rbt_find_great(rbtree,
-													&lowNode.rbtnode,
-													true);
-		if (!node)
-			break;
+static uint32
+bitmap_cardinality(const uint64 *words)
+{
+	uint32		result = 0;
+	int			i;
 
-		if (!node->bitmap)
-		{
-			if (node->key >= low && node->key < high)
-				valid = true;
-			skip_step = true;
-		}
+	for (i = 0; i < BITMAP_WORDS; i++)
+		result += pg_popcount64(words[i]);
+	return result;
+}
 
-		if (!skip_step)
-		{
-			if ((low & HIGH_PART_MASK) == (node->key & HIGH_PART_MASK))
-			{
-				iStart = (low & LOW_PART_MASK) >> 3;
-				startMask = 0xFF << ((low & LOW_PART_MASK) & 7);
-			}
-			else
-			{
-				iStart = 0;
-				startMask = 0xFF;
-			}
+static void
+container_to_bitmap(OKeyBitmapContainer *container)
+{
+	uint64	   *words;
+	uint32		i;
 
-			if ((high & HIGH_PART_MASK) == (node->key & HIGH_PART_MASK))
-			{
-				iEnd = ((high - 1) & LOW_PART_MASK) >> 3;
-				endMask = 0xFF >> (7 - (((high - 1) & LOW_PART_MASK) & 7));
-			}
-			else
-			{
-				iEnd = BITMAP_SIZE - 1;
-				endMask = 0xFF;
-			}
-			for (i = iStart; i <= iEnd; i++)
-			{
-				uint8		mask;
+	Assert(!CONTAINER_IS_BITMAP(container));
 
-				mask = (i == iStart) ? startMask : 0xFF;
-				if (i == iEnd)
-					mask &= endMask;
+	words = palloc0(BITMAP_WORDS * sizeof(uint64));
+	for (i = 0; i < container->cardinality; i++)
+	{
+		uint16		value = container->data.values[i];
 
-				if (node->bitmap[i] & mask)
-					valid = true;
-			}
-		}
-		if (!valid)
-		{
-			low = node->key;
-			if (!first)
-				low += (1L << 10);
-		}
-		first = false;
+		words[value / 64] |= UINT64CONST(1) << (value % 64);
 	}
-
-	return valid;
+	pfree(container->data.values);
+	container->data.words = words;
+	container->capacity = 0;
 }
 
-static int
-find_next_offset(uint8 *bitmap, int minOffset)
+static void
+container_to_array(OKeyBitmapContainer *container)
 {
+	uint16	   *values;
+	uint32		count = 0;
 	int			i;
-	uint8		mask;
 
-	i = minOffset >> 3;
-	mask = 0xFF << (minOffset & 7);
-	while (i < BITMAP_SIZE)
+	Assert(CONTAINER_IS_BITMAP(container));
+	Assert(container->cardinality > 0 &&
+		   container->cardinality <= ARRAY_MAX_VALUES);
+
+	values = palloc(sizeof(uint16) * container->cardinality);
+	for (i = 0; i < BITMAP_WORDS; i++)
 	{
-		mask &= bitmap[i];
-		if (mask)
-		{
-			int			result;
+		uint64		word = container->data.words[i];
 
-			result = i << 3;
-			while (!(mask & 1))
-			{
-				result++;
-				mask >>= 1;
-			}
-			return result;
+		while (word)
+		{
+			values[count++] = i * 64 + pg_rightmost_one_pos64(word);
+			word &= word - 1;
 		}
-		mask = 0xFF;
-		i++;
 	}
-	return -1;
+	Assert(count == container->cardinality);
+	pfree(container->data.words);
+	container->data.values = values;
+	container->capacity = container->cardinality;
 }
 
-
-uint64
-o_keybitmap_get_next(RBTree *rbtree, uint64 prev, bool *found)
+static void
+container_add(OKeyBitmapContainer *container, uint16 value)
 {
-	OKeyBitmapRBTNode lowNode;
-	OKeyBitmapRBTNode *node;
-	RBTreeIterator iter;
+	uint32		pos;
 
-	lowNode.key = prev;
-	lowNode.bitmap = NULL;
-	node = (OKeyBitmapRBTNode *) rbt_find_great(rbtree,
-												&lowNode.rbtnode,
-												true);
-	if (!node)
+	if (CONTAINER_IS_BITMAP(container))
 	{
-		*found = false;
-		return 0;
-	}
+		uint64		bit = UINT64CONST(1) << (value % 64);
 
-	if (!node->bitmap)
-	{
-		if (node->key >= prev)
+		if (!(container->data.words[value / 64] & bit))
 		{
-			*found = true;
-			return node->key;
+			container->data.words[value / 64] |= bit;
+			container->cardinality++;
 		}
+		return;
 	}
-	else if ((prev & HIGH_PART_MASK) == (node->key & HIGH_PART_MASK))
-	{
-		int			nextOffset;
 
-		nextOffset = find_next_offset(node->bitmap, prev & LOW_PART_MASK);
-
-		if (nextOffset >= 0)
-		{
-			*found = true;
-			return node->key + nextOffset;
-		}
-	}
+	pos = array_lower_bound(container->data.values,
+							container->cardinality, value);
+	if (pos < container->cardinality && container->data.values[pos] == value)
+		return;
 
-	if ((prev & HIGH_PART_MASK) == (node->key & HIGH_PART_MASK))
+	if (container->cardinality >= ARRAY_MAX_VALUES)
 	{
-		rbt_begin_iterate(rbtree, LeftRightWalk, &iter);
-		iter.last_visited = (RBTNode *) node;
-		node = (OKeyBitmapRBTNode *) rbt_iterate(&iter);
+		container_to_bitmap(container);
+		container_add(container, value);
+		return;
 	}
 
-	if (!node)
+	if (container->cardinality == container->capacity)
 	{
-		*found = false;
-		return 0;
+		container->capacity = Min(container->capacity * 2, ARRAY_MAX_VALUES);
+		container->data.values = repalloc(container->data.values,
+										  sizeof(uint16) * container->capacity);
 	}
+	memmove(&container->data.values[pos + 1],
+			&container->data.values[pos],
+			sizeof(uint16) * (container->cardinality - pos));
+	container->data.values[pos] = value;
+	container->cardinality++;
+}
+
+static bool
+container_test(OKeyBitmapContainer *container, uint16 value)
+{
+	uint32		pos;
+
+	if (CONTAINER_IS_BITMAP(container))
+		return bitmap_test(container->data.words, value);
 
-	if (!node->bitmap)
+	pos = array_lower_bound(container->data.values,
+							container->cardinality, value);
+	return pos < container->cardinality &&
+		container->data.values[pos] == value;
+}
+
+/*
+ * Finds the smallest value in the container, which is greater or equal to
+ * the given one.
+ */
+static bool
+container_next(OKeyBitmapContainer *container, uint32 from, uint16 *result)
+{
+	if (from > CONTAINER_LOW_MASK)
+		return false;
+
+	if (CONTAINER_IS_BITMAP(container))
 	{
-		*found = true;
-		return node->key;
+		int			i = from / 64;
+		uint64		word;
+
+		word = container->data.words[i] & (~UINT64CONST(0) << (from % 64));
+		while (true)
+		{
+			if (word)
+			{
+				*result = i * 64 + pg_rightmost_one_pos64(word);
+				return true;
+			}
+			if (++i >= BITMAP_WORDS)
+				return false;
+			word = container->data.words[i];
+		}
 	}
 	else
 	{
-		int			nextOffset = find_next_offset(node->bitmap, 0);
+		uint32		pos;
 
-		Assert(nextOffset >= 0);
-		*found = true;
-		return node->key + nextOffset;
+		pos = array_lower_bound(container->data.values,
+								container->cardinality, from);
+		if (pos >= container->cardinality)
+			return false;
+		*result = container->data.values[pos];
+		return true;
 	}
 }
 
-static void
-free_tree_node(RBTNode *node)
+/*
+ * Checks if the container has any value within [low, high].
+ */
+static bool
+container_range_is_valid(OKeyBitmapContainer *container,
+						 uint16 low, uint16 high)
 {
-	OKeyBitmapRBTNode *keyNode = (OKeyBitmapRBTNode *) node;
+	uint16		next;
+
+	Assert(low <= high);
+	return container_next(container, low, &next) && next <= high;
+}
+
+static OKeyBitmapContainer *
+find_container(OKeyBitmap *bitmap, uint64 high, bool greater)
+{
+	OKeyBitmapContainer key;
+
+	key.high = high;
+	if (greater)
+		return (OKeyBitmapContainer *) rbt_find_great(bitmap->tree,
+													  &key.rbtnode, true);
+	else
+		return (OKeyBitmapContainer *) rbt_find(bitmap->tree, &key.rbtnode);
+}
 
-	if (node->left == node)
+void
+o_keybitmap_insert(OKeyBitmap *bitmap, uint64 value)
+{
+	OKeyBitmapContainer *container = bitmap->last;
+	uint64		high = CONTAINER_HIGH(value);
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(bitmap->mcxt);
+	if (!container || container->high != high)
 	{
-		Assert(node->right == node);
-		return;
+		OKeyBitmapContainer newContainer;
+		bool		isNew;
+
+		memset(&newContainer, 0, sizeof(newContainer));
+		newContainer.high = high;
+		container = (OKeyBitmapContainer *) rbt_insert(bitmap->tree,
+													   &newContainer.rbtnode,
+													   &isNew);
+		if (isNew)
+		{
+			container->capacity = ARRAY_INITIAL_CAPACITY;
+			container->data.values = palloc(sizeof(uint16) *
+											ARRAY_INITIAL_CAPACITY);
+		}
+		bitmap->last = container;
 	}
-	if (keyNode->bitmap)
-		pfree(keyNode->bitmap);
-	free_tree_node(node->left);
-	free_tree_node(node->right);
-	pfree(node);
+
+	container_add(container, CONTAINER_LOW(value));
+	MemoryContextSwitchTo(oldcxt);
 }
 
-void
-o_keybitmap_free(RBTree *tree)
+bool
+o_keybitmap_test(OKeyBitmap *bitmap, uint64 value)
 {
-	free_tree_node(*((RBTNode **) tree));
-	pfree(tree);
+	OKeyBitmapContainer *container;
+
+	container = find_container(bitmap, CONTAINER_HIGH(value), false);
+	if (!container)
+		return false;
+
+	return container_test(container, CONTAINER_LOW(value));
 }
 
+/*
+ * Checks if the bitmap has any value within [low, high).
+ */
 bool
-o_keybitmap_is_empty(RBTree *rbtree)
+o_keybitmap_range_is_valid(OKeyBitmap *bitmap, uint64 low, uint64 high)
 {
-	return rbt_leftmost(rbtree) == NULL;
+	OKeyBitmapContainer *container;
+	uint64		last;
+
+	if (high <= low)
+		return false;
+	last = high - 1;
+
+	container = find_container(bitmap, CONTAINER_HIGH(low), true);
+	while (container && container->high <= CONTAINER_HIGH(last))
+	{
+		uint16		rangeLow = 0,
+					rangeHigh = CONTAINER_LOW_MASK;
+
+		if (container->high == CONTAINER_HIGH(low))
+			rangeLow = CONTAINER_LOW(low);
+		if (container->high == CONTAINER_HIGH(last))
+			rangeHigh = CONTAINER_LOW(last);
+
+		if (container_range_is_valid(container, rangeLow, rangeHigh))
+			return true;
+
+		if (container->high == CONTAINER_HIGH(last))
+			break;
+		container = find_container(bitmap, container->high + 1, true);
+	}
+
+	return false;
 }
 
-void
-o_keybitmap_intersect(RBTree *a, RBTree *b)
+uint64
+o_keybitmap_get_next(OKeyBitmap *bitmap, uint64 prev, bool *found)
 {
-	RBTreeIterator iterA;
-	RBTreeIterator iterB;
-	OKeyBitmapRBTNode *nodeA;
-	OKeyBitmapRBTNode *nodeB;
-	List	   *removing = NIL;
-	ListCell   *lc;
+	OKeyBitmapContainer *container;
+	uint32		from;
 
-	rbt_begin_iterate(a, LeftRightWalk, &iterA);
-	rbt_begin_iterate(b, LeftRightWalk, &iterB);
+	container = find_container(bitmap, CONTAINER_HIGH(prev), true);
+	if (!container)
+	{
+		*found = false;
+		return 0;
+	}
 
-	nodeB = (OKeyBitmapRBTNode *) rbt_iterate(&iterB);
-	while ((nodeA = (OKeyBitmapRBTNode *) rbt_iterate(&iterA)) != NULL)
+	from = (container->high == CONTAINER_HIGH(prev)) ? CONTAINER_LOW(prev) : 0;
+	while (container)
 	{
-		while (nodeB &&
-			   (nodeB->key & HIGH_PART_MASK) < (nodeA->key & HIGH_PART_MASK))
+		uint16		next;
+
+		if (container_next(container, from, &next))
 		{
-			nodeB = (OKeyBitmapRBTNode *) rbt_iterate(&iterB);
+			*found = true;
+			return (container->high << CONTAINER_BITS) | next;
 		}
 
-		if (!nodeB ||
-			(nodeB->key & HIGH_PART_MASK) > (nodeA->key & HIGH_PART_MASK))
-		{
-			OKeyBitmapRBTNode *removed_node;
+		container = find_container(bitmap, container->high + 1, true);
+		from = 0;
+	}
 
-			removed_node = palloc0(sizeof(OKeyBitmapRBTNode));
-			memcpy(removed_node, nodeA, sizeof(OKeyBitmapRBTNode));
-			removing = lappend(removing, removed_node);
-			continue;
-		}
+	*found = false;
+	return 0;
+}
 
-		Assert((nodeA->key & HIGH_PART_MASK) == (nodeB->key & HIGH_PART_MASK));
+/*
+ * Intersects container a with container b in place.  Returns the resulting
+ * cardinality of a.
+ */
+static uint32
+container_intersect(OKeyBitmapContainer *a, OKeyBitmapContainer *b)
+{
+	if (CONTAINER_IS_BITMAP(a) && CONTAINER_IS_BITMAP(b))
+	{
+		uint64	   *wa = a->data.words;
+		const uint64 *wb = b->data.words;
+		int			i;
 
-		if (!nodeA->bitmap)
+		/* simple loops over words to let the compiler vectorize them */
+		for (i = 0; i < BITMAP_WORDS; i++)
+			wa[i] &= wb[i];
+		a->cardinality = bitmap_cardinality(wa);
+		if (a->cardinality > 0 && a->cardinality <= ARRAY_MAX_VALUES)
+			container_to_array(a);
+	}
+	else if (CONTAINER_IS_BITMAP(a))
+	{
+		uint64	   *words = a->data.words;
+		uint16	   *values;
+		uint32		i,
+					count = 0;
+
+		/* the result can't be larger than the array of b */
+		values = palloc(sizeof(uint16) * Max(b->cardinality, 1));
+		for (i = 0; i < b->cardinality; i++)
 		{
-			if (!nodeB->bitmap)
-			{
-				if (nodeA->key != nodeB->key)
-				{
-					OKeyBitmapRBTNode *removed_node;
+			if (bitmap_test(words, b->data.values[i]))
+				values[count++] = b->data.values[i];
+		}
+		pfree(words);
+		a->data.values = values;
+		a->capacity = Max(b->cardinality, 1);
+		a->cardinality = count;
+	}
+	else
+	{
+		uint16	   *va = a->data.values;
+		uint32		i,
+					count = 0;
 
-					removed_node = palloc0(sizeof(OKeyBitmapRBTNode));
-					memcpy(removed_node, nodeA, sizeof(OKeyBitmapRBTNode));
-					removing = lappend(removing, removed_node);
-					continue;
-				}
-			}
-			else
+		if (CONTAINER_IS_BITMAP(b))
+		{
+			for (i = 0; i < a->cardinality; i++)
 			{
-				int			offset = (nodeA->key & LOW_PART_MASK);
-
-				if (!(nodeB->bitmap[offset >> 3] & (1 << (offset & 7))))
-				{
-					OKeyBitmapRBTNode *removed_node;
-
-					removed_node = palloc0(sizeof(OKeyBitmapRBTNode));
-					memcpy(removed_node, nodeA, sizeof(OKeyBitmapRBTNode));
-					removing = lappend(removing, removed_node);
-					continue;
-				}
+				if (bitmap_test(b->data.words, va[i]))
+					va[count++] = va[i];
 			}
 		}
 		else
 		{
-			if (!nodeB->bitmap)
-			{
-				int			offset = (nodeB->key & LOW_PART_MASK);
+			const uint16 *vb = b->data.values;
+			uint32		j = 0;
 
-				if (!(nodeA->bitmap[offset >> 3] & (1 << (offset & 7))))
+			i = 0;
+			while (i < a->cardinality && j < b->cardinality)
+			{
+				if (va[i] < vb[j])
+					i++;
+				else if (va[i] > vb[j])
+					j++;
+				else
 				{
-					OKeyBitmapRBTNode *removed_node;
-
-					removed_node = palloc0(sizeof(OKeyBitmapRBTNode));
-					memcpy(removed_node, nodeA, sizeof(OKeyBitmapRBTNode));
-					removing = lappend(removing, removed_node);
-					continue;
+					va[count++] = va[i];
+					i++;
+					j++;
 				}
-				pfree(nodeA->bitmap);
-				nodeA->bitmap = NULL;
-				nodeA->key = nodeB->key;
 			}
-			else
-			{
-				int			i;
-				bool		empty = true;
+		}
+		a->cardinality = count;
+	}
 
-				for (i = 0; i < BITMAP_SIZE; i++)
-				{
-					nodeA->bitmap[i] &= nodeB->bitmap[i];
-					if (nodeA->bitmap[i] != 0)
-						empty = false;
-				}
+	return a->cardinality;
+}
 
-				if (empty)
-				{
-					OKeyBitmapRBTNode *removed_node;
+void
+o_keybitmap_intersect(OKeyBitmap *a, OKeyBitmap *b)
+{
+	RBTreeIterator iterA;
+	OKeyBitmapContainer *containerA;
+	OKeyBitmapContainer *containerB;
+	uint64	   *removing = NULL;
+	int			nRemoving = 0,
+				removingAllocated = 0;
+	int			i;
+	MemoryContext oldcxt;
 
-					removed_node = palloc0(sizeof(OKeyBitmapRBTNode));
-					memcpy(removed_node, nodeA, sizeof(OKeyBitmapRBTNode));
-					removing = lappend(removing, removed_node);
-					continue;
-				}
+	oldcxt = MemoryContextSwitchTo(a->mcxt);
+
+	rbt_begin_iterate(a->tree, LeftRightWalk, &iterA);
+	while ((containerA = (OKeyBitmapContainer *) rbt_iterate(&iterA)) != NULL)
+	{
+		containerB = find_container(b, containerA->high, false);
+
+		if (!containerB || container_intersect(containerA, containerB) == 0)
+		{
+			if (nRemoving >= removingAllocated)
+			{
+				removingAllocated = Max(removingAllocated * 2, 16);
+				if (removing)
+					removing = repalloc(removing,
+										sizeof(uint64) * removingAllocated);
+				else
+					removing = palloc(sizeof(uint64) * removingAllocated);
 			}
+			removing[nRemoving++] = containerA->high;
 		}
 	}
 
-	foreach(lc, removing)
+	/*
+	 * rbt_delete() might move the data between nodes, so find each node
+	 * again before deletion.
+	 */
+	for (i = 0; i < nRemoving; i++)
 	{
-		OKeyBitmapRBTNode *search_node;
-		OKeyBitmapRBTNode *removing_node;
-
-		search_node = (OKeyBitmapRBTNode *) lfirst(lc);
-		if (search_node->bitmap)
-			pfree(search_node->bitmap);
-		removing_node = (OKeyBitmapRBTNode *) rbt_find(a,
-													   (RBTNode *) search_node);
-		rbt_delete(a, (RBTNode *) removing_node);
-		pfree(search_node);
+		OKeyBitmapContainer *container;
+
+		container = find_container(a, removing[i], false);
+		Assert(container);
+		pfree(container->data.values);
+		rbt_delete(a->tree, &container->rbtnode);
 	}
-	list_free(removing);
+	if (removing)
+		pfree(removing);
+	a->last = NULL;
+
+	MemoryContextSwitchTo(oldcxt);
 }
 
-void
-o_keybitmap_union(RBTree *a, RBTree *b)
+/*
+ * Merges container b into container a.
+ */
+static void
+container_union(OKeyBitmapContainer *a, const OKeyBitmapContainer *b)
 {
-	RBTreeIterator iterB;
-	OKeyBitmapRBTNode *nodeB;
+	if (!CONTAINER_IS_BITMAP(a) && !CONTAINER_IS_BITMAP(b) &&
+		a->cardinality + b->cardinality <= ARRAY_MAX_VALUES)
+	{
+		const uint16 *va = a->data.values;
+		const uint16 *vb = b->data.values;
+		uint16	   *values;
+		uint32		i = 0,
+					j = 0,
+					count = 0;
+
+		values = palloc(sizeof(uint16) * (a->cardinality + b->cardinality));
+		while (i < a->cardinality && j < b->cardinality)
+		{
+			if (va[i] < vb[j])
+				values[count++] = va[i++];
+			else if (va[i] > vb[j])
+				values[count++] = vb[j++];
+			else
+			{
+				values[count++] = va[i++];
+				j++;
+			}
+		}
+		while (i < a->cardinality)
+			values[count++] = va[i++];
+		while (j < b->cardinality)
+			values[count++] = vb[j++];
+
+		pfree(a->data.values);
+		a->data.values = values;
+		a->capacity = a->cardinality + b->cardinality;
+		a->cardinality = count;
+		return;
+	}
+
+	if (!CONTAINER_IS_BITMAP(a))
+		container_to_bitmap(a);
 
-	rbt_begin_iterate(b, LeftRightWalk, &iterB);
-	while ((nodeB = (OKeyBitmapRBTNode *) rbt_iterate(&iterB)) != NULL)
+	if (CONTAINER_IS_BITMAP(b))
 	{
-		bool		is_new;
+		uint64	   *wa = a->data.words;
+		const uint64 *wb = b->data.words;
+		int			i;
 
-		rbt_insert(a, &nodeB->rbtnode, &is_new);
+		for (i = 0; i < BITMAP_WORDS; i++)
+			wa[i] |= wb[i];
+		a->cardinality = bitmap_cardinality(wa);
+	}
+	else
+	{
+		uint32		i;
+
+		for (i = 0; i < b->cardinality; i++)
+			container_add(a, b->data.values[i]);
 	}
 }
 
-static int
-bm_rbt_comparator(const RBTNode *a, const RBTNode *b, void *arg)
+static void
+container_copy(OKeyBitmapContainer *dst, const OKeyBitmapContainer *src)
 {
-	const OKeyBitmapRBTNode *keyA = (OKeyBitmapRBTNode *) a;
-	const OKeyBitmapRBTNode *keyB = (OKeyBitmapRBTNode *) b;
-	uint64		va = keyA->key & HIGH_PART_MASK;
-	uint64		vb = keyB->key & HIGH_PART_MASK;
+	Size		size;
 
-	return va > vb ? 1 : va < vb ? -1 : 0;
+	dst->cardinality = src->cardinality;
+	if (CONTAINER_IS_BITMAP(src))
+	{
+		size = BITMAP_WORDS * sizeof(uint64);
+		dst->capacity = 0;
+		dst->data.words = palloc(size);
+		memcpy(dst->data.words, src->data.words, size);
+	}
+	else
+	{
+		size = sizeof(uint16) * Max(src->cardinality, 1);
+		dst->capacity = Max(src->cardinality, 1);
+		dst->data.values = palloc(size);
+		memcpy(dst->data.values, src->data.values,
+			   sizeof(uint16) * src->cardinality);
+	}
 }
 
-static void
-node_make_bitmap(OKeyBitmapRBTNode *node)
+void
+o_keybitmap_union(OKeyBitmap *a, OKeyBitmap *b)
 {
-	int			offset;
+	RBTreeIterator iterB;
+	OKeyBitmapContainer *containerB;
+	MemoryContext oldcxt;
 
-	node->bitmap = palloc0(BITMAP_SIZE);
-	offset = node->key & LOW_PART_MASK;
+	oldcxt = MemoryContextSwitchTo(a->mcxt);
+
+	rbt_begin_iterate(b->tree, LeftRightWalk, &iterB);
+	while ((containerB = (OKeyBitmapContainer *) rbt_iterate(&iterB)) != NULL)
+	{
+		OKeyBitmapContainer newContainer;
+		OKeyBitmapContainer *containerA;
+		bool		isNew;
+
+		memset(&newContainer, 0, sizeof(newContainer));
+		newContainer.high = containerB->high;
+		containerA = (OKeyBitmapContainer *) rbt_insert(a->tree,
+														&newContainer.rbtnode,
+														&isNew);
+		if (isNew)
+			container_copy(containerA, containerB);
+		else
+			container_union(containerA, containerB);
+	}
 
-	node->bitmap[offset >> 3] |= 1 << (offset & 7);
-	node->key &= HIGH_PART_MASK;
+	MemoryContextSwitchTo(oldcxt);
 }
 
-static void
-bm_rbt_combiner(RBTNode *existing,
-				const RBTNode *newdata,
-				void *arg)
+/*
+ * Serialized form of the key bitmap.  Containers follow the header in the
+ * key order, each one is followed by its data.
+ */
+typedef struct
+{
+	uint64		nContainers;
+} OKeyBitmapSerializedHeader;
+
+typedef struct
 {
-	OKeyBitmapRBTNode *old = (OKeyBitmapRBTNode *) existing;
-	OKeyBitmapRBTNode *new = (OKeyBitmapRBTNode *) newdata;
+	uint64		high;
+	uint32		cardinality;
+	bool		isBitmap;
+} OKeyBitmapSerializedContainer;
+
+static Size
+container_data_size(OKeyBitmapContainer *container)
+{
+	if (CONTAINER_IS_BITMAP(container))
+		return BITMAP_WORDS * sizeof(uint64);
+	else
+		return MAXALIGN(sizeof(uint16) * container->cardinality);
+}
 
-	if (!old->bitmap)
+/*
+ * Puts a flat copy of the bitmap to the given DSA area.
+ */
+dsa_pointer
+o_keybitmap_serialize(OKeyBitmap *bitmap, dsa_area *area)
+{
+	RBTreeIterator iter;
+	OKeyBitmapContainer *container;
+	OKeyBitmapSerializedHeader *header;
+	dsa_pointer result;
+	Size		size = MAXALIGN(sizeof(OKeyBitmapSerializedHeader));
+	uint64		nContainers = 0;
+	Pointer		ptr;
+
+	rbt_begin_iterate(bitmap->tree, LeftRightWalk, &iter);
+	while ((container = (OKeyBitmapContainer *) rbt_iterate(&iter)) != NULL)
 	{
-		if (!new->bitmap && new->key == old->key)
-			return;
-		node_make_bitmap(old);
+		size += MAXALIGN(sizeof(OKeyBitmapSerializedContainer));
+		size += container_data_size(container);
+		nContainers++;
 	}
 
-	if (!new->bitmap)
+	result = dsa_allocate_extended(area, size, DSA_ALLOC_HUGE);
+	ptr = dsa_get_address(area, result);
+	header = (OKeyBitmapSerializedHeader *) ptr;
+	header->nContainers = nContainers;
+	ptr += MAXALIGN(sizeof(OKeyBitmapSerializedHeader));
+
+	rbt_begin_iterate(bitmap->tree, LeftRightWalk, &iter);
+	while ((container = (OKeyBitmapContainer *) rbt_iterate(&iter)) != NULL)
 	{
-		int			offset = new->key & LOW_PART_MASK;
+		OKeyBitmapSerializedContainer *scontainer;
+
+		scontainer = (OKeyBitmapSerializedContainer *) ptr;
+		scontainer->high = container->high;
+		scontainer->cardinality = container->cardinality;
+		scontainer->isBitmap = CONTAINER_IS_BITMAP(container);
+		ptr += MAXALIGN(sizeof(OKeyBitmapSerializedContainer));
 
-		old->bitmap[offset >> 3] |= 1 << (offset & 7);
+		if (scontainer->isBitmap)
+			memcpy(ptr, container->data.words, BITMAP_WORDS * sizeof(uint64));
+		else
+			memcpy(ptr, container->data.values,
+				   sizeof(uint16) * container->cardinality);
+		ptr += container_data_size(container);
 	}
-	else
-	{
-		int			i;
 
-		for (i = 0; i < BITMAP_SIZE; i++)
-			old->bitmap[i] |= new->bitmap[i];
+	return result;
+}
+
+/*
+ * Makes a local copy of the bitmap serialized by o_keybitmap_serialize().
+ */
+OKeyBitmap *
+o_keybitmap_deserialize(dsa_area *area, dsa_pointer ptr)
+{
+	OKeyBitmap *bitmap = o_keybitmap_create();
+	OKeyBitmapSerializedHeader *header;
+	Pointer		data;
+	uint64		i;
+	MemoryContext oldcxt;
+
+	data = dsa_get_address(area, ptr);
+	header = (OKeyBitmapSerializedHeader *) data;
+	data += MAXALIGN(sizeof(OKeyBitmapSerializedHeader));
+
+	oldcxt = MemoryContextSwitchTo(bitmap->mcxt);
+	for (i = 0; i < header->nContainers; i++)
+	{
+		OKeyBitmapSerializedContainer *scontainer;
+		OKeyBitmapContainer newContainer;
+		OKeyBitmapContainer *container;
+		bool		isNew;
+		Size		size;
+
+		scontainer = (OKeyBitmapSerializedContainer *) data;
+		data += MAXALIGN(sizeof(OKeyBitmapSerializedContainer));
+
+		memset(&newContainer, 0, sizeof(newContainer));
+		newContainer.high = scontainer->high;
+		container = (OKeyBitmapContainer *) rbt_insert(bitmap->tree,
+													   &newContainer.rbtnode,
+													   &isNew);
+		Assert(isNew);
+		container->cardinality = scontainer->cardinality;
+		if (scontainer->isBitmap)
+		{
+			size = BITMAP_WORDS * sizeof(uint64);
+			container->capacity = 0;
+			container->data.words = palloc(size);
+			memcpy(container->data.words, data, size);
+		}
+		else
+		{
+			size = sizeof(uint16) * scontainer->cardinality;
+			container->capacity = Max(scontainer->cardinality, 1);
+			container->data.values = palloc(sizeof(uint16) *
+											container->capacity);
+			memcpy(container->data.values, data, size);
+		}
+		data += container_data_size(container);
 	}
+	MemoryContextSwitchTo(oldcxt);
+
+	return bitmap;
+}
+
+static int
+bm_rbt_comparator(const RBTNode *a, const RBTNode *b, void *arg)
+{
+	const OKeyBitmapContainer *containerA = (const OKeyBitmapContainer *) a;
+	const OKeyBitmapContainer *containerB = (const OKeyBitmapContainer *) b;
+
+	return containerA->high > containerB->high ? 1 :
+		containerA->high < containerB->high ? -1 : 0;
+}
+
+static void
+bm_rbt_combiner(RBTNode *existing, const RBTNode *newdata, void *arg)
+{
+	/* Containers are filled by the callers of rbt_insert() */
 }
 
 static RBTNode *
 bm_rbt_allocfunc(void *arg)
 {
-	RBTNode    *result = palloc0(sizeof(OKeyBitmapRBTNode));
-
-	return result;
+	return palloc0(sizeof(OKeyBitmapContainer));
 }
 
 static void
@@ -15,6 +15,7 @@
 #include "orioledb.h"
 
 #include "btree/btree.h"
+#include "btree/find.h"
 #include "btree/iterator.h"
 #include "btree/modify.h"
 #include "recovery/recovery.h"
@@ -26,17 +27,47 @@
 #include "transam/oxid.h"
 #include "transam/undo.h"
 #include "tuple/slot.h"
+#include "tuple/sort.h"
 #include "utils/stopevent.h"
 
 #include "access/heapam.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "catalog/index.h"
 #include "catalog/storage.h"
 #include "commands/vacuum.h"
 #include "nodes/execnodes.h"
+#include "miscadmin.h"
 #include "parser/parsetree.h"
 #include "storage/bufmgr.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+/*
+ * Maximum number of the secondary index tuples deferred by the batch
+ * insertion.
+ */
+#define O_SECONDARY_BATCH_SIZE	1024
+
+typedef struct
+{
+	int			ixnum;
+	OTuple		tuple;
+} OSecondaryBatchItem;
+
+/*
+ * Tuples of the non-unique secondary indices deferred by the batch insertion.
+ * They are inserted in the key order of each index, so that the subsequent
+ * insertions reuse the leaf location of the previous one.
+ */
+typedef struct
+{
+	OTableDescr *descr;
+	int			nitems;
+	OSecondaryBatchItem items[O_SECONDARY_BATCH_SIZE];
+} OSecondaryBatch;
 
 static OTableModifyResult o_update_secondary_indices(OTableDescr *descr,
 													 TupleTableSlot *newSlot,
@@ -48,10 +79,13 @@ static OBTreeModifyResult o_tbl_index_insert(OTableDescr *descr,
 											 OIndexDescr *id,
 											 TupleTableSlot *slot,
 											 OXid oxid, CommitSeqNo csn,
+											 BTreeLocationHint *hint,
 											 BTreeModifyCallbackInfo *callbackInfo);
 static OTableModifyResult o_tbl_indices_insert(TupleTableSlot *slot,
 											   OTableDescr *descr, OXid oxid,
 											   CommitSeqNo csn,
+											   BTreeLocationHint *hint,
+											   OSecondaryBatch *batch,
 											   BTreeModifyCallbackInfo *callbackInfo);
 static OTableModifyResult o_tbl_indices_overwrite(OTableDescr *descr,
 												  OBTreeKeyBound *oldPkey,
@@ -166,9 +200,103 @@ update_arg_get_slot(OModifyCallbackArg *arg)
 		return arg->tmpSlot;
 }
 
-TupleTableSlot *
-o_tbl_insert(OTableDescr *descr, Relation relation,
-			 TupleTableSlot *slot, OXid oxid, CommitSeqNo csn)
+static int
+secondary_batch_item_cmp(const void *a, const void *b, void *arg)
+{
+	const OSecondaryBatchItem *item1 = (const OSecondaryBatchItem *) a;
+	const OSecondaryBatchItem *item2 = (const OSecondaryBatchItem *) b;
+	OTableDescr *descr = (OTableDescr *) arg;
+
+	if (item1->ixnum != item2->ixnum)
+		return item1->ixnum - item2->ixnum;
+
+	return o_btree_cmp(&descr->indices[item1->ixnum]->desc,
+					   (Pointer) &item1->tuple, BTreeKeyLeafTuple,
+					   (Pointer) &item2->tuple, BTreeKeyLeafTuple);
+}
+
+static OSecondaryBatch *
+o_secondary_batch_create(OTableDescr *descr)
+{
+	OSecondaryBatch *batch;
+	int			i;
+
+	if (!enable_batch_index_insert)
+		return NULL;
+
+	for (i = PrimaryIndexNumber + 1; i < descr->nIndices; i++)
+	{
+		if (!descr->indices[i]->unique)
+			break;
+	}
+	if (i >= descr->nIndices)
+		return NULL;
+
+	batch = (OSecondaryBatch *) palloc(sizeof(OSecondaryBatch));
+	batch->descr = descr;
+	batch->nitems = 0;
+	return batch;
+}
+
+/*
+ * Inserts the deferred secondary index tuples.
+ */
+static void
+o_secondary_batch_flush(OSecondaryBatch *batch, OXid oxid, CommitSeqNo csn)
+{
+	OTableDescr *descr = batch->descr;
+	BTreeLocationHint hint = {OInvalidInMemoryBlkno, 0};
+	BTreeModifyCallbackInfo callbackInfo =
+	{
+		.waitCallback = NULL,
+		.modifyDeletedCallback = o_insert_callback,
+		.modifyCallback = NULL,
+		.needsUndoForSelfCreated = true,
+		.arg = NULL
+	};
+	int			prevIxnum = -1;
+	int			i;
+
+	qsort_arg(batch->items, batch->nitems, sizeof(OSecondaryBatchItem),
+			  secondary_batch_item_cmp, descr);
+
+	for (i = 0; i < batch->nitems; i++)
+	{
+		OSecondaryBatchItem *item = &batch->items[i];
+		OIndexDescr *id = descr->indices[item->ixnum];
+
+		if (item->ixnum != prevIxnum)
+		{
+			o_btree_load_shmem(&id->desc);
+			hint.blkno = OInvalidInMemoryBlkno;
+			hint.pageChangeCount = 0;
+			prevIxnum = item->ixnum;
+		}
+
+		if (o_btree_modify(&id->desc, BTreeOperationInsert,
+						   item->tuple, BTreeKeyLeafTuple,
+						   NULL, BTreeKeyNone,
+						   oxid, csn, RowLockUpdate,
+						   &hint, &callbackInfo) != OBTreeModifyResultInserted)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("unable to insert tuple into secondary index \"%s\"",
+							id->name.data)));
+		STOPEVENT(STOPEVENT_INDEX_INSERT, NULL);
+		pfree(item->tuple.data);
+	}
+	batch->nitems = 0;
+}
+
+/*
+ * Inserts the tuple into the table.  'hint' is the primary key leaf location
+ * left by the previous insertion of the sorted batch, or NULL.  Tuples of
+ * non-unique secondary indices are deferred to the 'batch' if given.
+ */
+static TupleTableSlot *
+o_tbl_insert_internal(OTableDescr *descr, Relation relation,
+					  TupleTableSlot *slot, OXid oxid, CommitSeqNo csn,
+					  BTreeLocationHint *hint, OSecondaryBatch *batch)
 {
 	OTableModifyResult mres;
 	OTuple		tup;
@@ -204,8 +332,11 @@ o_tbl_insert(OTableDescr *descr, Relation relation,
 								RelationGetRelationName(relation),
 								false);
 
+	if (batch && batch->nitems + descr->nIndices > O_SECONDARY_BATCH_SIZE)
+		o_secondary_batch_flush(batch, oxid, csn);
+
 	mres = o_tbl_indices_insert(slot, descr, oxid,
-								csn, &callbackInfo);
+								csn, hint, batch, &callbackInfo);
 
 	if (!mres.success)
 	{
@@ -222,6 +353,444 @@ o_tbl_insert(OTableDescr *descr, Relation relation,
 	return slot;
 }
 
+TupleTableSlot *
+o_tbl_insert(OTableDescr *descr, Relation relation,
+			 TupleTableSlot *slot, OXid oxid, CommitSeqNo csn)
+{
+	return o_tbl_insert_internal(descr, relation, slot, oxid, csn, NULL, NULL);
+}
+
+typedef struct
+{
+	int			index;
+	OBTreeKeyBound key;
+} OMultiInsertItem;
+
+static int
+multi_insert_item_cmp(const void *a, const void *b, void *arg)
+{
+	const OMultiInsertItem *item1 = (const OMultiInsertItem *) a;
+	const OMultiInsertItem *item2 = (const OMultiInsertItem *) b;
+	int			cmp;
+
+	cmp = o_btree_cmp((BTreeDescr *) arg,
+					  (Pointer) &item1->key, BTreeKeyBound,
+					  (Pointer) &item2->key, BTreeKeyBound);
+	if (cmp != 0)
+		return cmp;
+	return item1->index - item2->index;
+}
+
+static int
+fkey_prefetch_cmp(const void *a, const void *b, void *arg)
+{
+	BTreeDescr *desc = (BTreeDescr *) arg;
+
+	return o_btree_cmp(desc,
+					   *((Pointer *) a), BTreeKeyBound,
+					   *((Pointer *) b), BTreeKeyBound);
+}
+
+/*
+ * Loads the primary key leaves of the referenced OrioleDB table for the
+ * foreign key values of the batch.  The keys are read ahead and looked up
+ * in the key order, so the RI triggers checking each row afterwards find
+ * these pages in memory.  Returns false if the foreign key doesn't match the
+ * primary key of the OrioleDB table.
+ */
+static bool
+o_fkey_prefetch_parent(Relation relation, ForeignKeyCacheInfo *fk,
+					   TupleTableSlot **slots, int ntuples)
+{
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	Relation	parent;
+	OTableDescr *parentDescr;
+	OIndexDescr *primary;
+	AttrNumber	childAttnums[INDEX_MAX_KEYS];
+	OBTreeKeyBound *bounds;
+	BTreeBatchLookup *lookup;
+	Pointer    *keys;
+	int			nkeys = 0;
+	int			i,
+				j;
+
+	parent = table_open(fk->confrelid, AccessShareLock);
+	if (!is_orioledb_rel(parent))
+	{
+		table_close(parent, AccessShareLock);
+		return false;
+	}
+
+	parentDescr = relation_get_descr(parent);
+	primary = GET_PRIMARY(parentDescr);
+	if (primary->primaryIsCtid || primary->nonLeafTupdesc->natts != fk->nkeys)
+	{
+		table_close(parent, AccessShareLock);
+		return false;
+	}
+
+	/* Map the primary key fields to the referencing columns */
+	for (i = 0; i < fk->nkeys; i++)
+	{
+		for (j = 0; j < fk->nkeys; j++)
+		{
+			if (fk->confkey[j] == primary->fields[i].tableAttnum)
+				break;
+		}
+		if (j >= fk->nkeys ||
+			TupleDescAttr(tupdesc, fk->conkey[j] - 1)->atttypid !=
+			primary->nonLeafTupdesc->attrs[i].atttypid)
+		{
+			table_close(parent, AccessShareLock);
+			return false;
+		}
+		childAttnums[i] = fk->conkey[j];
+	}
+
+	bounds = (OBTreeKeyBound *) palloc(sizeof(OBTreeKeyBound) * ntuples);
+	keys = (Pointer *) palloc(sizeof(Pointer) * ntuples);
+	for (i = 0; i < ntuples; i++)
+	{
+		OBTreeKeyBound *bound = &bounds[nkeys];
+
+		bound->nkeys = fk->nkeys;
+		for (j = 0; j < fk->nkeys; j++)
+		{
+			bool		isnull;
+
+			bound->keys[j].value = slot_getattr(slots[i], childAttnums[j],
+												&isnull);
+			/* Rows having null foreign key values aren't checked */
+			if (isnull)
+				break;
+			bound->keys[j].type = primary->nonLeafTupdesc->attrs[j].atttypid;
+			bound->keys[j].flags = O_VALUE_BOUND_PLAIN_VALUE;
+			bound->keys[j].comparator = primary->fields[j].comparator;
+		}
+		if (j >= fk->nkeys)
+			keys[nkeys++] = (Pointer) bound;
+	}
+
+	if (nkeys > 0)
+	{
+		qsort_arg(keys, nkeys, sizeof(Pointer), fkey_prefetch_cmp,
+				  &primary->desc);
+
+		o_btree_load_shmem(&primary->desc);
+		(void) btree_prefetch_keys(&primary->desc, keys, nkeys,
+								   BTreeKeyBound);
+
+		lookup = o_btree_batch_lookup_create(&primary->desc);
+		for (i = 0; i < nkeys; i++)
+		{
+			OTuple		tuple;
+			CommitSeqNo tupleCsn;
+
+			if (i > 0 && fkey_prefetch_cmp(&keys[i - 1], &keys[i],
+										   &primary->desc) == 0)
+				continue;
+
+			tuple = o_btree_batch_lookup_fetch(lookup, keys[i], BTreeKeyBound,
+											   COMMITSEQNO_INPROGRESS,
+											   &tupleCsn, CurrentMemoryContext,
+											   NULL);
+			if (!O_TUPLE_IS_NULL(tuple))
+				pfree(tuple.data);
+		}
+		o_btree_batch_lookup_free(lookup);
+	}
+
+	pfree(keys);
+	pfree(bounds);
+	table_close(parent, AccessShareLock);
+	return true;
+}
+
+/*
+ * Prepares the foreign key checks of the batch against the OrioleDB
+ * referenced tables (see o_fkey_prefetch_parent()).
+ */
+static void
+o_fkey_prefetch_parents(Relation relation, TupleTableSlot **slots,
+						int ntuples)
+{
+	List	   *fkeys;
+	ListCell   *lc;
+
+	if (!enable_fkey_prefetch || ntuples <= 1)
+		return;
+
+	fkeys = RelationGetFKeyList(relation);
+	foreach(lc, fkeys)
+	{
+		ForeignKeyCacheInfo *fk = (ForeignKeyCacheInfo *) lfirst(lc);
+
+		if (fk->conrelid != RelationGetRelid(relation))
+			continue;
+		(void) o_fkey_prefetch_parent(relation, fk, slots, ntuples);
+	}
+}
+
+/*
+ * Inserts the batch of tuples into the table.  Tuples are inserted in the
+ * primary key order, so the subsequent insertions usually land to the same
+ * leaf page as the previous one.  Such insertions skip the tree descent
+ * using the location hint of the previous insertion.  Ctid primary keys are
+ * assigned sequentially, so these batches are already in order.  With
+ * orioledb.enable_batch_index_insert, the tuples of non-unique secondary
+ * indices are also inserted in the key order of each index after the batch.
+ * With orioledb.enable_fkey_prefetch, the referenced keys of the batch are
+ * loaded beforehand for the foreign key checks.
+ */
+void
+o_tbl_multi_insert(OTableDescr *descr, Relation relation,
+				   TupleTableSlot **slots, int ntuples,
+				   OXid oxid, CommitSeqNo csn)
+{
+	OIndexDescr *primary = GET_PRIMARY(descr);
+	OMultiInsertItem *items = NULL;
+	OSecondaryBatch *batch;
+	BTreeLocationHint hint = {OInvalidInMemoryBlkno, 0};
+	int			i;
+
+	o_fkey_prefetch_parents(relation, slots, ntuples);
+
+	o_btree_load_shmem(&primary->desc);
+
+	if (primary->primaryIsCtid)
+	{
+		btree_ctid_reserve(&primary->desc, ntuples);
+	}
+	else if (ntuples > 1)
+	{
+		items = (OMultiInsertItem *) palloc(sizeof(OMultiInsertItem) * ntuples);
+		for (i = 0; i < ntuples; i++)
+		{
+			TupleTableSlot *slot = slots[i];
+
+			if (slot->tts_ops != descr->newTuple->tts_ops)
+				break;
+			items[i].index = i;
+			tts_orioledb_fill_key_bound(slot, primary, &items[i].key);
+		}
+
+		/* Keep the original order for the foreign slots */
+		if (i < ntuples)
+		{
+			pfree(items);
+			items = NULL;
+		}
+		else
+		{
+			qsort_arg(items, ntuples, sizeof(OMultiInsertItem),
+					  multi_insert_item_cmp, &primary->desc);
+		}
+	}
+
+	batch = o_secondary_batch_create(descr);
+
+	for (i = 0; i < ntuples; i++)
+	{
+		TupleTableSlot *slot = slots[items ? items[i].index : i];
+
+		(void) o_tbl_insert_internal(descr, relation, slot, oxid, csn, &hint,
+									 batch);
+	}
+
+	if (batch)
+	{
+		o_secondary_batch_flush(batch, oxid, csn);
+		pfree(batch);
+	}
+	if (items)
+		pfree(items);
+}
+
+/*
+ * Bulk load of the table by COPY.  Instead of inserting each batch, the
+ * tuples are accumulated in the tuplesort by the primary key, and inserted at
+ * the end of COPY in the key order.  So, every insertion goes to the same or
+ * the next leaf page as the previous one, and the right edge split (see
+ * orioledb.enable_optimized_split) leaves the pages full.  The regular
+ * insertion path keeps WAL, undo and the unique checks as is.
+ */
+typedef struct
+{
+	Oid			relid;
+	SubTransactionId subid;
+	MemoryContext mcxt;
+	Tuplesortstate *sortstate;
+} OBulkLoad;
+
+/* Bulk loads in progress, allocated in the TopTransactionContext */
+static List *bulk_loads = NIL;
+
+static OBulkLoad *
+o_bulk_load_find(Oid relid)
+{
+	ListCell   *lc;
+
+	foreach(lc, bulk_loads)
+	{
+		OBulkLoad  *load = (OBulkLoad *) lfirst(lc);
+
+		if (load->relid == relid)
+			return load;
+	}
+	return NULL;
+}
+
+/*
+ * Checks if the tuples inserted by COPY could be deferred to the sorted bulk
+ * load.  Triggers might read the table before the end of COPY, so they would
+ * miss the deferred tuples.
+ */
+bool
+o_tbl_bulk_load_allowed(OTableDescr *descr, Relation relation)
+{
+	return enable_bulk_load_sort &&
+		relation->trigdesc == NULL &&
+		!GET_PRIMARY(descr)->primaryIsCtid;
+}
+
+/*
+ * Puts the batch of tuples into the tuplesort of the table bulk load.
+ */
+void
+o_tbl_bulk_load_put(OTableDescr *descr, Relation relation,
+					TupleTableSlot **slots, int ntuples)
+{
+	OIndexDescr *primary = GET_PRIMARY(descr);
+	OBulkLoad  *load;
+	MemoryContext oldcxt;
+	int			i;
+
+	load = o_bulk_load_find(RelationGetRelid(relation));
+	if (load == NULL)
+	{
+		oldcxt = MemoryContextSwitchTo(TopTransactionContext);
+		load = (OBulkLoad *) palloc(sizeof(OBulkLoad));
+		load->relid = RelationGetRelid(relation);
+		load->subid = GetCurrentSubTransactionId();
+		load->mcxt = AllocSetContextCreate(TopTransactionContext,
+										   "orioledb bulk load",
+										   ALLOCSET_DEFAULT_SIZES);
+		bulk_loads = lappend(bulk_loads, load);
+		MemoryContextSwitchTo(load->mcxt);
+		load->sortstate = tuplesort_begin_orioledb_bulk_load(primary,
+															 maintenance_work_mem);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	for (i = 0; i < ntuples; i++)
+	{
+		TupleTableSlot *slot = slots[i];
+		OTuple		tup;
+
+		if (slot->tts_ops != descr->newTuple->tts_ops)
+		{
+			ExecCopySlot(descr->newTuple, slot);
+			slot = descr->newTuple;
+		}
+
+		/* The values are toasted on the actual insertion */
+		tts_orioledb_detoast(slot);
+		tup = tts_orioledb_form_orphan_tuple(slot, descr);
+		tuplesort_putotuple(load->sortstate, tup);
+		pfree(tup.data);
+	}
+}
+
+/*
+ * Inserts the sorted tuples of the table bulk load, if any.  Called at the end
+ * of COPY.
+ */
+void
+o_tbl_bulk_load_finish(OTableDescr *descr, Relation relation)
+{
+	OBulkLoad  *load;
+	TupleTableSlot *primarySlot,
+			   *slot;
+	OSecondaryBatch *batch;
+	BTreeLocationHint hint = {OInvalidInMemoryBlkno, 0};
+	CommitSeqNo csn;
+	OXid		oxid;
+	OTuple		tup;
+
+	load = o_bulk_load_find(RelationGetRelid(relation));
+	if (load == NULL)
+		return;
+
+	o_btree_load_shmem(&GET_PRIMARY(descr)->desc);
+	fill_current_oxid_csn(&oxid, &csn);
+
+	primarySlot = MakeSingleTupleTableSlot(descr->tupdesc, &TTSOpsOrioleDB);
+	slot = MakeSingleTupleTableSlot(descr->tupdesc, &TTSOpsVirtual);
+	batch = o_secondary_batch_create(descr);
+
+	tuplesort_performsort(load->sortstate);
+
+	while (true)
+	{
+		tup = tuplesort_getotuple(load->sortstate, true);
+		if (O_TUPLE_IS_NULL(tup))
+			break;
+
+		tts_orioledb_store_tuple(primarySlot, tup, descr,
+								 COMMITSEQNO_INPROGRESS, PrimaryIndexNumber,
+								 false, NULL);
+		ExecCopySlot(slot, primarySlot);
+		ExecClearTuple(primarySlot);
+
+		(void) o_tbl_insert_internal(descr, relation, slot, oxid, csn, &hint,
+									 batch);
+		ExecClearTuple(slot);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if (batch)
+	{
+		o_secondary_batch_flush(batch, oxid, csn);
+		pfree(batch);
+	}
+
+	ExecDropSingleTupleTableSlot(primarySlot);
+	ExecDropSingleTupleTableSlot(slot);
+
+	tuplesort_end(load->sortstate);
+	MemoryContextDelete(load->mcxt);
+	bulk_loads = list_delete_ptr(bulk_loads, load);
+	pfree(load);
+}
+
+/*
+ * Forgets the bulk loads of the aborted (sub)transaction.  Their memory is
+ * freed with the transaction memory, and temporary files are closed by the
+ * resource owner.
+ */
+void
+o_tbl_bulk_load_cleanup(SubTransactionId subid)
+{
+	ListCell   *lc;
+
+	if (subid == InvalidSubTransactionId)
+	{
+		bulk_loads = NIL;
+		return;
+	}
+
+	foreach(lc, bulk_loads)
+	{
+		OBulkLoad  *load = (OBulkLoad *) lfirst(lc);
+
+		if (load->subid == subid)
+		{
+			MemoryContextDelete(load->mcxt);
+			bulk_loads = foreach_delete_current(bulk_loads, lc);
+		}
+	}
+}
+
 static RowLockMode
 tuple_lock_mode_to_row_lock_mode(LockTupleMode mode)
 {
@@ -332,7 +901,7 @@ o_tbl_insert_with_arbiter(Relation rel,
 
 			ioc_arg.conflictIxNum = i;
 			result = o_tbl_index_insert(descr, descr->indices[i], slot,
-										oxid, csn, &callbackInfo);
+										oxid, csn, NULL, &callbackInfo);
 			if (result != OBTreeModifyResultInserted)
 			{
 				success = false;
@@ -351,7 +920,7 @@ o_tbl_insert_with_arbiter(Relation rel,
 
 			ioc_arg.conflictIxNum = -1;
 			result = o_tbl_index_insert(descr, descr->indices[i], slot,
-										oxid, csn, &callbackInfo);
+										oxid, csn, NULL, &callbackInfo);
 			if (result != OBTreeModifyResultInserted)
 			{
 				success = false;
@@ -579,7 +1148,9 @@ o_tbl_update(OTableDescr *descr, TupleTableSlot *slot,
 			{
 				OTuple		final_tup = tts_orioledb_form_tuple(slot, descr);
 
-				o_wal_update(&primary->desc, final_tup);
+				o_wal_update_delta(&primary->desc,
+								   ((OTableSlot *) oldSlot)->tuple,
+								   final_tup);
 			}
 		}
 		else if (mres.action == BTreeOperationDelete)
@@ -688,7 +1259,18 @@ o_is_index_predicate_satisfied(OIndexDescr *idx, TupleTableSlot *slot,
 	bool		result = true;
 
 	/* Check for partial index */
-	if (idx->predicate != NIL)
+	if (idx->nPredicateNullTests > 0)
+	{
+		int			i;
+
+		for (i = 0; i < idx->nPredicateNullTests; i++)
+		{
+			if (slot_attisnull(slot, idx->predicateNullTestAttnums[i]) !=
+				idx->predicateNullTestIsNull[i])
+				return false;
+		}
+	}
+	else if (idx->predicate != NIL)
 	{
 		econtext->ecxt_scantuple = slot;
 		/* Skip this index-update if the predicate isn't satisfied */
@@ -1047,6 +1629,7 @@ o_tbl_index_insert(OTableDescr *descr,
 				   OIndexDescr *id,
 				   TupleTableSlot *slot,
 				   OXid oxid, CommitSeqNo csn,
+				   BTreeLocationHint *hint,
 				   BTreeModifyCallbackInfo *callbackInfo)
 {
 	BTreeDescr *bd = &id->desc;
@@ -1078,7 +1661,8 @@ o_tbl_index_insert(OTableDescr *descr,
 									tup, BTreeKeyLeafTuple,
 									(Pointer) &knew, BTreeKeyBound,
 									oxid, csn, RowLockUpdate,
-									NULL, callbackInfo) == OBTreeModifyResultInserted;
+									primary ? hint : NULL,
+									callbackInfo) == OBTreeModifyResultInserted;
 		else
 			result = o_btree_insert_unique(bd, tup, BTreeKeyLeafTuple,
 										   (Pointer) &knew, BTreeKeyBound,
@@ -1101,6 +1685,8 @@ static OTableModifyResult
 o_tbl_indices_insert(TupleTableSlot *slot,
 					 OTableDescr *descr,
 					 OXid oxid, CommitSeqNo csn,
+					 BTreeLocationHint *hint,
+					 OSecondaryBatch *batch,
 					 BTreeModifyCallbackInfo *callbackInfo)
 {
 	OTableModifyResult result;
@@ -1110,8 +1696,26 @@ o_tbl_indices_insert(TupleTableSlot *slot,
 
 	for (i = 0; i < descr->nIndices; i++)
 	{
+		OIndexDescr *id = descr->indices[i];
+
+		/* Unique checks can't be deferred */
+		if (batch && i != PrimaryIndexNumber && !id->unique)
+		{
+			if (o_is_index_predicate_satisfied(id, slot, id->econtext))
+			{
+				OSecondaryBatchItem *item = &batch->items[batch->nitems++];
+
+				item->ixnum = i;
+				item->tuple = tts_orioledb_make_secondary_tuple(slot, id, true);
+				o_btree_check_size_of_tuple(o_tuple_size(item->tuple, &id->leafSpec),
+											id->name.data, true);
+			}
+			continue;
+		}
+
 		result.success = (o_tbl_index_insert(descr, descr->indices[i], slot,
-											 oxid, csn, callbackInfo) == OBTreeModifyResultInserted);
+											 oxid, csn, hint,
+											 callbackInfo) == OBTreeModifyResultInserted);
 		if (!result.success)
 		{
 			result.failedIxNum = i;
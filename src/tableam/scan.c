@@ -16,16 +16,20 @@
 #include "orioledb.h"
 
 #include "btree/iterator.h"
+#include "btree/page_contents.h"
 #include "btree/scan.h"
+#include "checkpoint/checkpoint.h"
 #include "recovery/recovery.h"
 #include "tableam/bitmap_scan.h"
 #include "tableam/descr.h"
 #include "tableam/handler.h"
 #include "tableam/index_scan.h"
 #include "tableam/scan.h"
+#include "tableam/summary.h"
 #include "tuple/slot.h"
 #include "utils/stopevent.h"
 
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/table.h"
 #include "common/hashfn.h"
@@ -101,6 +105,17 @@ static void o_end_custom_scan(CustomScanState *node);
 static void o_rescan_custom_scan(CustomScanState *node);
 static void o_explain_custom_scan(CustomScanState *node, List *ancestors,
 								  ExplainState *es);
+static Size o_estimate_dsm_custom_scan(CustomScanState *node,
+									   ParallelContext *pcxt);
+static void o_initialize_dsm_custom_scan(CustomScanState *node,
+										 ParallelContext *pcxt,
+										 void *coordinate);
+static void o_reinitialize_dsm_custom_scan(CustomScanState *node,
+										   ParallelContext *pcxt,
+										   void *coordinate);
+static void o_initialize_worker_custom_scan(CustomScanState *node,
+											shm_toc *toc,
+											void *coordinate);
 static Node *o_create_custom_scan_state(CustomScan *cscan);
 
 static CustomPathMethods o_path_methods =
@@ -124,10 +139,10 @@ static CustomExecMethods o_scan_exec_methods =
 	o_rescan_custom_scan,
 	NULL,
 	NULL,
-	NULL,
-	NULL,
-	NULL,
-	NULL,
+	o_estimate_dsm_custom_scan,
+	o_initialize_dsm_custom_scan,
+	o_reinitialize_dsm_custom_scan,
+	o_initialize_worker_custom_scan,
 	NULL,
 	o_explain_custom_scan
 };
@@ -144,6 +159,148 @@ is_o_custom_scan_state(CustomScanState *scan)
 	return scan->methods == &o_scan_exec_methods;
 }
 
+/*
+ * CPU cost of decompressing a page of a compressed tree read from disk.
+ */
+#define O_DECOMPRESS_PAGE_COST	(cpu_operator_cost * (ORIOLEDB_BLCKSZ / 64))
+
+/*
+ * Estimates the cost of accessing a tree page given the cost of reading it
+ * from disk.  Pages resident in the page pool are accessed without IO, while
+ * pages of compressed trees also should be decompressed after reading.
+ */
+Cost
+o_tree_page_cost(BTreeDescr *desc, ORelOids *oids, Cost page_cost)
+{
+	BTreeMetaPage *meta;
+	uint32		leafPages;
+	uint32		residentPages;
+	double		missFraction;
+
+	if (!tbl_data_exists(oids))
+		return 0.0;
+
+	o_btree_load_shmem(desc);
+	meta = BTREE_GET_META(desc);
+	leafPages = pg_atomic_read_u32(&meta->leafPagesNum);
+	residentPages = pg_atomic_read_u32(&meta->numResidentPages);
+
+	if (residentPages >= leafPages)
+		return 0.0;
+	missFraction = 1.0 - (double) residentPages / (double) leafPages;
+
+	if (OCompressIsValid(desc->compress))
+		page_cost += O_DECOMPRESS_PAGE_COST;
+
+	return missFraction * page_cost;
+}
+
+/*
+ * Corrects the IO part of the path cost.  PostgreSQL heap cost formulas
+ * charge every page access with the tablespace page cost and assume a
+ * separate heap to visit after the index.  OrioleDB primary index is the
+ * table itself, and the page access cost depends on the residency of the
+ * tree in the page pool (see o_tree_page_cost()).
+ */
+static void
+o_adjust_path_io_cost(PlannerInfo *root, Path *path, OTableDescr *descr)
+{
+	RelOptInfo *rel = path->parent;
+	OIndexDescr *primary = GET_PRIMARY(descr);
+	double		spc_random_page_cost;
+	double		spc_seq_page_cost;
+	Cost		old_io_cost;
+	Cost		new_io_cost;
+	Cost		min_cost;
+
+	get_tablespace_page_costs(rel->reltablespace,
+							  &spc_random_page_cost,
+							  &spc_seq_page_cost);
+
+	if (IsA(path, IndexPath))
+	{
+		IndexPath  *ix_path = (IndexPath *) path;
+		IndexOptInfo *index = ix_path->indexinfo;
+		OIndexDescr *index_descr = NULL;
+		double		index_pages;
+		double		heap_pages;
+		int			i;
+
+		for (i = 0; i < descr->nIndices; i++)
+		{
+			if (descr->indices[i]->oids.reloid == index->indexoid)
+			{
+				index_descr = descr->indices[i];
+				break;
+			}
+		}
+		if (!index_descr)
+			return;
+
+		index_pages = ceil(ix_path->indexselectivity * index->pages);
+		heap_pages = index_pages_fetched(clamp_row_est(ix_path->indexselectivity *
+													   rel->tuples),
+										 rel->pages, (double) index->pages,
+										 root);
+		old_io_cost = (index_pages + heap_pages) * spc_random_page_cost;
+
+		if (index_descr == primary)
+		{
+			/* No heap to visit: the primary tree holds the tuples */
+			new_io_cost = heap_pages *
+				o_tree_page_cost(&primary->desc, &primary->oids,
+								 spc_random_page_cost);
+		}
+		else
+		{
+			new_io_cost = index_pages *
+				o_tree_page_cost(&index_descr->desc, &index_descr->oids,
+								 spc_random_page_cost) +
+				heap_pages *
+				o_tree_page_cost(&primary->desc, &primary->oids,
+								 spc_random_page_cost);
+		}
+	}
+	else if (IsA(path, BitmapHeapPath))
+	{
+		BitmapHeapPath *bitmap_path = (BitmapHeapPath *) path;
+		Cost		index_cost;
+		double		tuples;
+		double		heap_pages;
+
+		heap_pages = compute_bitmap_pages(root, rel, bitmap_path->bitmapqual,
+										  1, &index_cost, &tuples);
+		old_io_cost = heap_pages * spc_random_page_cost;
+		new_io_cost = heap_pages *
+			o_tree_page_cost(&primary->desc, &primary->oids,
+							 spc_random_page_cost);
+	}
+	else
+	{
+		Assert(IsA(path, Path));
+		old_io_cost = rel->pages * spc_seq_page_cost;
+		new_io_cost = rel->pages *
+			o_tree_page_cost(&primary->desc, &primary->oids,
+							 spc_seq_page_cost);
+	}
+
+	if (new_io_cost >= old_io_cost)
+	{
+		path->total_cost += new_io_cost - old_io_cost;
+		return;
+	}
+
+	/*
+	 * The formulas above don't account for the repeated scans of the
+	 * parameterized paths, so never go below the CPU cost of returning the
+	 * tuples.
+	 */
+	min_cost = Min(path->total_cost,
+				   path->startup_cost + path->rows * cpu_tuple_cost);
+	path->total_cost = Max(path->total_cost - (old_io_cost - new_io_cost),
+						   min_cost);
+}
+
 static Path *
 transform_path(Path *src_path, OTableDescr *descr)
 {
@@ -206,6 +363,56 @@ transform_path(Path *src_path, OTableDescr *descr)
 	return &result->path;
 }
 
+/*
+ * Makes the parallel version of the forward index scan path.  The parallel
+ * workers split the key range by the downlinks of the index (see
+ * parallel_index_claim_chunk()).  Each worker returns tuples in the index
+ * order, so the path keeps its pathkeys for Gather Merge.
+ */
+static void
+add_partial_index_path(RelOptInfo *rel, Path *custom_path, IndexPath *ix_path)
+{
+	CustomPath *result;
+	int			parallel_workers;
+	double		parallel_divisor;
+	double		leader_contribution;
+	Cost		run_cost;
+
+	if (!rel->consider_parallel || rel->lateral_relids != NULL ||
+		custom_path->param_info != NULL ||
+		ix_path->indexscandir != ForwardScanDirection ||
+		max_parallel_workers_per_gather <= 0)
+		return;
+
+	parallel_workers = compute_parallel_worker(rel,
+											   rel->pages * ix_path->indexselectivity,
+											   -1,
+											   max_parallel_workers_per_gather);
+	if (parallel_workers <= 0)
+		return;
+
+	/* The same as get_parallel_divisor() */
+	parallel_divisor = parallel_workers;
+	if (parallel_leader_participation)
+	{
+		leader_contribution = 1.0 - (0.3 * parallel_workers);
+		if (leader_contribution > 0)
+			parallel_divisor += leader_contribution;
+	}
+
+	result = makeNode(CustomPath);
+	memcpy(result, custom_path, sizeof(CustomPath));
+	result->path.parallel_aware = true;
+	result->path.parallel_safe = true;
+	result->path.parallel_workers = parallel_workers;
+	result->path.rows = clamp_row_est(custom_path->rows / parallel_divisor);
+	run_cost = custom_path->total_cost - custom_path->startup_cost;
+	result->path.total_cost = custom_path->startup_cost +
+		run_cost / parallel_divisor;
+
+	add_partial_path(rel, &result->path);
+}
+
 bool
 orioledb_set_plain_rel_pathlist_hook(PlannerInfo *root, RelOptInfo *rel,
 									 RangeTblEntry *rte)
@@ -339,6 +546,27 @@ orioledb_set_rel_pathlist_hook(PlannerInfo *root, RelOptInfo *rel,
 			descr = relation_get_descr(relation);
 			Assert(descr != NULL);
 
+			/*
+			 * Partial bitmap heap paths are executed by the parallel aware
+			 * custom scan.  Partial sequential scans are handled by the table
+			 * access method.
+			 */
+			for (i = 0; i < list_length(rel->partial_pathlist); i++)
+			{
+				Path	   *path = list_nth(rel->partial_pathlist, i);
+
+				if (IsA(path, BitmapHeapPath))
+				{
+					o_adjust_path_io_cost(root, path, descr);
+					lfirst(list_nth_cell(rel->partial_pathlist, i)) =
+						transform_path(path, descr);
+				}
+				else if (IsA(path, Path))
+				{
+					o_adjust_path_io_cost(root, path, descr);
+				}
+			}
+
 			/*
 			 * transform all postgres scans to custom scans
 			 */
@@ -365,6 +593,8 @@ orioledb_set_rel_pathlist_hook(PlannerInfo *root, RelOptInfo *rel,
 										  "bug report."));
 					}
 
+					o_adjust_path_io_cost(root, path, descr);
+
 					if (!IsA(path, Path))
 						rel->pathlist = list_delete_nth_cell(rel->pathlist, i);
 					else
@@ -376,6 +606,10 @@ orioledb_set_rel_pathlist_hook(PlannerInfo *root, RelOptInfo *rel,
 						rel->pathlist = list_insert_nth(rel->pathlist, i,
 														custom_path);
 						i++;
+
+						if (IsA(path, IndexPath) && path->parallel_safe)
+							add_partial_index_path(rel, custom_path,
+												   (IndexPath *) path);
 					}
 				}
 				else
@@ -383,6 +617,8 @@ orioledb_set_rel_pathlist_hook(PlannerInfo *root, RelOptInfo *rel,
 					i++;
 				}
 			}
+
+			o_add_summary_scan_path(root, rel, rte, descr);
 		}
 
 		if (relation != NULL)
@@ -522,6 +758,9 @@ o_create_custom_scan_state(CustomScan *cscan)
 		ix_plan_state->ostate.ixNum = intVal(lsecond(cscan->custom_private));
 		ix_plan_state->ostate.scanDir = intVal(lthird(cscan->custom_private));
 		ix_plan_state->ostate.iterator = NULL;
+		ix_plan_state->ostate.lookup = NULL;
+		ix_plan_state->ostate.prefetchTuples = NULL;
+		ix_plan_state->ostate.prefetchCsns = NULL;
 		ix_plan_state->ostate.curKeyRangeIsLoaded = false;
 		ix_plan_state->ostate.curKeyRange.empty = true;
 		ix_plan_state->ostate.curKeyRange.low.n_row_keys = 0;
@@ -756,9 +995,16 @@ o_rescan_custom_scan(CustomScanState *node)
 		OIndexPlanState *ix_plan_state =
 			(OIndexPlanState *) ocstate->o_plan_state;
 
+		o_index_scan_batch_reset(&ix_plan_state->ostate);
 		if (node->ss.ps.chgParam != NULL)
 		{
 			MemoryContextReset(ix_plan_state->ostate.cxt);
+			ix_plan_state->ostate.lookup = NULL;
+			ix_plan_state->ostate.prefetchTuples = NULL;
+			ix_plan_state->ostate.prefetchCsns = NULL;
+			ix_plan_state->ostate.prefetchResults = NULL;
+			ix_plan_state->ostate.prefetchHints = NULL;
+			ix_plan_state->ostate.primaryLookup = NULL;
 		}
 		else if (ix_plan_state->ostate.iterator != NULL)
 		{
@@ -772,6 +1018,7 @@ o_rescan_custom_scan(CustomScanState *node)
 		ix_plan_state->ostate.curKeyRange.high.n_row_keys = 0;
 		ix_plan_state->ostate.iterator = NULL;
 		ix_plan_state->ostate.scandesc = NULL;
+		ix_plan_state->ostate.parallelSerial = false;
 	}
 	else if (ocstate->o_plan_state->type == O_BitmapHeapPlan)
 	{
@@ -826,6 +1073,81 @@ o_end_custom_scan(CustomScanState *node)
 	ea_counters = NULL;
 }
 
+/*
+ * Parallel scan support.  Index plans share OParallelIndexScanData, bitmap
+ * plans share OParallelBitmapScanData.
+ */
+static Size
+o_estimate_dsm_custom_scan(CustomScanState *node, ParallelContext *pcxt)
+{
+	OCustomScanState *ocstate = (OCustomScanState *) node;
+
+	if (ocstate->o_plan_state->type == O_BitmapHeapPlan)
+		return sizeof(OParallelBitmapScanData);
+	return sizeof(OParallelIndexScanData);
+}
+
+static void
+o_initialize_dsm_custom_scan(CustomScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	OCustomScanState *ocstate = (OCustomScanState *) node;
+
+	if (ocstate->o_plan_state->type == O_BitmapHeapPlan)
+	{
+		OBitmapHeapPlanState *bitmap_state;
+
+		bitmap_state = (OBitmapHeapPlanState *) ocstate->o_plan_state;
+		o_parallel_bitmap_scan_init((OParallelBitmapScan) coordinate);
+		bitmap_state->pscan = (OParallelBitmapScan) coordinate;
+	}
+	else
+	{
+		OIndexPlanState *ix_plan_state;
+
+		Assert(ocstate->o_plan_state->type == O_IndexPlan);
+		ix_plan_state = (OIndexPlanState *) ocstate->o_plan_state;
+		o_parallel_index_scan_init((OParallelIndexScan) coordinate);
+		ix_plan_state->ostate.pscan = (OParallelIndexScan) coordinate;
+	}
+}
+
+static void
+o_reinitialize_dsm_custom_scan(CustomScanState *node, ParallelContext *pcxt,
+							   void *coordinate)
+{
+	OCustomScanState *ocstate = (OCustomScanState *) node;
+
+	if (ocstate->o_plan_state->type == O_BitmapHeapPlan)
+		o_parallel_bitmap_scan_reinit((OParallelBitmapScan) coordinate,
+									  node->ss.ps.state->es_query_dsa);
+	else
+		o_parallel_index_scan_init((OParallelIndexScan) coordinate);
+}
+
+static void
+o_initialize_worker_custom_scan(CustomScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	OCustomScanState *ocstate = (OCustomScanState *) node;
+
+	if (ocstate->o_plan_state->type == O_BitmapHeapPlan)
+	{
+		OBitmapHeapPlanState *bitmap_state;
+
+		bitmap_state = (OBitmapHeapPlanState *) ocstate->o_plan_state;
+		bitmap_state->pscan = (OParallelBitmapScan) coordinate;
+	}
+	else
+	{
+		OIndexPlanState *ix_plan_state;
+
+		Assert(ocstate->o_plan_state->type == O_IndexPlan);
+		ix_plan_state = (OIndexPlanState *) ocstate->o_plan_state;
+		ix_plan_state->ostate.pscan = (OParallelIndexScan) coordinate;
+	}
+}
+
 typedef struct OExplainContext
 {
 	List	   *ancestors;
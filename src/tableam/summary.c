@@ -0,0 +1,575 @@
+/*-------------------------------------------------------------------------
+ *
+ * summary.c
+ *		Min/max summaries of OrioleDB table columns.
+ *
+ * The summary splits the primary key space of the table into up to
+ * O_SUMMARY_MAX_ZONES key ranges ("zones") and keeps the minimum and the
+ * maximum value of the summarized column for each of them.  Sequential scans
+ * check the key range of each leaf downlink against the summary and skip the
+ * leaves, which can't contain the values matching the scan conditions.  That
+ * works for both in-memory and on-disk leaves, the latter aren't even read.
+ *
+ * Zones are defined by the primary key ranges, not by the pages.  So, page
+ * splits and merges need no summary maintenance, while inserts and updates
+ * have to widen the zone containing the new tuple (see o_summary_add_tuple()
+ * called from o_btree_modify()).  The summary is never narrowed: deleted
+ * tuples and aborted modifications only make it less precise.
+ *
+ * The summary is built by orioledb_tbl_summarize() holding ShareLock on the
+ * table, so there are no concurrent modifications.  The build sees all the
+ * committed tuples, but snapshots taken before the build might see the
+ * tuple versions, which were already replaced.  So, the summary is only
+ * used by the snapshots not older than validCsn.
+ *
+ * Summaries live in shared memory only and are lost on restart.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/tableam/summary.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/iterator.h"
+#include "tableam/descr.h"
+#include "tableam/summary.h"
+#include "tuple/format.h"
+
+#include "access/transam.h"
+#include "catalog/pg_type_d.h"
+#include "storage/lwlock.h"
+#include "utils/date.h"
+#include "utils/timestamp.h"
+
+typedef struct
+{
+	pg_atomic_uint64 minValue;
+	pg_atomic_uint64 maxValue;
+	/* Zero length means the unbounded lower side of the first zone */
+	uint16		keyLen;
+	uint8		keyFlags;
+	uint64		key[O_SUMMARY_MAX_KEY_SIZE / sizeof(uint64)];
+} OSummaryZone;
+
+typedef struct
+{
+	/* InvalidOid datoid if the slot is free */
+	ORelOids	tableOids;
+	/* The primary tree */
+	ORelOids	oids;
+	uint64		generation;
+	AttrNumber	attnum;
+	Oid			typid;
+	CommitSeqNo validCsn;
+	int			nzones;
+	OSummaryZone zones[O_SUMMARY_MAX_ZONES];
+} OSummary;
+
+typedef struct
+{
+	int			trancheId;
+	LWLock		lock;
+	pg_atomic_uint32 numSummaries;
+	uint64		lastGeneration;
+} OSummariesMeta;
+
+typedef struct
+{
+	int64		minValue;
+	int64		maxValue;
+	uint64		count;
+	uint16		keyLen;
+	uint8		keyFlags;
+	uint64		key[O_SUMMARY_MAX_KEY_SIZE / sizeof(uint64)];
+} OSummaryBuildZone;
+
+static OSummariesMeta *summaries_meta = NULL;
+static OSummary *summaries = NULL;
+
+Size
+o_summaries_shmem_needs(void)
+{
+	if (max_summaries == 0)
+		return 0;
+
+	return add_size(CACHELINEALIGN(sizeof(OSummariesMeta)),
+					mul_size(sizeof(OSummary), max_summaries));
+}
+
+void
+o_summaries_shmem_init(Pointer ptr, bool found)
+{
+	int			i;
+
+	if (max_summaries == 0)
+		return;
+
+	summaries_meta = (OSummariesMeta *) ptr;
+	summaries = (OSummary *) (ptr + CACHELINEALIGN(sizeof(OSummariesMeta)));
+
+	if (!found)
+	{
+		summaries_meta->trancheId = LWLockNewTrancheId();
+		LWLockInitialize(&summaries_meta->lock, summaries_meta->trancheId);
+		pg_atomic_init_u32(&summaries_meta->numSummaries, 0);
+		summaries_meta->lastGeneration = 0;
+		for (i = 0; i < max_summaries; i++)
+			summaries[i].tableOids.datoid = InvalidOid;
+	}
+	LWLockRegisterTranche(summaries_meta->trancheId, "OrioleDBSummaries");
+}
+
+/*
+ * Summaries are supported for the types, which values are integers ordered
+ * the same way as the type values are.
+ */
+bool
+o_summary_type_supported(Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+int64
+o_summary_datum_get_int64(Datum value, Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+			return DatumGetInt16(value);
+		case INT4OID:
+			return DatumGetInt32(value);
+		case DATEOID:
+			return DatumGetDateADT(value);
+		case INT8OID:
+			return DatumGetInt64(value);
+		case TIMESTAMPOID:
+			return DatumGetTimestamp(value);
+		case TIMESTAMPTZOID:
+			return DatumGetTimestampTz(value);
+		default:
+			elog(ERROR, "unsupported summary type %u", typid);
+	}
+	return 0;					/* keep compiler quiet */
+}
+
+static OSummary *
+find_summary(ORelOids oids)
+{
+	int			i;
+
+	for (i = 0; i < max_summaries; i++)
+	{
+		if (OidIsValid(summaries[i].tableOids.datoid) &&
+			ORelOidsIsEqual(summaries[i].oids, oids))
+			return &summaries[i];
+	}
+	return NULL;
+}
+
+/*
+ * Finds the slot of the summary of the table, including the stale summary of
+ * its previous relnode, or the free slot.
+ */
+static OSummary *
+find_summary_slot(ORelOids oids)
+{
+	OSummary   *freeSlot = NULL;
+	int			i;
+
+	for (i = 0; i < max_summaries; i++)
+	{
+		if (summaries[i].tableOids.datoid == oids.datoid &&
+			summaries[i].tableOids.reloid == oids.reloid)
+			return &summaries[i];
+		if (!OidIsValid(summaries[i].tableOids.datoid) && freeSlot == NULL)
+			freeSlot = &summaries[i];
+	}
+	return freeSlot;
+}
+
+static void
+summary_check_enabled(void)
+{
+	if (max_summaries == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("column summaries are disabled"),
+				 errhint("Set orioledb.max_summaries to a positive value.")));
+}
+
+/*
+ * Returns the number of the zone containing the key.
+ */
+static int
+summary_find_zone(BTreeDescr *desc, OSummary *summary,
+				  Pointer key, BTreeKeyType keyType)
+{
+	int			lo = 0,
+				hi = summary->nzones - 1;
+
+	while (lo < hi)
+	{
+		int			mid = (lo + hi + 1) / 2;
+		OSummaryZone *zone = &summary->zones[mid];
+		OTuple		bound;
+
+		Assert(zone->keyLen > 0);
+		bound.data = (Pointer) zone->key;
+		bound.formatFlags = zone->keyFlags;
+		if (o_btree_cmp(desc, key, keyType, (Pointer) &bound,
+						BTreeKeyNonLeafKey) >= 0)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+static void
+summary_zone_widen(OSummaryZone *zone, int64 value)
+{
+	uint64		cur;
+
+	cur = pg_atomic_read_u64(&zone->minValue);
+	while ((int64) cur > value &&
+		   !pg_atomic_compare_exchange_u64(&zone->minValue, &cur,
+										   (uint64) value));
+
+	cur = pg_atomic_read_u64(&zone->maxValue);
+	while ((int64) cur < value &&
+		   !pg_atomic_compare_exchange_u64(&zone->maxValue, &cur,
+										   (uint64) value));
+}
+
+/*
+ * Halves the number of build zones by merging the neighbors.
+ */
+static int
+build_zones_merge(OSummaryBuildZone *zones, int nzones)
+{
+	int			i;
+
+	for (i = 0; i < nzones / 2; i++)
+	{
+		OSummaryBuildZone *left = &zones[2 * i],
+				   *right = &zones[2 * i + 1];
+
+		left->minValue = Min(left->minValue, right->minValue);
+		left->maxValue = Max(left->maxValue, right->maxValue);
+		left->count += right->count;
+		if (i > 0)
+			zones[i] = *left;
+	}
+	if (nzones % 2 == 1)
+		zones[nzones / 2] = zones[nzones - 1];
+	return (nzones + 1) / 2;
+}
+
+/*
+ * Builds the summary of the column `attnum` of the table.  The caller must
+ * hold the lock preventing the table modifications.
+ */
+void
+o_summary_build(OTableDescr *descr, AttrNumber attnum)
+{
+	OIndexDescr *primary = GET_PRIMARY(descr);
+	BTreeDescr *desc = &primary->desc;
+	Oid			typid = TupleDescAttr(descr->tupdesc, attnum - 1)->atttypid;
+	OSummaryBuildZone *zones;
+	OSummary   *summary;
+	BTreeIterator *it;
+	MemoryContext tupleCxt,
+				oldCxt;
+	CommitSeqNo validCsn;
+	uint64		perZone = 1;
+	int			nzones = 0;
+	int			i;
+
+	summary_check_enabled();
+	Assert(!primary->primaryIsCtid);
+	Assert(o_summary_type_supported(typid));
+
+	zones = palloc(sizeof(OSummaryBuildZone) * O_SUMMARY_MAX_ZONES);
+	tupleCxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "orioledb summary build tuples",
+									 ALLOCSET_DEFAULT_SIZES);
+
+	/* Snapshots taken from now on see nothing older than the build sees */
+	validCsn = pg_atomic_read_u64(&ShmemVariableCache->nextCommitSeqNo);
+
+	o_btree_load_shmem(desc);
+	it = o_btree_iterator_create(desc, NULL, BTreeKeyNone,
+								 COMMITSEQNO_INPROGRESS, ForwardScanDirection);
+	o_btree_iterator_set_tuple_ctx(it, tupleCxt);
+
+	while (true)
+	{
+		OTuple		tuple;
+		Datum		value;
+		bool		isnull;
+
+		CHECK_FOR_INTERRUPTS();
+		tuple = o_btree_iterator_fetch(it, NULL, NULL, BTreeKeyNone,
+									   true, NULL);
+		if (O_TUPLE_IS_NULL(tuple))
+			break;
+
+		if (nzones > 0 && zones[nzones - 1].count >= perZone)
+		{
+			OTuple		key;
+			bool		allocated;
+			int			keyLen;
+
+			oldCxt = MemoryContextSwitchTo(tupleCxt);
+			key = o_btree_tuple_make_key(desc, tuple, NULL, false, &allocated);
+			MemoryContextSwitchTo(oldCxt);
+			keyLen = o_btree_len(desc, key, OKeyLength);
+
+			/* Too long keys just make the current zone larger */
+			if (keyLen <= O_SUMMARY_MAX_KEY_SIZE)
+			{
+				if (nzones == O_SUMMARY_MAX_ZONES)
+				{
+					nzones = build_zones_merge(zones, nzones);
+					perZone *= 2;
+				}
+				zones[nzones].minValue = PG_INT64_MAX;
+				zones[nzones].maxValue = PG_INT64_MIN;
+				zones[nzones].count = 0;
+				zones[nzones].keyLen = keyLen;
+				zones[nzones].keyFlags = key.formatFlags;
+				memcpy(zones[nzones].key, key.data, keyLen);
+				nzones++;
+			}
+		}
+		else if (nzones == 0)
+		{
+			zones[0].minValue = PG_INT64_MAX;
+			zones[0].maxValue = PG_INT64_MIN;
+			zones[0].count = 0;
+			zones[0].keyLen = 0;
+			nzones = 1;
+		}
+
+		value = o_fastgetattr(tuple, attnum, primary->leafTupdesc,
+							  &primary->leafSpec, &isnull);
+		if (!isnull)
+		{
+			int64		v = o_summary_datum_get_int64(value, typid);
+
+			zones[nzones - 1].minValue = Min(zones[nzones - 1].minValue, v);
+			zones[nzones - 1].maxValue = Max(zones[nzones - 1].maxValue, v);
+		}
+		zones[nzones - 1].count++;
+		MemoryContextReset(tupleCxt);
+	}
+	btree_iterator_free(it);
+	MemoryContextDelete(tupleCxt);
+
+	/* Empty table still needs a zone to be widened by the inserts */
+	if (nzones == 0)
+	{
+		zones[0].minValue = PG_INT64_MAX;
+		zones[0].maxValue = PG_INT64_MIN;
+		zones[0].keyLen = 0;
+		nzones = 1;
+	}
+	/* The first zone covers everything below the second one */
+	zones[0].keyLen = 0;
+
+	LWLockAcquire(&summaries_meta->lock, LW_EXCLUSIVE);
+	summary = find_summary_slot(descr->oids);
+	if (summary == NULL)
+	{
+		LWLockRelease(&summaries_meta->lock);
+		ereport(ERROR,
+				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+				 errmsg("out of column summaries"),
+				 errhint("Increase orioledb.max_summaries.")));
+	}
+
+	if (!OidIsValid(summary->tableOids.datoid))
+		pg_atomic_fetch_add_u32(&summaries_meta->numSummaries, 1);
+	summary->tableOids = descr->oids;
+	summary->oids = primary->desc.oids;
+	summary->generation = ++summaries_meta->lastGeneration;
+	summary->attnum = attnum;
+	summary->typid = typid;
+	summary->validCsn = validCsn;
+	summary->nzones = nzones;
+	for (i = 0; i < nzones; i++)
+	{
+		OSummaryZone *zone = &summary->zones[i];
+
+		pg_atomic_init_u64(&zone->minValue, (uint64) zones[i].minValue);
+		pg_atomic_init_u64(&zone->maxValue, (uint64) zones[i].maxValue);
+		zone->keyLen = zones[i].keyLen;
+		zone->keyFlags = zones[i].keyFlags;
+		memcpy(zone->key, zones[i].key, zones[i].keyLen);
+	}
+	LWLockRelease(&summaries_meta->lock);
+
+	pfree(zones);
+}
+
+/*
+ * Drops the summary of the table if any.
+ */
+void
+o_summary_drop(OTableDescr *descr)
+{
+	OSummary   *summary;
+
+	summary_check_enabled();
+
+	LWLockAcquire(&summaries_meta->lock, LW_EXCLUSIVE);
+	summary = find_summary_slot(descr->oids);
+	if (summary != NULL && OidIsValid(summary->tableOids.datoid))
+	{
+		summary->tableOids.datoid = InvalidOid;
+		pg_atomic_fetch_sub_u32(&summaries_meta->numSummaries, 1);
+	}
+	LWLockRelease(&summaries_meta->lock);
+}
+
+/*
+ * Accounts the tuple just inserted into the primary tree in its summary.
+ */
+void
+o_summary_add_tuple(BTreeDescr *desc, OTuple tuple)
+{
+	OSummary   *summary;
+
+	if (max_summaries == 0 ||
+		desc->type != oIndexPrimary ||
+		pg_atomic_read_u32(&summaries_meta->numSummaries) == 0)
+		return;
+
+	LWLockAcquire(&summaries_meta->lock, LW_SHARED);
+	summary = find_summary(desc->oids);
+	if (summary != NULL && desc->arg != NULL)
+	{
+		OIndexDescr *primary = (OIndexDescr *) desc->arg;
+		Datum		value;
+		bool		isnull;
+
+		value = o_fastgetattr(tuple, summary->attnum, primary->leafTupdesc,
+							  &primary->leafSpec, &isnull);
+		if (!isnull)
+		{
+			int			zonenum;
+
+			zonenum = summary_find_zone(desc, summary, (Pointer) &tuple,
+										BTreeKeyLeafTuple);
+			summary_zone_widen(&summary->zones[zonenum],
+							   o_summary_datum_get_int64(value,
+														 summary->typid));
+		}
+	}
+	LWLockRelease(&summaries_meta->lock);
+}
+
+/*
+ * Finds the summary of the tree usable by the snapshot `csn`.
+ */
+bool
+o_summary_find(ORelOids oids, CommitSeqNo csn, OSummaryRef *ref)
+{
+	OSummary   *summary;
+	bool		result = false;
+
+	if (max_summaries == 0 ||
+		pg_atomic_read_u32(&summaries_meta->numSummaries) == 0)
+		return false;
+
+	LWLockAcquire(&summaries_meta->lock, LW_SHARED);
+	summary = find_summary(oids);
+	if (summary != NULL &&
+		(csn == COMMITSEQNO_INPROGRESS ||
+		 (COMMITSEQNO_IS_NORMAL(csn) && csn >= summary->validCsn)))
+	{
+		ref->slotnum = summary - summaries;
+		ref->generation = summary->generation;
+		ref->attnum = summary->attnum;
+		ref->typid = summary->typid;
+		result = true;
+	}
+	LWLockRelease(&summaries_meta->lock);
+
+	return result;
+}
+
+/*
+ * Checks if the key range [low, high) might contain column values within
+ * [minValue, maxValue].  Null bound means the unbounded side of the range.
+ * Also reports the fraction of the zones matching if `fraction` is given.
+ */
+bool
+o_summary_range_matches(BTreeDescr *desc, OSummaryRef *ref,
+						OTuple low, OTuple high,
+						int64 minValue, int64 maxValue,
+						double *fraction)
+{
+	OSummary   *summary = &summaries[ref->slotnum];
+	int			i,
+				matches = 0,
+				total = 0;
+
+	LWLockAcquire(&summaries_meta->lock, LW_SHARED);
+	if (!OidIsValid(summary->tableOids.datoid) ||
+		summary->generation != ref->generation)
+	{
+		LWLockRelease(&summaries_meta->lock);
+		if (fraction)
+			*fraction = 1.0;
+		return true;
+	}
+
+	i = O_TUPLE_IS_NULL(low) ? 0 :
+		summary_find_zone(desc, summary, (Pointer) &low, BTreeKeyNonLeafKey);
+	for (; i < summary->nzones; i++)
+	{
+		OSummaryZone *zone = &summary->zones[i];
+
+		if (total > 0 && !O_TUPLE_IS_NULL(high))
+		{
+			OTuple		bound;
+
+			bound.data = (Pointer) zone->key;
+			bound.formatFlags = zone->keyFlags;
+			if (o_btree_cmp(desc, (Pointer) &bound, BTreeKeyNonLeafKey,
+							(Pointer) &high, BTreeKeyNonLeafKey) >= 0)
+				break;
+		}
+		total++;
+
+		if ((int64) pg_atomic_read_u64(&zone->minValue) <= maxValue &&
+			(int64) pg_atomic_read_u64(&zone->maxValue) >= minValue)
+		{
+			matches++;
+			if (!fraction)
+				break;
+		}
+	}
+	LWLockRelease(&summaries_meta->lock);
+
+	if (fraction)
+		*fraction = total > 0 ? (double) matches / total : 1.0;
+	return matches > 0;
+}
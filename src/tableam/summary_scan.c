@@ -0,0 +1,494 @@
+/*-------------------------------------------------------------------------
+ *
+ * summary_scan.c
+ *		Sequential scan of OrioleDB tables skipping leaves by the column
+ *		summary.
+ *
+ * When the table has the column summary (see summary.c) and the scan
+ * conditions compare the summarized column with the expressions constant
+ * during the scan, the custom scan path is added.  The scan evaluates the
+ * expressions at the beginning, turns them into the range of the column
+ * values and skips the primary tree leaves, which summary excludes that
+ * range.  All the conditions are still checked for the returned tuples.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/tableam/summary_scan.c
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/scan.h"
+#include "tableam/descr.h"
+#include "tableam/handler.h"
+#include "tableam/summary.h"
+#include "tuple/slot.h"
+
+#include "access/stratnum.h"
+#include "catalog/pg_am_d.h"
+#include "commands/defrem.h"
+#include "commands/explain.h"
+#include "executor/executor.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/restrictinfo.h"
+#include "utils/lsyscache.h"
+
+typedef struct OSummaryScanState
+{
+	CustomScanState css;
+	/* The column summarized at the planning time */
+	AttrNumber	attnum;
+	List	   *strategies;
+	List	   *exprStates;
+	OTableDescr *descr;
+	BTreeSeqScan *scan;
+	OSummaryRef ref;
+	bool		useSummary;
+	bool		empty;
+	int64		minValue;
+	int64		maxValue;
+	uint64		rangesSkipped;
+} OSummaryScanState;
+
+static Plan *o_plan_summary_path(PlannerInfo *root, RelOptInfo *rel,
+								 CustomPath *best_path, List *tlist,
+								 List *clauses, List *custom_plans);
+static Node *o_create_summary_scan_state(CustomScan *cscan);
+static void o_begin_summary_scan(CustomScanState *node, EState *estate,
+								 int eflags);
+static TupleTableSlot *o_exec_summary_scan(CustomScanState *node);
+static void o_end_summary_scan(CustomScanState *node);
+static void o_rescan_summary_scan(CustomScanState *node);
+static void o_explain_summary_scan(CustomScanState *node, List *ancestors,
+								   ExplainState *es);
+
+static CustomPathMethods o_summary_path_methods =
+{
+	.CustomName = "o_summary_path",
+	.PlanCustomPath = o_plan_summary_path
+};
+
+CustomScanMethods o_summary_scan_methods =
+{
+	"o_summary_scan",
+	o_create_summary_scan_state
+};
+
+static CustomExecMethods o_summary_scan_exec_methods =
+{
+	.CustomName = "o_exec_summary_scan",
+	.BeginCustomScan = o_begin_summary_scan,
+	.ExecCustomScan = o_exec_summary_scan,
+	.EndCustomScan = o_end_summary_scan,
+	.ReScanCustomScan = o_rescan_summary_scan,
+	.ExplainCustomScan = o_explain_summary_scan
+};
+
+/*
+ * Narrows [*minValue, *maxValue] range by the "column <strategy> value"
+ * condition.  Returns false if no value matches.
+ */
+static bool
+summary_apply_condition(int strategy, int64 value,
+						int64 *minValue, int64 *maxValue)
+{
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			if (value == PG_INT64_MIN)
+				return false;
+			*maxValue = Min(*maxValue, value - 1);
+			break;
+		case BTLessEqualStrategyNumber:
+			*maxValue = Min(*maxValue, value);
+			break;
+		case BTEqualStrategyNumber:
+			*minValue = Max(*minValue, value);
+			*maxValue = Min(*maxValue, value);
+			break;
+		case BTGreaterEqualStrategyNumber:
+			*minValue = Max(*minValue, value);
+			break;
+		case BTGreaterStrategyNumber:
+			if (value == PG_INT64_MAX)
+				return false;
+			*minValue = Max(*minValue, value + 1);
+			break;
+		default:
+			Assert(false);
+	}
+	return *minValue <= *maxValue;
+}
+
+/*
+ * Checks if the clause compares the summarized column with the expression
+ * constant during the scan.  Returns the btree strategy of the comparison
+ * and the expression.
+ */
+static bool
+summary_match_clause(Expr *clause, Index relid, AttrNumber attnum,
+					 Oid typid, Oid opfamily, int *strategy, Expr **expr)
+{
+	OpExpr	   *opexpr;
+	Node	   *left,
+			   *right;
+	Oid			opno;
+	Oid			lefttype,
+				righttype;
+
+	if (!IsA(clause, OpExpr))
+		return false;
+	opexpr = (OpExpr *) clause;
+	if (list_length(opexpr->args) != 2)
+		return false;
+
+	left = linitial(opexpr->args);
+	right = lsecond(opexpr->args);
+	opno = opexpr->opno;
+
+	if (IsA(right, Var) && !IsA(left, Var))
+	{
+		Node	   *tmp = left;
+
+		left = right;
+		right = tmp;
+		opno = get_commutator(opno);
+		if (!OidIsValid(opno))
+			return false;
+	}
+
+	if (!IsA(left, Var) ||
+		((Var *) left)->varno != relid ||
+		((Var *) left)->varattno != attnum ||
+		((Var *) left)->varlevelsup != 0 ||
+		contain_var_clause(right) ||
+		contain_volatile_functions(right))
+		return false;
+
+	if (!op_in_opfamily(opno, opfamily))
+		return false;
+	get_op_opfamily_properties(opno, opfamily, false,
+							   strategy, &lefttype, &righttype);
+	if (lefttype != typid || righttype != typid)
+		return false;
+
+	*expr = (Expr *) right;
+	return true;
+}
+
+/*
+ * Adds the summary scan path to the base relation if it has the column
+ * summary and the restriction clauses over the summarized column.
+ */
+void
+o_add_summary_scan_path(PlannerInfo *root, RelOptInfo *rel,
+						RangeTblEntry *rte, OTableDescr *descr)
+{
+	OSummaryRef ref;
+	Path	   *seqPath = NULL;
+	CustomPath *path;
+	List	   *strategies = NIL,
+			   *exprs = NIL,
+			   *clauses = NIL;
+	Oid			opfamily;
+	int64		minValue = PG_INT64_MIN,
+				maxValue = PG_INT64_MAX;
+	OTuple		nullTuple;
+	bool		allConsts = true,
+				empty = false;
+	double		fraction;
+	ListCell   *lc;
+
+	if (max_summaries == 0 ||
+		GET_PRIMARY(descr)->primaryIsCtid ||
+		rte->tablesample != NULL ||
+		!o_summary_find(GET_PRIMARY(descr)->desc.oids,
+						COMMITSEQNO_INPROGRESS, &ref))
+		return;
+
+	opfamily = get_opclass_family(GetDefaultOpClass(ref.typid, BTREE_AM_OID));
+
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		int			strategy;
+		Expr	   *expr;
+
+		if (rinfo->pseudoconstant ||
+			!summary_match_clause(rinfo->clause, rel->relid, ref.attnum,
+								  ref.typid, opfamily, &strategy, &expr))
+			continue;
+
+		strategies = lappend_int(strategies, strategy);
+		exprs = lappend(exprs, expr);
+		clauses = lappend(clauses, rinfo);
+
+		if (IsA(expr, Const))
+		{
+			Const	   *c = (Const *) expr;
+
+			if (c->constisnull ||
+				!summary_apply_condition(strategy,
+										 o_summary_datum_get_int64(c->constvalue,
+																   ref.typid),
+										 &minValue, &maxValue))
+				empty = true;
+		}
+		else
+		{
+			allConsts = false;
+		}
+	}
+
+	if (strategies == NIL)
+		return;
+
+	foreach(lc, rel->pathlist)
+	{
+		Path	   *p = (Path *) lfirst(lc);
+
+		if (IsA(p, Path) && p->pathtype == T_SeqScan && p->param_info == NULL)
+		{
+			seqPath = p;
+			break;
+		}
+	}
+	if (seqPath == NULL)
+		return;
+
+	/*
+	 * With the constant conditions, estimate the fraction of the table read
+	 * by the summary itself.  Otherwise, assume the summarized column is
+	 * correlated with the primary key, that's when the summary makes sense.
+	 */
+	if (empty)
+		fraction = 0.0;
+	else if (allConsts)
+	{
+		O_TUPLE_SET_NULL(nullTuple);
+		(void) o_summary_range_matches(&GET_PRIMARY(descr)->desc, &ref,
+									   nullTuple, nullTuple,
+									   minValue, maxValue, &fraction);
+	}
+	else
+		fraction = clauselist_selectivity(root, clauses, rel->relid,
+										  JOIN_INNER, NULL);
+
+	if (fraction >= 1.0)
+		return;
+
+	path = makeNode(CustomPath);
+	path->path.pathtype = T_CustomScan;
+	path->path.parent = rel;
+	path->path.pathtarget = rel->reltarget;
+	path->path.param_info = NULL;
+	path->path.parallel_aware = false;
+	path->path.parallel_safe = false;
+	path->path.parallel_workers = 0;
+	path->path.rows = seqPath->rows;
+	path->path.startup_cost = seqPath->startup_cost;
+	path->path.total_cost = seqPath->startup_cost +
+		(seqPath->total_cost - seqPath->startup_cost) * fraction;
+	path->path.pathkeys = NIL;
+	path->flags = 0;
+	path->custom_paths = NIL;
+	path->custom_private = list_make3(strategies, exprs,
+									  makeInteger(ref.attnum));
+	path->methods = &o_summary_path_methods;
+
+	add_path(rel, &path->path);
+}
+
+static Plan *
+o_plan_summary_path(PlannerInfo *root, RelOptInfo *rel,
+					CustomPath *best_path, List *tlist,
+					List *clauses, List *custom_plans)
+{
+	CustomScan *custom_scan = makeNode(CustomScan);
+
+	custom_scan->scan.plan.targetlist = tlist;
+	custom_scan->scan.plan.qual = extract_actual_clauses(clauses, false);
+	custom_scan->scan.plan.lefttree = NULL;
+	custom_scan->scan.plan.righttree = NULL;
+	custom_scan->scan.scanrelid = rel->relid;
+	custom_scan->flags = best_path->flags;
+	custom_scan->methods = &o_summary_scan_methods;
+	custom_scan->custom_plans = NIL;
+	custom_scan->custom_exprs = lsecond(best_path->custom_private);
+	custom_scan->custom_private = list_make2(linitial(best_path->custom_private),
+											 lthird(best_path->custom_private));
+	custom_scan->custom_scan_tlist = NIL;
+	custom_scan->custom_relids = NULL;
+
+	return (Plan *) custom_scan;
+}
+
+static Node *
+o_create_summary_scan_state(CustomScan *cscan)
+{
+	OSummaryScanState *sstate = palloc0(sizeof(OSummaryScanState));
+
+	NodeSetTag(sstate, T_CustomScanState);
+	sstate->css.methods = &o_summary_scan_exec_methods;
+	sstate->css.slotOps = &TTSOpsOrioleDB;
+	sstate->strategies = linitial(cscan->custom_private);
+	sstate->attnum = intVal(lsecond(cscan->custom_private));
+
+	return (Node *) sstate;
+}
+
+static void
+o_begin_summary_scan(CustomScanState *node, EState *estate, int eflags)
+{
+	OSummaryScanState *sstate = (OSummaryScanState *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+
+	sstate->descr = relation_get_descr(node->ss.ss_currentRelation);
+	sstate->exprStates = ExecInitExprList(cscan->custom_exprs,
+										  &node->ss.ps);
+	sstate->scan = NULL;
+}
+
+static bool
+summary_scan_range_valid(OTuple low, OTuple high, void *arg)
+{
+	OSummaryScanState *sstate = (OSummaryScanState *) arg;
+
+	if (sstate->empty ||
+		!o_summary_range_matches(&GET_PRIMARY(sstate->descr)->desc,
+								 &sstate->ref, low, high,
+								 sstate->minValue, sstate->maxValue, NULL))
+	{
+		sstate->rangesSkipped++;
+		return false;
+	}
+	return true;
+}
+
+static BTreeSeqScanCallbacks summary_scan_callbacks =
+{
+	.isRangeValid = summary_scan_range_valid
+};
+
+/*
+ * Evaluates the conditions and starts the primary tree scan.
+ */
+static void
+summary_scan_start(OSummaryScanState *sstate)
+{
+	ExprContext *econtext = sstate->css.ss.ps.ps_ExprContext;
+	BTreeDescr *desc = &GET_PRIMARY(sstate->descr)->desc;
+	CommitSeqNo csn = sstate->css.ss.ps.state->es_snapshot->snapshotcsn;
+	ListCell   *lc1,
+			   *lc2;
+
+	/* The summary might be rebuilt for another column since planning */
+	sstate->useSummary = o_summary_find(desc->oids, csn, &sstate->ref) &&
+		sstate->ref.attnum == sstate->attnum;
+	sstate->empty = false;
+	sstate->minValue = PG_INT64_MIN;
+	sstate->maxValue = PG_INT64_MAX;
+
+	forboth(lc1, sstate->strategies, lc2, sstate->exprStates)
+	{
+		ExprState  *exprState = (ExprState *) lfirst(lc2);
+		Datum		value;
+		bool		isnull;
+
+		if (!sstate->useSummary)
+			break;
+
+		value = ExecEvalExprSwitchContext(exprState, econtext, &isnull);
+
+		/* Comparison with null never matches */
+		if (isnull ||
+			!summary_apply_condition(lfirst_int(lc1),
+									 o_summary_datum_get_int64(value,
+															   sstate->ref.typid),
+									 &sstate->minValue, &sstate->maxValue))
+			sstate->empty = true;
+	}
+	ResetExprContext(econtext);
+
+	if (sstate->useSummary)
+		sstate->scan = make_btree_seq_scan_cb(desc, csn,
+											  &summary_scan_callbacks,
+											  sstate, NULL);
+	else
+		sstate->scan = make_btree_seq_scan(desc, csn, NULL);
+}
+
+static TupleTableSlot *
+summary_scan_next(ScanState *node)
+{
+	OSummaryScanState *sstate = (OSummaryScanState *) node;
+	TupleTableSlot *slot = node->ss_ScanTupleSlot;
+	OTuple		tuple;
+	CommitSeqNo tupleCsn;
+	BTreeLocationHint hint;
+
+	if (sstate->scan == NULL)
+		summary_scan_start(sstate);
+
+	tuple = btree_seq_scan_getnext(sstate->scan, slot->tts_mcxt,
+								   &tupleCsn, &hint);
+	if (O_TUPLE_IS_NULL(tuple))
+		return ExecClearTuple(slot);
+
+	tts_orioledb_store_tuple(slot, tuple, sstate->descr, tupleCsn,
+							 PrimaryIndexNumber, true, &hint);
+	return slot;
+}
+
+static bool
+summary_scan_recheck(ScanState *node, TupleTableSlot *slot)
+{
+	return true;
+}
+
+static TupleTableSlot *
+o_exec_summary_scan(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) summary_scan_next,
+					(ExecScanRecheckMtd) summary_scan_recheck);
+}
+
+static void
+o_end_summary_scan(CustomScanState *node)
+{
+	OSummaryScanState *sstate = (OSummaryScanState *) node;
+
+	if (sstate->scan)
+		free_btree_seq_scan(sstate->scan);
+	sstate->scan = NULL;
+}
+
+static void
+o_rescan_summary_scan(CustomScanState *node)
+{
+	OSummaryScanState *sstate = (OSummaryScanState *) node;
+
+	/* The conditions are evaluated again on the next fetch */
+	if (sstate->scan)
+		free_btree_seq_scan(sstate->scan);
+	sstate->scan = NULL;
+}
+
+static void
+o_explain_summary_scan(CustomScanState *node, List *ancestors,
+					   ExplainState *es)
+{
+	OSummaryScanState *sstate = (OSummaryScanState *) node;
+
+	ExplainPropertyText("Summary Scan of",
+						RelationGetRelationName(node->ss.ss_currentRelation),
+						es);
+	if (es->analyze)
+		ExplainPropertyInteger("Leaf Ranges Skipped", NULL,
+							   sstate->rangesSkipped, es);
+}
@@ -27,6 +27,7 @@
 #include "utils/stopevent.h"
 
 #include "access/nbtree.h"
+#include "catalog/pg_opfamily.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "parser/parse_coerce.h"
@@ -51,6 +52,13 @@ static OTuple o_create_key_tuple(BTreeDescr *desc, OTuple tuple,
 static bool pk_needs_undo(BTreeDescr *desc, BTreeOperationType action,
 						  OTuple oldTuple, OTupleXactInfo oldXactInfo,
 						  bool oldDeleted, OTuple newTuple, OXid newOxid);
+static bool o_idx_int_search_key(BTreeDescr *desc, void *key,
+								 BTreeKeyType keyType,
+								 BTreeIntSearchKey *result);
+static OTuple o_idx_separator_key(BTreeDescr *desc, OTuple left,
+								  OTuple right);
+static bool o_idx_key_hash(BTreeDescr *desc, void *key, BTreeKeyType keyType,
+						   uint32 *hash);
 
 static BTreeOps primaryOps = {
 	.len = o_idx_len,
@@ -59,7 +67,10 @@ static BTreeOps primaryOps = {
 	.needs_undo = pk_needs_undo,
 	.cmp = o_idx_cmp,
 	.hash = o_idx_hash,
-	.unique_hash = o_idx_unique_hash
+	.unique_hash = o_idx_unique_hash,
+	.int_search_key = o_idx_int_search_key,
+	.separator_key = o_idx_separator_key,
+	.key_hash = o_idx_key_hash
 },
 
 			secondaryOps = {
@@ -69,7 +80,10 @@ static BTreeOps primaryOps = {
 	.needs_undo = NULL,
 	.cmp = o_idx_cmp,
 	.hash = o_idx_hash,
-	.unique_hash = o_idx_unique_hash
+	.unique_hash = o_idx_unique_hash,
+	.int_search_key = o_idx_int_search_key,
+	.separator_key = o_idx_separator_key,
+	.key_hash = o_idx_key_hash
 },
 
 			toastOps = {
@@ -79,7 +93,10 @@ static BTreeOps primaryOps = {
 	.needs_undo = o_toast_needs_undo,
 	.cmp = o_toast_cmp,
 	.hash = o_toast_hash,
-	.unique_hash = NULL
+	.unique_hash = NULL,
+	.int_search_key = NULL,
+	.separator_key = NULL,
+	.key_hash = NULL
 };
 
 
@@ -115,6 +132,18 @@ index_btree_desc_init(BTreeDescr *desc, OCompress compress, ORelOids oids,
 		desc->storageType = BTreeStoragePersistence;
 	desc->undoType = UndoReserveTxn;
 	desc->createOxid = createOxid;
+	desc->rightmostLeafBlkno = OInvalidInMemoryBlkno;
+	desc->rightmostLeafChangeCount = InvalidOPageChangeCount;
+	desc->localFindHits = 0;
+	desc->localFindMisses = 0;
+	memset(desc->localOps, 0, sizeof(desc->localOps));
+	desc->localOpsTotal = 0;
+	desc->localUndoBytes = 0;
+	desc->localCtid = 0;
+	desc->localCtidEnd = 0;
+	desc->buffersMinPages = ((OIndexDescr *) arg)->buffersMinPages;
+	desc->buffersMaxPercent = ((OIndexDescr *) arg)->buffersMaxPercent;
+	desc->buffersPriority = ((OIndexDescr *) arg)->buffersPriority;
 }
 
 static inline OIndexDescr *
@@ -123,6 +152,23 @@ o_get_tree_def(BTreeDescr *desc)
 	return desc->arg;
 }
 
+/*
+ * Returns the number of attributes present in the key of given type.
+ * Separator keys made by o_idx_separator_key() may be suffix-truncated:
+ * the missing trailing attributes are considered as minus infinity.
+ */
+static inline int
+o_idx_key_natts(OIndexDescr *id, OTuple tuple, BTreeKeyType keyType)
+{
+	int			natts = id->nonLeafTupdesc->natts;
+
+	if (keyType == BTreeKeyNonLeafKey &&
+		!(tuple.formatFlags & O_TUPLE_FLAGS_FIXED_FORMAT))
+		natts = Min(natts, ((OTupleHeader) tuple.data)->natts);
+
+	return natts;
+}
+
 static int
 o_get_key_len(BTreeDescr *desc, OTuple tuple, OIndexType type, bool keepVersion)
 {
@@ -576,7 +622,7 @@ o_idx_cmp_range_key_to_value(OBTreeValueBound *bound1, OIndexField *field,
 		if ((bound1->flags & O_VALUE_BOUND_COERCIBLE) && bound1->value == value)
 			cmp = 0;
 		else if (o_bound_is_coercible(bound1, field))
-			cmp = o_call_comparator(field->comparator, bound1->value, value);
+			cmp = o_call_field_comparator(field, bound1->value, value);
 		else
 			cmp = o_call_comparator(bound1->comparator, bound1->value, value);
 
@@ -611,6 +657,8 @@ o_idx_cmp_tuples(OIndexDescr *id,
 			   *spec2;
 	int			i,
 				n,
+				natts1,
+				natts2,
 				attnum1,
 				attnum2;
 	Datum		value1,
@@ -643,8 +691,18 @@ o_idx_cmp_tuples(OIndexDescr *id,
 	}
 
 	n = id->nonLeafTupdesc->natts;
+	natts1 = o_idx_key_natts(id, *tuple1, keyType1);
+	natts2 = o_idx_key_natts(id, *tuple2, keyType2);
 	for (i = 0; i < n; i++)
 	{
+		/* Truncated attributes are minus infinity */
+		if (i >= natts1 || i >= natts2)
+		{
+			if (natts1 == natts2)
+				return 0;
+			return (natts1 < natts2) ? -1 : 1;
+		}
+
 		if (!OIgnoreColumn(id, i))
 		{
 			OIndexField *field = &id->fields[i];
@@ -657,7 +715,7 @@ o_idx_cmp_tuples(OIndexDescr *id,
 
 			if (!isnull1 && !isnull2)
 			{
-				cmp = o_call_comparator(field->comparator, value1, value2);
+				cmp = o_call_field_comparator(field, value1, value2);
 				if (!field->ascending)
 					cmp = -cmp;
 			}
@@ -684,6 +742,7 @@ o_idx_cmp_key_bound_to_tuple(OIndexDescr *id,
 	OTupleFixedFormatSpec *spec;
 	int			i,
 				n,
+				natts,
 				attnum;
 	Datum		value;
 	bool		isnull;
@@ -711,6 +770,7 @@ o_idx_cmp_key_bound_to_tuple(OIndexDescr *id,
 		n = id->nUniqueFields;
 	}
 
+	natts = o_idx_key_natts(id, *tuple2, keyType2);
 	for (i = 0; i < n; i++)
 	{
 		if (!OIgnoreColumn(id, i))
@@ -721,6 +781,10 @@ o_idx_cmp_key_bound_to_tuple(OIndexDescr *id,
 			if (flags & O_VALUE_BOUND_UNBOUNDED)
 				return (flags & O_VALUE_BOUND_LOWER) ? -1 : 1;
 
+			/* Truncated attributes are minus infinity */
+			if (i >= natts)
+				return 1;
+
 			attnum = OIndexKeyAttnumToTupleAttnum(keyType2, id, i + 1);
 			value = o_fastgetattr(*tuple2, attnum, tupdesc, spec, &isnull);
 
@@ -766,8 +830,8 @@ o_idx_cmp_value_bounds(OBTreeValueBound *bound1,
 			bool		coercible2 = o_bound_is_coercible(bound2, field);
 
 			if (coercible1 && coercible2)
-				res = o_call_comparator(field->comparator, bound1->value,
-										bound2->value);
+				res = o_call_field_comparator(field, bound1->value,
+											  bound2->value);
 			else if (coercible1)
 				res = -o_call_comparator(bound2->comparator, bound2->value,
 										 bound1->value);
@@ -913,6 +977,222 @@ o_idx_cmp(BTreeDescr *desc,
 	return 0;
 }
 
+/*
+ * Fills the normalized integer representation of the search key for the
+ * indices having the single int4 or int8 key column with the default
+ * ascending ordering.  That allows btree_page_search() to avoid calling
+ * o_idx_cmp() for every probe.
+ */
+static bool
+o_idx_int_search_key(BTreeDescr *desc, void *key, BTreeKeyType keyType,
+					 BTreeIntSearchKey *result)
+{
+	OIndexDescr *id = o_get_tree_def(desc);
+	OIndexField *field = &id->fields[0];
+	Form_pg_attribute leafAtt,
+				nonLeafAtt;
+	Datum		value;
+
+	if (id->nonLeafTupdesc->natts != 1 ||
+		!field->ascending ||
+		field->opfamily != INTEGER_BTREE_FAM_OID ||
+		(field->inputtype != INT4OID && field->inputtype != INT8OID))
+		return false;
+
+	if (IS_BOUND_KEY_TYPE(keyType))
+	{
+		OBTreeValueBound *bound = &((OBTreeKeyBound *) key)->keys[0];
+
+		if ((bound->flags & O_VALUE_BOUND_NO_VALUE) ||
+			!o_bound_is_coercible(bound, field))
+			return false;
+
+		value = bound->value;
+		result->eqResult = (bound->flags & O_VALUE_BOUND_INCLUSIVE) ?
+			0 : cmp_inclusive(bound->flags);
+		if (result->eqResult == 0)
+		{
+			if (keyType == BTreeKeyUniqueLowerBound)
+				result->eqResult = -1;
+			else if (keyType == BTreeKeyUniqueUpperBound)
+				result->eqResult = 1;
+		}
+	}
+	else if (keyType == BTreeKeyLeafTuple || keyType == BTreeKeyNonLeafKey)
+	{
+		OTuple	   *tuple = (OTuple *) key;
+		bool		isnull;
+
+		if (keyType == BTreeKeyLeafTuple)
+			value = o_fastgetattr(*tuple,
+								  OIndexKeyAttnumToTupleAttnum(keyType, id, 1),
+								  id->leafTupdesc, &id->leafSpec, &isnull);
+		else
+			value = o_fastgetattr(*tuple, 1, id->nonLeafTupdesc,
+								  &id->nonLeafSpec, &isnull);
+		if (isnull)
+			return false;
+		result->eqResult = 0;
+	}
+	else
+	{
+		return false;
+	}
+
+	if (field->inputtype == INT4OID)
+	{
+		result->value = DatumGetInt32(value);
+		result->width = sizeof(int32);
+	}
+	else
+	{
+		result->value = DatumGetInt64(value);
+		result->width = sizeof(int64);
+	}
+
+	result->leafAttnum = OIndexKeyAttnumToTupleAttnum(BTreeKeyLeafTuple, id, 1);
+	result->nonLeafAttnum = 1;
+	leafAtt = TupleDescAttr(id->leafTupdesc, result->leafAttnum - 1);
+	nonLeafAtt = TupleDescAttr(id->nonLeafTupdesc, 0);
+	result->leafOffset = leafAtt->attcacheoff;
+	result->nonLeafOffset = nonLeafAtt->attcacheoff;
+	result->leafFixedValid = result->leafAttnum <= id->leafSpec.natts;
+	result->nonLeafFixedValid = result->nonLeafAttnum <= id->nonLeafSpec.natts;
+
+	return true;
+}
+
+/*
+ * Hashes the search key for the lookup cache.  Only the inclusive bounds
+ * giving the value of the column type for each column of the non-leaf key
+ * are supported, so the key matches a single tuple.
+ */
+static bool
+o_idx_key_hash(BTreeDescr *desc, void *key, BTreeKeyType keyType,
+			   uint32 *result)
+{
+	OIndexDescr *id = o_get_tree_def(desc);
+	OBTreeKeyBound *bound = (OBTreeKeyBound *) key;
+	register uint32 hash = HASH_INITIAL;
+	int			i;
+
+	if (keyType != BTreeKeyBound ||
+		bound->nkeys != id->nonLeafTupdesc->natts)
+		return false;
+
+	for (i = 0; i < bound->nkeys; i++)
+	{
+		OBTreeValueBound *vb = &bound->keys[i];
+		Form_pg_attribute att = TupleDescAttr(id->nonLeafTupdesc, i);
+
+		if ((vb->flags & O_VALUE_BOUND_NO_VALUE) ||
+			!(vb->flags & O_VALUE_BOUND_INCLUSIVE) ||
+			vb->type != att->atttypid)
+			return false;
+
+		if (att->attbyval)
+		{
+			hash = hash_combine_mix((char *) &vb->value, sizeof(Datum), hash);
+		}
+		else if (att->attlen > 0)
+		{
+			hash = hash_combine_mix(DatumGetPointer(vb->value), att->attlen,
+									hash);
+		}
+		else if (att->attlen == -1)
+		{
+			Pointer		val = DatumGetPointer(vb->value);
+
+			if (VARATT_IS_EXTENDED(val) && !VARATT_IS_SHORT(val))
+				return false;
+			hash = hash_combine_mix(VARDATA_ANY(val), VARSIZE_ANY_EXHDR(val),
+									hash);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	*result = hash_final(hash);
+	return true;
+}
+
+/*
+ * Makes the separator key for the leaf page split: the shortest prefix of
+ * `right` key, which is still greater than `left`.  The truncated trailing
+ * attributes are considered as minus infinity by the comparison functions.
+ * Returns the null tuple if no attributes could be truncated.
+ */
+static OTuple
+o_idx_separator_key(BTreeDescr *desc, OTuple left, OTuple right)
+{
+	OIndexDescr *id = o_get_tree_def(desc);
+	TupleDesc	truncTupdesc;
+	OTupleFixedFormatSpec truncSpec = {0};
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	int			i,
+				natts = id->nonLeafTupdesc->natts,
+				keepNatts = natts;
+	Size		len;
+	OTuple		result;
+
+	O_TUPLE_SET_NULL(result);
+
+	if (!enable_btree_suffix_truncation || natts <= 1)
+		return result;
+
+	for (i = 0; i < natts; i++)
+	{
+		int			attnum = OIndexKeyAttnumToTupleAttnum(BTreeKeyLeafTuple,
+														  id, i + 1);
+		OIndexField *field = &id->fields[i];
+		Datum		leftValue;
+		bool		leftIsnull;
+		int			cmp;
+
+		values[i] = o_fastgetattr(right, attnum, id->leafTupdesc,
+								  &id->leafSpec, &isnull[i]);
+
+		if (keepNatts < natts)
+			continue;
+
+		if (OIgnoreColumn(id, i))
+			continue;
+
+		leftValue = o_fastgetattr(left, attnum, id->leafTupdesc,
+								  &id->leafSpec, &leftIsnull);
+		if (!leftIsnull && !isnull[i])
+			cmp = o_call_field_comparator(field, leftValue, values[i]);
+		else
+			cmp = (leftIsnull == isnull[i]) ? 0 : 1;
+
+		/* The first distinguishing attribute found, keep it */
+		if (cmp != 0)
+			keepNatts = i + 1;
+	}
+
+	if (keepNatts >= natts)
+		return result;
+
+	/*
+	 * Truncated key must be in non-fixed format to hold the number of
+	 * attributes.  Zero natts in the format spec forces that.
+	 */
+	truncTupdesc = CreateTupleDescCopy(id->nonLeafTupdesc);
+	truncTupdesc->natts = keepNatts;
+	len = o_new_tuple_size(truncTupdesc, &truncSpec, NULL, 0,
+						   values, isnull, NULL);
+	result.data = (Pointer) palloc0(len);
+	o_tuple_fill(truncTupdesc, &truncSpec, &result, len, NULL, 0,
+				 values, isnull, NULL);
+	pfree(truncTupdesc);
+
+	Assert(!(result.formatFlags & O_TUPLE_FLAGS_FIXED_FORMAT));
+	return result;
+}
+
 static bool
 pk_needs_undo(BTreeDescr *desc, BTreeOperationType action,
 			  OTuple oldTuple, OTupleXactInfo oldXactInfo, bool oldDeleted,
@@ -1029,7 +1309,7 @@ o_key_to_jsonb(BTreeDescr *desc, OTuple key, JsonbParseState **state)
 	(void) pushJsonbValue(state, WJB_BEGIN_OBJECT, NULL);
 	o_key_to_jsonb_internal(id->nonLeafTupdesc,
 							&id->nonLeafSpec,
-							id->nonLeafTupdesc->natts,
+							o_idx_key_natts(id, key, BTreeKeyNonLeafKey),
 							key, state);
 	return pushJsonbValue(state, WJB_END_OBJECT, NULL);
 }
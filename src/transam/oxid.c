@@ -16,6 +16,7 @@
 
 #include "recovery/recovery.h"
 #include "transam/oxid.h"
+#include "transam/undo.h"
 #include "utils/o_buffers.h"
 
 #include "access/transam.h"
@@ -39,6 +40,22 @@
 	 ((uint64) level << 31) | \
 	 ((committing) ? COMMITSEQNO_SPECIAL_COMMITTING_BIT : 0))
 
+/*
+ * Backend-local direct-mapped cache of the CSNs of finished transactions.
+ * CSN of the finished transaction never changes, so the cache doesn't need
+ * an invalidation.
+ */
+#define OXID_CSN_CACHE_SIZE (256)
+
+typedef struct
+{
+	OXid		oxid;
+	CommitSeqNo csn;
+} OXidCSNCacheEntry;
+
+static OXidCSNCacheEntry oxidCSNCache[OXID_CSN_CACHE_SIZE];
+static bool oxidCSNCacheInitialized = false;
+
 static OXid curOxid = InvalidOXid;
 static pg_atomic_uint64 *xidBuffer;
 
@@ -848,6 +865,8 @@ get_current_oxid(void)
 		curOxid = newOxid;
 	}
 
+	undo_record_pending_savepoints();
+
 	return curOxid;
 }
 
@@ -968,10 +987,38 @@ oxid_get_csn(OXid oxid)
 {
 	CommitSeqNo csn;
 	SpinDelayStatus status;
+	OXidCSNCacheEntry *entry;
 
 	if (oxid == BootstrapTransactionId)
 		return COMMITSEQNO_FROZEN;
 
+	if (oxid < pg_atomic_read_u64(&xid_meta->globalXmin))
+		return COMMITSEQNO_FROZEN;
+
+	/*
+	 * Recovery workers might see the transaction status ahead of the xid
+	 * map, so they don't use the cache.
+	 */
+	if (!is_recovery_process())
+	{
+		if (!oxidCSNCacheInitialized)
+		{
+			int			i;
+
+			for (i = 0; i < OXID_CSN_CACHE_SIZE; i++)
+				oxidCSNCache[i].oxid = InvalidOXid;
+			oxidCSNCacheInitialized = true;
+		}
+
+		entry = &oxidCSNCache[oxid % OXID_CSN_CACHE_SIZE];
+		if (entry->oxid == oxid)
+			return entry->csn;
+	}
+	else
+	{
+		entry = NULL;
+	}
+
 	init_local_spin_delay(&status);
 
 	while (true)
@@ -991,6 +1038,12 @@ oxid_get_csn(OXid oxid)
 	if (COMMITSEQNO_IS_SPECIAL(csn))
 		return COMMITSEQNO_INPROGRESS;
 
+	if (entry && csn != COMMITSEQNO_INPROGRESS && csn != COMMITSEQNO_FROZEN)
+	{
+		entry->oxid = oxid;
+		entry->csn = csn;
+	}
+
 	return csn;
 }
 
@@ -16,6 +16,7 @@
 
 #include "orioledb.h"
 
+#include "btree/range_lock.h"
 #include "btree/scan.h"
 #include "btree/undo.h"
 #include "checkpoint/checkpoint.h"
@@ -23,17 +24,23 @@
 #include "recovery/wal.h"
 #include "tableam/descr.h"
 #include "tableam/handler.h"
+#include "tableam/operations.h"
 #include "transam/oxid.h"
 #include "transam/undo.h"
 #include "utils/o_buffers.h"
+#include "utils/o_latency.h"
+#include "utils/o_probes.h"
+#include "utils/o_wait_events.h"
 #include "utils/page_pool.h"
 #include "utils/stopevent.h"
 
 #include "access/transam.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "utils/builtins.h"
 #include "utils/memutils.h"
 
 #define GET_UNDO_REC(loc) (o_undo_buffers + (loc) % undo_circular_buffer_size)
@@ -101,6 +108,7 @@ UndoItemTypeDescr undoItemTypeDescrs[] = {
 
 
 PG_FUNCTION_INFO_V1(orioledb_has_retained_undo);
+PG_FUNCTION_INFO_V1(orioledb_undo_stats);
 
 UndoMeta   *undo_meta = NULL;
 
@@ -109,6 +117,18 @@ bool		oxid_needs_wal_flush = false;
 
 static Size reserved_undo_size = 0;
 
+/*
+ * Undo space reserved in advanceReservedLocation, but not handed to any
+ * reserve_undo_size() call yet.  Backends keep the space released after each
+ * modification for the next one, so that typical modifications don't touch
+ * advanceReservedLocation at all.  The cache is limited so that all the
+ * backends together can't hold more than a quarter of the undo buffer.
+ */
+static Size cached_undo_size = 0;
+
+#define UNDO_RESERVE_CACHE_MAX_SIZE \
+	Min(2 * O_MODIFY_UNDO_RESSERVE_SIZE, undo_circular_buffer_size / (4 * max_procs))
+
 static OBuffersDesc buffersDesc = {
 	.singleFileSize = UNDO_FILE_SIZE,
 	.filenameTemplate = ORIOLEDB_UNDO_DIR "/%02X%08X",
@@ -116,6 +136,21 @@ static OBuffersDesc buffersDesc = {
 	.bufferCtlTrancheName = "undoBuffersCtlTranche"
 };
 
+/*
+ * Savepoints, which are not yet recorded to the undo stack and WAL.  We
+ * postpone recording the savepoint till the first modification in the
+ * subtransaction, so subtransactions without modifications are cheap.
+ */
+typedef struct
+{
+	SubTransactionId mySubid;
+	SubTransactionId parentSubid;
+} PendingSavepoint;
+
+static PendingSavepoint *pendingSavepoints = NULL;
+static int	pendingSavepointsCount = 0;
+static int	pendingSavepointsAllocated = 0;
+
 static bool wait_for_reserved_location(UndoLocation undoLocationToWait);
 
 Size
@@ -124,6 +159,7 @@ undo_shmem_needs(void)
 	Size		size;
 
 	buffersDesc.buffersCount = undo_buffers_count;
+	buffersDesc.compress = undo_compress;
 
 	size = CACHELINEALIGN(sizeof(UndoMeta));
 	size = add_size(size, undo_circular_buffer_size);
@@ -132,6 +168,47 @@ undo_shmem_needs(void)
 	return size;
 }
 
+/*
+ * Returns the part of the undo circular buffer, which is reserved after the
+ * last written or retained location.
+ */
+static uint64
+undo_buffer_usage(uint64 reservedLocation)
+{
+	uint64		startLocation;
+
+	startLocation = Max(pg_atomic_read_u64(&undo_meta->writtenLocation),
+						pg_atomic_read_u64(&undo_meta->minProcRetainLocation));
+	if (reservedLocation <= startLocation)
+		return 0;
+	return Min(reservedLocation - startLocation, undo_circular_buffer_size);
+}
+
+static void
+undo_update_max_buffer_usage(uint64 reservedLocation)
+{
+	uint64		usage = undo_buffer_usage(reservedLocation),
+				max = pg_atomic_read_u64(&undo_meta->maxBufferUsage);
+
+	while (usage > max)
+	{
+		if (pg_atomic_compare_exchange_u64(&undo_meta->maxBufferUsage,
+										   &max, usage))
+			break;
+	}
+}
+
+void
+undo_shmem_usage(OShmemUsage *usage)
+{
+	uint64		used;
+
+	used = undo_buffer_usage(pg_atomic_read_u64(&undo_meta->advanceReservedLocation));
+	usage->used = used;
+	usage->free = undo_circular_buffer_size - used;
+	usage->highWater = Max(pg_atomic_read_u64(&undo_meta->maxBufferUsage), used);
+}
+
 void
 undo_shmem_init(Pointer buf, bool found)
 {
@@ -149,6 +226,10 @@ undo_shmem_init(Pointer buf, bool found)
 	{
 		SpinLockInit(&undo_meta->minUndoLocationsMutex);
 		undo_meta->minUndoLocationsChangeCount = 0;
+		pg_atomic_init_u64(&undo_meta->writtenToFilesBytes, 0);
+		pg_atomic_init_u64(&undo_meta->readFromFilesBytes, 0);
+		pg_atomic_init_u64(&undo_meta->fileReadsCount, 0);
+		pg_atomic_init_u64(&undo_meta->maxBufferUsage, 0);
 		undo_meta->undoWriteTrancheId = LWLockNewTrancheId();
 		undo_meta->pendingTruncatesTrancheId = LWLockNewTrancheId();
 		undo_meta->undoStackLocationsFlushLockTrancheId = LWLockNewTrancheId();
@@ -426,6 +507,7 @@ wait_for_reserved_location(UndoLocation undoLocationToWait)
 			if (!delay_inited)
 			{
 				init_local_spin_delay(&delay);
+				pgstat_report_wait_start(o_wait_event_info(OWaitEventUndoReserve));
 				delay_inited = true;
 			}
 			else
@@ -435,7 +517,10 @@ wait_for_reserved_location(UndoLocation undoLocationToWait)
 		}
 
 		if (delay_inited)
+		{
+			pgstat_report_wait_end();
 			finish_spin_delay(&delay);
+		}
 	}
 
 	return true;
@@ -748,7 +833,10 @@ static void
 write_undo_range(Pointer buf, UndoLocation minLoc, UndoLocation maxLoc)
 {
 	if (maxLoc > minLoc)
+	{
 		o_buffers_write(&buffersDesc, buf, minLoc, maxLoc - minLoc);
+		pg_atomic_fetch_add_u64(&undo_meta->writtenToFilesBytes, maxLoc - minLoc);
+	}
 }
 
 static void
@@ -756,6 +844,8 @@ read_undo_range(Pointer buf, UndoLocation minLoc, UndoLocation maxLoc)
 {
 	Assert(maxLoc > minLoc);
 	o_buffers_read(&buffersDesc, buf, minLoc, maxLoc - minLoc);
+	pg_atomic_fetch_add_u64(&undo_meta->readFromFilesBytes, maxLoc - minLoc);
+	pg_atomic_fetch_add_u64(&undo_meta->fileReadsCount, 1);
 }
 
 void
@@ -814,6 +904,8 @@ write_undo(UndoLocation targetUndoLocation,
 		(void) wait_for_reserved_location(targetUndoLocation + undo_circular_buffer_size);
 
 
+	TRACE_ORIOLEDB_UNDO_WRITE_START(retainUndoLocation, targetUndoLocation);
+
 	if (retainUndoLocation % undo_circular_buffer_size <
 		targetUndoLocation % undo_circular_buffer_size)
 	{
@@ -836,32 +928,23 @@ write_undo(UndoLocation targetUndoLocation,
 	pg_atomic_write_u64(&undo_meta->writtenLocation, targetUndoLocation);
 	SpinLockRelease(&undo_meta->minUndoLocationsMutex);
 
+	TRACE_ORIOLEDB_UNDO_WRITE_DONE(targetUndoLocation);
+
 	LWLockRelease(&undo_meta->undoWriteLock);
 }
 
-bool
-reserve_undo_size_extended(UndoReserveType type, Size size,
+/*
+ * Slow path of reserve_undo_size_extended(): the reserved location doesn't
+ * fit the circular buffer, so wait for the retained undo to be released and
+ * write the buffer to the files.  'size' is already added to the
+ * advanceReservedLocation and reserved_undo_size.
+ */
+static bool
+reserve_undo_location_wait(UndoLocation location, Size size,
 						   bool waitForUndoLocation, bool reportError)
 {
-	UndoLocation location;
 	uint64		minProcReservedLocation;
 
-	Assert(!waitForUndoLocation || !have_locked_pages());
-	Assert(type == UndoReserveTxn);
-	Assert(size > 0);
-
-	if (reserved_undo_size >= size)
-		return true;
-
-	size -= reserved_undo_size;
-
-	location = pg_atomic_fetch_add_u64(&undo_meta->advanceReservedLocation, size);
-	reserved_undo_size += size;
-
-	if (location + size <=
-		pg_atomic_read_u64(&undo_meta->writtenLocation) + undo_circular_buffer_size)
-		return true;
-
 	update_min_undo_locations(false, waitForUndoLocation);
 
 	if (!check_reserved_undo_location(location + size, &minProcReservedLocation,
@@ -920,6 +1003,64 @@ reserve_undo_size_extended(UndoReserveType type, Size size,
 	return true;
 }
 
+bool
+reserve_undo_size_extended(UndoReserveType type, Size size,
+						   bool waitForUndoLocation, bool reportError)
+{
+	UndoLocation location;
+	Size		cacheSize;
+	instr_time	start;
+	bool		result;
+
+	Assert(!waitForUndoLocation || !have_locked_pages());
+	Assert(type == UndoReserveTxn);
+	Assert(size > 0);
+
+	if (reserved_undo_size >= size)
+		return true;
+
+	size -= reserved_undo_size;
+
+	if (cached_undo_size >= size)
+	{
+		cached_undo_size -= size;
+		reserved_undo_size += size;
+		return true;
+	}
+
+	/* Take the whole cache and reserve the rest together with a new cache */
+	size -= cached_undo_size;
+	reserved_undo_size += cached_undo_size;
+	cached_undo_size = 0;
+	cacheSize = UNDO_RESERVE_CACHE_MAX_SIZE;
+
+	TRACE_ORIOLEDB_UNDO_RESERVE(size);
+
+	location = pg_atomic_fetch_add_u64(&undo_meta->advanceReservedLocation,
+									   size + cacheSize);
+	undo_update_max_buffer_usage(location + size + cacheSize);
+
+	if (location + size + cacheSize <=
+		pg_atomic_read_u64(&undo_meta->writtenLocation) + undo_circular_buffer_size)
+	{
+		reserved_undo_size += size;
+		cached_undo_size = cacheSize;
+		return true;
+	}
+
+	/* No room for the cache, proceed with the requested size only */
+	if (cacheSize > 0)
+		pg_atomic_fetch_sub_u64(&undo_meta->advanceReservedLocation, cacheSize);
+	reserved_undo_size += size;
+
+	O_LATENCY_START(start);
+	result = reserve_undo_location_wait(location, size, waitForUndoLocation,
+										reportError);
+	o_latency_report(OLatencyUndoReserve, start);
+
+	return result;
+}
+
 void
 fsync_undo_range(UndoLocation fromLoc, UndoLocation toLoc, uint32 wait_event_info)
 {
@@ -992,6 +1133,9 @@ get_undo_record_unreserved(UndoReserveType type, UndoLocation *undoLocation, Siz
 	Assert(size == MAXALIGN(size));
 	Assert(reserved_undo_size == 0);
 
+	if (pendingSavepointsCount > 0)
+		undo_record_pending_savepoints();
+
 	reserve_undo_size(type, 2 * size);
 	return get_undo_record(type, undoLocation, size);
 }
@@ -1005,12 +1149,41 @@ release_undo_size(UndoReserveType type)
 
 	if (reserved_undo_size != 0)
 	{
-		pg_atomic_fetch_sub_u64(&undo_meta->advanceReservedLocation, reserved_undo_size);
+		Size		cacheMaxSize = UNDO_RESERVE_CACHE_MAX_SIZE;
+
+		cached_undo_size += reserved_undo_size;
 		reserved_undo_size = 0;
+		if (cached_undo_size > cacheMaxSize)
+		{
+			pg_atomic_fetch_sub_u64(&undo_meta->advanceReservedLocation,
+									cached_undo_size - cacheMaxSize);
+			cached_undo_size = cacheMaxSize;
+		}
 	}
 	pg_atomic_write_u64(&curProcData->reservedUndoLocation, InvalidUndoLocation);
 }
 
+/*
+ * Returns the cached undo space on backend exit.
+ */
+void
+release_undo_cache(void)
+{
+	if (undo_meta == NULL)
+		return;
+
+	if (reserved_undo_size != 0)
+	{
+		pg_atomic_fetch_sub_u64(&undo_meta->advanceReservedLocation, reserved_undo_size);
+		reserved_undo_size = 0;
+	}
+	if (cached_undo_size != 0)
+	{
+		pg_atomic_fetch_sub_u64(&undo_meta->advanceReservedLocation, cached_undo_size);
+		cached_undo_size = 0;
+	}
+}
+
 Size
 get_reserved_undo_size(UndoReserveType type)
 {
@@ -1024,6 +1197,9 @@ add_new_undo_stack_item(UndoLocation location)
 {
 	UndoStackItem *item = (UndoStackItem *) GET_UNDO_REC(location);
 	UndoStackSharedLocations *sharedLocations = GET_CUR_UNDO_STACK_LOCATIONS();
+
+	/* savepoints should be recorded before the first item is allocated */
+	Assert(pendingSavepointsCount == 0);
 	UndoItemTypeDescr *descr = item_type_get_descr(item->type);
 
 	item->prev = pg_atomic_read_u64(&sharedLocations->location);
@@ -1136,7 +1312,11 @@ undo_xact_callback(XactEvent event, void *arg)
 	ea_counters = NULL;
 
 	if (event == XACT_EVENT_COMMIT || event == XACT_EVENT_ABORT)
+	{
 		seq_scans_cleanup();
+		o_tbl_bulk_load_cleanup(InvalidSubTransactionId);
+		pendingSavepointsCount = 0;
+	}
 
 	if (!OXidIsValid(oxid) || isParallelWorker)
 	{
@@ -1217,6 +1397,7 @@ undo_xact_callback(XactEvent event, void *arg)
 
 		free_retained_undo_location();
 		saved_undo_location = InvalidUndoLocation;
+		o_range_locks_release();
 	}
 
 	if (event == XACT_EVENT_COMMIT && isParallelWorker)
@@ -1246,6 +1427,69 @@ add_subxact_undo_item(SubTransactionId parentSubid)
 	pg_atomic_write_u64(&sharedLocations->subxactLocation, location);
 }
 
+/*
+ * Records savepoints postponed by undo_subxact_callback() to the undo stack
+ * and WAL.  Called before the first modification in the subtransaction.
+ */
+void
+undo_record_pending_savepoints(void)
+{
+	int			count = pendingSavepointsCount,
+				i;
+
+	if (count == 0)
+		return;
+
+	pendingSavepointsCount = 0;
+	(void) get_current_oxid();
+
+	for (i = 0; i < count; i++)
+	{
+		add_subxact_undo_item(pendingSavepoints[i].parentSubid);
+		add_savepoint_wal_record(pendingSavepoints[i].parentSubid);
+	}
+}
+
+static void
+add_pending_savepoint(SubTransactionId mySubid, SubTransactionId parentSubid)
+{
+	if (pendingSavepointsCount >= pendingSavepointsAllocated)
+	{
+		if (pendingSavepointsAllocated == 0)
+		{
+			pendingSavepointsAllocated = 16;
+			pendingSavepoints = (PendingSavepoint *)
+				MemoryContextAlloc(TopMemoryContext,
+								   sizeof(PendingSavepoint) * pendingSavepointsAllocated);
+		}
+		else
+		{
+			pendingSavepointsAllocated *= 2;
+			pendingSavepoints = (PendingSavepoint *)
+				repalloc(pendingSavepoints,
+						 sizeof(PendingSavepoint) * pendingSavepointsAllocated);
+		}
+	}
+	pendingSavepoints[pendingSavepointsCount].mySubid = mySubid;
+	pendingSavepoints[pendingSavepointsCount].parentSubid = parentSubid;
+	pendingSavepointsCount++;
+}
+
+/*
+ * Forgets the savepoint if it's not recorded yet.  Returns true if so.
+ */
+static bool
+forget_pending_savepoint(SubTransactionId mySubid)
+{
+	if (pendingSavepointsCount > 0 &&
+		pendingSavepoints[pendingSavepointsCount - 1].mySubid == mySubid)
+	{
+		pendingSavepointsCount--;
+		return true;
+	}
+	return false;
+}
+
 static bool
 search_for_undo_sub_location(UndoStackKind kind, UndoLocation location,
 							 UndoItemBuf *buf, SubTransactionId parentSubid,
@@ -1373,15 +1617,21 @@ undo_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
 	switch (event)
 	{
 		case SUBXACT_EVENT_START_SUB:
-			(void) get_current_oxid();
-			add_subxact_undo_item(parentSubid);
-			add_savepoint_wal_record(parentSubid);
+			add_pending_savepoint(mySubid, parentSubid);
 			break;
 		case SUBXACT_EVENT_COMMIT_SUB:
-			update_subxact_undo_location_on_commit(parentSubid);
+			if (!forget_pending_savepoint(mySubid))
+				update_subxact_undo_location_on_commit(parentSubid);
 			saved_undo_location = InvalidUndoLocation;
 			break;
 		case SUBXACT_EVENT_ABORT_SUB:
+			o_tbl_bulk_load_cleanup(mySubid);
+			if (forget_pending_savepoint(mySubid))
+			{
+				/* nothing was changed in the subtransaction */
+				saved_undo_location = InvalidUndoLocation;
+				break;
+			}
 			rollback_to_savepoint(UndoStackFull, parentSubid, true);
 			add_rollback_to_savepoint_wal_record(parentSubid);
 			saved_undo_location = InvalidUndoLocation;
@@ -1409,6 +1659,7 @@ have_current_undo(void)
 void
 report_undo_overflow(void)
 {
+	TRACE_ORIOLEDB_UNDO_OVERFLOW();
 	ereport(ERROR,
 			(errcode(ERRCODE_SNAPSHOT_TOO_OLD),
 			 errmsg("failed to add an undo record: undo size is exceeded")));
@@ -1434,6 +1685,85 @@ orioledb_has_retained_undo(PG_FUNCTION_ARGS)
 	PG_RETURN_BOOL(result);
 }
 
+/*
+ * Reports undo log usage together with the backend, which retains the oldest
+ * undo location by its transaction or snapshot.
+ */
+Datum
+orioledb_undo_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[11];
+	bool		nulls[11];
+	UndoLocation lastUsedLocation,
+				advanceReservedLocation,
+				minRetainLocation = InvalidUndoLocation;
+	int			minRetainProcnum = -1;
+	bool		minRetainIsSnapshot = false;
+	int			i;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	lastUsedLocation = pg_atomic_read_u64(&undo_meta->lastUsedLocation);
+	advanceReservedLocation = pg_atomic_read_u64(&undo_meta->advanceReservedLocation);
+
+	for (i = 0; i < max_procs; i++)
+	{
+		UndoLocation transactionLocation,
+					snapshotLocation;
+
+		transactionLocation = pg_atomic_read_u64(&oProcData[i].transactionUndoRetainLocation);
+		snapshotLocation = pg_atomic_read_u64(&oProcData[i].snapshotRetainUndoLocation);
+
+		if (UndoLocationIsValid(transactionLocation) &&
+			(!UndoLocationIsValid(minRetainLocation) ||
+			 transactionLocation < minRetainLocation))
+		{
+			minRetainLocation = transactionLocation;
+			minRetainProcnum = i;
+			minRetainIsSnapshot = false;
+		}
+		if (UndoLocationIsValid(snapshotLocation) &&
+			(!UndoLocationIsValid(minRetainLocation) ||
+			 snapshotLocation < minRetainLocation))
+		{
+			minRetainLocation = snapshotLocation;
+			minRetainProcnum = i;
+			minRetainIsSnapshot = true;
+		}
+	}
+
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(undo_circular_buffer_size);
+	values[1] = Int64GetDatum(advanceReservedLocation > lastUsedLocation ?
+							  advanceReservedLocation - lastUsedLocation : 0);
+	values[2] = Int64GetDatum(lastUsedLocation -
+							  Min(lastUsedLocation, pg_atomic_read_u64(&undo_meta->minProcRetainLocation)));
+	values[3] = Int64GetDatum(lastUsedLocation -
+							  Min(lastUsedLocation, pg_atomic_read_u64(&undo_meta->minProcTransactionRetainLocation)));
+	if (minRetainProcnum >= 0)
+	{
+		values[4] = Int32GetDatum(GetPGProcByNumber(minRetainProcnum)->pid);
+		values[5] = CStringGetTextDatum(minRetainIsSnapshot ? "snapshot" : "transaction");
+		values[6] = Int64GetDatum(lastUsedLocation - Min(lastUsedLocation, minRetainLocation));
+	}
+	else
+	{
+		nulls[4] = true;
+		nulls[5] = true;
+		nulls[6] = true;
+	}
+	values[7] = Int64GetDatum(pg_atomic_read_u64(&undo_meta->writtenLocation) -
+							  pg_atomic_read_u64(&undo_meta->cleanedLocation));
+	values[8] = Int64GetDatum(pg_atomic_read_u64(&undo_meta->writtenToFilesBytes));
+	values[9] = Int64GetDatum(pg_atomic_read_u64(&undo_meta->readFromFilesBytes));
+	values[10] = Int64GetDatum(pg_atomic_read_u64(&undo_meta->fileReadsCount));
+
+	tupdesc = BlessTupleDesc(tupdesc);
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 void
 start_autonomous_transaction(OAutonomousTxState *state)
 {
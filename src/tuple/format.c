@@ -157,6 +157,47 @@ o_tuple_read_next_field(OTupleReaderState *state, bool *isnull)
 	return fetchatt(att, state->tp + off);
 }
 
+/*
+ * Deforms the leading fixed-width attributes of the tuple at once.
+ *
+ * While no nulls and no variable-length attributes were met, every attribute
+ * offset is known from the attcacheoff of the tuple descriptor, so we can
+ * fetch the values directly without tracking alignment per attribute.  The
+ * reader state is advanced past the deformed attributes, so the rest of the
+ * tuple can be read with o_tuple_read_next_field() as usual.  At most
+ * maxatts values are stored to values/isnull arrays.  Returns the number of
+ * attributes deformed.
+ */
+int
+o_tuple_read_fixed_prefix(OTupleReaderState *state, int maxatts,
+						  Datum *values, bool *isnull)
+{
+	TupleDesc	desc = state->desc;
+	char	   *tp = state->tp;
+	int			natts = Min(state->attnum + maxatts, state->natts);
+	int			attnum;
+	int			i = 0;
+
+	if (state->slow || state->hasnulls)
+		return 0;
+
+	for (attnum = state->attnum; attnum < natts; attnum++, i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, attnum);
+
+		if (att->attlen <= 0 || att->attcacheoff < 0)
+			break;
+
+		values[i] = fetchatt(att, tp + att->attcacheoff);
+		isnull[i] = false;
+		state->off = att->attcacheoff + att->attlen;
+	}
+
+	state->attnum = attnum;
+
+	return i;
+}
+
 static Pointer
 o_tuple_read_next_field_ptr(OTupleReaderState *state)
 {
@@ -627,22 +668,22 @@ o_tuple_fill(TupleDesc tupleDesc, OTupleFixedFormatSpec *spec,
 
 #if PG_VERSION_NUM >= 140000
 			{
-				if (VARATT_IS_COMPRESSED(value))
+				/*
+				 * Take the method the value is actually compressed with: it
+				 * might differ from the current attcompression.
+				 */
+				if (VARATT_IS_EXTERNAL_ORIOLEDB(value))
 				{
-					if (att->attcompression == InvalidCompressionMethod)
-						att->attcompression = default_toast_compression;
-					switch (att->attcompression)
-					{
-						case TOAST_PGLZ_COMPRESSION:
-							toastValue.compression = TOAST_PGLZ_COMPRESSION_ID;
-							break;
-						case TOAST_LZ4_COMPRESSION:
-							toastValue.compression = TOAST_LZ4_COMPRESSION_ID;
-							break;
-						default:
-							toastValue.compression = TOAST_INVALID_COMPRESSION_ID;
-					}
+					OToastExternal ote;
+
+					memcpy(&ote, VARDATA_EXTERNAL(DatumGetPointer(value)),
+						   O_TOAST_EXTERNAL_SZ);
+					toastValue.compression = ote.formatFlags >>
+						ORIOLEDB_EXT_FORMAT_FLAGS_BITS;
 				}
+				else if (VARATT_IS_COMPRESSED(value))
+					toastValue.compression =
+						VARDATA_COMPRESSED_GET_COMPRESS_METHOD(DatumGetPointer(value));
 				else
 					toastValue.compression = TOAST_INVALID_COMPRESSION_ID;
 			}
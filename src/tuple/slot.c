@@ -218,7 +218,19 @@ tts_orioledb_getsomeattrs(TupleTableSlot *slot, int __natts)
 		natts = oslot->state.desc->natts;
 	}
 
-	for (attnum = slot->tts_nvalid; attnum < natts; attnum++)
+	attnum = slot->tts_nvalid;
+
+	/*
+	 * Primary tuple attributes map one-to-one to the slot attributes, so the
+	 * fixed-width prefix can be deformed in a single pass over cached
+	 * offsets.
+	 */
+	if (oslot->ixnum == PrimaryIndexNumber && !index_order &&
+		oslot->state.attnum == attnum + ctid_off)
+		attnum += o_tuple_read_fixed_prefix(&oslot->state, natts - attnum,
+											&values[attnum], &isnull[attnum]);
+
+	for (; attnum < natts; attnum++)
 	{
 		Form_pg_attribute thisatt;
 		int			res_attnum;
@@ -1059,14 +1071,83 @@ tts_orioledb_toast(TupleTableSlot *slot, OTableDescr *descr)
 		}
 	}
 
+	/*
+	 * First try to compress values, starting from the largest one.  Medium
+	 * sized values often fit the primary tree once compressed, so reading
+	 * them doesn't need extra TOAST tree lookups.
+	 */
+	if (!can_be_stored_in_index(slot, descr))
+	{
+		bool	   *tried = palloc0(sizeof(bool) * natts);
+
+		while (true)
+		{
+			Datum		tmp;
+			int			max = 0,
+						max_attn = -1,
+						var_size;
+			MemoryContext oldMctx;
+
+			/* search max value, which is not compressed yet */
+			for (i = 0; i < descr->ntoastable; i++)
+			{
+				toast_attn = descr->toastable[i] - ctid_off;
+				if (slot->tts_isnull[toast_attn] ||
+					oslot->to_toast[toast_attn] || tried[toast_attn] ||
+					VARATT_IS_COMPRESSED(slot->tts_values[toast_attn]))
+					continue;
+
+				att = TupleDescAttr(tupdesc, toast_attn);
+				if (att->attstorage == 'e')
+					continue;
+
+				var_size = VARSIZE_ANY(slot->tts_values[toast_attn]);
+				if (var_size > max)
+				{
+					max = var_size;
+					max_attn = toast_attn;
+				}
+			}
+
+			/* we have no values which can be compressed */
+			if (max_attn == -1)
+				break;
+
+			att = TupleDescAttr(tupdesc, max_attn);
+			tried[max_attn] = true;
+
+			oldMctx = MemoryContextSwitchTo(slot->tts_mcxt);
+			tmp = toast_compress_datum(slot->tts_values[max_attn]
+#if PG_VERSION_NUM >= 140000
+									   ,att->attcompression
+#endif
+				);
+			MemoryContextSwitchTo(oldMctx);
+
+			/* value can not be compressed */
+			if (DatumGetPointer(tmp) == NULL)
+				continue;
+
+			/* we should free it later */
+			if (oslot->vfree[max_attn])
+				pfree(DatumGetPointer(slot->tts_values[max_attn]));
+			slot->tts_values[max_attn] = tmp;
+			oslot->vfree[max_attn] = true;
+
+			/* if tuple with compressed values can be stored without TOAST */
+			if (can_be_stored_in_index(slot, descr))
+				break;
+		}
+		pfree(tried);
+	}
+
+	/* Then move the largest values to TOAST until the tuple fits */
 	while (to_toastn < descr->ntoastable &&
 		   !can_be_stored_in_index(slot, descr))
 	{
-		Datum		tmp;
 		int			max = 0,
 					max_attn = -1,
 					var_size;
-		MemoryContext oldMctx;
 
 		/* search max unprocessed value */
 		for (i = 0; i < descr->ntoastable; i++)
@@ -1093,49 +1174,6 @@ tts_orioledb_toast(TupleTableSlot *slot, OTableDescr *descr)
 		if (max_attn == -1)
 			break;
 
-		att = TupleDescAttr(tupdesc, max_attn);
-
-		/*
-		 * if value already compressed or can not be compressed - it must be
-		 * toasted
-		 */
-		if (VARATT_IS_COMPRESSED(slot->tts_values[max_attn])
-			|| att->attstorage == 'e')
-		{
-			oslot->to_toast[max_attn] = true;
-			to_toastn++;
-			continue;
-		}
-
-		oldMctx = MemoryContextSwitchTo(slot->tts_mcxt);
-		tmp = toast_compress_datum(slot->tts_values[max_attn]
-#if PG_VERSION_NUM >= 140000
-								   ,TOAST_PGLZ_COMPRESSION
-#endif
-			);
-		MemoryContextSwitchTo(oldMctx);
-
-		if (DatumGetPointer(tmp) == NULL)
-		{
-			/* value can not be compressed */
-			oslot->to_toast[max_attn] = true;
-			to_toastn++;
-			continue;
-		}
-		else
-		{
-			/* we should free it later */
-			if (oslot->vfree[max_attn])
-				pfree(DatumGetPointer(slot->tts_values[max_attn]));
-			slot->tts_values[max_attn] = tmp;
-			oslot->vfree[max_attn] = true;
-		}
-
-		/* if tuple with compressed value can be stored without TOAST */
-		if (can_be_stored_in_index(slot, descr))
-			break;
-
-		/* else it must be toasted */
 		oslot->to_toast[max_attn] = true;
 		to_toastn++;
 	}
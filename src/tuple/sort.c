@@ -276,6 +276,10 @@ tuplesort_begin_orioledb_index(OIndexDescr *idx,
 	base->comparetup = comparetup_orioledb_index;
 	base->writetup = writetup_orioledb_index;
 	base->readtup = readtup_orioledb_index;
+#if PG_VERSION_NUM >= 160000
+	/* Let tuplesort use specialized qsort for int4/int8 leading keys */
+	base->haveDatum1 = true;
+#endif
 	base->arg = arg;
 
 	for (i = 0; i < sort_fields; i++)
@@ -291,7 +295,6 @@ tuplesort_begin_orioledb_index(OIndexDescr *idx,
 				OIndexKeyAttnumToTupleAttnum(BTreeKeyLeafTuple, idx, i + 1);
 			sortKey->abbreviate = (i == 0);
 			sortKey->ssup_reverse = !idx->fields[i].ascending;
-			/* FIXME: no abbrev converter yet */
 			o_finish_sort_support_function(idx->fields[i].comparator, sortKey);
 		}
 	}
@@ -301,6 +304,24 @@ tuplesort_begin_orioledb_index(OIndexDescr *idx,
 	return state;
 }
 
+/*
+ * Begins the sort of primary tree tuples for the bulk load.  Unlike the index
+ * build, duplicates are passed through: the subsequent insertion reports
+ * them as the regular unique violation.
+ */
+Tuplesortstate *
+tuplesort_begin_orioledb_bulk_load(OIndexDescr *primary, int workMem)
+{
+	Tuplesortstate *state;
+	OIndexBuildSortArg *arg;
+
+	state = tuplesort_begin_orioledb_index(primary, workMem, false, NULL);
+	arg = (OIndexBuildSortArg *) TuplesortstateGetPublic(state)->arg;
+	arg->enforceUnique = false;
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_orioledb_toast(OIndexDescr *toast,
 							   OIndexDescr *primary,
@@ -335,6 +356,10 @@ tuplesort_begin_orioledb_toast(OIndexDescr *toast,
 	base->comparetup = comparetup_orioledb_index;
 	base->writetup = writetup_orioledb_index;
 	base->readtup = readtup_orioledb_index;
+#if PG_VERSION_NUM >= 160000
+	/* Let tuplesort use specialized qsort for int4/int8 leading keys */
+	base->haveDatum1 = true;
+#endif
 	base->arg = arg;
 
 	for (i = 0; i < key_fields; i++)
@@ -347,7 +372,6 @@ tuplesort_begin_orioledb_toast(OIndexDescr *toast,
 		sortKey->ssup_attno = OIndexKeyAttnumToTupleAttnum(BTreeKeyLeafTuple, primary, i + 1);
 		sortKey->abbreviate = (i == 0);
 		sortKey->ssup_reverse = !primary->fields[i].ascending;
-		/* FIXME: no abbrev converter yet */
 		o_finish_sort_support_function(primary->fields[i].comparator, sortKey);
 	}
 
@@ -29,6 +29,7 @@
 #include "access/htup_details.h"
 #include "access/detoast.h"
 #include "catalog/pg_type.h"
+#include "common/pg_lzcompress.h"
 #include "utils/builtins.h"
 #include "miscadmin.h"
 
@@ -38,6 +39,10 @@ typedef struct
 	OIndexDescr *toast;
 } OTableToastArg;
 
+#if PG_VERSION_NUM < 140000
+#define VARHDRSZ_COMPRESSED		offsetof(varattrib_4b, va_compressed.va_data)
+#endif
+
 /*
  * Help functions.
  */
@@ -133,7 +138,7 @@ o_toast_cmp(BTreeDescr *desc,
 			else
 				return field->nullfirst ? 1 : -1;
 		}
-		cmp = o_call_comparator(field->comparator, v1, v2);
+		cmp = o_call_field_comparator(field, v1, v2);
 		if (cmp)
 			return field->ascending ? cmp : -cmp;
 	}
@@ -224,6 +229,112 @@ o_detoast(struct varlena *attr)
 										  ote.toasted_size, ote.csn);
 }
 
+/*
+ * Returns the slice of the value referenced by orioledb TOAST pointer.  For
+ * uncompressed values only the chunks covering the slice are fetched.  For
+ * compressed values, the prefix of compressed data needed to decompress the
+ * slice is fetched.  Negative slicelength means the rest of the value.
+ */
+struct varlena *
+o_detoast_slice(struct varlena *attr, int32 sliceoffset, int32 slicelength)
+{
+	OToastExternal ote;
+	ORelOids	oids;
+	OTableDescr *descr;
+	OFixedKey	key;
+	OToastKey	tkey;
+	OTableToastArg arg;
+	struct varlena *result;
+	Pointer		data;
+	Size		fetch_size;
+
+	memcpy(&ote, VARDATA_EXTERNAL(attr), O_TOAST_EXTERNAL_SZ);
+	oids.datoid = ote.datoid;
+	oids.reloid = ote.relid;
+	oids.relnode = ote.relnode;
+	descr = o_fetch_table_descr(oids);
+
+	Assert(descr);
+
+	o_btree_load_shmem(&descr->toast->desc);
+	key.tuple.formatFlags = ote.formatFlags;
+	key.tuple.data = key.fixedData;
+	memcpy(key.fixedData,
+		   VARDATA_EXTERNAL(attr) + O_TOAST_EXTERNAL_SZ,
+		   ote.data_size);
+
+	tkey.pk_tuple = key.tuple;
+	tkey.attnum = ote.attnum;
+	tkey.offset = 0;
+	arg.pk = GET_PRIMARY(descr);
+	arg.toast = descr->toast;
+
+	/* fetch the header first to find out how the value is stored */
+	data = generic_toast_get_slice(&tableToastAPI, &tkey, ote.toasted_size,
+								   0, Min(ote.toasted_size, VARHDRSZ_COMPRESSED),
+								   ote.csn, &arg);
+	if (data == NULL)
+		return NULL;
+
+	if (!VARATT_IS_COMPRESSED(data))
+	{
+		int32		rawsize = ote.toasted_size - VARHDRSZ;
+
+		pfree(data);
+		if (sliceoffset >= rawsize)
+			sliceoffset = slicelength = 0;
+		else if (slicelength < 0 || sliceoffset + slicelength > rawsize)
+			slicelength = rawsize - sliceoffset;
+
+		result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+		SET_VARSIZE(result, slicelength + VARHDRSZ);
+		if (slicelength > 0)
+		{
+			tkey.offset = 0;
+			data = generic_toast_get_slice(&tableToastAPI, &tkey,
+										   ote.toasted_size,
+										   VARHDRSZ + sliceoffset, slicelength,
+										   ote.csn, &arg);
+			if (data == NULL)
+			{
+				pfree(result);
+				return NULL;
+			}
+			memcpy(VARDATA(result), data, slicelength);
+			pfree(data);
+		}
+		return result;
+	}
+
+	fetch_size = ote.toasted_size;
+#if PG_VERSION_NUM >= 140000
+	if (slicelength >= 0 &&
+		VARDATA_COMPRESSED_GET_COMPRESS_METHOD(data) == TOAST_PGLZ_COMPRESSION_ID)
+#else
+	if (slicelength >= 0)
+#endif
+		fetch_size = Min(fetch_size,
+						 VARHDRSZ_COMPRESSED +
+						 pglz_maximum_compressed_size(sliceoffset + slicelength,
+													  ote.toasted_size -
+													  VARHDRSZ_COMPRESSED));
+	pfree(data);
+
+	tkey.offset = 0;
+	data = generic_toast_get_slice(&tableToastAPI, &tkey, ote.toasted_size,
+								   0, fetch_size, ote.csn, &arg);
+	if (data == NULL)
+		return NULL;
+
+	/* the compressed prefix is decompressed without completeness check */
+	result = (struct varlena *) data;
+	SET_VARSIZE_COMPRESSED(result, fetch_size);
+	result = detoast_attr_slice(result, sliceoffset, slicelength);
+	pfree(data);
+
+	return result;
+}
+
 static BTreeDescr *
 tableGetBTreeDesc(void *arg)
 {
@@ -745,6 +856,94 @@ generic_toast_get(ToastAPI *api, void *key, Size data_size,
 	return data;
 }
 
+/*
+ * Fetches only the slice [slice_offset, slice_offset + slice_length) of the
+ * TOASTed value of data_size bytes.  The chunk containing slice_offset is
+ * located by the key, so the chunks before the slice are not read at all.
+ * Returns NULL if the value is not found.
+ */
+Pointer
+generic_toast_get_slice(ToastAPI *api, void *key, Size data_size,
+						Size slice_offset, Size slice_length,
+						CommitSeqNo csn, void *arg)
+{
+	BTreeDescr *desc = api->getBTreeDesc(arg);
+	BTreeIterator *it;
+	void	   *nextKey;
+	uint32		max_length = api->getMaxChunkSize(key, arg);
+	Size		actual_size = 0;
+	Pointer		data;
+	bool		first = true;
+
+	if (slice_offset >= data_size)
+		return palloc(1);
+	slice_length = Min(slice_length, data_size - slice_offset);
+
+	nextKey = api->getNextKey(key, arg);
+
+	/* all chunks except the last one are of max_length */
+	api->updateKey(key, slice_offset - slice_offset % max_length, arg);
+
+	it = o_btree_iterator_create(desc, key, BTreeKeyBound,
+								 csn, ForwardScanDirection);
+	if (api->versionCallback)
+		o_btree_iterator_set_callback(it, api->versionCallback, (void *) key);
+
+	data = palloc(slice_length);
+
+	while (actual_size < slice_length)
+	{
+		OTuple		tup;
+		uint32		chunk_offset,
+					chunk_size;
+		Size		from,
+					len;
+
+		tup = o_btree_iterator_fetch(it, NULL, nextKey, BTreeKeyBound, false,
+									 NULL);
+
+		if (O_TUPLE_IS_NULL(tup))
+			break;
+
+		chunk_offset = api->getTupleOffset(tup, arg);
+		chunk_size = api->getTupleDataSize(tup, arg);
+
+		if (first && chunk_offset > slice_offset)
+		{
+			/* chunks are split differently, restart from the beginning */
+			pfree(tup.data);
+			btree_iterator_free(it);
+			api->updateKey(key, 0, arg);
+			it = o_btree_iterator_create(desc, key, BTreeKeyBound,
+										 csn, ForwardScanDirection);
+			if (api->versionCallback)
+				o_btree_iterator_set_callback(it, api->versionCallback,
+											  (void *) key);
+			first = false;
+			continue;
+		}
+		first = false;
+
+		if (chunk_offset + chunk_size > slice_offset + actual_size)
+		{
+			from = slice_offset + actual_size - chunk_offset;
+			len = Min(chunk_size - from, slice_length - actual_size);
+			memcpy(data + actual_size, api->getTupleData(tup, arg) + from, len);
+			actual_size += len;
+		}
+		pfree(tup.data);
+	}
+
+	btree_iterator_free(it);
+
+	if (actual_size != slice_length)
+	{
+		pfree(data);
+		return NULL;
+	}
+	return data;
+}
+
 /*
  * Common code for
  * generic_toast_get_any_with_callback and generic_toast_get_any_with_key
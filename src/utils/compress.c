@@ -14,17 +14,76 @@
 
 #include "orioledb.h"
 
+#include "btree/io.h"
 #include "utils/compress.h"
 
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
 #include "utils/elog.h"
+#include "utils/hsearch.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 
+#include <unistd.h>
+#include <lz4.h>
 #include <zstd.h>
+#include <zdict.h>
+
+/*
+ * Dictionaries are stored per BTree in "<relnode>-<dictid>.dict" files.
+ * "<relnode>-0.dict" holds a copy of the dictionary used for compression of
+ * new page images.  Dictionaries are never modified once written, so pages
+ * compressed with an older dictionary remain readable.
+ */
+#define O_DICT_FILENAME (ORIOLEDB_DATA_DIR "/%u/%u-%u.dict")
+#define O_DICT_MIN_SAMPLES (16)
+
+typedef struct
+{
+	Oid			datoid;
+	Oid			relnode;
+	uint32		dictId;
+} ODictKey;
+
+typedef struct
+{
+	ODictKey	key;
+
+	/* for dictId == 0: id of the current dictionary and generation seen */
+	uint32		currentDictId;
+	uint64		generation;
+
+	/* for dictId != 0: dictionary itself */
+	Pointer		data;
+	size_t		size;
+	ZSTD_CDict *cdict;
+	OCompress	cdictLvl;
+	ZSTD_DDict *ddict;
+} ODictEntry;
 
 static ZSTD_CCtx *zstd_cctx = NULL;
 static ZSTD_DCtx *zstd_dctx = NULL;
 static size_t zstd_dst_size;
 static Pointer zstd_dst = NULL;
+static HTAB *dicts = NULL;
+static pg_atomic_uint64 *dictsGeneration = NULL;
+
+Size
+o_compress_shmem_needs(void)
+{
+	return CACHELINEALIGN(sizeof(pg_atomic_uint64));
+}
+
+void
+o_compress_shmem_init(Pointer ptr, bool found)
+{
+	dictsGeneration = (pg_atomic_uint64 *) ptr;
+
+	if (!found)
+		pg_atomic_init_u64(dictsGeneration, 0);
+}
 
 /*
  * Initializes compression context.
@@ -34,7 +93,8 @@ o_compress_init(void)
 {
 	zstd_cctx = ZSTD_createCCtx();
 	zstd_dctx = ZSTD_createDCtx();
-	zstd_dst_size = ZSTD_compressBound(ORIOLEDB_BLCKSZ);
+	zstd_dst_size = Max(ZSTD_compressBound(ORIOLEDB_BLCKSZ),
+						LZ4_compressBound(ORIOLEDB_BLCKSZ));
 	zstd_dst = malloc(zstd_dst_size);
 
 	/*
@@ -48,17 +108,214 @@ o_compress_init(void)
 	VALGRIND_MAKE_MEM_DEFINED(zstd_dst, ORIOLEDB_BLCKSZ);
 }
 
+static ODictEntry *
+dict_get_entry(Oid datoid, Oid relnode, uint32 dictId, bool *found)
+{
+	ODictKey	key;
+
+	if (dicts == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ODictKey);
+		ctl.entrysize = sizeof(ODictEntry);
+		ctl.hcxt = TopMemoryContext;
+		dicts = hash_create("orioledb compression dictionaries", 16, &ctl,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.datoid = datoid;
+	key.relnode = relnode;
+	key.dictId = dictId;
+
+	return (ODictEntry *) hash_search(dicts, &key, HASH_ENTER, found);
+}
+
+/*
+ * Reads the dictionary file.  Returns NULL if the file doesn't exist.
+ */
+static Pointer
+dict_read_file(Oid datoid, Oid relnode, uint32 dictId, size_t *size)
+{
+	char	   *filename;
+	File		file;
+	off_t		fileSize;
+	Pointer		data;
+
+	filename = psprintf(O_DICT_FILENAME, datoid, relnode, dictId);
+	file = PathNameOpenFile(filename, O_RDONLY | PG_BINARY);
+	if (file < 0)
+	{
+		pfree(filename);
+		return NULL;
+	}
+
+	fileSize = FileSize(file);
+	if (fileSize <= 0)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("invalid compression dictionary file %s",
+							   filename)));
+
+	data = MemoryContextAlloc(TopMemoryContext, fileSize);
+	if (OFileRead(file, data, fileSize, 0, WAIT_EVENT_DATA_FILE_READ) != fileSize)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not read compression dictionary file %s",
+							   filename)));
+	FileClose(file);
+	pfree(filename);
+
+	*size = fileSize;
+	return data;
+}
+
+static void
+dict_entry_set_data(ODictEntry *entry, Pointer data, size_t size)
+{
+	entry->data = NULL;
+	entry->cdict = NULL;
+	entry->cdictLvl = InvalidOCompress;
+	entry->ddict = ZSTD_createDDict(data, size);
+	if (entry->ddict == NULL)
+		elog(ERROR, "unable to load compression dictionary");
+	entry->data = data;
+	entry->size = size;
+}
+
+/*
+ * Returns the dictionary with given id, loading it from disk if needed.
+ */
+static ODictEntry *
+dict_get(Oid datoid, Oid relnode, uint32 dictId)
+{
+	ODictEntry *entry;
+	bool		found;
+	Pointer		data;
+	size_t		size;
+
+	entry = dict_get_entry(datoid, relnode, dictId, &found);
+	if (found && entry->data != NULL)
+		return entry;
+
+	entry->data = NULL;
+	data = dict_read_file(datoid, relnode, dictId, &size);
+	if (data == NULL)
+	{
+		hash_search(dicts, &entry->key, HASH_REMOVE, NULL);
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("compression dictionary %u of relnode %u is missing",
+							   dictId, relnode)));
+	}
+	dict_entry_set_data(entry, data, size);
+	return entry;
+}
+
+/*
+ * Returns the dictionary to compress new images of the given tree with or
+ * NULL if the tree has no dictionary.
+ */
+static ODictEntry *
+dict_get_current(Oid datoid, Oid relnode)
+{
+	ODictEntry *current,
+			   *entry;
+	bool		found;
+	uint64		generation = pg_atomic_read_u64(dictsGeneration);
+	Pointer		data;
+	size_t		size;
+	uint32		dictId;
+
+	current = dict_get_entry(datoid, relnode, 0, &found);
+	if (found && current->generation == generation)
+	{
+		if (current->currentDictId == 0)
+			return NULL;
+		return dict_get(datoid, relnode, current->currentDictId);
+	}
+
+	current->currentDictId = 0;
+	current->generation = generation;
+	current->data = NULL;
+
+	data = dict_read_file(datoid, relnode, 0, &size);
+	if (data == NULL)
+		return NULL;
+
+	dictId = ZDICT_getDictID(data, size);
+	if (dictId == 0)
+	{
+		pfree(data);
+		return NULL;
+	}
+
+	entry = dict_get_entry(datoid, relnode, dictId, &found);
+	if (found && entry->data != NULL)
+		pfree(data);
+	else
+		dict_entry_set_data(entry, data, size);
+	current->currentDictId = dictId;
+
+	return entry;
+}
+
 /*
- * Compresses a BTree page.
+ * Compresses a BTree page with LZ4.
+ */
+static Pointer
+o_compress_page_lz4(Pointer page, size_t *size)
+{
+	int			result;
+
+	VALGRIND_CHECK_MEM_IS_DEFINED(page, ORIOLEDB_BLCKSZ);
+	result = LZ4_compress_default(page, zstd_dst, ORIOLEDB_BLCKSZ,
+								  zstd_dst_size);
+	if (result <= 0)
+		elog(PANIC, "Unable to compress page with LZ4");
+	VALGRIND_MAKE_MEM_DEFINED(zstd_dst, result);
+
+	*size = result;
+	return zstd_dst;
+}
+
+/*
+ * Compresses a BTree page.  zstd uses the tree dictionary if it has one.
  */
 Pointer
-o_compress_page(Pointer page, size_t *size, OCompress lvl)
+o_compress_page(Pointer page, size_t *size, OCompress lvl,
+				Oid datoid, Oid relnode)
 {
+	ODictEntry *dict;
+
+	if (OCompressIsLZ4(lvl))
+		return o_compress_page_lz4(page, size);
+
+	dict = dict_get_current(datoid, relnode);
+
 	VALGRIND_CHECK_MEM_IS_DEFINED(page, ORIOLEDB_BLCKSZ);
-	*size = ZSTD_compressCCtx(zstd_cctx,
-							  zstd_dst, zstd_dst_size,
-							  page, ORIOLEDB_BLCKSZ,
-							  lvl);
+	if (dict)
+	{
+		if (dict->cdict == NULL || dict->cdictLvl != lvl)
+		{
+			if (dict->cdict)
+				ZSTD_freeCDict(dict->cdict);
+			dict->cdict = ZSTD_createCDict(dict->data, dict->size, lvl);
+			dict->cdictLvl = lvl;
+			if (dict->cdict == NULL)
+				elog(ERROR, "unable to load compression dictionary");
+		}
+		*size = ZSTD_compress_usingCDict(zstd_cctx,
+										 zstd_dst, zstd_dst_size,
+										 page, ORIOLEDB_BLCKSZ,
+										 dict->cdict);
+	}
+	else
+	{
+		*size = ZSTD_compressCCtx(zstd_cctx,
+								  zstd_dst, zstd_dst_size,
+								  page, ORIOLEDB_BLCKSZ,
+								  lvl);
+	}
 	VALGRIND_MAKE_MEM_DEFINED(zstd_dst, *size);
 	if (ZSTD_isError(*size))
 	{
@@ -70,16 +327,43 @@ o_compress_page(Pointer page, size_t *size, OCompress lvl)
 }
 
 /*
- * Decompresses a BTree page.
+ * Decompresses a BTree page.  The codec is taken from the compression header.
+ * zstd dictionary is located by the id stored in the frame header.
  */
 void
-o_decompress_page(Pointer src, size_t size, Pointer page)
+o_decompress_page(Pointer src, OCompressHeader header, Pointer page,
+				  Oid datoid, Oid relnode)
 {
 	size_t		result;
+	size_t		size = O_COMPRESS_HEADER_GET_SIZE(header);
+	uint32		dictId;
+
+	if (header & O_COMPRESS_HEADER_LZ4)
+	{
+		int			lz4result;
+
+		lz4result = LZ4_decompress_safe(src, page, size, ORIOLEDB_BLCKSZ);
+		if (lz4result != ORIOLEDB_BLCKSZ)
+			elog(PANIC, "Unable to decompress page with LZ4");
+		return;
+	}
 
-	result = ZSTD_decompressDCtx(zstd_dctx,
-								 page, ORIOLEDB_BLCKSZ,
-								 src, size);
+	dictId = ZSTD_getDictID_fromFrame(src, size);
+	if (dictId != 0)
+	{
+		ODictEntry *dict = dict_get(datoid, relnode, dictId);
+
+		result = ZSTD_decompress_usingDDict(zstd_dctx,
+											page, ORIOLEDB_BLCKSZ,
+											src, size,
+											dict->ddict);
+	}
+	else
+	{
+		result = ZSTD_decompressDCtx(zstd_dctx,
+									 page, ORIOLEDB_BLCKSZ,
+									 src, size);
+	}
 	if (ZSTD_isError(result))
 	{
 		elog(PANIC,
@@ -89,6 +373,74 @@ o_decompress_page(Pointer src, size_t size, Pointer page)
 	Assert(result == ORIOLEDB_BLCKSZ);
 }
 
+static void
+dict_write_file(Oid datoid, Oid relnode, uint32 dictId,
+				Pointer data, size_t size)
+{
+	char	   *filename,
+			   *tmpFilename;
+	File		file;
+
+	filename = psprintf(O_DICT_FILENAME, datoid, relnode, dictId);
+	tmpFilename = psprintf("%s.%d.tmp", filename, MyProcPid);
+
+	file = PathNameOpenFile(tmpFilename, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+	if (file < 0)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not create compression dictionary file %s",
+							   tmpFilename)));
+	if (OFileWrite(file, data, size, 0, WAIT_EVENT_DATA_FILE_WRITE) != size ||
+		FileSync(file, WAIT_EVENT_DATA_FILE_SYNC) != 0)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not write compression dictionary file %s",
+							   tmpFilename)));
+	FileClose(file);
+
+	durable_rename(tmpFilename, filename, ERROR);
+
+	pfree(tmpFilename);
+	pfree(filename);
+}
+
+/*
+ * Trains a new dictionary for the tree from the given page samples and makes
+ * it current.  Returns false if samples are not enough to train the
+ * dictionary.
+ */
+bool
+o_compress_train_dict(Oid datoid, Oid relnode, Pointer samples, size_t *sizes,
+					  int nsamples)
+{
+	Pointer		dict;
+	size_t		size;
+	uint32		dictId;
+
+	if (nsamples < O_DICT_MIN_SAMPLES)
+		return false;
+
+	dict = palloc(O_COMPRESS_DICT_SIZE);
+	size = ZDICT_trainFromBuffer(dict, O_COMPRESS_DICT_SIZE,
+								 samples, sizes, nsamples);
+	if (ZDICT_isError(size))
+	{
+		elog(DEBUG1, "unable to train compression dictionary, reason: %s",
+			 ZDICT_getErrorName(size));
+		pfree(dict);
+		return false;
+	}
+
+	dictId = ZDICT_getDictID(dict, size);
+	Assert(dictId != 0);
+
+	/* first write the dictionary itself then make it current */
+	dict_write_file(datoid, relnode, dictId, dict, size);
+	dict_write_file(datoid, relnode, 0, dict, size);
+	pg_atomic_fetch_add_u64(dictsGeneration, 1);
+
+	pfree(dict);
+	return true;
+}
+
 /*
  * Returns max orioledb compression level.
  */
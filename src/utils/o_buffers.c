@@ -18,12 +18,38 @@
 
 #include "btree/btree.h"
 #include "btree/io.h"
+#include "utils/compress.h"
 #include "utils/o_buffers.h"
 
 #include "pgstat.h"
 
 #define O_BUFFERS_PER_GROUP 4
 
+/*
+ * Sequential access detection.  After O_BUFFERS_SEQ_THRESHOLD consecutive
+ * block reads in the same direction, we ask the kernel to read ahead the next
+ * O_BUFFERS_READ_AHEAD blocks.  The blocks are prefetched into the OS page
+ * cache, not into the buffers: there are few buffers, and loading them ahead
+ * would evict the buffers in use.  Completely written blocks of sequential
+ * writes are written out and their writeback is started in batches of
+ * O_BUFFERS_WRITEBACK_BLOCKS, so that neither eviction of the buffers nor
+ * o_buffers_sync() have much to wait for.
+ */
+#define O_BUFFERS_SEQ_THRESHOLD 2
+#define O_BUFFERS_READ_AHEAD 16
+#define O_BUFFERS_WRITEBACK_BLOCKS 32
+
+/*
+ * When compression is enabled, every block has a fixed slot in the file,
+ * which starts with OCompressHeader containing the length of LZ4 image.
+ * Header value of zero means the slot was never written, and the
+ * O_BUFFERS_RAW_BLOCK value means that the block is stored uncompressed.
+ * Only the header and the image are written, so the rest of the slot remains
+ * the file hole.
+ */
+#define O_BUFFERS_SLOT_SIZE (sizeof(OCompressHeader) + ORIOLEDB_BLCKSZ)
+#define O_BUFFERS_RAW_BLOCK ((OCompressHeader) ORIOLEDB_BLCKSZ)
+
 struct OBuffersMeta
 {
 	int			groupCtlTrancheId;
@@ -66,6 +92,13 @@ o_buffers_shmem_init(OBuffersDesc *desc, void *buf, bool found)
 	desc->groups = (OBuffersGroup *) ptr;
 	desc->groupsCount = (desc->buffersCount + O_BUFFERS_PER_GROUP - 1) / O_BUFFERS_PER_GROUP;
 	desc->curFile = -1;
+	desc->lastReadBlockNum = -1;
+	desc->readAheadBlockNum = -1;
+	desc->readDirection = 0;
+	desc->seqReadCount = 0;
+	desc->lastWriteEnd = -1;
+	desc->writebackStart = -1;
+	desc->writebackEnd = -1;
 
 	Assert((desc->singleFileSize % ORIOLEDB_BLCKSZ) == 0);
 
@@ -135,11 +168,70 @@ unlink_file(OBuffersDesc *desc, uint64 fileNum)
 	(void) unlink(fileNameToUnlink);
 }
 
+/*
+ * Returns the offset of the block within its file.  The block slot size is
+ * returned in *slotSize.
+ */
+static off_t
+block_file_offset(OBuffersDesc *desc, int64 blockNum, int *slotSize)
+{
+	uint64		blocksPerFile = desc->singleFileSize / ORIOLEDB_BLCKSZ;
+
+	if (desc->compress)
+	{
+		*slotSize = O_BUFFERS_SLOT_SIZE;
+		return (off_t) (blockNum % blocksPerFile) * O_BUFFERS_SLOT_SIZE;
+	}
+	*slotSize = ORIOLEDB_BLCKSZ;
+	return (off_t) (blockNum % blocksPerFile) * ORIOLEDB_BLCKSZ;
+}
+
+static void
+write_compressed_buffer_data(OBuffersDesc *desc, char *data, uint64 blockNum)
+{
+	static char slot[O_BUFFERS_SLOT_SIZE];
+	uint64		blocksPerFile = desc->singleFileSize / ORIOLEDB_BLCKSZ;
+	OCompressHeader header;
+	Pointer		image;
+	size_t		size;
+	int			result;
+
+	image = o_compress_page(data, &size, O_COMPRESS_LZ4,
+							InvalidOid, InvalidOid);
+	if (size >= ORIOLEDB_BLCKSZ)
+	{
+		image = data;
+		size = ORIOLEDB_BLCKSZ;
+		header = O_BUFFERS_RAW_BLOCK;
+	}
+	else
+	{
+		header = (OCompressHeader) size;
+	}
+	memcpy(slot, &header, sizeof(header));
+	memcpy(slot + sizeof(header), image, size);
+	size += sizeof(header);
+
+	open_file(desc, blockNum / blocksPerFile);
+	result = OFileWrite(desc->curFile, slot, size,
+						(blockNum % blocksPerFile) * O_BUFFERS_SLOT_SIZE,
+						WAIT_EVENT_SLRU_WRITE);
+	if (result != (int) size)
+		ereport(PANIC, (errcode_for_file_access(),
+						errmsg("could not write buffer to file %s", desc->curFileName)));
+}
+
 static void
 write_buffer_data(OBuffersDesc *desc, char *data, uint64 blockNum)
 {
 	int			result;
 
+	if (desc->compress)
+	{
+		write_compressed_buffer_data(desc, data, blockNum);
+		return;
+	}
+
 	open_file(desc, blockNum / (desc->singleFileSize / ORIOLEDB_BLCKSZ));
 	result = OFileWrite(desc->curFile, data, ORIOLEDB_BLCKSZ,
 						(blockNum * ORIOLEDB_BLCKSZ) % desc->singleFileSize,
@@ -155,11 +247,59 @@ write_buffer(OBuffersDesc *desc, OBuffer *buffer)
 	write_buffer_data(desc, buffer->data, buffer->blockNum);
 }
 
+static void
+read_compressed_buffer(OBuffersDesc *desc, OBuffer *buffer)
+{
+	static char slot[O_BUFFERS_SLOT_SIZE];
+	uint64		blocksPerFile = desc->singleFileSize / ORIOLEDB_BLCKSZ;
+	OCompressHeader header = 0;
+	int			result;
+
+	open_file(desc, buffer->blockNum / blocksPerFile);
+	result = OFileRead(desc->curFile, slot, O_BUFFERS_SLOT_SIZE,
+					   (buffer->blockNum % blocksPerFile) * O_BUFFERS_SLOT_SIZE,
+					   WAIT_EVENT_SLRU_READ);
+
+	if (result < 0)
+		ereport(PANIC, (errcode_for_file_access(),
+						errmsg("could not read buffer from file %s", desc->curFileName)));
+
+	if (result >= sizeof(header))
+		memcpy(&header, slot, sizeof(header));
+
+	if (header == 0)
+	{
+		/* the slot was never written */
+		memset(buffer->data, 0, ORIOLEDB_BLCKSZ);
+	}
+	else if (header == O_BUFFERS_RAW_BLOCK)
+	{
+		if (result != O_BUFFERS_SLOT_SIZE)
+			ereport(PANIC, (errcode_for_file_access(),
+							errmsg("could not read buffer from file %s", desc->curFileName)));
+		memcpy(buffer->data, slot + sizeof(header), ORIOLEDB_BLCKSZ);
+	}
+	else
+	{
+		if (header > ORIOLEDB_BLCKSZ || result < sizeof(header) + header)
+			ereport(PANIC, (errcode_for_file_access(),
+							errmsg("could not read buffer from file %s", desc->curFileName)));
+		o_decompress_page(slot + sizeof(header), header | O_COMPRESS_HEADER_LZ4,
+						  buffer->data, InvalidOid, InvalidOid);
+	}
+}
+
 static void
 read_buffer(OBuffersDesc *desc, OBuffer *buffer)
 {
 	int			result;
 
+	if (desc->compress)
+	{
+		read_compressed_buffer(desc, buffer);
+		return;
+	}
+
 	open_file(desc, buffer->blockNum / (desc->singleFileSize / ORIOLEDB_BLCKSZ));
 	result = OFileRead(desc->curFile, buffer->data, ORIOLEDB_BLCKSZ,
 					   (buffer->blockNum * ORIOLEDB_BLCKSZ) % desc->singleFileSize,
@@ -259,6 +399,190 @@ get_buffer(OBuffersDesc *desc, int64 blockNum, bool write)
 	return buffer;
 }
 
+/*
+ * Hints the kernel to read the given range of blocks.  The range must
+ * belong to a single file.
+ */
+static void
+prefetch_blocks(OBuffersDesc *desc, int64 firstBlockNum, int64 lastBlockNum)
+{
+	uint64		blocksPerFile = desc->singleFileSize / ORIOLEDB_BLCKSZ;
+	off_t		offset;
+	int			slotSize;
+
+	Assert(firstBlockNum / blocksPerFile == lastBlockNum / blocksPerFile);
+	offset = block_file_offset(desc, firstBlockNum, &slotSize);
+	open_file(desc, firstBlockNum / blocksPerFile);
+	(void) FilePrefetch(desc->curFile, offset,
+						(lastBlockNum - firstBlockNum + 1) * slotSize,
+						WAIT_EVENT_SLRU_READ);
+}
+
+/*
+ * Tracks the pattern of block reads and reads ahead the blocks following the
+ * sequential access in either direction.  Read-ahead doesn't cross the
+ * boundary of the file being read: the neighboring file might be not yet
+ * created or already unlinked, and open_file() would create it.
+ */
+static void
+read_ahead(OBuffersDesc *desc, int64 blockNum)
+{
+	uint64		blocksPerFile = desc->singleFileSize / ORIOLEDB_BLCKSZ;
+	int64		fileFirstBlockNum = blockNum - blockNum % blocksPerFile;
+	int64		fileLastBlockNum = fileFirstBlockNum + blocksPerFile - 1;
+	int64		firstBlockNum,
+				lastBlockNum;
+	int			direction;
+
+	if (blockNum == desc->lastReadBlockNum)
+		return;
+
+	if (desc->lastReadBlockNum >= 0 && blockNum == desc->lastReadBlockNum + 1)
+		direction = 1;
+	else if (desc->lastReadBlockNum >= 0 && blockNum == desc->lastReadBlockNum - 1)
+		direction = -1;
+	else
+		direction = 0;
+
+	desc->lastReadBlockNum = blockNum;
+	if (direction == 0 || direction != desc->readDirection)
+	{
+		desc->readDirection = direction;
+		desc->seqReadCount = 0;
+		desc->readAheadBlockNum = -1;
+		return;
+	}
+
+	if (++desc->seqReadCount < O_BUFFERS_SEQ_THRESHOLD)
+		return;
+
+	/*
+	 * Prefetch the window ahead of the current block, which wasn't prefetched
+	 * before.  Refill it once the reader has consumed the half of it, so that
+	 * the prefetch requests are issued in batches.
+	 */
+	if (direction > 0)
+	{
+		if (desc->readAheadBlockNum >= blockNum + O_BUFFERS_READ_AHEAD / 2)
+			return;
+		firstBlockNum = Max(blockNum + 1, desc->readAheadBlockNum + 1);
+		lastBlockNum = Min(blockNum + O_BUFFERS_READ_AHEAD, fileLastBlockNum);
+		desc->readAheadBlockNum = lastBlockNum;
+	}
+	else
+	{
+		if (desc->readAheadBlockNum >= 0 &&
+			desc->readAheadBlockNum <= blockNum - O_BUFFERS_READ_AHEAD / 2)
+			return;
+		firstBlockNum = Max(blockNum - O_BUFFERS_READ_AHEAD, fileFirstBlockNum);
+		lastBlockNum = desc->readAheadBlockNum >= 0 ?
+			Min(blockNum - 1, desc->readAheadBlockNum - 1) : blockNum - 1;
+		desc->readAheadBlockNum = firstBlockNum;
+	}
+
+	if (firstBlockNum <= lastBlockNum)
+		prefetch_blocks(desc, firstBlockNum, lastBlockNum);
+}
+
+/*
+ * Starts the writeback of the pending range of written out blocks.
+ */
+static void
+writeback_blocks(OBuffersDesc *desc)
+{
+	uint64		blocksPerFile = desc->singleFileSize / ORIOLEDB_BLCKSZ;
+	off_t		offset;
+	int			slotSize;
+
+	if (desc->writebackStart < 0)
+		return;
+
+	/* pending range never crosses the file boundary */
+	Assert(desc->writebackStart / blocksPerFile == desc->writebackEnd / blocksPerFile);
+	offset = block_file_offset(desc, desc->writebackStart, &slotSize);
+	open_file(desc, desc->writebackStart / blocksPerFile);
+	FileWriteback(desc->curFile, offset,
+				  (desc->writebackEnd - desc->writebackStart + 1) * slotSize,
+				  WAIT_EVENT_SLRU_FLUSH_SYNC);
+	desc->writebackStart = -1;
+	desc->writebackEnd = -1;
+}
+
+/*
+ * Writes out the completely written block if it's still dirty in the
+ * buffers and adds it to the pending writeback range.
+ */
+static void
+write_behind_block(OBuffersDesc *desc, int64 blockNum)
+{
+	OBuffersGroup *group = &desc->groups[blockNum % desc->groupsCount];
+	uint64		blocksPerFile = desc->singleFileSize / ORIOLEDB_BLCKSZ;
+	OBuffer    *buffer = NULL;
+	bool		written = false;
+	int			i;
+
+	LWLockAcquire(&group->groupCtlLock, LW_SHARED);
+	for (i = 0; i < O_BUFFERS_PER_GROUP; i++)
+	{
+		if (group->buffers[i].blockNum == blockNum)
+		{
+			buffer = &group->buffers[i];
+			LWLockAcquire(&buffer->bufferCtlLock, LW_SHARED);
+			break;
+		}
+	}
+	LWLockRelease(&group->groupCtlLock);
+
+	if (buffer)
+	{
+		if (buffer->dirty && buffer->blockNum == blockNum)
+		{
+			write_buffer(desc, buffer);
+			buffer->dirty = false;
+			written = true;
+		}
+		LWLockRelease(&buffer->bufferCtlLock);
+	}
+
+	if (!written)
+		return;
+
+	if (desc->writebackStart >= 0 &&
+		(blockNum != desc->writebackEnd + 1 ||
+		 blockNum / blocksPerFile != desc->writebackStart / blocksPerFile))
+		writeback_blocks(desc);
+
+	if (desc->writebackStart < 0)
+		desc->writebackStart = blockNum;
+	desc->writebackEnd = blockNum;
+
+	if (desc->writebackEnd - desc->writebackStart + 1 >= O_BUFFERS_WRITEBACK_BLOCKS)
+		writeback_blocks(desc);
+}
+
+/*
+ * Writes behind the blocks completed by the write of the given range.  The
+ * first block is considered complete only if the write continues the
+ * previous one.
+ */
+static void
+write_behind(OBuffersDesc *desc, int64 offset, int64 size)
+{
+	int64		firstBlockNum,
+				lastBlockNum,
+				blockNum;
+
+	if (offset == desc->lastWriteEnd)
+		firstBlockNum = offset / ORIOLEDB_BLCKSZ;
+	else
+		firstBlockNum = (offset + ORIOLEDB_BLCKSZ - 1) / ORIOLEDB_BLCKSZ;
+	lastBlockNum = (offset + size) / ORIOLEDB_BLCKSZ - 1;
+	desc->lastWriteEnd = offset + size;
+
+	for (blockNum = firstBlockNum; blockNum <= lastBlockNum; blockNum++)
+		write_behind_block(desc, blockNum);
+}
+
 static void
 o_buffers_rw(OBuffersDesc *desc, Pointer buf,
 			 int64 offset, int64 size,
@@ -271,10 +595,14 @@ o_buffers_rw(OBuffersDesc *desc, Pointer buf,
 
 	for (blockNum = firstBlockNum; blockNum <= lastBlockNum; blockNum++)
 	{
-		OBuffer    *buffer = get_buffer(desc, blockNum, write);
+		OBuffer    *buffer;
 		uint32		copySize,
 					copyOffset;
 
+		if (!write)
+			read_ahead(desc, blockNum);
+		buffer = get_buffer(desc, blockNum, write);
+
 		if (firstBlockNum == lastBlockNum)
 		{
 			copySize = size;
@@ -322,6 +650,7 @@ o_buffers_write(OBuffersDesc *desc, Pointer buf, int64 offset, int64 size)
 {
 	Assert(offset >= 0 && size > 0);
 	o_buffers_rw(desc, buf, offset, size, true);
+	write_behind(desc, offset, size);
 }
 
 static void
@@ -400,6 +729,10 @@ o_buffers_sync(OBuffersDesc *desc,
 
 	o_buffers_flush(desc, firstPageNumber, lastPageNumber);
 
+	/* the pending writeback is superseded by fsync */
+	desc->writebackStart = -1;
+	desc->writebackEnd = -1;
+
 	firstFileNumber = fromOffset / desc->singleFileSize;
 	lastFileNumber = toOffset / desc->singleFileSize;
 	if (toOffset % desc->singleFileSize == 0)
@@ -418,6 +751,10 @@ o_buffers_unlink_files_range(OBuffersDesc *desc,
 {
 	int64		fileNumber;
 
+	/* don't start writeback of the unlinked files */
+	desc->writebackStart = -1;
+	desc->writebackEnd = -1;
+
 	o_buffers_wipe(desc,
 				   firstFileNumber * (desc->singleFileSize / ORIOLEDB_BLCKSZ),
 				   (lastFileNumber + 1) * (desc->singleFileSize / ORIOLEDB_BLCKSZ) - 1);
@@ -0,0 +1,298 @@
+/*-------------------------------------------------------------------------
+ *
+ * o_latency.c
+ *		Latency histograms of OrioleDB operations.
+ *
+ * The histograms cover the slow paths, whose tail latency matters: page
+ * loads, evictions made by backends failed to reserve pages, undo
+ * reservations not served by the local cache, WAL flushes at commit and
+ * page writes by checkpointer.  The buckets are log-scaled: the bucket i
+ * counts operations taking [2^(i-1), 2^i) microseconds, the last bucket is
+ * unbounded.
+ *
+ * Each backend accumulates the histograms locally and adds them to the
+ * shared ones after O_LATENCY_FLUSH_BATCH operations of the kind or once the
+ * last flush is older than O_LATENCY_FLUSH_INTERVAL, so the shared atomics
+ * aren't touched on every operation.  The rest is flushed on backend exit.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/utils/o_latency.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "utils/o_latency.h"
+
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "port/pg_bitutils.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/tuplestore.h"
+
+PG_FUNCTION_INFO_V1(orioledb_latency_stats);
+PG_FUNCTION_INFO_V1(orioledb_latency_stats_reset);
+
+/* Buckets are bounded by 1us, 2us, 4us, ..., 2^24us (~16.8s) */
+#define O_LATENCY_NUM_BOUNDS	25
+#define O_LATENCY_NUM_BUCKETS	(O_LATENCY_NUM_BOUNDS + 1)
+
+#define O_LATENCY_FLUSH_BATCH		32
+#define O_LATENCY_FLUSH_INTERVAL	1.0 /* in seconds */
+
+typedef struct
+{
+	pg_atomic_uint64 count;
+	pg_atomic_uint64 time;		/* in microseconds */
+	pg_atomic_uint64 max;		/* in microseconds */
+	pg_atomic_uint64 buckets[O_LATENCY_NUM_BUCKETS];
+} OLatencySharedStats;
+
+typedef struct
+{
+	uint64		count;
+	uint64		time;
+	uint64		max;
+	uint64		buckets[O_LATENCY_NUM_BUCKETS];
+} OLatencyLocalStats;
+
+static const char *const oLatencyOpNames[] = {
+	"page load",
+	"eviction",
+	"undo reserve",
+	"commit wal",
+	"checkpoint write"
+};
+
+StaticAssertDecl(lengthof(oLatencyOpNames) == OLatencyOpsCount,
+				 "every latency operation must have a name");
+
+static OLatencySharedStats *latency_stats = NULL;
+static OLatencyLocalStats local_latency_stats[OLatencyOpsCount];
+static instr_time last_flush_time;
+
+Size
+o_latency_shmem_needs(void)
+{
+	return CACHELINEALIGN(sizeof(OLatencySharedStats) * OLatencyOpsCount);
+}
+
+static void
+o_latency_reset_shared(void)
+{
+	int			i,
+				j;
+
+	for (i = 0; i < OLatencyOpsCount; i++)
+	{
+		pg_atomic_write_u64(&latency_stats[i].count, 0);
+		pg_atomic_write_u64(&latency_stats[i].time, 0);
+		pg_atomic_write_u64(&latency_stats[i].max, 0);
+		for (j = 0; j < O_LATENCY_NUM_BUCKETS; j++)
+			pg_atomic_write_u64(&latency_stats[i].buckets[j], 0);
+	}
+}
+
+void
+o_latency_shmem_init(Pointer ptr, bool found)
+{
+	int			i,
+				j;
+
+	latency_stats = (OLatencySharedStats *) ptr;
+
+	if (!found)
+	{
+		for (i = 0; i < OLatencyOpsCount; i++)
+		{
+			pg_atomic_init_u64(&latency_stats[i].count, 0);
+			pg_atomic_init_u64(&latency_stats[i].time, 0);
+			pg_atomic_init_u64(&latency_stats[i].max, 0);
+			for (j = 0; j < O_LATENCY_NUM_BUCKETS; j++)
+				pg_atomic_init_u64(&latency_stats[i].buckets[j], 0);
+		}
+	}
+}
+
+/*
+ * Adds the local histogram of the operation to the shared one.
+ */
+static void
+o_latency_flush_op(OLatencyOp op)
+{
+	OLatencyLocalStats *local = &local_latency_stats[op];
+	OLatencySharedStats *shared = &latency_stats[op];
+	uint64		max;
+	int			i;
+
+	if (local->count == 0)
+		return;
+
+	pg_atomic_fetch_add_u64(&shared->count, local->count);
+	pg_atomic_fetch_add_u64(&shared->time, local->time);
+	for (i = 0; i < O_LATENCY_NUM_BUCKETS; i++)
+	{
+		if (local->buckets[i] != 0)
+			pg_atomic_fetch_add_u64(&shared->buckets[i], local->buckets[i]);
+	}
+
+	max = pg_atomic_read_u64(&shared->max);
+	while (local->max > max)
+	{
+		if (pg_atomic_compare_exchange_u64(&shared->max, &max, local->max))
+			break;
+	}
+
+	memset(local, 0, sizeof(*local));
+}
+
+/*
+ * Flushes all the locally accumulated histograms to the shared memory.
+ */
+void
+o_latency_flush(void)
+{
+	int			i;
+
+	if (!latency_stats)
+		return;
+
+	for (i = 0; i < OLatencyOpsCount; i++)
+		o_latency_flush_op(i);
+	INSTR_TIME_SET_CURRENT(last_flush_time);
+}
+
+/*
+ * Accounts the operation started at 'start' (see O_LATENCY_START()).
+ */
+void
+o_latency_report(OLatencyOp op, instr_time start)
+{
+	OLatencyLocalStats *local = &local_latency_stats[op];
+	instr_time	now,
+				duration;
+	uint64		elapsed;
+	int			bucket;
+
+	if (!latency_stats)
+		return;
+
+	INSTR_TIME_SET_CURRENT(now);
+	duration = now;
+	INSTR_TIME_SUBTRACT(duration, start);
+	elapsed = (uint64) INSTR_TIME_GET_MICROSEC(duration);
+
+	if (elapsed == 0)
+		bucket = 0;
+	else
+		bucket = Min(pg_leftmost_one_pos64(elapsed) + 1,
+					 O_LATENCY_NUM_BUCKETS - 1);
+
+	local->count++;
+	local->time += elapsed;
+	local->max = Max(local->max, elapsed);
+	local->buckets[bucket]++;
+
+	if (local->count >= O_LATENCY_FLUSH_BATCH)
+	{
+		o_latency_flush_op(op);
+	}
+	else
+	{
+		duration = now;
+		INSTR_TIME_SUBTRACT(duration, last_flush_time);
+		if (INSTR_TIME_GET_DOUBLE(duration) >= O_LATENCY_FLUSH_INTERVAL)
+			o_latency_flush();
+	}
+}
+
+/*
+ * Returns the latency histograms.  The histogram is an array of the
+ * operation counts per bucket, with the bucket upper bounds given in
+ * microseconds in the separate column, and the last bucket unbounded.
+ */
+Datum
+orioledb_latency_stats(PG_FUNCTION_ARGS)
+{
+	Datum		values[6];
+	bool		nulls[6];
+	Datum		bounds[O_LATENCY_NUM_BOUNDS];
+	int			i,
+				j;
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+
+	orioledb_check_shmem();
+
+	/* Show own operations too */
+	o_latency_flush();
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < O_LATENCY_NUM_BOUNDS; i++)
+		bounds[i] = Int64GetDatum(INT64CONST(1) << i);
+
+	for (i = 0; i < OLatencyOpsCount; i++)
+	{
+		OLatencySharedStats *stats = &latency_stats[i];
+		Datum		buckets[O_LATENCY_NUM_BUCKETS];
+
+		for (j = 0; j < O_LATENCY_NUM_BUCKETS; j++)
+			buckets[j] = Int64GetDatum((int64) pg_atomic_read_u64(&stats->buckets[j]));
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = PointerGetDatum(cstring_to_text(oLatencyOpNames[i]));
+		values[1] = Int64GetDatum((int64) pg_atomic_read_u64(&stats->count));
+		values[2] = Float8GetDatum((double) pg_atomic_read_u64(&stats->time) / 1000.0);
+		values[3] = Float8GetDatum((double) pg_atomic_read_u64(&stats->max) / 1000.0);
+		values[4] = PointerGetDatum(construct_array(bounds,
+													O_LATENCY_NUM_BOUNDS,
+													INT8OID, sizeof(int64),
+													FLOAT8PASSBYVAL,
+													TYPALIGN_DOUBLE));
+		values[5] = PointerGetDatum(construct_array(buckets,
+													O_LATENCY_NUM_BUCKETS,
+													INT8OID, sizeof(int64),
+													FLOAT8PASSBYVAL,
+													TYPALIGN_DOUBLE));
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Resets the latency histograms.  Operations accumulated locally by other
+ * backends are added after the reset.
+ */
+Datum
+orioledb_latency_stats_reset(PG_FUNCTION_ARGS)
+{
+	orioledb_check_shmem();
+
+	memset(local_latency_stats, 0, sizeof(local_latency_stats));
+	o_latency_reset_shared();
+
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,57 @@
+/*-------------------------------------------------------------------------
+ *
+ * o_wait_events.c
+ *		Registration of OrioleDB-specific wait events.
+ *
+ * PostgreSQL versions we support have no API for named extension wait
+ * events.  So, we allocate an LWLock tranche id for each kind of wait and
+ * report it with PG_WAIT_LWLOCK class.  The tranche names are registered
+ * in every process, so they are shown in pg_stat_activity.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/utils/o_wait_events.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "utils/o_wait_events.h"
+
+#include "storage/lwlock.h"
+
+int		   *oWaitEventTrancheIds = NULL;
+
+static const char *oWaitEventNames[OWaitEventsCount] = {
+	"orioledb_page_lock",
+	"orioledb_page_read_enable",
+	"orioledb_page_changecount",
+	"orioledb_undo_reserve",
+	"orioledb_s3_queue"
+};
+
+Size
+o_wait_events_shmem_needs(void)
+{
+	return CACHELINEALIGN(sizeof(int) * OWaitEventsCount);
+}
+
+void
+o_wait_events_shmem_init(Pointer ptr, bool found)
+{
+	int			i;
+
+	oWaitEventTrancheIds = (int *) ptr;
+
+	if (!found)
+	{
+		for (i = 0; i < OWaitEventsCount; i++)
+			oWaitEventTrancheIds[i] = LWLockNewTrancheId();
+	}
+
+	for (i = 0; i < OWaitEventsCount; i++)
+		LWLockRegisterTranche(oWaitEventTrancheIds[i], oWaitEventNames[i]);
+}
@@ -18,11 +18,17 @@
 #include "btree/page_contents.h"
 #include "btree/undo.h"
 #include "transam/undo.h"
+#include "utils/o_latency.h"
 #include "utils/page_pool.h"
 #include "utils/ucm.h"
 
+#include "storage/proc.h"
 #include "utils/memdebug.h"
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 /*
  * Calculates shared memory space needed for a page pool. Be careful,
  * it prepares local memory structures to initialize.
@@ -38,8 +44,14 @@ ppool_estimate_space(OPagePool *pool, OInMemoryBlkno offset, OInMemoryBlkno size
 	pool->offset = offset;
 	pool->size = size;
 
+	result += CACHELINEALIGN(sizeof(pg_atomic_uint64));
 	result += CACHELINEALIGN(sizeof(pg_atomic_uint64));
 	result += CACHELINEALIGN(sizeof(pg_atomic_uint32));
+	result += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+	result += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+	result += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+	result += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+	result += CACHELINEALIGN(mul_size(pool->ghostSize, sizeof(pg_atomic_uint32)));
 
 	pool->ucmShmemSize = estimate_ucm_space(&pool->ucm, offset, size);
 
@@ -57,13 +69,40 @@ ppool_shmem_init(OPagePool *pool, Pointer ptr, bool found)
 	pool->availablePagesCount = (pg_atomic_uint64 *) ptr;
 	ptr += CACHELINEALIGN(sizeof(pg_atomic_uint64));
 
+	pool->minAvailablePagesCount = (pg_atomic_uint64 *) ptr;
+	ptr += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+
 	pool->dirtyPagesCount = (pg_atomic_uint32 *) ptr;
 	ptr += CACHELINEALIGN(sizeof(pg_atomic_uint32));
 
+	pool->mergedPagesCount = (pg_atomic_uint64 *) ptr;
+	ptr += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+
+	pool->loadedPagesCount = (pg_atomic_uint64 *) ptr;
+	ptr += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+
+	pool->ghostHitsCount = (pg_atomic_uint64 *) ptr;
+	ptr += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+
+	pool->backendEvictionsCount = (pg_atomic_uint64 *) ptr;
+	ptr += CACHELINEALIGN(sizeof(pg_atomic_uint64));
+
+	pool->ghost = (pg_atomic_uint32 *) ptr;
+	ptr += CACHELINEALIGN(mul_size(pool->ghostSize, sizeof(pg_atomic_uint32)));
+
 	if (!found)
 	{
+		uint32		i;
+
 		pg_atomic_init_u64(pool->availablePagesCount, pool->size);
+		pg_atomic_init_u64(pool->minAvailablePagesCount, pool->size);
 		pg_atomic_init_u32(pool->dirtyPagesCount, 0);
+		pg_atomic_init_u64(pool->mergedPagesCount, 0);
+		pg_atomic_init_u64(pool->loadedPagesCount, 0);
+		pg_atomic_init_u64(pool->ghostHitsCount, 0);
+		pg_atomic_init_u64(pool->backendEvictionsCount, 0);
+		for (i = 0; i < pool->ghostSize; i++)
+			pg_atomic_init_u32(&pool->ghost[i], 0);
 	}
 
 	init_ucm(&pool->ucm, ptr, found);
@@ -81,6 +120,34 @@ ppool_shmem_init(OPagePool *pool, Pointer ptr, bool found)
 #endif
 }
 
+/*
+ * Each backend keeps a small number of pages taken from availablePagesCount
+ * in a local cache.  Reservations are served from the cache and released
+ * pages go back there, so the shared counter is touched once per batch
+ * rather than once per page.
+ */
+#define PPOOL_CACHE_BATCH	8
+
+/*
+ * Lower minAvailablePagesCount to the given value of availablePagesCount.
+ * Negative values, which mean that the pool is exhausted, count as zero.
+ */
+static void
+ppool_update_min_available(OPagePool *pool, uint64 val)
+{
+	uint64		min = pg_atomic_read_u64(pool->minAvailablePagesCount);
+
+	if (val & (UINT64CONST(1) << 63))
+		val = 0;
+
+	while (val < min)
+	{
+		if (pg_atomic_compare_exchange_u64(pool->minAvailablePagesCount,
+										   &min, val))
+			break;
+	}
+}
+
 /*
  * Reserve pages for further allocation.  Reserving pages might require running
  * clock algorithm with page eviction.  It shouldn't be called while holding
@@ -105,16 +172,67 @@ ppool_reserve_pages(OPagePool *pool, int kind, int count)
 	if (count <= 0)
 		return;
 
-	val = pg_atomic_sub_fetch_u64(pool->availablePagesCount, count);
-	while (val & (UINT64CONST(1) << 63))
+	if (pool->numPagesCached < count)
 	{
-		ppool_run_clock(pool, true, NULL);
-		val = pg_atomic_read_u64(pool->availablePagesCount);
+		int			cached = pool->numPagesCached,
+					take = count - cached + PPOOL_CACHE_BATCH;
+
+		/* ppool_run_clock() flushes the cache, so keep it aside */
+		pool->numPagesCached = 0;
+		val = pg_atomic_sub_fetch_u64(pool->availablePagesCount, take);
+		ppool_update_min_available(pool, val);
+		if (val & (UINT64CONST(1) << 63))
+		{
+			instr_time	evictStart;
+
+			O_LATENCY_START(evictStart);
+			while (val & (UINT64CONST(1) << 63))
+			{
+				/* background writers pace themselves by this counter */
+				pg_atomic_fetch_add_u64(pool->backendEvictionsCount, 1);
+				ppool_run_clock(pool, true, NULL);
+				val = pg_atomic_read_u64(pool->availablePagesCount);
+			}
+			o_latency_report(OLatencyEviction, evictStart);
+		}
+		pool->numPagesCached = cached + take;
 	}
 
+	pool->numPagesCached -= count;
 	pool->numPagesReserved[kind] += count;
 }
 
+/*
+ * Put pages back to the local cache of the pool.  Return the cache excess to
+ * the shared counter, so that no more than 2 * PPOOL_CACHE_BATCH pages stay
+ * cached by one backend.
+ */
+static void
+ppool_cache_pages(OPagePool *pool, int count)
+{
+	pool->numPagesCached += count;
+	if (pool->numPagesCached > 2 * PPOOL_CACHE_BATCH)
+	{
+		pg_atomic_add_fetch_u64(pool->availablePagesCount,
+								pool->numPagesCached - PPOOL_CACHE_BATCH);
+		pool->numPagesCached = PPOOL_CACHE_BATCH;
+	}
+}
+
+/*
+ * Return all the locally cached pages to the shared counter.
+ */
+static void
+ppool_flush_cache(OPagePool *pool)
+{
+	if (pool->numPagesCached != 0)
+	{
+		pg_atomic_add_fetch_u64(pool->availablePagesCount,
+								pool->numPagesCached);
+		pool->numPagesCached = 0;
+	}
+}
+
 /*
  * Release previously reserved pages according to mask (multiple kinds can be
  * released in one call).
@@ -134,11 +252,11 @@ ppool_release_reserved(OPagePool *pool, uint32 mask)
 		}
 	}
 	if (sum != 0)
-		pg_atomic_add_fetch_u64(pool->availablePagesCount, sum);
+		ppool_cache_pages(pool, sum);
 }
 
 /*
- * Release all reserved pages in all the pools.
+ * Release all reserved and cached pages in all the pools.
  */
 void
 ppool_release_all_pages(void)
@@ -150,6 +268,7 @@ ppool_release_all_pages(void)
 		OPagePool  *pool = get_ppool((OPagePoolType) i);
 
 		ppool_release_reserved(pool, PPOOL_RESERVE_MASK_ALL);
+		ppool_flush_cache(pool);
 	}
 }
 
@@ -164,6 +283,56 @@ ppool_get_metapage(OPagePool *pool)
 	return ppool_get_page(pool, PPOOL_RESERVE_META);
 }
 
+/*
+ * Each pool is split into ranges of pages, one range per background writer.
+ * Every background writer starts its clock sweep within its own range, and
+ * backends start both the clock sweep and the free page search within the
+ * range picked by the CPU they run on.  So, concurrent walks over the UCM
+ * don't all hit the same words.  The ranges are just starting points: walks
+ * proceed to the other ranges if there is nothing to find in their own.
+ */
+static int	ppool_partition = -1;
+
+void
+ppool_set_partition(int num)
+{
+	ppool_partition = num;
+}
+
+static int
+ppool_num_partitions(OPagePool *pool)
+{
+	return Max(Min(bgwriter_num_workers, (int) pool->size), 1);
+}
+
+static int
+ppool_get_partition(OPagePool *pool)
+{
+	int			num = ppool_partition;
+
+	if (num < 0)
+	{
+#ifdef __linux__
+		num = sched_getcpu();
+#endif
+		if (num < 0)
+			num = MyProc ? MyProc->pgprocno : 0;
+	}
+	return num % ppool_num_partitions(pool);
+}
+
+static OInMemoryBlkno
+ppool_partition_size(OPagePool *pool)
+{
+	return pool->size / ppool_num_partitions(pool);
+}
+
+static OInMemoryBlkno
+ppool_partition_start(OPagePool *pool)
+{
+	return pool->offset + ppool_get_partition(pool) * ppool_partition_size(pool);
+}
+
 /*
  * Get next free page from the pool.
  *
@@ -177,9 +346,12 @@ ppool_get_page(OPagePool *pool, int kind)
 	Assert(pool->numPagesReserved[kind] > 0);
 	pool->numPagesReserved[kind]--;
 
-	result = ucm_occupy_free_page(&pool->ucm);
+	result = ucm_occupy_free_page(&pool->ucm, ppool_partition_start(pool));
 	Assert(pool->offset <= result && result < pool->offset + pool->size);
 
+	/* Access statistics of the previous page owner are irrelevant */
+	pg_atomic_write_u32(&O_GET_IN_MEMORY_PAGEDESC(result)->accessStats, 0);
+
 	VALGRIND_CHECK_MEM_IS_DEFINED(O_GET_IN_MEMORY_PAGE(result), ORIOLEDB_BLCKSZ);
 
 	return result;
@@ -216,7 +388,7 @@ ppool_free_page(OPagePool *pool, OInMemoryBlkno blkno, bool haveLock)
 
 	page_change_usage_count(&pool->ucm, blkno, UCM_FREE_PAGES_LEVEL);
 
-	pg_atomic_add_fetch_u64(pool->availablePagesCount, 1);
+	ppool_cache_pages(pool, 1);
 }
 
 /*
@@ -233,6 +405,15 @@ ppool_free_pages_count(OPagePool *pool)
 		return (OInMemoryBlkno) count;
 }
 
+/*
+ * Return the minimal count of free pages in the pool since the start.
+ */
+OInMemoryBlkno
+ppool_min_free_pages_count(OPagePool *pool)
+{
+	return (OInMemoryBlkno) pg_atomic_read_u64(pool->minAvailablePagesCount);
+}
+
 /*
  * Return count of dirty pages in the pool.
  */
@@ -242,6 +423,66 @@ ppool_dirty_pages_count(OPagePool *pool)
 	return pg_atomic_read_u32(pool->dirtyPagesCount);
 }
 
+/*
+ * Return count of clock runs made by processes, which failed to reserve pages
+ * in the pool.
+ */
+uint64
+ppool_backend_evictions_count(OPagePool *pool)
+{
+	return pg_atomic_read_u64(pool->backendEvictionsCount);
+}
+
+/*
+ * Return count of pages reclaimed by merging sparse pages in the pool.
+ */
+uint64
+ppool_merged_pages_count(OPagePool *pool)
+{
+	return pg_atomic_read_u64(pool->mergedPagesCount);
+}
+
+/*
+ * The ghost history remembers keys of the recently evicted pages, one slot
+ * per page of the pool.  A page loaded again while its key is still in the
+ * history is considered frequently used and gets a higher usage count, while
+ * pages loaded for the first time get a lower one.  So, pages touched once by
+ * a scan leave the pool before the pages of the working set.
+ */
+void
+ppool_ghost_insert(OPagePool *pool, uint32 key)
+{
+	if (pool->ghostSize == 0)
+		return;
+
+	Assert(key != 0);
+	pg_atomic_write_u32(&pool->ghost[key % pool->ghostSize], key);
+}
+
+/*
+ * Returns the usage count for the page loaded into the pool.  'key' identifies
+ * the page in the ghost history, zero means the page is just created.
+ */
+uint32
+ppool_loaded_page_usage_count(OPagePool *pool, uint32 key)
+{
+	pg_atomic_uint32 *slot;
+	uint32		expected = key;
+
+	if (pool->ghostSize == 0 || key == 0)
+		return ucm_loaded_page_usage_count(&pool->ucm, 0);
+
+	slot = &pool->ghost[key % pool->ghostSize];
+	if (pg_atomic_read_u32(slot) == key &&
+		pg_atomic_compare_exchange_u32(slot, &expected, 0))
+	{
+		pg_atomic_fetch_add_u64(pool->ghostHitsCount, 1);
+		return ucm_loaded_page_usage_count(&pool->ucm, 1);
+	}
+
+	return ucm_loaded_page_usage_count(&pool->ucm, -1);
+}
+
 /*
  * Run clock replacement algorithm until we evict at least one page.
  */
@@ -249,16 +490,20 @@ void
 ppool_run_clock(OPagePool *pool, bool evict,
 				volatile sig_atomic_t *shutdown_requested)
 {
-	uint64		blkno;
+	uint64		blkno,
+				partitionSize;
 	Size		undoSize = get_reserved_undo_size(UndoReserveTxn);
 	bool		haveRetainLoc = have_retained_undo_location();
+	OWalkPageResult result;
 
+	/* start from a random page of our partition */
+	partitionSize = ppool_partition_size(pool);
 #if PG_VERSION_NUM >= 150000
-	blkno = pg_prng_uint64_range(&pool->prngSeed,
-								 pool->offset,
-								 pool->offset + pool->size - 1);
+	blkno = ppool_partition_start(pool) +
+		pg_prng_uint64_range(&pool->prngSeed, 0, partitionSize - 1);
 #else
-	blkno = pool->offset + (uint64) pg_jrand48(pool->xseed) % pool->size;
+	blkno = ppool_partition_start(pool) +
+		(uint64) pg_jrand48(pool->xseed) % partitionSize;
 #endif
 
 	/*
@@ -282,9 +527,12 @@ ppool_run_clock(OPagePool *pool, bool evict,
 		blkno = ucm_next_blkno(&pool->ucm, blkno, 1);
 
 		Assert(blkno >= pool->offset && blkno < pool->offset + pool->size);
-		if (walk_page(blkno, evict) != OWalkPageSkipped)
+		result = walk_page(blkno, evict);
+		if (result != OWalkPageSkipped)
 		{
 			Assert(!have_locked_pages());
+			if (result == OWalkPageMerged)
+				pg_atomic_fetch_add_u64(pool->mergedPagesCount, 1);
 			break;
 		}
 		Assert(!have_locked_pages());
@@ -295,6 +543,12 @@ ppool_run_clock(OPagePool *pool, bool evict,
 
 	unset_skip_ucm();
 
+	/*
+	 * Make the evicted pages visible to the backends waiting for the free
+	 * pages.
+	 */
+	ppool_flush_cache(pool);
+
 	/*
 	 * The caller might have the undo location reserved.  We need to carefully
 	 * put the undo location back.
@@ -312,3 +566,92 @@ ppool_run_clock(OPagePool *pool, bool evict,
 			reserve_undo_size(UndoReserveTxn, undoSize);
 	}
 }
+
+/*
+ * Apply 'walk' to the next 'count' pages of the pool starting from the pool
+ * location.  Returns the number of pages, for which 'walk' returned 'target'.
+ */
+static int
+ppool_walk_pages(OPagePool *pool, int count,
+				 OWalkPageResult (*walk) (OInMemoryBlkno blkno),
+				 OWalkPageResult target,
+				 volatile sig_atomic_t *shutdown_requested)
+{
+	OInMemoryBlkno blkno = pool->location;
+	Size		undoSize = get_reserved_undo_size(UndoReserveTxn);
+	bool		haveRetainLoc = have_retained_undo_location();
+	int			processed = 0;
+	int			i;
+
+	Assert(!have_locked_pages());
+
+	reserve_undo_size(UndoReserveTxn, 2 * O_MERGE_UNDO_IMAGE_SIZE);
+
+	/* Our attempts to merge pages shouldn't themselves affect UCM */
+	set_skip_ucm();
+
+	for (i = 0; i < count; i++)
+	{
+		if (shutdown_requested != NULL && *shutdown_requested)
+			break;
+
+		if (blkno < pool->offset || blkno >= pool->offset + pool->size)
+			blkno = pool->offset;
+
+		if (walk(blkno) == target)
+			processed++;
+		Assert(!have_locked_pages());
+		blkno++;
+	}
+	pool->location = blkno;
+
+	unset_skip_ucm();
+
+	/* Put the undo location back, see ppool_run_clock() */
+	if (haveRetainLoc)
+	{
+		if (undoSize > 0)
+			reserve_undo_size(UndoReserveTxn, undoSize);
+	}
+	else
+	{
+		release_undo_size(UndoReserveTxn);
+		free_retained_undo_location();
+		if (undoSize > 0)
+			reserve_undo_size(UndoReserveTxn, undoSize);
+	}
+
+	return processed;
+}
+
+/*
+ * Examine next 'count' pages of the pool and merge the sparse leaf pages.
+ * Unlike ppool_run_clock(), pages are never written or evicted.  Returns the
+ * number of pages merged.
+ */
+int
+ppool_run_merge_clock(OPagePool *pool, int count,
+					  volatile sig_atomic_t *shutdown_requested)
+{
+	int			merged;
+
+	merged = ppool_walk_pages(pool, count, walk_page_merge, OWalkPageMerged,
+							  shutdown_requested);
+	if (merged > 0)
+		pg_atomic_fetch_add_u64(pool->mergedPagesCount, merged);
+
+	return merged;
+}
+
+/*
+ * Examine next 'count' pages of the pool and write dirty pages of compressed
+ * trees ahead of the checkpoint in progress.  Returns the number of pages
+ * written.
+ */
+int
+ppool_run_checkpoint_ahead_clock(OPagePool *pool, int count,
+								 volatile sig_atomic_t *shutdown_requested)
+{
+	return ppool_walk_pages(pool, count, walk_page_checkpoint_ahead,
+							OWalkPageWritten, shutdown_requested);
+}
@@ -48,6 +48,13 @@
 /* we should skip orioledb page header on io operations */
 #define SEQBUF_DATA_POS(page) ((Pointer)(page) + SEQBUF_DATA_OFF)
 
+/*
+ * Number of pages to read ahead.  Readers hold the shared spinlock while the
+ * next page is read, so that concurrent readers wait for it.  Hint the kernel
+ * in advance to make these reads hit the page cache.
+ */
+#define SEQBUF_READ_AHEAD_PAGES 16
+
 /* offset of current sequence buffer page in file */
 #define SEQBUF_FILE_OFFSET(shared, blkno) ((off_t) SEQBUF_CHUNK_SIZE * (blkno) \
 												+ (shared)->evictOffset)
@@ -62,6 +69,8 @@ static inline bool seq_buf_rw(SeqBufDescPrivate *private,
 							  char *data, Size data_size, bool write);
 static bool seq_buf_read_pages(SeqBufDescPrivate *private,
 							   SeqBufDescShared *shared, int header_off, off_t evicted_off);
+static void seq_buf_read_ahead(SeqBufDescPrivate *private, off_t offset,
+							   off_t freeBytesNum);
 
 /*
  * Initialize sequential buffered access to given file.
@@ -315,6 +324,11 @@ seq_buf_finish_prev_page(SeqBufDescPrivate *private)
 			shared->freeBytesNum -= nbytes;
 			Assert(shared->freeBytesNum >= 0);
 			put_page_image(shared->pages[1 - shared->curPageNum], buf);
+
+			/* issue the read-ahead once per SEQBUF_READ_AHEAD_PAGES pages */
+			if ((shared->filePageNum + 1) % SEQBUF_READ_AHEAD_PAGES == 1)
+				seq_buf_read_ahead(private, offset + SEQBUF_CHUNK_SIZE,
+								   shared->freeBytesNum);
 		}
 	}
 	return true;
@@ -683,9 +697,28 @@ seq_buf_read_pages(SeqBufDescPrivate *private, SeqBufDescShared *shared,
 	put_page_image(shared->pages[0], buf_first);
 	put_page_image(shared->pages[1], buf_second);
 	shared->freeBytesNum = free_bytes;
+
+	if (free_bytes > 0)
+		seq_buf_read_ahead(private, evicted_off + nbytes, free_bytes);
 	return true;
 }
 
+/*
+ * Hints the kernel to read SEQBUF_READ_AHEAD_PAGES pages starting from the
+ * given offset, but not more than the unread bytes of the file.
+ */
+static void
+seq_buf_read_ahead(SeqBufDescPrivate *private, off_t offset,
+				   off_t freeBytesNum)
+{
+	off_t		amount = Min(freeBytesNum,
+							 (off_t) SEQBUF_READ_AHEAD_PAGES * SEQBUF_CHUNK_SIZE);
+
+	if (amount > 0)
+		(void) FilePrefetch(private->file, offset, amount,
+							WAIT_EVENT_SLRU_READ);
+}
+
 static inline char *
 seq_buf_filename_if_exist(SeqBufTag *tag)
 {
@@ -108,6 +108,13 @@ pg_stopevent_set(PG_FUNCTION_ARGS)
 	JsonPath   *condition = PG_GETARG_JSONPATH_P(1);
 	StopEvent  *event;
 
+#ifdef ORIOLEDB_NO_STOPEVENTS
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("stop events are not supported by this build"),
+			 errhint("Rebuild orioledb without NO_STOPEVENTS=1.")));
+#endif
+
 	event = find_stop_event(event_name);
 
 	if (VARSIZE_ANY(condition) > QUERY_BUFFER_SIZE)
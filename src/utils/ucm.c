@@ -20,8 +20,19 @@
 #define UCM_LEVEL_BITS		4
 #define UCM_LEVEL_MASK		0xF
 
+/* page accesses are added to the shared counter in batches */
+#define UCM_ACCESS_COUNT_BATCH	1024
+
 static bool skip_ucm = false;
 
+/*
+ * Nesting level of the bulk read strategy.  Pages loaded by large scans enter
+ * the UCM at the lowest level of live pages, and the accesses of the scan
+ * don't raise usage counts.  So, a single large scan can't push out the
+ * working set.
+ */
+static int	bulk_read_level = 0;
+
 static int	init_ucm_non_leaf_recursive(UsageCountMap *map, int i);
 static void ucm_inc_recursive(UsageCountMap *map, int i, int prev, int next);
 static bool ucm_check_recursive(UsageCountMap *map, int i);
@@ -57,7 +68,7 @@ estimate_ucm_space(UsageCountMap *map, OInMemoryBlkno offset, OInMemoryBlkno siz
 
 	map->total = n_non_leaf_vars + n_leaf_vars;
 	map->nonLeaf = n_non_leaf_vars;
-	return PG_CACHE_LINE_SIZE + sizeof(pg_atomic_uint32) * map->total;
+	return 2 * PG_CACHE_LINE_SIZE + sizeof(pg_atomic_uint32) * map->total;
 }
 
 static int
@@ -118,12 +129,16 @@ init_ucm(UsageCountMap *map, Pointer ptr, bool found)
 	map->epoch = (pg_atomic_uint32 *) ptr;
 	ptr += PG_CACHE_LINE_SIZE;
 
+	map->accessCount = (pg_atomic_uint64 *) ptr;
+	ptr += PG_CACHE_LINE_SIZE;
+
 	map->ucm = (pg_atomic_uint32 *) ptr;
 
 	if (found)
 		return;
 
 	pg_atomic_init_u32(map->epoch, 0);
+	pg_atomic_init_u64(map->accessCount, 0);
 
 	/* Init leaf variables */
 	blkno = 0;
@@ -214,6 +229,72 @@ ucm_inc(UsageCountMap *map, OInMemoryBlkno blkno, int prev, int next)
 	ucm_inc_recursive(map, map->nonLeaf + blkno / UCM_BRANCH_FACTOR, prev, next);
 }
 
+/*
+ * Raises the usage count of the page by one unless it's already changed
+ * concurrently or reached the top level.
+ */
+static inline void
+page_try_inc_usage_count(UsageCountMap *map, OInMemoryBlkno blkno,
+						 uint32 usageCount, uint32 epoch)
+{
+	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+
+	if ((usageCount + 1) % UCM_USAGE_LEVELS == epoch)
+		return;
+
+	if (pg_atomic_compare_exchange_u32(&(O_PAGE_HEADER(p)->usageCount),
+									   &usageCount,
+									   (usageCount + 1) % UCM_USAGE_LEVELS))
+	{
+		ucm_inc(map, blkno - map->offset, usageCount, (usageCount + 1) % UCM_USAGE_LEVELS);
+	}
+}
+
+/*
+ * Applies the deferred usage count increments.  The page might be evicted or
+ * its usage count might be changed since the increment was deferred.  Then
+ * the page header doesn't match the deferred usage count, and the increment
+ * is just lost.
+ */
+void
+ucm_flush_deferred(UsageCountMap *map)
+{
+	uint32		epoch;
+	int			i;
+
+	if (map->numDeferred == 0)
+		return;
+
+	epoch = pg_atomic_read_u32(map->epoch);
+	for (i = 0; i < map->numDeferred; i++)
+		page_try_inc_usage_count(map, map->deferredBlknos[i],
+								 map->deferredUsageCounts[i], epoch);
+	map->numDeferred = 0;
+}
+
+/*
+ * Remembers the usage count increment in the backend-local buffer.  Repeated
+ * accesses to the same page before the flush make the single shared write.
+ */
+static void
+ucm_defer_inc(UsageCountMap *map, OInMemoryBlkno blkno, uint32 usageCount)
+{
+	int			i;
+
+	for (i = 0; i < map->numDeferred; i++)
+	{
+		if (map->deferredBlknos[i] == blkno)
+			return;
+	}
+
+	map->deferredBlknos[map->numDeferred] = blkno;
+	map->deferredUsageCounts[map->numDeferred] = usageCount;
+	map->numDeferred++;
+
+	if (map->numDeferred >= Min(usage_count_batch, UCM_MAX_DEFERRED))
+		ucm_flush_deferred(map);
+}
+
 void
 page_inc_usage_count(UsageCountMap *map, OInMemoryBlkno blkno,
 					 uint32 usageCount, bool no_skip)
@@ -223,25 +304,30 @@ page_inc_usage_count(UsageCountMap *map, OInMemoryBlkno blkno,
 
 	if (usageCount == InvalidUsageCount ||
 		usageCount == UCM_FREE_PAGES_LEVEL ||
-		(!no_skip && skip_ucm))
+		(!no_skip && (skip_ucm || bulk_read_level > 0)))
 		return;
 
 	Assert(usageCount < UCM_USAGE_LEVELS);
 
 	map->usageCounter++;
+	if ((map->usageCounter % UCM_ACCESS_COUNT_BATCH) == 0)
+	{
+		pg_atomic_fetch_add_u64(map->accessCount, UCM_ACCESS_COUNT_BATCH);
+		ucm_flush_deferred(map);
+	}
+
+	/* Pages at the top level need no shared writes */
+	if ((usageCount + 1) % UCM_USAGE_LEVELS == epoch)
+		return;
 
 	mask = (1 << ((UCM_USAGE_LEVELS + usageCount - epoch) % UCM_USAGE_LEVELS)) - 1;
 
-	if ((map->usageCounter & mask) == 0 && (usageCount + 1) % UCM_USAGE_LEVELS != epoch)
+	if ((map->usageCounter & mask) == 0)
 	{
-		Page		p = O_GET_IN_MEMORY_PAGE(blkno);
-
-		if (pg_atomic_compare_exchange_u32(&(O_PAGE_HEADER(p)->usageCount),
-										   &usageCount,
-										   (usageCount + 1) % UCM_USAGE_LEVELS))
-		{
-			ucm_inc(map, blkno - map->offset, usageCount, (usageCount + 1) % UCM_USAGE_LEVELS);
-		}
+		if (usage_count_batch > 0 && !no_skip)
+			ucm_defer_inc(map, blkno, usageCount);
+		else
+			page_try_inc_usage_count(map, blkno, usageCount, epoch);
 	}
 }
 
@@ -499,7 +585,7 @@ retry:
 }
 
 OInMemoryBlkno
-ucm_occupy_free_page(UsageCountMap *map)
+ucm_occupy_free_page(UsageCountMap *map, OInMemoryBlkno init_blkno)
 {
 	int64		location;
 	int64		i;
@@ -509,7 +595,7 @@ ucm_occupy_free_page(UsageCountMap *map)
 	uint32		mask;
 
 	mask = UCM_LEVEL_MASK << (UCM_FREE_PAGES_LEVEL * UCM_LEVEL_BITS);
-	location = 0;
+	location = init_blkno - map->offset;
 	factor = map->rootFactor;
 	base = 0;
 	num_iterations = 0;
@@ -567,6 +653,39 @@ ucm_occupy_free_page(UsageCountMap *map)
 	}
 }
 
+/*
+ * Returns the usage count for the page just loaded into the pool.  'boost'
+ * from -1 to 1 shifts it relative to the default level.  It's ignored in the
+ * bulk read mode.
+ */
+uint32
+ucm_loaded_page_usage_count(UsageCountMap *map, int boost)
+{
+	uint32		epoch = pg_atomic_read_u32(map->epoch);
+
+	Assert(boost >= -1 && boost <= 1);
+	return (epoch + (bulk_read_level > 0 ? 1 : 2 + boost)) % UCM_USAGE_LEVELS;
+}
+
+void
+ucm_bulk_read_start(void)
+{
+	bulk_read_level++;
+}
+
+void
+ucm_bulk_read_end(void)
+{
+	Assert(bulk_read_level > 0);
+	bulk_read_level--;
+}
+
+void
+ucm_bulk_read_reset(void)
+{
+	bulk_read_level = 0;
+}
+
 void
 set_skip_ucm(void)
 {
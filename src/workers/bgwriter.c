@@ -25,10 +25,12 @@
 #include "miscadmin.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/interrupt.h"
 #include "storage/bufmgr.h"
 #include "storage/latch.h"
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
+#include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
@@ -36,8 +38,26 @@
 
 #include "pgstat.h"
 
+/*
+ * Background writer pacing.  When backends have to run the clock themselves,
+ * because the pool has no pages available to reserve, the boost grows.  The
+ * higher boost makes the background writer to keep more free pages, to write
+ * out dirty pages earlier, to make more clock runs per round and to sleep
+ * less.  The boost decreases when backends stop evicting, and the sleep time
+ * grows when there is no work for the background writer.
+ */
+#define BGWRITER_MAX_BOOST			(4)
+#define BGWRITER_MAX_IDLE_FACTOR	(4)
+
+typedef struct
+{
+	uint64		lastBackendEvictions;
+	int			boost;
+} BGWriterPace;
+
 static volatile sig_atomic_t shutdown_requested = false;
 bool		IsBGWriter = false;
+static BGWriterPace pace[OPagePoolTypesCount];
 
 static void
 handle_sigterm(SIGNAL_ARGS)
@@ -46,8 +66,37 @@ handle_sigterm(SIGNAL_ARGS)
 	SetLatch(MyLatch);
 }
 
+/*
+ * Updates the boost of the pool according to the evictions made by backends
+ * since the previous round.
+ */
+static void
+bgwriter_update_pace(OPagePool *pool, BGWriterPace *poolPace)
+{
+	uint64		backendEvictions = ppool_backend_evictions_count(pool);
+
+	if (backendEvictions != poolPace->lastBackendEvictions)
+		poolPace->boost = Min(poolPace->boost + 1, BGWRITER_MAX_BOOST);
+	else if (poolPace->boost > 0)
+		poolPace->boost--;
+	poolPace->lastBackendEvictions = backendEvictions;
+}
+
+static inline bool
+bgwriter_need_eviction(OPagePool *pool, BGWriterPace *poolPace)
+{
+	return ppool_free_pages_count(pool) <
+		(pool->size / 20) * (1 + poolPace->boost);
+}
+
+static inline bool
+bgwriter_need_write(OPagePool *pool, BGWriterPace *poolPace)
+{
+	return ppool_dirty_pages_count(pool) > pool->size / (2 + poolPace->boost);
+}
+
 void
-register_bgwriter(void)
+register_bgwriter(int num)
 {
 	BackgroundWorker worker;
 
@@ -56,6 +105,7 @@ register_bgwriter(void)
 	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
 	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
 	worker.bgw_restart_time = 0;
+	worker.bgw_main_arg = Int32GetDatum(num);
 	strcpy(worker.bgw_library_name, "orioledb");
 	strcpy(worker.bgw_function_name, "bgwriter_main");
 	strcpy(worker.bgw_name, "orioledb background writer");
@@ -68,9 +118,12 @@ bgwriter_main(Datum main_arg)
 {
 	OPagePool  *pool;
 	int			rc,
-				wake_events = WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_TIMEOUT;
+				wake_events = WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_TIMEOUT,
+				idle_factor = 1,
+				max_boost = 0;
 	bool		need_eviction,
-				need_write;
+				need_write,
+				was_busy;
 
 	/* enable timeout for relation lock */
 	RegisterTimeout(DEADLOCK_TIMEOUT, CheckDeadLockAlert);
@@ -93,10 +146,12 @@ bgwriter_main(Datum main_arg)
 
 	/* catch SIGTERM signal for reason to not interupt background writing */
 	pqsignal(SIGTERM, handle_sigterm);
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
 	BackgroundWorkerUnblockSignals();
 
 	elog(LOG, "orioledb background writer started");
 	IsBGWriter = true;
+	ppool_set_partition(DatumGetInt32(main_arg));
 
 	if (debug_disable_bgwriter)
 	{
@@ -126,45 +181,76 @@ bgwriter_main(Datum main_arg)
 				break;
 
 			/*
-			 * Sleep until we are signaled or it's time for another
-			 * checkpoint.
+			 * Sleep until we are signaled or it's time for another round.
+			 * Sleep less when backends have to evict pages themselves, and
+			 * more when there was nothing to do.
 			 */
 			rc = WaitLatch(MyLatch, wake_events,
-						   BgWriterDelay,
+						   Max((BgWriterDelay * idle_factor) >> max_boost, 1),
 						   WAIT_EVENT_BGWRITER_MAIN);
 
 			if (rc & WL_POSTMASTER_DEATH)
 				shutdown_requested = true;
 
+			if (ConfigReloadPending)
+			{
+				ConfigReloadPending = false;
+				ProcessConfigFile(PGC_SIGHUP);
+			}
+
+			was_busy = false;
+			max_boost = 0;
 			for (poolType = 0; poolType < OPagePoolTypesCount && !shutdown_requested; poolType++)
 			{
+				BGWriterPace *poolPace = &pace[poolType];
+
 				pool = get_ppool(poolType);
-				need_eviction = ppool_free_pages_count(pool) < pool->size / 20;
-				need_write = ppool_dirty_pages_count(pool) > pool->size / 2;
+				bgwriter_update_pace(pool, poolPace);
+				max_boost = Max(max_boost, poolPace->boost);
+				need_eviction = bgwriter_need_eviction(pool, poolPace);
+				need_write = bgwriter_need_write(pool, poolPace);
 
 				if (need_eviction || need_write)
 				{
 					int			i = 0;
 
+					was_busy = true;
 					while (need_eviction || need_write)
 					{
 						ppool_run_clock(pool, need_eviction, &shutdown_requested);
 						i++;
 
-						if (i >= bgwriter_lru_maxpages * (BLCKSZ / ORIOLEDB_BLCKSZ))
+						if (i >= (bgwriter_lru_maxpages * (BLCKSZ / ORIOLEDB_BLCKSZ)) << poolPace->boost)
 							break;
 
 						if (shutdown_requested)
 							break;
 
-						need_eviction = ppool_free_pages_count(pool) < pool->size / 20;
-						need_write = ppool_dirty_pages_count(pool) > pool->size / 2;
+						need_eviction = bgwriter_need_eviction(pool, poolPace);
+						need_write = bgwriter_need_write(pool, poolPace);
 					}
 
 					MemoryContextReset(CurTransactionContext);
 					MemoryContextReset(TopTransactionContext);
 				}
 
+				if (!shutdown_requested && bgwriter_merge_pages > 0)
+				{
+					ppool_run_merge_clock(pool, bgwriter_merge_pages,
+										  &shutdown_requested);
+					MemoryContextReset(CurTransactionContext);
+					MemoryContextReset(TopTransactionContext);
+				}
+
+				if (!shutdown_requested && bgwriter_checkpoint_ahead_pages > 0)
+				{
+					ppool_run_checkpoint_ahead_clock(pool,
+													 bgwriter_checkpoint_ahead_pages,
+													 &shutdown_requested);
+					MemoryContextReset(CurTransactionContext);
+					MemoryContextReset(TopTransactionContext);
+				}
+
 				if (!shutdown_requested && ucm_epoch_needs_shift(&pool->ucm))
 				{
 					if (ucm_epoch_needs_shift(&pool->ucm))
@@ -184,6 +270,11 @@ bgwriter_main(Datum main_arg)
 					write_undo(targetLocation, minProcReservedLocation, true);
 			}
 
+			if (was_busy || max_boost > 0)
+				idle_factor = 1;
+			else
+				idle_factor = Min(idle_factor * 2, BGWRITER_MAX_IDLE_FACTOR);
+
 			check_pending_truncates();
 
 			if (orioledb_s3_mode)
@@ -0,0 +1,555 @@
+/*-------------------------------------------------------------------------
+ *
+ * prewarm.c
+ *		Routines for saving and restoring the resident page set.
+ *
+ * Each checkpoint writes the file offsets of the pages resident in the main
+ * page pool to the prewarm file.  On startup, prewarm workers read this file
+ * and load the pages back walking each tree from the root.  A non-leaf page
+ * is walked only if it's resident or listed in the file, so the pages listed
+ * are loaded together with their parents.  Offsets are taken from the page
+ * descriptors, so they match the data file images of the last checkpoint.
+ * A page relocated since then is just not found.
+ *
+ * In S3 mode, the prewarm file is uploaded with each checkpoint, so the node
+ * restored from S3 gets it too.  Before walking the trees, the workers
+ * schedule the loads of the data file parts holding the listed pages, which
+ * S3 workers then download in parallel.  The rest of the parts are loaded
+ * lazily on access as usual.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/workers/prewarm.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "btree/find.h"
+#include "btree/io.h"
+#include "btree/page_contents.h"
+#include "catalog/o_tables.h"
+#include "catalog/sys_trees.h"
+#include "tableam/descr.h"
+#include "utils/page_pool.h"
+#include "workers/prewarm.h"
+
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "storage/fd.h"
+#include "storage/ipc.h"
+#include "storage/lock.h"
+#include "storage/sinvaladt.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+#include "utils/timeout.h"
+
+#define PREWARM_TMP_FILENAME	(ORIOLEDB_DATA_DIR "/prewarm.tmp")
+#define PREWARM_MAGIC			(0x4F505257)
+#define PREWARM_BUFFER_SIZE		(256)
+
+typedef struct
+{
+	uint32		magic;
+	uint32		reserved;
+	uint64		count;
+} PrewarmFileHeader;
+
+typedef struct
+{
+	ORelOids	oids;
+	uint32		type;
+	uint64		off;
+} PrewarmRecord;
+
+typedef struct
+{
+	/* sorted offsets of the tree pages to load */
+	PrewarmRecord *records;
+	int			count;
+	uint64		loaded;
+	bool		stop;
+} PrewarmTreeState;
+
+static volatile sig_atomic_t shutdown_requested = false;
+
+static void
+handle_sigterm(SIGNAL_ARGS)
+{
+	shutdown_requested = true;
+	SetLatch(MyLatch);
+}
+
+static void
+prewarm_write(File file, Pointer data, int length, uint64 offset)
+{
+	if (OFileWrite(file, data, length, offset,
+				   WAIT_EVENT_DATA_FILE_WRITE) != length)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not write prewarm file %s",
+							   PREWARM_TMP_FILENAME)));
+}
+
+/*
+ * Saves the file offsets of the pages resident in the main page pool.  The
+ * page descriptors are read without locks: the file is only a hint.
+ */
+void
+prewarm_dump_resident_pages(void)
+{
+	OPagePool  *pool = get_ppool(OPagePoolMain);
+	PrewarmRecord buffer[PREWARM_BUFFER_SIZE];
+	PrewarmFileHeader header;
+	OInMemoryBlkno blkno;
+	File		file;
+	uint64		offset;
+	int			nbuffered = 0;
+
+	if (prewarm_workers == 0)
+		return;
+
+	file = PathNameOpenFile(PREWARM_TMP_FILENAME,
+							O_RDWR | O_CREAT | O_TRUNC | PG_BINARY);
+	if (file < 0)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not open prewarm file %s",
+							   PREWARM_TMP_FILENAME)));
+
+	header.magic = PREWARM_MAGIC;
+	header.reserved = 0;
+	header.count = 0;
+	offset = sizeof(header);
+
+	for (blkno = pool->offset; blkno < pool->offset + pool->size; blkno++)
+	{
+		OrioleDBPageDesc *page_desc = O_GET_IN_MEMORY_PAGEDESC(blkno);
+		PrewarmRecord *record = &buffer[nbuffered];
+		FileExtent	extent;
+
+		record->oids = *((volatile ORelOids *) &page_desc->oids);
+		record->type = page_desc->type;
+		extent = *((volatile FileExtent *) &page_desc->fileExtent);
+
+		if (!ORelOidsIsValid(record->oids) ||
+			record->type == oIndexInvalid ||
+			IS_SYS_TREE_OIDS(record->oids) ||
+			!FileExtentIsValid(extent))
+			continue;
+
+		record->off = extent.off;
+		if (++nbuffered == PREWARM_BUFFER_SIZE)
+		{
+			prewarm_write(file, (Pointer) buffer,
+						  sizeof(PrewarmRecord) * nbuffered, offset);
+			offset += sizeof(PrewarmRecord) * nbuffered;
+			header.count += nbuffered;
+			nbuffered = 0;
+		}
+	}
+
+	if (nbuffered > 0)
+	{
+		prewarm_write(file, (Pointer) buffer,
+					  sizeof(PrewarmRecord) * nbuffered, offset);
+		header.count += nbuffered;
+	}
+	prewarm_write(file, (Pointer) &header, sizeof(header), 0);
+
+	if (FileSync(file, WAIT_EVENT_DATA_FILE_SYNC) != 0)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not sync prewarm file %s",
+							   PREWARM_TMP_FILENAME)));
+	FileClose(file);
+
+	(void) durable_rename(PREWARM_TMP_FILENAME, PREWARM_FILENAME, ERROR);
+	elog(DEBUG1, "orioledb saved " UINT64_FORMAT " resident pages", header.count);
+}
+
+void
+register_prewarm_worker(int num)
+{
+	BackgroundWorker worker;
+
+	/* Set up background worker parameters */
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main_arg = Int32GetDatum(num);
+	strcpy(worker.bgw_library_name, "orioledb");
+	strcpy(worker.bgw_function_name, "prewarm_worker_main");
+	strcpy(worker.bgw_name, "orioledb prewarm worker");
+	strcpy(worker.bgw_type, "orioledb prewarm worker");
+	RegisterBackgroundWorker(&worker);
+}
+
+static int
+prewarm_record_cmp(const void *a, const void *b)
+{
+	const PrewarmRecord *r1 = (const PrewarmRecord *) a;
+	const PrewarmRecord *r2 = (const PrewarmRecord *) b;
+
+	if (r1->oids.datoid != r2->oids.datoid)
+		return r1->oids.datoid < r2->oids.datoid ? -1 : 1;
+	if (r1->oids.reloid != r2->oids.reloid)
+		return r1->oids.reloid < r2->oids.reloid ? -1 : 1;
+	if (r1->oids.relnode != r2->oids.relnode)
+		return r1->oids.relnode < r2->oids.relnode ? -1 : 1;
+	if (r1->type != r2->type)
+		return r1->type < r2->type ? -1 : 1;
+	if (r1->off != r2->off)
+		return r1->off < r2->off ? -1 : 1;
+	return 0;
+}
+
+static bool
+prewarm_page_listed(PrewarmTreeState *state, uint64 off)
+{
+	int			lo = 0,
+				hi = state->count - 1;
+
+	while (lo <= hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (state->records[mid].off == off)
+			return true;
+		else if (state->records[mid].off < off)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return false;
+}
+
+/*
+ * Prewarm shouldn't cause the eviction of the pages already used.
+ */
+static bool
+prewarm_pool_is_full(OPagePool *pool)
+{
+	return ppool_free_pages_count(pool) < pool->size / 10;
+}
+
+static void
+prewarm_recursive(BTreeDescr *desc, PrewarmTreeState *state,
+				  OBTreeFindPageContext *context, OInMemoryBlkno blkno)
+{
+	Page		p = O_GET_IN_MEMORY_PAGE(blkno);
+	BTreePageItemLocator loc;
+	uint32		changeCount;
+
+	if (O_PAGE_IS(p, LEAF))
+		return;
+
+	changeCount = O_PAGE_GET_CHANGE_COUNT(p);
+	context->index++;
+	context->items[context->index].blkno = blkno;
+	context->items[context->index].pageChangeCount = changeCount;
+
+	BTREE_PAGE_LOCATOR_FIRST(p, &loc);
+	while (BTREE_PAGE_LOCATOR_IS_VALID(p, &loc) && !state->stop)
+	{
+		BTreeNonLeafTuphdr *tuphdr;
+		uint64		downlink;
+
+		if (shutdown_requested)
+		{
+			state->stop = true;
+			break;
+		}
+
+		tuphdr = (BTreeNonLeafTuphdr *) BTREE_PAGE_LOCATOR_GET_ITEM(p, &loc);
+		downlink = tuphdr->downlink;
+
+		if (DOWNLINK_IS_IN_MEMORY(downlink))
+		{
+			prewarm_recursive(desc, state, context,
+							  DOWNLINK_GET_IN_MEMORY_BLKNO(downlink));
+		}
+		else if (DOWNLINK_IS_IN_IO(downlink))
+		{
+			wait_for_io_completion(DOWNLINK_GET_IO_LOCKNUM(downlink));
+			continue;
+		}
+		else if (DOWNLINK_IS_ON_DISK(downlink) &&
+				 prewarm_page_listed(state, DOWNLINK_GET_DISK_OFF(downlink)))
+		{
+			OInMemoryBlkno parentBlkno;
+
+			if (prewarm_pool_is_full(desc->ppool))
+			{
+				state->stop = true;
+				break;
+			}
+
+			lock_page(blkno);
+			if (O_PAGE_GET_CHANGE_COUNT(p) != changeCount)
+			{
+				/* the page was changed concurrently, skip the rest of it */
+				unlock_page(blkno);
+				break;
+			}
+			if (tuphdr->downlink != downlink)
+			{
+				unlock_page(blkno);
+				continue;
+			}
+
+			context->items[context->index].locator = loc;
+			load_page(context);
+			state->loaded++;
+
+			/* load_page() re-finds the parent and leaves it locked */
+			parentBlkno = context->items[context->index].blkno;
+			unlock_page(parentBlkno);
+			if (parentBlkno != blkno || O_PAGE_GET_CHANGE_COUNT(p) != changeCount)
+				break;
+
+			/* descend to the loaded page on the next iteration */
+			CHECK_FOR_INTERRUPTS();
+			continue;
+		}
+		BTREE_PAGE_LOCATOR_NEXT(p, &loc);
+	}
+
+	context->index--;
+}
+
+static void
+prewarm_tree(PrewarmTreeState *state)
+{
+	ORelOids	oids = state->records[0].oids;
+	OIndexType	type = (OIndexType) state->records[0].type;
+	OIndexDescr *indexDescr;
+	BTreeDescr *desc;
+	OBTreeFindPageContext context;
+
+	indexDescr = o_fetch_index_descr(oids, type, true, NULL);
+	if (indexDescr == NULL)
+	{
+		/* tree might be deleted */
+		return;
+	}
+	desc = &indexDescr->desc;
+	o_btree_load_shmem(desc);
+
+	if (desc->ppool == get_ppool(OPagePoolMain))
+	{
+		init_page_find_context(&context, desc, COMMITSEQNO_INPROGRESS,
+							   BTREE_PAGE_FIND_MODIFY);
+		prewarm_recursive(desc, state, &context,
+						  desc->rootInfo.rootPageBlkno);
+	}
+
+	o_tables_rel_unlock_extended(&oids, AccessShareLock, true);
+}
+
+/*
+ * Schedules the background load of the S3 data file parts holding the given
+ * pages.  The number of parts is limited by this worker's share of
+ * orioledb.s3_desired_size, so that the parts don't get evicted before we
+ * walk them.
+ */
+static void
+prewarm_schedule_s3_parts(PrewarmRecord *records, uint64 count)
+{
+	uint64		budget,
+				scheduled = 0,
+				i = 0;
+
+	budget = (uint64) s3_desired_size * (uint64) (1024 * 1024) /
+		(uint64) ORIOLEDB_S3_PART_SIZE / (uint64) prewarm_workers;
+
+	while (i < count && scheduled < budget && !shutdown_requested)
+	{
+		ORelOids	oids = records[i].oids;
+		OIndexType	type = (OIndexType) records[i].type;
+		OIndexDescr *indexDescr;
+		uint64		j = i + 1;
+
+		while (j < count && ORelOidsIsEqual(records[j].oids, oids) &&
+			   records[j].type == type)
+			j++;
+
+		indexDescr = o_fetch_index_descr(oids, type, true, NULL);
+		if (indexDescr != NULL)
+		{
+			BTreeDescr *desc = &indexDescr->desc;
+			uint64		lastPart = PG_UINT64_MAX,
+						k;
+
+			/* offsets are sorted, so are the parts */
+			for (k = i; k < j && scheduled < budget; k++)
+			{
+				FileExtent	extent;
+				uint64		part;
+
+				extent.off = records[k].off;
+				extent.len = 1;
+				part = downlink_get_s3_part(desc, MAKE_ON_DISK_DOWNLINK(extent));
+				if (part != lastPart)
+				{
+					prefetch_s3_part(desc, part);
+					lastPart = part;
+					scheduled++;
+				}
+			}
+
+			o_tables_rel_unlock_extended(&oids, AccessShareLock, true);
+		}
+
+		MemoryContextReset(CurTransactionContext);
+		i = j;
+	}
+
+	elog(DEBUG1, "orioledb prewarm scheduled " UINT64_FORMAT " S3 parts to load",
+		 scheduled);
+}
+
+static void
+prewarm_load_resident_pages(int num)
+{
+	PrewarmFileHeader header;
+	PrewarmRecord buffer[PREWARM_BUFFER_SIZE];
+	PrewarmRecord *records;
+	PrewarmTreeState state;
+	File		file;
+	uint64		offset,
+				i,
+				count = 0,
+				allocated = PREWARM_BUFFER_SIZE,
+				loaded = 0;
+
+	file = PathNameOpenFile(PREWARM_FILENAME, O_RDONLY | PG_BINARY);
+	if (file < 0)
+	{
+		if (errno != ENOENT)
+			ereport(LOG, (errcode_for_file_access(),
+						  errmsg("could not open prewarm file %s",
+								 PREWARM_FILENAME)));
+		return;
+	}
+
+	if (OFileRead(file, (Pointer) &header, sizeof(header), 0,
+				  WAIT_EVENT_DATA_FILE_READ) != sizeof(header) ||
+		header.magic != PREWARM_MAGIC)
+	{
+		FileClose(file);
+		elog(LOG, "orioledb prewarm file %s is invalid", PREWARM_FILENAME);
+		return;
+	}
+
+	/* Read the records of the trees this worker is responsible for */
+	records = palloc(sizeof(PrewarmRecord) * allocated);
+	offset = sizeof(header);
+	for (i = 0; i < header.count; i += PREWARM_BUFFER_SIZE)
+	{
+		int			n = Min(header.count - i, PREWARM_BUFFER_SIZE),
+					j;
+
+		if (OFileRead(file, (Pointer) buffer, sizeof(PrewarmRecord) * n,
+					  offset, WAIT_EVENT_DATA_FILE_READ) != sizeof(PrewarmRecord) * n)
+		{
+			elog(LOG, "orioledb prewarm file %s is truncated", PREWARM_FILENAME);
+			break;
+		}
+		offset += sizeof(PrewarmRecord) * n;
+
+		for (j = 0; j < n; j++)
+		{
+			uint32		hash;
+
+			hash = hash_bytes((const unsigned char *) &buffer[j].oids,
+							  sizeof(ORelOids));
+			if (hash % prewarm_workers != num)
+				continue;
+
+			if (count >= allocated)
+			{
+				allocated *= 2;
+				records = repalloc_huge(records,
+										sizeof(PrewarmRecord) * allocated);
+			}
+			records[count++] = buffer[j];
+		}
+	}
+	FileClose(file);
+
+	pg_qsort(records, count, sizeof(PrewarmRecord), prewarm_record_cmp);
+
+	if (orioledb_s3_mode)
+		prewarm_schedule_s3_parts(records, count);
+
+	/* Walk the trees one by one */
+	memset(&state, 0, sizeof(state));
+	i = 0;
+	while (i < count && !state.stop)
+	{
+		uint64		j = i + 1;
+
+		while (j < count && ORelOidsIsEqual(records[j].oids, records[i].oids) &&
+			   records[j].type == records[i].type)
+			j++;
+
+		state.records = &records[i];
+		state.count = j - i;
+		state.loaded = 0;
+		prewarm_tree(&state);
+		loaded += state.loaded;
+
+		MemoryContextReset(CurTransactionContext);
+		i = j;
+	}
+
+	pfree(records);
+	elog(LOG, "orioledb prewarm worker %d loaded " UINT64_FORMAT " pages",
+		 num, loaded);
+}
+
+void
+prewarm_worker_main(Datum main_arg)
+{
+	int			num = DatumGetInt32(main_arg);
+
+	/* enable timeout for relation lock */
+	RegisterTimeout(DEADLOCK_TIMEOUT, CheckDeadLockAlert);
+
+	/* enable relation cache invalidation (remove old OTableDescr) */
+	RelationCacheInitialize();
+	InitCatalogCache();
+	SharedInvalBackendInit(false);
+
+	SetProcessingMode(NormalProcessing);
+
+	pqsignal(SIGTERM, handle_sigterm);
+	BackgroundWorkerUnblockSignals();
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "orioledb prewarm worker");
+	CurTransactionContext = AllocSetContextCreate(TopMemoryContext,
+												  "orioledb prewarm current transaction context",
+												  ALLOCSET_DEFAULT_SIZES);
+	TopTransactionContext = AllocSetContextCreate(TopMemoryContext,
+												  "orioledb prewarm top transaction context",
+												  ALLOCSET_DEFAULT_SIZES);
+
+	PG_TRY();
+	{
+		MemoryContextSwitchTo(TopTransactionContext);
+		prewarm_load_resident_pages(num);
+	}
+	PG_CATCH();
+	{
+		LockReleaseSession(DEFAULT_LOCKMETHOD);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	LockReleaseSession(DEFAULT_LOCKMETHOD);
+	proc_exit(0);
+}
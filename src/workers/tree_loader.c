@@ -0,0 +1,188 @@
+/*-------------------------------------------------------------------------
+ *
+ * tree_loader.c
+ *		Routines for loading the trees ahead of recovery.
+ *
+ * Recovery loads the shared root info of each tree the first time a WAL
+ * record touches it.  That requires reading the checkpoint metadata and the
+ * root page of the tree, so with many trees the beginning of recovery is
+ * dominated by opening them one by one.  Tree loaders are launched by the
+ * startup process and load all the trees listed in o_indices in parallel
+ * while the WAL is replayed.  The trees are split between loaders by the hash
+ * of their oids.
+ *
+ * Copyright (c) 2021-2023, Oriole DB Inc.
+ *
+ * IDENTIFICATION
+ *	  contrib/orioledb/src/workers/tree_loader.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "orioledb.h"
+
+#include "catalog/o_indices.h"
+#include "catalog/o_tables.h"
+#include "tableam/descr.h"
+#include "workers/tree_loader.h"
+
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "storage/ipc.h"
+#include "storage/lock.h"
+#include "storage/sinvaladt.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+#include "utils/timeout.h"
+
+typedef struct
+{
+	ORelOids	oids;
+	OIndexType	type;
+} TreeLoaderItem;
+
+typedef struct
+{
+	int			num;
+	TreeLoaderItem *items;
+	int			count;
+	int			allocated;
+} TreeLoaderState;
+
+static volatile sig_atomic_t shutdown_requested = false;
+
+static void
+handle_sigterm(SIGNAL_ARGS)
+{
+	shutdown_requested = true;
+	SetLatch(MyLatch);
+}
+
+/*
+ * Registers a new tree loader.  Returns NULL if no background worker slots
+ * available.
+ */
+BackgroundWorkerHandle *
+tree_loader_register(int num)
+{
+	BackgroundWorker worker;
+	BackgroundWorkerHandle *handle = NULL;
+
+	/* Set up background worker parameters */
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main_arg = Int32GetDatum(num);
+	strcpy(worker.bgw_library_name, "orioledb");
+	strcpy(worker.bgw_function_name, "tree_loader_main");
+	strcpy(worker.bgw_name, "orioledb tree loader");
+	strcpy(worker.bgw_type, "orioledb tree loader");
+	RegisterDynamicBackgroundWorker(&worker, &handle);
+
+	return handle;
+}
+
+static void
+tree_loader_add_item(OIndexType type, ORelOids treeOids, ORelOids tableOids,
+					 void *arg)
+{
+	TreeLoaderState *state = (TreeLoaderState *) arg;
+	uint32		hash;
+
+	hash = hash_bytes((const unsigned char *) &treeOids, sizeof(ORelOids));
+	if (hash % recovery_tree_loaders != state->num)
+		return;
+
+	if (state->count >= state->allocated)
+	{
+		state->allocated *= 2;
+		state->items = repalloc_huge(state->items,
+									 sizeof(TreeLoaderItem) * state->allocated);
+	}
+	state->items[state->count].oids = treeOids;
+	state->items[state->count].type = type;
+	state->count++;
+}
+
+static void
+tree_loader_load_trees(int num)
+{
+	TreeLoaderState state;
+	int			i,
+				loaded = 0;
+
+	state.num = num;
+	state.count = 0;
+	state.allocated = 256;
+	state.items = palloc(sizeof(TreeLoaderItem) * state.allocated);
+
+	o_indices_foreach_oids(tree_loader_add_item, &state);
+
+	for (i = 0; i < state.count && !shutdown_requested; i++)
+	{
+		OIndexDescr *indexDescr;
+
+		/* takes the checkpoint lock, so the tree can't be dropped meanwhile */
+		indexDescr = o_fetch_index_descr(state.items[i].oids,
+										 state.items[i].type, true, NULL);
+		if (indexDescr == NULL)
+		{
+			/* tree might be deleted */
+			continue;
+		}
+		o_btree_load_shmem(&indexDescr->desc);
+		o_tables_rel_unlock_extended(&state.items[i].oids, AccessShareLock,
+									 true);
+		loaded++;
+
+		MemoryContextReset(CurTransactionContext);
+	}
+
+	pfree(state.items);
+	elog(LOG, "orioledb tree loader %d loaded %d trees", num, loaded);
+}
+
+void
+tree_loader_main(Datum main_arg)
+{
+	int			num = DatumGetInt32(main_arg);
+
+	/* enable timeout for relation lock */
+	RegisterTimeout(DEADLOCK_TIMEOUT, CheckDeadLockAlert);
+
+	/* enable relation cache invalidation (remove old OTableDescr) */
+	RelationCacheInitialize();
+	InitCatalogCache();
+	SharedInvalBackendInit(false);
+
+	SetProcessingMode(NormalProcessing);
+
+	pqsignal(SIGTERM, handle_sigterm);
+	BackgroundWorkerUnblockSignals();
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "orioledb tree loader");
+	CurTransactionContext = AllocSetContextCreate(TopMemoryContext,
+												  "orioledb tree loader current transaction context",
+												  ALLOCSET_DEFAULT_SIZES);
+	TopTransactionContext = AllocSetContextCreate(TopMemoryContext,
+												  "orioledb tree loader top transaction context",
+												  ALLOCSET_DEFAULT_SIZES);
+
+	PG_TRY();
+	{
+		MemoryContextSwitchTo(TopTransactionContext);
+		tree_loader_load_trees(num);
+	}
+	PG_CATCH();
+	{
+		LockReleaseSession(DEFAULT_LOCKMETHOD);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	LockReleaseSession(DEFAULT_LOCKMETHOD);
+	proc_exit(0);
+}
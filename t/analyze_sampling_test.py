@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class AnalyzeSamplingTest(BaseTest):
+
+	def check_reltuples(self, expected):
+		reltuples = self.node.execute("""
+			SELECT reltuples FROM pg_class WHERE relname = 'o_test';
+		""")[0][0]
+		self.assertGreater(reltuples, expected * 0.8)
+		self.assertLess(reltuples, expected * 1.2)
+
+	def test_analyze_random_descent(self):
+		node = self.node
+		node.append_conf('postgresql.conf', "orioledb.main_buffers = 8MB\n")
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				id int NOT NULL PRIMARY KEY,
+				val int
+			) USING orioledb;
+			ALTER TABLE o_test ALTER COLUMN val SET STATISTICS 1;
+			ALTER TABLE o_test ALTER COLUMN id SET STATISTICS 1;
+			INSERT INTO o_test
+				SELECT i, i % 100 FROM generate_series(1, 500000) i;
+		""")
+
+		# Sampled leaves are both in memory and on disk
+		node.safe_psql("ANALYZE o_test;")
+		self.check_reltuples(500000)
+
+		node.safe_psql("CHECKPOINT;")
+		node.stop()
+		node.start()
+
+		# Sampled leaves are on disk only
+		node.safe_psql("ANALYZE o_test;")
+		self.check_reltuples(500000)
+		node.stop()
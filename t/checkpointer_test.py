@@ -99,6 +99,49 @@ class CheckpointerTest(BaseTest):
 		    10000)
 		node.stop()
 
+	def test_checkpoint_progress(self):
+		node = self.node
+		node.append_conf(
+		    'postgresql.conf', "orioledb.debug_checkpoint_timeout = 2s\n"
+		    "orioledb.enable_stopevents = true\n")
+		node.start()
+		con1 = node.connect()
+
+		node.safe_psql(
+		    'postgres', "CREATE EXTENSION IF NOT EXISTS orioledb;\n"
+		    "CREATE TABLE o_test (\n"
+		    "	id integer NOT NULL,\n"
+		    "	val text,\n"
+		    "	PRIMARY KEY (id)\n"
+		    ") USING orioledb;\n")
+		con1.execute("SELECT pg_stopevent_set('checkpoint_step', 'true');")
+
+		node.safe_psql(
+		    'postgres', "INSERT INTO o_test\n"
+		    "	(SELECT id, id || 'val' FROM generate_series(1, 1000, 1) id);\n")
+
+		wait_checkpointer_stopevent(node)
+		progress = node.execute(
+		    "SELECT pid, pages_visited >= 0, progress BETWEEN 0 AND 1\n"
+		    "  FROM orioledb_checkpoint_progress;")
+		self.assertEqual(len(progress), 1)
+		self.assertEqual(progress[0][1:], (True, True))
+
+		con1.execute("SELECT pg_stopevent_reset('checkpoint_step')")
+		con1.close()
+		node.safe_psql('postgres', "CHECKPOINT;")
+
+		self.assertEqual(
+		    node.execute(
+		        "SELECT count(*) FROM orioledb_checkpoint_progress;")[0][0],
+		    0)
+		self.assertGreater(
+		    node.execute(
+		        "SELECT checkpoint_pages FROM orioledb_tree_stats()\n"
+		        "  WHERE reloid = 'o_test'::regclass AND\n"
+		        "        index_type = 'primary';")[0][0], 0)
+		node.stop()
+
 	def is_checkpoint_exist(self):
 		orioledb_dir = self.node.data_dir + "/orioledb_data"
 		exist = False
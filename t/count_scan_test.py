@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class CountScanTest(BaseTest):
+
+	def explain(self, query):
+		return "\n".join(row[0] for row in
+		                 self.node.execute("EXPLAIN (COSTS OFF) " + query))
+
+	def test_count_star(self):
+		node = self.node
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				id int NOT NULL PRIMARY KEY,
+				val int
+			) USING orioledb;
+			INSERT INTO o_test
+				SELECT i, i % 100 FROM generate_series(1, 10000) i;
+		""")
+		self.assertIn("Count of: o_test",
+		              self.explain("SELECT count(*) FROM o_test"))
+		self.assertNotIn("Count of",
+		                 self.explain("SELECT count(*) FROM o_test "
+		                              "WHERE val = 1"))
+		self.assertNotIn("Count of", self.explain("SELECT count(val) "
+		                                          "FROM o_test"))
+
+		self.assertEqual(node.execute("SELECT count(*) FROM o_test")[0][0],
+		                 10000)
+		self.assertEqual(
+		    node.execute("SELECT count(*), count(*) + 1 FROM o_test")[0],
+		    (10000, 10001))
+
+		node.safe_psql("DELETE FROM o_test WHERE id > 6000;")
+		self.assertEqual(node.execute("SELECT count(*) FROM o_test")[0][0],
+		                 6000)
+
+		con1 = node.connect()
+		con2 = node.connect()
+		con1.execute("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ;")
+		self.assertEqual(con1.execute("SELECT count(*) FROM o_test")[0][0],
+		                 6000)
+		con2.begin()
+		con2.execute("INSERT INTO o_test VALUES (10001, 1);")
+		con2.execute("DELETE FROM o_test WHERE id <= 10;")
+		self.assertEqual(con2.execute("SELECT count(*) FROM o_test")[0][0],
+		                 5991)
+		con2.commit()
+		self.assertEqual(con1.execute("SELECT count(*) FROM o_test")[0][0],
+		                 6000)
+		con1.commit()
+		self.assertEqual(node.execute("SELECT count(*) FROM o_test")[0][0],
+		                 5991)
+		con1.close()
+		con2.close()
+		node.stop()
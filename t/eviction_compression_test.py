@@ -50,6 +50,16 @@ class EvictionCompressionTest(BaseTest):
 	def test_eviction_compress_simple(self):
 		self.eviction_simple_base(True)
 
+	def test_eviction_compressed_buffers(self):
+		self.node.append_conf('postgresql.conf',
+		                      "orioledb.compressed_buffers = 4MB\n")
+		self.eviction_simple_base(False)
+
+	def test_eviction_compress_compressed_buffers(self):
+		self.node.append_conf('postgresql.conf',
+		                      "orioledb.compressed_buffers = 4MB\n")
+		self.eviction_simple_base(True)
+
 	def eviction_toast_base(self, compressed):
 		node = self.node
 		node.append_conf('postgresql.conf', "orioledb.main_buffers = 8MB\n")
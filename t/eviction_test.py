@@ -507,3 +507,196 @@ class EvictionTest(BaseTest):
 		self.assertTrue(
 		    node.execute("SELECT orioledb_tbl_check('o_evicted'::regclass)")[0]
 		    [0])
+
+	def test_eviction_buffers_options(self):
+		node = self.node
+		node.append_conf('postgresql.conf', "orioledb.main_buffers = 8MB\n")
+		node.start()
+		node.safe_psql(
+		    'postgres', "CREATE EXTENSION IF NOT EXISTS orioledb;\n"
+		    "CREATE TABLE o_pinned (\n"
+		    "	id integer NOT NULL,\n"
+		    "	val text NOT NULL,\n"
+		    "	PRIMARY KEY (id)\n"
+		    ") USING orioledb\n"
+		    "  WITH (buffers_min_pages = 100, buffers_priority = high);\n"
+		    "CREATE TABLE o_bulk (\n"
+		    "	id integer NOT NULL,\n"
+		    "	val text NOT NULL,\n"
+		    "	PRIMARY KEY (id)\n"
+		    ") USING orioledb\n"
+		    "  WITH (buffers_max_percent = 50, buffers_priority = low);\n")
+		node.safe_psql(
+		    'postgres', "INSERT INTO o_pinned\n"
+		    "    (SELECT id, repeat('x', 100) FROM generate_series(1, 5000, 1) id);"
+		)
+		node.safe_psql(
+		    'postgres', "INSERT INTO o_bulk\n"
+		    "    (SELECT id, repeat('x', 100) FROM generate_series(1, 100000, 1) id);"
+		)
+		self.assertEqual(
+		    node.execute("SELECT COUNT(*) FROM o_pinned;")[0][0], 5000)
+		self.assertEqual(
+		    node.execute("SELECT COUNT(*) FROM o_bulk;")[0][0], 100000)
+
+		node.safe_psql(
+		    'postgres', "ALTER TABLE o_pinned RESET (buffers_priority);\n"
+		    "ALTER TABLE o_bulk SET (buffers_max_percent = 0);\n")
+		node.safe_psql(
+		    'postgres', "UPDATE o_bulk SET val = repeat('y', 100)\n"
+		    "    WHERE id % 10 = 0;")
+		self.assertEqual(
+		    node.execute("SELECT COUNT(*) FROM o_pinned;")[0][0], 5000)
+		self.assertEqual(
+		    node.execute(
+		        "SELECT COUNT(*) FROM o_bulk WHERE val = repeat('y', 100);")[0]
+		    [0], 10000)
+		self.assertTrue(
+		    node.execute("SELECT orioledb_tbl_check('o_pinned'::regclass)")[0]
+		    [0])
+		self.assertTrue(
+		    node.execute("SELECT orioledb_tbl_check('o_bulk'::regclass)")[0]
+		    [0])
+		node.stop()
+
+	def test_eviction_ghost_history(self):
+		node = self.node
+		node.append_conf(
+		    'postgresql.conf', "orioledb.main_buffers = 8MB\n"
+		    "orioledb.main_buffers_ghost = on\n")
+		node.start()
+		node.safe_psql(
+		    'postgres', "CREATE EXTENSION IF NOT EXISTS orioledb;\n"
+		    "CREATE TABLE o_test (\n"
+		    "	id integer NOT NULL,\n"
+		    "	val text NOT NULL,\n"
+		    "	PRIMARY KEY (id)\n"
+		    ") USING orioledb;\n")
+		node.safe_psql(
+		    'postgres', "INSERT INTO o_test\n"
+		    "    (SELECT id, repeat('x', 100) FROM generate_series(1, 100000, 1) id);"
+		)
+		for i in range(3):
+			self.assertEqual(
+			    node.execute("SELECT COUNT(*) FROM o_test WHERE id % 7 = 0;")
+			    [0][0], 14285)
+		stats = node.execute(
+		    "SELECT accesses, loads, ghost_hits FROM orioledb_page_hit_stats()\n"
+		    "  WHERE pool_name = 'main';")[0]
+		self.assertGreater(stats[0], 0)
+		self.assertGreater(stats[1], 0)
+		self.assertGreater(stats[2], 0)
+		node.stop()
+
+	def test_eviction_prewarm(self):
+		node = self.node
+		node.append_conf(
+		    'postgresql.conf', "orioledb.main_buffers = 32MB\n"
+		    "orioledb.prewarm_workers = 1\n")
+		node.start()
+		node.safe_psql(
+		    'postgres', "CREATE EXTENSION IF NOT EXISTS orioledb;\n"
+		    "CREATE TABLE o_test (\n"
+		    "	id integer NOT NULL,\n"
+		    "	val text NOT NULL,\n"
+		    "	PRIMARY KEY (id)\n"
+		    ") USING orioledb;\n")
+		node.safe_psql(
+		    'postgres', "INSERT INTO o_test\n"
+		    "    (SELECT id, repeat('x', 100) FROM generate_series(1, 20000, 1) id);"
+		)
+		node.safe_psql('postgres', "CHECKPOINT;")
+		node.stop()
+		node.start()
+		node.poll_query_until(
+		    "SELECT loads > 0 FROM orioledb_page_hit_stats()\n"
+		    "  WHERE pool_name = 'main';")
+		self.assertEqual(
+		    node.execute("SELECT COUNT(*) FROM o_test;")[0][0], 20000)
+		node.stop()
+
+	def test_eviction_tree_stats(self):
+		node = self.node
+		node.append_conf('postgresql.conf', "orioledb.main_buffers = 8MB\n")
+		node.start()
+		node.safe_psql(
+		    'postgres', "CREATE EXTENSION IF NOT EXISTS orioledb;\n"
+		    "CREATE TABLE o_test (\n"
+		    "	id integer NOT NULL,\n"
+		    "	val text NOT NULL,\n"
+		    "	PRIMARY KEY (id)\n"
+		    ") USING orioledb;\n")
+		node.safe_psql(
+		    'postgres', "INSERT INTO o_test\n"
+		    "    (SELECT id, repeat('x', 100) FROM generate_series(1, 100000, 1) id);"
+		)
+		self.assertEqual(
+		    node.execute("SELECT COUNT(*) FROM o_test WHERE id % 7 = 0;")[0][0],
+		    14285)
+		stats = node.execute(
+		    "SELECT resident_pages, array_length(pages_by_level, 1),\n"
+		    "       loads, evictions, find_hits\n"
+		    "  FROM orioledb_tree_stats()\n"
+		    "  WHERE reloid = 'o_test'::regclass AND index_type = 'primary';"
+		)[0]
+		self.assertGreater(stats[0], 0)
+		self.assertGreater(stats[1], 1)
+		self.assertGreater(stats[2], 0)
+		self.assertGreater(stats[3], 0)
+		self.assertGreater(stats[4], 0)
+		stats = node.execute(
+		    "SELECT inserts, splits, eviction_bytes, undo_bytes\n"
+		    "  FROM orioledb_tree_stats\n"
+		    "  WHERE reloid = 'o_test'::regclass AND index_type = 'primary';"
+		)[0]
+		self.assertGreater(stats[0], 0)
+		self.assertGreater(stats[1], 0)
+		self.assertGreater(stats[2], 0)
+		self.assertGreater(stats[3], 0)
+		stats = node.execute(
+		    "SELECT size, used, free, high_water\n"
+		    "  FROM orioledb_shmem_stats\n"
+		    "  WHERE name = 'page_pools';")[0]
+		self.assertGreaterEqual(stats[0], 8 * 1024 * 1024)
+		self.assertGreater(stats[1], 0)
+		self.assertGreaterEqual(stats[3], stats[1])
+		node.poll_query_until(
+		    "SELECT count > 0 AND total_time > 0\n"
+		    "  FROM orioledb_latency_stats\n"
+		    "  WHERE operation = 'eviction';")
+		stats = node.execute(
+		    "SELECT array_length(latency_bounds, 1) + 1,\n"
+		    "       array_length(latency_histogram, 1)\n"
+		    "  FROM orioledb_latency_stats\n"
+		    "  WHERE operation = 'eviction';")[0]
+		self.assertEqual(stats[0], stats[1])
+		node.stop()
+
+	def test_eviction_temp_table_checkpoint(self):
+		node = self.node
+		node.append_conf('postgresql.conf', "orioledb.main_buffers = 8MB\n")
+		node.start()
+		node.safe_psql('postgres', "CREATE EXTENSION IF NOT EXISTS orioledb;")
+		con1 = node.connect()
+		con1.execute("CREATE TEMP TABLE o_temp (\n"
+		             "	id integer NOT NULL,\n"
+		             "	val text NOT NULL,\n"
+		             "	PRIMARY KEY (id)\n"
+		             ") USING orioledb;")
+		con1.execute("INSERT INTO o_temp\n"
+		             "	SELECT id, repeat('x', 200)\n"
+		             "	FROM generate_series(1, 50000) id;")
+		con1.commit()
+		for i in range(3):
+			node.safe_psql('postgres', "CHECKPOINT;")
+			con1.execute("UPDATE o_temp SET val = repeat('%d', 200)\n"
+			             "	WHERE id %% 3 = %d;" % (i, i))
+			con1.commit()
+		self.assertEqual(
+		    con1.execute("SELECT count(*), count(DISTINCT val)\n"
+		                 "  FROM o_temp;")[0], (50000, 3))
+		self.assertTrue(
+		    con1.execute("SELECT orioledb_tbl_check('o_temp'::regclass);")[0]
+		    [0])
+		con1.close()
+		node.stop()
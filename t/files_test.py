@@ -535,3 +535,58 @@ class FilesTest(BaseTest):
 		    f for f in glob.glob(node.data_dir + "/orioledb_data/*/*.evt")
 		]
 		self.assertEqual(len(evt_files), 0)
+
+	def get_data_files_size(self):
+		return sum(
+		    os.path.getsize(f)
+		    for f in glob.glob(self.node.data_dir + "/orioledb_data/*/*")
+		    if re.match(r".*/\d+(\.\d+)?$", f))
+
+	def test_compact_compressed(self):
+		node = self.node
+		node.append_conf('postgresql.conf',
+		                 "orioledb.debug_disable_bgwriter = true\n")
+		node.start()
+		node.safe_psql(
+		    'postgres', """
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				key int NOT NULL,
+				val text NOT NULL,
+				PRIMARY KEY (key)
+			) USING orioledb WITH (compress = 1);
+			INSERT INTO o_test
+				(SELECT i, repeat('x', i % 100) FROM generate_series(1, 50000) i);
+			CHECKPOINT;""")
+
+		# copy-on-write checkpoints leave free extents across the file
+		for i in range(3):
+			node.safe_psql(
+			    'postgres', "UPDATE o_test SET val = val || 'y';\n"
+			    "CHECKPOINT;")
+		node.safe_psql('postgres', "DELETE FROM o_test WHERE key > 5000;\n"
+		               "CHECKPOINT;")
+
+		size_before = self.get_data_files_size()
+		reclaimed = 0
+		for i in range(3):
+			reclaimed += node.execute(
+			    "SELECT orioledb_tbl_compact('o_test'::regclass);")[0][0]
+			node.safe_psql('postgres', "CHECKPOINT;")
+		self.assertGreaterEqual(reclaimed, 0)
+		self.assertLessEqual(self.get_data_files_size(), size_before)
+		self.assertTrue(
+		    node.execute("SELECT orioledb_tbl_check('o_test'::regclass, TRUE);")
+		    [0][0])
+
+		node.stop(['-m', 'immediate'])
+		node.start()
+		self.assertEqual(
+		    node.execute("SELECT count(*), sum(length(val)) FROM o_test;")[0],
+		    node.execute(
+		        "SELECT count(*), sum(length(repeat('x', i % 100)) + 3) "
+		        "FROM generate_series(1, 5000) i;")[0])
+		self.assertTrue(
+		    node.execute("SELECT orioledb_tbl_check('o_test'::regclass, TRUE);")
+		    [0][0])
+		node.stop()
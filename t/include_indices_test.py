@@ -285,3 +285,48 @@ class IncludeIndicesTest(BaseTest):
 				SELECT * FROM o_test_1 ORDER BY val_1;
 			"""))
 		node.stop()
+
+	def test_include_index_only_scan(self):
+		node = self.node
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+
+			CREATE TABLE o_test_ios (
+				id int PRIMARY KEY,
+				val_1 int,
+				val_2 int,
+				val_3 text
+			) USING orioledb;
+
+			CREATE INDEX o_test_ios_ix1 ON o_test_ios (val_1) INCLUDE (val_2);
+
+			INSERT INTO o_test_ios SELECT x, x % 100, x, repeat('x', 100)
+				FROM generate_series(1, 10000) AS x;
+			ANALYZE o_test_ios;
+		""")
+
+		con1 = node.connect()
+		con2 = node.connect()
+		query = "SELECT val_1, sum(val_2) FROM o_test_ios " \
+		        "WHERE val_1 BETWEEN 10 AND 12 GROUP BY val_1 ORDER BY val_1"
+		plan = con1.execute("EXPLAIN (COSTS OFF) " + query)
+		self.assertIn("index only scan of: o_test_ios_ix1",
+		              "\n".join(row[0] for row in plan))
+
+		con1.begin("REPEATABLE READ")
+		before = con1.execute(query)
+		self.assertEqual([(10, 496000), (11, 496100), (12, 496200)], before)
+
+		con2.execute("UPDATE o_test_ios SET val_2 = 0 WHERE val_1 = 11")
+		con2.execute("DELETE FROM o_test_ios WHERE val_1 = 12")
+		con2.commit()
+
+		# The secondary tree alone decides visibility
+		self.assertEqual(before, con1.execute(query))
+		con1.commit()
+		self.assertEqual([(10, 496000), (11, 0)], con1.execute(query))
+
+		con1.close()
+		con2.close()
+		node.stop()
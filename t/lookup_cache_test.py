@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class LookupCacheTest(BaseTest):
+
+	def test_lookup_cache_splits(self):
+		node = self.node
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				key text NOT NULL PRIMARY KEY,
+				val int NOT NULL
+			) USING orioledb;
+			INSERT INTO o_test
+				SELECT 'key' || i, i FROM generate_series(1, 1000) i;
+		""")
+
+		con = node.connect()
+		con.execute("SET orioledb.lookup_cache_size = 1024;")
+		for i in range(1, 1001, 7):
+			self.assertEqual(
+			    con.execute("SELECT val FROM o_test WHERE key = 'key%d';" %
+			                i)[0][0], i)
+
+		# Split the cached leaves and move the keys to other pages
+		node.safe_psql("""
+			INSERT INTO o_test
+				SELECT 'key' || i || repeat('x', 100), i
+				FROM generate_series(1, 3000) i;
+			DELETE FROM o_test WHERE val % 7 = 1 AND val <= 1000
+				AND key NOT LIKE '%x';
+		""")
+
+		for i in range(1, 1001, 7):
+			self.assertEqual(
+			    con.execute("SELECT count(*) FROM o_test WHERE key = 'key%d';" %
+			                i)[0][0], 0)
+			self.assertEqual(
+			    con.execute("SELECT val FROM o_test WHERE key = 'key%d';" %
+			                (i + 1))[0][0], i + 1)
+		con.close()
+		node.stop()
@@ -71,3 +71,88 @@ class ParallelTest(BaseTest):
 			node.start()
 
 			node.stop()
+
+	def test_parallel_index_scan(self):
+		with self.node as node:
+			node.start()
+			node.safe_psql("CREATE EXTENSION orioledb;")
+			with node.connect() as con:
+				con.execute("""
+					CREATE TABLE o_test (
+						id int PRIMARY KEY,
+						val int
+					) USING orioledb;
+					CREATE INDEX o_test_val_ix ON o_test (val);
+					INSERT INTO o_test
+						SELECT id, (id * 7919) % 100000
+						FROM generate_series(1, 100000) id;
+				""")
+				con.commit()
+
+				queries = [
+				    "SELECT count(*), sum(val) FROM o_test "
+				    "WHERE id BETWEEN 1000 AND 90000",
+				    "SELECT count(*), sum(id) FROM o_test "
+				    "WHERE val >= 500 AND val < 70000",
+				    "SELECT val FROM o_test WHERE val >= 99000 ORDER BY val",
+				    "SELECT count(*) FROM o_test WHERE id IN (1, 500, 90000)"
+				]
+				expected = [con.execute(query) for query in queries]
+
+				con.execute("""
+					SET parallel_setup_cost = 0;
+					SET parallel_tuple_cost = 0;
+					SET min_parallel_table_scan_size = 0;
+					SET max_parallel_workers_per_gather = 3;
+					SET enable_seqscan = off;
+					SET enable_bitmapscan = off;
+				""")
+				plan = con.execute("EXPLAIN (COSTS OFF) " + queries[0])
+				self.assertIn("Parallel Custom Scan (o_scan) on o_test",
+				              "\n".join(row[0] for row in plan))
+				for query, result in zip(queries, expected):
+					self.assertEqual(result, con.execute(query))
+			node.stop()
+
+	def test_parallel_bitmap_scan(self):
+		with self.node as node:
+			node.start()
+			node.safe_psql("CREATE EXTENSION orioledb;")
+			with node.connect() as con:
+				con.execute("""
+					CREATE TABLE o_test (
+						id int PRIMARY KEY,
+						a int,
+						b int
+					) USING orioledb;
+					CREATE INDEX o_test_a_ix ON o_test (a);
+					CREATE INDEX o_test_b_ix ON o_test (b);
+					INSERT INTO o_test
+						SELECT id, (id * 7919) % 1000, (id * 104729) % 1000
+						FROM generate_series(1, 100000) id;
+					ANALYZE o_test;
+				""")
+				con.commit()
+
+				queries = [
+				    "SELECT count(*), sum(id) FROM o_test "
+				    "WHERE a < 100 AND b < 500",
+				    "SELECT count(*), sum(id) FROM o_test "
+				    "WHERE a < 50 OR b > 950"
+				]
+				expected = [con.execute(query) for query in queries]
+
+				con.execute("""
+					SET parallel_setup_cost = 0;
+					SET parallel_tuple_cost = 0;
+					SET min_parallel_table_scan_size = 0;
+					SET max_parallel_workers_per_gather = 3;
+					SET enable_seqscan = off;
+					SET enable_indexscan = off;
+				""")
+				for query, result in zip(queries, expected):
+					plan = con.execute("EXPLAIN (COSTS OFF) " + query)
+					self.assertIn("Parallel Custom Scan (o_scan) on o_test",
+					              "\n".join(row[0] for row in plan))
+					self.assertEqual(result, con.execute(query))
+			node.stop()
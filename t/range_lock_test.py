@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+from testgres.connection import DatabaseError
+
+
+class RangeLockTest(BaseTest):
+
+	def test_range_lock_insert(self):
+		node = self.node
+		node.append_conf('postgresql.conf', "orioledb.max_range_locks = 16\n")
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				id int NOT NULL PRIMARY KEY,
+				val text
+			) USING orioledb;
+			INSERT INTO o_test VALUES (5, 'a'), (30, 'b');
+		""")
+
+		con1 = node.connect()
+		con2 = node.connect()
+		con1.begin()
+		con1.execute("SELECT orioledb_range_lock('o_test'::regclass, 10, 20);")
+		self.assertEqual(
+		    con1.execute("SELECT count(*) FROM o_test "
+		                 "WHERE id BETWEEN 10 AND 20;")[0][0], 0)
+
+		con2.execute("SET lock_timeout = '100ms';")
+		con2.begin()
+		with self.assertRaises(DatabaseError):
+			con2.execute("INSERT INTO o_test VALUES (15, 'c');")
+		con2.rollback()
+		con2.execute("INSERT INTO o_test VALUES (25, 'c');")
+		con2.commit()
+
+		con1.execute("INSERT INTO o_test VALUES (15, 'd');")
+		con1.commit()
+
+		con2.execute("INSERT INTO o_test VALUES (16, 'e');")
+		con2.commit()
+		self.assertEqual(
+		    con2.execute("SELECT id, val FROM o_test ORDER BY id;"),
+		    [(5, 'a'), (15, 'd'), (16, 'e'), (25, 'c'), (30, 'b')])
+		con1.close()
+		con2.close()
+		node.stop()
+
+	def test_range_lock_waits_for_insert(self):
+		node = self.node
+		node.append_conf('postgresql.conf', "orioledb.max_range_locks = 16\n")
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				id int NOT NULL PRIMARY KEY
+			) USING orioledb;
+		""")
+
+		con1 = node.connect()
+		con2 = node.connect()
+		con1.begin()
+		con1.execute("INSERT INTO o_test VALUES (15);")
+
+		con2.execute("SET lock_timeout = '100ms';")
+		con2.begin()
+		with self.assertRaises(DatabaseError):
+			con2.execute(
+			    "SELECT orioledb_range_lock('o_test'::regclass, 10, NULL::int);"
+			)
+		con2.rollback()
+		con1.commit()
+
+		con2.execute(
+		    "SELECT orioledb_range_lock('o_test'::regclass, 10, NULL::int);")
+		self.assertEqual(
+		    con2.execute("SELECT count(*) FROM o_test;")[0][0], 1)
+		con2.commit()
+		con1.close()
+		con2.close()
+		node.stop()
@@ -674,6 +674,44 @@ class RecoveryTest(BaseTest):
 		    "[(1000, 500498)]")
 		node.stop()  # stop PostgreSQL
 
+	def test_wal_update_delta(self):
+		node = self.node
+		node.start()  # start PostgreSQL
+		node.safe_psql(
+		    'postgres', "CREATE EXTENSION IF NOT EXISTS orioledb;\n"
+		    "CREATE TABLE IF NOT EXISTS o_test (\n"
+		    "	id integer NOT NULL,\n"
+		    "	counter integer NOT NULL,\n"
+		    "	status text NOT NULL,\n"
+		    "	payload text NOT NULL,\n"
+		    "	PRIMARY KEY (id)\n"
+		    ") USING orioledb;\n"
+		    "CREATE INDEX o_test_ix1 ON o_test (status);\n"
+		    "INSERT INTO o_test\n"
+		    "	(SELECT id, 0, 'new', repeat('x', 1000)\n"
+		    "	 FROM generate_series(1, 100, 1) id);\n")
+		node.safe_psql(
+		    'postgres', "CHECKPOINT;\n"
+		    "UPDATE o_test SET counter = counter + 1 WHERE id <= 50;\n"
+		    "UPDATE o_test SET counter = counter + 1 WHERE id <= 50;\n"
+		    "UPDATE o_test SET status = 'done' WHERE id % 2 = 0;\n"
+		    "UPDATE o_test SET counter = counter + 1 WHERE id <= 50;\n")
+		node.stop(['-m', 'immediate'])
+
+		node.start()
+		self.assertEqual(
+		    str(
+		        node.execute(
+		            'postgres', "SELECT count(*), sum(counter),\n"
+		            "	sum(length(payload)) FROM o_test;")), "[(100, 150, 100000)]")
+		self.assertEqual(
+		    str(
+		        node.execute(
+		            'postgres', "SET enable_seqscan = off;\n"
+		            "SELECT count(*), sum(counter) FROM o_test\n"
+		            "WHERE status = 'done';")), "[(50, 75)]")
+		node.stop()
+
 	def test_wal_update_sec_index(self):
 		node = self.node
 		node.start()  # start PostgreSQL
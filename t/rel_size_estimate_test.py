@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class RelSizeEstimateTest(BaseTest):
+
+	def plan_rows(self, query):
+		plan = self.node.execute("EXPLAIN (FORMAT JSON) " + query)
+		return plan[0][0][0]['Plan']['Plan Rows']
+
+	def test_estimate_without_analyze(self):
+		node = self.node
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				id int NOT NULL PRIMARY KEY,
+				val int
+			) USING orioledb;
+			CREATE INDEX o_test_val_idx ON o_test (val);
+			INSERT INTO o_test
+				SELECT i, i % 100 FROM generate_series(1, 10000) i;
+		""")
+		self.assertEqual(self.plan_rows("SELECT * FROM o_test"), 10000)
+
+		node.safe_psql("DELETE FROM o_test WHERE id > 6000;")
+		self.assertEqual(self.plan_rows("SELECT * FROM o_test"), 6000)
+
+		node.safe_psql("INSERT INTO o_test VALUES (10001, 1);")
+		self.assertEqual(self.plan_rows("SELECT * FROM o_test"), 6001)
+
+		node.stop()
+		node.start()
+		self.assertEqual(self.plan_rows("SELECT * FROM o_test"), 6001)
+		node.stop()
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class SkipScanTest(BaseTest):
+
+	def test_skip_scan_composite_pk(self):
+		node = self.node
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				tenant int NOT NULL,
+				ts int NOT NULL,
+				val int,
+				PRIMARY KEY (tenant, ts)
+			) USING orioledb;
+			INSERT INTO o_test
+				SELECT t, ts, t * ts
+				FROM generate_series(1, 10) t,
+					 generate_series(1, 5000) ts;
+		""")
+
+		queries = [
+		    "SELECT count(*), sum(val) FROM o_test WHERE ts > 4990",
+		    "SELECT count(*), sum(val) FROM o_test "
+		    "WHERE ts BETWEEN 100 AND 120",
+		    "SELECT count(*), sum(val) FROM o_test "
+		    "WHERE tenant > 3 AND ts < 10",
+		    "SELECT tenant, ts FROM o_test WHERE ts >= 4998 "
+		    "ORDER BY tenant, ts",
+		    "SELECT tenant, ts FROM o_test WHERE ts <= 2 "
+		    "ORDER BY tenant DESC, ts DESC",
+		    "SELECT count(*) FROM o_test "
+		    "WHERE tenant IN (2, 5, 7) AND ts > 4000"
+		]
+
+		con = node.connect()
+		con.execute("SET enable_indexscan = off; SET enable_bitmapscan = off;")
+		expected = [con.execute(query) for query in queries]
+
+		con.execute("""
+			SET enable_indexscan = on;
+			SET enable_seqscan = off;
+		""")
+		for query, result in zip(queries, expected):
+			plan = con.execute("EXPLAIN (COSTS OFF) " + query)
+			self.assertIn("scan of: o_test_pkey", "\n".join(row[0] for row in plan))
+			self.assertEqual(result, con.execute(query))
+		con.close()
+		node.stop()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class SplitTest(BaseTest):
+
+	def test_optimized_split_separator(self):
+		node = self.node
+		node.append_conf('postgresql.conf',
+		                 "orioledb.enable_optimized_split = on\n"
+		                 "orioledb.enable_suffix_truncation = on\n")
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				grp text NOT NULL,
+				id int NOT NULL,
+				val text,
+				PRIMARY KEY (grp, id)
+			) USING orioledb;
+			CREATE INDEX o_test_val_idx ON o_test (val, id);
+			INSERT INTO o_test
+				SELECT 'group_' || repeat('x', (i * 7) % 50) || (i % 37),
+					   i, md5(i::text)
+				FROM generate_series(1, 20000) i
+				ORDER BY random();
+		""")
+		self.assertTrue(
+		    node.execute("SELECT orioledb_tbl_check('o_test'::regclass)")[0]
+		    [0])
+		self.assertEqual(
+		    node.execute("SELECT count(*) FROM o_test")[0][0], 20000)
+		self.assertEqual(
+		    node.execute("SET enable_seqscan = off;\n"
+		                 "SELECT count(*) FROM o_test "
+		                 "WHERE val > md5('1')")[0][0],
+		    node.execute("SET enable_seqscan = on;\n"
+		                 "SET enable_indexscan = off;\n"
+		                 "SET enable_bitmapscan = off;\n"
+		                 "SELECT count(*) FROM o_test "
+		                 "WHERE val > md5('1')")[0][0])
+		node.stop()
+
+	def leaf_pages(self, optimized):
+		node = self.node
+		node.safe_psql("""
+			SET orioledb.enable_optimized_split = %s;
+			DROP TABLE IF EXISTS o_append;
+			CREATE TABLE o_append (
+				id int NOT NULL PRIMARY KEY,
+				val text
+			) USING orioledb;
+			DO $$
+			BEGIN
+				FOR i IN 1..5000 LOOP
+					INSERT INTO o_append VALUES (i, repeat('x', 100));
+					IF i %% 10 = 0 THEN
+						UPDATE o_append SET val = repeat('y', 100)
+							WHERE id = i - 5;
+					END IF;
+				END LOOP;
+			END $$;
+		""" % ('on' if optimized else 'off'))
+		self.assertEqual(
+		    node.execute("SELECT count(*) FROM o_append")[0][0], 5000)
+		return node.execute(
+		    "SELECT pages_by_level[1] FROM orioledb_tree_stats()\n"
+		    "  WHERE reloid = 'o_append'::regclass "
+		    "AND index_type = 'primary';")[0][0]
+
+	def test_optimized_split_append(self):
+		node = self.node
+		node.start()
+		node.safe_psql("CREATE EXTENSION IF NOT EXISTS orioledb;")
+		self.assertLessEqual(self.leaf_pages(True), self.leaf_pages(False))
+		node.stop()
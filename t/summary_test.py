@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class SummaryTest(BaseTest):
+
+	def test_summary_scan(self):
+		node = self.node
+		node.append_conf('postgresql.conf', "orioledb.max_summaries = 4\n")
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				id int NOT NULL PRIMARY KEY,
+				val int NOT NULL,
+				payload text
+			) USING orioledb;
+			INSERT INTO o_test
+				SELECT i, i * 2, repeat('x', 100)
+				FROM generate_series(1, 20000) i;
+		""")
+		node.safe_psql("SELECT orioledb_tbl_summarize('o_test'::regclass, "
+		               "'val');")
+
+		plan = node.execute("EXPLAIN SELECT count(*) FROM o_test "
+		                    "WHERE val > 39000;")
+		self.assertIn('Summary Scan of', '\n'.join(r[0] for r in plan))
+
+		self.assertEqual(
+		    node.execute("SELECT count(*) FROM o_test "
+		                 "WHERE val > 39000;")[0][0], 500)
+		self.assertEqual(
+		    node.execute("SELECT count(*) FROM o_test "
+		                 "WHERE val BETWEEN 100 AND 200;")[0][0], 51)
+
+		# Summaries are extended by the modifications
+		node.safe_psql("INSERT INTO o_test VALUES (20001, 5, 'y');")
+		node.safe_psql("UPDATE o_test SET val = 1000000 WHERE id = 10;")
+		self.assertEqual(
+		    node.execute("SELECT count(*) FROM o_test "
+		                 "WHERE val > 39000;")[0][0], 501)
+		self.assertEqual(
+		    node.execute("SELECT count(*) FROM o_test "
+		                 "WHERE val < 10;")[0][0], 5)
+
+		node.safe_psql("SELECT orioledb_tbl_summarize('o_test'::regclass, "
+		               "NULL);")
+		self.assertEqual(
+		    node.execute("SELECT count(*) FROM o_test "
+		                 "WHERE val > 39000;")[0][0], 501)
+		node.stop()
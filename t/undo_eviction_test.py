@@ -55,6 +55,23 @@ class UndoEvictionTest(BaseTest):
 		con1.close()
 		node.stop()
 
+	def test_undo_stats(self):
+		node = self.node
+		con1 = node.connect()
+		con1.begin()
+		pid = con1.execute("SELECT pg_backend_pid();")[0][0]
+		con1.execute(
+		    "INSERT INTO o_undo_evict (SELECT i, i FROM generate_series(1, 100000) i);"
+		)
+		self.assertEqual(
+		    node.execute("""SELECT oldest_retain_pid,
+		                           retained_size >= oldest_retain_size,
+		                           written_to_files > 0
+		                    FROM orioledb_undo;""")[0], (pid, True, True))
+		con1.rollback()
+		con1.close()
+		node.stop()
+
 	def test_undo_eviction_update(self):
 		node = self.node
 
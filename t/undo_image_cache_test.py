@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# coding: utf-8
+
+from .base_test import BaseTest
+
+
+class UndoImageCacheTest(BaseTest):
+
+	def test_undo_image_cache_snapshots(self):
+		node = self.node
+		node.append_conf('postgresql.conf',
+		                 "orioledb.undo_image_cache_buffers = 1MB\n")
+		node.start()
+		node.safe_psql("""
+			CREATE EXTENSION IF NOT EXISTS orioledb;
+			CREATE TABLE o_test (
+				id int NOT NULL PRIMARY KEY,
+				val text
+			) USING orioledb;
+			INSERT INTO o_test
+				SELECT i, repeat('a', 10) FROM generate_series(1, 500) i;
+		""")
+		expected = node.execute("SELECT count(*), sum(length(val)) "
+		                        "FROM o_test;")[0]
+
+		cons = [node.connect() for i in range(3)]
+		for con in cons:
+			con.execute("BEGIN ISOLATION LEVEL REPEATABLE READ;")
+			self.assertEqual(
+			    con.execute("SELECT count(*), sum(length(val)) "
+			                "FROM o_test;")[0], expected)
+
+		# Make the chains of page images in undo
+		for i in range(1, 20):
+			node.safe_psql("UPDATE o_test SET val = repeat('b', %d) "
+			               "WHERE id %% 3 = %d;" % (10 + i * 7, i % 3))
+
+		for j in range(2):
+			for con in cons:
+				self.assertEqual(
+				    con.execute("SELECT count(*), sum(length(val)) "
+				                "FROM o_test;")[0], expected)
+				self.assertEqual(
+				    con.execute("SELECT val FROM o_test WHERE id = 250;")[0][0],
+				    'aaaaaaaaaa')
+		for con in cons:
+			con.commit()
+			con.close()
+
+		self.assertTrue(
+		    node.execute("SELECT orioledb_tbl_check('o_test'::regclass)")[0]
+		    [0])
+		node.stop()